@@ -30,6 +30,7 @@ def parse_options(argv, prog=None):
     parser.add_option("--overwrite-file", dest="overwrite",                        default=False,  help="overwrite -f/--file if it exists", action="store_true")
     parser.add_option("--clients",        dest="clients",   metavar="NUM",         default=3,      help='number of tables to export simultaneously (default: 3)', type="pos_int")
     parser.add_option("--read-outdated",  dest="outdated",                         default=False,  help='use outdated read mode', action="store_true")
+    parser.add_option("--low-io-priority", dest="low_io_priority",                 default=False,  help='let the reads yield the disk to other queries (requires RethinkDB 2.4)', action="store_true")
     
     options, args = parser.parse_args(argv)
     
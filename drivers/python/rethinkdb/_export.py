@@ -57,6 +57,7 @@ def parse_options(argv, prog=None):
     parser.add_option("--format",          dest="format",    metavar="json|csv|ndjson", default="json",     help='format to write (defaults to json. ndjson is newline delimited json.)', type="choice", choices=['json', 'csv', 'ndjson'])
     parser.add_option("--clients",         dest="clients",   metavar="NUM",             default=3,          help='number of tables to export simultaneously (default: 3)', type="pos_int")
     parser.add_option("--read-outdated",   dest="outdated",                             default=False,      help='use outdated read mode',  action="store_true")
+    parser.add_option("--low-io-priority", dest="low_io_priority",                      default=False,      help='let the reads yield the disk to other queries (requires RethinkDB 2.4)', action="store_true")
     
     csvGroup = optparse.OptionGroup(parser, 'CSV options')
     csvGroup.add_option("--delimiter", dest="delimiter",     metavar="CHARACTER",       default=None,       help="character to be used as field delimiter, or '\\t' for tab (default: ',')")
@@ -223,6 +224,8 @@ def export_table(db, table, directory, options, error_queue, progress_info, sind
         }
         if options.outdated:
             runOptions["read_mode"] = "outdated"
+        if options.low_io_priority:
+            runOptions["io_priority"] = "low"
         cursor = options.retryQuery(
             'inital cursor for %s.%s' % (db, table),
             query.db(db).table(table).order_by(index=table_info["primary_key"]),
@@ -389,6 +389,12 @@ class RqlQuery(object):
     def downcase(self, *args):
         return Downcase(self, *args)
 
+    def trigrams(self, *args):
+        return Trigrams(self, *args)
+
+    def tokens(self, *args):
+        return Tokens(self, *args)
+
     def is_empty(self, *args):
         return IsEmpty(self, *args)
 
@@ -1340,6 +1346,16 @@ class Downcase(RqlMethodQuery):
     st = 'downcase'
 
 
+class Trigrams(RqlMethodQuery):
+    tt = pTerm.TRIGRAMS
+    st = 'trigrams'
+
+
+class Tokens(RqlMethodQuery):
+    tt = pTerm.TOKENS
+    st = 'tokens'
+
+
 class OffsetsOf(RqlMethodQuery):
     tt = pTerm.OFFSETS_OF
     st = 'offsets_of'
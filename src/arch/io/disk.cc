@@ -8,6 +8,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <libgen.h>
 #endif
 
@@ -25,6 +26,8 @@
 #include "arch/io/disk/conflict_resolving.hpp"
 #include "arch/io/disk/stats.hpp"
 #include "arch/io/disk/accounting.hpp"
+#include "arch/io/disk/merging.hpp"
+#include "arch/io/disk/uring.hpp"
 #include "backtrace.hpp"
 #include "config/args.hpp"
 #include "do_on_thread.hpp"
@@ -50,12 +53,13 @@ public:
     linux_disk_manager_t(linux_event_queue_t *queue,
                          int batch_factor,
                          int max_concurrent_io_requests,
+                         disk_backend_mode_t backend_mode,
                          perfmon_collection_t *stats) :
         stack_stats(stats, "stack"),
         conflict_resolver(stats),
         accounter(batch_factor),
-        backend_stats(stats, "backend", accounter.producer),
-        backend(queue, backend_stats.producer, max_concurrent_io_requests),
+        merger(stats, accounter.producer),
+        backend_stats(stats, "backend", merger.producer),
         outstanding_txn(0)
     {
         /* Hook up the `submit_fun`s of the parts of the IO stack that are above the
@@ -67,12 +71,36 @@ public:
                                                  &accounter, ph::_1);
 
         /* Hook up everything's `done_fun`. */
-        backend.done_fun = std::bind(&stats_diskmgr_2_t::done, &backend_stats, ph::_1);
-        backend_stats.done_fun = std::bind(&accounting_diskmgr_t::done, &accounter, ph::_1);
+        backend_stats.done_fun = std::bind(&merging_diskmgr_t::done, &merger, ph::_1);
+        merger.done_fun = std::bind(&accounting_diskmgr_t::done, &accounter, ph::_1);
         accounter.done_fun = std::bind(&conflict_resolving_diskmgr_t::done,
                                        &conflict_resolver, ph::_1);
         conflict_resolver.done_fun = std::bind(&stats_diskmgr_t::done, &stack_stats, ph::_1);
         stack_stats.done_fun = std::bind(&linux_disk_manager_t::done, this, ph::_1);
+
+        /* Construct the backend last, because it starts pulling operations from
+        `backend_stats` right away. */
+#if USE_IO_URING
+        if (backend_mode == disk_backend_mode_t::uring_desired) {
+            if (uring_diskmgr_t::is_supported()) {
+                uring_backend.init(new uring_diskmgr_t(
+                    queue, backend_stats.producer, max_concurrent_io_requests));
+                uring_backend->done_fun =
+                    std::bind(&stats_diskmgr_2_t::done, &backend_stats, ph::_1);
+                return;
+            }
+            logWRN("io_uring is not available on this system.  Falling back to the "
+                   "thread pool disk backend.");
+        }
+#else
+        if (backend_mode == disk_backend_mode_t::uring_desired) {
+            logWRN("This build of RethinkDB does not support io_uring.  Using the "
+                   "thread pool disk backend.");
+        }
+#endif
+        pool_backend.init(new pool_diskmgr_t(
+            queue, backend_stats.producer, max_concurrent_io_requests));
+        pool_backend->done_fun = std::bind(&stats_diskmgr_2_t::done, &backend_stats, ph::_1);
     }
 
     ~linux_disk_manager_t() {
@@ -81,8 +109,12 @@ public:
                 outstanding_txn);
     }
 
-    void *create_account(int pri, int outstanding_requests_limit) {
-        return new accounting_diskmgr_t::account_t(&accounter, pri, outstanding_requests_limit);
+    void *create_account(int pri, int outstanding_requests_limit, const char *io_class,
+                         perfmon_keyed_latency_t *queue_latency,
+                         perfmon_keyed_latency_t *service_latency) {
+        return new accounting_diskmgr_t::account_t(&accounter, pri,
+                                                   outstanding_requests_limit, io_class,
+                                                   queue_latency, service_latency);
     }
 
     void destroy_account(void *account) {
@@ -159,6 +191,8 @@ public:
         assert_thread();
         outstanding_txn--;
         action_t *a2 = static_cast<action_t *>(a);
+        a2->account->record_latencies(a2->dequeue_time - a2->submit_time,
+                                      get_ticks() - a2->dequeue_time);
         bool succeeded = a2->get_succeeded();
         if (succeeded) {
             do_on_thread(a2->cb_thread,
@@ -173,27 +207,50 @@ public:
         delete a2;
     }
 
+    void sample_load(double read_latency_percentile,
+                     int64_t *read_latency_usecs_out,
+                     int64_t *queue_depth_out) {
+        assert_thread();
+        *read_latency_usecs_out =
+            stack_stats.take_read_latency_percentile(read_latency_percentile);
+        *queue_depth_out = stack_stats.get_queue_depth();
+    }
+
+    int64_t get_queue_depth() {
+        assert_thread();
+        return stack_stats.get_queue_depth();
+    }
+
 private:
     /* These fields describe the entire IO stack. At the top level, we allocate a new
     action_t object for each operation and record its callback. Then it passes through
     the conflict resolver, which enforces ordering constraints between IO operations by
     holding back operations that must be run after other, currently-running, operations.
     Then it goes to the account manager, which queues up running IO operations according
-    to which account they are part of. Finally the "backend" pops the IO operations
-    from the queue.
+    to which account they are part of. The merger combines reads that are queued at the
+    same time and are next to each other into one. Finally the "backend" pops the IO
+    operations from the queue.
 
     At two points in the process--once as soon as it is submitted, and again right
     as the backend pops it off the queue--its statistics are recorded. The "stack stats"
     will tell you how many IO operations are queued. The "backend stats" will tell you
     how long the OS takes to perform the operations. Note that it's not perfect, because
     it counts operations that have been queued by the backend but not sent to the OS yet
-    as having been sent to the OS. */
+    as having been sent to the OS.
+
+    Exactly one of the backends is used.  The uring backend submits operations to
+    the kernel directly from this thread; the pool backend runs blocking syscalls on
+    a thread pool. */
 
     stats_diskmgr_t stack_stats;
     conflict_resolving_diskmgr_t conflict_resolver;
     accounting_diskmgr_t accounter;
+    merging_diskmgr_t merger;
     stats_diskmgr_2_t backend_stats;
-    pool_diskmgr_t backend;
+    scoped_ptr_t<pool_diskmgr_t> pool_backend;
+#if USE_IO_URING
+    scoped_ptr_t<uring_diskmgr_t> uring_backend;
+#endif
 
 
     intptr_t outstanding_txn;
@@ -202,27 +259,76 @@ private:
 };
 
 io_backender_t::io_backender_t(file_direct_io_mode_t _direct_io_mode,
-                               int max_concurrent_io_requests)
+                               int _max_concurrent_io_requests,
+                               disk_backend_mode_t backend_mode,
+                               const std::vector<std::string> &_stripe_directories)
     : direct_io_mode(_direct_io_mode),
+      max_concurrent_io_requests(_max_concurrent_io_requests),
       diskmgr(new linux_disk_manager_t(&linux_thread_pool_t::get_thread()->queue,
                                        DEFAULT_IO_BATCH_FACTOR,
                                        max_concurrent_io_requests,
-                                       &stats)) { }
+                                       backend_mode,
+                                       &stats)),
+      stripe_directories(_stripe_directories),
+      stripe_stats(stripe_directories.size()),
+      stripe_diskmgrs(stripe_directories.size()) {
+    for (size_t i = 0; i < stripe_directories.size(); ++i) {
+        stripe_diskmgrs[i].init(
+            new linux_disk_manager_t(&linux_thread_pool_t::get_thread()->queue,
+                                     DEFAULT_IO_BATCH_FACTOR,
+                                     max_concurrent_io_requests,
+                                     backend_mode,
+                                     &stripe_stats[i]));
+    }
+}
 
 io_backender_t::~io_backender_t() { }
 
+linux_disk_manager_t *io_backender_t::get_diskmgr_ptr(size_t device) {
+    if (device == 0) {
+        return diskmgr.get();
+    }
+    guarantee(device <= stripe_diskmgrs.size());
+    return stripe_diskmgrs[device - 1].get();
+}
+
 file_direct_io_mode_t io_backender_t::get_direct_io_mode() const { return direct_io_mode; }
 
+void io_backender_t::sample_load(double read_latency_percentile,
+                                 int64_t *read_latency_usecs_out,
+                                 int64_t *queue_depth_out) {
+    on_thread_t thread_switcher(diskmgr->home_thread());
+    diskmgr->sample_load(
+        read_latency_percentile, read_latency_usecs_out, queue_depth_out);
+    // The slowest device is the one that limits us.
+    for (size_t i = 0; i < stripe_diskmgrs.size(); ++i) {
+        int64_t latency, depth;
+        stripe_diskmgrs[i]->sample_load(read_latency_percentile, &latency, &depth);
+        *read_latency_usecs_out = std::max(*read_latency_usecs_out, latency);
+        *queue_depth_out += depth;
+    }
+}
+
+int64_t io_backender_t::get_queue_depth() {
+    on_thread_t thread_switcher(diskmgr->home_thread());
+    int64_t depth = diskmgr->get_queue_depth();
+    for (size_t i = 0; i < stripe_diskmgrs.size(); ++i) {
+        depth += stripe_diskmgrs[i]->get_queue_depth();
+    }
+    return depth;
+}
+
 
 /* Disk file object */
 
 linux_file_t::linux_file_t(scoped_fd_t &&_fd, int64_t _file_size, linux_disk_manager_t *_diskmgr)
-    : fd(std::move(_fd)), file_size(_file_size), diskmgr(_diskmgr) {
+    : fd(std::move(_fd)), file_size(_file_size), mapping(nullptr), mapping_size(0),
+      diskmgr(_diskmgr), io_queue_latency(nullptr), io_service_latency(nullptr) {
     // TODO: Why do we care whether we're in a thread pool?  (Maybe it's that you can't create a
     // file_account_t outside of the thread pool?  But they're associated with the diskmgr,
     // aren't they?)
     if (linux_thread_pool_t::get_thread()) {
-        default_account.init(new file_account_t(this, 1, UNLIMITED_OUTSTANDING_REQUESTS));
+        default_account.init(new file_account_t(this, 1, "default"));
     }
 }
 
@@ -246,6 +352,11 @@ void linux_file_t::set_file_size(int64_t new_size) {
 
         auto_drainer_t::lock_t lock;
     };
+    if (new_size < mapping_size) {
+        // Touching the mapping beyond the end of the file would raise `SIGBUS`.
+        unmap();
+    }
+
     rs_callback_t *rs_callback = new rs_callback_t();
     rs_callback->lock = file_size_ops_drainer.lock();
     diskmgr->submit_resize(fd.get(), file_size, new_size,
@@ -255,7 +366,6 @@ void linux_file_t::set_file_size(int64_t new_size) {
     file_size = new_size;
 }
 
-// For growing in large chunks at a time.
 int64_t chunk_factor(int64_t size, int64_t extent_size) {
     // x is at most 12.5% of size. Overall we align to chunks no larger than 64 extents.
     // This ratio was increased from 6.25% for performance reasons.  Resizing a file
@@ -367,9 +477,18 @@ bool linux_file_t::coop_lock_and_check() {
 #endif
 }
 
-void *linux_file_t::create_account(int priority, int outstanding_requests_limit) {
+void *linux_file_t::create_account(int priority, int outstanding_requests_limit,
+                                   const char *io_class) {
     assert_thread();
-    return diskmgr->create_account(priority, outstanding_requests_limit);
+    return diskmgr->create_account(priority, outstanding_requests_limit, io_class,
+                                   io_queue_latency, io_service_latency);
+}
+
+void linux_file_t::set_io_latency_stats(perfmon_keyed_latency_t *queue_latency,
+                                        perfmon_keyed_latency_t *service_latency) {
+    assert_thread();
+    io_queue_latency = queue_latency;
+    io_service_latency = service_latency;
 }
 
 void linux_file_t::destroy_account(void *account) {
@@ -379,7 +498,63 @@ void linux_file_t::destroy_account(void *account) {
 
 
 
+bool linux_file_t::read_mapped(int64_t offset, size_t length, void *buf) {
+    assert_thread();
+#ifdef _WIN32
+    // TODO WINDOWS
+    (void) offset;
+    (void) length;
+    (void) buf;
+    return false;
+#else
+    if (offset + static_cast<int64_t>(length) > file_size) {
+        return false;
+    }
+    if (offset + static_cast<int64_t>(length) > mapping_size) {
+        // The file has grown since we mapped it.
+        unmap();
+        void *res = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd.get(), 0);
+        if (res == MAP_FAILED) {
+            return false;
+        }
+        mapping = static_cast<char *>(res);
+        mapping_size = file_size;
+    }
+
+    // Copying a page that isn't resident would block the whole thread on the disk,
+    // so we check first.
+    const int64_t page_size = sysconf(_SC_PAGESIZE);
+    const int64_t first_page = floor_aligned(offset, page_size);
+    const int64_t end_page = ceil_aligned(offset + length, page_size);
+    const size_t num_pages = (end_page - first_page) / page_size;
+    unsigned char residency[64];
+    if (num_pages > sizeof(residency)
+        || mincore(mapping + first_page, end_page - first_page, residency) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < num_pages; ++i) {
+        if ((residency[i] & 1) == 0) {
+            return false;
+        }
+    }
+
+    memcpy(buf, mapping + offset, length);
+    return true;
+#endif
+}
+
+void linux_file_t::unmap() {
+#ifndef _WIN32
+    if (mapping != nullptr) {
+        guarantee_err(munmap(mapping, mapping_size) == 0, "munmap failed");
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+#endif
+}
+
 linux_file_t::~linux_file_t() {
+    unmap();
     // scoped_fd_t's destructor takes care of close()ing the file
 }
 
@@ -411,7 +586,7 @@ void verify_aligned_file_access(DEBUG_VAR int64_t file_size, DEBUG_VAR int64_t o
 }
 
 file_open_result_t open_file(const char *path, const int mode, io_backender_t *backender,
-                             scoped_ptr_t<file_t> *out) {
+                             scoped_ptr_t<file_t> *out, size_t device) {
     scoped_fd_t fd;
 
 #ifdef _WIN32
@@ -585,7 +760,8 @@ file_open_result_t open_file(const char *path, const int mode, io_backender_t *b
     // created file's directory entry is persisted to disk.
     warn_fsync_parent_directory(path);
 
-    out->init(new linux_file_t(std::move(fd), file_size, backender->get_diskmgr_ptr()));
+    out->init(new linux_file_t(std::move(fd), file_size,
+                               backender->get_diskmgr_ptr(device)));
 
     return open_res;
 }
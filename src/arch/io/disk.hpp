@@ -2,6 +2,9 @@
 #ifndef ARCH_IO_DISK_HPP_
 #define ARCH_IO_DISK_HPP_
 
+#include <string>
+#include <vector>
+
 #include "arch/io/io_utils.hpp"
 #include "arch/types.hpp"
 #include "concurrency/auto_drainer.hpp"
@@ -28,16 +31,43 @@ public:
     // This takes what is effectively a global flag whether to use O_DIRECT here.  Nothing technical
     // stops us from specifying this on a file-by-file basis, but right now there's no desire for
     // that.  See https://github.com/rethinkdb/rethinkdb/issues/97#issuecomment-19778177 .
+    //
+    // Table files are striped across the data directory and the
+    // `stripe_directories`, which should be on different devices.  Each of them gets
+    // its own disk manager, so that every device has its own I/O queue; device 0 is
+    // the data directory, and device `i + 1` is `stripe_directories[i]`.
     io_backender_t(file_direct_io_mode_t direct_io_mode,
-                   int max_concurrent_io_requests = DEFAULT_MAX_CONCURRENT_IO_REQUESTS);
+                   int max_concurrent_io_requests = DEFAULT_MAX_CONCURRENT_IO_REQUESTS,
+                   disk_backend_mode_t backend_mode = disk_backend_mode_t::pool,
+                   const std::vector<std::string> &stripe_directories
+                       = std::vector<std::string>());
     ~io_backender_t();
-    linux_disk_manager_t *get_diskmgr_ptr() { return diskmgr.get(); }
+    linux_disk_manager_t *get_diskmgr_ptr(size_t device = 0);
+    const std::vector<std::string> &get_stripe_directories() const {
+        return stripe_directories;
+    }
     file_direct_io_mode_t get_direct_io_mode() const;
+    int get_max_concurrent_io_requests() const { return max_concurrent_io_requests; }
+
+    /* Returns the `read_latency_percentile` read latency (see
+    `stats_diskmgr_t::take_read_latency_percentile()`) since the last call, and how many
+    operations are currently queued or running. May be called on any thread. */
+    void sample_load(double read_latency_percentile,
+                     int64_t *read_latency_usecs_out,
+                     int64_t *queue_depth_out);
+
+    /* Like the queue depth from `sample_load()`, but leaves the read latencies for its
+    caller. May be called on any thread. */
+    int64_t get_queue_depth();
 
 protected:
     const file_direct_io_mode_t direct_io_mode;
+    const int max_concurrent_io_requests;
     perfmon_collection_t stats;
     scoped_ptr_t<linux_disk_manager_t> diskmgr;
+    const std::vector<std::string> stripe_directories;
+    scoped_array_t<perfmon_collection_t> stripe_stats;
+    scoped_array_t<scoped_ptr_t<linux_disk_manager_t> > stripe_diskmgrs;
 
 private:
     DISABLE_COPYING(io_backender_t);
@@ -81,24 +111,42 @@ public:
     void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
                       file_account_t *account, linux_iocallback_t *cb);
 
+    bool read_mapped(int64_t offset, size_t length, void *buf);
+
     bool coop_lock_and_check();
 
-    void *create_account(int priority, int outstanding_requests_limit);
+    void *create_account(int priority, int outstanding_requests_limit,
+                         const char *io_class);
     void destroy_account(void *account);
 
+    void set_io_latency_stats(perfmon_keyed_latency_t *queue_latency,
+                              perfmon_keyed_latency_t *service_latency);
+
     ~linux_file_t();
 
 private:
     linux_file_t(scoped_fd_t &&fd, int64_t file_size, linux_disk_manager_t *diskmgr);
     friend file_open_result_t open_file(const char *path, int mode,
                                         io_backender_t *backender,
-                                        scoped_ptr_t<file_t> *out);
+                                        scoped_ptr_t<file_t> *out,
+                                        size_t device);
+
+    void unmap();
 
     scoped_fd_t fd;
     int64_t file_size;
 
+    // The mapping `read_mapped()` copies from, created the first time it's called.
+    // It covers the first `mapping_size` bytes of the file.
+    char *mapping;
+    int64_t mapping_size;
+
     linux_disk_manager_t *diskmgr;
 
+    // Where the accounts of this file record their latencies, if anywhere.
+    perfmon_keyed_latency_t *io_queue_latency;
+    perfmon_keyed_latency_t *io_service_latency;
+
     scoped_ptr_t<file_account_t> default_account;
 
     // Used to make sure we do not destruct the linux_file_t until all file size
@@ -108,9 +156,14 @@ private:
     DISABLE_COPYING(linux_file_t);
 };
 
+// `device` picks the I/O queue of the file; see `io_backender_t`.
 file_open_result_t open_file(const char *path, int mode,
                              io_backender_t *backender,
-                             scoped_ptr_t<file_t> *out);
+                             scoped_ptr_t<file_t> *out,
+                             size_t device = 0);
+
+// For growing files in large chunks at a time.
+int64_t chunk_factor(int64_t size, int64_t extent_size);
 
 NORETURN void crash_due_to_inaccessible_database_file(const char *path, file_open_result_t open_res);
 
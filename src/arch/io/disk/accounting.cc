@@ -47,16 +47,28 @@ private:
     DISABLE_COPYING(accounting_diskmgr_eager_account_t);
 };
 
-accounting_diskmgr_account_t::accounting_diskmgr_account_t(accounting_diskmgr_t *_par,
-                                                           int _pri,
-                                                           int _outstanding_requests_limit)
+accounting_diskmgr_account_t::accounting_diskmgr_account_t(
+        accounting_diskmgr_t *_par, int _pri, int _outstanding_requests_limit,
+        const char *_io_class, perfmon_keyed_latency_t *_queue_latency,
+        perfmon_keyed_latency_t *_service_latency)
         : par(_par), pri(_pri),
-          outstanding_requests_limit(_outstanding_requests_limit) { }
+          outstanding_requests_limit(_outstanding_requests_limit),
+          io_class(_io_class),
+          queue_latency(_queue_latency),
+          service_latency(_service_latency) { }
 
 accounting_diskmgr_account_t::~accounting_diskmgr_account_t() {
     par->assert_thread();
 }
 
+void accounting_diskmgr_account_t::record_latencies(ticks_t queue_ticks,
+                                                    ticks_t service_ticks) {
+    if (queue_latency != nullptr) {
+        queue_latency->record(io_class, queue_ticks / 1000);
+        service_latency->record(io_class, service_ticks / 1000);
+    }
+}
+
 void accounting_diskmgr_account_t::push(action_t *action) {
     maybe_init();
     if (!requests_drainer.has()) {
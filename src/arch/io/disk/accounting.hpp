@@ -12,6 +12,7 @@
 #include "concurrency/semaphore.hpp"
 #include "arch/io/disk.hpp"
 #include "arch/io/disk/stats_2.hpp"
+#include "perfmon/perfmon.hpp"
 
 /* `casting_passive_producer_t` is useful when you have a
 `passive_producer_t<X>` but you need a `passive_producer_t<Y>`, where `X` can
@@ -47,11 +48,17 @@ struct accounting_diskmgr_account_t {
 
     accounting_diskmgr_account_t(accounting_diskmgr_t *_par,
                                  int _pri,
-                                 int _outstanding_requests_limit);
+                                 int _outstanding_requests_limit,
+                                 const char *_io_class,
+                                 perfmon_keyed_latency_t *_queue_latency,
+                                 perfmon_keyed_latency_t *_service_latency);
 
     ~accounting_diskmgr_account_t();
 
     void push(action_t *action);
+    /* Records how long an operation of this account waited for the backend and how
+    long the backend took to run it, if the account has latency stats. */
+    void record_latencies(ticks_t queue_ticks, ticks_t service_ticks);
     void on_semaphore_available();
     co_semaphore_t *get_outstanding_requests_limiter();
 
@@ -63,6 +70,9 @@ private:
     accounting_diskmgr_t *par;
     int pri;
     int outstanding_requests_limit;
+    const char *io_class;
+    perfmon_keyed_latency_t *queue_latency;
+    perfmon_keyed_latency_t *service_latency;
     scoped_ptr_t<eager_account_t> eager_account;
     // A scoped pointer because we create the drainer lazily on first use.
     scoped_ptr_t<auto_drainer_t> requests_drainer;
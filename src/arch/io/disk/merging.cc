@@ -0,0 +1,172 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/io/disk/merging.hpp"
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "config/args.hpp"
+
+struct merging_diskmgr_merged_read_t : public accounting_payload_t {
+    // The original reads, by offset
+    std::vector<accounting_payload_t *> reads;
+    // Where the bytes between them go, if there are any
+    scoped_device_block_aligned_ptr_t<char> gap_buffer;
+};
+
+merging_diskmgr_t::merging_diskmgr_t(perfmon_collection_t *stats,
+                                     passive_producer_t<action_t *> *_source)
+    : passive_producer_t<action_t *>(&available_control),
+      producer(this),
+      source(_source),
+      stats_membership(stats,
+                       &pm_merged_reads, "merged_reads",
+                       &pm_reads_merged, "reads_merged",
+                       &pm_merge_gap_bytes, "merge_gap_bytes") {
+    source->available->set_callback(this);
+    available_control.set_available(source->available->get());
+}
+
+merging_diskmgr_t::~merging_diskmgr_t() {
+    rassert(held.empty());
+    source->available->unset_callback();
+}
+
+void merging_diskmgr_t::on_source_availability_changed() {
+    available_control.set_available(!held.empty() || source->available->get());
+}
+
+merging_diskmgr_t::action_t *merging_diskmgr_t::produce_next_value() {
+    while (held.size() < DISK_MERGE_MAX_LOOKAHEAD && source->available->get()) {
+        held.push_back(source->pop());
+    }
+    rassert(!held.empty());
+    action_t *a = held.front();
+    held.pop_front();
+    if (a->get_is_read()) {
+        a = merge_with_held(a);
+    }
+    available_control.set_available(!held.empty() || source->available->get());
+    return a;
+}
+
+static bool offset_less(const accounting_payload_t *x, const accounting_payload_t *y) {
+    return x->get_offset() < y->get_offset();
+}
+
+merging_diskmgr_t::action_t *merging_diskmgr_t::merge_with_held(action_t *first) {
+#if USE_WRITEV
+    std::vector<action_t *> reads(1, first);
+    int64_t begin = first->get_offset();
+    int64_t end = begin + first->get_count();
+
+    // Grow the range in either direction for as long as there's a read to add.
+    for (bool grew = true; grew;) {
+        grew = false;
+        for (auto it = held.begin(); it != held.end(); ++it) {
+            action_t *a = *it;
+            if (!a->get_is_read() || a->get_fd() != first->get_fd()) {
+                continue;
+            }
+            const int64_t a_begin = a->get_offset();
+            const int64_t a_end = a_begin + a->get_count();
+            const bool adjacent =
+                (a_begin >= end && a_begin - end <= DISK_MERGE_MAX_GAP)
+                || (a_end <= begin && begin - a_end <= DISK_MERGE_MAX_GAP);
+            if (adjacent
+                && std::max(end, a_end) - std::min(begin, a_begin)
+                    <= DISK_MERGE_MAX_SIZE) {
+                reads.push_back(a);
+                begin = std::min(begin, a_begin);
+                end = std::max(end, a_end);
+                held.erase(it);
+                grew = true;
+                break;
+            }
+        }
+    }
+    if (reads.size() == 1) {
+        return first;
+    }
+
+    std::sort(reads.begin(), reads.end(), &offset_less);
+    size_t num_vecs = 0;
+    int64_t max_gap = 0;
+    int64_t gap_bytes = 0;
+    for (size_t i = 0; i < reads.size(); ++i) {
+        iovec *vecs;
+        size_t vecs_len;
+        reads[i]->get_bufs(&vecs, &vecs_len);
+        num_vecs += vecs_len;
+        if (i > 0) {
+            const int64_t gap = reads[i]->get_offset()
+                - (reads[i - 1]->get_offset() + reads[i - 1]->get_count());
+            if (gap > 0) {
+                ++num_vecs;
+                max_gap = std::max(max_gap, gap);
+                gap_bytes += gap;
+            }
+        }
+    }
+
+    merging_diskmgr_merged_read_t *merged = new merging_diskmgr_merged_read_t;
+    if (max_gap > 0) {
+        // The gaps may all share one buffer, since nobody looks at what's in it.
+        merged->gap_buffer = scoped_device_block_aligned_ptr_t<char>(max_gap);
+    }
+    scoped_array_t<iovec> merged_vecs(num_vecs);
+    size_t n = 0;
+    for (size_t i = 0; i < reads.size(); ++i) {
+        if (i > 0) {
+            const int64_t gap = reads[i]->get_offset()
+                - (reads[i - 1]->get_offset() + reads[i - 1]->get_count());
+            if (gap > 0) {
+                merged_vecs[n].iov_base = merged->gap_buffer.get();
+                merged_vecs[n].iov_len = gap;
+                ++n;
+            }
+        }
+        iovec *vecs;
+        size_t vecs_len;
+        reads[i]->get_bufs(&vecs, &vecs_len);
+        for (size_t j = 0; j < vecs_len; ++j) {
+            merged_vecs[n++] = vecs[j];
+        }
+    }
+    rassert(n == num_vecs);
+
+    merged->make_readv(first->get_fd(), std::move(merged_vecs), end - begin, begin);
+    merged->reads = std::move(reads);
+
+    ++pm_merged_reads;
+    pm_reads_merged += merged->reads.size();
+    pm_merge_gap_bytes += gap_bytes;
+    return merged;
+#else
+    return first;
+#endif
+}
+
+void merging_diskmgr_t::done(action_t *a) {
+    merging_diskmgr_merged_read_t *merged =
+        dynamic_cast<merging_diskmgr_merged_read_t *>(a);
+    if (merged == nullptr) {
+        done_fun(a);
+        return;
+    }
+
+    // The backends always read everything or report an error.
+    const int64_t error = merged->get_succeeded()
+        ? 0
+        : (merged->io_result < 0 ? merged->io_result : -EIO);
+    std::vector<action_t *> reads = std::move(merged->reads);
+    for (action_t *r : reads) {
+        r->io_result = error == 0 ? static_cast<int64_t>(r->get_count()) : error;
+        r->dequeue_time = merged->dequeue_time;
+    }
+    delete merged;
+    for (action_t *r : reads) {
+        done_fun(r);
+    }
+}
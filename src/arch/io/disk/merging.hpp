@@ -0,0 +1,65 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_DISK_MERGING_HPP_
+#define ARCH_IO_DISK_MERGING_HPP_
+
+#include <deque>
+#include <functional>
+
+#include "arch/io/disk/accounting.hpp"
+#include "perfmon/perfmon.hpp"
+
+/* `merging_diskmgr_t` sits between the `accounting_diskmgr_t` and the backend.  When
+the backend pops an operation, it also looks at the other operations that are queued
+(up to `DISK_MERGE_MAX_LOOKAHEAD` of them), and turns the reads of the same file that
+are next to each other, or at most `DISK_MERGE_MAX_GAP` bytes apart, into a single
+vectored read.  The bytes in the gaps are read into a scratch buffer and thrown away,
+which is safe even if a write to a gap is running at the same time.  Everything it
+doesn't merge is handed to the backend later, in the order it came in.
+
+Since the conflict resolver never lets two conflicting operations through at the same
+time, none of the operations that are queued here conflict with each other, so the
+order in which they run doesn't matter.
+
+When a merged read is done, `done()` passes its result on to each of the original
+reads and calls `done_fun` on them. */
+
+struct merging_diskmgr_merged_read_t;
+
+class merging_diskmgr_t : private passive_producer_t<accounting_payload_t *>,
+                          private availability_callback_t {
+public:
+    typedef accounting_payload_t action_t;
+
+    merging_diskmgr_t(perfmon_collection_t *stats,
+                      passive_producer_t<action_t *> *_source);
+    ~merging_diskmgr_t();
+
+    passive_producer_t<action_t *> *const producer;
+
+    std::function<void (action_t *)> done_fun;
+    void done(action_t *a);
+
+private:
+    action_t *produce_next_value();
+    void on_source_availability_changed();
+
+    // Takes the queued reads that can be merged with `first` out of `held`.  Returns
+    // `first` itself if there aren't any.
+    action_t *merge_with_held(action_t *first);
+
+    passive_producer_t<action_t *> *const source;
+    availability_control_t available_control;
+
+    // Operations that got popped from `source` to look for reads to merge, but that
+    // haven't been passed on yet
+    std::deque<action_t *> held;
+
+    // How many merged reads were run, how many reads went into them, and how many
+    // bytes of gaps between them had to be read as well
+    perfmon_counter_t pm_merged_reads, pm_reads_merged, pm_merge_gap_bytes;
+    perfmon_multi_membership_t stats_membership;
+
+    DISABLE_COPYING(merging_diskmgr_t);
+};
+
+#endif  // ARCH_IO_DISK_MERGING_HPP_
@@ -64,6 +64,17 @@ struct pool_diskmgr_action_t
         offset = _offset;
         size_change = 0;
     }
+
+    void make_readv(fd_t _fd, scoped_array_t<iovec> &&_bufs, size_t _count, int64_t _offset) {
+        type = ACTION_READ;
+        wrap_in_datasyncs = false;
+        fd = _fd;
+        iovecs = std::move(_bufs);
+        buf_and_count.iov_base = nullptr;
+        buf_and_count.iov_len = _count;
+        offset = _offset;
+        size_change = 0;
+    }
 #endif
 
     void make_read(fd_t _fd, void *_buf, size_t _count, int64_t _offset) {
@@ -102,6 +113,8 @@ struct pool_diskmgr_action_t
 
 private:
     friend class pool_diskmgr_t;
+    friend class uring_diskmgr_t;
+    friend class merging_diskmgr_t;
     pool_diskmgr_t *parent;
 
     enum action_type_t {ACTION_READ, ACTION_WRITE, ACTION_RESIZE};
@@ -110,9 +123,8 @@ private:
     fd_t fd;
 
     // Either type is ACTION_RESIZE, or buf_and_count.iov_base is used, or iovecs
-    // is used (for writev).  If iovecs is used, then buf_and_count.iov_len is the
-    // sum of the iovecs' iov_len fields.  Currently readv is not supported, but if
-    // you need it, it should be easy to add.
+    // is used (for writev or readv).  If iovecs is used, then buf_and_count.iov_len
+    // is the sum of the iovecs' iov_len fields.
     scoped_array_t<iovec> iovecs;
     iovec buf_and_count;
     int64_t offset;
@@ -1,14 +1,25 @@
 #include "arch/io/disk/stats.hpp"
 
+#include "time.hpp"
+
 stats_diskmgr_t::stats_diskmgr_t(perfmon_collection_t *stats, const std::string &name) :
     read_sampler(secs_to_ticks(1)),
     write_sampler(secs_to_ticks(1)),
     stats_membership(stats,
                      &read_sampler, (name + "_read").c_str(),
-                     &write_sampler, (name + "_write").c_str()) { }
+                     &write_sampler, (name + "_write").c_str(),
+                     &read_latency, (name + "_read_latency").c_str(),
+                     &write_latency, (name + "_write_latency").c_str()),
+    queue_depth(0) {
+    for (int i = 0; i < read_latency_buckets; ++i) {
+        read_latency_histogram[i] = 0;
+    }
+}
 
 
 void stats_diskmgr_t::submit(action_t *a) {
+    ++queue_depth;
+    a->submit_time = get_ticks();
     if (a->get_is_read()) {
         read_sampler.begin(&a->start_time);
     } else {
@@ -19,10 +30,44 @@ void stats_diskmgr_t::submit(action_t *a) {
 
 void stats_diskmgr_t::done(conflict_resolving_diskmgr_action_t *p) {
     action_t *a = static_cast<action_t *>(p);
+    --queue_depth;
     if (a->get_is_read()) {
         read_sampler.end(&a->start_time);
+
+        uint64_t usecs = (get_ticks() - a->submit_time) / 1000;
+        read_latency.record(usecs);
+        int bucket = 0;
+        while (usecs > 1 && bucket < read_latency_buckets - 1) {
+            usecs >>= 1;
+            ++bucket;
+        }
+        ++read_latency_histogram[bucket];
     } else {
         write_sampler.end(&a->start_time);
+        write_latency.record_ticks(get_ticks() - a->submit_time);
     }
     done_fun(a);
 }
+
+int64_t stats_diskmgr_t::take_read_latency_percentile(double percentile) {
+    uint64_t total = 0;
+    for (int i = 0; i < read_latency_buckets; ++i) {
+        total += read_latency_histogram[i];
+    }
+    int64_t result = 0;
+    if (total != 0) {
+        const uint64_t threshold = static_cast<uint64_t>(total * percentile);
+        uint64_t below = 0;
+        for (int i = 0; i < read_latency_buckets; ++i) {
+            below += read_latency_histogram[i];
+            if (below >= threshold) {
+                result = int64_t(2) << i;
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < read_latency_buckets; ++i) {
+        read_latency_histogram[i] = 0;
+    }
+    return result;
+}
@@ -2,6 +2,8 @@
 #ifndef ARCH_IO_DISK_STATS_HPP_
 #define ARCH_IO_DISK_STATS_HPP_
 
+#include <stdint.h>
+
 #include <functional>
 #include <string>
 
@@ -18,6 +20,8 @@ struct stats_diskmgr_t {
 
     struct action_t : public conflict_resolving_diskmgr_action_t {
         ticks_t start_time;
+        /* Unlike `start_time`, this is set even if full perfmon is disabled. */
+        ticks_t submit_time;
     };
 
     void submit(action_t *a);
@@ -28,9 +32,26 @@ struct stats_diskmgr_t {
 
     void done(conflict_resolving_diskmgr_action_t *p);
 
+    /* Returns a latency (in microseconds) that at least `percentile` of the reads that
+    completed since the last call were faster than, or 0 if there were no reads. The
+    result is rounded up to a power of two. */
+    int64_t take_read_latency_percentile(double percentile);
+
+    /* The number of operations that have been submitted but haven't completed yet,
+    including the ones still waiting in the queue. */
+    int64_t get_queue_depth() const { return queue_depth; }
+
 private:
     perfmon_duration_sampler_t read_sampler, write_sampler;
+    /* The time from submitting an operation to its completion, queueing included */
+    perfmon_latency_histogram_t read_latency, write_latency;
     perfmon_multi_membership_t stats_membership;
+
+    /* `read_latency_histogram[i]` counts the reads that took between `2^i` and
+    `2^(i+1)` microseconds. */
+    static const int read_latency_buckets = 32;
+    uint64_t read_latency_histogram[read_latency_buckets];
+    int64_t queue_depth;
 };
 
 #endif /* ARCH_IO_DISK_STATS_HPP_ */
@@ -40,6 +40,7 @@ void stats_diskmgr_2_t::done(pool_diskmgr_t::action_t *p) {
 
 pool_diskmgr_t::action_t *stats_diskmgr_2_t::produce_next_value() {
     action_t *a = source->pop();
+    a->dequeue_time = get_ticks();
     if (a->get_is_read()) {
         read_sampler.begin(&a->start_time);
     } else {
@@ -8,6 +8,9 @@
 
 struct stats_diskmgr_2_action_t : public pool_diskmgr_t::action_t {
     ticks_t start_time;
+    /* When the backend took the operation off the queue. Unlike `start_time`, this is
+    set even if full perfmon is disabled. */
+    ticks_t dequeue_time;
 };
 
 void debug_print(printf_buffer_t *buf,
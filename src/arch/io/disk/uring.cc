@@ -0,0 +1,301 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/io/disk/uring.hpp"
+
+#if USE_IO_URING
+
+#include <limits.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "logger.hpp"
+
+// io_uring can't sensibly use more entries than this, and there's no benefit in
+// asking for more.
+const int URING_MAX_RING_ENTRIES = 4096;
+
+// How many blocker pool threads serve the operations that don't go through the ring.
+const int URING_FALLBACK_POOL_THREADS = 2;
+
+/* glibc doesn't provide wrappers for the io_uring system calls. */
+
+int sys_io_uring_setup(unsigned entries, io_uring_params *params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                       unsigned flags) {
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                   nullptr, 0);
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, const void *arg,
+                          unsigned nr_args) {
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+int uring_queue_depth(int max_concurrent_io_requests) {
+    guarantee(max_concurrent_io_requests > 0);
+    guarantee(max_concurrent_io_requests < MAXIMUM_MAX_CONCURRENT_IO_REQUESTS);
+    return std::min(max_concurrent_io_requests, URING_MAX_RING_ENTRIES);
+}
+
+void *map_ring(int ring_fd, size_t size, off_t offset) {
+    void *res = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+    guarantee_err(res != MAP_FAILED, "Could not map io_uring ring");
+    return res;
+}
+
+template <class T>
+T *ring_field(void *ring, uint32_t offset) {
+    return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+
+struct uring_diskmgr_op_t {
+    uring_diskmgr_op_t() : action(nullptr), remaining(nullptr), remaining_count(0),
+                           bytes_done(0), total_bytes(0) { }
+
+    uring_diskmgr_t::action_t *action;
+
+    // A copy of the action's io vectors.  `remaining` points into it, and the
+    // vectors get advanced when the kernel completes a short transfer.
+    scoped_array_t<iovec> vectors;
+    iovec *remaining;
+    size_t remaining_count;
+
+    int64_t bytes_done;
+    int64_t total_bytes;
+};
+
+bool uring_diskmgr_t::is_supported() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(1, &params);
+    if (fd < 0) {
+        return false;
+    }
+    scoped_fd_t closer(fd);
+    /* We rely on `IORING_OP_READV`/`IORING_OP_WRITEV`, which every kernel with
+    io_uring supports, and on eventfd notifications. */
+    return true;
+}
+
+uring_diskmgr_t::uring_diskmgr_t(linux_event_queue_t *_queue,
+                                 passive_producer_t<action_t *> *_source,
+                                 int max_concurrent_io_requests)
+    : queue(_queue),
+      queue_depth(uring_queue_depth(max_concurrent_io_requests)),
+      source(_source),
+      n_unsubmitted(0),
+      n_pending(0),
+      fallback(_queue, &fallback_queue, URING_FALLBACK_POOL_THREADS) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd = sys_io_uring_setup(queue_depth, &params);
+    guarantee_err(ring_fd >= 0, "Could not set up io_uring");
+    guarantee(params.sq_entries >= static_cast<unsigned>(queue_depth));
+    // The completion ring is at least as big as the submission ring, so it can't
+    // overflow while we have at most `queue_depth` operations in flight.
+    guarantee(params.cq_entries >= static_cast<unsigned>(queue_depth));
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    sq_ring_ptr = map_ring(ring_fd, sq_ring_size, IORING_OFF_SQ_RING);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    cq_ring_ptr = map_ring(ring_fd, cq_ring_size, IORING_OFF_CQ_RING);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ptr = map_ring(ring_fd, sqes_size, IORING_OFF_SQES);
+
+    sq_head = ring_field<unsigned>(sq_ring_ptr, params.sq_off.head);
+    sq_tail = ring_field<unsigned>(sq_ring_ptr, params.sq_off.tail);
+    sq_ring_mask = ring_field<unsigned>(sq_ring_ptr, params.sq_off.ring_mask);
+    sq_array = ring_field<unsigned>(sq_ring_ptr, params.sq_off.array);
+    cq_head = ring_field<unsigned>(cq_ring_ptr, params.cq_off.head);
+    cq_tail = ring_field<unsigned>(cq_ring_ptr, params.cq_off.tail);
+    cq_ring_mask = ring_field<unsigned>(cq_ring_ptr, params.cq_off.ring_mask);
+    cqes = ring_field<void>(cq_ring_ptr, params.cq_off.cqes);
+
+    int notify_fd = completion_event.get_notify_fd();
+    int res = sys_io_uring_register(ring_fd, IORING_REGISTER_EVENTFD, &notify_fd, 1);
+    guarantee_err(res == 0, "Could not register eventfd with io_uring");
+
+    ops.init(queue_depth);
+    free_ops.reserve(queue_depth);
+    for (size_t i = 0; i < ops.size(); ++i) {
+        free_ops.push_back(&ops[i]);
+    }
+
+    fallback.done_fun = std::bind(&uring_diskmgr_t::on_fallback_done, this, ph::_1);
+
+    queue->watch_event(&completion_event, this);
+
+    if (source->available->get()) { pump(); }
+    source->available->set_callback(this);
+}
+
+uring_diskmgr_t::~uring_diskmgr_t() {
+    assert_thread();
+    rassert(n_pending == 0);
+    source->available->unset_callback();
+    queue->forget_event(&completion_event, this);
+
+    munmap(sqes_ptr, sqes_size);
+    munmap(cq_ring_ptr, cq_ring_size);
+    munmap(sq_ring_ptr, sq_ring_size);
+    int res = close(ring_fd);
+    guarantee_err(res == 0 || get_errno() == EINTR, "Could not close io_uring");
+}
+
+void uring_diskmgr_t::on_source_availability_changed() {
+    assert_thread();
+    if (source->available->get()) pump();
+}
+
+void uring_diskmgr_t::on_event(DEBUG_VAR int events) {
+    assert_thread();
+    rassert(events == poll_event_in);
+    completion_event.consume_wakey_wakeys();
+    reap_completions();
+}
+
+void uring_diskmgr_t::pump() {
+    assert_thread();
+    while (source->available->get() && n_pending < queue_depth) {
+        action_t *a = source->pop();
+        n_pending++;
+        if (a->get_is_resize() || a->wrap_in_datasyncs) {
+            fallback_queue.push(a);
+            continue;
+        }
+
+        rassert(!free_ops.empty());
+        uring_diskmgr_op_t *op = free_ops.back();
+        free_ops.pop_back();
+
+        op->action = a;
+        a->copy_vectors(&op->vectors);
+        op->remaining = op->vectors.data();
+        op->remaining_count = op->vectors.size();
+        op->bytes_done = 0;
+        op->total_bytes = 0;
+        for (size_t i = 0; i < op->vectors.size(); ++i) {
+            op->total_bytes += op->vectors[i].iov_len;
+        }
+        prepare_op(op);
+    }
+    flush_submissions();
+}
+
+void uring_diskmgr_t::prepare_op(uring_diskmgr_op_t *op) {
+    // We are the only writer of the submission tail.
+    const unsigned tail = *sq_tail;
+    rassert(tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE)
+            < static_cast<unsigned>(queue_depth));
+    const unsigned index = tail & *sq_ring_mask;
+
+    io_uring_sqe *sqe = static_cast<io_uring_sqe *>(sqes_ptr) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = op->action->get_is_read() ? IORING_OP_READV : IORING_OP_WRITEV;
+    sqe->fd = op->action->get_fd();
+    sqe->off = op->action->get_offset() + op->bytes_done;
+    sqe->addr = reinterpret_cast<uint64_t>(op->remaining);
+    sqe->len = std::min<size_t>(op->remaining_count, IOV_MAX);
+    sqe->user_data = reinterpret_cast<uint64_t>(op);
+
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++n_unsubmitted;
+}
+
+void uring_diskmgr_t::flush_submissions() {
+    while (n_unsubmitted > 0) {
+        int res = sys_io_uring_enter(ring_fd, n_unsubmitted, 0, 0);
+        if (res == -1) {
+            guarantee_err(get_errno() == EINTR || get_errno() == EAGAIN,
+                          "io_uring_enter failed");
+            continue;
+        }
+        rassert(static_cast<unsigned>(res) <= n_unsubmitted);
+        n_unsubmitted -= res;
+    }
+}
+
+void uring_diskmgr_t::reap_completions() {
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        const io_uring_cqe *cqe =
+            static_cast<const io_uring_cqe *>(cqes) + (head & *cq_ring_mask);
+        uring_diskmgr_op_t *op = reinterpret_cast<uring_diskmgr_op_t *>(cqe->user_data);
+        const int32_t res = cqe->res;
+        ++head;
+        // Hand the slot back to the kernel before running the callback, which might
+        // submit more operations.
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+        handle_completion(op, res);
+
+        if (head == tail) {
+            tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+    flush_submissions();
+}
+
+void uring_diskmgr_t::handle_completion(uring_diskmgr_op_t *op, int32_t res) {
+    if (res == -EINTR || res == -EAGAIN) {
+        prepare_op(op);
+        return;
+    } else if (res < 0) {
+        finish_op(op, res);
+        return;
+    } else if (res == 0 && op->action->get_is_write()) {
+        // Same as in `pool_diskmgr_t`: a write that makes no progress means that we
+        // ran out of disk space.
+        logERR("Failed I/O: vectored write of %" PRIi64 " bytes stopped after "
+               "%" PRIi64 " bytes. Assuming we ran out of disk space.",
+               op->total_bytes, op->bytes_done);
+        finish_op(op, -ENOSPC);
+        return;
+    } else if (res == 0) {
+        logERR("Failed I/O: we tried to read from behind the end of the file. "
+               "Either the file got truncated, or there is a bug in RethinkDB.");
+        finish_op(op, -EINVAL);
+        return;
+    }
+
+    op->bytes_done += action_t::advance_vector(&op->remaining, &op->remaining_count,
+                                               res);
+    if (op->bytes_done < op->total_bytes) {
+        prepare_op(op);
+    } else {
+        finish_op(op, op->total_bytes);
+    }
+}
+
+void uring_diskmgr_t::finish_op(uring_diskmgr_op_t *op, int64_t io_result) {
+    action_t *a = op->action;
+    a->io_result = io_result;
+    op->action = nullptr;
+    op->vectors.reset();
+    free_ops.push_back(op);
+
+    n_pending--;
+    pump();
+    done_fun(a);
+}
+
+void uring_diskmgr_t::on_fallback_done(action_t *a) {
+    assert_thread();
+    n_pending--;
+    pump();
+    done_fun(a);
+}
+
+#endif  // USE_IO_URING
@@ -0,0 +1,128 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_DISK_URING_HPP_
+#define ARCH_IO_DISK_URING_HPP_
+
+#include <functional>
+#include <vector>
+
+#include "arch/io/disk/pool.hpp"
+#include "arch/runtime/event_queue.hpp"
+#include "arch/runtime/system_event.hpp"
+#include "concurrency/queue/passive_producer.hpp"
+#include "concurrency/queue/unlimited_fifo.hpp"
+#include "containers/scoped.hpp"
+
+#if defined(__linux) && !defined(NO_EVENTFD) && !defined(LEGACY_LINUX) \
+    && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define USE_IO_URING 1
+#endif
+#endif
+
+#ifndef USE_IO_URING
+#define USE_IO_URING 0
+#endif
+
+#if USE_IO_URING
+
+struct iovec;
+struct uring_diskmgr_op_t;
+
+/* The uring disk manager submits reads and writes to the kernel through an io_uring
+instance owned by the disk manager's home thread, so that no thread handoff is needed
+per operation.  The kernel signals completions through an eventfd which is watched
+by the thread's regular event queue.
+
+Operations that io_uring can't run on its own in the way we need them (resizes and
+writes that have to be wrapped in datasyncs) are handed to a small internal
+`pool_diskmgr_t`.  Those are rare (metablock writes and file extensions).
+
+It has the same interface as `pool_diskmgr_t`, so it slots in underneath
+`stats_diskmgr_2_t` in the I/O stack. */
+
+class uring_diskmgr_t :
+    private availability_callback_t,
+    private linux_event_callback_t,
+    public home_thread_mixin_debug_only_t {
+public:
+    typedef pool_diskmgr_action_t action_t;
+
+    /* Returns false if the running kernel doesn't let us set up an io_uring (too old,
+    or disabled by a seccomp policy or sysctl), in which case the caller should fall
+    back to `pool_diskmgr_t`. */
+    static bool is_supported();
+
+    /* The `uring_diskmgr_t` will draw actions to run from `source`. It will call
+    `done_fun` on each one when it's done. */
+    uring_diskmgr_t(linux_event_queue_t *queue, passive_producer_t<action_t *> *source,
+                    int max_concurrent_io_requests);
+    std::function<void(action_t *)> done_fun;
+    ~uring_diskmgr_t();
+
+private:
+    friend struct uring_diskmgr_op_t;
+
+    void on_source_availability_changed();
+    void on_event(int events);
+
+    void pump();
+    void reap_completions();
+
+    // Fills in the next submission queue entry for `op`.  Doesn't notify the kernel.
+    void prepare_op(uring_diskmgr_op_t *op);
+    // Tells the kernel about all the submission queue entries prepared so far.
+    void flush_submissions();
+    // Handles one completion queue entry; either finishes `op` or resubmits the
+    // rest of a short transfer.
+    void handle_completion(uring_diskmgr_op_t *op, int32_t res);
+    void finish_op(uring_diskmgr_op_t *op, int64_t io_result);
+
+    void on_fallback_done(action_t *a);
+
+    linux_event_queue_t *const queue;
+    const int queue_depth;
+    passive_producer_t<action_t *> *source;
+
+    // The io_uring file descriptor and the memory-mapped rings.
+    int ring_fd;
+    void *sq_ring_ptr;
+    size_t sq_ring_size;
+    void *cq_ring_ptr;
+    size_t cq_ring_size;
+    void *sqes_ptr;
+    size_t sqes_size;
+
+    // Pointers into the mapped rings.
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_ring_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_ring_mask;
+    void *cqes;
+
+    // Number of entries queued up in the submission ring that we haven't passed to
+    // `io_uring_enter` yet.
+    unsigned n_unsubmitted;
+
+    // The kernel writes to this eventfd whenever it posts a completion.
+    system_event_t completion_event;
+
+    // Per-operation bookkeeping.  `free_ops` is the free list into `ops`.
+    scoped_array_t<uring_diskmgr_op_t> ops;
+    std::vector<uring_diskmgr_op_t *> free_ops;
+
+    // Number of actions we've popped from `source` that haven't been completed yet
+    // (including the ones running on the fallback pool).
+    int n_pending;
+
+    unlimited_fifo_queue_t<action_t *> fallback_queue;
+    pool_diskmgr_t fallback;
+
+    DISABLE_COPYING(uring_diskmgr_t);
+};
+
+#endif  // USE_IO_URING
+
+#endif  // ARCH_IO_DISK_URING_HPP_
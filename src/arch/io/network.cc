@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <string.h>
 #include <sys/types.h>
 
@@ -18,6 +19,8 @@
 #include <netinet/tcp.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #endif
 
 #include "arch/runtime/runtime.hpp"
@@ -521,19 +524,34 @@ linux_tcp_conn_t::write_handler_t::write_handler_t(linux_tcp_conn_t *_parent) :
 { }
 
 void linux_tcp_conn_t::write_handler_t::coro_pool_callback(write_queue_op_t *operation, UNUSED signal_t *interruptor) {
-    if (operation->buffer != nullptr) {
-        parent->perform_write(operation->buffer, operation->size);
-        if (operation->dealloc != nullptr) {
-            parent->release_write_buffer(operation->dealloc);
-            parent->write_queue_limiter.unlock(operation->size);
+    /* Whatever got queued up while the previous write was blocked goes out together
+    with this operation, instead of costing a system call per flushed buffer. */
+    std::vector<write_queue_op_t *> ops(1, operation);
+    while (ops.size() < MAX_GATHERED_WRITES && parent->write_queue.available->get()) {
+        ops.push_back(parent->write_queue.pop());
+    }
+    std::vector<const_charslice> buffers;
+    buffers.reserve(ops.size());
+    for (write_queue_op_t *op : ops) {
+        if (op->buffer != nullptr) {
+            const char *data = static_cast<const char *>(op->buffer);
+            buffers.push_back(const_charslice(data, data + op->size));
         }
     }
+    parent->perform_gathered_write(buffers);
 
-    if (operation->cond != nullptr) {
-        operation->cond->pulse();
-    }
-    if (operation->dealloc != nullptr) {
-        parent->release_write_queue_op(operation);
+    for (write_queue_op_t *op : ops) {
+        if (op->buffer != nullptr && op->dealloc != nullptr) {
+            parent->release_write_buffer(op->dealloc);
+            parent->write_queue_limiter.unlock(op->size);
+        }
+
+        if (op->cond != nullptr) {
+            op->cond->pulse();
+        }
+        if (op->dealloc != nullptr) {
+            parent->release_write_queue_op(op);
+        }
     }
 }
 
@@ -598,8 +616,52 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         rassert(op.nb_bytes == size);  // TODO WINDOWS: does windows guarantee this?
     }
 #else
-    while (size > 0) {
-        ssize_t res = ::write(sock.get(), buf, size);
+    iovec iov;
+    iov.iov_base = const_cast<void *>(buf);
+    iov.iov_len = size;
+    perform_writev(&iov, 1);
+#endif
+}
+
+void linux_tcp_conn_t::perform_gathered_write(
+        const std::vector<const_charslice> &buffers) {
+    assert_thread();
+#ifdef _WIN32
+    for (const const_charslice &buffer : buffers) {
+        perform_write(buffer.beg, buffer.end - buffer.beg);
+    }
+#else
+    std::vector<iovec> iov;
+    iov.reserve(buffers.size());
+    for (const const_charslice &buffer : buffers) {
+        iovec v;
+        v.iov_base = const_cast<char *>(buffer.beg);
+        v.iov_len = buffer.end - buffer.beg;
+        iov.push_back(v);
+    }
+    perform_writev(iov.data(), iov.size());
+#endif
+}
+
+#ifndef _WIN32
+void linux_tcp_conn_t::perform_writev(iovec *iov, size_t iovcnt) {
+    assert_thread();
+
+    if (write_closed.is_pulsed()) {
+        return;
+    }
+
+    while (true) {
+        /* `writev()` returns 0 if there's nothing left to write. */
+        while (iovcnt > 0 && iov->iov_len == 0) {
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt == 0) {
+            break;
+        }
+
+        ssize_t res = ::writev(sock.get(), iov, std::min<size_t>(iovcnt, IOV_MAX));
 
         if (res == -1 && (get_errno() == EAGAIN || get_errno() == EWOULDBLOCK)) {
             /* Wait for a notification from the event queue, or for an order to
@@ -632,21 +694,31 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         } else if (res == 0) {
             /* This should never happen either, but it's better to write an error message than to
                crash completely. */
-            logERR("Didn't expect write() to return 0.");
+            logERR("Didn't expect writev() to return 0.");
             on_shutdown_write();
             break;
 
         } else {
-            rassert(res <= static_cast<ssize_t>(size));
-            buf = reinterpret_cast<const void *>(reinterpret_cast<const char *>(buf) + res);
-            size -= res;
             if (write_perfmon) {
                 write_perfmon->record(res);
             }
+            size_t written = res;
+            while (written > 0) {
+                rassert(iovcnt > 0);
+                if (written >= iov->iov_len) {
+                    written -= iov->iov_len;
+                    ++iov;
+                    --iovcnt;
+                } else {
+                    iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+                    iov->iov_len -= written;
+                    written = 0;
+                }
+            }
         }
     }
-#endif
 }
+#endif
 
 void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
     write_op_wrapper_t sentry(this, closer);
@@ -679,6 +751,38 @@ void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THR
     }
 }
 
+void linux_tcp_conn_t::write_gathered(const std::vector<const_charslice> &buffers,
+                                      signal_t *closer)
+        THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    write_op_wrapper_t sentry(this, closer);
+
+    if (current_write_buffer->size > 0) {
+        internal_flush_write_buffer();
+    }
+    if (buffers.empty()) {
+        return;
+    }
+
+    /* As in `write()`, the operations refer to the caller's buffers. The write
+    coroutine hands consecutive operations to the socket together, so these mostly go
+    out in a single `writev()`. Only the last one signals us. */
+    scoped_array_t<write_queue_op_t> ops(buffers.size());
+    cond_t to_signal_when_done;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        ops[i].buffer = buffers[i].beg;
+        ops[i].size = buffers[i].end - buffers[i].beg;
+        ops[i].dealloc = nullptr;
+        ops[i].cond = i + 1 == buffers.size() ? &to_signal_when_done : nullptr;
+        write_queue.push(&ops[i]);
+    }
+
+    to_signal_when_done.wait();
+
+    if (write_closed.is_pulsed()) {
+        throw tcp_conn_write_closed_exc_t();
+    }
+}
+
 void linux_tcp_conn_t::write_buffered(const void *vbuf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
     write_op_wrapper_t sentry(this, closer);
 
@@ -849,7 +953,8 @@ bool linux_tcp_conn_t::getpeername(ip_and_port_t *ip_and_port) {
     socklen_t addr_len = sizeof(addr);
 
     int res = ::getpeername(fd_to_socket(sock.get()), reinterpret_cast<sockaddr *>(&addr), &addr_len);
-    if (res == 0) {
+    // Connections over Unix domain sockets don't have an IP address.
+    if (res == 0 && (addr.ss_family == AF_INET || addr.ss_family == AF_INET6)) {
         *ip_and_port = ip_and_port_t(reinterpret_cast<sockaddr *>(&addr));
         return true;
     }
@@ -908,7 +1013,8 @@ linux_secure_tcp_conn_t::linux_secure_tcp_conn_t(
         signal_t *interruptor, int local_port)
         THROWS_ONLY(connect_failed_exc_t, crypto::openssl_error_t, interrupted_exc_t) :
     linux_tcp_conn_t(host, port, interruptor, local_port),
-    conn(tls_ctx) {
+    conn(tls_ctx),
+    kernel_tls_send(false) {
 
     conn.set_fd(sock.get());
     SSL_set_connect_state(conn.get());
@@ -920,7 +1026,8 @@ linux_secure_tcp_conn_t::linux_secure_tcp_conn_t(
         SSL_CTX *tls_ctx, fd_t _sock, signal_t *interruptor)
         THROWS_ONLY(crypto::openssl_error_t, interrupted_exc_t) :
     linux_tcp_conn_t(_sock),
-    conn(tls_ctx) {
+    conn(tls_ctx),
+    kernel_tls_send(false) {
 
     conn.set_fd(sock.get());
     SSL_set_accept_state(conn.get());
@@ -947,7 +1054,11 @@ void linux_secure_tcp_conn_t::perform_handshake(signal_t *interruptor)
         int ret = SSL_do_handshake(conn.get());
 
         if (ret > 0) {
-            return; // Successful TLS handshake.
+            // Successful TLS handshake.
+#ifdef SSL_OP_ENABLE_KTLS
+            kernel_tls_send = BIO_get_ktls_send(SSL_get_wbio(conn.get())) > 0;
+#endif
+            return;
         }
 
         if (ret == 0) {
@@ -1044,6 +1155,21 @@ size_t linux_secure_tcp_conn_t::read_internal(void *buffer, size_t size)
     }
 }
 
+void linux_secure_tcp_conn_t::perform_gathered_write(
+        const std::vector<const_charslice> &buffers) {
+    if (kernel_tls_send) {
+        /* The kernel turns whatever we write to the socket into application data
+        records, so we can hand it all buffers at once without copying them. */
+        if (!closed.is_pulsed()) {
+            linux_tcp_conn_t::perform_gathered_write(buffers);
+        }
+        return;
+    }
+    for (const const_charslice &buffer : buffers) {
+        perform_write(buffer.beg, buffer.end - buffer.beg);
+    }
+}
+
 void linux_secure_tcp_conn_t::perform_write(const void *buffer, size_t size) {
     assert_thread();
 
@@ -1277,6 +1403,24 @@ linux_nonthrowing_tcp_listener_t::linux_nonthrowing_tcp_listener_t(
     }
 }
 
+#ifndef _WIN32
+linux_nonthrowing_tcp_listener_t::linux_nonthrowing_tcp_listener_t(
+         const std::string &_unix_socket_path,
+         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &cb) :
+    callback(cb),
+    local_addresses(),
+    port(0),
+    unix_socket_path(_unix_socket_path),
+    bound(false),
+    socks(),
+    last_used_socket_index(0),
+    event_watchers(),
+    log_next_error(true)
+{
+    guarantee(!unix_socket_path.empty());
+}
+#endif
+
 bool linux_nonthrowing_tcp_listener_t::begin_listening() {
     if (!bound) {
         try {
@@ -1318,6 +1462,21 @@ int linux_nonthrowing_tcp_listener_t::get_port() const {
 }
 
 int linux_nonthrowing_tcp_listener_t::init_sockets() {
+#ifndef _WIN32
+    if (!unix_socket_path.empty()) {
+        event_watchers.reset();
+        event_watchers.init(1);
+        socks.reset();
+        socks.init(1);
+        socks[0].reset(socket(AF_UNIX, SOCK_STREAM, 0));
+        if (socks[0].get() == INVALID_FD) {
+            return get_errno();
+        }
+        event_watchers[0].init(new event_watcher_t(socks[0].get(), this));
+        return 0;
+    }
+#endif
+
     event_watchers.reset();
     event_watchers.init(local_addresses.size());
     socks.reset();
@@ -1465,7 +1624,61 @@ void fallback_to_ipv4(std::set<ip_address_t> *addrs, int err, int port) {
            "falling back to IPv4 only", port);
 }
 
+#ifndef _WIN32
+int linux_nonthrowing_tcp_listener_t::bind_unix_socket() {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (unix_socket_path.size() >= sizeof(addr.sun_path)) {
+        return ENAMETOOLONG;
+    }
+    memcpy(addr.sun_path, unix_socket_path.data(), unix_socket_path.size());
+
+    int res = init_sockets();
+    if (res != 0) {
+        return res;
+    }
+    if (bind(socks[0].get(), reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        res = get_errno();
+        if (res != EADDRINUSE) {
+            return res;
+        }
+        // The file is left over from a server that didn't shut down cleanly if it's a
+        // socket that refuses connections.  Then we can replace it.
+        struct stat st;
+        if (lstat(unix_socket_path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) {
+            return EADDRINUSE;
+        }
+        scoped_fd_t probe(socket(AF_UNIX, SOCK_STREAM, 0));
+        if (probe.get() == INVALID_FD) {
+            return get_errno();
+        }
+        if (connect(probe.get(), reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0
+            || get_errno() != ECONNREFUSED) {
+            return EADDRINUSE;
+        }
+        if (unlink(unix_socket_path.c_str()) != 0
+            || bind(socks[0].get(), reinterpret_cast<sockaddr *>(&addr),
+                    sizeof(addr)) != 0) {
+            return get_errno();
+        }
+    }
+    bound = true;
+    return 0;
+}
+#endif
+
 void linux_nonthrowing_tcp_listener_t::bind_sockets() {
+#ifndef _WIN32
+    if (!unix_socket_path.empty()) {
+        int res = bind_unix_socket();
+        if (res != 0) {
+            throw tcp_socket_exc_t(res, port);
+        }
+        return;
+    }
+#endif
+
     // It may take multiple attempts to get all the sockets onto the same port
     int local_port = port;
 
@@ -1656,6 +1869,15 @@ linux_nonthrowing_tcp_listener_t::~linux_nonthrowing_tcp_listener_t() {
     /* Interrupt the accept loop */
     accept_loop_drainer.reset();
 
+#ifndef _WIN32
+    if (bound && !unix_socket_path.empty()) {
+        if (unlink(unix_socket_path.c_str()) != 0) {
+            logWRN("Could not remove the Unix domain socket `%s`: %s",
+                   unix_socket_path.c_str(), errno_string(get_errno()).c_str());
+        }
+    }
+#endif
+
     // scoped_fd_t destructor will close() the socket
 }
 
@@ -1696,6 +1918,21 @@ linux_tcp_listener_t::linux_tcp_listener_t(
     }
 }
 
+#ifndef _WIN32
+linux_tcp_listener_t::linux_tcp_listener_t(const std::string &unix_socket_path,
+    const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback) :
+        listener(new linux_nonthrowing_tcp_listener_t(unix_socket_path, callback))
+{
+    // Binding first keeps the reason of a failure, which `begin_listening()` drops.
+    const int res = listener->bind_unix_socket();
+    if (res != 0 || !listener->begin_listening()) {
+        throw address_in_use_exc_t(
+            strprintf("Could not listen on the Unix domain socket `%s`: %s",
+                      unix_socket_path.c_str(), errno_string(res).c_str()));
+    }
+}
+#endif
+
 int linux_tcp_listener_t::get_port() const {
     return listener->get_port();
 }
@@ -17,6 +17,7 @@
 #include <ifaddrs.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/uio.h>
 #endif
 
 #include <functional>
@@ -136,6 +137,12 @@ public:
     void write(const void *buf, size_t size, signal_t *closer)
         THROWS_ONLY(tcp_conn_write_closed_exc_t);
 
+    /* write_gathered() is like write(), but writes several buffers in order. Like
+    write(), it sends the data straight from the caller's buffers instead of copying
+    it, and blocks until it's done. */
+    void write_gathered(const std::vector<const_charslice> &buffers, signal_t *closer)
+        THROWS_ONLY(tcp_conn_write_closed_exc_t);
+
     /* write_buffered() is like write(), but it might not send the data until
     flush_buffer*() or write() is called. Internally, it bundles together the
     buffered writes; this may improve performance. */
@@ -268,6 +275,9 @@ private:
 
     static const size_t WRITE_QUEUE_MAX_SIZE = 128 * KILOBYTE;
     static const size_t WRITE_CHUNK_SIZE = 8 * KILOBYTE;
+    /* The write coroutine hands up to this many queued operations to the socket at
+    once. */
+    static const size_t MAX_GATHERED_WRITES = 64;
 
     /* Structs to avoid over-using dynamic allocation */
     struct write_buffer_t : public intrusive_list_node_t<write_buffer_t> {
@@ -345,6 +355,15 @@ private:
     /* Used to actually perform a write. If the write end of the connection is open, then
     writes `size` bytes from `buffer` to the socket. */
     virtual void perform_write(const void *buffer, size_t size);
+
+protected:
+    /* Like `perform_write()`, but writes several buffers in order. Plain sockets do
+    that with a single `writev()` where possible. */
+    virtual void perform_gathered_write(const std::vector<const_charslice> &buffers);
+
+#ifndef _WIN32
+    void perform_writev(iovec *iov, size_t iovcnt);
+#endif
 };
 
 #ifdef ENABLE_TLS
@@ -409,6 +428,10 @@ private:
     writes `size` bytes from `buffer` to the socket. */
     virtual void perform_write(const void *buffer, size_t size);
 
+    /* `SSL_write()` only takes one buffer at a time, so this writes to the socket
+    directly once the kernel encrypts outgoing records (see `--tls-kernel-offload`). */
+    virtual void perform_gathered_write(const std::vector<const_charslice> &buffers);
+
     void shutdown();
     void shutdown_socket();
 
@@ -416,6 +439,9 @@ private:
 
     tls_conn_wrapper_t conn;
 
+    /* Whether the kernel took over encrypting the records that we send. */
+    bool kernel_tls_send;
+
     cond_t closed;
 };
 
@@ -454,6 +480,13 @@ class linux_nonthrowing_tcp_listener_t : private linux_event_callback_t {
 public:
     linux_nonthrowing_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int _port,
         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+#ifndef _WIN32
+    /* Listens on a Unix domain socket at `unix_socket_path` instead. A socket file at
+    that path that nothing accepts connections on anymore is replaced, and the file is
+    removed again when the listener is destroyed. The port is 0. */
+    linux_nonthrowing_tcp_listener_t(const std::string &unix_socket_path,
+        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+#endif
 
     ~linux_nonthrowing_tcp_listener_t();
 
@@ -473,6 +506,10 @@ protected:
 private:
     static const uint32_t MAX_BIND_ATTEMPTS = 20;
     int init_sockets();
+#ifndef _WIN32
+    // Returns 0 or the `errno` of the failure
+    int bind_unix_socket();
+#endif
 
     /* accept_loop() runs in a separate coroutine. It repeatedly tries to accept
     new connections; when accept() blocks, then it waits for events from the
@@ -499,6 +536,9 @@ private:
     // The port we're asked to bind to
     int port;
 
+    // Not empty if we listen on a Unix domain socket rather than on `local_addresses`
+    std::string unix_socket_path;
+
     // Inidicates successful binding to a port
     bool bound;
 
@@ -532,6 +572,10 @@ public:
         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
     linux_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int port,
         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+#ifndef _WIN32
+    linux_tcp_listener_t(const std::string &unix_socket_path,
+        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+#endif
 
     int get_port() const;
 
@@ -0,0 +1,339 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/io/striped_file.hpp"
+
+#include <sys/uio.h>
+
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "containers/scoped.hpp"
+#include "math.hpp"
+
+// The accounts of a `striped_file_t`, one for each of its files.
+struct striped_file_account_t {
+    std::vector<scoped_ptr_t<file_account_t> > accounts;
+};
+
+/* Calls `cb` once `piece_done()` has been called `pieces` times, and deletes itself.
+If any of the pieces failed, it reports the first failure, for the whole range of the
+operation. */
+class striped_file_op_t : public linux_iocallback_t {
+public:
+    striped_file_op_t(linux_iocallback_t *_cb, size_t pieces,
+                      int64_t _offset, size_t _length)
+        : cb(_cb), remaining(pieces), offset(_offset), length(_length), errsv(0) { }
+
+    void on_io_complete() {
+        piece_done();
+    }
+
+    void on_io_failure(int _errsv, int64_t, int64_t) {
+        if (errsv == 0) {
+            errsv = _errsv;
+        }
+        piece_done();
+    }
+
+    void piece_done() {
+        guarantee(remaining > 0);
+        --remaining;
+        if (remaining > 0) {
+            return;
+        }
+        linux_iocallback_t *local_cb = cb;
+        const int local_errsv = errsv;
+        const int64_t local_offset = offset;
+        const size_t local_length = length;
+        delete this;
+        if (local_errsv == 0) {
+            local_cb->on_io_complete();
+        } else {
+            local_cb->on_io_failure(local_errsv, local_offset, local_length);
+        }
+    }
+
+private:
+    linux_iocallback_t *cb;
+    // The callers pass one more than the number of pieces, and call `piece_done()`
+    // once they've submitted all of them, so that `cb` can't run before that.
+    size_t remaining;
+    int64_t offset;
+    size_t length;
+    int errsv;
+};
+
+/* Waits for the files a synchronous write doesn't touch to be sync'ed before writing
+the pieces, so that the write can't reach the disk before the writes that went to the
+other files earlier.  (The metablock manager relies on that.) */
+class striped_file_barrier_t : public linux_iocallback_t {
+public:
+    striped_file_barrier_t(striped_file_t *_file,
+                           std::vector<striped_file_t::piece_t> &&_pieces,
+                           int64_t _offset, size_t _length, const void *_buf,
+                           file_account_t *_account, linux_iocallback_t *_cb,
+                           size_t _remaining)
+        : file(_file), pieces(std::move(_pieces)), offset(_offset), length(_length),
+          buf(_buf), account(_account), cb(_cb), remaining(_remaining) { }
+
+    void on_io_complete() {
+        guarantee(remaining > 0);
+        --remaining;
+        if (remaining > 0) {
+            return;
+        }
+        file->write_pieces(pieces, offset, length, buf, account, cb,
+                           file_t::WRAP_IN_DATASYNCS);
+        delete this;
+    }
+
+    void on_io_failure(int errsv, int64_t, int64_t) {
+        crash("Failed to sync a stripe file before a synchronous write (%s).",
+              errno_string(errsv).c_str());
+    }
+
+private:
+    striped_file_t *file;
+    std::vector<striped_file_t::piece_t> pieces;
+    int64_t offset;
+    size_t length;
+    const void *buf;
+    file_account_t *account;
+    linux_iocallback_t *cb;
+    size_t remaining;
+};
+
+striped_file_t::striped_file_t(std::vector<scoped_ptr_t<file_t> > &&_files,
+                               int64_t _unit_size)
+    : unit_size(_unit_size), files(std::move(_files)), file_size(0) {
+    guarantee(!files.empty());
+    guarantee(unit_size > 0 && divides(DEVICE_BLOCK_SIZE, unit_size));
+    for (size_t i = 0; i < files.size(); ++i) {
+        file_size = std::max(file_size,
+                             logical_size(files[i]->get_file_size(), i, files.size(),
+                                          unit_size));
+    }
+}
+
+striped_file_t::~striped_file_t() { }
+
+int64_t striped_file_t::physical_size(int64_t logical_size, size_t index,
+                                      size_t num_files, int64_t unit_size) {
+    const int64_t units = logical_size / unit_size;
+    const int64_t rest = logical_size % unit_size;
+    const int64_t n = num_files;
+    const int64_t i = index;
+    int64_t size = (units / n + (i < units % n ? 1 : 0)) * unit_size;
+    if (units % n == i) {
+        size += rest;
+    }
+    return size;
+}
+
+int64_t striped_file_t::logical_size(int64_t physical_size, size_t index,
+                                     size_t num_files, int64_t unit_size) {
+    const int64_t full_units = physical_size / unit_size;
+    const int64_t rest = physical_size % unit_size;
+    const int64_t n = num_files;
+    const int64_t i = index;
+    if (rest > 0) {
+        return (full_units * n + i) * unit_size + rest;
+    } else if (full_units > 0) {
+        return ((full_units - 1) * n + i + 1) * unit_size;
+    } else {
+        return 0;
+    }
+}
+
+std::vector<striped_file_t::piece_t> striped_file_t::split(int64_t offset,
+                                                          size_t length) const {
+    std::vector<piece_t> pieces;
+    size_t start = 0;
+    while (start < length) {
+        const int64_t logical = offset + start;
+        const int64_t unit = logical / unit_size;
+        const int64_t within = logical % unit_size;
+        piece_t piece;
+        piece.file = unit % files.size();
+        piece.physical_offset = (unit / files.size()) * unit_size + within;
+        piece.start = start;
+        piece.length = std::min<size_t>(length - start, unit_size - within);
+        pieces.push_back(piece);
+        start += piece.length;
+    }
+    return pieces;
+}
+
+file_account_t *striped_file_t::file_account(file_account_t *account, size_t index) {
+    if (account == DEFAULT_DISK_ACCOUNT) {
+        return DEFAULT_DISK_ACCOUNT;
+    }
+    return static_cast<striped_file_account_t *>(account->get_account())
+        ->accounts[index].get();
+}
+
+int64_t striped_file_t::get_file_size() {
+    return file_size;
+}
+
+void striped_file_t::set_file_size(int64_t size) {
+    for (size_t i = 0; i < files.size(); ++i) {
+        files[i]->set_file_size(physical_size(size, i, files.size(), unit_size));
+    }
+    file_size = size;
+}
+
+void striped_file_t::set_file_size_at_least(int64_t size, int64_t extent_size) {
+    if (file_size < size) {
+        // Growing the logical file in chunks keeps the files' sizes consistent with
+        // each other, which `logical_size()` relies on.
+        set_file_size(ceil_aligned(size, chunk_factor(size, extent_size)));
+    }
+}
+
+void striped_file_t::read_async(int64_t offset, size_t length, void *buf,
+                                file_account_t *account, linux_iocallback_t *cb) {
+    rassert(offset + static_cast<int64_t>(length) <= file_size);
+    const std::vector<piece_t> pieces = split(offset, length);
+    striped_file_op_t *op = new striped_file_op_t(cb, pieces.size() + 1, offset, length);
+    for (const piece_t &piece : pieces) {
+        files[piece.file]->read_async(piece.physical_offset, piece.length,
+                                      static_cast<char *>(buf) + piece.start,
+                                      file_account(account, piece.file), op);
+    }
+    op->piece_done();
+}
+
+void striped_file_t::write_async(int64_t offset, size_t length, const void *buf,
+                                 file_account_t *account, linux_iocallback_t *cb,
+                                 wrap_in_datasyncs_t wrap_in_datasyncs) {
+    rassert(offset + static_cast<int64_t>(length) <= file_size);
+    std::vector<piece_t> pieces = split(offset, length);
+    if (wrap_in_datasyncs == NO_DATASYNCS || files.size() == 1) {
+        write_pieces(pieces, offset, length, buf, account, cb, wrap_in_datasyncs);
+        return;
+    }
+
+    // The files that the pieces go to sync themselves before the write anyway.
+    std::vector<bool> touched(files.size(), false);
+    for (const piece_t &piece : pieces) {
+        touched[piece.file] = true;
+    }
+    size_t barriers = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!touched[i]) {
+            ++barriers;
+        }
+    }
+    if (barriers == 0) {
+        write_pieces(pieces, offset, length, buf, account, cb, wrap_in_datasyncs);
+        return;
+    }
+    // An empty write that's wrapped in datasyncs is just a datasync.
+    striped_file_barrier_t *barrier = new striped_file_barrier_t(
+        this, std::move(pieces), offset, length, buf, account, cb, barriers);
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!touched[i]) {
+            files[i]->write_async(0, 0, buf, file_account(account, i), barrier,
+                                  WRAP_IN_DATASYNCS);
+        }
+    }
+}
+
+void striped_file_t::write_pieces(const std::vector<piece_t> &pieces,
+                                  int64_t offset, size_t length, const void *buf,
+                                  file_account_t *account, linux_iocallback_t *cb,
+                                  wrap_in_datasyncs_t wrap_in_datasyncs) {
+    striped_file_op_t *op = new striped_file_op_t(cb, pieces.size() + 1, offset, length);
+    for (const piece_t &piece : pieces) {
+        files[piece.file]->write_async(piece.physical_offset, piece.length,
+                                       static_cast<const char *>(buf) + piece.start,
+                                       file_account(account, piece.file), op,
+                                       wrap_in_datasyncs);
+    }
+    op->piece_done();
+}
+
+void striped_file_t::writev_async(int64_t offset, size_t length,
+                                  scoped_array_t<iovec> &&bufs,
+                                  file_account_t *account, linux_iocallback_t *cb) {
+    rassert(offset + static_cast<int64_t>(length) <= file_size);
+    const std::vector<piece_t> pieces = split(offset, length);
+    if (pieces.size() == 1) {
+        files[pieces[0].file]->writev_async(pieces[0].physical_offset, length,
+                                            std::move(bufs),
+                                            file_account(account, pieces[0].file), cb);
+        return;
+    }
+
+    striped_file_op_t *op = new striped_file_op_t(cb, pieces.size() + 1, offset, length);
+    // Where the current piece starts in `bufs`
+    size_t vec = 0;
+    size_t vec_offset = 0;
+    for (const piece_t &piece : pieces) {
+        std::vector<iovec> slice;
+        size_t left = piece.length;
+        while (left > 0) {
+            guarantee(vec < bufs.size());
+            iovec part;
+            part.iov_base = static_cast<char *>(bufs[vec].iov_base) + vec_offset;
+            part.iov_len = std::min(left, bufs[vec].iov_len - vec_offset);
+            slice.push_back(part);
+            left -= part.iov_len;
+            vec_offset += part.iov_len;
+            if (vec_offset == bufs[vec].iov_len) {
+                ++vec;
+                vec_offset = 0;
+            }
+        }
+        scoped_array_t<iovec> piece_bufs(slice.size());
+        std::copy(slice.begin(), slice.end(), piece_bufs.data());
+        files[piece.file]->writev_async(piece.physical_offset, piece.length,
+                                        std::move(piece_bufs),
+                                        file_account(account, piece.file), op);
+    }
+    op->piece_done();
+}
+
+bool striped_file_t::read_mapped(int64_t offset, size_t length, void *buf) {
+    if (offset + static_cast<int64_t>(length) > file_size) {
+        return false;
+    }
+    for (const piece_t &piece : split(offset, length)) {
+        if (!files[piece.file]->read_mapped(piece.physical_offset, piece.length,
+                                            static_cast<char *>(buf) + piece.start)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void *striped_file_t::create_account(int priority, int outstanding_requests_limit,
+                                     const char *io_class) {
+    striped_file_account_t *account = new striped_file_account_t;
+    account->accounts.resize(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        account->accounts[i].init(new file_account_t(files[i].get(), priority, io_class,
+                                                     outstanding_requests_limit));
+    }
+    return account;
+}
+
+void striped_file_t::destroy_account(void *account) {
+    delete static_cast<striped_file_account_t *>(account);
+}
+
+void striped_file_t::set_io_latency_stats(perfmon_keyed_latency_t *queue_latency,
+                                          perfmon_keyed_latency_t *service_latency) {
+    for (const auto &file : files) {
+        file->set_io_latency_stats(queue_latency, service_latency);
+    }
+}
+
+bool striped_file_t::coop_lock_and_check() {
+    for (const auto &file : files) {
+        if (!file->coop_lock_and_check()) {
+            return false;
+        }
+    }
+    return true;
+}
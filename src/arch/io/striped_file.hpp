@@ -0,0 +1,82 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_STRIPED_FILE_HPP_
+#define ARCH_IO_STRIPED_FILE_HPP_
+
+#include <vector>
+
+#include "arch/types.hpp"
+#include "containers/scoped.hpp"
+
+/* `striped_file_t` makes several files, usually on different devices, look like a
+single file.  The logical file is cut into units of `unit_size` bytes, and unit `k`
+lives in file `k % n`, at offset `(k / n) * unit_size`, where `n` is the number of
+files.  Operations that cross unit boundaries are split up, and their callback is
+called once all the pieces are done.  Since every file has its own disk manager, each
+device gets its own I/O queue.
+
+The logical size isn't stored anywhere, but it's derived from the sizes of the files
+when they're opened, so the files must always be resized together through this
+class. */
+class striped_file_t : public file_t {
+public:
+    // `unit_size` must be a multiple of `DEVICE_BLOCK_SIZE`.
+    striped_file_t(std::vector<scoped_ptr_t<file_t> > &&files, int64_t unit_size);
+    ~striped_file_t();
+
+    int64_t get_file_size();
+    void set_file_size(int64_t size);
+    void set_file_size_at_least(int64_t size, int64_t extent_size);
+
+    void read_async(int64_t offset, size_t length, void *buf, file_account_t *account,
+                    linux_iocallback_t *cb);
+    void write_async(int64_t offset, size_t length, const void *buf,
+                     file_account_t *account, linux_iocallback_t *cb,
+                     wrap_in_datasyncs_t wrap_in_datasyncs);
+    void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
+                      file_account_t *account, linux_iocallback_t *cb);
+
+    bool read_mapped(int64_t offset, size_t length, void *buf);
+
+    void *create_account(int priority, int outstanding_requests_limit,
+                         const char *io_class);
+    void destroy_account(void *account);
+
+    void set_io_latency_stats(perfmon_keyed_latency_t *queue_latency,
+                              perfmon_keyed_latency_t *service_latency);
+
+    bool coop_lock_and_check();
+
+    // How large file `index` of `num_files` has to be for a logical size of
+    // `logical_size`.
+    static int64_t physical_size(int64_t logical_size, size_t index, size_t num_files,
+                                 int64_t unit_size);
+    // The smallest logical size that needs file `index` to be `physical_size` large.
+    static int64_t logical_size(int64_t physical_size, size_t index, size_t num_files,
+                                int64_t unit_size);
+
+private:
+    friend class striped_file_barrier_t;
+
+    struct piece_t {
+        size_t file;
+        int64_t physical_offset;
+        // Relative to the start of the whole operation
+        size_t start;
+        size_t length;
+    };
+    std::vector<piece_t> split(int64_t offset, size_t length) const;
+    file_account_t *file_account(file_account_t *account, size_t index);
+
+    void write_pieces(const std::vector<piece_t> &pieces,
+                      int64_t offset, size_t length, const void *buf,
+                      file_account_t *account, linux_iocallback_t *cb,
+                      wrap_in_datasyncs_t wrap_in_datasyncs);
+
+    const int64_t unit_size;
+    std::vector<scoped_ptr_t<file_t> > files;
+    int64_t file_size;
+
+    DISABLE_COPYING(striped_file_t);
+};
+
+#endif  // ARCH_IO_STRIPED_FILE_HPP_
@@ -358,6 +358,28 @@ void artificial_stack_t::disable_overflow_protection() {
 #endif
 }
 
+void artificial_stack_t::release_unused_pages() {
+    rassert(!context.is_nil());
+    rassert(address_in_stack(context.pointer));
+    /* Leave the protection page alone, and don't touch the page that the saved
+    stack pointer is on. */
+    char *begin = stack.get() + getpagesize();
+    char *end = reinterpret_cast<char *>(
+        floor_aligned(reinterpret_cast<uintptr_t>(context.pointer), getpagesize()));
+    if (end <= begin) {
+        return;
+    }
+    /* `MADV_FREE` lets the kernel take the pages lazily, whenever it is short on
+    memory, which is cheaper than `MADV_DONTNEED` if the stack grows again soon.
+    Older Linux kernels don't support it. */
+#ifdef MADV_FREE
+    if (madvise(begin, end - begin, MADV_FREE) == 0) {
+        return;
+    }
+#endif
+    madvise(begin, end - begin, MADV_DONTNEED);
+}
+
 bool artificial_stack_t::address_in_stack(const void *addr) const {
     return reinterpret_cast<uintptr_t>(addr) >=
             reinterpret_cast<uintptr_t>(get_stack_bound())
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <functional>
 #ifndef NDEBUG
 #include <map>
@@ -19,6 +20,7 @@
 #include "debug.hpp"
 #include "do_on_thread.hpp"
 #include "logger.hpp"
+#include "perfmon/memory_accounting.hpp"
 #include "perfmon/perfmon.hpp"
 #include "rethinkdb_backtrace.hpp"
 #include "thread_local.hpp"
@@ -28,9 +30,14 @@
 size_t coro_stack_size = COROUTINE_STACK_SIZE;
 
 // How many unused coroutine stacks to keep around (at most), before they are
-// freed. This value is per thread.
+// freed. This value is per thread and stack class.
 const size_t COROUTINE_FREE_LIST_SIZE = 64;
 
+// How many of those are kept ready for reuse. The stacks of the others get their pages
+// released to the operating system, so that a burst of coroutines doesn't leave
+// behind a lot of resident memory.
+const size_t COROUTINE_HOT_FREE_LIST_SIZE = 8;
+
 // In debug mode, we print a warning if more than this many coroutines have been
 // allocated on one thread.
 #ifndef NDEBUG
@@ -68,8 +75,11 @@ struct coro_globals_t {
     /* The previous context. */
     coro_t *prev_coro;
 
-    /* A list of coro_t objects that are not in use. */
-    intrusive_list_t<coro_t> free_coros;
+    /* Lists of coro_t objects that are not in use, for each stack class. The most
+    recently used ones are at the back. The stacks of the coroutines in
+    `cold_free_coros` have had their pages released. */
+    intrusive_list_t<coro_t> free_coros[NUM_CORO_STACK_CLASSES];
+    intrusive_list_t<coro_t> cold_free_coros[NUM_CORO_STACK_CLASSES];
 
     /* A list of coroutines that currently have protected stacks. The least recently
     used protected coroutine is always at the front of the list. */
@@ -120,9 +130,15 @@ struct coro_globals_t {
         rassert(!current_coro);
 
         /* Destroy remaining coroutines */
-        while (coro_t *s = free_coros.head()) {
-            free_coros.remove(s);
-            delete s;
+        for (size_t i = 0; i < NUM_CORO_STACK_CLASSES; ++i) {
+            while (coro_t *s = free_coros[i].head()) {
+                free_coros[i].remove(s);
+                delete s;
+            }
+            while (coro_t *s = cold_free_coros[i].head()) {
+                cold_free_coros[i].remove(s);
+                delete s;
+            }
         }
     }
 
@@ -133,10 +149,24 @@ TLS_with_init(coro_globals_t *, cglobals, nullptr);
 // These must be initialized after TLS_cglobals, because perfmon_multi_membership_t
 // construction depends on coro_t::coroutines_have_been_initialized() which in turn
 // depends on cglobals.
-static perfmon_counter_t pm_active_coroutines, pm_allocated_coroutines;
+static perfmon_counter_t pm_active_coroutines, pm_allocated_coroutines,
+    pm_coroutine_stack_bytes, pm_released_coroutine_stacks;
+// How many times coroutines were resumed on each thread, and for how long they ran in
+// total.  Together they give the average time a coroutine runs before it yields.
+static perfmon_thread_counter_t pm_coroutine_resumes, pm_coroutine_run_nsecs;
 static perfmon_multi_membership_t pm_coroutines_membership(&get_global_perfmon_collection(),
     &pm_active_coroutines, "active_coroutines",
-    &pm_allocated_coroutines, "allocated_coroutines");
+    &pm_allocated_coroutines, "allocated_coroutines",
+    &pm_coroutine_stack_bytes, "coroutine_stack_bytes",
+    &pm_released_coroutine_stacks, "released_coroutine_stacks",
+    &pm_coroutine_resumes, "coroutine_resumes",
+    &pm_coroutine_run_nsecs, "coroutine_run_nsecs");
+
+// Records that a coroutine ran for `ticks` since it was last resumed.
+static void record_coroutine_run(ticks_t ticks) {
+    ++pm_coroutine_resumes;
+    pm_coroutine_run_nsecs += ticks;
+}
 
 coro_runtime_t::coro_runtime_t() {
     rassert(!TLS_get_cglobals(), "coro runtime initialized twice on this thread");
@@ -162,11 +192,15 @@ void coro_runtime_t::get_coroutine_counts(std::map<std::string, size_t> *dest) {
 TLS_with_init(int64_t, coro_selfname_counter, 0);
 #endif
 
-coro_t::coro_t() :
-    stack(&coro_t::run, coro_stack_size),
+coro_t::coro_t(coro_stack_class_t _stack_class) :
+    stack_class_(_stack_class),
+    stack_size_(stack_size_for_class(_stack_class)),
+    stack(&coro_t::run, stack_size_),
     current_thread_(linux_thread_pool_t::get_thread_id()),
     notified_(false),
     waiting_(false),
+    running_ticks_(0),
+    resumed_at_(0),
     protected_stack_lru_entry_(this)
 #ifndef NDEBUG
     , selfname_number(get_thread_id().threadnum + MAX_THREADS *
@@ -180,6 +214,8 @@ coro_t::coro_t() :
 #endif
 {
     ++pm_allocated_coroutines;
+    pm_coroutine_stack_bytes += stack_size_;
+    account_memory(memory_category_t::coroutine_stacks, stack_size_);
 
 #ifndef NDEBUG
     TLS_get_cglobals()->coro_count++;
@@ -198,14 +234,30 @@ void coro_t::return_coro_to_free_list(coro_t *coro) {
     // by checking the free list size *before* we push `coro` onto it.
     // This is important because when we call `return_coro_to_free_list` in
     // `coro_t::run`, that coroutine is still active and must not be deleted yet.
-    static_assert(COROUTINE_FREE_LIST_SIZE > 0, "COROUTINE_FREE_LIST_SIZE cannot be 0");
-    if (cglobals->free_coros.size() >= COROUTINE_FREE_LIST_SIZE) {
-        coro_t *coro_to_delete = cglobals->free_coros.tail();
-        cglobals->free_coros.remove(coro_to_delete);
-        delete coro_to_delete;
+    // The same goes for releasing its stack pages, which is why we only ever release
+    // the stacks of coroutines that were already on the free list.
+    static_assert(COROUTINE_HOT_FREE_LIST_SIZE > 0,
+                  "COROUTINE_HOT_FREE_LIST_SIZE cannot be 0");
+    static_assert(COROUTINE_HOT_FREE_LIST_SIZE < COROUTINE_FREE_LIST_SIZE,
+                  "COROUTINE_HOT_FREE_LIST_SIZE must be below COROUTINE_FREE_LIST_SIZE");
+    const size_t stack_class = static_cast<size_t>(coro->stack_class_);
+    intrusive_list_t<coro_t> *hot = &cglobals->free_coros[stack_class];
+    intrusive_list_t<coro_t> *cold = &cglobals->cold_free_coros[stack_class];
+    if (hot->size() >= COROUTINE_HOT_FREE_LIST_SIZE) {
+        if (cold->size() >= COROUTINE_FREE_LIST_SIZE - COROUTINE_HOT_FREE_LIST_SIZE) {
+            coro_t *coro_to_delete = cold->head();
+            cold->remove(coro_to_delete);
+            --pm_released_coroutine_stacks;
+            delete coro_to_delete;
+        }
+        coro_t *coro_to_release = hot->head();
+        hot->remove(coro_to_release);
+        coro_to_release->stack.release_unused_pages();
+        ++pm_released_coroutine_stacks;
+        cold->push_back(coro_to_release);
     }
-    rassert(cglobals->free_coros.size() < COROUTINE_FREE_LIST_SIZE);
-    cglobals->free_coros.push_back(coro);
+    rassert(hot->size() < COROUTINE_HOT_FREE_LIST_SIZE);
+    hot->push_back(coro);
 }
 
 coro_t::~coro_t() {
@@ -216,6 +268,9 @@ coro_t::~coro_t() {
     TLS_get_cglobals()->coro_count--;
 #endif
     --pm_allocated_coroutines;
+    pm_coroutine_stack_bytes -= stack_size_;
+    account_memory(memory_category_t::coroutine_stacks,
+                   -static_cast<int64_t>(stack_size_));
 }
 
 /* Helper function for switching into a new context and making sure that the new context
@@ -266,6 +321,7 @@ void coro_t::run() {
         rassert(coro->notified_ == false);
         rassert(coro->waiting_ == true);
         coro->waiting_ = false;
+        coro->resumed_at_ = get_ticks();
 
 #ifndef NDEBUG
         // Keep track of how many coroutines of each type ran
@@ -276,6 +332,7 @@ void coro_t::run() {
         PROFILER_CORO_RESUME;
         coro->action_wrapper.run();
         PROFILER_CORO_YIELD(0);
+        record_coroutine_run(get_ticks() - coro->resumed_at_);
 #ifndef NDEBUG
         TLS_get_cglobals()->running_coroutine_counts[coro->coroutine_type]--;
         TLS_get_cglobals()->active_coroutines.erase(coro);
@@ -340,6 +397,12 @@ void coro_t::parse_coroutine_type(const char *coroutine_function)
 }
 #endif
 
+ticks_t coro_t::get_running_ticks() const {
+    return this == self()
+        ? running_ticks_ + (get_ticks() - resumed_at_)
+        : running_ticks_;
+}
+
 coro_t *coro_t::self() {   /* class method */
     // Make a local copy because TLS_get_cglobals() can't be inlined, and we don't
     // want to call it twice.
@@ -359,6 +422,9 @@ void coro_t::wait() {   /* class method */
 
     rassert(!self()->waiting_);
     self()->waiting_ = true;
+    const ticks_t ran_for = get_ticks() - self()->resumed_at_;
+    self()->running_ticks_ += ran_for;
+    record_coroutine_run(ran_for);
 
     PROFILER_CORO_YIELD(1);
     if (TLS_get_cglobals()->prev_coro) {
@@ -372,6 +438,7 @@ void coro_t::wait() {   /* class method */
     rassert(self());
     rassert(self()->waiting_);
     self()->waiting_ = false;
+    self()->resumed_at_ = get_ticks();
 }
 
 void coro_t::yield() {  /* class method */
@@ -514,15 +581,34 @@ bool coroutines_have_been_initialized() {
     return TLS_get_cglobals() != nullptr;
 }
 
-coro_t * coro_t::get_coro() {
+size_t coro_t::stack_size_for_class(coro_stack_class_t stack_class) {
+    switch (stack_class) {
+    case coro_stack_class_t::DEFAULT:
+        return coro_stack_size;
+    case coro_stack_class_t::SMALL:
+        return std::min<size_t>(COROUTINE_SMALL_STACK_SIZE, coro_stack_size);
+    default:
+        unreachable();
+    }
+}
+
+coro_t * coro_t::get_coro(coro_stack_class_t stack_class) {
     rassert(coroutines_have_been_initialized());
     coro_t *coro;
 
-    if (TLS_get_cglobals()->free_coros.size() == 0) {
-        coro = new coro_t();
+    intrusive_list_t<coro_t> *hot =
+        &TLS_get_cglobals()->free_coros[static_cast<size_t>(stack_class)];
+    intrusive_list_t<coro_t> *cold =
+        &TLS_get_cglobals()->cold_free_coros[static_cast<size_t>(stack_class)];
+    if (!hot->empty()) {
+        coro = hot->tail();
+        hot->remove(coro);
+    } else if (!cold->empty()) {
+        coro = cold->tail();
+        cold->remove(coro);
+        --pm_released_coroutine_stacks;
     } else {
-        coro = TLS_get_cglobals()->free_coros.tail();
-        TLS_get_cglobals()->free_coros.remove(coro);
+        coro = new coro_t(stack_class);
     }
 
     rassert(!coro->intrusive_list_node_t<coro_t>::in_a_list());
@@ -36,6 +36,15 @@ struct coro_profiler_mixin_t {
 #endif
 };
 
+/* Coroutines that are known to stay shallow, and that there can be a lot of at the
+same time, can be spawned with a small stack. The two classes have separate free
+lists. */
+enum class coro_stack_class_t {
+    DEFAULT = 0,
+    SMALL = 1
+};
+const size_t NUM_CORO_STACK_CLASSES = 2;
+
 /* The `coro_lru_entry_t` is used to keep track of coroutines that have protected
 stacks and to eventually unprotect them using a least-recently-used strategy. */
 struct coro_lru_entry_t : public intrusive_list_node_t<coro_lru_entry_t> {
@@ -58,14 +67,18 @@ public:
     friend bool has_n_bytes_free_stack_space(size_t);
 
     template<class callable_t>
-    static void spawn_now_dangerously(callable_t &&action) {
-        coro_t *coro = get_and_init_coro(std::forward<callable_t>(action));
+    static void spawn_now_dangerously(
+            callable_t &&action,
+            coro_stack_class_t stack_class = coro_stack_class_t::DEFAULT) {
+        coro_t *coro = get_and_init_coro(std::forward<callable_t>(action), stack_class);
         coro->notify_now_deprecated();
     }
 
     template<class callable_t>
-    static coro_t *spawn_sometime(callable_t &&action) {
-        coro_t *coro = get_and_init_coro(std::forward<callable_t>(action));
+    static coro_t *spawn_sometime(
+            callable_t &&action,
+            coro_stack_class_t stack_class = coro_stack_class_t::DEFAULT) {
+        coro_t *coro = get_and_init_coro(std::forward<callable_t>(action), stack_class);
         coro->notify_sometime();
         return coro;
     }
@@ -150,6 +163,11 @@ public:
 
     static void set_coroutine_stack_size(size_t size);
 
+    /* How long this coroutine has been running for over its lifetime, as opposed to
+    waiting. Coroutines get reused, so only differences between two calls are
+    meaningful. */
+    ticks_t get_running_ticks() const;
+
     coro_stack_t *get_stack();
 
     void set_priority(int _priority) {
@@ -174,7 +192,7 @@ private:
 
     // Constructor sets up the stack, get_and_init_coro will load a function to be run
     //  at which point the coroutine can be notified
-    coro_t();
+    explicit coro_t(coro_stack_class_t _stack_class);
 
     // Generates a spawn-time backtrace and stores it into `spawn_backtrace`.
     void grab_spawn_backtrace();
@@ -185,8 +203,10 @@ private:
 
     // If this function footprint ever changes, you may need to update the parse_coroutine_info function
     template<class callable_t>
-    static coro_t *get_and_init_coro(callable_t &&action) {
-        coro_t *coro = get_coro();
+    static coro_t *get_and_init_coro(
+            callable_t &&action,
+            coro_stack_class_t stack_class = coro_stack_class_t::DEFAULT) {
+        coro_t *coro = get_coro(stack_class);
 #ifndef NDEBUG
         coro->parse_coroutine_type(CURRENT_FUNCTION_PRETTY);
 #endif
@@ -205,7 +225,9 @@ private:
         return coro;
     }
 
-    static coro_t *get_coro();
+    static coro_t *get_coro(coro_stack_class_t stack_class);
+
+    static size_t stack_size_for_class(coro_stack_class_t stack_class);
 
     static void return_coro_to_free_list(coro_t *coro);
 
@@ -217,6 +239,8 @@ private:
 
     virtual void on_thread_switch();
 
+    const coro_stack_class_t stack_class_;
+    const size_t stack_size_;
     coro_stack_t stack;
 
     threadnum_t current_thread_;
@@ -225,6 +249,10 @@ private:
     bool notified_;
     bool waiting_;
 
+    // For `get_running_ticks()`.
+    ticks_t running_ticks_;
+    ticks_t resumed_at_;
+
     callable_action_wrapper_t action_wrapper;
 
     /* Used to eventually unprotect the coroutine if it has been inactive for a while. */
@@ -15,6 +15,35 @@ perfmon_duration_sampler_t *pm_eventloop_singleton_t::get() {
     return &pm_eventloop;
 }
 
+perfmon_thread_counter_t *pm_eventloop_idle_singleton_t::spin_usecs() {
+    static perfmon_thread_counter_t pm_spin_usecs;
+    static perfmon_membership_t pm_spin_usecs_membership(
+        &get_global_perfmon_collection(), &pm_spin_usecs, "eventloop_spin_usecs");
+    return &pm_spin_usecs;
+}
+
+perfmon_thread_counter_t *pm_eventloop_idle_singleton_t::sleep_usecs() {
+    static perfmon_thread_counter_t pm_sleep_usecs;
+    static perfmon_membership_t pm_sleep_usecs_membership(
+        &get_global_perfmon_collection(), &pm_sleep_usecs, "eventloop_sleep_usecs");
+    return &pm_sleep_usecs;
+}
+
+perfmon_thread_counter_t *pm_eventloop_load_singleton_t::busy_usecs() {
+    static perfmon_thread_counter_t pm_busy_usecs;
+    static perfmon_membership_t pm_busy_usecs_membership(
+        &get_global_perfmon_collection(), &pm_busy_usecs, "eventloop_busy_usecs");
+    return &pm_busy_usecs;
+}
+
+perfmon_thread_counter_t *pm_eventloop_load_singleton_t::message_queue_depth() {
+    static perfmon_thread_counter_t pm_message_queue_depth;
+    static perfmon_membership_t pm_message_queue_depth_membership(
+        &get_global_perfmon_collection(), &pm_message_queue_depth,
+        "message_queue_depth");
+    return &pm_message_queue_depth;
+}
+
 std::string format_poll_event(int event) {
     std::string s;
     if (event & poll_event_in) {
@@ -21,6 +21,21 @@ struct pm_eventloop_singleton_t {
     static perfmon_duration_sampler_t *get();
 };
 
+// How many microseconds each thread's event loop spent busy-polling for events, and
+// how many it spent blocked in the kernel waiting for them.
+struct pm_eventloop_idle_singleton_t {
+    static perfmon_thread_counter_t *spin_usecs();
+    static perfmon_thread_counter_t *sleep_usecs();
+};
+
+// How many microseconds each thread's event loop spent handling events and messages,
+// and how many messages (including notified coroutines) were waiting for each
+// thread's message hub the last time it looked.
+struct pm_eventloop_load_singleton_t {
+    static perfmon_thread_counter_t *busy_usecs();
+    static perfmon_thread_counter_t *message_queue_depth();
+};
+
 /* Pick the queue now*/
 
 #if defined(_WIN32)
@@ -18,6 +18,7 @@
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "perfmon/perfmon.hpp"
+#include "time.hpp"
 
 int user_to_epoll(int mode) {
 
@@ -45,21 +46,65 @@ int epoll_to_user(int mode) {
     return out_mode;
 }
 
+// The adaptive spin time never drops below this fraction of the spin budget.
+const int64_t MIN_SPIN_FRACTION = 16;
+
 epoll_event_queue_t::epoll_event_queue_t(linux_queue_parent_t *_parent)
-    : parent(_parent), nevents(0) {
+    : parent(_parent), spin_usecs(-1), nevents(0) {
     // Create a poll fd
 
     epoll_fd = epoll_create1(0);
     guarantee_err(epoll_fd >= 0, "Could not create epoll fd");
 }
 
+int epoll_event_queue_t::wait_for_events() {
+    parent->set_idle(true);
+    const int64_t budget = parent->spin_budget_usecs();
+    if (budget > 0) {
+        if (spin_usecs == -1) {
+            spin_usecs = budget;
+        }
+        const ticks_t start = get_ticks();
+        const ticks_t deadline = start + spin_usecs * THOUSAND;
+        parent->set_spinning(true);
+        int res;
+        bool found_work = false;
+        do {
+            res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, 0);
+            found_work = res != 0 || parent->poll_spin();
+        } while (!found_work && get_ticks() < deadline);
+        parent->set_spinning(false);
+        // Other threads might have stopped waking us up just before we stopped
+        // spinning, so we have to look for their messages one more time.
+        found_work = found_work || parent->poll_spin();
+        const ticks_t end = get_ticks();
+        *pm_eventloop_idle_singleton_t::spin_usecs() += (end - start) / THOUSAND;
+
+        if (found_work) {
+            spin_usecs = budget;
+            parent->set_idle(false);
+            return res;
+        }
+        spin_usecs = std::max(spin_usecs / 2, budget / MIN_SPIN_FRACTION);
+    }
+
+    const ticks_t start = get_ticks();
+    const int res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+    *pm_eventloop_idle_singleton_t::sleep_usecs() += (get_ticks() - start) / THOUSAND;
+    parent->set_idle(false);
+    return res;
+}
+
 void epoll_event_queue_t::run() {
     int res;
+    // Busy time that doesn't add up to a whole microsecond yet.
+    ticks_t busy_remainder = 0;
 
     // Now, start the loop
     while (!parent->should_shut_down()) {
         // Grab the events from the kernel!
-        res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+        res = wait_for_events();
+        const ticks_t busy_start = get_ticks();
 
         // epoll_wait might return with EINTR in some cases (in
         // particular under GDB), we just need to retry.
@@ -119,6 +164,10 @@ void epoll_event_queue_t::run() {
         nevents = 0;
 
         parent->pump();
+
+        busy_remainder += get_ticks() - busy_start;
+        *pm_eventloop_load_singleton_t::busy_usecs() += busy_remainder / THOUSAND;
+        busy_remainder %= THOUSAND;
     }
 }
 
@@ -30,8 +30,16 @@ public:
     void forget_event(system_event_t *, linux_event_callback_t *cb);
 
 private:
+    // Waits for events, spinning first if the parent wants us to.  Returns the
+    // result of the last `epoll_wait` call.
+    int wait_for_events();
+
     linux_queue_parent_t *parent;
 
+    // How long we spin before blocking.  It shrinks while spinning doesn't find any
+    // work, so that a mostly idle thread doesn't burn its whole budget every time.
+    int64_t spin_usecs;
+
     fd_t epoll_fd;
 
     // We store this as a class member because forget_resource needs
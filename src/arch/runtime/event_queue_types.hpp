@@ -3,6 +3,7 @@
 #define ARCH_RUNTIME_EVENT_QUEUE_TYPES_HPP_
 
 #include <signal.h>
+#include <stdint.h>
 
 // Types that are used, in particular, by poll.hpp and epoll.hpp.
 
@@ -15,6 +16,20 @@ struct linux_event_callback_t {
 struct linux_queue_parent_t {
     virtual void pump() = 0;
     virtual bool should_shut_down() = 0;
+
+    /* Busy-polling support.  If `spin_budget_usecs()` is positive, the event queue
+    polls for up to that long before it blocks in the kernel.  It calls
+    `set_spinning(true)` before it starts and `set_spinning(false)` when it stops,
+    and in between it calls `poll_spin()`, which returns true if it found work to do
+    that doesn't show up as an event. */
+    virtual int64_t spin_budget_usecs() { return 0; }
+    virtual void set_spinning(bool) { }
+    virtual bool poll_spin() { return false; }
+
+    /* The event queue calls `set_idle(true)` while it is waiting for events, whether
+    spinning or blocked in the kernel, and `set_idle(false)` once it has some. */
+    virtual void set_idle(bool) { }
+
     virtual ~linux_queue_parent_t() {}
 };
 
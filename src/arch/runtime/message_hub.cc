@@ -10,6 +10,7 @@
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "logger.hpp"
+#include "perfmon/perfmon.hpp"
 #include "random.hpp"
 #include "utils.hpp"
 
@@ -23,8 +24,10 @@ linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue,
                                          threadnum_t current_thread)
     : queue_(queue),
       thread_pool_(thread_pool),
-      is_woken_up_(false),
-      current_thread_(current_thread) {
+      incoming_messages_(nullptr),
+      spinning_(false),
+      current_thread_(current_thread),
+      reported_queue_depth_(0) {
 
 #ifndef NDEBUG
     if(MESSAGE_SCHEDULER_GRANULARITY < (1 << (NUM_SCHEDULER_PRIORITIES))) {
@@ -47,7 +50,7 @@ linux_message_hub_t::~linux_message_hub_t() {
         guarantee(get_priority_msg_list(p).empty());
     }
 
-    guarantee(incoming_messages_.empty());
+    guarantee(incoming_messages_.load() == nullptr);
 }
 
 void linux_message_hub_t::do_store_message(threadnum_t nthread, linux_thread_message_t *msg) {
@@ -94,19 +97,39 @@ void linux_message_hub_t::store_message_sometime(threadnum_t nthread, linux_thre
 
 
 void linux_message_hub_t::insert_external_message(linux_thread_message_t *msg) {
-    bool do_wake_up;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        do_wake_up = !check_and_set_is_woken_up();
-        incoming_messages_.push_back(msg);
+    msg_list_t msgs;
+    msgs.push_back(msg);
+
+    if (push_incoming_messages(&msgs)) {
+        wake_up_after_push();
     }
+}
 
-    // Wakey wakey eggs and bakey
-    if (do_wake_up) {
+void linux_message_hub_t::wake_up_after_push() {
+    // This load has to be sequentially consistent with the push, so that either we
+    // see that the thread stopped spinning, or it sees our messages when it checks
+    // again after it stops.
+    if (!spinning_.load()) {
+        // Wakey wakey eggs and bakey
         event_.wakey_wakey();
     }
 }
 
+void linux_message_hub_t::set_spinning(bool spinning) {
+    spinning_.store(spinning);
+}
+
+bool linux_message_hub_t::poll_messages() {
+    bool have_messages = incoming_messages_.load() != nullptr;
+    for (int i = 0; i < NUM_SCHEDULER_PRIORITIES && !have_messages; ++i) {
+        have_messages = !priority_msg_lists_[i].empty();
+    }
+    if (have_messages) {
+        process_messages();
+    }
+    return have_messages;
+}
+
 linux_message_hub_t::msg_list_t &linux_message_hub_t::get_priority_msg_list(int priority) {
     rassert(priority >= MESSAGE_SCHEDULER_MIN_PRIORITY);
     rassert(priority <= MESSAGE_SCHEDULER_MAX_PRIORITY);
@@ -122,6 +145,10 @@ void linux_message_hub_t::on_event(int events) {
     // up and so that poll-based event triggering doesn't infinite-loop.
     event_.consume_wakey_wakeys();
 
+    process_messages();
+}
+
+void linux_message_hub_t::process_messages() {
     // Sort incoming messages into the respective priority_msg_lists_
     sort_incoming_messages_by_priority();
 
@@ -133,6 +160,9 @@ void linux_message_hub_t::on_event(int events) {
     for (int i = 0; i < NUM_SCHEDULER_PRIORITIES; ++i) {
         total_pending_msgs += priority_msg_lists_[i].size();
     }
+    perfmon_thread_counter_t *depth = pm_eventloop_load_singleton_t::message_queue_depth();
+    *depth += static_cast<int64_t>(total_pending_msgs) - reported_queue_depth_;
+    reported_queue_depth_ = total_pending_msgs;
     const size_t effective_granularity = std::min(total_pending_msgs,
                                                   static_cast<size_t>(MESSAGE_SCHEDULER_GRANULARITY));
 
@@ -178,32 +208,17 @@ void linux_message_hub_t::on_event(int events) {
             // Place wakey_wakey and then yield to the event processing.
             // It will wake us up again immediately, but can handle a few
             // OS events (such as timers, network messages etc.) in the meantime.
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&incoming_messages_lock_);
-                do_wake_up = !check_and_set_is_woken_up();
-            }
-            if (do_wake_up) {
-                event_.wakey_wakey();
-            }
+            // If another thread woke us up already, the event just stays set.
+            event_.wakey_wakey();
             break;
         }
     }
 }
 
 void linux_message_hub_t::sort_incoming_messages_by_priority() {
-    // We do this in two steps to release the spinlock faster.
-    // append_and_clear is a very cheap operation, while
-    // assigning each message to a different priority queue
-    // is more expensive.
-
     // 1. Pull the messages
     msg_list_t new_messages;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        new_messages.append_and_clear(&incoming_messages_);
-        is_woken_up_ = false;
-    }
+    pop_incoming_messages(&new_messages);
 
     // 2. Sort the messages into their respective priority queues
     while (linux_thread_message_t *m = new_messages.head()) {
@@ -221,10 +236,37 @@ void linux_message_hub_t::sort_incoming_messages_by_priority() {
     }
 }
 
-bool linux_message_hub_t::check_and_set_is_woken_up() {
-    const bool was_woken_up = is_woken_up_;
-    is_woken_up_ = true;
-    return was_woken_up;
+bool linux_message_hub_t::push_incoming_messages(msg_list_t *msgs) {
+    rassert(!msgs->empty());
+    // Link the messages into a chain, newest first.
+    linux_thread_message_t *oldest = msgs->head();
+    linux_thread_message_t *newest = nullptr;
+    while (linux_thread_message_t *m = msgs->head()) {
+        msgs->remove(m);
+        m->incoming_next_ = newest;
+        newest = m;
+    }
+
+    linux_thread_message_t *old_head = incoming_messages_.load(std::memory_order_relaxed);
+    do {
+        oldest->incoming_next_ = old_head;
+    } while (!incoming_messages_.compare_exchange_weak(old_head, newest,
+                                                       std::memory_order_seq_cst,
+                                                       std::memory_order_relaxed));
+    return old_head == nullptr;
+}
+
+void linux_message_hub_t::pop_incoming_messages(msg_list_t *msgs_out) {
+    linux_thread_message_t *m
+        = incoming_messages_.exchange(nullptr, std::memory_order_acquire);
+    // The stack is newest first, so pushing each message to the front restores the
+    // order in which they were sent.
+    while (m != nullptr) {
+        linux_thread_message_t *next = m->incoming_next_;
+        m->incoming_next_ = nullptr;
+        msgs_out->push_front(m);
+        m = next;
+    }
 }
 
 // Pushes messages collected locally global lists available to all
@@ -235,23 +277,12 @@ void linux_message_hub_t::push_messages() {
         // message list.
         thread_queue_t *queue = &queues_[i];
         if (!queue->msg_local_list.empty()) {
-            // Transfer messages to the other core
-
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&thread_pool_->threads[i]->message_hub.incoming_messages_lock_);
-
-                // We only need to do a wake up if we're the first people to do a
-                // wake up.
-                do_wake_up =
-                    !thread_pool_->threads[i]->message_hub.check_and_set_is_woken_up();
-
-                thread_pool_->threads[i]->message_hub.incoming_messages_.append_and_clear(&queue->msg_local_list);
-            }
-
-            // Wakey wakey, perhaps eggs and bakey
-            if (do_wake_up) {
-                thread_pool_->threads[i]->message_hub.event_.wakey_wakey();
+            // Transfer messages to the other core.  We only need to do a wake up
+            // if the other core had no pending messages; otherwise somebody woke it
+            // up already.
+            linux_message_hub_t *target = &thread_pool_->threads[i]->message_hub;
+            if (target->push_incoming_messages(&queue->msg_local_list)) {
+                target->wake_up_after_push();
             }
         }
     }
@@ -4,10 +4,11 @@
 
 #include <pthread.h>
 
+#include <atomic>
+
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime_utils.hpp"
 #include "arch/runtime/system_event.hpp"
-#include "arch/spinlock.hpp"
 #include "config/args.hpp"
 #include "containers/intrusive_list.hpp"
 #include "threading.hpp"
@@ -48,6 +49,13 @@ public:
     // (which does not have an event queue)
     void insert_external_message(linux_thread_message_t *msg);
 
+    // While our thread's event loop is spinning, other threads don't wake us up when
+    // they send us messages, and the event loop calls `poll_messages()` instead.
+    // `poll_messages()` processes our pending messages, if there are any, and returns
+    // whether there were.
+    void set_spinning(bool spinning);
+    bool poll_messages();
+
     ~linux_message_hub_t();
 
 private:
@@ -59,8 +67,23 @@ private:
     // priority_msg_lists, depending on the messages' priorities.
     void sort_incoming_messages_by_priority();
 
+    // Moves the messages in `*msgs` onto incoming_messages_ in one atomic step.  Can
+    // be called from any thread.  Returns true if incoming_messages_ was empty, in
+    // which case the caller must wake up the hub's thread.
+    bool push_incoming_messages(msg_list_t *msgs);
+    // Takes all messages off incoming_messages_, in the order in which they were
+    // pushed.  Must only be called on the hub's thread.
+    void pop_incoming_messages(msg_list_t *msgs_out);
+
     msg_list_t &get_priority_msg_list(int priority);
 
+    // Sorts in the incoming messages and runs a batch of pending messages.
+    void process_messages();
+
+    // Wakes up the hub's thread after a message was pushed onto an empty stack, unless
+    // it's spinning.
+    void wake_up_after_push();
+
     linux_event_queue_t *const queue_;
     linux_thread_pool_t *const thread_pool_;
 
@@ -68,16 +91,17 @@ private:
     struct thread_queue_t {
         //TODO this doesn't need to be a class anymore
 
-        /* Messages are cached here before being pushed to the global list so that we don't
-        have to acquire the spinlock as often */
+        /* Messages are cached here before being pushed to the other thread's incoming
+        stack so that we don't have to touch it as often */
         msg_list_t msg_local_list;
     } queues_[MAX_THREADS];
 
-    // Must only be used with acquired incoming_messages_lock_
-    bool check_and_set_is_woken_up();
-    bool is_woken_up_;
-    msg_list_t incoming_messages_;
-    spinlock_t incoming_messages_lock_;
+    /* Messages from other threads.  This is a lock-free stack of messages linked
+    through `incoming_next_`, newest first, which other threads push onto and which we
+    take off in one go.  We only need to be woken up when a message is pushed onto an
+    empty stack, so a burst of messages costs a single wake up. */
+    std::atomic<linux_thread_message_t *> incoming_messages_;
+    std::atomic<bool> spinning_;
 
     // Use `sort_incoming_messages_by_priority()` to sort incoming_messages_ into
     // these lists.
@@ -90,13 +114,16 @@ private:
     void on_event(int events);
 
     // The eventfd (or pipe-based alternative) notified after the first incoming
-    // message is put onto incoming_messages_.
+    // message is put onto an empty incoming_messages_.
     system_event_t event_;
 
     /* The thread that we queue messages originating from. (Recall that there is one
     message_hub_t per thread.) */
     const threadnum_t current_thread_;
 
+    // What we last reported in `pm_eventloop_load_singleton_t::message_queue_depth()`.
+    int64_t reported_queue_depth_;
+
     DISABLE_COPYING(linux_message_hub_t);
 };
 
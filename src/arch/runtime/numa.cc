@@ -0,0 +1,90 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/numa.hpp"
+
+#include <stdlib.h>
+
+#include "arch/runtime/runtime_utils.hpp"
+#include "errors.hpp"
+#include "paths.hpp"
+#include "utils.hpp"
+
+std::vector<std::vector<int> > get_numa_node_cpus() {
+    std::vector<std::vector<int> > ret;
+#ifdef __linux
+    std::string online;
+    std::vector<int> nodes;
+    if (blocking_read_file("/sys/devices/system/node/online", &online)
+        && parse_cpu_list(online, &nodes)) {
+        for (int node : nodes) {
+            std::string contents;
+            const std::string path
+                = strprintf("/sys/devices/system/node/node%d/cpulist", node);
+            std::vector<int> cpus;
+            if (blocking_read_file(path.c_str(), &contents)
+                && parse_cpu_list(contents, &cpus)
+                && !cpus.empty()) {
+                ret.push_back(std::move(cpus));
+            }
+        }
+    }
+#endif
+    if (ret.empty()) {
+        std::vector<int> cpus;
+        for (int i = 0; i < get_cpu_count(); ++i) {
+            cpus.push_back(i);
+        }
+        ret.push_back(std::move(cpus));
+    }
+    return ret;
+}
+
+bool parse_cpu_list(const std::string &list, std::vector<int> *cpus_out) {
+    cpus_out->clear();
+    const char *p = list.c_str();
+    while (*p != '\0' && *p != '\n') {
+        char *end;
+        const long first = strtol(p, &end, 10);
+        if (end == p || first < 0) {
+            return false;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            ++p;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) {
+                return false;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus_out->push_back(cpu);
+        }
+        if (*p == ',') {
+            ++p;
+        } else if (*p != '\0' && *p != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void assign_threads_to_cpus(const std::vector<std::vector<int> > &node_cpus,
+                            int num_threads,
+                            std::vector<int> *cpus_out,
+                            std::vector<int> *nodes_out) {
+    guarantee(!node_cpus.empty());
+    cpus_out->clear();
+    nodes_out->clear();
+    const int num_nodes = node_cpus.size();
+    // The number of threads assigned to each node so far.
+    std::vector<int> node_counts(num_nodes, 0);
+    for (int i = 0; i < num_threads; ++i) {
+        const int node = static_cast<int64_t>(i) * num_nodes / num_threads;
+        const std::vector<int> &cpus = node_cpus[node];
+        // If there are more threads than CPUs on the node, we wrap around.
+        cpus_out->push_back(cpus[node_counts[node] % cpus.size()]);
+        nodes_out->push_back(node);
+        ++node_counts[node];
+    }
+}
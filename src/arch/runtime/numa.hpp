@@ -0,0 +1,26 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_NUMA_HPP_
+#define ARCH_RUNTIME_NUMA_HPP_
+
+#include <string>
+#include <vector>
+
+/* Returns the online CPUs of each NUMA node, as reported by
+`/sys/devices/system/node`.  Nodes without CPUs are left out.  If the system doesn't
+report any NUMA information, returns a single node with CPUs 0 to
+`get_cpu_count() - 1`. */
+std::vector<std::vector<int> > get_numa_node_cpus();
+
+/* Parses a kernel CPU (or node) list such as "0-3,8,10-11" into `*cpus_out`.  Returns false if
+`list` is malformed. */
+bool parse_cpu_list(const std::string &list, std::vector<int> *cpus_out);
+
+/* Picks a CPU for each of `num_threads` threads, so that the threads are spread
+evenly over the NUMA nodes in `node_cpus` and consecutive threads share a node.  Fills
+in the CPU and the index of its node for each thread. */
+void assign_threads_to_cpus(const std::vector<std::vector<int> > &node_cpus,
+                            int num_threads,
+                            std::vector<int> *cpus_out,
+                            std::vector<int> *nodes_out);
+
+#endif  // ARCH_RUNTIME_NUMA_HPP_
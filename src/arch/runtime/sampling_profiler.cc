@@ -0,0 +1,197 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/sampling_profiler.hpp"
+
+#include <errno.h>
+#include <inttypes.h>
+#ifndef _WIN32
+#include <execinfo.h>
+#endif
+#include <string.h>
+
+#include <algorithm>
+
+#include "arch/io/io_utils.hpp"
+#include "arch/runtime/runtime_utils.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "backtrace.hpp"
+#include "logger.hpp"
+#include "utils.hpp"
+
+#ifdef __linux__
+// See the comment in `timer_signal_provider.cc`.
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+// The signal handler itself and the kernel's signal trampoline.
+const int SAMPLING_PROFILER_FRAMES_TO_SKIP = 2;
+
+#ifndef _WIN32
+void sampling_profiler_signal_handler(int, siginfo_t *, void *) {
+    // `backtrace()` doesn't promise to be async-signal-safe, but it is once it has
+    // been called for the first time, which the constructor takes care of.
+    int saved_errno = errno;
+    void *frames[SAMPLING_PROFILER_MAX_DEPTH + SAMPLING_PROFILER_FRAMES_TO_SKIP];
+    int depth = backtrace(frames, SAMPLING_PROFILER_MAX_DEPTH
+                                  + SAMPLING_PROFILER_FRAMES_TO_SKIP);
+    sampling_profiler_t::get_global_profiler().record_sample(
+        frames + SAMPLING_PROFILER_FRAMES_TO_SKIP,
+        std::max(0, depth - SAMPLING_PROFILER_FRAMES_TO_SKIP));
+    errno = saved_errno;
+}
+#endif
+
+sampling_profiler_t &sampling_profiler_t::get_global_profiler() {
+    static sampling_profiler_t profiler;
+    return profiler;
+}
+
+sampling_profiler_t::sampling_profiler_t() : num_dropped_samples(0) {
+    for (auto &buffer : buffers) {
+        buffer.store(nullptr);
+    }
+#ifdef __linux__
+    timer_running.fill(false);
+
+    void *frames[1];
+    UNUSED int depth = backtrace(frames, 1);
+
+    struct sigaction sa = make_sa_sigaction(SA_SIGINFO | SA_ONSTACK | SA_RESTART,
+                                            &sampling_profiler_signal_handler);
+    int res = sigaction(SIGPROF, &sa, nullptr);
+    guarantee_err(res == 0, "Could not install the SIGPROF handler");
+#endif
+}
+
+bool sampling_profiler_t::start_on_this_thread(int hz) {
+    guarantee(hz > 0);
+#ifdef __linux__
+    const int thread = linux_thread_pool_t::get_thread_id();
+    guarantee(thread >= 0 && thread < MAX_THREADS);
+    if (buffers[thread].load() == nullptr) {
+        buffers[thread].store(new thread_buffer_t());
+    }
+
+    if (!timer_running[thread]) {
+        // The timer counts the CPU time of this thread only, so threads that are
+        // waiting for events don't get interrupted.
+        struct sigevent evp;
+        memset(&evp, 0, sizeof(evp));
+        evp.sigev_signo = SIGPROF;
+        evp.sigev_notify = SIGEV_THREAD_ID;
+        evp.sigev_notify_thread_id = _gettid();
+        if (timer_create(CLOCK_THREAD_CPUTIME_ID, &evp, &timers[thread]) != 0) {
+            logERR("Could not create a timer for the sampling profiler: %s",
+                   errno_string(get_errno()).c_str());
+            return false;
+        }
+        timer_running[thread] = true;
+    }
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = BILLION / hz;
+    spec.it_value = spec.it_interval;
+    int res = timer_settime(timers[thread], 0, &spec, nullptr);
+    guarantee_err(res == 0, "Could not start the sampling profiler timer");
+    return true;
+#else
+    return false;
+#endif
+}
+
+void sampling_profiler_t::stop_on_this_thread() {
+#ifdef __linux__
+    const int thread = linux_thread_pool_t::get_thread_id();
+    guarantee(thread >= 0 && thread < MAX_THREADS);
+    if (timer_running[thread]) {
+        int res = timer_delete(timers[thread]);
+        guarantee_err(res == 0, "Could not delete the sampling profiler timer");
+        timer_running[thread] = false;
+    }
+#endif
+}
+
+void sampling_profiler_t::record_sample(void *const *frames, int depth) {
+    const int thread = linux_thread_pool_t::get_thread_id();
+    if (thread < 0 || thread >= MAX_THREADS) {
+        return;
+    }
+    thread_buffer_t *buffer = buffers[thread].load(std::memory_order_acquire);
+    if (buffer == nullptr) {
+        return;
+    }
+    const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    if (head - buffer->tail.load(std::memory_order_acquire)
+        >= SAMPLING_PROFILER_BUFFER_SIZE) {
+        num_dropped_samples.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    sample_t *sample = &buffer->samples[head % SAMPLING_PROFILER_BUFFER_SIZE];
+    memcpy(sample->frames, frames, depth * sizeof(void *));
+    sample->depth = depth;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void sampling_profiler_t::collect() {
+    spinlock_acq_t acq(&lock);
+    for (auto &buffer_ptr : buffers) {
+        thread_buffer_t *buffer = buffer_ptr.load(std::memory_order_acquire);
+        if (buffer == nullptr) {
+            continue;
+        }
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        for (uint64_t i = buffer->tail.load(std::memory_order_relaxed); i < head; ++i) {
+            const sample_t &sample = buffer->samples[i % SAMPLING_PROFILER_BUFFER_SIZE];
+            ++traces[std::vector<void *>(sample.frames, sample.frames + sample.depth)];
+        }
+        buffer->tail.store(head, std::memory_order_release);
+    }
+}
+
+std::string sampling_profiler_t::get_folded_stacks() {
+    collect();
+    std::map<std::vector<void *>, uint64_t> traces_copy;
+    {
+        spinlock_acq_t acq(&lock);
+        traces_copy = traces;
+    }
+
+    // Looking up the symbols is slow, so we do it once per address.
+    std::map<void *, std::string> names;
+    std::string res;
+    for (const auto &pair : traces_copy) {
+        const std::vector<void *> &trace = pair.first;
+        for (auto it = trace.rbegin(); it != trace.rend(); ++it) {
+            auto name_it = names.find(*it);
+            if (name_it == names.end()) {
+                backtrace_frame_t frame(*it);
+                frame.initialize_symbols();
+                std::string name;
+                try {
+                    name = frame.get_demangled_name();
+                } catch (const demangle_failed_exc_t &) {
+                    name = frame.get_name();
+                }
+                if (name.empty()) {
+                    name = strprintf("%p", *it);
+                }
+                // `;` separates the frames of the folded format.
+                std::replace(name.begin(), name.end(), ';', ':');
+                name_it = names.insert(std::make_pair(*it, name)).first;
+            }
+            if (it != trace.rbegin()) {
+                res += ";";
+            }
+            res += name_it->second;
+        }
+        res += strprintf(" %" PRIu64 "\n", pair.second);
+    }
+    return res;
+}
+
+void sampling_profiler_t::reset() {
+    collect();
+    spinlock_acq_t acq(&lock);
+    traces.clear();
+    num_dropped_samples.store(0);
+}
@@ -0,0 +1,97 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
+#define ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
+
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "arch/spinlock.hpp"
+#include "config/args.hpp"
+#include "errors.hpp"
+
+/* The `sampling_profiler_t` finds out where the server spends its CPU time, cheaply
+enough to use it on a production server.  While it is running, every thread gets a
+`SIGPROF` after each `1 / hz` seconds of CPU time that it uses, and the signal handler
+records the backtrace of whatever the thread was running, usually a coroutine.
+
+Unlike the `coro_profiler_t`, it doesn't have to be compiled in, and it can be started
+and stopped at any time.  It only works on Linux.
+
+The signal handler puts the backtraces into a small buffer per thread, so somebody has
+to call `collect()` regularly to aggregate them.  Samples that don't fit into the
+buffer are dropped and counted. */
+class sampling_profiler_t {
+public:
+    static sampling_profiler_t &get_global_profiler();
+
+    // Starts or stops sampling the current thread, which must be in the thread pool.
+    // `start_on_this_thread()` returns false if this platform doesn't support it.
+    bool start_on_this_thread(int hz);
+    void stop_on_this_thread();
+
+    // Moves the samples out of the per-thread buffers into the aggregated backtraces.
+    // Can be called from any thread.
+    void collect();
+
+    // Calls `collect()` and returns the aggregated backtraces in the "folded" format
+    // that flame graph tools understand: one line per distinct backtrace, with the
+    // function names from the outermost to the innermost frame separated by `;`,
+    // followed by a space and the number of samples.
+    std::string get_folded_stacks();
+
+    // Forgets all samples collected so far.
+    void reset();
+
+    uint64_t get_num_dropped_samples() const { return num_dropped_samples.load(); }
+
+private:
+    sampling_profiler_t();
+
+#ifndef _WIN32
+    friend void sampling_profiler_signal_handler(int, siginfo_t *, void *);
+#endif
+
+    struct sample_t {
+        int depth;
+        void *frames[SAMPLING_PROFILER_MAX_DEPTH];
+    };
+
+    // Written by the signal handler of one thread and read by `collect()`.
+    struct thread_buffer_t {
+        thread_buffer_t() : head(0), tail(0) { }
+        std::atomic<uint64_t> head;
+        std::atomic<uint64_t> tail;
+        sample_t samples[SAMPLING_PROFILER_BUFFER_SIZE];
+    };
+
+    // Called by the signal handler.
+    void record_sample(void *const *frames, int depth);
+
+    // They are allocated when a thread gets started for the first time, and are kept
+    // around after that.
+    std::array<std::atomic<thread_buffer_t *>, MAX_THREADS> buffers;
+
+#ifdef __linux__
+    // Only used by their respective threads.
+    std::array<timer_t, MAX_THREADS> timers;
+    std::array<bool, MAX_THREADS> timer_running;
+#endif
+
+    std::atomic<uint64_t> num_dropped_samples;
+
+    // Protects `traces`, and makes sure that only one thread empties the buffers at
+    // a time.
+    spinlock_t lock;
+    std::map<std::vector<void *>, uint64_t> traces;
+
+    DISABLE_COPYING(sampling_profiler_t);
+};
+
+#endif  // ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
@@ -4,12 +4,17 @@
 
 // Implementation in runtime.cc.
 
+#include <stdint.h>
+
 #include <functional>
 
 /* `run_in_thread_pool()` starts a RethinkDB thread pool, runs the given
 function in a coroutine inside of it, waits for the function to return, and then
-shuts down the thread pool. */
+shuts down the thread pool.  If `pin_threads` is true, the worker threads get
+pinned to CPUs, grouped by NUMA node.  If `event_loop_spin_usecs` is positive, the
+worker threads busy-poll for up to that long before they go to sleep. */
 
-void run_in_thread_pool(const std::function<void()> &fun, int worker_threads);
+void run_in_thread_pool(const std::function<void()> &fun, int worker_threads,
+                        bool pin_threads = false, int64_t event_loop_spin_usecs = 0);
 
 #endif  // ARCH_RUNTIME_STARTER_HPP_
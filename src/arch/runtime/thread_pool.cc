@@ -8,6 +8,8 @@
 
 #ifndef _WIN32
 #include <sys/time.h>
+
+#include <vector>
 #endif
 
 #include "arch/compiler.hpp"
@@ -15,6 +17,7 @@
 #include "arch/os_signal.hpp"
 #include "arch/io/timer_provider.hpp"
 #include "arch/runtime/event_queue.hpp"
+#include "arch/runtime/numa.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/timing.hpp"
 #include "errors.hpp"
@@ -62,18 +65,24 @@ void linux_thread_pool_t::set_thread(linux_thread_t *val) {
     thread = val;
 }
 
-linux_thread_pool_t::linux_thread_pool_t(int worker_threads, bool _do_set_affinity) :
+linux_thread_pool_t::linux_thread_pool_t(int worker_threads, bool _do_set_affinity,
+                                         int64_t _event_loop_spin_usecs) :
 #ifndef NDEBUG
       coroutine_summary(false),
 #endif
       interrupt_message(nullptr),
       generic_blocker_pool(nullptr),
       n_threads(worker_threads + 1),    // we create an extra utility thread
-      do_set_affinity(_do_set_affinity)
+      do_set_affinity(_do_set_affinity),
+      event_loop_spin_usecs(_event_loop_spin_usecs)
 {
     rassert(n_threads > 1);             // we want at least one non-utility thread
     rassert(n_threads <= MAX_THREADS);
 
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        thread_numa_nodes[i] = -1;
+    }
+
     int res;
 
     res = pthread_cond_init(&shutdown_cond, nullptr);
@@ -105,8 +114,8 @@ struct thread_data_t {
 
 void *linux_thread_pool_t::start_thread(void *arg) {
 #ifndef _WIN32
-    // Block all signals but `SIGSEGV` and `SIGBUS` (will be unblocked by the event
-    // queue in case of poll).
+    // Block all signals but `SIGSEGV`, `SIGBUS` and the sampling profiler's `SIGPROF`
+    // (will be unblocked by the event queue in case of poll).
     {
         sigset_t sigmask;
         int res = sigfillset(&sigmask);
@@ -116,6 +125,8 @@ void *linux_thread_pool_t::start_thread(void *arg) {
         guarantee_err(res == 0, "Could not remove SIGSEGV from sigmask");
         res = sigdelset(&sigmask, SIGBUS);
         guarantee_err(res == 0, "Could not remove SIGBUS from sigmask");
+        res = sigdelset(&sigmask, SIGPROF);
+        guarantee_err(res == 0, "Could not remove SIGPROF from sigmask");
 
         res = pthread_sigmask(SIG_SETMASK, &sigmask, nullptr);
         guarantee_xerr(res == 0, res, "Could not block signal");
@@ -212,6 +223,18 @@ void linux_thread_pool_t::enable_coroutine_summary() {
 void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_message) {
     do_shutdown = false;
 
+    // Spread the worker threads (but not the utility thread) over the NUMA nodes, so
+    // that the threads that serve a table can be picked from the same node.
+    std::vector<int> thread_cpus;
+    if (do_set_affinity) {
+        std::vector<int> nodes;
+        assign_threads_to_cpus(get_numa_node_cpus(), n_threads - 1,
+                               &thread_cpus, &nodes);
+        for (int i = 0; i < n_threads - 1; ++i) {
+            thread_numa_nodes[i] = nodes[i];
+        }
+    }
+
     // Start child threads
     thread_barrier_t barrier(n_threads + 1);
 
@@ -231,11 +254,9 @@ void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_messag
         if (do_set_affinity && !is_utility_thread) {
             // On Apple, the thread affinity API has awful documentation, so we don't even bother.
 #ifdef _GNU_SOURCE
-            // Distribute threads evenly among CPUs
-            int ncpus = get_cpu_count();
             cpu_set_t mask;
             CPU_ZERO(&mask);
-            CPU_SET(i % ncpus, &mask);
+            CPU_SET(thread_cpus[i], &mask);
             res = pthread_setaffinity_np(pthreads[i], sizeof(cpu_set_t), &mask);
             guarantee_xerr(res == 0, res, "Could not set thread affinity");
 #endif
@@ -458,6 +479,10 @@ linux_thread_t::linux_thread_t(linux_thread_pool_t *parent_pool, int thread_id)
     : queue(this),
       message_hub(&queue, parent_pool, threadnum_t(thread_id)),
       timer_handler(&queue),
+      // Spinning on the utility thread would waste a core on background work.
+      spin_budget(thread_id == parent_pool->n_threads - 1
+                  ? 0 : parent_pool->event_loop_spin_usecs),
+      idle(false),
       do_shutdown(false)
 #ifndef NDEBUG
       , coroutine_counts_at_shutdown(NULL)
@@ -488,6 +513,22 @@ void linux_thread_t::pump() {
     message_hub.push_messages();
 }
 
+int64_t linux_thread_t::spin_budget_usecs() {
+    return spin_budget;
+}
+
+void linux_thread_t::set_spinning(bool spinning) {
+    message_hub.set_spinning(spinning);
+}
+
+bool linux_thread_t::poll_spin() {
+    return message_hub.poll_messages();
+}
+
+void linux_thread_t::set_idle(bool _idle) {
+    idle.store(_idle, std::memory_order_relaxed);
+}
+
 void linux_thread_t::on_event(int events) {
     // No-op. This is just to make sure that the event queue wakes up
     // so it can shut down.
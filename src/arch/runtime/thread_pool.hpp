@@ -13,7 +13,9 @@
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/system_event.hpp"
 #include "arch/runtime/message_hub.hpp"
+#include "arch/spinlock.hpp"
 #include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/work_stealing.hpp"
 #include "arch/io/blocker_pool.hpp"
 #include "arch/io/timer_provider.hpp"
 #include "arch/timer.hpp"
@@ -41,7 +43,10 @@ and shutting down the threads and event queues. */
 
 class linux_thread_pool_t {
 public:
-    linux_thread_pool_t(int worker_threads, bool do_set_affinity);
+    // If `event_loop_spin_usecs` is positive, the worker threads' event loops spin for
+    // up to that long before they block in the kernel.
+    linux_thread_pool_t(int worker_threads, bool do_set_affinity,
+                        int64_t event_loop_spin_usecs);
 
     // When the process receives a SIGINT or SIGTERM, interrupt_message will be delivered to the
     // same thread that initial_message was delivered to, and interrupt_message will be set to
@@ -101,7 +106,11 @@ public:
     static void run_in_blocker_pool(const Callable &);
 
     int n_threads;
+    // If set, worker threads are pinned to CPUs, grouped by NUMA node.
     bool do_set_affinity;
+    // The NUMA node that each pinned worker thread runs on, or -1.
+    int thread_numa_nodes[MAX_THREADS];
+    const int64_t event_loop_spin_usecs;
 
 #ifdef _WIN32
     static linux_thread_pool_t *get_global_thread_pool();
@@ -190,6 +199,13 @@ public:
 
     void pump();   // Called by the event queue
     bool should_shut_down();   // Called by the event queue
+    int64_t spin_budget_usecs();   // Called by the event queue
+    void set_spinning(bool spinning);   // Called by the event queue
+    bool poll_spin();   // Called by the event queue
+    void set_idle(bool idle);   // Called by the event queue
+    // Whether the event queue is waiting for events.  Can be called from any thread,
+    // but the answer may be out of date by the time it returns.
+    bool is_idle() const { return idle.load(std::memory_order_relaxed); }
 #ifndef NDEBUG
     void initiate_shut_down(std::map<std::string, size_t> *coroutine_counts); // Can be called from any thread
 #else
@@ -197,7 +213,15 @@ public:
 #endif
     void on_event(int events);
 
+    // Calls of `run_stealable()` on this thread that other threads may take over.
+    stealable_task_queue_t stealable_tasks;
+
 private:
+    // How long the event queue may spin; 0 for the utility thread.
+    const int64_t spin_budget;
+
+    std::atomic<bool> idle;
+
     volatile bool do_shutdown;
     pthread_mutex_t do_shutdown_mutex;
     system_event_t shutdown_notify_event;
@@ -0,0 +1,122 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/work_stealing.hpp"
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "perfmon/perfmon.hpp"
+
+/* How many tasks each thread has taken over from other threads. */
+static perfmon_thread_counter_t *get_stolen_tasks_perfmon() {
+    static perfmon_thread_counter_t pm_stolen_tasks;
+    static perfmon_membership_t pm_stolen_tasks_membership(
+        &get_global_perfmon_collection(), &pm_stolen_tasks, "stolen_tasks");
+    return &pm_stolen_tasks;
+}
+
+void stealable_task_queue_t::push(stealable_task_t *task) {
+    spinlock_acq_t acq(&lock);
+    tasks.push_back(task);
+}
+
+bool stealable_task_queue_t::remove(stealable_task_t *task) {
+    spinlock_acq_t acq(&lock);
+    if (!task->in_a_list()) {
+        return false;
+    }
+    tasks.remove(task);
+    return true;
+}
+
+stealable_task_t *stealable_task_queue_t::steal() {
+    spinlock_acq_t acq(&lock);
+    stealable_task_t *task = tasks.head();
+    if (task != nullptr) {
+        tasks.remove(task);
+    }
+    return task;
+}
+
+namespace {
+
+void run_stolen_task(stealable_task_t *task) {
+    try {
+        (*task->fn)();
+    } catch (...) {
+        task->exception = std::current_exception();
+    }
+    // `task` may be gone as soon as we count it down.
+    coro_t *waiter = task->waiter;
+    if (task->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        waiter->notify_sometime();
+    }
+}
+
+/* Sent to an idle thread to make it look for work in `victim`'s queue.  By the time it
+arrives, the victim may have run the task itself, in which case it does nothing. */
+class steal_request_t : public linux_thread_message_t {
+public:
+    explicit steal_request_t(threadnum_t _victim) : victim(_victim) { }
+
+    void on_thread_switch() {
+        stealable_task_t *task = linux_thread_pool_t::get_thread_pool()
+            ->threads[victim.threadnum]->stealable_tasks.steal();
+        if (task != nullptr) {
+            ++*get_stolen_tasks_perfmon();
+            coro_t::spawn_sometime(std::bind(&run_stolen_task, task));
+        }
+        delete this;
+    }
+
+private:
+    threadnum_t victim;
+};
+
+// Returns -1 if no other database thread is idle.
+int find_idle_thread(linux_thread_pool_t *pool, stealable_task_queue_t *queue) {
+    const int current = linux_thread_pool_t::get_thread_id();
+    const int num_db_threads = get_num_db_threads();
+    for (int i = 0; i < num_db_threads; ++i) {
+        const int thread = (queue->next_thief + i) % num_db_threads;
+        if (thread != current && pool->threads[thread]->is_idle()) {
+            queue->next_thief = thread + 1;
+            return thread;
+        }
+    }
+    return -1;
+}
+
+}  // namespace
+
+void run_stealable(const std::function<void()> &fn) {
+    linux_thread_pool_t *pool = linux_thread_pool_t::get_thread_pool();
+    if (pool == nullptr || coro_t::self() == nullptr) {
+        fn();
+        return;
+    }
+    stealable_task_queue_t *queue = &linux_thread_pool_t::get_thread()->stealable_tasks;
+    const int thief = find_idle_thread(pool, queue);
+    if (thief == -1) {
+        fn();
+        return;
+    }
+
+    // Offer the task to the idle thread, and let the other coroutines on our thread
+    // run.  If we get back to it before the thief does, we run it ourselves.
+    stealable_task_t task(&fn, coro_t::self());
+    queue->push(&task);
+    linux_thread_pool_t::get_thread()->message_hub.store_message_sometime(
+        threadnum_t(thief), new steal_request_t(get_thread_id()));
+    coro_t::yield();
+
+    if (queue->remove(&task)) {
+        fn();
+        return;
+    }
+    if (task.pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        coro_t::wait();
+    }
+    if (task.exception) {
+        std::rethrow_exception(task.exception);
+    }
+}
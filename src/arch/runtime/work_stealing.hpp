@@ -0,0 +1,65 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_WORK_STEALING_HPP_
+#define ARCH_RUNTIME_WORK_STEALING_HPP_
+
+#include <atomic>
+#include <exception>
+#include <functional>
+
+#include "arch/spinlock.hpp"
+#include "containers/intrusive_list.hpp"
+#include "errors.hpp"
+
+class coro_t;
+
+/* A call of `run_stealable()` that waits for its thread to get around to it. */
+class stealable_task_t : public intrusive_list_node_t<stealable_task_t> {
+public:
+    stealable_task_t(const std::function<void()> *_fn, coro_t *_waiter)
+        : fn(_fn), waiter(_waiter), pending(2) { }
+
+    const std::function<void()> *const fn;
+    coro_t *const waiter;
+    std::exception_ptr exception;
+
+    // Once a task has been stolen, both the thief and the waiter count this down when
+    // they are done with it.  Whoever gets to zero last must wake up the waiter.
+    std::atomic<int> pending;
+
+    DISABLE_COPYING(stealable_task_t);
+};
+
+/* Every thread has a `stealable_task_queue_t`, which idle threads take tasks from. */
+class stealable_task_queue_t {
+public:
+    stealable_task_queue_t() : next_thief(0) { }
+
+    void push(stealable_task_t *task);
+    // Removes `task`, unless another thread has taken it.  Returns false in that case.
+    bool remove(stealable_task_t *task);
+    // Takes the oldest task off the queue, or returns null if there isn't one.
+    stealable_task_t *steal();
+
+    // Where the owning thread starts looking for an idle thread next time, so that the
+    // steal requests get spread out.  Only used by the owning thread.
+    int next_thief;
+
+private:
+    spinlock_t lock;
+    intrusive_list_t<stealable_task_t> tasks;
+
+    DISABLE_COPYING(stealable_task_queue_t);
+};
+
+/* Calls `fn()` in the current coroutine, unless the thread is busy and an idle thread
+takes the call over in the meantime.  Use this for CPU-bound work that is worth
+spreading across threads, but that isn't worth a thread switch if the current thread
+has nothing else to do.
+
+`fn` must not touch anything that is bound to the current thread, such as objects
+with a `home_thread_mixin_t` or thread-local caches, or share data with other
+coroutines that isn't safe to use from another thread.  Exceptions that `fn`
+throws are rethrown here. */
+void run_stealable(const std::function<void()> &fn);
+
+#endif  // ARCH_RUNTIME_WORK_STEALING_HPP_
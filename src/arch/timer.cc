@@ -4,14 +4,20 @@
 #include <algorithm>
 
 #include "arch/runtime/thread_pool.hpp"
+#include "math.hpp"
 #include "time.hpp"
 #include "utils.hpp"
 
-class timer_token_t : public intrusive_priority_queue_node_t<timer_token_t> {
+static const int64_t TIMER_WHEEL_TICK_NANOS = TIMER_WHEEL_TICK_MS * MILLION;
+
+class timer_token_t : public intrusive_priority_queue_node_t<timer_token_t>,
+                      public intrusive_list_node_t<timer_token_t> {
     friend class timer_handler_t;
 
 private:
-    timer_token_t() : interval_nanos(-1), next_time_in_nanos(-1), callback(nullptr) { }
+    timer_token_t()
+        : interval_nanos(-1), next_time_in_nanos(-1), callback(nullptr),
+          wheel_list(nullptr) { }
 
     friend bool left_is_higher_priority(const timer_token_t *left, const timer_token_t *right);
 
@@ -24,6 +30,10 @@ private:
     // The callback we call upon each 'ring'.
     timer_callback_t *callback;
 
+    // The wheel slot (or `wheel_ringing`) the token is in, or null if the token is in
+    // the priority queue.
+    intrusive_list_t<timer_token_t> *wheel_list;
+
     DISABLE_COPYING(timer_token_t);
 };
 
@@ -33,12 +43,75 @@ bool left_is_higher_priority(const timer_token_t *left, const timer_token_t *rig
 
 timer_handler_t::timer_handler_t(linux_event_queue_t *queue)
     : timer_provider(queue),
-      expected_oneshot_time_in_nanos(0) {
+      expected_oneshot_time_in_nanos(0),
+      wheel_tick(0),
+      wheel_size(0) {
     // Right now, we have no tokens.  So we don't ask the timer provider to do anything for us.
 }
 
 timer_handler_t::~timer_handler_t() {
     guarantee(token_queue.empty());
+    guarantee(wheel_size == 0 && wheel_ringing.empty());
+}
+
+void timer_handler_t::insert_token(timer_token_t *token, int64_t duration_nanos) {
+    if (duration_nanos < TIMER_WHEEL_MIN_MS * MILLION) {
+        token->wheel_list = nullptr;
+        token_queue.push(token);
+        return;
+    }
+
+    if (wheel_size == 0) {
+        // Nothing to process in the ticks that have passed since the wheel was last
+        // used.
+        wheel_tick = get_ticks() / TIMER_WHEEL_TICK_NANOS;
+    }
+    const int64_t tick = std::max(
+        wheel_tick, ceil_divide(token->next_time_in_nanos, TIMER_WHEEL_TICK_NANOS));
+    token->wheel_list = &wheel[tick % TIMER_WHEEL_SLOTS];
+    token->wheel_list->push_back(token);
+    ++wheel_size;
+}
+
+void timer_handler_t::advance_wheel(int64_t ticks) {
+    const int64_t last_tick = ticks / TIMER_WHEEL_TICK_NANOS;
+    if (wheel_size == 0 || last_tick < wheel_tick) {
+        return;
+    }
+    // If more than a whole rotation has passed, every slot is only visited once.
+    const int64_t first_tick = std::max(wheel_tick, last_tick - TIMER_WHEEL_SLOTS + 1);
+    for (int64_t t = first_tick; t <= last_tick; ++t) {
+        intrusive_list_t<timer_token_t> *slot = &wheel[t % TIMER_WHEEL_SLOTS];
+        timer_token_t *token = slot->head();
+        while (token != nullptr) {
+            timer_token_t *next = slot->next(token);
+            if (ceil_divide(token->next_time_in_nanos, TIMER_WHEEL_TICK_NANOS)
+                    <= last_tick) {
+                slot->remove(token);
+                --wheel_size;
+                token->wheel_list = &wheel_ringing;
+                wheel_ringing.push_back(token);
+            }
+            token = next;
+        }
+    }
+    wheel_tick = last_tick + 1;
+}
+
+int64_t timer_handler_t::next_oneshot_time() {
+    int64_t res = token_queue.empty() ? -1 : token_queue.peek()->next_time_in_nanos;
+    if (wheel_size > 0) {
+        for (int64_t t = wheel_tick; t < wheel_tick + TIMER_WHEEL_SLOTS; ++t) {
+            if (!wheel[t % TIMER_WHEEL_SLOTS].empty()) {
+                const int64_t wheel_time = t * TIMER_WHEEL_TICK_NANOS;
+                if (res == -1 || wheel_time < res) {
+                    res = wheel_time;
+                }
+                break;
+            }
+        }
+    }
+    return res;
 }
 
 void timer_handler_t::on_oneshot() {
@@ -66,9 +139,29 @@ void timer_handler_t::on_oneshot() {
         }
     }
 
+    // The callbacks may cancel tokens that are still in `wheel_ringing`.
+    advance_wheel(ticks);
+    while (!wheel_ringing.empty()) {
+        timer_token_t *token = wheel_ringing.head();
+        wheel_ringing.remove(token);
+        token->wheel_list = nullptr;
+
+        if (token->interval_nanos != 0) {
+            token->next_time_in_nanos = real_ticks + token->interval_nanos;
+            insert_token(token, token->interval_nanos);
+        }
+
+        token->callback->on_timer();
+
+        if (token->interval_nanos == 0) {
+            delete token;
+        }
+    }
+
     // We've processed young tokens.  Now schedule a new one-shot (if necessary).
-    if (!token_queue.empty()) {
-        timer_provider.schedule_oneshot(token_queue.peek()->next_time_in_nanos, this);
+    const int64_t next_time = next_oneshot_time();
+    if (next_time != -1) {
+        timer_provider.schedule_oneshot(next_time, this);
     }
 }
 
@@ -83,21 +176,29 @@ timer_token_t *timer_handler_t::add_timer_internal(const int64_t ms, timer_callb
     token->next_time_in_nanos = next_time_in_nanos;
     token->callback = callback;
 
-    const timer_token_t *top_entry = token_queue.peek();
-    token_queue.push(token);
+    const int64_t old_oneshot_time = next_oneshot_time();
+    insert_token(token, nanos);
+    const int64_t new_oneshot_time = next_oneshot_time();
 
-    if (top_entry == nullptr || next_time_in_nanos < top_entry->next_time_in_nanos) {
-        timer_provider.schedule_oneshot(next_time_in_nanos, this);
+    if (new_oneshot_time != old_oneshot_time) {
+        timer_provider.schedule_oneshot(new_oneshot_time, this);
     }
 
     return token;
 }
 
 void timer_handler_t::cancel_timer(timer_token_t *token) {
-    token_queue.remove(token);
+    if (token->wheel_list == nullptr) {
+        token_queue.remove(token);
+    } else {
+        token->wheel_list->remove(token);
+        if (token->wheel_list != &wheel_ringing) {
+            --wheel_size;
+        }
+    }
     delete token;
 
-    if (token_queue.empty()) {
+    if (token_queue.empty() && wheel_size == 0 && wheel_ringing.empty()) {
         timer_provider.unschedule_oneshot();
     }
 }
@@ -2,6 +2,8 @@
 #ifndef ARCH_TIMER_HPP_
 #define ARCH_TIMER_HPP_
 
+#include "config/args.hpp"
+#include "containers/intrusive_list.hpp"
 #include "containers/intrusive_priority_queue.hpp"
 #include "arch/io/timer_provider.hpp"
 
@@ -26,6 +28,16 @@ public:
 private:
     void on_oneshot();
 
+    // Puts the token into the timer wheel or the priority queue, depending on how far
+    // in the future it rings.
+    void insert_token(timer_token_t *token, int64_t duration_nanos);
+    // Moves the tokens of the wheel slots up to `ticks` that are due to
+    // `wheel_ringing`.
+    void advance_wheel(int64_t ticks);
+    // The time at which `on_oneshot` has to be called next, or -1 if there are no
+    // timers.
+    int64_t next_oneshot_time();
+
     // The timer provider, a platform-dependent typedef for interfacing with the OS.
     timer_provider_t timer_provider;
 
@@ -36,6 +48,15 @@ private:
     // A priority queue of timer tokens, ordered by the soonest.
     intrusive_priority_queue_t<timer_token_t> token_queue;
 
+    // The hashed timer wheel for coarse timers.  A token that rings in wheel tick `t`
+    // is in slot `t % TIMER_WHEEL_SLOTS`, so a slot can hold tokens of several
+    // rotations.  All the ticks before `wheel_tick` have been processed.
+    intrusive_list_t<timer_token_t> wheel[TIMER_WHEEL_SLOTS];
+    int64_t wheel_tick;
+    size_t wheel_size;
+    // The tokens that `on_oneshot` took from the wheel and is calling the callbacks of.
+    intrusive_list_t<timer_token_t> wheel_ringing;
+
     DISABLE_COPYING(timer_handler_t);
 };
 
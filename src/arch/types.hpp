@@ -12,6 +12,7 @@
 
 template <class> class scoped_array_t;
 struct iovec;
+class perfmon_keyed_latency_t;
 
 #define DEFAULT_DISK_ACCOUNT (static_cast<file_account_t *>(0))
 #define UNLIMITED_OUTSTANDING_REQUESTS (-1)
@@ -105,6 +106,14 @@ enum class file_direct_io_mode_t {
     buffered_desired
 };
 
+// Which mechanism the disk manager uses to hand reads and writes to the kernel.  If
+// `uring_desired` is given but io_uring is unavailable, we fall back to the blocker
+// pool.
+enum class disk_backend_mode_t {
+    pool,
+    uring_desired
+};
+
 // A linux file.  It expects reads and writes and buffers to have an
 // alignment of DEVICE_BLOCK_SIZE.
 class file_t {
@@ -127,9 +136,21 @@ public:
     virtual void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
                               file_account_t *account, linux_iocallback_t *cb) = 0;
 
-    virtual void *create_account(int priority, int outstanding_requests_limit) = 0;
+    /* Copies `length` bytes at `offset` out of a read-only memory mapping of the file,
+    if all of them are in the OS page cache. Returns false, without blocking on the
+    disk, if they aren't or if the file can't be mapped; the caller should then use
+    `read_async()`. Unlike `read_async()`, this has no alignment requirements. */
+    virtual bool read_mapped(int64_t offset, size_t length, void *buf) = 0;
+
+    virtual void *create_account(int priority, int outstanding_requests_limit,
+                                 const char *io_class) = 0;
     virtual void destroy_account(void *account) = 0;
 
+    /* Accounts created after this call record the queueing and service times of
+    their operations in the given histograms, keyed by their I/O class. */
+    virtual void set_io_latency_stats(perfmon_keyed_latency_t *queue_latency,
+                                      perfmon_keyed_latency_t *service_latency) = 0;
+
     virtual bool coop_lock_and_check() = 0;
 
 private:
@@ -138,7 +159,10 @@ private:
 
 class file_account_t {
 public:
-    file_account_t(file_t *f, int p, int outstanding_requests_limit = UNLIMITED_OUTSTANDING_REQUESTS);
+    /* `io_class` names the kind of I/O done through the account in the latency
+    stats (see `file_t::set_io_latency_stats()`). It must be a string literal. */
+    file_account_t(file_t *f, int p, const char *io_class,
+                   int outstanding_requests_limit = UNLIMITED_OUTSTANDING_REQUESTS);
     ~file_account_t();
     void *get_account() { return account; }
 
@@ -44,6 +44,15 @@ public:
         *skip_out = false;
     }
 
+    /* Can be overloaded to ignore individual keys. This is called before the key's
+    value is loaded or `handle_pair()` is scheduled, so it's much cheaper than ignoring
+    the key in `handle_pair()`. */
+    virtual void filter_key(
+            UNUSED const btree_key_t *key,
+            bool *skip_out) {
+        *skip_out = false;
+    }
+
     // Passes a keyvalue and a callback.  waiter.wait_interruptible() must be called to
     // begin the region of "exclusive access", which only handle_pair implementation
     // can enters at a time.  (This should happen after loading the value from disk
@@ -1,9 +1,12 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "btree/depth_first_traversal.hpp"
 
+#include <algorithm>
+
 #include "btree/internal_node.hpp"
 #include "btree/operations.hpp"
 #include "concurrency/interruptor.hpp"
+#include "config/args.hpp"
 #include "rdb_protocol/profile.hpp"
 
 scoped_key_value_t::scoped_key_value_t(const btree_key_t *_key,
@@ -180,6 +183,12 @@ continue_bool_t btree_depth_first_traversal(
             r.decrement();
             end_index = internal_node::get_offset_index(inode, r.btree_key()) + 1;
         }
+        // State for prefetching the children ahead of a sequential read scan.  The
+        // children with loop indices below `prefetched_until` have been prefetched
+        // already.
+        int sequential_run = 0;
+        int prefetch_batch = BTREE_PREFETCH_MIN_BATCH;
+        int prefetched_until = 0;
         for (int i = 0; i < end_index - start_index; ++i) {
             int true_index = (direction == FORWARD ? start_index + i : (end_index - 1) - i);
             const btree_internal_pair *pair = internal_node::get_pair_by_index(inode, true_index);
@@ -195,7 +204,34 @@ continue_bool_t btree_depth_first_traversal(
                     child_left_excl_or_null, child_right_incl, interruptor, &skip)) {
                 return continue_bool_t::ABORT;
             }
-            if (!skip) {
+            if (skip) {
+                sequential_run = 0;
+                prefetch_batch = BTREE_PREFETCH_MIN_BATCH;
+            } else {
+                ++sequential_run;
+                if (access == access_t::read
+                    && sequential_run >= BTREE_PREFETCH_SEQUENTIAL_THRESHOLD
+                    && i + 1 >= prefetched_until) {
+                    if (prefetched_until > i) {
+                        // We caught up with the previous batch, so the scan is
+                        // still going.
+                        prefetch_batch = std::min(2 * prefetch_batch,
+                                                  BTREE_PREFETCH_MAX_BATCH);
+                    }
+                    const int prefetch_end = std::min(i + 1 + prefetch_batch,
+                                                      end_index - start_index);
+                    for (int j = std::max(i + 1, prefetched_until);
+                         j < prefetch_end;
+                         ++j) {
+                        const int true_j = (direction == FORWARD
+                                            ? start_index + j
+                                            : (end_index - 1) - j);
+                        block->lock.txn()->prefetch_block(
+                            internal_node::get_pair_by_index(inode, true_j)->lnode);
+                    }
+                    prefetched_until = prefetch_end;
+                }
+
                 counted_t<counted_buf_lock_and_read_t> lock;
                 {
                     PROFILE_STARTER_IF_ENABLED(
@@ -357,7 +357,28 @@ btree_internal_pair *get_pair_by_index(internal_node_t *node, int index) {
 }
 
 int get_offset_index(const internal_node_t *node, const btree_key_t *key) {
-    return std::lower_bound(node->pair_offsets, node->pair_offsets+node->npairs-1, (uint16_t) internal_key_comp::faux_offset, internal_key_comp(node, key)) - node->pair_offsets;
+    // Finds the first pair (not counting the special last pair) whose key is not less
+    // than `key`.  `beg_prefix` and `end_prefix` are the lengths of the prefixes
+    // `key` shares with the keys just outside of [beg, end), which every key in
+    // between shares too.
+    int beg = 0;
+    int end = node->npairs - 1;
+    int beg_prefix = 0;
+    int end_prefix = 0;
+    while (beg < end) {
+        const int test_point = beg + (end - beg) / 2;
+        int common_prefix = std::min(beg_prefix, end_prefix);
+        const int res = btree_key_cmp_after_prefix(
+            key, &get_pair_by_index(node, test_point)->key, &common_prefix);
+        if (res > 0) {
+            beg = test_point + 1;
+            beg_prefix = common_prefix;
+        } else {
+            end = test_point;
+            end_prefix = common_prefix;
+        }
+    }
+    return beg;
 }
 
 int nodecmp(const internal_node_t *node1, const internal_node_t *node2) {
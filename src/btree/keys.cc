@@ -23,6 +23,37 @@ int sized_strcmp(const uint8_t *str1, int len1, const uint8_t *str2, int len2) {
     return res;
 }
 
+int btree_key_cmp_after_prefix(const btree_key_t *left, const btree_key_t *right,
+                               int *common_prefix_inout) {
+    const int min_len = std::min(left->size, right->size);
+    int i = *common_prefix_inout;
+    rassert(i <= min_len);
+    rassert(memcmp(left->contents, right->contents, i) == 0);
+
+    // Look for the first mismatch eight bytes at a time.
+    while (i + static_cast<int>(sizeof(uint64_t)) <= min_len) {
+        uint64_t l, r;
+        memcpy(&l, left->contents + i, sizeof(uint64_t));
+        memcpy(&r, right->contents + i, sizeof(uint64_t));
+        if (l != r) {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            i += __builtin_ctzll(l ^ r) / 8;
+#endif
+            break;
+        }
+        i += sizeof(uint64_t);
+    }
+    while (i < min_len && left->contents[i] == right->contents[i]) {
+        ++i;
+    }
+
+    *common_prefix_inout = i;
+    if (i < min_len) {
+        return static_cast<int>(left->contents[i]) - static_cast<int>(right->contents[i]);
+    }
+    return static_cast<int>(left->size) - static_cast<int>(right->size);
+}
+
 bool unescaped_str_to_key(const char *str, int len, store_key_t *buf) {
     if (len <= MAX_KEY_SIZE) {
         memcpy(buf->contents(), str, len);
@@ -52,6 +52,14 @@ inline int btree_key_cmp(const btree_key_t *left, const btree_key_t *right) {
     return sized_strcmp(left->contents, left->size, right->contents, right->size);
 }
 
+/* Compares `left` and `right` like `btree_key_cmp`, given that their first
+`*common_prefix_inout` bytes are already known to be equal, and sets
+`*common_prefix_inout` to the length of their longest common prefix.  Binary
+searches through a node use this to avoid comparing the prefix that the search
+key shares with both ends of the remaining range over and over again. */
+int btree_key_cmp_after_prefix(const btree_key_t *left, const btree_key_t *right,
+                               int *common_prefix_inout);
+
 struct store_key_t {
 public:
     store_key_t() {
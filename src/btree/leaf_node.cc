@@ -2,6 +2,7 @@
 #include "btree/leaf_node.hpp"
 
 #include <inttypes.h>
+#include <string.h>
 
 #include <algorithm>
 #include <set>
@@ -960,6 +961,29 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     validate(sizer, tow);
 }
 
+// Sets `*separator_out` to the shortest key that is greater than or equal to `left`
+// but less than `right`, where `left` is the last key of a leaf node and `right` the
+// first key of its right sibling.  The parent node only needs some key between the
+// two, and shorter keys there mean a higher fanout in the internal nodes.  This
+// matters most for secondary indexes, whose keys tend to be long but differ early.
+void shortest_separator(const btree_key_t *left, const btree_key_t *right,
+                        btree_key_t *separator_out) {
+    rassert(btree_key_cmp(left, right) < 0);
+    int common = 0;
+    while (common < left->size && common < right->size
+           && left->contents[common] == right->contents[common]) {
+        ++common;
+    }
+    if (common < left->size && common + 1 < right->size) {
+        // `right` truncated just past the first differing byte is bigger than `left`
+        // and, being a proper prefix, smaller than `right`.
+        separator_out->size = common + 1;
+        memcpy(separator_out->contents, right->contents, common + 1);
+    } else {
+        keycpy(separator_out, left);
+    }
+}
+
 void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_key_t *median_out) {
     int tstamp_back_offset;
     int mandatory = mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS, &tstamp_back_offset);
@@ -1033,7 +1057,31 @@ void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_ke
     move_elements(sizer, node, s, node->num_pairs, 0, rnode, node_copysize,
                   tstamp_back_offset, nullptr);
 
-    keycpy(median_out, entry_key(get_entry(node, node->pair_offsets[s - 1])));
+    shortest_separator(entry_key(get_entry(node, node->pair_offsets[s - 1])),
+                       entry_key(get_entry(rnode, rnode->pair_offsets[0])),
+                       median_out);
+}
+
+bool is_past_last_key(const leaf_node_t *node, const btree_key_t *key) {
+    if (node->num_pairs == 0) {
+        return false;
+    }
+    const btree_key_t *last
+        = entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1]));
+    return btree_key_cmp(key, last) > 0;
+}
+
+void split_for_append(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode,
+                      btree_key_t *median_out) {
+    guarantee(node->num_pairs > 0);
+    guarantee(mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS)
+              >= free_space(sizer) - leaf_epsilon(sizer));
+
+    // Everything stays in `node`.  The key that is about to be inserted sorts after
+    // the median, so it goes into the empty `rnode`.
+    init(sizer, rnode);
+    keycpy(median_out,
+           entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1])));
 }
 
 void merge(value_sizer_t *sizer, leaf_node_t *left, leaf_node_t *right) {
@@ -1165,9 +1213,15 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
     guarantee(sibling->num_pairs > 0);
 
     if (nodecmp_node_with_sib < 0) {
-        keycpy(replacement_key_out, entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1])));
+        shortest_separator(
+            entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1])),
+            entry_key(get_entry(sibling, sibling->pair_offsets[0])),
+            replacement_key_out);
     } else {
-        keycpy(replacement_key_out, entry_key(get_entry(sibling, sibling->pair_offsets[sibling->num_pairs - 1])));
+        shortest_separator(
+            entry_key(get_entry(sibling, sibling->pair_offsets[sibling->num_pairs - 1])),
+            entry_key(get_entry(node, node->pair_offsets[0])),
+            replacement_key_out);
     }
 
     return true;
@@ -1187,20 +1241,28 @@ bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
     // beg == 0 or key > *(beg - 1).
     // end == num_pairs or key < *end.
 
+    // The lengths of the prefixes that key shares with *(beg - 1) and *end.  Every
+    // key in between shares at least the shorter of the two.
+    int beg_prefix = 0;
+    int end_prefix = 0;
+
     while (beg < end) {
         // when (end - beg) > 0, (end - beg) / 2 is always less than (end - beg).  So beg <= test_point < end.
         int test_point = beg + (end - beg) / 2;
 
         const btree_key_t *ek = entry_key(get_entry(node, node->pair_offsets[test_point]));
 
-        int res = btree_key_cmp(key, ek);
+        int common_prefix = std::min(beg_prefix, end_prefix);
+        int res = btree_key_cmp_after_prefix(key, ek, &common_prefix);
 
         if (res < 0) {
             // key < *test_point.
             end = test_point;
+            end_prefix = common_prefix;
         } else if (res > 0) {
             // key > *test_point.  Since test_point < end, we have test_point + 1 <= end.
             beg = test_point + 1;
+            beg_prefix = common_prefix;
         } else {
             // We found the key!
             *index_out = test_point;
@@ -131,6 +131,18 @@ bool is_underfull(value_sizer_t *sizer, const leaf_node_t *node);
 void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *sibling,
            btree_key_t *median_out);
 
+// Returns true if `key` sorts after every entry (live or deleted) in `node`.
+bool is_past_last_key(const leaf_node_t *node, const btree_key_t *key);
+
+// A split for keys that are inserted in ascending order, as in a bulk load of
+// presorted data.  Instead of halving the full `node`, it leaves every entry where it
+// is and starts the empty `sibling`, so that such a load fills its leaves completely
+// rather than leaving each of them half empty.  The caller must only use it when the
+// key that is about to be inserted satisfies `is_past_last_key`.  `sibling` stays
+// underfull until it receives more keys.
+void split_for_append(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *sibling,
+                      btree_key_t *median_out);
+
 void merge(value_sizer_t *sizer, leaf_node_t *left, leaf_node_t *right);
 
 // The pointers in `moved_values_out` point to positions in `node` and
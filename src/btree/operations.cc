@@ -23,6 +23,25 @@ block_id_t create_stat_block(buf_parent_t parent) {
     return stats_block.block_id();
 }
 
+bool get_btree_population(superblock_t *superblock, int64_t *population_out) {
+    const block_id_t stat_block_id = superblock->get_stat_block_id();
+    if (stat_block_id == NULL_BLOCK_ID) {
+        return false;
+    }
+    // The stat block isn't part of the btree's block tree, so like in
+    // `apply_keyvalue_change()` the txn is its parent.  We still hold the superblock,
+    // so no write that comes after us can have touched it yet.
+    buf_lock_t stat_block(buf_parent_t(superblock->expose_buf().txn()),
+                          stat_block_id, access_t::read);
+    buf_read_t read(&stat_block);
+    uint32_t stat_block_size;
+    auto stat_block_buf = static_cast<const btree_statblock_t *>(
+        read.get_data_read(&stat_block_size));
+    guarantee(stat_block_size == BTREE_STATBLOCK_SIZE);
+    *population_out = stat_block_buf->population;
+    return true;
+}
+
 buf_lock_t get_root(value_sizer_t *sizer, superblock_t *sb) {
     const block_id_t node_id = sb->get_root_block_id();
 
@@ -73,6 +92,9 @@ void check_and_handle_split(value_sizer_t *sizer,
                             superblock_t *sb,
                             const btree_key_t *key, void *new_value,
                             const value_deleter_t *detacher) {
+    // Set if `key` goes after everything in the full leaf, which is what inserting
+    // presorted keys looks like.  We don't halve the leaf in that case.
+    bool is_append = false;
     {
         buf_read_t buf_read(buf);
         const node_t *node = static_cast<const node_t *>(buf_read.get_data_read());
@@ -80,10 +102,11 @@ void check_and_handle_split(value_sizer_t *sizer,
         // If the node isn't full, we don't need to split, so we're done.
         if (!node::is_internal(node)) { // This should only be called when update_needed.
             rassert(new_value);
-            if (!leaf::is_full(sizer, reinterpret_cast<const leaf_node_t *>(node),
-                               key, new_value)) {
+            const leaf_node_t *leaf_node = reinterpret_cast<const leaf_node_t *>(node);
+            if (!leaf::is_full(sizer, leaf_node, key, new_value)) {
                 return;
             }
+            is_append = leaf::is_past_last_key(leaf_node, key);
         } else {
             rassert(!new_value);
             if (!internal_node::is_full(reinterpret_cast<const internal_node_t *>(node))) {
@@ -109,10 +132,18 @@ void check_and_handle_split(value_sizer_t *sizer,
     {
         buf_write_t buf_write(buf);
         buf_write_t rbuf_write(&rbuf);
-        node::split(sizer,
-                    static_cast<node_t *>(buf_write.get_data_write()),
-                    static_cast<node_t *>(rbuf_write.get_data_write()),
-                    median);
+        if (is_append) {
+            leaf::split_for_append(sizer,
+                                   static_cast<leaf_node_t *>(buf_write.get_data_write()),
+                                   static_cast<leaf_node_t *>(
+                                       rbuf_write.get_data_write()),
+                                   median);
+        } else {
+            node::split(sizer,
+                        static_cast<node_t *>(buf_write.get_data_write()),
+                        static_cast<node_t *>(rbuf_write.get_data_write()),
+                        median);
+        }
 
         // We must detach all entries that we have removed from `buf`.
         buf_read_t rbuf_read(&rbuf);
@@ -653,9 +684,13 @@ void apply_keyvalue_change(
     }
 
     // Check to see if the leaf is underfull (following a change in
-    // size or a deletion, and merge/level if it is.
-    check_and_handle_underfull(sizer, &kv_loc->buf, &kv_loc->last_buf,
-                               kv_loc->superblock, key, balancing_detacher);
+    // size or a deletion, and merge/level if it is.  Inserting a new key only grows
+    // the leaf, so we skip the check then; this is what lets a leaf that was started
+    // by `split_for_append` fill up instead of getting leveled right away.
+    if (population_change != 1) {
+        check_and_handle_underfull(sizer, &kv_loc->buf, &kv_loc->last_buf,
+                                   kv_loc->superblock, key, balancing_detacher);
+    }
 
     // Modify the stats block.  The stats block is detached from the rest of the
     // btree, we don't keep a consistent view of it, so we pass the txn as its
@@ -192,6 +192,11 @@ void insert_root(block_id_t root_id, superblock_t *sb);
 `get_stat_block_id()`. */
 block_id_t create_stat_block(buf_parent_t parent);
 
+/* Reads the number of keys in the btree from its stat block. Returns `false` if the
+btree doesn't have a stat block. The stat block is updated by every insertion and
+deletion that goes through `apply_keyvalue_change()`, so the count is exact. */
+bool get_btree_population(superblock_t *superblock, int64_t *population_out);
+
 /* Note that there's no guarantee that `pass_back_superblock` will have been
  * pulsed by the time `find_keyvalue_location_for_write` returns. In some cases,
  * the superblock is returned only when `*keyvalue_location_out` gets destructed. */
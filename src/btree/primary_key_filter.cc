@@ -0,0 +1,111 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "btree/primary_key_filter.hpp"
+
+#include <algorithm>
+#include <string>
+
+#include "btree/keys.hpp"
+#include "config/args.hpp"
+
+namespace {
+
+// Spread `std::hash` over all bits like `hot_keys_t::add` does, and derive the bit
+// positions from its two halves.
+void key_hashes(const store_key_t &key, uint64_t *h1_out, uint64_t *h2_out) {
+    const std::string str(reinterpret_cast<const char *>(key.contents()), key.size());
+    uint64_t hash = std::hash<std::string>()(str);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    *h1_out = hash & 0xffffffff;
+    *h2_out = (hash >> 32) | 1;
+}
+
+}  // namespace
+
+bloom_filter_t::bloom_filter_t(uint64_t capacity)
+    : bits(std::max<uint64_t>(
+          1, (capacity * PRIMARY_KEY_FILTER_BITS_PER_KEY + 63) / 64), 0),
+      capacity_(capacity),
+      size_(0) { }
+
+void bloom_filter_t::add(const store_key_t &key) {
+    uint64_t h1, h2;
+    key_hashes(key, &h1, &h2);
+    const uint64_t num_bits = bits.size() * 64;
+    bool added = false;
+    for (uint64_t i = 0; i < PRIMARY_KEY_FILTER_NUM_HASHES; ++i) {
+        const uint64_t bit = (h1 + i * h2) % num_bits;
+        const uint64_t mask = uint64_t(1) << (bit % 64);
+        if ((bits[bit / 64] & mask) == 0) {
+            bits[bit / 64] |= mask;
+            added = true;
+        }
+    }
+    if (added) {
+        ++size_;
+    }
+}
+
+bool bloom_filter_t::may_contain(const store_key_t &key) const {
+    uint64_t h1, h2;
+    key_hashes(key, &h1, &h2);
+    const uint64_t num_bits = bits.size() * 64;
+    for (uint64_t i = 0; i < PRIMARY_KEY_FILTER_NUM_HASHES; ++i) {
+        const uint64_t bit = (h1 + i * h2) % num_bits;
+        if ((bits[bit / 64] & (uint64_t(1) << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+primary_key_filter_t::primary_key_filter_t(const std::function<void()> &_on_full)
+    : on_full(_on_full), rebuild_requested(false) { }
+
+void primary_key_filter_t::add(const store_key_t &key) {
+    assert_thread();
+    if (building.has()) {
+        building->add(key);
+    }
+    if (ready.has()) {
+        ready->add(key);
+        if (ready->is_full() && !building.has() && !rebuild_requested) {
+            rebuild_requested = true;
+            on_full();
+        }
+    }
+}
+
+bool primary_key_filter_t::may_contain(const store_key_t &key) const {
+    assert_thread();
+    return !ready.has() || ready->may_contain(key);
+}
+
+uint64_t primary_key_filter_t::size() const {
+    assert_thread();
+    return ready.has() ? ready->size() : 0;
+}
+
+void primary_key_filter_t::start_build(uint64_t capacity) {
+    assert_thread();
+    building.init(new bloom_filter_t(capacity));
+    rebuild_requested = false;
+}
+
+void primary_key_filter_t::add_scanned(const store_key_t &key) {
+    assert_thread();
+    building->add(key);
+}
+
+bool primary_key_filter_t::finish_build() {
+    assert_thread();
+    if (building->is_full()) {
+        building.reset();
+        return false;
+    }
+    ready = std::move(building);
+    return true;
+}
@@ -0,0 +1,76 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef BTREE_PRIMARY_KEY_FILTER_HPP_
+#define BTREE_PRIMARY_KEY_FILTER_HPP_
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "containers/scoped.hpp"
+#include "threading.hpp"
+
+struct store_key_t;
+
+/* A bloom filter (Bloom, 1970) with `PRIMARY_KEY_FILTER_BITS_PER_KEY` bits for each of
+the `capacity` keys it's made for.  Every key sets `PRIMARY_KEY_FILTER_NUM_HASHES` of
+them, and a key whose bits aren't all set was never added. */
+class bloom_filter_t {
+public:
+    explicit bloom_filter_t(uint64_t capacity);
+
+    void add(const store_key_t &key);
+    bool may_contain(const store_key_t &key) const;
+
+    uint64_t capacity() const { return capacity_; }
+    // How many of the added keys set a bit that wasn't set yet.  Adding a key again
+    // doesn't count, so this is a slight underestimate of the distinct keys.
+    uint64_t size() const { return size_; }
+    bool is_full() const { return size_ > capacity_; }
+
+private:
+    std::vector<uint64_t> bits;
+    uint64_t capacity_;
+    uint64_t size_;
+};
+
+/* With `--primary-key-filter`, every `store_t` keeps a `primary_key_filter_t` of the
+keys in its primary B-tree, so that point reads of keys that aren't there can be
+answered without going down to a leaf.  When the table is opened, a scan of the B-tree
+builds the filter in the background, and until it's done, `may_contain()` is always
+true.  The writes that might add a key to the B-tree add it here before they release
+the superblock, so a read that gets the superblock after them can't miss it.
+
+Deletions don't take the keys out again, which just lets more absent keys through.
+Once `is_full()` gets true because the filter holds more keys than it's made for,
+`on_full` gets called so that a bigger one gets built by another scan.  The old filter
+keeps answering until then. */
+class primary_key_filter_t : public home_thread_mixin_debug_only_t {
+public:
+    explicit primary_key_filter_t(const std::function<void()> &on_full);
+
+    void add(const store_key_t &key);
+    bool may_contain(const store_key_t &key) const;
+
+    // How many keys the filter that answers holds, or 0 if there's none yet.
+    uint64_t size() const;
+
+    // For the scan of the B-tree.  The filter started by `start_build()` gets all the
+    // keys that `add()` gets from then on, and `finish_build()` makes it the one that
+    // answers.  If it turned out to be too small, `finish_build()` returns false and
+    // it has to be started again.
+    void start_build(uint64_t capacity);
+    void add_scanned(const store_key_t &key);
+    MUST_USE bool finish_build();
+
+private:
+    std::function<void()> on_full;
+    scoped_ptr_t<bloom_filter_t> ready;
+    scoped_ptr_t<bloom_filter_t> building;
+    // Whether `on_full` was called and we're waiting for the next `start_build()`
+    bool rebuild_requested;
+
+    DISABLE_COPYING(primary_key_filter_t);
+};
+
+#endif  // BTREE_PRIMARY_KEY_FILTER_HPP_
@@ -181,8 +181,10 @@ btree_slice_t::btree_slice_t(cache_t *c, perfmon_collection_t *parent,
                              index_type_t index_type)
     : stats(parent,
             (index_type == index_type_t::SECONDARY ? "index-" : "") + identifier),
+      primary_key_filter(nullptr),
       cache_(c),
-      backfill_account_(cache()->create_cache_account(BACKFILL_CACHE_PRIORITY)) { }
+      backfill_account_(cache()->create_cache_account(BACKFILL_CACHE_PRIORITY,
+                                                        "backfill")) { }
 
 btree_slice_t::~btree_slice_t() { }
 
@@ -15,6 +15,7 @@ metainfo, which are unrelated to the B-tree but stored on the ReQL primary super
 They should probably be moved out of the `btree/` directory. */
 
 class binary_blob_t;
+class primary_key_filter_t;
 
 /* `real_superblock_t` represents the superblock for the primary B-tree of a table. */
 class real_superblock_t : public superblock_t {
@@ -100,6 +101,10 @@ public:
 
     btree_stats_t stats;
 
+    // The filter that the writes to a primary B-tree add their keys to, if the store
+    // has one.  See `primary_key_filter_t`.
+    primary_key_filter_t *primary_key_filter;
+
 private:
     cache_t *cache_;
 
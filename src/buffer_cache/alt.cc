@@ -2,6 +2,7 @@
 
 #include <stack>
 
+#include "arch/timing.hpp"
 #include "arch/types.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "buffer_cache/stats.hpp"
@@ -30,6 +31,19 @@ const double SOFT_UNWRITTEN_CHANGES_MEMORY_FRACTION = 0.5;
 // proportionally to the unwritten block changes limit
 const int64_t INDEX_CHANGES_LIMIT_FACTOR = 5;
 
+// Rather than letting writes run freely until the unwritten block changes limit is
+// hit and then blocking all of them until a flush catches up, we start delaying new
+// write transactions once the number of unwritten block changes exceeds this
+// fraction of the limit.  The delay grows linearly with the excess, up to the time
+// the page cache needs to flush the transaction's changes at the measured flush
+// throughput, so that the dirty page level settles around the target.
+const double THROTTLE_TARGET_UNWRITTEN_CHANGES_FRACTION = 0.5;
+// The weight of a new sample in the moving average of the flush throughput.
+const double FLUSH_THROUGHPUT_SMOOTHING_FACTOR = 0.2;
+// Caps the delay of a single transaction, so that a temporarily slow flush doesn't
+// stall writes for too long.  (The semaphores still bound the dirty data.)
+const double MAX_THROTTLE_DELAY_SECS = 0.1;
+
 // There are very few ASSERT_NO_CORO_WAITING calls (instead we have
 // ASSERT_FINITE_CORO_WAITING) because most of the time we're at the mercy of the
 // page cache, which often may need to load or evict blocks, which may involve a
@@ -64,6 +78,8 @@ private:
 
 alt_txn_throttler_t::alt_txn_throttler_t(int64_t minimum_unwritten_changes_limit)
     : minimum_unwritten_changes_limit_(minimum_unwritten_changes_limit),
+      flushed_changes_per_sec_(0),
+      pending_delay_secs_(0),
       unwritten_block_changes_semaphore_(SOFT_UNWRITTEN_CHANGES_LIMIT),
       unwritten_index_changes_semaphore_(
           SOFT_UNWRITTEN_CHANGES_LIMIT * INDEX_CHANGES_LIMIT_FACTOR) { }
@@ -71,6 +87,13 @@ alt_txn_throttler_t::alt_txn_throttler_t(int64_t minimum_unwritten_changes_limit
 alt_txn_throttler_t::~alt_txn_throttler_t() { }
 
 throttler_acq_t alt_txn_throttler_t::begin_txn_or_throttle(int64_t expected_change_count) {
+    pending_delay_secs_ += compute_txn_delay(expected_change_count);
+    if (pending_delay_secs_ >= 0.001) {
+        const int64_t delay_ms = static_cast<int64_t>(pending_delay_secs_ * 1000);
+        pending_delay_secs_ = 0;
+        nap(delay_ms);
+    }
+
     throttler_acq_t acq;
     acq.index_changes_semaphore_acq_.init(
         &unwritten_index_changes_semaphore_,
@@ -87,6 +110,36 @@ void alt_txn_throttler_t::end_txn(UNUSED throttler_acq_t acq) {
     // Just let the acq destructor do its thing.
 }
 
+void alt_txn_throttler_t::inform_changes_flushed(int64_t change_count,
+                                                 ticks_t flush_duration) {
+    const double secs = ticks_to_secs(flush_duration);
+    if (change_count <= 0 || secs <= 0) {
+        return;
+    }
+    const double sample = change_count / secs;
+    if (flushed_changes_per_sec_ == 0) {
+        flushed_changes_per_sec_ = sample;
+    } else {
+        flushed_changes_per_sec_ += FLUSH_THROUGHPUT_SMOOTHING_FACTOR
+            * (sample - flushed_changes_per_sec_);
+    }
+}
+
+double alt_txn_throttler_t::compute_txn_delay(int64_t expected_change_count) const {
+    if (flushed_changes_per_sec_ == 0 || expected_change_count <= 0) {
+        return 0;
+    }
+    const double capacity = unwritten_block_changes_semaphore_.capacity();
+    const double target = capacity * THROTTLE_TARGET_UNWRITTEN_CHANGES_FRACTION;
+    const double current = unwritten_block_changes_semaphore_.current();
+    if (current <= target || capacity <= target) {
+        return 0;
+    }
+    const double excess = std::min(1.0, (current - target) / (capacity - target));
+    return std::min(MAX_THROTTLE_DELAY_SECS,
+                    excess * expected_change_count / flushed_changes_per_sec_);
+}
+
 void alt_txn_throttler_t::inform_memory_limit_change(uint64_t memory_limit,
                                                      const block_size_t max_block_size) {
     int64_t throttler_limit = std::min<int64_t>(SOFT_UNWRITTEN_CHANGES_LIMIT,
@@ -111,8 +164,30 @@ cache_t::~cache_t() {
     guarantee(snapshot_nodes_by_block_id_.empty());
 }
 
-cache_account_t cache_t::create_cache_account(int priority) {
-    return page_cache_.create_cache_account(priority);
+void cache_t::set_memory_bounds(uint64_t memory_reservation,
+                                uint64_t max_memory_limit) {
+    assert_thread();
+    page_cache_.evicter().set_memory_bounds(memory_reservation, max_memory_limit);
+}
+
+std::vector<block_id_t> cache_t::hot_block_ids(size_t max_count) const {
+    assert_thread();
+    return page_cache_.hot_block_ids(max_count);
+}
+
+void cache_t::warm_up(const std::vector<block_id_t> &block_ids, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+    page_cache_.warm_up(block_ids, interruptor);
+}
+
+bool cache_t::snapshot_memory_limit_exceeded() {
+    assert_thread();
+    return page_cache_.evicter().snapshot_memory_limit_exceeded();
+}
+
+cache_account_t cache_t::create_cache_account(int priority, const char *io_class) {
+    return page_cache_.create_cache_account(priority, io_class);
 }
 
 alt_snapshot_node_t *
@@ -190,6 +265,7 @@ txn_t::txn_t(cache_conn_t *cache_conn,
              read_access_t)
     : cache_(cache_conn->cache()),
       cache_account_(cache_->page_cache_.default_reads_account()),
+      read_stats_(nullptr),
       access_(access_t::read),
       durability_(write_durability_t::SOFT),
       is_committed_(false) {
@@ -204,6 +280,7 @@ txn_t::txn_t(cache_conn_t *cache_conn,
              int64_t expected_change_count)
     : cache_(cache_conn->cache()),
       cache_account_(cache_->page_cache_.default_reads_account()),
+      read_stats_(nullptr),
       access_(access_t::write),
       durability_(durability),
       is_committed_(false) {
@@ -238,6 +315,14 @@ void txn_t::inform_tracker(cache_t *cache, throttler_acq_t *throttler_acq) {
     cache->throttler_.end_txn(std::move(*throttler_acq));
 }
 
+void txn_t::record_soft_flush_and_inform_tracker(cache_t *cache,
+                                                 ticks_t commit_ticks,
+                                                 throttler_acq_t *throttler_acq) {
+    cache->stats_->soft_durability_flush_latency.record_ticks(
+        get_ticks() - commit_ticks);
+    inform_tracker(cache, throttler_acq);
+}
+
 void txn_t::pulse_and_inform_tracker(cache_t *cache,
                                      throttler_acq_t *throttler_acq,
                                      cond_t *pulsee) {
@@ -264,8 +349,9 @@ void txn_t::commit() {
 
     if (durability_ == write_durability_t::SOFT) {
         cache_->page_cache_.flush_and_destroy_txn(std::move(page_txn_),
-            std::bind(&txn_t::inform_tracker,
+            std::bind(&txn_t::record_soft_flush_and_inform_tracker,
                 cache_,
+                get_ticks(),
                 ph::_1));
     } else {
         cond_t cond;
@@ -281,6 +367,10 @@ void txn_t::set_account(cache_account_t *cache_account) {
     cache_account_ = cache_account;
 }
 
+bool txn_t::prefetch_block(block_id_t block_id) {
+    return cache_->page_cache_.prefetch_block(block_id, cache_account_);
+}
+
 
 alt_snapshot_node_t::alt_snapshot_node_t(scoped_ptr_t<current_page_acq_t> &&acq)
     : current_page_acq_(std::move(acq)), ref_count_(0) { }
@@ -813,6 +903,23 @@ const void *buf_read_t::get_data_read(uint32_t *block_size_out) {
     if (!page_acq_.has()) {
         page_acq_.init(page, &lock_->cache()->page_cache_,
                        lock_->txn()->account());
+        // The signal is pulsed right away if the block is in memory.
+        const bool in_cache = page_acq_.buf_ready_signal()->is_pulsed();
+        if (!in_cache) {
+            const ticks_t start_ticks = get_ticks();
+            page_acq_.buf_ready_signal()->wait();
+            lock_->cache()->stats_->miss_latency.record_ticks(
+                get_ticks() - start_ticks);
+        }
+        txn_read_stats_t *read_stats = lock_->txn()->read_stats();
+        if (read_stats != nullptr) {
+            const uint32_t size = page_acq_.get_buf_size().value();
+            if (in_cache) {
+                read_stats->cache_bytes_read += size;
+            } else {
+                read_stats->disk_bytes_read += size;
+            }
+        }
     }
     page_acq_.buf_ready_signal()->wait();
     *block_size_out = page_acq_.get_buf_size().value();
@@ -10,6 +10,7 @@
 #include "buffer_cache/types.hpp"
 #include "containers/two_level_array.hpp"
 #include "repli_timestamp.hpp"
+#include "time.hpp"
 
 class serializer_t;
 
@@ -30,9 +31,26 @@ public:
     void inform_memory_limit_change(uint64_t memory_limit,
                                     block_size_t max_block_size);
 
+    // Called by the page cache after it has flushed `change_count` block changes,
+    // which took `flush_duration` ticks.
+    void inform_changes_flushed(int64_t change_count, ticks_t flush_duration);
+
 private:
+    // Returns how long (in seconds) a new transaction with `expected_change_count`
+    // changes should be delayed so that write transactions get admitted at about the
+    // rate at which the page cache manages to flush them.
+    double compute_txn_delay(int64_t expected_change_count) const;
+
     const int64_t minimum_unwritten_changes_limit_;
 
+    // An exponential moving average of the measured flush throughput, in block
+    // changes per second.  Zero until the first flush has completed.
+    double flushed_changes_per_sec_;
+
+    // Delays too short to `nap()` for accumulate here, so that they still slow down
+    // writes in aggregate.
+    double pending_delay_secs_;
+
     new_semaphore_t unwritten_block_changes_semaphore_;
     new_semaphore_t unwritten_index_changes_semaphore_;
 
@@ -48,12 +66,25 @@ public:
 
     max_block_size_t max_block_size() const { return page_cache_.max_block_size(); }
 
+    // Bounds how much memory the cache balancer gives to this cache.  Pass
+    // `UINT64_MAX` as `max_memory_limit` if there is no upper bound.
+    void set_memory_bounds(uint64_t memory_reservation, uint64_t max_memory_limit);
+
+    // See `page_cache_t::hot_block_ids()` and `page_cache_t::warm_up()`.
+    std::vector<block_id_t> hot_block_ids(size_t max_count) const;
+    void warm_up(const std::vector<block_id_t> &block_ids, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
+    // Whether snapshotted reads should start over with a new snapshot at the next
+    // opportunity, see `evicter_t::snapshot_memory_limit_exceeded()`.
+    bool snapshot_memory_limit_exceeded();
+
     // These todos come from the mirrored cache.  The real problem is that whole
     // cache account / priority thing is just one ghetto hack amidst a dozen other
     // throttling systems.  TODO: Come up with a consistent priority scheme,
     // i.e. define a "default" priority etc.  TODO: As soon as we can support it, we
     // might consider supporting a mem_cap paremeter.
-    cache_account_t create_cache_account(int priority);
+    cache_account_t create_cache_account(int priority, const char *io_class);
 
 private:
     friend class txn_t;
@@ -79,6 +110,16 @@ private:
     DISABLE_COPYING(cache_t);
 };
 
+/* Counts how many bytes of blocks a transaction read and whether they were in the cache
+already.  The cache accounts are shared by everything that reads from a table, so
+per-query stats have to be kept on the transaction instead.  See
+`txn_t::set_read_stats()`. */
+struct txn_read_stats_t {
+    txn_read_stats_t() : cache_bytes_read(0), disk_bytes_read(0) { }
+    uint64_t cache_bytes_read;
+    uint64_t disk_bytes_read;
+};
+
 class txn_t {
 public:
     // Constructor for read-only transactions.
@@ -103,11 +144,28 @@ public:
     void set_account(cache_account_t *cache_account);
     cache_account_t *account() { return cache_account_; }
 
+    // If `read_stats` isn't null, every `buf_read_t` of this transaction adds the size
+    // of the block it reads to it.
+    void set_read_stats(txn_read_stats_t *read_stats) { read_stats_ = read_stats; }
+    txn_read_stats_t *read_stats() { return read_stats_; }
+
+    // Hints that the block will probably be acquired soon, so that the cache can
+    // start loading it now, using this transaction's cache account.  Returns true
+    // if that started a load.
+    bool prefetch_block(block_id_t block_id);
+
 private:
     // Resets the *throttler_acq parameter.
     static void inform_tracker(cache_t *cache,
                                alt::throttler_acq_t *throttler_acq);
 
+    // Resets the *throttler_acq parameter.  Also records for how long the soft
+    // durability transaction committed at `commit_ticks` was acknowledged but not
+    // yet on disk.
+    static void record_soft_flush_and_inform_tracker(cache_t *cache,
+                                                     ticks_t commit_ticks,
+                                                     alt::throttler_acq_t *throttler_acq);
+
     // Resets the *throttler_acq parameter.
     static void pulse_and_inform_tracker(cache_t *cache,
                                          alt::throttler_acq_t *throttler_acq,
@@ -122,6 +180,8 @@ private:
     // set_account().
     cache_account_t *cache_account_;
 
+    txn_read_stats_t *read_stats_;
+
     const access_t access_;
 
     // Only applicable if access_ == write.
@@ -230,6 +290,12 @@ public:
         return current_page_acq()->write_acq_signal();
     }
 
+    // See `current_page_acq_t::set_lock_class()`.
+    void set_lock_class(lock_class_t lock_class) {
+        guarantee(!empty());
+        current_page_acq()->set_lock_class(lock_class);
+    }
+
     void mark_deleted();
 
     txn_t *txn() const { return txn_; }
@@ -18,11 +18,17 @@ alt_cache_balancer_t::cache_data_t::cache_data_t(alt::evicter_t *_evicter) :
     new_size(0),
     old_size(evicter->memory_limit()),
     bytes_loaded(evicter->get_bytes_loaded()),
-    access_count(evicter->access_count()) { }
+    access_count(evicter->access_count()),
+    min_size(evicter->memory_reservation()),
+    max_size(evicter->max_memory_limit()) { }
 
 alt_cache_balancer_t::alt_cache_balancer_t(
-        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable) :
+        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable,
+        cache_eviction_policy_t _eviction_policy,
+        uint32_t _snapshot_memory_limit_percent) :
     total_cache_size_watchable(_total_cache_size_watchable),
+    cache_eviction_policy(_eviction_policy),
+    snapshot_memory_percent(_snapshot_memory_limit_percent),
     rebalance_timer(make_scoped<repeating_timer_t>(rebalance_check_interval_ms, this)),
     rebalance_timer_state(rebalance_timer_state_t::normal),
     last_rebalance_time(0),
@@ -149,6 +155,25 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
 
     // Calculate new cache sizes
     if (total_evicters > 0) {
+        // If the reservations of all caches don't fit, every cache gets the same
+        // fraction of its reservation.
+        uint64_t total_reservations = 0;
+        for (size_t i = 0; i < cache_data.size(); ++i) {
+            for (size_t j = 0; j < cache_data[i].size(); ++j) {
+                total_reservations += cache_data[i][j].min_size;
+            }
+        }
+        if (total_reservations > total_cache_size) {
+            double scale = static_cast<double>(total_cache_size)
+                / static_cast<double>(total_reservations);
+            for (size_t i = 0; i < cache_data.size(); ++i) {
+                for (size_t j = 0; j < cache_data[i].size(); ++j) {
+                    cache_data_t *data = &cache_data[i][j];
+                    data->min_size = static_cast<uint64_t>(data->min_size * scale);
+                }
+            }
+        }
+
         uint64_t total_new_sizes = 0;
 
         for (size_t i = 0; i < cache_data.size(); ++i) {
@@ -165,18 +190,36 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
                     new_size += data->old_size;
                     new_size = std::max<int64_t>(new_size, 0);
 
-                    data->new_size = new_size;
-                    total_new_sizes += new_size;
+                    data->new_size = std::min(
+                        std::max<uint64_t>(new_size, data->min_size), data->max_size);
+                    total_new_sizes += data->new_size;
                 } else {
                     data->new_size = 0;
                 }
             }
         }
 
-        // Distribute any rounding error across shards
+        // Distribute any rounding error (and anything the bounds took away or added)
+        // across the shards that haven't reached their bounds yet
         int64_t extra_bytes = total_cache_size - total_new_sizes;
         while (extra_bytes != 0) {
-            int64_t delta = extra_bytes / static_cast<int64_t>(total_evicters);
+            size_t adjustable_evicters = 0;
+            for (size_t i = 0; i < cache_data.size(); ++i) {
+                for (size_t j = 0; j < cache_data[i].size(); ++j) {
+                    const cache_data_t *data = &cache_data[i][j];
+                    if (extra_bytes > 0
+                        ? data->new_size < data->max_size
+                        : data->new_size > data->min_size) {
+                        ++adjustable_evicters;
+                    }
+                }
+            }
+            if (adjustable_evicters == 0) {
+                // Every shard is at its limit, so some of the cache stays unused.
+                break;
+            }
+
+            int64_t delta = extra_bytes / static_cast<int64_t>(adjustable_evicters);
             if (delta == 0) {
                 delta = ((extra_bytes < 0) ? -1 : 1);
             }
@@ -184,13 +227,16 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
                 for (size_t j = 0; j < cache_data[i].size() && extra_bytes != 0; ++j) {
                     cache_data_t *data = &cache_data[i][j];
 
-                    // Avoid underflow
-                    if (static_cast<int64_t>(data->new_size) + delta >= 0) {
-                        data->new_size += delta;
-                        extra_bytes -= delta;
+                    if (delta > 0) {
+                        uint64_t change = std::min<uint64_t>(
+                            delta, data->max_size - data->new_size);
+                        data->new_size += change;
+                        extra_bytes -= change;
                     } else {
-                        extra_bytes += data->new_size;
-                        data->new_size = 0;
+                        uint64_t change = std::min<uint64_t>(
+                            -delta, data->new_size - data->min_size);
+                        data->new_size -= change;
+                        extra_bytes += change;
                     }
                 }
             }
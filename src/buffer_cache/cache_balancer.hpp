@@ -10,6 +10,7 @@
 
 #include "threading.hpp"
 #include "arch/timing.hpp"
+#include "buffer_cache/types.hpp"
 #include "concurrency/pump_coro.hpp"
 #include "concurrency/watchable.hpp"
 #include "containers/scoped.hpp"
@@ -30,6 +31,14 @@ public:
     // Tells caches whether to start read ahead initially
     virtual bool read_ahead_ok_at_start() const = 0;
 
+    // The eviction policy for all the caches using this balancer
+    virtual cache_eviction_policy_t eviction_policy() const = 0;
+
+    // How much of its memory limit a cache lets snapshots keep in old versions of
+    // pages before long snapshotted reads start over with a new snapshot, in percent,
+    // or 0 if there is no limit
+    virtual uint32_t snapshot_memory_limit_percent() const = 0;
+
     // Returns a pointer to a boolean for the given thread number (which must be the
     // current thread) which, when set to true, means you should notify the balancer
     // that it should wake up.  Stuff outside the balancer should only set it from
@@ -68,6 +77,14 @@ public:
         return false;
     }
 
+    cache_eviction_policy_t eviction_policy() const final {
+        return cache_eviction_policy_t::lru;
+    }
+
+    uint32_t snapshot_memory_limit_percent() const final {
+        return 0;
+    }
+
     bool *notify_activity_boolean(threadnum_t) final {
         return &notify_activity_boolean_;
     }
@@ -89,8 +106,10 @@ class alt_cache_balancer_t final :
     public cache_balancer_t,
     public repeating_timer_callback_t {
 public:
-    explicit alt_cache_balancer_t(
-        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable);
+    alt_cache_balancer_t(
+        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable,
+        cache_eviction_policy_t _eviction_policy,
+        uint32_t _snapshot_memory_limit_percent);
     ~alt_cache_balancer_t();
 
     uint64_t base_mem_per_store() const final {
@@ -101,6 +120,14 @@ public:
         return true;
     }
 
+    cache_eviction_policy_t eviction_policy() const final {
+        return cache_eviction_policy;
+    }
+
+    uint32_t snapshot_memory_limit_percent() const final {
+        return snapshot_memory_percent;
+    }
+
     bool *notify_activity_boolean(threadnum_t thread) final;
 
     void wake_up_activity_happened() final;
@@ -142,6 +169,10 @@ private:
         uint64_t old_size;
         int64_t bytes_loaded;
         uint64_t access_count;
+        // The bounds that `new_size` has to stay within, from
+        // `evicter_t::set_memory_bounds()`.
+        uint64_t min_size;
+        uint64_t max_size;
     };
 
     // Helper function to collect stats from each thread so we don't need
@@ -155,6 +186,8 @@ private:
                                    bool new_read_ahead_ok);
 
     clone_ptr_t<watchable_t<uint64_t> > total_cache_size_watchable;
+    const cache_eviction_policy_t cache_eviction_policy;
+    const uint32_t snapshot_memory_percent;
     scoped_ptr_t<repeating_timer_t> rebalance_timer;
     enum class rebalance_timer_state_t {
         // Normal operating condition: there is a timer, and it'll ping soon.  Can
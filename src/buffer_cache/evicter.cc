@@ -1,22 +1,47 @@
 #include "buffer_cache/evicter.hpp"
 
+#include <algorithm>
+
 #include "arch/runtime/coroutines.hpp"
+#include "btree/node.hpp"
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/page.hpp"
 #include "buffer_cache/page_cache.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "config/args.hpp"
 
 namespace alt {
 
+// The page must be loaded.  Its contents only change while it has waiters, i.e. while
+// it's in the unevictable bag, so this is stable for as long as it sits in any other
+// bag.
+bool page_holds_internal_node(page_t *page) {
+    if (page->get_page_buf_size().value() < sizeof(node_t)) {
+        return false;
+    }
+    const node_t *node
+        = reinterpret_cast<const node_t *>(page->get_loaded_ser_buffer()->cache_data);
+    return node->magic == internal_node_t::expected_magic;
+}
+
 evicter_t::evicter_t()
     : initialized_(false),
       page_cache_(nullptr),
       balancer_(nullptr),
       balancer_notify_activity_boolean_(nullptr),
       throttler_(nullptr),
+      memory_reservation_(0),
+      max_memory_limit_(UINT64_MAX),
+      eviction_policy_(cache_eviction_policy_t::lru),
       bytes_loaded_counter_(0),
       access_count_counter_(0),
       access_time_counter_(INITIAL_ACCESS_TIME),
+      hit_count_(0),
+      miss_count_(0),
+      snapshot_retained_size_(0),
+      snapshot_memory_limit_percent_(0),
+      dirtied_block_count_(0),
+      written_block_count_(0),
       evict_if_necessary_active_(false) { }
 
 evicter_t::~evicter_t() {
@@ -36,6 +61,8 @@ void evicter_t::initialize(page_cache_t *page_cache,
     initialized_ = true;  // Can you really say this class is 'initialized_'?
     page_cache_ = page_cache;
     memory_limit_ = balancer->base_mem_per_store();
+    eviction_policy_ = balancer->eviction_policy();
+    snapshot_memory_limit_percent_ = balancer->snapshot_memory_limit_percent();
     page_cache_ = page_cache;
     throttler_ = throttler;
     balancer_ = balancer;
@@ -66,6 +93,27 @@ void evicter_t::update_memory_limit(uint64_t new_memory_limit,
                                            page_cache_->max_block_size());
 }
 
+void evicter_t::set_memory_bounds(uint64_t memory_reservation,
+                                  uint64_t max_memory_limit) {
+    assert_thread();
+    guarantee(initialized_);
+    guarantee(memory_reservation <= max_memory_limit);
+
+    memory_reservation_ = memory_reservation;
+    max_memory_limit_ = max_memory_limit;
+
+    // We don't wait for the balancer if we're over the new limit.
+    if (memory_limit_ > max_memory_limit_) {
+        memory_limit_ = max_memory_limit_;
+        evict_if_necessary();
+        throttler_->inform_memory_limit_change(memory_limit_,
+                                               page_cache_->max_block_size());
+    }
+
+    // The balancer might be asleep because this cache has been idle.
+    notify_balancer_of_activity();
+}
+
 int64_t evicter_t::get_bytes_loaded() const {
     assert_thread();
     guarantee(initialized_);
@@ -78,6 +126,29 @@ uint64_t evicter_t::memory_limit() const {
     return memory_limit_;
 }
 
+uint64_t evicter_t::memory_reservation() const {
+    assert_thread();
+    guarantee(initialized_);
+    return memory_reservation_;
+}
+
+void evicter_t::make_room_for(uint64_t bytes) {
+    assert_thread();
+    guarantee(initialized_);
+    const uint64_t wanted = std::min(in_memory_size() + bytes, max_memory_limit_);
+    if (wanted > memory_limit_) {
+        memory_limit_ = wanted;
+        throttler_->inform_memory_limit_change(memory_limit_,
+                                               page_cache_->max_block_size());
+    }
+}
+
+uint64_t evicter_t::max_memory_limit() const {
+    assert_thread();
+    guarantee(initialized_);
+    return max_memory_limit_;
+}
+
 uint64_t evicter_t::access_count() const {
     assert_thread();
     guarantee(initialized_);
@@ -95,6 +166,10 @@ void evicter_t::notify_bytes_loading(int64_t in_memory_buf_change) {
     guarantee(initialized_);
     bytes_loaded_counter_ += in_memory_buf_change;
     access_count_counter_ += 1;
+    notify_balancer_of_activity();
+}
+
+void evicter_t::notify_balancer_of_activity() {
     if (*balancer_notify_activity_boolean_) {
         *balancer_notify_activity_boolean_ = false;
 
@@ -166,6 +241,8 @@ void evicter_t::move_unevictable_to_evictable(page_t *page) {
     unevictable_.remove(page, page->hypothetical_memory_usage(page_cache_));
     eviction_bag_t *new_bag = correct_eviction_category(page);
     rassert(new_bag == &evictable_disk_backed_
+            || new_bag == &evictable_probationary_
+            || new_bag == &evictable_internal_
             || new_bag == &evictable_unbacked_);
     new_bag->add(page, page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
@@ -190,6 +267,13 @@ eviction_bag_t *evicter_t::correct_eviction_category(page_t *page) {
     } else if (!page->is_loaded()) {
         return &evicted_;
     } else if (page->is_disk_backed()) {
+        if (page_holds_internal_node(page)) {
+            return &evictable_internal_;
+        }
+        if (eviction_policy_ == cache_eviction_policy_t::scan_resistant
+            && page->is_probationary()) {
+            return &evictable_probationary_;
+        }
         return &evictable_disk_backed_;
     } else {
         return &evictable_unbacked_;
@@ -209,9 +293,52 @@ uint64_t evicter_t::in_memory_size() const {
     guarantee(initialized_);
     return unevictable_.size()
         + evictable_disk_backed_.size()
+        + evictable_probationary_.size()
+        + evictable_internal_.size()
         + evictable_unbacked_.size();
 }
 
+bool evicter_t::snapshot_memory_limit_exceeded() const {
+    assert_thread();
+    guarantee(initialized_);
+    return snapshot_memory_limit_percent_ != 0
+        && snapshot_retained_size_
+           > memory_limit_ / 100 * snapshot_memory_limit_percent_;
+}
+
+uint64_t evicter_t::probationary_size() const {
+    assert_thread();
+    guarantee(initialized_);
+    return evictable_probationary_.size();
+}
+
+uint64_t evicter_t::internal_node_size() const {
+    assert_thread();
+    guarantee(initialized_);
+    return evictable_internal_.size();
+}
+
+eviction_bag_t *evicter_t::bag_to_evict_from() {
+    // Probationary pages are evicted first once they take up more than their share
+    // of the cache, so that one-off scans only ever cycle through that share.  We
+    // also take them when there's nothing else left.  (With the LRU policy the
+    // probationary bag is always empty.)  Internal nodes go last, unless they take
+    // up more than their own share.
+    if (evictable_probationary_.size() > memory_limit_ / CACHE_PROBATIONARY_SHARE) {
+        return &evictable_probationary_;
+    }
+    if (evictable_internal_.size() > memory_limit_ / CACHE_INTERNAL_NODE_SHARE) {
+        return &evictable_internal_;
+    }
+    if (evictable_disk_backed_.size() != 0) {
+        return &evictable_disk_backed_;
+    }
+    if (evictable_probationary_.size() != 0) {
+        return &evictable_probationary_;
+    }
+    return &evictable_internal_;
+}
+
 void evicter_t::evict_if_necessary() THROWS_NOTHING {
     assert_thread();
     guarantee(initialized_);
@@ -230,8 +357,8 @@ void evicter_t::evict_if_necessary() THROWS_NOTHING {
     evict_if_necessary_active_ = true;
     page_t *page;
     while (in_memory_size() > memory_limit_
-           && evictable_disk_backed_.remove_oldish(&page, access_time_counter_,
-                                                   page_cache_)) {
+           && bag_to_evict_from()->remove_oldish(&page, access_time_counter_,
+                                                 page_cache_)) {
         evicted_.add(page, page->hypothetical_memory_usage(page_cache_));
         page->evict_self(page_cache_);
         page_cache_->consider_evicting_current_page(page->block_id());
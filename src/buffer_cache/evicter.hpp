@@ -6,6 +6,7 @@
 #include <functional>
 
 #include "buffer_cache/eviction_bag.hpp"
+#include "buffer_cache/types.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cache_line_padded.hpp"
 #include "concurrency/pubsub.hpp"
@@ -47,16 +48,65 @@ public:
                              uint64_t access_count_accounted_for,
                              bool read_ahead_ok);
 
+    // Bounds the memory limit that the balancer may give to this cache.  Pass
+    // `UINT64_MAX` as `max_memory_limit` if there is no upper bound.
+    void set_memory_bounds(uint64_t memory_reservation, uint64_t max_memory_limit);
+
+    // Raises the memory limit so that `bytes` more can be loaded without evicting
+    // anything, within the bounds from `set_memory_bounds()`.  The balancer sets the
+    // limit again the next time it rebalances.
+    void make_room_for(uint64_t bytes);
+
     uint64_t next_access_time() {
         guarantee(initialized_);
         return ++access_time_counter_;
     }
+    uint64_t current_access_time() const { return access_time_counter_; }
 
     uint64_t memory_limit() const;
+    uint64_t memory_reservation() const;
+    uint64_t max_memory_limit() const;
     uint64_t access_count() const;
     int64_t get_bytes_loaded() const;
 
     uint64_t in_memory_size() const;
+    uint64_t probationary_size() const;
+    uint64_t internal_node_size() const;
+
+    // Called whenever a page gets acquired, to keep the hit rate statistics.
+    void note_page_acquired(bool page_was_in_memory) {
+        if (page_was_in_memory) {
+            ++hit_count_;
+        } else {
+            ++miss_count_;
+        }
+    }
+    uint64_t hit_count() const { return hit_count_; }
+    uint64_t miss_count() const { return miss_count_; }
+
+    // Old versions of pages that a write has replaced, but that snapshotted reads
+    // still hold on to.  They are counted whether or not they are currently in memory.
+    void add_snapshot_retained(uint64_t bytes) { snapshot_retained_size_ += bytes; }
+    void remove_snapshot_retained(uint64_t bytes) {
+        rassert(snapshot_retained_size_ >= bytes);
+        snapshot_retained_size_ -= bytes;
+    }
+    uint64_t snapshot_retained_size() const { return snapshot_retained_size_; }
+
+    // Whether `snapshot_retained_size()` is over the balancer's
+    // `snapshot_memory_limit_percent()` of the memory limit.
+    bool snapshot_memory_limit_exceeded() const;
+
+    // Called for every set of transactions that gets flushed together, with the
+    // number of block changes the transactions made and the number of blocks that
+    // actually got written after combining them.
+    void note_txn_set_flushed(uint64_t dirtied_block_count,
+                              uint64_t written_block_count) {
+        dirtied_block_count_ += dirtied_block_count;
+        written_block_count_ += written_block_count;
+    }
+    uint64_t dirtied_block_count() const { return dirtied_block_count_; }
+    uint64_t written_block_count() const { return written_block_count_; }
 
     // This is decremented past UINT64_MAX to force code to be aware of access time
     // rollovers.
@@ -68,9 +118,16 @@ private:
     // Tells the cache balancer about a page being loaded
     void notify_bytes_loading(int64_t ser_buf_change);
 
+    // Wakes up the cache balancer, unless it's already been told about activity on
+    // this thread.
+    void notify_balancer_of_activity();
+
     // Evicts any evictable pages until under the memory limit
     void evict_if_necessary() THROWS_NOTHING;
 
+    // Picks the bag to evict the next page from.
+    eviction_bag_t *bag_to_evict_from();
+
     bool initialized_;
     page_cache_t *page_cache_;
     cache_balancer_t *balancer_;
@@ -80,6 +137,13 @@ private:
 
     uint64_t memory_limit_;
 
+    // The balancer keeps `memory_limit_` between these two (unless the reservations
+    // of all caches don't fit into the total cache size).
+    uint64_t memory_reservation_;
+    uint64_t max_memory_limit_;
+
+    cache_eviction_policy_t eviction_policy_;
+
     // These are updated every time a page is loaded, created, or destroyed, and
     // cleared when cache memory limits are re-evaluated.  This value can go
     // negative, if you keep deleting blocks or suddenly drop a snapshot.
@@ -89,6 +153,20 @@ private:
     // This gets incremented every time a page is accessed.
     uint64_t access_time_counter_;
 
+    // How many page acquisitions found the page in memory, and how many had to
+    // wait for it to be loaded.
+    uint64_t hit_count_;
+    uint64_t miss_count_;
+
+    uint64_t snapshot_retained_size_;
+    // Copied from the balancer, 0 if there is no limit
+    uint32_t snapshot_memory_limit_percent_;
+
+    // How many block changes flushed transactions made, and how many block writes
+    // they turned into.
+    uint64_t dirtied_block_count_;
+    uint64_t written_block_count_;
+
     // This is set to true while `evict_if_necessary()` is active.
     // It avoids reentrant calls to that function.
     bool evict_if_necessary_active_;
@@ -96,6 +174,12 @@ private:
     // These track every page's eviction status.
     eviction_bag_t unevictable_;
     eviction_bag_t evictable_disk_backed_;
+    // With the scan-resistant policy, the disk-backed pages that have only been
+    // acquired once live here instead of in evictable_disk_backed_.
+    eviction_bag_t evictable_probationary_;
+    // Disk-backed pages that hold btree internal nodes live here instead, regardless
+    // of the eviction policy.
+    eviction_bag_t evictable_internal_;
     eviction_bag_t evictable_unbacked_;
     eviction_bag_t evicted_;
 
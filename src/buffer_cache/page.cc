@@ -56,6 +56,9 @@ page_t::page_t(block_id_t _block_id, page_cache_t *page_cache)
     : block_id_(_block_id),
       loader_(nullptr),
       access_time_(page_cache->evicter().next_access_time()),
+      times_acquired_(0),
+      replaced_(false),
+      snapshot_reader_count_(0),
       snapshot_refcount_(0) {
     page_cache->evicter().add_deferred_loaded(this);
 
@@ -70,6 +73,9 @@ page_t::page_t(block_id_t _block_id, page_cache_t *page_cache,
     : block_id_(_block_id),
       loader_(nullptr),
       access_time_(page_cache->evicter().next_access_time()),
+      times_acquired_(0),
+      replaced_(false),
+      snapshot_reader_count_(0),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
 
@@ -86,6 +92,9 @@ page_t::page_t(block_id_t _block_id, buf_ptr_t buf,
       loader_(nullptr),
       buf_(std::move(buf)),
       access_time_(page_cache->evicter().next_access_time()),
+      times_acquired_(0),
+      replaced_(false),
+      snapshot_reader_count_(0),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_unbacked(this);
@@ -100,6 +109,9 @@ page_t::page_t(block_id_t _block_id,
       buf_(std::move(buf)),
       block_token_(_block_token),
       access_time_(READ_AHEAD_ACCESS_TIME),
+      times_acquired_(0),
+      replaced_(false),
+      snapshot_reader_count_(0),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_disk_backed(this);
@@ -109,6 +121,9 @@ page_t::page_t(page_t *copyee, page_cache_t *page_cache, cache_account_t *accoun
     : block_id_(copyee->block_id_),
       loader_(nullptr),
       access_time_(page_cache->evicter().next_access_time()),
+      times_acquired_(0),
+      replaced_(false),
+      snapshot_reader_count_(0),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
     coro_t::spawn_now_dangerously(std::bind(&page_t::load_from_copyee,
@@ -393,6 +408,32 @@ size_t page_t::num_snapshot_references() {
     return snapshot_refcount_;
 }
 
+void page_t::mark_replaced(page_cache_t *page_cache) {
+    rassert(!replaced_);
+    replaced_ = true;
+    if (snapshot_reader_count_ > 0) {
+        page_cache->evicter().add_snapshot_retained(
+            hypothetical_memory_usage(page_cache));
+    }
+}
+
+void page_t::add_snapshot_reader(page_cache_t *page_cache) {
+    ++snapshot_reader_count_;
+    if (replaced_ && snapshot_reader_count_ == 1) {
+        page_cache->evicter().add_snapshot_retained(
+            hypothetical_memory_usage(page_cache));
+    }
+}
+
+void page_t::remove_snapshot_reader(page_cache_t *page_cache) {
+    rassert(snapshot_reader_count_ > 0);
+    --snapshot_reader_count_;
+    if (replaced_ && snapshot_reader_count_ == 0) {
+        page_cache->evicter().remove_snapshot_retained(
+            hypothetical_memory_usage(page_cache));
+    }
+}
+
 page_t *page_t::make_copy(page_cache_t *page_cache, cache_account_t *account) {
     page_t *ret = new page_t(this, page_cache, account);
     return ret;
@@ -413,6 +454,10 @@ void page_t::pulse_waiters_or_make_evictable(page_cache_t *page_cache) {
 void page_t::add_waiter(page_acq_t *acq, cache_account_t *account) {
     eviction_bag_t *old_bag
         = acq->page_cache()->evicter().correct_eviction_category(this);
+    acq->page_cache()->evicter().note_page_acquired(buf_.has());
+    if (times_acquired_ < 2) {
+        ++times_acquired_;
+    }
     waiters_.push_front(acq);
     acq->page_cache()->evicter().change_to_correct_eviction_bag(old_bag, this);
     if (buf_.has()) {
@@ -680,6 +725,7 @@ page_t *page_ptr_t::get_page_for_write(page_cache_t *page_cache,
                                        cache_account_t *account) {
     rassert(page_ != nullptr);
     if (page_->num_snapshot_references() > 1) {
+        page_->mark_replaced(page_cache);
         page_ptr_t tmp(page_->make_copy(page_cache, account));
         swap_with(&tmp);
         tmp.reset_page_ptr(page_cache);
@@ -65,6 +65,8 @@ public:
     bool has_waiters() const { return !waiters_.empty(); }
     bool is_loaded() const { return buf_.has(); }
     bool is_disk_backed() const { return block_token_.has(); }
+    // True until the page has been acquired a second time.
+    bool is_probationary() const { return times_acquired_ < 2; }
 
     void evict_self(page_cache_t *page_cache);
 
@@ -72,6 +74,14 @@ public:
 
     bool page_ptr_count() const { return snapshot_refcount_; }
 
+    // A write that can't modify the page in place because other page_ptr_t's point
+    // at it calls `mark_replaced()` before switching to a copy.  Snapshotted read
+    // acquirers register themselves with `add_snapshot_reader()`, so that the evicter
+    // can tell how much memory snapshots keep alive just for themselves.
+    void mark_replaced(page_cache_t *page_cache);
+    void add_snapshot_reader(page_cache_t *page_cache);
+    void remove_snapshot_reader(page_cache_t *page_cache);
+
     const counted_t<block_token_t> &block_token() const {
         return block_token_;
     }
@@ -132,6 +142,16 @@ private:
 
     uint64_t access_time_;
 
+    // How many times the page has been acquired, saturating at 2.  This is what
+    // distinguishes probationary pages from frequently used ones.
+    uint8_t times_acquired_;
+
+    // Whether a write has replaced this version of the page with a copy.
+    bool replaced_;
+
+    // How many of the page_ptr_t's belong to snapshotted read acquirers.
+    uint32_t snapshot_reader_count_;
+
     // How many page_ptr_t's point at this page, expecting nothing to modify it,
     // other than themselves.
     size_t snapshot_refcount_;
@@ -146,7 +166,9 @@ private:
     // if loader_ is non-null:  unevictable_pages_
     // else if waiters_ is non-empty: unevictable_pages_
     // else if buf_ is null: evicted_pages_ (and block_token_ is non-null)
-    // else if block_token_ is non-null: evictable_disk_backed_pages_
+    // else if block_token_ is non-null: evictable_disk_backed_pages_ (or
+    //     evictable_probationary_, with the scan-resistant eviction policy, or
+    //     evictable_internal_, if it holds a btree internal node)
     // else: evictable_unbacked_pages_ (buf_ is non-null, block_token_ is null)
     //
     // So, when loader_, waiters_, buf_, or block_token_ is touched, we might
@@ -10,6 +10,8 @@
 #include "arch/runtime/runtime_utils.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/new_mutex.hpp"
+#include "concurrency/pmap.hpp"
+#include "buffer_cache/alt.hpp"
 #include "buffer_cache/cache_balancer.hpp"
 #include "do_on_thread.hpp"
 #include "serializer/serializer.hpp"
@@ -208,6 +210,7 @@ page_cache_t::page_cache_t(serializer_t *_serializer,
       serializer_(_serializer),
       free_list_(_serializer),
       evicter_(),
+      throttler_(throttler),
       read_ahead_cb_(nullptr),
       drainer_(make_scoped<auto_drainer_t>()) {
 
@@ -223,7 +226,8 @@ page_cache_t::page_cache_t(serializer_t *_serializer,
             local_read_ahead_cb = new page_read_ahead_cb_t(_serializer, this);
         }
         default_reads_account_.init(_serializer->home_thread(),
-                                    _serializer->make_io_account(CACHE_READS_IO_PRIORITY));
+                                    _serializer->make_io_account(CACHE_READS_IO_PRIORITY,
+                                                                 "cache_reads"));
         index_write_sink_.init(new page_cache_index_write_sink_t);
         recencies_ = _serializer->get_all_recencies();
     }
@@ -362,6 +366,132 @@ current_page_t *page_cache_t::page_for_block_id(block_id_t block_id) {
     return page_it->second;
 }
 
+bool page_cache_t::prefetch_block(block_id_t block_id, cache_account_t *account) {
+    assert_thread();
+
+    // Prefetched pages are only worth having if they don't push out pages that
+    // somebody is using.
+    if (evicter_.in_memory_size() + max_block_size_.value()
+        > evicter_.memory_limit()) {
+        return false;
+    }
+
+    current_page_t *current_page;
+    auto page_it = current_pages_.find(block_id);
+    if (page_it == current_pages_.end()) {
+        // The block might have been deleted since the (possibly snapshotted) parent
+        // node that referred to it was written.
+        if (is_aux_block_id(block_id)
+            || recency_for_block_id(block_id) == repli_timestamp_t::invalid) {
+            return false;
+        }
+        current_page = new current_page_t(block_id);
+        current_pages_.insert(page_it, std::make_pair(block_id, current_page));
+    } else {
+        current_page = page_it->second;
+        if (current_page->is_deleted() || current_page->page_.has()) {
+            return false;
+        }
+    }
+
+    current_page->convert_from_serializer_if_necessary(
+        current_page_help_t(block_id, this), account);
+    return true;
+}
+
+std::vector<block_id_t> page_cache_t::hot_block_ids(size_t max_count) const {
+    assert_thread();
+    // Access times wrap around, so we compare how long ago each page was accessed.
+    const uint64_t now = evicter_.current_access_time();
+    std::vector<std::pair<uint64_t, block_id_t> > ages;
+    for (const auto &pair : current_pages_) {
+        const current_page_t *current_page = pair.second;
+        if (is_aux_block_id(pair.first) || current_page->is_deleted()
+            || !current_page->page_.has()) {
+            continue;
+        }
+        const page_t *page = current_page->page_.get_page_for_read();
+        if (page->is_loaded()) {
+            ages.push_back(std::make_pair(now - page->access_time(), pair.first));
+        }
+    }
+    if (ages.size() > max_count) {
+        std::nth_element(ages.begin(), ages.begin() + max_count, ages.end());
+        ages.resize(max_count);
+    }
+    std::sort(ages.begin(), ages.end());
+
+    std::vector<block_id_t> ret;
+    ret.reserve(ages.size());
+    for (const auto &age : ages) {
+        ret.push_back(age.second);
+    }
+    return ret;
+}
+
+void page_cache_t::warm_up(const std::vector<block_id_t> &block_ids,
+                           signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+    std::vector<block_id_t> wanted;
+    for (block_id_t block_id : block_ids) {
+        // This also skips IDs past the end of the serializer's index, if the list
+        // came from a different version of the file.
+        if (!is_aux_block_id(block_id)
+            && recency_for_block_id(block_id) != repli_timestamp_t::invalid
+            && current_pages_.count(block_id) == 0) {
+            wanted.push_back(block_id);
+        }
+    }
+
+    std::vector<std::pair<block_id_t, counted_t<block_token_t> > > tokens;
+    {
+        on_thread_t thread_switcher(serializer_->home_thread());
+        for (block_id_t block_id : wanted) {
+            counted_t<block_token_t> token = serializer_->index_read(block_id);
+            if (token.has()) {
+                tokens.push_back(std::make_pair(block_id, std::move(token)));
+            }
+        }
+    }
+    std::sort(tokens.begin(), tokens.end(),
+        [](const std::pair<block_id_t, counted_t<block_token_t> > &a,
+           const std::pair<block_id_t, counted_t<block_token_t> > &b) {
+            return a.second->offset() < b.second->offset();
+        });
+
+    uint64_t total_size = 0;
+    for (const auto &pair : tokens) {
+        total_size += pair.second->block_size().value();
+    }
+    // Otherwise the blocks would get evicted right away, if the balancer hasn't given
+    // this cache any memory yet.
+    evicter_.make_room_for(total_size);
+
+    for (size_t begin = 0; begin < tokens.size();
+         begin += PAGE_CACHE_WARM_UP_BATCH_SIZE) {
+        if (interruptor->is_pulsed()) {
+            throw interrupted_exc_t();
+        }
+        const size_t end = std::min<size_t>(begin + PAGE_CACHE_WARM_UP_BATCH_SIZE,
+                                            tokens.size());
+        std::vector<buf_ptr_t> bufs(end - begin);
+        {
+            on_thread_t thread_switcher(serializer_->home_thread());
+            pmap(end - begin, [&](int64_t i) {
+                bufs[i] = serializer_->block_read(
+                    tokens[begin + i].second, default_reads_account_.get());
+            });
+        }
+        for (size_t i = begin; i < end; ++i) {
+            const block_id_t block_id = tokens[i].first;
+            if (current_pages_.count(block_id) == 0) {
+                current_pages_[block_id] = new current_page_t(
+                    block_id, std::move(bufs[i - begin]), tokens[i].second, this);
+            }
+        }
+    }
+}
+
 current_page_t *page_cache_t::page_for_new_block_id(
         block_type_t block_type,
         block_id_t *block_id_out) {
@@ -413,7 +543,8 @@ current_page_t *page_cache_t::internal_page_for_new_chosen(block_id_t block_id)
     return inserted_page.first->second;
 }
 
-cache_account_t page_cache_t::create_cache_account(int priority) {
+cache_account_t page_cache_t::create_cache_account(int priority,
+                                                   const char *io_class) {
     // We assume that a priority of 100 means that the transaction should have the
     // same priority as all the non-accounted transactions together. Not sure if this
     // makes sense.
@@ -431,7 +562,7 @@ cache_account_t page_cache_t::create_cache_account(int priority) {
         // Ideally we shouldn't have to switch to the serializer thread.  But that's
         // what the file account API is right now, deep in the I/O layer.
         on_thread_t thread_switcher(serializer_->home_thread());
-        io_account = serializer_->make_io_account(io_priority,
+        io_account = serializer_->make_io_account(io_priority, io_class,
                                                   outstanding_requests_limit);
     }
 
@@ -440,27 +571,31 @@ cache_account_t page_cache_t::create_cache_account(int priority) {
 
 
 current_page_acq_t::current_page_acq_t()
-    : page_cache_(nullptr), the_txn_(nullptr) { }
+    : page_cache_(nullptr), the_txn_(nullptr), lock_class_(lock_class_t::none),
+      wait_start_(0) { }
 
 current_page_acq_t::current_page_acq_t(page_txn_t *txn,
                                        block_id_t _block_id,
                                        access_t _access,
                                        page_create_t create)
-    : page_cache_(nullptr), the_txn_(nullptr) {
+    : page_cache_(nullptr), the_txn_(nullptr), lock_class_(lock_class_t::none),
+      wait_start_(0) {
     init(txn, _block_id, _access, create);
 }
 
 current_page_acq_t::current_page_acq_t(page_txn_t *txn,
                                        alt_create_t create,
                                        block_type_t block_type)
-    : page_cache_(nullptr), the_txn_(nullptr) {
+    : page_cache_(nullptr), the_txn_(nullptr), lock_class_(lock_class_t::none),
+      wait_start_(0) {
     init(txn, create, block_type);
 }
 
 current_page_acq_t::current_page_acq_t(page_cache_t *_page_cache,
                                        block_id_t _block_id,
                                        read_access_t read)
-    : page_cache_(nullptr), the_txn_(nullptr) {
+    : page_cache_(nullptr), the_txn_(nullptr), lock_class_(lock_class_t::none),
+      wait_start_(0) {
     init(_page_cache, _block_id, read);
 }
 
@@ -487,8 +622,12 @@ void current_page_acq_t::init(page_txn_t *txn,
         dirtied_page_ = false;
         touched_page_ = false;
 
+        lock_class_ = _block_id == SUPERBLOCK_ID
+            ? lock_class_t::superblock
+            : lock_class_t::page;
         the_txn_->add_acquirer(this);
         current_page_->add_acquirer(this);
+        start_lock_wait_if_waiting();
     }
 }
 
@@ -504,6 +643,8 @@ void current_page_acq_t::init(page_txn_t *txn,
     current_page_ = page_cache_->page_for_new_block_id(block_type, &block_id_);
     dirtied_page_ = false;
     touched_page_ = false;
+    // A new block isn't anybody else's yet, so there is nothing to wait for.
+    lock_class_ = lock_class_t::page;
 
     the_txn_->add_acquirer(this);
     current_page_->add_acquirer(this);
@@ -522,8 +663,19 @@ void current_page_acq_t::init(page_cache_t *_page_cache,
     current_page_ = page_cache_->page_for_block_id(_block_id);
     dirtied_page_ = false;
     touched_page_ = false;
+    lock_class_ = _block_id == SUPERBLOCK_ID
+        ? lock_class_t::superblock
+        : lock_class_t::page;
 
     current_page_->add_acquirer(this);
+    start_lock_wait_if_waiting();
+}
+
+void current_page_acq_t::start_lock_wait_if_waiting() {
+    const cond_t *acq_cond = access_ == access_t::read ? &read_cond_ : &write_cond_;
+    if (!acq_cond->is_pulsed()) {
+        wait_start_ = start_lock_wait(lock_class_);
+    }
 }
 
 current_page_acq_t::~current_page_acq_t() {
@@ -543,6 +695,10 @@ current_page_acq_t::~current_page_acq_t() {
             current_page_->remove_acquirer(this);
         }
         if (declared_snapshotted_) {
+            if (the_txn_ == nullptr && snapshotted_page_.has()) {
+                snapshotted_page_.get_page_for_read()->remove_snapshot_reader(
+                    page_cache_);
+            }
             snapshotted_page_.reset_page_ptr(page_cache_);
             current_page_->remove_keepalive();
         }
@@ -673,11 +829,19 @@ current_page_help_t current_page_acq_t::help() const {
 
 void current_page_acq_t::pulse_read_available() {
     assert_thread();
+    if (access_ == access_t::read && wait_start_ != 0) {
+        record_lock_wait(lock_class_, wait_start_);
+        wait_start_ = 0;
+    }
     read_cond_.pulse_if_not_already_pulsed();
 }
 
 void current_page_acq_t::pulse_write_available() {
     assert_thread();
+    if (wait_start_ != 0) {
+        record_lock_wait(lock_class_, wait_start_);
+        wait_start_ = 0;
+    }
     write_cond_.pulse_if_not_already_pulsed();
 }
 
@@ -876,6 +1040,11 @@ void current_page_t::pulse_pulsables(current_page_acq_t *const acq) {
                 cur->snapshotted_page_.init(
                         current_recency,
                         the_page_for_read_or_deleted(help));
+                // Write acquirers that flush their version this way aren't readers.
+                if (cur->the_txn_ == nullptr && cur->snapshotted_page_.has()) {
+                    cur->snapshotted_page_.get_page_for_read()->add_snapshot_reader(
+                        help.page_cache);
+                }
                 acquirers_.remove(cur);
             }
             cur = next;
@@ -1416,14 +1585,33 @@ void page_cache_t::do_flush_txn_set(page_cache_t *page_cache,
     std::unordered_map<block_id_t, block_change_t> changes = std::move(*changes_ptr);
     rassert(!changes.empty());
 
+    {
+        uint64_t dirtied_block_count = 0;
+        for (page_txn_t *txn : txns) {
+            dirtied_block_count += txn->snapshotted_dirtied_pages_.size();
+        }
+        uint64_t written_block_count = 0;
+        for (const auto &pair : changes) {
+            if (pair.second.modified) {
+                ++written_block_count;
+            }
+        }
+        page_cache->evicter_.note_txn_set_flushed(dirtied_block_count,
+                                                  written_block_count);
+    }
+
     fifo_enforcer_write_token_t index_write_token
         = page_cache->index_write_source_.enter_write();
 
     // Okay, yield, thank you.
     coro_t::yield();
+    const int64_t change_count = changes.size();
+    const ticks_t flush_start = get_ticks();
     do_flush_changes(page_cache, std::move(changes), txns, index_write_token);
 
     // Flush complete.
+    page_cache->throttler_->inform_changes_flushed(change_count,
+                                                   get_ticks() - flush_start);
 
     // KSI: Can't we remove_txn_set_from_graph before flushing?  It would make some
     // data structures smaller.
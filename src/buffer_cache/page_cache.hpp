@@ -19,6 +19,8 @@
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cond_var.hpp"
 #include "concurrency/fifo_enforcer.hpp"
+#include "concurrency/interruptor.hpp"
+#include "concurrency/lock_stats.hpp"
 #include "concurrency/new_semaphore.hpp"
 #include "containers/backindex_bag.hpp"
 #include "containers/intrusive_list.hpp"
@@ -209,6 +211,10 @@ public:
     block_id_t block_id() const { return block_id_; }
     access_t access() const { return access_; }
 
+    // Waits for the page are recorded as superblock or page waits, depending on the
+    // block id, unless this says otherwise.  Call it before waiting for the page.
+    void set_lock_class(lock_class_t lock_class) { lock_class_ = lock_class; }
+
     void mark_deleted();
 
     block_version_t block_version() const;
@@ -240,6 +246,9 @@ private:
 
     current_page_help_t help() const;
 
+    // Starts timing the wait for the page if we didn't get it right away.
+    void start_lock_wait_if_waiting();
+
     void pulse_read_available();
     void pulse_write_available();
 
@@ -255,6 +264,8 @@ private:
     timestamped_page_ptr_t snapshotted_page_;
     cond_t read_cond_;
     cond_t write_cond_;
+    lock_class_t lock_class_;
+    ticks_t wait_start_;
 
     // The block version for our acquisition of the page -- every write acquirer sees
     // a greater block version than the previous acquirer.  The current page's block
@@ -344,6 +355,25 @@ public:
         block_id_t *block_id_out);
     current_page_t *page_for_new_chosen_block_id(block_id_t block_id);
 
+    // Starts loading the block from the serializer if it isn't in memory (or being
+    // loaded) already, so that a later acquisition doesn't have to wait for the
+    // disk.  Does nothing if the cache doesn't have room for the block without
+    // evicting something.  Returns true if it started a load.
+    bool prefetch_block(block_id_t block_id, cache_account_t *account);
+
+    // Returns the IDs of up to `max_count` of the blocks that are in memory, most
+    // recently accessed first.
+    std::vector<block_id_t> hot_block_ids(size_t max_count) const;
+
+    // Loads the given blocks (typically an earlier result of `hot_block_ids()`) into
+    // the cache.  The blocks are read in the order of their offsets in the file, at
+    // most PAGE_CACHE_WARM_UP_BATCH_SIZE at a time.  Blocks that no longer exist or
+    // are in memory already are skipped.  This is meant to be called before the
+    // cache is in use, so that the first queries after a restart find their blocks in
+    // memory.
+    void warm_up(const std::vector<block_id_t> &block_ids, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     // Returns how much memory is being used by all the pages in the cache at this
     // moment in time.
     size_t total_page_memory() const;
@@ -351,7 +381,7 @@ public:
 
     max_block_size_t max_block_size() const { return max_block_size_; }
 
-    cache_account_t create_cache_account(int priority);
+    cache_account_t create_cache_account(int priority, const char *io_class);
 
     cache_account_t *default_reads_account() {
         return &default_reads_account_;
@@ -472,6 +502,9 @@ private:
 
     evicter_t evicter_;
 
+    // Informed about flush throughput so it can pace write transactions.
+    alt_txn_throttler_t *throttler_;
+
     // KSI: I bet this read_ahead_cb_ and read_ahead_cb_existence_ type could be
     // packaged in some new cross_thread_ptr type.
     page_read_ahead_cb_t *read_ahead_cb_;
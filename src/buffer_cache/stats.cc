@@ -8,13 +8,43 @@ alt_cache_stats_t::alt_cache_stats_t(alt::page_cache_t *_page_cache,
     page_cache(_page_cache),
     cache_collection(),
     cache_membership(parent, &cache_collection, "cache"),
-    in_use_bytes(this),
+    in_use_bytes(this, &alt::evicter_t::in_memory_size),
     in_use_bytes_membership(&cache_collection,
                             &in_use_bytes, "in_use_bytes"),
+    probationary_bytes(this, &alt::evicter_t::probationary_size),
+    probationary_bytes_membership(&cache_collection,
+                                  &probationary_bytes, "probationary_bytes"),
+    internal_node_bytes(this, &alt::evicter_t::internal_node_size),
+    internal_node_bytes_membership(&cache_collection,
+                                   &internal_node_bytes, "internal_node_bytes"),
+    snapshot_retained_bytes(this, &alt::evicter_t::snapshot_retained_size),
+    snapshot_retained_bytes_membership(&cache_collection,
+                                       &snapshot_retained_bytes,
+                                       "snapshot_retained_bytes"),
+    allocated_bytes(this, &alt::evicter_t::memory_limit),
+    allocated_bytes_membership(&cache_collection,
+                               &allocated_bytes, "allocated_bytes"),
+    reserved_bytes(this, &alt::evicter_t::memory_reservation),
+    reserved_bytes_membership(&cache_collection,
+                              &reserved_bytes, "reserved_bytes"),
+    hits(this, &alt::evicter_t::hit_count),
+    hits_membership(&cache_collection, &hits, "hits"),
+    misses(this, &alt::evicter_t::miss_count),
+    misses_membership(&cache_collection, &misses, "misses"),
+    dirtied_blocks(this, &alt::evicter_t::dirtied_block_count),
+    dirtied_blocks_membership(&cache_collection, &dirtied_blocks, "dirtied_blocks"),
+    written_blocks(this, &alt::evicter_t::written_block_count),
+    written_blocks_membership(&cache_collection, &written_blocks, "written_blocks"),
+    miss_latency_membership(&cache_collection, &miss_latency, "miss_latency"),
+    soft_durability_flush_latency_membership(&cache_collection,
+                                             &soft_durability_flush_latency,
+                                             "soft_durability_flush_latency"),
     cache_collection_membership(&cache_collection) { }
 
-alt_cache_stats_t::perfmon_value_t::perfmon_value_t(alt_cache_stats_t *_parent) :
-    parent(_parent) { }
+alt_cache_stats_t::perfmon_value_t::perfmon_value_t(
+        alt_cache_stats_t *_parent,
+        uint64_t (alt::evicter_t::*_getter)() const) :
+    parent(_parent), getter(_getter) { }
 
 void *alt_cache_stats_t::perfmon_value_t::begin_stats() {
     return new uint64_t;
@@ -23,7 +53,7 @@ void *alt_cache_stats_t::perfmon_value_t::begin_stats() {
 void alt_cache_stats_t::perfmon_value_t::visit_stats(void *ptr) {
     if (get_thread_id() == parent->home_thread()) {
         uint64_t *value = reinterpret_cast<uint64_t *>(ptr);
-        *value = parent->page_cache->evicter().in_memory_size();
+        *value = (parent->page_cache->evicter().*getter)();
     }
 }
 
@@ -15,18 +15,53 @@ public:
     perfmon_collection_t cache_collection;
     perfmon_membership_t cache_membership;
 
+    // Reports one of the evicter's values, read on the cache's home thread.
     class perfmon_value_t : public perfmon_t {
     public:
-        explicit perfmon_value_t(alt_cache_stats_t *_parent);
+        perfmon_value_t(alt_cache_stats_t *_parent,
+                        uint64_t (alt::evicter_t::*_getter)() const);
         void *begin_stats();
         void visit_stats(void *);
         ql::datum_t end_stats(void *);
     private:
         alt_cache_stats_t *parent;
+        uint64_t (alt::evicter_t::*getter)() const;
         DISABLE_COPYING(perfmon_value_t);
     };
     perfmon_value_t in_use_bytes;
     perfmon_membership_t in_use_bytes_membership;
+    perfmon_value_t probationary_bytes;
+    perfmon_membership_t probationary_bytes_membership;
+    perfmon_value_t internal_node_bytes;
+    perfmon_membership_t internal_node_bytes_membership;
+    // Old versions of pages that only snapshotted reads still need
+    perfmon_value_t snapshot_retained_bytes;
+    perfmon_membership_t snapshot_retained_bytes_membership;
+    // How much memory the cache balancer currently gives to the cache, and how much
+    // of that is reserved for it by the table's configuration.
+    perfmon_value_t allocated_bytes;
+    perfmon_membership_t allocated_bytes_membership;
+    perfmon_value_t reserved_bytes;
+    perfmon_membership_t reserved_bytes_membership;
+    // The number of page acquisitions that found the page in memory, and the number
+    // that had to wait for a read from disk.
+    perfmon_value_t hits;
+    perfmon_membership_t hits_membership;
+    perfmon_value_t misses;
+    perfmon_membership_t misses_membership;
+    // The number of block changes made by flushed transactions, and the number of
+    // block writes they turned into after changes to the same block were combined.
+    perfmon_value_t dirtied_blocks;
+    perfmon_membership_t dirtied_blocks_membership;
+    perfmon_value_t written_blocks;
+    perfmon_membership_t written_blocks_membership;
+    // How long the page acquisitions that missed waited for the page.
+    perfmon_latency_histogram_t miss_latency;
+    perfmon_membership_t miss_latency_membership;
+    // How long soft durability writes were acknowledged to the client before they
+    // were flushed to disk, i.e. the window of writes a crash could lose.
+    perfmon_latency_histogram_t soft_durability_flush_latency;
+    perfmon_membership_t soft_durability_flush_latency_membership;
 
 
     perfmon_multi_membership_t cache_collection_membership;
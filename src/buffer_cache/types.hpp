@@ -14,6 +14,26 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(write_durability_t, int8_t,
                                       write_durability_t::SOFT,
                                       write_durability_t::HARD);
 
+// How the caches pick which pages to evict.
+enum class cache_eviction_policy_t {
+    // Evicts the approximately least recently used page.
+    lru,
+    // Keeps pages that have only been used once (typically by a large scan) in a
+    // probationary category of limited size, and evicts from it first, so that a
+    // scan can't push the frequently used pages out of the cache.
+    scan_resistant
+};
+
+// How much secondary index post construction holds back for foreground queries.
+enum class sindex_build_priority_t {
+    // Holds back further and for longer than `normal`.
+    low,
+    // Waits between passes for as long as the disk or the table is busy.
+    normal,
+    // Never waits between passes.
+    high
+};
+
 
 typedef uint32_t block_magic_comparison_t;
 
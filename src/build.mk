@@ -98,6 +98,10 @@ RT_CXXFLAGS += -DENABLE_TLS
 RT_CXXFLAGS += "-DRAPIDJSON_HAS_STDSTRING"
 # Set RapidJSON to exact double parsing mode
 RT_CXXFLAGS += "-DRAPIDJSON_PARSE_DEFAULT_FLAGS=kParseFullPrecisionFlag"
+# Let RapidJSON skip whitespace 16 bytes at a time. Every x86_64 CPU has SSE2.
+ifeq (x86_64,$(firstword $(subst -, ,$(MACHINE))))
+  RT_CXXFLAGS += "-DRAPIDJSON_SSE2"
+endif
 
 # Force 64-bit off_t size on Linux -- also, sizeof(off_t) will be
 # checked by a compile-time assertion.
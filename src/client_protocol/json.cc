@@ -1,18 +1,28 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "client_protocol/json.hpp"
 
+#include <string.h>
+
+#include <functional>
+#include <vector>
+
 #include "arch/io/network.hpp"
+#include "arch/runtime/work_stealing.hpp"
 #include "arch/timing.hpp"
 #include "client_protocol/protocols.hpp"
 #include "concurrency/pmap.hpp"
+#include "config/args.hpp"
 #include "containers/scoped.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
+#include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/rdb_backtrace.hpp"
 #include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/query_cache.hpp"
 #include "rdb_protocol/query_params.hpp"
 #include "rdb_protocol/response.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 #include "rdb_protocol/term_storage.hpp"
 #include "utils.hpp"
 
@@ -20,6 +30,21 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query_from_buffer(
         scoped_array_t<char> &&buffer, size_t offset,
         ql::query_cache_t *query_cache, int64_t token,
         ql::response_t *error_out) {
+    // If we have already compiled a START query with the same text, we don't have to
+    // parse this one at all. We don't bother with very large queries, which are
+    // mostly writes with literal documents that rarely repeat.
+    std::string query_text;
+    const size_t query_size = strlen(buffer.data() + offset);
+    if (query_size <= QUERY_CACHE_MAX_COMPILED_QUERY_SIZE) {
+        query_text.assign(buffer.data() + offset, query_size);
+        counted_t<const ql::compiled_query_t> compiled_query =
+            query_cache->find_compiled_query(query_text);
+        if (compiled_query.has()) {
+            return make_scoped<ql::query_params_t>(
+                token, query_cache, std::move(compiled_query));
+        }
+    }
+
     rapidjson::Document doc;
     doc.ParseInsitu(buffer.data() + offset);
 
@@ -29,6 +54,7 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query_from_buffer(
             res = make_scoped<ql::query_params_t>(token, query_cache,
                     scoped_ptr_t<ql::term_storage_t>(
                         new ql::json_term_storage_t(std::move(buffer), std::move(doc))));
+            res->compiled_query_key = std::move(query_text);
         } catch (const ql::bt_exc_t &ex) {
             error_out->fill_error(Response::CLIENT_ERROR,
                                   ex.error_type,
@@ -45,7 +71,10 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query_from_buffer(
     return res;
 }
 
-scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
+/* Reads a JSON query off the connection. `protocol_t` determines how errors are sent
+back. */
+template <class protocol_t>
+scoped_ptr_t<ql::query_params_t> read_json_query(
         tcp_conn_t *conn,
         signal_t *interruptor,
         ql::query_cache_t *query_cache) {
@@ -70,7 +99,7 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
             conn->pop(size, &pop_interruptor);
         }
 
-        send_response(&error, token, conn, interruptor);
+        protocol_t::send_response(&error, token, conn, interruptor);
         throw tcp_conn_read_closed_exc_t();
     }
 
@@ -82,124 +111,262 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
     conn->read(data.data(), size, interruptor);
     data[size] = 0; // Null terminate the string, which the json parser requires
 
-    scoped_ptr_t<ql::query_params_t> res =
-        parse_query_from_buffer(std::move(data), 0, query_cache, token, &error);
+    scoped_ptr_t<ql::query_params_t> res = json_protocol_t::parse_query_from_buffer(
+        std::move(data), 0, query_cache, token, &error);
 
     if (!res.has()) {
-        send_response(&error, token, conn, interruptor);
+        protocol_t::send_response(&error, token, conn, interruptor);
     }
     return res;
 }
 
-void write_response_internal(ql::response_t *response,
-                             rapidjson::StringBuffer *buffer_out,
-                             bool throw_errors) {
-    rapidjson::Writer<rapidjson::StringBuffer> writer(*buffer_out);
-    size_t start_offset = buffer_out->GetSize();
+scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
+        tcp_conn_t *conn,
+        signal_t *interruptor,
+        ql::query_cache_t *query_cache) {
+    return read_json_query<json_protocol_t>(conn, interruptor, query_cache);
+}
 
-    try {
-        writer.StartObject();
-        writer.Key("t", 1);
-        writer.Int(response->type());
-        if (response->type() == Response::RUNTIME_ERROR &&
-            response->error_type()) {
-            writer.Key("e", 1);
-            writer.Int(*response->error_type());
+/* Takes the JSON of a large response in pieces (see `JSON_RESPONSE_CHUNK_SIZE`), so
+that it doesn't have to be kept in one buffer. */
+class json_chunk_sink_t {
+public:
+    virtual ~json_chunk_sink_t() { }
+    virtual void consume(const char *data, size_t size) = 0;
+};
+
+// The stack space to have left before recursing into an element of a datum
+const size_t MIN_JSON_CHUNK_STACK_SPACE = 16 * KILOBYTE;
+
+/* Like `datum_t::write_json`, but calls `maybe_flush` after every element of in-memory
+arrays and objects, at any depth.  That's where big results like a `coerce_to('array')`
+or a `group` come from.  Serialized arrays and objects are written in one go from their
+buffer, like `write_json` does; they're already in memory in a form that isn't much
+smaller than their JSON. */
+void write_json_in_chunks(const ql::datum_t &datum,
+                          rapidjson::Writer<rapidjson::StringBuffer> *writer,
+                          const std::function<void()> &maybe_flush) {
+    if (datum.get_buf_ref() != nullptr) {
+        datum.write_json(writer);
+        return;
+    }
+    if (datum.get_type() == ql::datum_t::R_ARRAY) {
+        writer->StartArray();
+        const size_t size = datum.arr_size();
+        for (size_t i = 0; i < size; ++i) {
+            call_with_enough_stack([&]() {
+                    write_json_in_chunks(datum.get(i), writer, maybe_flush);
+                }, MIN_JSON_CHUNK_STACK_SPACE);
+            maybe_flush();
+        }
+        writer->EndArray();
+    } else if (datum.get_type() == ql::datum_t::R_OBJECT) {
+        writer->StartObject();
+        const size_t size = datum.obj_size();
+        for (size_t i = 0; i < size; ++i) {
+            auto pair = datum.get_pair(i);
+            writer->Key(pair.first.data(), pair.first.size());
+            call_with_enough_stack([&]() {
+                    write_json_in_chunks(pair.second, writer, maybe_flush);
+                }, MIN_JSON_CHUNK_STACK_SPACE);
+            maybe_flush();
+        }
+        writer->EndObject();
+    } else {
+        datum.write_json(writer);
+    }
+}
+
+/* Writes the JSON of `response` to `buffer`.  If `sink` isn't null, it gets the
+contents of the buffer whenever they reach `JSON_RESPONSE_CHUNK_SIZE`.  If
+`any_thread` is false, the sink has to run on this thread, so the datums aren't
+encoded on other threads. */
+void write_response_json(ql::response_t *response,
+                         rapidjson::StringBuffer *buffer,
+                         json_chunk_sink_t *sink,
+                         bool any_thread) {
+    rapidjson::Writer<rapidjson::StringBuffer> writer(*buffer);
+    const std::function<void()> maybe_flush = [&]() {
+        if (sink != nullptr && buffer->GetSize() >= JSON_RESPONSE_CHUNK_SIZE) {
+            sink->consume(buffer->GetString(), buffer->GetSize());
+            buffer->Clear();
         }
+    };
+    const auto write_item = [&](const ql::datum_t &item) {
+        if (sink != nullptr) {
+            write_json_in_chunks(item, &writer, maybe_flush);
+            maybe_flush();
+        } else {
+            item.write_json(&writer);
+        }
+    };
 
-        writer.Key("r", 1);
-        writer.StartArray();
-        const size_t PARALLELIZATION_THRESHOLD = 500;
-        if (response->data().size() > PARALLELIZATION_THRESHOLD) {
-            int64_t num_threads = std::min<int64_t>(16, get_num_db_threads());
-            int32_t thread_offset = get_thread_id().threadnum;
-            std::vector<rapidjson::StringBuffer> buffers(num_threads);
-
-            size_t per_thread = response->data().size() / num_threads;
-            pmap(num_threads, [&](int64_t m) {
-                    int32_t target_thread =
-                        (thread_offset + static_cast<int32_t>(m)) % get_num_db_threads();
-                    on_thread_t rethreader((threadnum_t(target_thread)));
-                    rapidjson::StringBuffer *thread_buffer = &buffers[m];
-                    rapidjson::Writer<rapidjson::StringBuffer>
-                        thread_writer(*thread_buffer);
-
-                    thread_writer.StartArray();
-                    size_t offset = per_thread * m;
-                    size_t end = (m == num_threads - 1) ?
-                        response->data().size() : (per_thread * (m + 1));
-
-                    for (size_t i = offset; i < end; ++i) {
-                        const size_t YIELD_INTERVAL = 2000;
-                        if ((i + 1) % YIELD_INTERVAL == 0) {
-                            coro_t::yield();
-                        }
-                        response->data()[i].write_json(&thread_writer);
+    writer.StartObject();
+    writer.Key("t", 1);
+    writer.Int(response->type());
+    if (response->type() == Response::RUNTIME_ERROR &&
+        response->error_type()) {
+        writer.Key("e", 1);
+        writer.Int(*response->error_type());
+    }
+
+    writer.Key("r", 1);
+    writer.StartArray();
+    const size_t PARALLELIZATION_THRESHOLD = 500;
+    if (any_thread && response->data().size() > PARALLELIZATION_THRESHOLD) {
+        // Batches with this many items are bounded in size, so the buffers of the
+        // threads don't need to be passed to `sink`.
+        int64_t num_threads = std::min<int64_t>(16, get_num_db_threads());
+        int32_t thread_offset = get_thread_id().threadnum;
+        std::vector<rapidjson::StringBuffer> buffers(num_threads);
+
+        size_t per_thread = response->data().size() / num_threads;
+        pmap(num_threads, [&](int64_t m) {
+                int32_t target_thread =
+                    (thread_offset + static_cast<int32_t>(m)) % get_num_db_threads();
+                on_thread_t rethreader((threadnum_t(target_thread)));
+                rapidjson::StringBuffer *thread_buffer = &buffers[m];
+                rapidjson::Writer<rapidjson::StringBuffer>
+                    thread_writer(*thread_buffer);
+
+                thread_writer.StartArray();
+                size_t offset = per_thread * m;
+                size_t end = (m == num_threads - 1) ?
+                    response->data().size() : (per_thread * (m + 1));
+
+                for (size_t i = offset; i < end; ++i) {
+                    const size_t YIELD_INTERVAL = 2000;
+                    if ((i + 1) % YIELD_INTERVAL == 0) {
+                        coro_t::yield();
                     }
+                    response->data()[i].write_json(&thread_writer);
+                }
 
-                    thread_writer.EndArray();
-                });
+                thread_writer.EndArray();
+            });
 
-            for (const auto &buffer : buffers) {
-                writer.SpliceArray(buffer);
-            }
-        } else {
+        for (const auto &thread_buffer : buffers) {
+            writer.SpliceArray(thread_buffer);
+            maybe_flush();
+        }
+    } else if (any_thread && response->data().size() >= WORK_STEALING_MIN_ITEMS) {
+        // Encoding datums doesn't depend on the thread, so if ours is busy
+        // another one may do it.
+        run_stealable([&]() {
             for (const auto &item : response->data()) {
-                item.write_json(&writer);
+                write_item(item);
             }
+        });
+    } else {
+        for (const auto &item : response->data()) {
+            write_item(item);
         }
-        writer.EndArray();
-        if (response->backtrace()) {
-            writer.Key("b", 1);
-            response->backtrace()->write_json(&writer);
-        }
-        if (response->profile()) {
-            writer.Key("p", 1);
-            response->profile()->write_json(&writer);
+    }
+    writer.EndArray();
+    if (response->backtrace()) {
+        writer.Key("b", 1);
+        response->backtrace()->write_json(&writer);
+    }
+    if (response->profile()) {
+        writer.Key("p", 1);
+        response->profile()->write_json(&writer);
+    }
+    if (response->type() == Response::SUCCESS_PARTIAL ||
+        response->type() == Response::SUCCESS_SEQUENCE) {
+        writer.Key("n", 1);
+        writer.StartArray();
+        for (const auto &note : response->notes()) {
+            writer.Int(note);
         }
-        if (response->type() == Response::SUCCESS_PARTIAL ||
-            response->type() == Response::SUCCESS_SEQUENCE) {
-            writer.Key("n", 1);
-            writer.StartArray();
-            for (const auto &note : response->notes()) {
-                writer.Int(note);
-            }
-            writer.EndArray();
+        writer.EndArray();
+    }
+    writer.EndObject();
+    guarantee(writer.IsComplete());
+}
+
+/* Counts the bytes of a response's JSON without keeping them. */
+class json_size_counter_t : public json_chunk_sink_t {
+public:
+    json_size_counter_t() : size(0) { }
+    void consume(UNUSED const char *data, size_t _size) {
+        size += _size;
+    }
+    size_t size;
+};
+
+/* Writes what it's given to `conn`. */
+class json_conn_sink_t : public json_chunk_sink_t {
+public:
+    json_conn_sink_t(tcp_conn_t *_conn, signal_t *_interruptor)
+        : conn(_conn), interruptor(_interruptor), size(0) { }
+    void consume(const char *data, size_t _size) {
+        conn->write(data, _size, interruptor);
+        size += _size;
+    }
+    tcp_conn_t *conn;
+    signal_t *interruptor;
+    size_t size;
+};
+
+/* Writes the JSON of `response` after what's already in `buffer_out`, or the JSON of
+an error response if that fails.  `counter` is like `sink` for `write_response_json`,
+except that it gets reset if the response is replaced by an error. */
+void write_response_internal(ql::response_t *response,
+                             rapidjson::StringBuffer *buffer_out,
+                             bool throw_errors,
+                             json_size_counter_t *counter = nullptr) {
+    size_t start_offset = buffer_out->GetSize();
+    // Puts the buffer back the way it was, before an error gets written to it.
+    auto restart = [&]() {
+        if (counter != nullptr && counter->size > 0) {
+            counter->size = 0;
+            buffer_out->Clear();
+            buffer_out->Push(start_offset);
+        } else {
+            buffer_out->Pop(buffer_out->GetSize() - start_offset);
         }
-        writer.EndObject();
-        guarantee(writer.IsComplete());
+    };
+
+    try {
+        write_response_json(response, buffer_out, counter, true);
     } catch (const ql::base_exc_t &ex) {
-        buffer_out->Pop(buffer_out->GetSize() - start_offset);
+        restart();
         response->fill_error(Response::RUNTIME_ERROR, Response::QUERY_LOGIC,
                              ex.what(), ql::backtrace_registry_t::EMPTY_BACKTRACE);
-        write_response_internal(response, buffer_out, true);
+        write_response_internal(response, buffer_out, true, counter);
     } catch (const std::exception &ex) {
         if (throw_errors) {
             throw;
         }
 
-        buffer_out->Pop(buffer_out->GetSize() - start_offset);
+        restart();
         response->fill_error(Response::RUNTIME_ERROR, Response::INTERNAL,
             strprintf("Internal error in json_protocol_t::write: %s", ex.what()),
             ql::backtrace_registry_t::EMPTY_BACKTRACE);
-        write_response_internal(response, buffer_out, true);
+        write_response_internal(response, buffer_out, true, counter);
     }
 }
 
 // Small wrapper - in debug mode we would rather crash than send the error back
-void json_protocol_t::write_response_to_buffer(ql::response_t *response,
-                                               rapidjson::StringBuffer *buffer_out) {
+void write_response_checked(ql::response_t *response,
+                            rapidjson::StringBuffer *buffer_out,
+                            json_size_counter_t *counter) {
 #ifdef NDEBUG
-    write_response_internal(response, buffer_out, false);
+    write_response_internal(response, buffer_out, false, counter);
 #else
-    write_response_internal(response, buffer_out, true);
+    write_response_internal(response, buffer_out, true, counter);
 #endif
 }
 
-void json_protocol_t::send_response(ql::response_t *response,
-                                    int64_t token,
-                                    tcp_conn_t *conn,
-                                    signal_t *interruptor) {
+void json_protocol_t::write_response_to_buffer(ql::response_t *response,
+                                               rapidjson::StringBuffer *buffer_out) {
+    write_response_checked(response, buffer_out, nullptr);
+}
+
+size_t json_protocol_t::write_response(ql::response_t *response,
+                                     int64_t token,
+                                     tcp_conn_t *conn,
+                                     signal_t *interruptor) {
     uint32_t data_size; // filled in below
     const size_t prefix_size = sizeof(token) + sizeof(data_size);
 
@@ -207,8 +374,13 @@ void json_protocol_t::send_response(ql::response_t *response,
     rapidjson::StringBuffer buffer;
     buffer.Push(prefix_size);
 
-    write_response_to_buffer(response, &buffer);
-    int64_t payload_size = buffer.GetSize() - prefix_size;
+    // If the response gets too large, this only counts its bytes, and it gets encoded
+    // again below.
+    json_size_counter_t counter;
+    write_response_checked(response, &buffer, &counter);
+    const bool streamed = counter.size > 0;
+    const size_t total_size = counter.size + buffer.GetSize();
+    int64_t payload_size = total_size - prefix_size;
     guarantee(payload_size > 0);
 
     static_assert(std::is_same<decltype(wire_protocol_t::TOO_LARGE_RESPONSE_SIZE),
@@ -220,8 +392,12 @@ void json_protocol_t::send_response(ql::response_t *response,
                              Response::RESOURCE_LIMIT,
                              wire_protocol_t::too_large_response_message(payload_size),
                              ql::backtrace_registry_t::EMPTY_BACKTRACE);
-        send_response(response, token, conn, interruptor);
-        return;
+        return write_response(response, token, conn, interruptor);
+    }
+
+    if (streamed) {
+        buffer.Clear();
+        buffer.Push(prefix_size);
     }
 
     // Fill in the token and size
@@ -236,6 +412,113 @@ void json_protocol_t::send_response(ql::response_t *response,
             reinterpret_cast<const char *>(&data_size)[i];
     }
 
-    conn->write(buffer.GetString(), buffer.GetSize(), interruptor);
+    if (streamed) {
+        // The first encoding went through, so this one can't fail either.
+        json_conn_sink_t sink(conn, interruptor);
+        write_response_json(response, &buffer, &sink, false);
+        sink.consume(buffer.GetString(), buffer.GetSize());
+        guarantee(sink.size == total_size,
+                  "The JSON of a response changed while it was being written.");
+        return total_size;
+    }
+
+    if (buffer.GetSize() >= UNBUFFERED_WRITE_MIN_SIZE) {
+        conn->write(buffer.GetString(), buffer.GetSize(), interruptor);
+    } else {
+        conn->write_buffered(buffer.GetString(), buffer.GetSize(), interruptor);
+    }
+    return buffer.GetSize();
+}
+
+void json_protocol_t::send_response(ql::response_t *response,
+                                    int64_t token,
+                                    tcp_conn_t *conn,
+                                    signal_t *interruptor) {
+    write_response(response, token, conn, interruptor);
+    conn->flush_buffer(interruptor);
+}
+
+
+scoped_ptr_t<ql::query_params_t> binary_response_protocol_t::parse_query(
+        tcp_conn_t *conn,
+        signal_t *interruptor,
+        ql::query_cache_t *query_cache) {
+    return read_json_query<binary_response_protocol_t>(conn, interruptor, query_cache);
+}
+
+static ql::datum_t response_to_datum(const ql::response_t *response) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("t", ql::datum_t(static_cast<double>(response->type())));
+    if (response->type() == Response::RUNTIME_ERROR && response->error_type()) {
+        builder.overwrite("e",
+            ql::datum_t(static_cast<double>(*response->error_type())));
+    }
+    std::vector<ql::datum_t> data = response->data();
+    builder.overwrite("r", ql::datum_t(std::move(data),
+        ql::datum_t::no_array_size_limit_check_t()));
+    if (response->backtrace()) {
+        builder.overwrite("b", *response->backtrace());
+    }
+    if (response->profile()) {
+        builder.overwrite("p", *response->profile());
+    }
+    if (response->type() == Response::SUCCESS_PARTIAL ||
+        response->type() == Response::SUCCESS_SEQUENCE) {
+        std::vector<ql::datum_t> notes;
+        for (const auto &note : response->notes()) {
+            notes.push_back(ql::datum_t(static_cast<double>(note)));
+        }
+        builder.overwrite("n", ql::datum_t(std::move(notes),
+            ql::datum_t::no_array_size_limit_check_t()));
+    }
+    return std::move(builder).to_datum();
+}
+
+size_t binary_response_protocol_t::write_response(ql::response_t *response,
+                                                int64_t token,
+                                                tcp_conn_t *conn,
+                                                signal_t *interruptor) {
+    write_message_t wm;
+    /* With `check_datum_serialization_errors_t::NO`, objects and arrays that are still
+    in their serialized form get appended to `wm` without being taken apart. */
+    ql::datum_serialize(&wm, response_to_datum(response),
+                    ql::check_datum_serialization_errors_t::NO);
+    const size_t payload_size = wm.size();
+
+    if (payload_size >= wire_protocol_t::TOO_LARGE_RESPONSE_SIZE) {
+        response->fill_error(Response::RUNTIME_ERROR,
+                             Response::RESOURCE_LIMIT,
+                             wire_protocol_t::too_large_response_message(payload_size),
+                             ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        return write_response(response, token, conn, interruptor);
+    }
+
+    const uint32_t data_size = static_cast<uint32_t>(payload_size);
+    conn->write_buffered(&token, sizeof(token), interruptor);
+    conn->write_buffered(&data_size, sizeof(data_size), interruptor);
+    if (payload_size >= UNBUFFERED_WRITE_MIN_SIZE) {
+        // Hand `wm`'s buffers to the socket instead of copying them.
+        std::vector<const_charslice> buffers;
+        for (write_buffer_t *buf = wm.unsafe_expose_buffers()->head();
+             buf != nullptr;
+             buf = wm.unsafe_expose_buffers()->next(buf)) {
+            buffers.push_back(const_charslice(buf->data, buf->data + buf->size));
+        }
+        conn->write_gathered(buffers, interruptor);
+    } else {
+        for (write_buffer_t *buf = wm.unsafe_expose_buffers()->head();
+             buf != nullptr;
+             buf = wm.unsafe_expose_buffers()->next(buf)) {
+            conn->write_buffered(buf->data, buf->size, interruptor);
+        }
+    }
+    return sizeof(token) + sizeof(data_size) + payload_size;
 }
 
+void binary_response_protocol_t::send_response(ql::response_t *response,
+                                               int64_t token,
+                                               tcp_conn_t *conn,
+                                               signal_t *interruptor) {
+    write_response(response, token, conn, interruptor);
+    conn->flush_buffer(interruptor);
+}
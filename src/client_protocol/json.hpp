@@ -33,6 +33,42 @@ public:
     static void write_response_to_buffer(ql::response_t *response,
                                          rapidjson::StringBuffer *buffer_out);
 
+    // Writes the response into `conn`'s write buffer.  The caller has to flush it
+    // eventually, which lets responses that are ready at the same time share a write.
+    // Returns the number of bytes written.
+    static size_t write_response(ql::response_t *response,
+                               int64_t token,
+                               tcp_conn_t *conn,
+                               signal_t *interruptor);
+
+    // Like `write_response`, but flushes right away.
+    static void send_response(ql::response_t *response,
+                              int64_t token,
+                              tcp_conn_t *conn,
+                              signal_t *interruptor);
+};
+
+/* Clients that ask for `protocol_version` 1 in the handshake still send their queries as
+JSON, but get their responses in the same format as a `datum_t` on disk (see
+`rdb_protocol/serialize_datum.cc`): a `BUF_R_OBJECT` with the same fields as the JSON
+response. Encoding and decoding it takes much less CPU than JSON, and rows that were
+read from disk get copied into the response as they are. Each response is framed by the
+token and the size, as in the JSON protocol. */
+class binary_response_protocol_t {
+public:
+    static scoped_ptr_t<ql::query_params_t> parse_query(tcp_conn_t *conn,
+                                                        signal_t *interruptor,
+                                                        ql::query_cache_t *query_cache);
+
+    // Writes the response into `conn`'s write buffer.  The caller has to flush it
+    // eventually, which lets responses that are ready at the same time share a write.
+    // Returns the number of bytes written.
+    static size_t write_response(ql::response_t *response,
+                               int64_t token,
+                               tcp_conn_t *conn,
+                               signal_t *interruptor);
+
+    // Like `write_response`, but flushes right away.
     static void send_response(ql::response_t *response,
                               int64_t token,
                               tcp_conn_t *conn,
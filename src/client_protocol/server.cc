@@ -189,23 +189,35 @@ size_t http_conn_cache_t::sha_hasher_t::operator()(const conn_key_t &x) const {
 query_server_t::query_server_t(rdb_context_t *_rdb_ctx,
                                const std::set<ip_address_t> &local_addresses,
                                int port,
+                               const optional<std::string> &unix_socket_path,
                                query_handler_t *_handler,
                                uint32_t http_timeout_sec,
                                tls_ctx_t *_tls_ctx) :
         tls_ctx(_tls_ctx),
         rdb_ctx(_rdb_ctx),
         handler(_handler),
+        thread_loads(get_num_db_threads()),
         http_conn_cache(http_timeout_sec),
         next_thread(0) {
     rassert(rdb_ctx != nullptr);
     try {
         tcp_listener.init(new tcp_listener_t(local_addresses, port,
             std::bind(&query_server_t::handle_conn,
-                      this, ph::_1, auto_drainer_t::lock_t(&drainer))));
+                      this, ph::_1, tls_ctx, auto_drainer_t::lock_t(&drainer))));
     } catch (const address_in_use_exc_t &ex) {
         throw address_in_use_exc_t(
             strprintf("Could not bind to RDB protocol port: %s", ex.what()));
     }
+    if (unix_socket_path.has_value()) {
+#ifdef _WIN32
+        throw address_in_use_exc_t(
+            "Unix domain sockets for client drivers aren't supported on Windows.");
+#else
+        unix_socket_listener.init(new tcp_listener_t(*unix_socket_path,
+            std::bind(&query_server_t::handle_conn,
+                      this, ph::_1, nullptr, auto_drainer_t::lock_t(&drainer))));
+#endif
+    }
 }
 
 query_server_t::~query_server_t() { }
@@ -249,10 +261,50 @@ ql::datum_t read_datum(tcp_conn_t *connection, signal_t *interruptor) {
     }
 }
 
+/* Counts something towards a thread's load while it exists. */
+class scoped_load_counter_t {
+public:
+    explicit scoped_load_counter_t(std::atomic<int64_t> *_counter) : counter(_counter) {
+        ++*counter;
+    }
+    ~scoped_load_counter_t() {
+        --*counter;
+    }
+private:
+    std::atomic<int64_t> *counter;
+    DISABLE_COPYING(scoped_load_counter_t);
+};
+
+threadnum_t query_server_t::choose_connection_thread() {
+    // Start looking at `next_thread`, so that we still go round-robin when all the
+    // threads are equally busy.
+    const int num_threads = get_num_db_threads();
+    int best_thread = next_thread;
+    int64_t best_queries = thread_loads[best_thread].value.active_queries;
+    int64_t best_connections = thread_loads[best_thread].value.connections;
+    for (int i = 1; i < num_threads; ++i) {
+        const int thread = (next_thread + i) % num_threads;
+        const int64_t queries = thread_loads[thread].value.active_queries;
+        const int64_t connections = thread_loads[thread].value.connections;
+        if (queries < best_queries
+            || (queries == best_queries && connections < best_connections)) {
+            best_thread = thread;
+            best_queries = queries;
+            best_connections = connections;
+        }
+    }
+    next_thread = (best_thread + 1) % num_threads;
+    return threadnum_t(best_thread);
+}
+
 void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
+                                 tls_ctx_t *conn_tls_ctx,
                                  auto_drainer_t::lock_t keepalive) {
-    threadnum_t chosen_thread = threadnum_t(next_thread);
-    next_thread = (next_thread + 1) % get_num_db_threads();
+    threadnum_t chosen_thread = choose_connection_thread();
+    // Count the connection right away, so that connections that arrive at the same
+    // time don't all pick the same thread.
+    scoped_load_counter_t connection_load(
+        &thread_loads[chosen_thread.threadnum].value.connections);
 
     cross_thread_signal_t ct_keepalive(keepalive.get_drain_signal(), chosen_thread);
     on_thread_t rethreader(chosen_thread);
@@ -260,7 +312,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
     scoped_ptr_t<tcp_conn_t> conn;
 
     try {
-        nconn->make_server_connection(tls_ctx, &conn, &ct_keepalive);
+        nconn->make_server_connection(conn_tls_ctx, &conn, &ct_keepalive);
     } catch (const interrupted_exc_t &) {
         // TLS handshake was interrupted.
         return;
@@ -271,6 +323,10 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
     }
 
     uint8_t version = 0;
+    /* Protocol version 1 of the `V1_0` handshake is the same as 0, except that the
+    server sends responses in the binary format of `binary_response_protocol_t`. */
+    const int max_protocol_version = 1;
+    bool binary_responses = false;
     std::unique_ptr<auth::base_authenticator_t> authenticator;
     uint32_t error_code = 0;
     std::string error_message;
@@ -357,7 +413,9 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
             {
                 ql::datum_object_builder_t datum_object_builder;
                 datum_object_builder.overwrite("success", ql::datum_t::boolean(true));
-                datum_object_builder.overwrite("max_protocol_version", ql::datum_t(0.0));
+                datum_object_builder.overwrite(
+                    "max_protocol_version",
+                    ql::datum_t(static_cast<double>(max_protocol_version)));
                 datum_object_builder.overwrite("min_protocol_version", ql::datum_t(0.0));
                 datum_object_builder.overwrite(
                     "server_version", ql::datum_t(RETHINKDB_VERSION));
@@ -377,10 +435,12 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                     throw client_protocol::client_server_error_t(
                         1, "Expected a number for `protocol_version`.");
                 }
-                if (protocol_version.as_num() != 0.0) {
+                if (protocol_version.as_num() != 0.0 &&
+                        protocol_version.as_num() != max_protocol_version) {
                     throw client_protocol::client_server_error_t(
                         2, "Unsupported `protocol_version`.");
                 }
+                binary_responses = protocol_version.as_num() == max_protocol_version;
 
                 ql::datum_t authentication_method =
                     datum.get_field("authentication_method", ql::NOTHROW);
@@ -449,13 +509,18 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                 : ql::return_empty_normal_batches_t::NO,
             auth::user_context_t(authenticator->get_authenticated_username()));
 
-        connection_loop<json_protocol_t>(
-            conn.get(),
-            (version < 4)
-                ? 1
-                : 1024,
-            &query_cache,
-            &ct_keepalive);
+        if (binary_responses) {
+            connection_loop<binary_response_protocol_t>(
+                conn.get(), 1024, &query_cache, &ct_keepalive);
+        } else {
+            connection_loop<json_protocol_t>(
+                conn.get(),
+                (version < 4)
+                    ? 1
+                    : 1024,
+                &query_cache,
+                &ct_keepalive);
+        }
     } catch (client_protocol::client_server_error_t const &error) {
         // We can't write the response here due to coroutine switching inside an
         // exception handler
@@ -549,6 +614,47 @@ void save_exception(std::exception_ptr *err,
     }
 }
 
+/* Writes the responses of the queries that run in parallel on one connection.  Responses
+that become ready while another response is being written line up on the mutex, and
+only the last one in line flushes the connection's write buffer.  That way responses
+that complete at about the same time go out in as few writes as possible, instead of
+one write each.  A response that gets interrupted while it's in line can leave the
+responses ahead of it unflushed, but then the connection is going away anyway. */
+template <class protocol_t>
+class response_sender_t {
+public:
+    explicit response_sender_t(tcp_conn_t *_conn) : conn(_conn), num_in_line(0) { }
+
+    // Returns the number of bytes written.
+    size_t send(ql::response_t *response,
+                int64_t token,
+                signal_t *lock_interruptor,
+                signal_t *write_interruptor) {
+        new_mutex_in_line_t in_line(&mutex);
+        ++num_in_line;
+        try {
+            wait_interruptible(in_line.acq_signal(), lock_interruptor);
+        } catch (const interrupted_exc_t &) {
+            --num_in_line;
+            throw;
+        }
+        --num_in_line;
+        const size_t size =
+            protocol_t::write_response(response, token, conn, write_interruptor);
+        if (num_in_line == 0) {
+            conn->flush_buffer(write_interruptor);
+        }
+        return size;
+    }
+
+private:
+    tcp_conn_t *conn;
+    new_mutex_t mutex;
+    size_t num_in_line;
+
+    DISABLE_COPYING(response_sender_t);
+};
+
 template <class protocol_t>
 void query_server_t::connection_loop(tcp_conn_t *conn,
                                      size_t max_concurrent_queries,
@@ -557,7 +663,7 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
     std::exception_ptr err;
     std::string err_str;
     cond_t abort;
-    new_mutex_t send_mutex;
+    response_sender_t<protocol_t> sender(conn);
     scoped_perfmon_counter_t connection_counter(&rdb_ctx->stats.client_connections);
 
 #ifdef __linux
@@ -586,23 +692,27 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
                                           &interruptor);
                 ql::response_t response;
                 bool replied = false;
+                scoped_load_counter_t query_load(
+                    &thread_loads[get_thread_id().threadnum].value.active_queries);
+                scoped_perfmon_counter_t query_counter(
+                    &rdb_ctx->stats.thread_queries_active);
 
                 save_exception(&err, &err_str, &abort, [&]() {
                     handler->run_query(query.get(), &response, &cb_interruptor);
+                    size_t bytes_sent = 0;
                     if (!query->noreply) {
-                        new_mutex_acq_t send_lock(&send_mutex, &cb_interruptor);
-                        protocol_t::send_response(&response, query->token,
-                                                  conn, &cb_interruptor);
+                        bytes_sent = sender.send(&response, query->token,
+                                                 &cb_interruptor, &cb_interruptor);
                         replied = true;
                     }
+                    query_cache->note_response_sent(query.get(), bytes_sent);
                 });
                 save_exception(&err, &err_str, &abort, [&]() {
                     if (!replied && !query->noreply) {
                         make_error_response(drain_signal->is_pulsed(), *conn,
                                             err_str, &response);
-                        new_mutex_acq_t send_lock(&send_mutex, drain_signal);
-                        protocol_t::send_response(&response, query->token,
-                                                  conn, &cb_interruptor);
+                        sender.send(&response, query->token,
+                                    drain_signal, &cb_interruptor);
                     }
                 });
             });
@@ -668,17 +778,17 @@ void query_server_t::handle(const http_req_t &req,
 
     ql::response_t response;
     counted_t<http_conn_cache_t::http_conn_t> conn = http_conn_cache.find(conn_id);
+    scoped_ptr_t<ql::query_params_t> query;
     if (!conn.has()) {
         response.fill_error(Response::CLIENT_ERROR, Response::INTERNAL,
                             "This HTTP connection is not open.",
                             ql::backtrace_registry_t::EMPTY_BACKTRACE);
     } else {
-        scoped_ptr_t<ql::query_params_t> query =
-            json_protocol_t::parse_query_from_buffer(std::move(body_buf),
-                                                     sizeof(token),
-                                                     conn->get_query_cache(),
-                                                     token,
-                                                     &response);
+        query = json_protocol_t::parse_query_from_buffer(std::move(body_buf),
+                                                         sizeof(token),
+                                                         conn->get_query_cache(),
+                                                         token,
+                                                         &response);
 
         if (query.has()) {
             // Check for noreply, which we don't support here, as it causes
@@ -748,6 +858,9 @@ void query_server_t::handle(const http_req_t &req,
     body_data.reserve(sizeof(header_buffer) + buffer.GetSize());
     body_data.append(&header_buffer[0], sizeof(header_buffer));
     body_data.append(buffer.GetString(), buffer.GetSize());
+    if (query.has()) {
+        conn->get_query_cache()->note_response_sent(query.get(), body_data.size());
+    }
     result->set_body("application/octet-stream", body_data);
     result->code = http_status_code_t::OK;
 }
@@ -2,6 +2,7 @@
 #ifndef CLIENT_PROTOCOL_SERVER_HPP_
 #define CLIENT_PROTOCOL_SERVER_HPP_
 
+#include <atomic>
 #include <set>
 #include <map>
 #include <memory>
@@ -15,9 +16,12 @@
 #include "arch/runtime/runtime.hpp"
 #include "arch/timing.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/cache_line_padded.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "containers/archive/archive.hpp"
 #include "containers/counted.hpp"
+#include "containers/optional.hpp"
+#include "containers/scoped.hpp"
 #include "http/http.hpp"
 #include "perfmon/perfmon.hpp"
 #include "utils.hpp"
@@ -101,6 +105,7 @@ public:
         rdb_context_t *rdb_ctx,
         const std::set<ip_address_t> &local_addresses,
         int port,
+        const optional<std::string> &unix_socket_path,
         query_handler_t *_handler,
         uint32_t http_timeout_sec,
         tls_ctx_t* tls_ctx);
@@ -114,11 +119,16 @@ private:
                              const std::string &err,
                              ql::response_t *response_out);
 
-    // For the client driver socket
+    // For the client driver sockets.  `conn_tls_ctx` is null for connections that
+    // don't use TLS, which includes those over the Unix domain socket.
     void handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
+                     tls_ctx_t *conn_tls_ctx,
                      auto_drainer_t::lock_t);
 
-    // This is templatized based on the wire protocol requested by the client
+    // This is templatized based on the wire protocol requested by the client.  Runs up
+    // to `max_concurrent_queries` queries at once, and sends every response as soon
+    // as its query is done, so responses may go out in a different order than the
+    // queries came in.  Clients match them up by their tokens.
     template<class protocol_t>
     void connection_loop(tcp_conn_t *conn,
                          size_t max_concurrent_queries,
@@ -130,14 +140,31 @@ private:
                 http_res_t *result,
                 signal_t *interruptor);
 
+    // Picks the thread for a new client connection.  See `thread_load_t`.
+    threadnum_t choose_connection_thread();
+
     tls_ctx_t *tls_ctx;
     rdb_context_t *const rdb_ctx;
     query_handler_t *const handler;
 
+    /* How busy each thread is with client connections.  New connections go to the
+    thread with the fewest running queries, and among those to the one with the fewest
+    connections.  Connections stay on their thread, so this can't fix a thread that
+    already has too many busy connections, but it keeps new connections away from it.
+    These are read from the listener's thread, hence the atomics. */
+    struct thread_load_t {
+        thread_load_t() : active_queries(0), connections(0) { }
+        std::atomic<int64_t> active_queries;
+        std::atomic<int64_t> connections;
+    };
+    scoped_array_t<cache_line_padded_t<thread_load_t> > thread_loads;
+
     /* WARNING: The order here is fragile. */
     auto_drainer_t drainer;
     http_conn_cache_t http_conn_cache;
     scoped_ptr_t<tcp_listener_t> tcp_listener;
+    // For drivers on the same host; they skip the TCP stack, and TLS.
+    scoped_ptr_t<tcp_listener_t> unix_socket_listener;
 
     int next_thread;
 };
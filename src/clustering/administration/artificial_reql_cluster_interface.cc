@@ -106,6 +106,7 @@ bool artificial_reql_cluster_interface_t::table_create(
         counted_t<const ql::db_t> db,
         const table_generate_config_params_t &config_params,
         const std::string &primary_key,
+        key_generation_t key_generation,
         write_durability_t durability,
         signal_t *interruptor,
         ql::datum_t *result_out,
@@ -123,6 +124,7 @@ bool artificial_reql_cluster_interface_t::table_create(
         db,
         config_params,
         primary_key,
+        key_generation,
         durability,
         interruptor,
         result_out,
@@ -757,6 +759,7 @@ artificial_reql_cluster_backends_t::artificial_reql_cluster_backends_t(
                 name_resolver,
                 directory_map_view,
                 server_config_client,
+                mailbox_manager->get_connectivity_cluster(),
                 static_cast<admin_identifier_format_t>(format)));
     }
     server_status_sentry = backend_sentry_t(
@@ -1,14 +1,67 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/administration/auth/plaintext_authenticator.hpp"
 
+#include <array>
+#include <map>
+#include <utility>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "arch/spinlock.hpp"
 #include "clustering/administration/auth/authentication_error.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "crypto/compare_equal.hpp"
+#include "crypto/hmac.hpp"
 #include "crypto/pbkcs5_pbkdf2_hmac.hpp"
+#include "crypto/random.hpp"
 #include "crypto/saslprep.hpp"
 
 namespace auth {
 
+/* Remembers the passwords that recently authenticated each user, so that clients that
+reconnect over and over don't make us run PBKDF2 every time.  Instead of the passwords
+we keep their HMACs with a random key that never leaves this process.  An entry only
+counts as long as the user's `password_t` is still the one it got checked against, so
+changing the password invalidates it. */
+class verified_password_cache_t {
+public:
+    verified_password_cache_t() : key(crypto::random_bytes<SHA256_DIGEST_LENGTH>()) { }
+
+    bool is_verified(username_t const &username,
+                     password_t const &password,
+                     std::string const &plaintext) {
+        std::array<unsigned char, SHA256_DIGEST_LENGTH> verifier =
+            crypto::hmac_sha256(key, plaintext);
+        spinlock_acq_t acq(&lock);
+        auto it = entries.find(username);
+        return it != entries.end()
+            && it->second.first == password
+            && crypto::compare_equal(it->second.second, verifier);
+    }
+
+    void set_verified(username_t const &username,
+                      password_t const &password,
+                      std::string const &plaintext) {
+        std::array<unsigned char, SHA256_DIGEST_LENGTH> verifier =
+            crypto::hmac_sha256(key, plaintext);
+        spinlock_acq_t acq(&lock);
+        entries[username] = std::make_pair(password, verifier);
+    }
+
+private:
+    const std::array<unsigned char, SHA256_DIGEST_LENGTH> key;
+    spinlock_t lock;
+    std::map<username_t,
+             std::pair<password_t, std::array<unsigned char, SHA256_DIGEST_LENGTH> > >
+        entries;
+
+    DISABLE_COPYING(verified_password_cache_t);
+};
+
+verified_password_cache_t *get_verified_password_cache() {
+    static verified_password_cache_t cache;
+    return &cache;
+}
+
 plaintext_authenticator_t::plaintext_authenticator_t(
         clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> auth_watchable,
         username_t const &username)
@@ -34,14 +87,29 @@ plaintext_authenticator_t::plaintext_authenticator_t(
         throw authentication_error_t(17, "Unknown user");
     }
 
-    std::array<unsigned char, SHA256_DIGEST_LENGTH> hash =
-        crypto::pbkcs5_pbkdf2_hmac_sha256(
-            crypto::saslprep(password),
-            user->get_password().get_salt(),
-            user->get_password().get_iteration_count());
+    password_t const &user_password = user->get_password();
+    std::string prepared_password = crypto::saslprep(password);
+    if (user_password.is_empty() && prepared_password.empty()) {
+        // This is the common case of the `admin` user without a password, for which
+        // there's nothing to derive.
+    } else if (!get_verified_password_cache()->is_verified(
+            m_username, user_password, prepared_password)) {
+        // PBKDF2 takes long enough that it would hold up the other connections on
+        // this thread, so we run it in the blocker pool.  That pool has a fixed number
+        // of threads, which also limits how many derivations run at once.
+        std::array<unsigned char, SHA256_DIGEST_LENGTH> hash;
+        thread_pool_t::run_in_blocker_pool([&]() {
+            hash = crypto::pbkcs5_pbkdf2_hmac_sha256(
+                prepared_password,
+                user_password.get_salt(),
+                user_password.get_iteration_count());
+        });
 
-    if (!crypto::compare_equal(user->get_password().get_hash(), hash)) {
-        throw authentication_error_t(12, "Wrong password");
+        if (!crypto::compare_equal(user_password.get_hash(), hash)) {
+            throw authentication_error_t(12, "Wrong password");
+        }
+        get_verified_password_cache()->set_verified(
+            m_username, user_password, prepared_password);
     }
 
     m_is_authenticated = true;
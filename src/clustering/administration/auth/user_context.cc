@@ -27,6 +27,10 @@ bool user_context_t::is_admin_user() const {
     }
 }
 
+username_t const *user_context_t::get_username() const {
+    return boost::get<username_t>(&m_context);
+}
+
 void user_context_t::require_admin_user() const THROWS_ONLY(permission_error_t) {
     if (!is_admin_user()) {
         throw permission_error_t("admin");
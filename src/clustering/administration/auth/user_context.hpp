@@ -25,6 +25,9 @@ public:
 
     bool is_admin_user() const;
 
+    // The user of the context, or null if the context only has permissions
+    username_t const *get_username() const;
+
     void require_admin_user() const THROWS_ONLY(permission_error_t);
 
     void require_read_permission(
@@ -0,0 +1,102 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/http/profiler_app.hpp"
+
+#include <atomic>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "arch/runtime/sampling_profiler.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/pmap.hpp"
+#include "utils.hpp"
+
+profiler_http_app_t::profiler_http_app_t() : running(false) {
+    coro_t::spawn_sometime(std::bind(&profiler_http_app_t::collect_loop, this,
+                                     auto_drainer_t::lock_t(&drainer)));
+}
+
+profiler_http_app_t::~profiler_http_app_t() {
+    assert_thread();
+    if (running) {
+        stop();
+    }
+}
+
+void profiler_http_app_t::handle(const http_req_t &req, http_res_t *result,
+                                 signal_t *) {
+    on_thread_t thread_switcher(home_thread());
+    sampling_profiler_t *profiler = &sampling_profiler_t::get_global_profiler();
+
+    optional<std::string> action = req.find_query_param("action");
+    if (!action) {
+        *result = http_res_t(http_status_code_t::OK, "text/plain",
+                             profiler->get_folded_stacks());
+        return;
+    }
+
+    if (*action == "start") {
+        int64_t hz = SAMPLING_PROFILER_DEFAULT_HZ;
+        optional<std::string> hz_param = req.find_query_param("hz");
+        if (hz_param && (!strtoi64_strict(*hz_param, 10, &hz)
+                         || hz <= 0 || hz > SAMPLING_PROFILER_MAX_HZ)) {
+            *result = http_error_res(strprintf(
+                "`hz` must be an integer between 1 and %d.", SAMPLING_PROFILER_MAX_HZ));
+            return;
+        }
+        if (!start(static_cast<int>(hz))) {
+            *result = http_error_res("The sampling profiler is not available.",
+                                     http_status_code_t::INTERNAL_SERVER_ERROR);
+            return;
+        }
+    } else if (*action == "stop") {
+        if (running) {
+            stop();
+        }
+    } else if (*action == "reset") {
+        profiler->reset();
+    } else {
+        *result = http_error_res("`action` must be `start`, `stop` or `reset`.");
+        return;
+    }
+    *result = http_res_t(http_status_code_t::OK, "text/plain", strprintf(
+        "%" PRIu64 " samples dropped\n", profiler->get_num_dropped_samples()));
+}
+
+bool profiler_http_app_t::start(int hz) {
+    assert_thread();
+    std::atomic<bool> success(true);
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        if (!sampling_profiler_t::get_global_profiler().start_on_this_thread(hz)) {
+            success = false;
+        }
+    });
+    if (!success) {
+        stop();
+        return false;
+    }
+    running = true;
+    return true;
+}
+
+void profiler_http_app_t::stop() {
+    assert_thread();
+    pmap(get_num_threads(), [](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        sampling_profiler_t::get_global_profiler().stop_on_this_thread();
+    });
+    running = false;
+}
+
+void profiler_http_app_t::collect_loop(auto_drainer_t::lock_t keepalive) {
+    try {
+        for (;;) {
+            nap(SAMPLING_PROFILER_COLLECT_INTERVAL_MS, keepalive.get_drain_signal());
+            if (running) {
+                sampling_profiler_t::get_global_profiler().collect();
+            }
+        }
+    } catch (const interrupted_exc_t &) {
+        // The app is being destroyed.
+    }
+}
@@ -0,0 +1,38 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_PROFILER_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_PROFILER_APP_HPP_
+
+#include "concurrency/auto_drainer.hpp"
+#include "http/http.hpp"
+#include "threading.hpp"
+
+/* `profiler_http_app_t` controls the `sampling_profiler_t` over HTTP:
+
+    /ajax/profiler?action=start[&hz=N]  starts sampling every thread
+    /ajax/profiler?action=stop          stops sampling
+    /ajax/profiler?action=reset         throws away the recorded samples
+    /ajax/profiler                      returns the samples in the folded format that
+                                        `flamegraph.pl` reads
+
+While sampling, it periodically moves the samples out of the per-thread buffers so
+that they don't overflow. */
+class profiler_http_app_t : public http_app_t, public home_thread_mixin_t {
+public:
+    profiler_http_app_t();
+    ~profiler_http_app_t();
+
+    void handle(const http_req_t &req, http_res_t *result, signal_t *interruptor);
+
+private:
+    bool start(int hz);
+    void stop();
+    void collect_loop(auto_drainer_t::lock_t keepalive);
+
+    bool running;
+
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(profiler_http_app_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_PROFILER_APP_HPP_ */
@@ -96,7 +96,8 @@ void jobs_manager_t::on_get_job_reports(
                         server_id,
                         query_cache->get_client_addr_port(),
                         pretty_print(printed_query_columns, render),
-                        query_cache->get_user_context());
+                        query_cache->get_user_context(),
+                        pair.second->record->stats);
                 }
             }
         }
@@ -12,6 +12,7 @@
 #include "containers/archive/stl_types.hpp"
 #include "containers/uuid.hpp"
 #include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/query_stats.hpp"
 #include "rpc/serialize_macros.hpp"
 #include "time.hpp"
 
@@ -140,7 +141,8 @@ public:
             server_id_t const &server_id,
             ip_and_port_t const &client_addr_port,
             std::string const &query,
-            auth::user_context_t const &user_context);
+            auth::user_context_t const &user_context,
+            ql::query_stats_t const &stats);
 
     void merge_derived(query_job_report_t const &job_report);
 
@@ -154,6 +156,7 @@ public:
     ip_and_port_t client_addr_port;
     std::string query;
     auth::user_context_t user_context;
+    ql::query_stats_t stats;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(query_job_report_t);
 
@@ -368,3 +368,127 @@ void log_warnings_for_cache_size(uint64_t bytes) {
         logWRN("Cache size is very low and may impact performance.");
     }
 }
+
+#if defined(__linux__)
+
+bool read_file_in_blocker_pool(const char *path, std::string *contents_out) {
+    bool ok;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        ok = blocking_read_file(path, contents_out);
+    });
+    return ok;
+}
+
+/* cgroup v2 has the limit in `memory.max`, which is "max" without a limit; cgroup v1
+has it in `memory.limit_in_bytes`, which is some huge number without a limit.  This
+only looks at the root of the hierarchy, which is our own cgroup inside of a container
+with a cgroup namespace. */
+bool get_cgroup_memory_limit(uint64_t *limit_out) {
+    std::string contents;
+    if (!read_file_in_blocker_pool("/sys/fs/cgroup/memory.max", &contents)
+        && !read_file_in_blocker_pool("/sys/fs/cgroup/memory/memory.limit_in_bytes",
+                                      &contents)) {
+        return false;
+    }
+    const size_t end = contents.find_first_not_of("0123456789");
+    uint64_t limit;
+    if (!strtou64_strict(contents.substr(0, end), 10, &limit)) {
+        return false;
+    }
+    const uint64_t physical_memory =
+        static_cast<uint64_t>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+    if (limit >= physical_memory) {
+        return false;
+    }
+    *limit_out = limit;
+    return true;
+}
+
+/* Sets `*percent_out` to the share of the last ten seconds in which some of the tasks
+of our cgroup (or of the system, without cgroup v2) were stalled waiting for memory.
+Returns false if the kernel doesn't track this. */
+bool get_memory_pressure(double *percent_out) {
+    std::string contents;
+    if (!read_file_in_blocker_pool("/sys/fs/cgroup/memory.pressure", &contents)
+        && !read_file_in_blocker_pool("/proc/pressure/memory", &contents)) {
+        return false;
+    }
+    const char *prefix = "some avg10=";
+    if (contents.compare(0, strlen(prefix), prefix) != 0) {
+        return false;
+    }
+    char *end;
+    const double percent = strtod(contents.c_str() + strlen(prefix), &end);
+    if (end == contents.c_str() + strlen(prefix)) {
+        return false;
+    }
+    *percent_out = percent;
+    return true;
+}
+
+bool get_resident_memory_size(uint64_t *rss_out) {
+    std::string contents;
+    if (!read_file_in_blocker_pool("/proc/self/statm", &contents)) {
+        return false;
+    }
+    // The second field is the number of resident pages.
+    const size_t begin = contents.find(' ');
+    if (begin == std::string::npos) {
+        return false;
+    }
+    const size_t end = contents.find(' ', begin + 1);
+    uint64_t pages;
+    if (!strtou64_strict(contents.substr(begin + 1, end - begin - 1), 10, &pages)) {
+        return false;
+    }
+    *rss_out = pages * sysconf(_SC_PAGESIZE);
+    return true;
+}
+
+#else
+
+bool get_cgroup_memory_limit(UNUSED uint64_t *limit_out) {
+    return false;
+}
+
+bool get_memory_pressure(UNUSED double *percent_out) {
+    return false;
+}
+
+bool get_resident_memory_size(UNUSED uint64_t *rss_out) {
+    return false;
+}
+
+#endif  // __linux__
+
+uint64_t get_dynamic_total_cache_size(uint64_t current_size) {
+    // This assumes that the cache currently uses its whole size, so that the rest of
+    // the resident memory belongs to everything else.
+    uint64_t rss;
+    const uint64_t other_usage = get_resident_memory_size(&rss) && rss > current_size
+        ? rss - current_size
+        : 0;
+
+    // The memory that the cache could use if nothing else needed any more
+    uint64_t room = current_size + get_avail_mem_size();
+    uint64_t limit;
+    if (get_cgroup_memory_limit(&limit)) {
+        room = std::min(room, limit > other_usage ? limit - other_usage : 0);
+    }
+    uint64_t target = room / 100 * (100 - DYNAMIC_CACHE_SIZE_HEADROOM_PERCENT);
+
+    double pressure;
+    if (get_memory_pressure(&pressure)) {
+        if (pressure >= DYNAMIC_CACHE_SIZE_SHRINK_PRESSURE) {
+            target = std::min(
+                target, current_size - current_size / DYNAMIC_CACHE_SIZE_SHRINK_DIVISOR);
+        } else if (pressure >= DYNAMIC_CACHE_SIZE_GROW_PRESSURE) {
+            target = std::min(target, current_size);
+        }
+    }
+    target = std::min(
+        target, current_size + current_size / DYNAMIC_CACHE_SIZE_GROW_DIVISOR);
+
+    return std::min(std::max<uint64_t>(target, 100 * MEGABYTE),
+                    get_max_total_cache_size());
+}
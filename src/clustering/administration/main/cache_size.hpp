@@ -9,5 +9,18 @@ uint64_t get_max_total_cache_size();
 uint64_t get_default_total_cache_size();
 void log_warnings_for_cache_size(uint64_t);
 
+/* Returns the cache size that `--dynamic-cache-size` should switch to from
+`current_size`, based on the memory limit of our cgroup, the memory that the rest of the
+process uses, the available memory and the memory pressure.  Signals that aren't
+available on this platform are ignored.  Blocks on reading files, so it has to be
+called from a coroutine. */
+uint64_t get_dynamic_total_cache_size(uint64_t current_size);
+
+/* These return false if the value isn't available on this platform (or if there's no
+cgroup limit), and block like `get_dynamic_total_cache_size`. */
+bool get_cgroup_memory_limit(uint64_t *limit_out);
+bool get_resident_memory_size(uint64_t *rss_out);
+uint64_t get_avail_mem_size();
+
 #endif  // CLUSTERING_ADMINISTRATION_MAIN_CACHE_SIZE_HPP_
 
@@ -731,6 +731,7 @@ service_address_ports_t get_service_address_ports(const std::map<std::string, op
         exists_option(opts, "--no-http-admin"),
         offseted_port(get_single_int(opts, "--http-port"), port_offset),
         offseted_port(get_single_int(opts, "--driver-port"), port_offset),
+        get_optional_option(opts, "--driver-unix-socket"),
         port_offset);
 }
 
@@ -997,6 +998,20 @@ bool initialize_tls_ctx(
         }
     }
 
+    /* With `--tls-kernel-offload`, OpenSSL hands the session keys to the kernel after
+    the handshake if the kernel supports the negotiated cipher.  The kernel then
+    encrypts and decrypts the records itself, so writes to the socket don't need to
+    be copied through OpenSSL's buffers. */
+    if (exists_option(opts, "--tls-kernel-offload")) {
+#ifdef SSL_OP_ENABLE_KTLS
+        SSL_CTX_set_options(tls_ctx_out->get(), SSL_OP_ENABLE_KTLS);
+#else
+        logERR("--tls-kernel-offload requires OpenSSL 3.0 or later with kernel TLS "
+               "support.");
+        return false;
+#endif
+    }
+
     return true;
 }
 
@@ -1045,6 +1060,7 @@ void run_rethinkdb_create(const base_path_t &base_path,
                           optional<uint64_t> total_cache_size,
                           const file_direct_io_mode_t direct_io_mode,
                           const int max_concurrent_io_requests,
+                          const disk_backend_mode_t disk_backend_mode,
                           bool *const result_out) {
     server_id_t our_server_id = server_id_t::generate_server_id();
 
@@ -1058,7 +1074,8 @@ void run_rethinkdb_create(const base_path_t &base_path,
     server_config.config.cache_size_bytes = total_cache_size;
     server_config.version = 1;
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(
+        direct_io_mode, max_concurrent_io_requests, disk_backend_mode);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -1139,6 +1156,8 @@ void run_rethinkdb_serve(const base_path_t &base_path,
                          const std::string &initial_password,
                          const file_direct_io_mode_t direct_io_mode,
                          const int max_concurrent_io_requests,
+                         const disk_backend_mode_t disk_backend_mode,
+                         const std::vector<std::string> &stripe_directories,
                          const optional<optional<uint64_t> >
                             &total_cache_size,
                          const server_id_t *our_server_id,
@@ -1156,7 +1175,9 @@ void run_rethinkdb_serve(const base_path_t &base_path,
 
     logNTC("Loading data from directory %s\n", base_path.path().c_str());
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(
+        direct_io_mode, max_concurrent_io_requests, disk_backend_mode,
+        stripe_directories);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -1284,6 +1305,8 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              const std::string &initial_password,
                              const file_direct_io_mode_t direct_io_mode,
                              const int max_concurrent_io_requests,
+                             const disk_backend_mode_t disk_backend_mode,
+                             const std::vector<std::string> &stripe_directories,
                              const optional<optional<uint64_t> >
                                 &total_cache_size,
                              const bool new_directory,
@@ -1292,7 +1315,8 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              bool *const result_out) {
     if (!new_directory) {
         run_rethinkdb_serve(base_path, serve_info, initial_password, direct_io_mode,
-                            max_concurrent_io_requests, total_cache_size,
+                            max_concurrent_io_requests, disk_backend_mode,
+                            stripe_directories, total_cache_size,
                             nullptr, nullptr, nullptr, data_directory_lock,
                             result_out);
     } else {
@@ -1328,8 +1352,8 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
         server_config.version = 1;
 
         run_rethinkdb_serve(base_path, serve_info, initial_password, direct_io_mode,
-                            max_concurrent_io_requests,
-                            optional<optional<uint64_t> >(),
+                            max_concurrent_io_requests, disk_backend_mode,
+                            stripe_directories, optional<optional<uint64_t> >(),
                             &our_server_id, &server_config, &cluster_metadata,
                             data_directory_lock, result_out);
     }
@@ -1407,6 +1431,18 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
                                              strprintf("%d", DEFAULT_MAX_CONCURRENT_IO_REQUESTS)));
     help.add("--io-threads n",
              "how many simultaneous I/O operations can happen at the same time");
+    options_out->push_back(options::option_t(options::names_t("--io-backend"),
+                                             options::OPTIONAL,
+                                             "pool"));
+    help.add("--io-backend pool | uring",
+             "how to submit disk I/O to the kernel: 'pool' uses blocking calls on a "
+             "thread pool, 'uring' uses io_uring where the kernel supports it");
+    options_out->push_back(options::option_t(options::names_t("--stripe-directory"),
+                                             options::OPTIONAL_REPEAT));
+    help.add("--stripe-directory path",
+             "stripe the files of new tables across the data directory and this "
+             "directory, which should be on a different device (may be specified "
+             "multiple times)");
 #ifndef _WIN32
     // TODO WINDOWS: accept this option, but error out if it is passed
     options_out->push_back(options::option_t(options::names_t("--direct-io"),
@@ -1417,6 +1453,46 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
                                              options::OPTIONAL));
     help.add("--cache-size mb", "total cache size (in megabytes) for the process. Can "
         "be 'auto'.");
+    options_out->push_back(options::option_t(options::names_t("--cache-eviction-policy"),
+                                             options::OPTIONAL,
+                                             "lru"));
+    help.add("--cache-eviction-policy lru | scan-resistant",
+             "how the cache picks pages to evict: 'scan-resistant' keeps large scans "
+             "from pushing frequently used pages out of the cache");
+    options_out->push_back(options::option_t(options::names_t("--snapshot-memory-limit"),
+                                             options::OPTIONAL,
+                                             "0"));
+    help.add("--snapshot-memory-limit percent",
+             "how much of a table's cache old versions of pages that long reads still "
+             "see may use before the reads continue from a new snapshot (0 for no "
+             "limit)");
+    options_out->push_back(options::option_t(options::names_t("--dynamic-cache-size"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--dynamic-cache-size",
+             "keep adjusting an automatically sized cache to the cgroup memory limit, "
+             "the memory pressure and the memory that the rest of the server uses");
+    options_out->push_back(options::option_t(options::names_t("--backfill-latency-target"),
+                                             options::OPTIONAL,
+                                             "0"));
+    help.add("--backfill-latency-target ms",
+             "run fewer backfills at once while the 99th percentile disk read latency "
+             "is above this many milliseconds (0 to disable)");
+    options_out->push_back(options::option_t(options::names_t("--index-build-priority"),
+                                             options::OPTIONAL,
+                                             "normal"));
+    help.add("--index-build-priority low | normal | high",
+             "how much secondary index construction holds back while the disk or the "
+             "table is busy: 'high' never holds back");
+    options_out->push_back(options::option_t(options::names_t("--primary-key-filter"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--primary-key-filter",
+             "keep a bloom filter of the primary keys of every table in memory, so "
+             "that looking up keys that don't exist doesn't have to read from disk");
+    options_out->push_back(options::option_t(options::names_t("--auto-rebalance"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--auto-rebalance",
+             "periodically rebalance tables whose shards have become uneven, for the "
+             "tables that this server is the first primary replica of");
     return help;
 }
 
@@ -1594,6 +1670,12 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              strprintf("%d", port_defaults::reql_port)));
     help.add("--driver-port port", "port for rethinkdb protocol client drivers");
 
+    options_out->push_back(options::option_t(options::names_t("--driver-unix-socket"),
+                                             options::OPTIONAL));
+    help.add("--driver-unix-socket path",
+             "also listen for client drivers on the same host on this Unix domain "
+             "socket (without TLS)");
+
     options_out->push_back(options::option_t(options::names_t("--port-offset", "-o"),
                                              options::OPTIONAL,
                                              strprintf("%d", port_defaults::port_offset)));
@@ -1607,6 +1689,31 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              options::OPTIONAL));
     help.add("--reql-http-proxy [protocol://]host[:port]", "HTTP proxy to use for performing `r.http(...)` queries, default port is 1080");
 
+    options_out->push_back(options::option_t(options::names_t("--slow-query-threshold"),
+                                             options::OPTIONAL,
+                                             strprintf("%d", SLOW_QUERY_LOG_THRESHOLD_MS)));
+    help.add("--slow-query-threshold ms",
+             "log queries that take at least this many milliseconds (0 to disable)");
+
+    options_out->push_back(options::option_t(options::names_t("--user-quota"),
+                                             options::OPTIONAL_REPEAT));
+    help.add("--user-quota user:key=value,...",
+             "limit the queries of a user on this server, with the keys "
+             "concurrent_queries, read_bytes_per_sec, write_ops_per_sec and priority "
+             "(the highest priority the user may use), can be specified multiple times");
+
+    options_out->push_back(options::option_t(options::names_t("--point-read-cache-size"),
+                                             options::OPTIONAL, "0"));
+    help.add("--point-read-cache-size documents",
+             "cache the results of up to this many `get()`s with read_mode \"outdated\" "
+             "on this server, and keep them up to date with changefeeds (0 to disable)");
+
+    options_out->push_back(options::option_t(options::names_t("--coalesce-writes"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--coalesce-writes",
+             "write concurrent single-document inserts into the same table from "
+             "queries on this server as one batch");
+
     options_out->push_back(options::option_t(options::names_t("--canonical-address"),
                                              options::OPTIONAL_REPEAT));
     help.add("--canonical-address addr", "address that other rethinkdb instances will use to connect to us, can be specified multiple times");
@@ -1624,6 +1731,11 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                                     "before giving up, the default is "
                                                     "24 hours");
 
+    options_out->push_back(options::option_t(options::names_t("--cluster-compression"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--cluster-compression", "compress large messages to other servers, such "
+             "as the data sent while backfilling, if they support it");
+
     return help;
 }
 
@@ -1633,9 +1745,32 @@ options::help_section_t get_cpu_options(std::vector<options::option_t> *options_
                                              options::OPTIONAL,
                                              strprintf("%d", get_cpu_count())));
     help.add("-c [ --cores ] n", "the number of cores to use");
+    options_out->push_back(options::option_t(options::names_t("--pin-threads"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--pin-threads", "pin each thread to a core, and keep the threads serving "
+             "a table on the same NUMA node");
+    options_out->push_back(options::option_t(options::names_t("--event-loop-spin"),
+                                             options::OPTIONAL,
+                                             "0"));
+    help.add("--event-loop-spin usecs", "busy-poll for up to this many microseconds "
+             "before an idle thread goes to sleep, trading CPU for latency "
+             "(0 to disable)");
     return help;
 }
 
+MUST_USE bool parse_event_loop_spin_option(
+        const std::map<std::string, options::values_t> &opts,
+        int64_t *spin_usecs_out) {
+    const int spin_usecs = get_single_int(opts, "--event-loop-spin");
+    if (spin_usecs < 0 || spin_usecs > MAX_EVENT_LOOP_SPIN_USECS) {
+        fprintf(stderr, "ERROR: event-loop-spin must be between 0 and %d\n",
+                MAX_EVENT_LOOP_SPIN_USECS);
+        return false;
+    }
+    *spin_usecs_out = spin_usecs;
+    return true;
+}
+
 MUST_USE bool parse_cores_option(const std::map<std::string, options::values_t> &opts,
                                  int *num_workers_out) {
     int num_workers = get_single_int(opts, "--cores");
@@ -1730,6 +1865,8 @@ options::help_section_t get_tls_options(std::vector<options::option_t> *options_
                                              options::OPTIONAL));
     options_out->push_back(options::option_t(options::names_t("--tls-dhparams"),
                                              options::OPTIONAL));
+    options_out->push_back(options::option_t(options::names_t("--tls-kernel-offload"),
+                                             options::OPTIONAL_NO_PARAMETER));
     help.add(
         "--tls-min-protocol protocol",
         "the minimum TLS protocol version that the server accepts; options are "
@@ -1744,6 +1881,10 @@ options::help_section_t get_tls_options(std::vector<options::option_t> *options_
         "--tls-dhparams dhparams_filename",
         "provide parameters for DHE key agreement; REQUIRED if using DHE cipher suites; "
         "at least 2048-bit recommended");
+    help.add(
+        "--tls-kernel-offload",
+        "let the kernel encrypt and decrypt TLS connections where it supports the "
+        "cipher suite; requires Linux 4.17 and OpenSSL 3.0 or later");
 
     return help;
 }
@@ -1887,6 +2028,143 @@ MUST_USE bool parse_io_threads_option(const std::map<std::string, options::value
     return true;
 }
 
+MUST_USE bool parse_io_backend_option(const std::map<std::string, options::values_t> &opts,
+                                      disk_backend_mode_t *disk_backend_mode_out) {
+    const std::string backend = get_single_option(opts, "--io-backend");
+    if (backend == "pool") {
+        *disk_backend_mode_out = disk_backend_mode_t::pool;
+    } else if (backend == "uring") {
+        *disk_backend_mode_out = disk_backend_mode_t::uring_desired;
+    } else {
+        fprintf(stderr, "ERROR: io-backend must be either 'pool' or 'uring'\n");
+        return false;
+    }
+    return true;
+}
+
+/* The directories given with `--stripe-directory`, made absolute.  They must exist
+already, since they're usually mount points. */
+MUST_USE bool parse_stripe_directory_options(
+        const std::map<std::string, options::values_t> &opts,
+        std::vector<std::string> *stripe_directories_out) {
+    stripe_directories_out->clear();
+    for (const std::string &directory : all_options(opts, "--stripe-directory")) {
+        base_path_t path(directory);
+        if (!check_existence(path)) {
+            fprintf(stderr, "ERROR: stripe directory '%s' does not exist\n",
+                    directory.c_str());
+            return false;
+        }
+        path.make_absolute();
+        stripe_directories_out->push_back(path.path());
+    }
+    return true;
+}
+
+MUST_USE bool parse_backfill_latency_target_option(
+        const std::map<std::string, options::values_t> &opts,
+        int64_t *latency_target_ms_out) {
+    const int latency_target_ms = get_single_int(opts, "--backfill-latency-target");
+    if (latency_target_ms < 0) {
+        fprintf(stderr, "ERROR: backfill-latency-target must not be negative\n");
+        return false;
+    }
+    *latency_target_ms_out = latency_target_ms;
+    return true;
+}
+
+MUST_USE bool parse_slow_query_threshold_option(
+        const std::map<std::string, options::values_t> &opts,
+        int64_t *threshold_ms_out) {
+    const int threshold_ms = get_single_int(opts, "--slow-query-threshold");
+    if (threshold_ms < 0) {
+        fprintf(stderr, "ERROR: slow-query-threshold must not be negative\n");
+        return false;
+    }
+    *threshold_ms_out = threshold_ms;
+    return true;
+}
+
+MUST_USE bool parse_point_read_cache_size_option(
+        const std::map<std::string, options::values_t> &opts,
+        uint64_t *size_out) {
+    const int size = get_single_int(opts, "--point-read-cache-size");
+    if (size < 0) {
+        fprintf(stderr, "ERROR: point-read-cache-size must not be negative\n");
+        return false;
+    }
+    *size_out = size;
+    return true;
+}
+
+MUST_USE bool parse_user_quota_options(
+        const std::map<std::string, options::values_t> &opts,
+        std::map<std::string, ql::user_quota_t> *quotas_out) {
+    std::string source;
+    for (const std::string &spec : all_options(opts, "--user-quota", &source)) {
+        std::string username;
+        ql::user_quota_t quota;
+        std::string error;
+        if (!ql::parse_user_quota(spec, &username, &quota, &error)) {
+            fprintf(stderr, "ERROR: invalid user-quota `%s` (%s): %s\n",
+                    spec.c_str(), source.c_str(), error.c_str());
+            return false;
+        }
+        if (!quotas_out->insert(std::make_pair(username, quota)).second) {
+            fprintf(stderr, "ERROR: user-quota given twice for user `%s`\n",
+                    username.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+MUST_USE bool parse_cache_eviction_policy_option(
+        const std::map<std::string, options::values_t> &opts,
+        cache_eviction_policy_t *eviction_policy_out) {
+    const std::string policy = get_single_option(opts, "--cache-eviction-policy");
+    if (policy == "lru") {
+        *eviction_policy_out = cache_eviction_policy_t::lru;
+    } else if (policy == "scan-resistant") {
+        *eviction_policy_out = cache_eviction_policy_t::scan_resistant;
+    } else {
+        fprintf(stderr, "ERROR: cache-eviction-policy must be either 'lru' or "
+                "'scan-resistant'\n");
+        return false;
+    }
+    return true;
+}
+
+MUST_USE bool parse_snapshot_memory_limit_option(
+        const std::map<std::string, options::values_t> &opts,
+        uint32_t *percent_out) {
+    const int percent = get_single_int(opts, "--snapshot-memory-limit");
+    if (percent < 0 || percent > 100) {
+        fprintf(stderr, "ERROR: snapshot-memory-limit must be between 0 and 100\n");
+        return false;
+    }
+    *percent_out = percent;
+    return true;
+}
+
+MUST_USE bool parse_index_build_priority_option(
+        const std::map<std::string, options::values_t> &opts,
+        sindex_build_priority_t *priority_out) {
+    const std::string priority = get_single_option(opts, "--index-build-priority");
+    if (priority == "low") {
+        *priority_out = sindex_build_priority_t::low;
+    } else if (priority == "normal") {
+        *priority_out = sindex_build_priority_t::normal;
+    } else if (priority == "high") {
+        *priority_out = sindex_build_priority_t::high;
+    } else {
+        fprintf(stderr, "ERROR: index-build-priority must be 'low', 'normal' or "
+                "'high'\n");
+        return false;
+    }
+    return true;
+}
+
 update_check_t parse_update_checking_option(const std::map<std::string, options::values_t> &opts) {
     return exists_option(opts, "--no-update-check")
         ? update_check_t::do_not_perform
@@ -1929,6 +2207,11 @@ int main_rethinkdb_create(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        disk_backend_mode_t disk_backend_mode;
+        if (!parse_io_backend_option(opts, &disk_backend_mode)) {
+            return EXIT_FAILURE;
+        }
+
         const int num_workers = get_cpu_count();
 
         bool is_new_directory = false;
@@ -1958,6 +2241,7 @@ int main_rethinkdb_create(int argc, char *argv[]) {
                                      total_cache_size,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     disk_backend_mode,
                                      &result),
                            num_workers);
 
@@ -2052,16 +2336,66 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        int64_t event_loop_spin_usecs;
+        if (!parse_event_loop_spin_option(opts, &event_loop_spin_usecs)) {
+            return EXIT_FAILURE;
+        }
+
         int max_concurrent_io_requests;
         if (!parse_io_threads_option(opts, &max_concurrent_io_requests)) {
             return EXIT_FAILURE;
         }
 
+        disk_backend_mode_t disk_backend_mode;
+        if (!parse_io_backend_option(opts, &disk_backend_mode)) {
+            return EXIT_FAILURE;
+        }
+
+        std::vector<std::string> stripe_directories;
+        if (!parse_stripe_directory_options(opts, &stripe_directories)) {
+            return EXIT_FAILURE;
+        }
+
         update_check_t do_update_checking = parse_update_checking_option(opts);
 
         optional<optional<uint64_t> > total_cache_size =
             parse_total_cache_size_option(opts);
 
+        cache_eviction_policy_t cache_eviction_policy;
+        if (!parse_cache_eviction_policy_option(opts, &cache_eviction_policy)) {
+            return EXIT_FAILURE;
+        }
+
+        uint32_t snapshot_memory_limit_percent;
+        if (!parse_snapshot_memory_limit_option(opts, &snapshot_memory_limit_percent)) {
+            return EXIT_FAILURE;
+        }
+
+        int64_t backfill_latency_target_ms;
+        if (!parse_backfill_latency_target_option(opts, &backfill_latency_target_ms)) {
+            return EXIT_FAILURE;
+        }
+
+        int64_t slow_query_threshold_ms;
+        if (!parse_slow_query_threshold_option(opts, &slow_query_threshold_ms)) {
+            return EXIT_FAILURE;
+        }
+
+        std::map<std::string, ql::user_quota_t> user_quotas;
+        if (!parse_user_quota_options(opts, &user_quotas)) {
+            return EXIT_FAILURE;
+        }
+
+        uint64_t point_read_cache_size;
+        if (!parse_point_read_cache_size_option(opts, &point_read_cache_size)) {
+            return EXIT_FAILURE;
+        }
+
+        sindex_build_priority_t index_build_priority;
+        if (!parse_index_build_priority_option(opts, &index_build_priority)) {
+            return EXIT_FAILURE;
+        }
+
         optional<int> join_delay_secs = parse_join_delay_secs_option(opts);
         optional<int> node_reconnect_timeout_secs =
             parse_node_reconnect_timeout_secs_option(opts);
@@ -2075,6 +2409,9 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
         initialize_logfile(opts, base_path);
 
         recreate_temporary_directory(base_path);
+        for (const std::string &directory : stripe_directories) {
+            recreate_temporary_directory(base_path_t(directory));
+        }
 
         if (check_pid_file(opts) != EXIT_SUCCESS) {
             return EXIT_FAILURE;
@@ -2107,7 +2444,19 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                 std::vector<std::string>(argv, argv + argc),
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
-                                tls_configs);
+                                tls_configs,
+                                cache_eviction_policy,
+                                snapshot_memory_limit_percent,
+                                exists_option(opts, "--cluster-compression"),
+                                backfill_latency_target_ms,
+                                slow_query_threshold_ms,
+                                exists_option(opts, "--auto-rebalance"),
+                                index_build_priority,
+                                exists_option(opts, "--dynamic-cache-size"),
+                                std::move(user_quotas),
+                                point_read_cache_size,
+                                exists_option(opts, "--coalesce-writes"),
+                                exists_option(opts, "--primary-key-filter"));
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
 
@@ -2118,13 +2467,17 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                      initial_password,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     disk_backend_mode,
+                                     stripe_directories,
                                      total_cache_size,
                                      static_cast<server_id_t*>(nullptr),
                                      static_cast<server_config_versioned_t *>(nullptr),
                                      static_cast<cluster_semilattice_metadata_t*>(nullptr),
                                      &data_directory_lock,
                                      &result),
-                           num_workers);
+                           num_workers,
+                           exists_option(opts, "--pin-threads"),
+                           event_loop_spin_usecs);
         return result ? EXIT_SUCCESS : EXIT_FAILURE;
     } catch (const options::named_error_t &ex) {
         output_named_error(ex, help);
@@ -2168,6 +2521,21 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
         optional<int> node_reconnect_timeout_secs =
             parse_node_reconnect_timeout_secs_option(opts);
 
+        int64_t slow_query_threshold_ms;
+        if (!parse_slow_query_threshold_option(opts, &slow_query_threshold_ms)) {
+            return EXIT_FAILURE;
+        }
+
+        std::map<std::string, ql::user_quota_t> user_quotas;
+        if (!parse_user_quota_options(opts, &user_quotas)) {
+            return EXIT_FAILURE;
+        }
+
+        uint64_t point_read_cache_size;
+        if (!parse_point_read_cache_size_option(opts, &point_read_cache_size)) {
+            return EXIT_FAILURE;
+        }
+
 #ifndef _WIN32
         get_and_set_user_group(opts);
 #endif
@@ -2210,7 +2578,19 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
                                 std::vector<std::string>(argv, argv + argc),
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
-                                tls_configs);
+                                tls_configs,
+                                cache_eviction_policy_t::lru,
+                                0,
+                                exists_option(opts, "--cluster-compression"),
+                                0,
+                                slow_query_threshold_ms,
+                                false,
+                                sindex_build_priority_t::normal,
+                                false,
+                                std::move(user_quotas),
+                                point_read_cache_size,
+                                exists_option(opts, "--coalesce-writes"),
+                                false);
 
         bool result;
         run_in_thread_pool(
@@ -2323,11 +2703,26 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        int64_t event_loop_spin_usecs;
+        if (!parse_event_loop_spin_option(opts, &event_loop_spin_usecs)) {
+            return EXIT_FAILURE;
+        }
+
         int max_concurrent_io_requests;
         if (!parse_io_threads_option(opts, &max_concurrent_io_requests)) {
             return EXIT_FAILURE;
         }
 
+        disk_backend_mode_t disk_backend_mode;
+        if (!parse_io_backend_option(opts, &disk_backend_mode)) {
+            return EXIT_FAILURE;
+        }
+
+        std::vector<std::string> stripe_directories;
+        if (!parse_stripe_directory_options(opts, &stripe_directories)) {
+            return EXIT_FAILURE;
+        }
+
         update_check_t do_update_checking = parse_update_checking_option(opts);
 
         optional<int> join_delay_secs = parse_join_delay_secs_option(opts);
@@ -2352,6 +2747,9 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
         initialize_logfile(opts, base_path);
 
         recreate_temporary_directory(base_path);
+        for (const std::string &directory : stripe_directories) {
+            recreate_temporary_directory(base_path_t(directory));
+        }
 
         name_string_t server_name;
         if (is_new_directory) {
@@ -2366,6 +2764,41 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
         optional<optional<uint64_t> > total_cache_size =
             parse_total_cache_size_option(opts);
 
+        cache_eviction_policy_t cache_eviction_policy;
+        if (!parse_cache_eviction_policy_option(opts, &cache_eviction_policy)) {
+            return EXIT_FAILURE;
+        }
+
+        uint32_t snapshot_memory_limit_percent;
+        if (!parse_snapshot_memory_limit_option(opts, &snapshot_memory_limit_percent)) {
+            return EXIT_FAILURE;
+        }
+
+        int64_t backfill_latency_target_ms;
+        if (!parse_backfill_latency_target_option(opts, &backfill_latency_target_ms)) {
+            return EXIT_FAILURE;
+        }
+
+        int64_t slow_query_threshold_ms;
+        if (!parse_slow_query_threshold_option(opts, &slow_query_threshold_ms)) {
+            return EXIT_FAILURE;
+        }
+
+        std::map<std::string, ql::user_quota_t> user_quotas;
+        if (!parse_user_quota_options(opts, &user_quotas)) {
+            return EXIT_FAILURE;
+        }
+
+        uint64_t point_read_cache_size;
+        if (!parse_point_read_cache_size_option(opts, &point_read_cache_size)) {
+            return EXIT_FAILURE;
+        }
+
+        sindex_build_priority_t index_build_priority;
+        if (!parse_index_build_priority_option(opts, &index_build_priority)) {
+            return EXIT_FAILURE;
+        }
+
         if (check_pid_file(opts) != EXIT_SUCCESS) {
             return EXIT_FAILURE;
         }
@@ -2400,7 +2833,19 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                 std::vector<std::string>(argv, argv + argc),
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
-                                tls_configs);
+                                tls_configs,
+                                cache_eviction_policy,
+                                snapshot_memory_limit_percent,
+                                exists_option(opts, "--cluster-compression"),
+                                backfill_latency_target_ms,
+                                slow_query_threshold_ms,
+                                exists_option(opts, "--auto-rebalance"),
+                                index_build_priority,
+                                exists_option(opts, "--dynamic-cache-size"),
+                                std::move(user_quotas),
+                                point_read_cache_size,
+                                exists_option(opts, "--coalesce-writes"),
+                                exists_option(opts, "--primary-key-filter"));
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
 
@@ -2412,12 +2857,16 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                      initial_password,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     disk_backend_mode,
+                                     stripe_directories,
                                      total_cache_size,
                                      is_new_directory,
                                      &serve_info,
                                      &data_directory_lock,
                                      &result),
-                           num_workers);
+                           num_workers,
+                           exists_option(opts, "--pin-threads"),
+                           event_loop_spin_usecs);
 
         return result ? EXIT_SUCCESS : EXIT_FAILURE;
     } catch (const options::named_error_t &ex) {
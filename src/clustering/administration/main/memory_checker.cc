@@ -1,14 +1,18 @@
 // Copyright 2010-2016 RethinkDB, all rights reserved.
 #include "clustering/administration/main/memory_checker.hpp"
 
+#include <inttypes.h>
 #include <math.h>
 #ifndef _WIN32
 #include <sys/resource.h>
 #endif
 
+#include <algorithm>
+
 #include "clustering/administration/metadata.hpp"
 #include "clustering/table_manager/table_meta_client.hpp"
 #include "logger.hpp"
+#include "perfmon/memory_accounting.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/pseudo_time.hpp"
 
@@ -22,7 +26,16 @@ memory_checker_t::memory_checker_t() :
     swap_usage(0),
     print_log_message(true),
     practice_runs_remaining(practice_runs),
-    timer(delay_time, this)
+    low_memory_check_running(false),
+    timer(delay_time, this),
+    low_memory_timer(LOW_MEMORY_CHECK_INTERVAL_MS, [this]() {
+        if (!low_memory_check_running) {
+            low_memory_check_running = true;
+            coro_t::spawn_sometime(std::bind(&memory_checker_t::do_low_memory_check,
+                                             this,
+                                             drainer.lock()));
+        }
+    })
 {
     coro_t::spawn_sometime(std::bind(&memory_checker_t::do_check,
                                      this,
@@ -61,10 +74,12 @@ void memory_checker_t::do_check(UNUSED auto_drainer_t::lock_t keepalive) {
             print_log_message = false;
         }
         checks_until_reset = reset_checks;
-        memory_issue_tracker.report_error(error_message);
+        swap_error.set(error_message);
+        update_issue();
     } else if (checks_until_reset == 0) {
         // We haven't had more than 200 major page faults per minute for the last 10m.
-        memory_issue_tracker.report_success();
+        swap_error.reset();
+        update_issue();
         print_log_message = true;
     }
 
@@ -78,3 +93,58 @@ void memory_checker_t::do_check(UNUSED auto_drainer_t::lock_t keepalive) {
     }
 }
 
+
+void memory_checker_t::do_low_memory_check(UNUSED auto_drainer_t::lock_t keepalive) {
+    uint64_t rss;
+    if (!get_resident_memory_size(&rss)) {
+        low_memory_check_running = false;
+        return;
+    }
+    uint64_t usable = rss + get_avail_mem_size();
+    uint64_t limit;
+    if (get_cgroup_memory_limit(&limit)) {
+        usable = std::min(usable, limit);
+    }
+    const uint64_t used_percent = usable == 0 ? 0 : rss * 100 / usable;
+
+    if (!memory_is_low() && used_percent >= LOW_MEMORY_SHED_PERCENT) {
+        std::string breakdown;
+        for (int i = 0; i < NUM_MEMORY_CATEGORIES; ++i) {
+            const memory_category_t category = static_cast<memory_category_t>(i);
+            breakdown += strprintf("%s%s: %" PRIi64 " MB",
+                                   i == 0 ? "" : ", ",
+                                   memory_category_name(category),
+                                   get_accounted_memory(category)
+                                       / static_cast<int64_t>(MEGABYTE));
+        }
+        logWRN("RethinkDB is using %" PRIu64 " MB of the %" PRIu64 " MB of memory "
+               "that it can use, and will reject new queries until it uses less "
+               "than %d%% (%s).",
+               rss / static_cast<uint64_t>(MEGABYTE),
+               usable / static_cast<uint64_t>(MEGABYTE),
+               LOW_MEMORY_RECOVER_PERCENT, breakdown.c_str());
+        set_memory_is_low(true);
+        low_memory_error.set(
+            "RethinkDB is running out of memory and is rejecting new queries. "
+            "Consider reducing the cache size or the number of open changefeeds.");
+        update_issue();
+    } else if (memory_is_low() && used_percent < LOW_MEMORY_RECOVER_PERCENT) {
+        logNTC("RethinkDB has enough memory again and accepts new queries.");
+        set_memory_is_low(false);
+        low_memory_error.reset();
+        update_issue();
+    }
+    low_memory_check_running = false;
+}
+
+void memory_checker_t::update_issue() {
+    if (swap_error && low_memory_error) {
+        memory_issue_tracker.report_error(*low_memory_error + " " + *swap_error);
+    } else if (low_memory_error) {
+        memory_issue_tracker.report_error(*low_memory_error);
+    } else if (swap_error) {
+        memory_issue_tracker.report_error(*swap_error);
+    } else {
+        memory_issue_tracker.report_success();
+    }
+}
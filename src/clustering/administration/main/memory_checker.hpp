@@ -16,6 +16,8 @@ class table_meta_client_t;
 // memory_checker_t is created in serve.cc, and calls a repeating timer to
 // Periodically check if we're using swap by looking at the proc file or system calls.
 // If we're using swap, it creates an issue in a local issue tracker, and logs an error.
+// A second, faster timer checks whether we're getting close to our memory limit, in
+// which case the query servers turn away new queries until we have room again.
 class memory_checker_t : private repeating_timer_callback_t {
 public:
     memory_checker_t();
@@ -25,6 +27,8 @@ public:
     }
 private:
     void do_check(auto_drainer_t::lock_t keepalive);
+    void do_low_memory_check(auto_drainer_t::lock_t keepalive);
+    void update_issue();
     void on_ring() final {
         coro_t::spawn_sometime(std::bind(&memory_checker_t::do_check,
                                          this,
@@ -39,9 +43,14 @@ private:
 
     int practice_runs_remaining;
 
+    optional<std::string> swap_error;
+    optional<std::string> low_memory_error;
+    bool low_memory_check_running;
+
     // Timer must be destructed before drainer, because on_ring aquires a lock on drainer.
     auto_drainer_t drainer;
     repeating_timer_t timer;
+    repeating_timer_t low_memory_timer;
 };
 
 #endif // CLUSTERING_ADMINISTRATION_MAIN_MEMORY_CHECKER_HPP_
@@ -27,6 +27,7 @@
 #include "clustering/administration/servers/config_server.hpp"
 #include "clustering/administration/servers/config_client.hpp"
 #include "clustering/administration/servers/network_logger.hpp"
+#include "clustering/administration/tables/auto_rebalancer.hpp"
 #include "clustering/administration/tables/name_resolver.hpp"
 #include "clustering/table_manager/table_meta_client.hpp"
 #include "clustering/table_manager/multi_table_manager.hpp"
@@ -202,7 +203,7 @@ bool do_serve(io_backender_t *io_backender,
         scoped_ptr_t<server_config_server_t> server_config_server;
         if (i_am_a_server) {
             server_config_server.init(new server_config_server_t(
-                &mailbox_manager, metadata_file));
+                &mailbox_manager, metadata_file, serve_info.dynamic_cache_size));
         }
 
         /* `server_config_client` is used to get a list of all connected servers and
@@ -236,7 +237,8 @@ bool do_serve(io_backender_t *io_backender,
                 serve_info.ports.client_port,
                 semilattice_manager_heartbeat.get_root_view(),
                 semilattice_manager_auth.get_root_view(),
-                serve_info.tls_configs.cluster.get()));
+                serve_info.tls_configs.cluster.get(),
+                serve_info.cluster_compression));
         } catch (const address_in_use_exc_t &ex) {
             throw address_in_use_exc_t(strprintf("Could not bind to cluster port: %s", ex.what()));
         }
@@ -283,7 +285,8 @@ bool do_serve(io_backender_t *io_backender,
                               nullptr,   /* we'll fill this in later */
                               semilattice_manager_auth.get_root_view(),
                               &get_global_perfmon_collection(),
-                              serve_info.reql_http_proxy);
+                              serve_info.reql_http_proxy,
+                              serve_info.slow_query_threshold_ms);
         {
             /* Extract a subview of the directory with all the table meta manager
             business cards. */
@@ -305,14 +308,18 @@ bool do_serve(io_backender_t *io_backender,
             scoped_ptr_t<multi_table_manager_t> multi_table_manager;
             if (i_am_a_server) {
                 cache_balancer.init(new alt_cache_balancer_t(
-                    server_config_server->get_actual_cache_size_bytes()));
+                    server_config_server->get_actual_cache_size_bytes(),
+                    serve_info.cache_eviction_policy,
+                    serve_info.snapshot_memory_limit_percent));
                 table_persistence_interface.init(
                     new real_table_persistence_interface_t(
                         io_backender,
                         cache_balancer.get(),
                         base_path,
                         &rdb_ctx,
-                        metadata_file));
+                        metadata_file,
+                        serve_info.index_build_priority,
+                        serve_info.primary_key_filter));
                 multi_table_manager.init(new multi_table_manager_t(
                     server_id,
                     &mailbox_manager,
@@ -323,7 +330,8 @@ bool do_serve(io_backender_t *io_backender,
                     table_persistence_interface.get(),
                     base_path,
                     io_backender,
-                    &perfmon_collection_repo));
+                    &perfmon_collection_repo,
+                    serve_info.backfill_latency_target_ms));
             } else {
                 /* Proxies still need a `multi_table_manager_t` because it takes care of
                 receiving table names, databases, and primary keys from other servers and
@@ -364,7 +372,9 @@ bool do_serve(io_backender_t *io_backender,
                 &table_meta_client,
                 multi_table_manager.get(),
                 table_query_directory_read_manager.get_root_view(),
-                make_lifetime(name_resolver));
+                make_lifetime(name_resolver),
+                serve_info.point_read_cache_size,
+                serve_info.coalesce_writes);
 
             artificial_reql_cluster_interface.set_next_reql_cluster_interface(
                 &real_reql_cluster_interface);
@@ -537,15 +547,23 @@ bool do_serve(io_backender_t *io_backender,
             {
                 /* The `rdb_query_server_t` listens for client requests and processes the
                 queries it receives. */
+                ql::user_quotas_t user_quotas(serve_info.user_quotas);
                 rdb_query_server_t rdb_query_server(
                     serve_info.ports.local_addresses_driver,
                     serve_info.ports.reql_port,
+                    serve_info.ports.driver_unix_socket,
                     &rdb_ctx,
                     &server_config_client,
                     server_id,
-                    serve_info.tls_configs.driver.get());
+                    serve_info.tls_configs.driver.get(),
+                    &user_quotas);
                 logNTC("Listening for client driver connections on port %d\n",
                        rdb_query_server.get_port());
+                if (serve_info.ports.driver_unix_socket.has_value()) {
+                    logNTC("Listening for client driver connections on the Unix "
+                           "domain socket %s\n",
+                           serve_info.ports.driver_unix_socket->c_str());
+                }
                 /* If `serve_info.ports.reql_port` was zero then the OS assigned us a
                 port, so we need to update the directory. */
                 our_root_directory_variable.apply_atomic_op(
@@ -660,6 +678,14 @@ bool do_serve(io_backender_t *io_backender,
                             &rdb_ctx, uname, &table_meta_client, &server_config_client));
                     }
 
+                    /* `auto_rebalancer` moves the split points of tables whose data
+                    has become unevenly distributed across their shards. */
+                    scoped_ptr_t<auto_rebalancer_t> auto_rebalancer;
+                    if (i_am_a_server && serve_info.auto_rebalance) {
+                        auto_rebalancer.init(new auto_rebalancer_t(
+                            server_id, &table_meta_client, &real_reql_cluster_interface));
+                    }
+
                     /* This is the end of the startup process. `stop_cond` will be pulsed
                     when it's time for the server to shut down. */
                     stop_cond->wait_lazily_unordered();
@@ -2,6 +2,7 @@
 #ifndef CLUSTERING_ADMINISTRATION_MAIN_SERVE_HPP_
 #define CLUSTERING_ADMINISTRATION_MAIN_SERVE_HPP_
 
+#include <map>
 #include <set>
 #include <string>
 #include <utility>
@@ -13,6 +14,8 @@
 #include "clustering/administration/main/version_check.hpp"
 #include "arch/address.hpp"
 #include "arch/io/openssl.hpp"
+#include "buffer_cache/types.hpp"
+#include "rdb_protocol/user_quotas.hpp"
 
 class os_signal_cond_t;
 
@@ -60,6 +63,7 @@ struct service_address_ports_t {
                             bool _http_admin_is_disabled,
                             int _http_port,
                             int _reql_port,
+                            const optional<std::string> &_driver_unix_socket,
                             int _port_offset) :
         local_addresses(_local_addresses),
         local_addresses_cluster(_local_addresses_cluster),
@@ -71,6 +75,7 @@ struct service_address_ports_t {
         http_admin_is_disabled(_http_admin_is_disabled),
         http_port(_http_port),
         reql_port(_reql_port),
+        driver_unix_socket(_driver_unix_socket),
         port_offset(_port_offset)
     {
             sanitize_port(port, "port", port_offset);
@@ -95,6 +100,8 @@ struct service_address_ports_t {
     bool http_admin_is_disabled;
     int http_port;
     int reql_port;
+    // Where to also listen for client drivers on the same host, if anywhere
+    optional<std::string> driver_unix_socket;
     int port_offset;
 };
 
@@ -120,7 +127,19 @@ public:
                  std::vector<std::string> &&_argv,
                  const int _join_delay_secs,
                  const int _node_reconnect_timeout_secs,
-                 tls_configs_t _tls_configs) :
+                 tls_configs_t _tls_configs,
+                 cache_eviction_policy_t _cache_eviction_policy,
+                 uint32_t _snapshot_memory_limit_percent,
+                 bool _cluster_compression,
+                 int64_t _backfill_latency_target_ms,
+                 int64_t _slow_query_threshold_ms,
+                 bool _auto_rebalance,
+                 sindex_build_priority_t _index_build_priority,
+                 bool _dynamic_cache_size,
+                 std::map<std::string, ql::user_quota_t> &&_user_quotas,
+                 uint64_t _point_read_cache_size,
+                 bool _coalesce_writes,
+                 bool _primary_key_filter) :
         joins(std::move(_joins)),
         reql_http_proxy(std::move(_reql_http_proxy)),
         web_assets(std::move(_web_assets)),
@@ -129,7 +148,19 @@ public:
         config_file(_config_file),
         argv(std::move(_argv)),
         join_delay_secs(_join_delay_secs),
-        node_reconnect_timeout_secs(_node_reconnect_timeout_secs)
+        node_reconnect_timeout_secs(_node_reconnect_timeout_secs),
+        cache_eviction_policy(_cache_eviction_policy),
+        snapshot_memory_limit_percent(_snapshot_memory_limit_percent),
+        cluster_compression(_cluster_compression),
+        backfill_latency_target_ms(_backfill_latency_target_ms),
+        slow_query_threshold_ms(_slow_query_threshold_ms),
+        auto_rebalance(_auto_rebalance),
+        index_build_priority(_index_build_priority),
+        dynamic_cache_size(_dynamic_cache_size),
+        user_quotas(std::move(_user_quotas)),
+        point_read_cache_size(_point_read_cache_size),
+        coalesce_writes(_coalesce_writes),
+        primary_key_filter(_primary_key_filter)
     {
         tls_configs = _tls_configs;
     }
@@ -150,6 +181,28 @@ public:
     std::vector<std::string> argv;
     int join_delay_secs;
     int node_reconnect_timeout_secs;
+    cache_eviction_policy_t cache_eviction_policy;
+    /* The share of a cache that snapshots may keep in old page versions, or 0 */
+    uint32_t snapshot_memory_limit_percent;
+    /* Whether large messages to other servers get compressed */
+    bool cluster_compression;
+    /* The disk read latency over which fewer backfills get to run, or 0 */
+    int64_t backfill_latency_target_ms;
+    /* Queries that take at least this long get logged, unless it's 0 */
+    int64_t slow_query_threshold_ms;
+    /* Whether to rebalance uneven tables without waiting for a `rebalance()` */
+    bool auto_rebalance;
+    sindex_build_priority_t index_build_priority;
+    /* Whether an automatically selected cache size follows the available memory */
+    bool dynamic_cache_size;
+    /* The `--user-quota`s, by user name */
+    std::map<std::string, ql::user_quota_t> user_quotas;
+    /* How many outdated point reads to cache, or 0 */
+    uint64_t point_read_cache_size;
+    /* Whether to write concurrent single inserts in batches */
+    bool coalesce_writes;
+    /* Whether every store keeps a bloom filter of its primary keys */
+    bool primary_key_filter;
     tls_configs_t tls_configs;
 };
 
@@ -122,14 +122,17 @@ public:
     public:
         write_txn_t(metadata_file_t *file, signal_t *interruptor);
 
+        /* Returns the size of the serialized value, for callers that keep track of
+        how much they're writing. */
         template<class T>
-        void write(
+        size_t write(
                 const key_t<T> &key,
                 const T &value,
                 signal_t *interruptor) {
             write_message_t wm;
             serialize<cluster_version_t::LATEST_DISK>(&wm, value);
             write_bin(key.key, &wm, interruptor);
+            return wm.size();
         }
 
         template<class T>
@@ -3,6 +3,12 @@
 
 #include "clustering/administration/persist/file_keys.hpp"
 
+/* We write a new snapshot once we've written about as many bytes of log entries as the
+last snapshot took up, so that the cost of snapshots is proportional to the rate of
+changes rather than to the size of the state. But we don't let the log grow longer than
+`MAX_LOG_ENTRIES_BETWEEN_SNAPSHOTS`, so that loading the state doesn't take too long. */
+static const size_t MAX_LOG_ENTRIES_BETWEEN_SNAPSHOTS = 1000;
+
 RDB_IMPL_SERIALIZABLE_3_SINCE_v2_1(table_raft_stored_header_t,
     current_term, voted_for, commit_index);
 RDB_IMPL_SERIALIZABLE_4_SINCE_v2_1(table_raft_stored_snapshot_t,
@@ -41,7 +47,8 @@ table_raft_storage_interface_t::table_raft_storage_interface_t(
         metadata_file_t::read_txn_t *txn,
         const namespace_id_t &_table_id,
         signal_t *interruptor) :
-        file(_file), table_id(_table_id) {
+        file(_file), table_id(_table_id),
+        snapshot_size(0), log_size_since_snapshot(0) {
     table_raft_stored_header_t header = txn->read(
         mdprefix_table_raft_header().suffix(uuid_to_str(table_id)), interruptor);
     state.current_term = header.current_term;
@@ -72,7 +79,8 @@ table_raft_storage_interface_t::table_raft_storage_interface_t(
         metadata_file_t::write_txn_t *txn,
         const namespace_id_t &_table_id,
         const raft_persistent_state_t<table_raft_state_t> &_state) :
-        file(_file), table_id(_table_id), state(_state) {
+        file(_file), table_id(_table_id), state(_state),
+        snapshot_size(0), log_size_since_snapshot(0) {
     cond_t non_interruptor;
 
     txn->write(
@@ -87,7 +95,7 @@ table_raft_storage_interface_t::table_raft_storage_interface_t(
     snapshot.snapshot_config = std::move(state.snapshot_config);
     snapshot.log_prev_index = state.log.prev_index;
     snapshot.log_prev_term = state.log.prev_term;
-    txn->write(
+    snapshot_size = txn->write(
         mdprefix_table_raft_snapshot().suffix(uuid_to_str(table_id)),
         snapshot,
         &non_interruptor);
@@ -96,7 +104,7 @@ table_raft_storage_interface_t::table_raft_storage_interface_t(
 
     for (raft_log_index_t i = state.log.prev_index + 1;
             i <= state.log.get_latest_index(); ++i) {
-        txn->write(
+        log_size_since_snapshot += txn->write(
             mdprefix_table_raft_log().suffix(
                 uuid_to_str(table_id) + "/" + log_index_to_str(i)),
             state.log.get_entry_ref(i),
@@ -172,7 +180,8 @@ void table_raft_storage_interface_t::write_log_replace_tail(
             mdprefix_table_raft_log().suffix(
                 uuid_to_str(table_id) + "/" + log_index_to_str(i));
         if (i <= source.get_latest_index()) {
-            txn.write(key, source.get_entry_ref(i), &non_interruptor);
+            log_size_since_snapshot +=
+                txn.write(key, source.get_entry_ref(i), &non_interruptor);
         } else {
             txn.erase(key, &non_interruptor);
         }
@@ -191,7 +200,7 @@ void table_raft_storage_interface_t::write_log_append_one(
     cond_t non_interruptor;
     metadata_file_t::write_txn_t txn(file, &non_interruptor);
     raft_log_index_t index = state.log.get_latest_index() + 1;
-    txn.write(
+    log_size_since_snapshot += txn.write(
         mdprefix_table_raft_log().suffix(
             uuid_to_str(table_id) + "/" + log_index_to_str(index)),
         entry,
@@ -219,10 +228,11 @@ void table_raft_storage_interface_t::write_snapshot(
     snapshot.snapshot_config = snapshot_config;
     snapshot.log_prev_index = log_prev_index;
     snapshot.log_prev_term = log_prev_term;
-    txn.write(
+    snapshot_size = txn.write(
         mdprefix_table_raft_snapshot().suffix(uuid_to_str(table_id)),
         snapshot,
         &non_interruptor);
+    log_size_since_snapshot = 0;
     for (raft_log_index_t i = state.log.prev_index + 1;
             i <= (clear_log ? state.log.get_latest_index() : log_prev_index); ++i) {
         txn.erase(
@@ -242,3 +252,11 @@ void table_raft_storage_interface_t::write_snapshot(
     txn.commit();
 }
 
+bool table_raft_storage_interface_t::should_take_snapshot(
+        size_t num_committed_entries) {
+    if (num_committed_entries <= snapshot_threshold) {
+        return false;
+    }
+    return log_size_since_snapshot >= snapshot_size
+        || num_committed_entries > MAX_LOG_ENTRIES_BETWEEN_SNAPSHOTS;
+}
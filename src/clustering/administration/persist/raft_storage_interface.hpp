@@ -79,11 +79,19 @@ public:
         raft_log_index_t log_prev_index,
         raft_term_t log_prev_term,
         raft_log_index_t commit_index);
+    bool should_take_snapshot(size_t num_committed_entries);
 
 private:
     metadata_file_t *const file;
     namespace_id_t const table_id;
     raft_persistent_state_t<table_raft_state_t> state;
+
+    /* The serialized size of the snapshot we wrote last (zero if we haven't written
+    one since we were loaded), and of the log entries we've written since then.
+    `should_take_snapshot()` uses these so that we don't rewrite a large table state
+    after every few small changes. */
+    size_t snapshot_size;
+    size_t log_size_since_snapshot;
 };
 
 #endif /* CLUSTERING_ADMINISTRATION_PERSIST_RAFT_STORAGE_INTERFACE_HPP_ */
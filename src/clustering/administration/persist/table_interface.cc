@@ -1,19 +1,96 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/administration/persist/table_interface.hpp"
 
+#include <stdio.h>
+#include <string.h>
+
 #include <algorithm>
 #include <array>
 
+#include "arch/runtime/thread_pool.hpp"
+#include "arch/timing.hpp"
 #include "clustering/administration/persist/branch_history_manager.hpp"
 #include "clustering/administration/persist/file_keys.hpp"
 #include "clustering/administration/persist/raft_storage_interface.hpp"
 #include "clustering/administration/perfmon_collection_repo.hpp"
+#include "concurrency/pmap.hpp"
+#include "config/args.hpp"
 #include "logger.hpp"
+#include "paths.hpp"
 #include "rdb_protocol/store.hpp"
 #include "serializer/log/log_serializer.hpp"
 #include "serializer/merger.hpp"
 #include "serializer/translator.hpp"
 
+/* The IDs of the most recently used blocks in each of a table's caches are kept in a
+file next to the table's file, so that the caches can be warmed up when the table is
+opened again. The file holds, for each store, the number of block IDs followed by the
+IDs, all as native 64-bit integers. Since it only affects how warm the cache is, a
+missing, outdated or damaged file is simply ignored. */
+static std::string hot_blocks_path_for(const serializer_filepath_t &path) {
+    return path.permanent_path() + ".hot";
+}
+
+static void write_hot_blocks(
+        const std::string &path,
+        const std::vector<std::vector<block_id_t> > &hot_blocks) {
+    std::string contents;
+    for (const std::vector<block_id_t> &block_ids : hot_blocks) {
+        const uint64_t count = block_ids.size();
+        contents.append(reinterpret_cast<const char *>(&count), sizeof(count));
+        contents.append(reinterpret_cast<const char *>(block_ids.data()),
+                        block_ids.size() * sizeof(block_id_t));
+    }
+    bool ok;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        const std::string temp_path = path + ".tmp";
+        FILE *fp = fopen(temp_path.c_str(), "wb");
+        ok = fp != nullptr
+            && fwrite(contents.data(), 1, contents.size(), fp) == contents.size();
+        if (fp != nullptr) {
+            ok = (fclose(fp) == 0) && ok;
+        }
+        ok = ok && rename(temp_path.c_str(), path.c_str()) == 0;
+        if (!ok) {
+            unlink(temp_path.c_str());
+        }
+    });
+    if (!ok) {
+        logWRN("Failed to save the list of recently used blocks to %s.", path.c_str());
+    }
+}
+
+static bool read_hot_blocks(
+        const std::string &path,
+        std::vector<std::vector<block_id_t> > *hot_blocks_out) {
+    std::string contents;
+    bool ok;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        ok = blocking_read_file(path.c_str(), &contents);
+    });
+    if (!ok) {
+        return false;
+    }
+    hot_blocks_out->clear();
+    size_t pos = 0;
+    while (pos < contents.size()) {
+        uint64_t count;
+        if (contents.size() - pos < sizeof(count)) {
+            return false;
+        }
+        memcpy(&count, contents.data() + pos, sizeof(count));
+        pos += sizeof(count);
+        if (count > (contents.size() - pos) / sizeof(block_id_t)) {
+            return false;
+        }
+        std::vector<block_id_t> block_ids(count);
+        memcpy(block_ids.data(), contents.data() + pos, count * sizeof(block_id_t));
+        pos += count * sizeof(block_id_t);
+        hot_blocks_out->push_back(std::move(block_ids));
+    }
+    return hot_blocks_out->size() == CPU_SHARDING_FACTOR;
+}
+
 class real_multistore_ptr_t :
     public multistore_ptr_t {
 public:
@@ -24,6 +101,8 @@ public:
             const base_path_t &base_path,
             io_backender_t *io_backender,
             cache_balancer_t *cache_balancer,
+            sindex_build_priority_t sindex_build_priority,
+            bool primary_key_filter,
             rdb_context_t *rdb_context,
             perfmon_collection_t *perfmon_collection_serializers,
             scoped_ptr_t<thread_allocation_t> &&serializer_thread,
@@ -32,8 +111,14 @@ public:
                 namespace_id_t, std::pair<real_multistore_ptr_t *, auto_drainer_t::lock_t>
             > *real_multistores) :
         branch_history_manager(std::move(bhm)),
+        log_serializer(nullptr),
+        hot_blocks_path(hot_blocks_path_for(path)),
         serializer_thread_allocation(std::move(serializer_thread)),
         store_thread_allocations(std::move(store_threads)),
+        hot_blocks_timer(new repeating_timer_t(HOT_BLOCKS_SAVE_INTERVAL_MS, [this]() {
+            coro_t::spawn_sometime(std::bind(
+                &real_multistore_ptr_t::save_hot_blocks, this, drainer.lock()));
+        })),
         map_insertion_sentry(
             real_multistores, table_id, std::make_pair(this, drainer.lock()))
     {
@@ -51,7 +136,7 @@ public:
         bool create = (res != 0);
 
         on_thread_t thread_switcher(serializer_thread_allocation->get_thread());
-        filepath_file_opener_t file_opener(path, io_backender);
+        filepath_file_opener_t file_opener(path, io_backender, true);
 
         if (create) {
             log_serializer_t::create(
@@ -62,10 +147,11 @@ public:
         // TODO: Could we handle failure when loading the serializer?  Right
         // now, we don't.
 
-        scoped_ptr_t<serializer_t> inner_serializer(new log_serializer_t(
+        log_serializer = new log_serializer_t(
             log_serializer_t::dynamic_config_t(),
             &file_opener,
-            perfmon_collection_serializers));
+            perfmon_collection_serializers);
+        scoped_ptr_t<serializer_t> inner_serializer(log_serializer);
         serializer.init(new merger_serializer_t(
             std::move(inner_serializer),
             MERGER_SERIALIZER_MAX_ACTIVE_WRITES));
@@ -95,6 +181,10 @@ public:
                 base_path,
                 table_id,
                 update_sindexes_t::UPDATE));
+            stores[ix]->sindex_build_priority = sindex_build_priority;
+            if (primary_key_filter) {
+                stores[ix]->enable_primary_key_filter();
+            }
 
             /* Initialize the metainfo if necessary */
             if (create) {
@@ -115,14 +205,27 @@ public:
 
         if (create) {
             file_opener.move_serializer_file_to_permanent_location();
+        } else {
+            /* Bring the blocks that were in use when the table was last shut down back
+            into the caches before anyone gets to query the table. */
+            std::vector<std::vector<block_id_t> > hot_blocks;
+            if (read_hot_blocks(hot_blocks_path, &hot_blocks)) {
+                cond_t non_interruptor;
+                pmap(CPU_SHARDING_FACTOR, [&](int ix) {
+                    on_thread_t thread_switcher_2(stores[ix]->home_thread());
+                    stores[ix]->cache->warm_up(hot_blocks[ix], &non_interruptor);
+                });
+            }
         }
     }
 
     ~real_multistore_ptr_t() {
+        hot_blocks_timer.reset();
         serializer_thread_allocation.reset();
         store_thread_allocations.clear();
         map_insertion_sentry.reset();
         drainer.drain();
+        save_hot_blocks(auto_drainer_t::lock_t());
         pmap(CPU_SHARDING_FACTOR, [this](int ix) {
             if (stores[ix].has()) {
                 on_thread_t thread_switcher(stores[ix]->home_thread());
@@ -154,6 +257,11 @@ public:
         return stores[i].get();
     }
 
+    void set_mmap_reads(bool enabled) {
+        on_thread_t thread_switcher(serializer->home_thread());
+        log_serializer->set_mmap_reads(enabled);
+    }
+
     bool is_gc_active() {
         rassert(!drainer.is_draining());
         if (serializer.has()) {
@@ -164,7 +272,26 @@ public:
     }
 
 private:
+    void save_hot_blocks(auto_drainer_t::lock_t) {
+        std::vector<std::vector<block_id_t> > hot_blocks(CPU_SHARDING_FACTOR);
+        bool all_stores = true;
+        pmap(CPU_SHARDING_FACTOR, [&](int ix) {
+            if (!stores[ix].has()) {
+                all_stores = false;
+                return;
+            }
+            on_thread_t thread_switcher(stores[ix]->home_thread());
+            hot_blocks[ix] = stores[ix]->cache->hot_block_ids(HOT_BLOCKS_MAX_PER_STORE);
+        });
+        if (all_stores) {
+            write_hot_blocks(hot_blocks_path, hot_blocks);
+        }
+    }
+
     scoped_ptr_t<real_branch_history_manager_t> branch_history_manager;
+    /* Owned by the `merger_serializer_t` in `serializer` */
+    log_serializer_t *log_serializer;
+    std::string hot_blocks_path;
     scoped_ptr_t<serializer_t> serializer;
     scoped_ptr_t<serializer_multiplexer_t> multiplexer;
     scoped_ptr_t<store_t> stores[CPU_SHARDING_FACTOR];
@@ -172,6 +299,9 @@ private:
     scoped_ptr_t<thread_allocation_t> serializer_thread_allocation;
     std::vector<scoped_ptr_t<thread_allocation_t> > store_thread_allocations;
 
+    /* Periodically saves the hot blocks, so that even a crash leaves us a recent list */
+    scoped_ptr_t<repeating_timer_t> hot_blocks_timer;
+
     auto_drainer_t drainer;
     map_insertion_sentry_t<
         namespace_id_t, std::pair<real_multistore_ptr_t *, auto_drainer_t::lock_t>
@@ -201,12 +331,21 @@ void real_table_persistence_interface_t::read_all_metadata(
         },
         interruptor);
     storage_interfaces.clear();
-    for (const auto &pair : active_tables) {
-        storage_interfaces[pair.first].init(new table_raft_storage_interface_t(
-            metadata_file, &read_txn, pair.first, interruptor));
-        active_cb(
-            pair.first, pair.second, storage_interfaces[pair.first].get(), &read_txn);
-    }
+    std::vector<std::pair<namespace_id_t, table_active_persistent_state_t> >
+        active_vector(active_tables.begin(), active_tables.end());
+    /* Opening a table reads its Raft log and loads its serializer's metablock and LBA,
+    so with many tables the startup time is dominated by waiting on the disk. The
+    tables are independent of each other, and reads on `read_txn` can run
+    concurrently, so several of them are opened at the same time. */
+    throttled_pmap(active_vector.size(), [&](int64_t i) {
+        const namespace_id_t &table_id = active_vector[i].first;
+        scoped_ptr_t<table_raft_storage_interface_t> storage(
+            new table_raft_storage_interface_t(
+                metadata_file, &read_txn, table_id, interruptor));
+        table_raft_storage_interface_t *storage_ptr = storage.get();
+        storage_interfaces[table_id] = std::move(storage);
+        active_cb(table_id, active_vector[i].second, storage_ptr, &read_txn);
+    }, TABLE_STARTUP_CONCURRENCY);
 
     read_txn.read_many<table_inactive_persistent_state_t>(
         mdprefix_table_inactive(),
@@ -286,7 +425,10 @@ void real_table_persistence_interface_t::load_multistore(
         new thread_allocation_t(&thread_allocator));
     std::vector<scoped_ptr_t<thread_allocation_t> > store_threads;
     for (size_t i = 0; i < CPU_SHARDING_FACTOR; ++i) {
-        store_threads.emplace_back(new thread_allocation_t(&thread_allocator));
+        // Keeping the stores on the serializer's NUMA node means that the blocks that
+        // the serializer reads into the page cache stay local to the node.
+        store_threads.emplace_back(new thread_allocation_t(
+            &thread_allocator, serializer_thread->get_thread()));
     }
 
     multistore_ptr_out->init(new real_multistore_ptr_t(
@@ -296,6 +438,8 @@ void real_table_persistence_interface_t::load_multistore(
         base_path,
         io_backender,
         cache_balancer,
+        sindex_build_priority,
+        primary_key_filter,
         rdb_context,
         perfmon_collection_serializers,
         std::move(serializer_thread),
@@ -325,6 +469,8 @@ void real_table_persistence_interface_t::destroy_multistore(
     const int res = ::unlink(filepath.c_str());
     guarantee_err(res == 0 || get_errno() == ENOENT,
                   "unlink failed for file %s", filepath.c_str());
+    ::unlink(hot_blocks_path_for(file_name_for(table_id)).c_str());
+    filepath_file_opener_t::unlink_stripe_files(file_name_for(table_id));
 }
 
 serializer_filepath_t real_table_persistence_interface_t::file_name_for(
@@ -36,7 +36,9 @@ real_reql_cluster_interface_t::real_reql_cluster_interface_t(
         watchable_map_t<
             std::pair<peer_id_t, std::pair<namespace_id_t, branch_id_t> >,
             table_query_bcard_t> *table_query_directory,
-        lifetime_t<name_resolver_t const &> name_resolver) :
+        lifetime_t<name_resolver_t const &> name_resolver,
+        uint64_t point_read_cache_size,
+        bool coalesce_writes) :
     m_mailbox_manager(mailbox_manager),
     m_auth_semilattice_view(auth_semilattice_view),
     m_cluster_semilattice_view(cluster_semilattice_view),
@@ -54,13 +56,17 @@ real_reql_cluster_interface_t::real_reql_cluster_interface_t(
         [this](const namespace_id_t &id, signal_t *interruptor) {
             return this->m_namespace_repo.get_namespace_interface(id, interruptor);
         },
-        name_resolver),
+        name_resolver,
+        point_read_cache_size),
     m_server_config_client(server_config_client)
 {
     guarantee(m_auth_semilattice_view->home_thread() == home_thread());
     guarantee(m_cluster_semilattice_view->home_thread() == home_thread());
     guarantee(m_table_meta_client->home_thread() == home_thread());
     guarantee(m_server_config_client->home_thread() == home_thread());
+    if (coalesce_writes) {
+        m_write_coalescer.init(new write_coalescer_t());
+    }
     for (int thr = 0; thr < get_num_threads(); ++thr) {
         m_cross_thread_database_watchables[thr].init(
             new cross_thread_watchable_variable_t<databases_semilattice_metadata_t>(
@@ -141,21 +147,22 @@ bool real_reql_cluster_interface_t::db_drop_uuid(
 
     user_context.require_config_permission(m_rdb_context, database_id, table_ids);
 
-    // Here we actually delete the tables
-    size_t tables_dropped = 0;
-    for (const auto &table_id : table_ids) {
-        try {
-            m_table_meta_client->drop(table_id, interruptor_on_home);
-            ++tables_dropped;
-        } catch (const no_such_table_exc_t &) {
-             /* The table was dropped by something else between the time when we called
-             `list_names()` and when we went to actually delete it. This is OK. */
-        } CATCH_OP_ERRORS(name, table_names.at(table_id).name, error_out,
-            "The database was not dropped, but some of the tables in it may or may not "
-                "have been dropped.",
-            "The database was not dropped, but some of the tables in it may or may not "
-                "have been dropped.")
+    /* Here we actually delete the tables, all at once. The tables that something else
+    dropped between the time when we called `list_names()` and now are skipped, which is
+    OK. */
+    std::set<namespace_id_t> dropped_table_ids;
+    try {
+        m_table_meta_client->drop_multi(
+            table_ids, interruptor_on_home, &dropped_table_ids);
+    } catch (const maybe_failed_table_op_exc_t &) {
+        *error_out = admin_err_t{
+            strprintf("We lost contact with the server(s) hosting some of the tables "
+                      "in database `%s`. The database was not dropped, but some of the "
+                      "tables in it may or may not have been dropped.", name.c_str()),
+            query_state_t::INDETERMINATE};
+        return false;
     }
+    size_t tables_dropped = dropped_table_ids.size();
 
     cluster_semilattice_metadata_t metadata = m_cluster_semilattice_view->get();
     auto iter = metadata.databases.databases.find(database_id);
@@ -291,6 +298,7 @@ bool real_reql_cluster_interface_t::table_create(
         counted_t<const ql::db_t> db,
         const table_generate_config_params_t &config_params,
         const std::string &primary_key,
+        key_generation_t key_generation,
         write_durability_t durability,
         signal_t *interruptor_on_caller,
         ql::datum_t *result_out,
@@ -321,6 +329,7 @@ bool real_reql_cluster_interface_t::table_create(
         config.config.basic.name = name;
         config.config.basic.database = db->id;
         config.config.basic.primary_key = primary_key;
+        config.config.basic.key_generation = key_generation;
 
         /* We don't have any data to generate split points based on, so assume UUIDs */
         calculate_split_points_for_uuids(
@@ -463,8 +472,10 @@ bool real_reql_cluster_interface_t::table_find(
         "real_reql_cluster_interface_t should never get queries for system tables");
     namespace_id_t table_id;
     std::string primary_key;
+    key_generation_t key_generation;
     try {
-        m_table_meta_client->find(db->id, name, &table_id, &primary_key);
+        m_table_meta_client->find(
+            db->id, name, &table_id, &primary_key, &key_generation);
 
         /* Note that we completely ignore `identifier_format`. `identifier_format` is
         meaningless for real tables, so it might seem like we should produce an error.
@@ -478,7 +489,9 @@ bool real_reql_cluster_interface_t::table_find(
             m_namespace_repo.get_namespace_interface(table_id, interruptor_on_caller),
             primary_key,
             &m_changefeed_client,
-            m_table_meta_client));
+            m_table_meta_client,
+            key_generation,
+            m_write_coalescer.get_or_null()));
 
         return true;
     } CATCH_NAME_ERRORS(db->name, name, error_out)
@@ -690,13 +703,23 @@ void real_reql_cluster_interface_t::reconfigure_internal(
     new_config.config.write_ack_config = old_config.config.write_ack_config;
     new_config.config.durability = old_config.config.durability;
 
-    calculate_split_points_intelligently(
-        table_id,
-        this,
-        params.num_shards,
-        old_config.shard_scheme,
-        interruptor_on_home,
-        &new_config.shard_scheme);
+    std::map<store_key_t, int64_t> counts;
+    if (params.minimal_movement) {
+        fetch_distribution(table_id, this, interruptor_on_home, &counts);
+        calculate_split_points_with_minimal_movement(
+            counts,
+            params.num_shards,
+            old_config.shard_scheme,
+            &new_config.shard_scheme);
+    } else {
+        calculate_split_points_intelligently(
+            table_id,
+            this,
+            params.num_shards,
+            old_config.shard_scheme,
+            interruptor_on_home,
+            &new_config.shard_scheme);
+    }
 
     /* `table_generate_config()` just generates the config; it doesn't apply it */
     table_generate_config(
@@ -739,6 +762,10 @@ void real_reql_cluster_interface_t::reconfigure_internal(
         result_builder.overwrite("config_changes",
             make_replacement_pair(old_config_datum, new_config_datum));
     }
+    if (params.minimal_movement) {
+        result_builder.overwrite("documents_to_move", ql::datum_t(static_cast<double>(
+            estimate_documents_to_move(counts, old_config, new_config))));
+    }
     *result_out = std::move(result_builder).to_datum();
 }
 
@@ -12,6 +12,7 @@
 #include "concurrency/cross_thread_watchable.hpp"
 #include "concurrency/watchable.hpp"
 #include "rdb_protocol/context.hpp"
+#include "rdb_protocol/write_coalescer.hpp"
 #include "rpc/semilattice/view.hpp"
 
 class artificial_reql_cluster_interface_t;
@@ -42,7 +43,9 @@ public:
             watchable_map_t<
                 std::pair<peer_id_t, std::pair<namespace_id_t, branch_id_t> >,
                 table_query_bcard_t> *table_query_directory,
-            lifetime_t<name_resolver_t const &> name_resolver);
+            lifetime_t<name_resolver_t const &> name_resolver,
+            uint64_t point_read_cache_size,
+            bool coalesce_writes);
 
     bool db_create(
             auth::user_context_t const &user_context,
@@ -85,6 +88,7 @@ public:
             counted_t<const ql::db_t> db,
             const table_generate_config_params_t &config_params,
             const std::string &primary_key,
+            key_generation_t key_generation,
             write_durability_t durability,
             signal_t *interruptor,
             ql::datum_t *result_out,
@@ -285,6 +289,7 @@ private:
 
     namespace_repo_t m_namespace_repo;
     ql::changefeed::client_t m_changefeed_client;
+    scoped_ptr_t<write_coalescer_t> m_write_coalescer;
     server_config_client_t *m_server_config_client;
 
     void wait_for_cluster_metadata_to_propagate(
@@ -7,7 +7,8 @@
 
 server_config_server_t::server_config_server_t(
         mailbox_manager_t *_mailbox_manager,
-        metadata_file_t *_file) :
+        metadata_file_t *_file,
+        bool _dynamic_cache_size) :
     mailbox_manager(_mailbox_manager),
     file(_file),
     my_config(server_config_versioned_t()),
@@ -21,6 +22,16 @@ server_config_server_t::server_config_server_t(
     my_server_id = read_txn.read(mdkey_server_id(), &non_interruptor);
     my_config.set_value(read_txn.read(mdkey_server_config(), &non_interruptor));
     update_actual_cache_size(my_config.get_ref().config.cache_size_bytes);
+
+    if (_dynamic_cache_size) {
+        dynamic_cache_size_timer.init(new repeating_timer_t(
+            DYNAMIC_CACHE_SIZE_INTERVAL_MS,
+            [this]() {
+                coro_t::spawn_sometime(std::bind(
+                    &server_config_server_t::adjust_dynamic_cache_size,
+                    this, drainer.lock()));
+            }));
+    }
 }
 
 server_config_business_card_t server_config_server_t::get_business_card() {
@@ -96,3 +107,27 @@ void server_config_server_t::update_actual_cache_size(
     actual_cache_size_bytes.set_value(actual_size);
 }
 
+void server_config_server_t::adjust_dynamic_cache_size(
+        UNUSED auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    if (static_cast<bool>(my_config.get_ref().config.cache_size_bytes)) {
+        // The user picked a cache size.
+        return;
+    }
+    const uint64_t current_size = actual_cache_size_bytes.get_ref();
+    const uint64_t new_size = get_dynamic_total_cache_size(current_size);
+    // The config may have changed while we were reading the memory statistics.
+    if (static_cast<bool>(my_config.get_ref().config.cache_size_bytes)
+        || actual_cache_size_bytes.get_ref() != current_size) {
+        return;
+    }
+    const uint64_t difference =
+        new_size > current_size ? new_size - current_size : current_size - new_size;
+    if (difference >= current_size / DYNAMIC_CACHE_SIZE_MIN_CHANGE_DIVISOR) {
+        logINF("Changing the cache size from %" PRIu64 " MB to %" PRIu64 " MB",
+            current_size / static_cast<uint64_t>(MEGABYTE),
+            new_size / static_cast<uint64_t>(MEGABYTE));
+        actual_cache_size_bytes.set_value(new_size);
+    }
+}
+
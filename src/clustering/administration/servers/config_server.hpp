@@ -4,16 +4,22 @@
 
 #include <set>
 
+#include "arch/timing.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/servers/server_metadata.hpp"
+#include "concurrency/auto_drainer.hpp"
 
 class metadata_file_t;
 
 class server_config_server_t : public home_thread_mixin_t {
 public:
+    /* With `_dynamic_cache_size`, an automatically selected cache size keeps getting
+    adjusted to the memory that is actually available, see
+    `get_dynamic_total_cache_size()`. */
     server_config_server_t(
         mailbox_manager_t *_mailbox_manager,
-        metadata_file_t *_file);
+        metadata_file_t *_file,
+        bool _dynamic_cache_size);
 
     server_config_business_card_t get_business_card();
 
@@ -37,6 +43,8 @@ private:
 
     void update_actual_cache_size(const optional<uint64_t> &setting);
 
+    void adjust_dynamic_cache_size(auto_drainer_t::lock_t keepalive);
+
     mailbox_manager_t *const mailbox_manager;
     metadata_file_t *const file;
     server_id_t my_server_id;
@@ -44,6 +52,10 @@ private:
     watchable_variable_t<uint64_t> actual_cache_size_bytes;
 
     server_config_business_card_t::set_config_mailbox_t set_config_mailbox;
+
+    // The timer must be destroyed before the drainer, since it acquires locks on it.
+    auto_drainer_t drainer;
+    scoped_ptr_t<repeating_timer_t> dynamic_cache_size_timer;
 };
 
 #endif /* CLUSTERING_ADMINISTRATION_SERVERS_CONFIG_SERVER_HPP_ */
@@ -5,6 +5,7 @@
 #include "clustering/administration/datum_adapter.hpp"
 #include "clustering/administration/main/watchable_fields.hpp"
 #include "clustering/administration/servers/config_client.hpp"
+#include "rpc/connectivity/cluster.hpp"
 
 ql::datum_t convert_ip_to_datum(const ip_address_t &ip) {
     return ql::datum_t(datum_string_t(ip.to_string()));
@@ -22,6 +23,7 @@ server_status_artificial_table_backend_t::server_status_artificial_table_backend
         lifetime_t<name_resolver_t const &> name_resolver,
         watchable_map_t<peer_id_t, cluster_directory_metadata_t> *_directory,
         server_config_client_t *_server_config_client,
+        connectivity_cluster_t *_connectivity_cluster,
         admin_identifier_format_t _admin_format)
     : common_server_artificial_table_backend_t(
         name_string_t::guarantee_valid("server_status"),
@@ -30,6 +32,7 @@ server_status_artificial_table_backend_t::server_status_artificial_table_backend
         _server_config_client,
         _directory),
       server_config_client(_server_config_client),
+      connectivity_cluster(_connectivity_cluster),
       admin_format(_admin_format),
       directory_subs(_directory,
         [&](const peer_id_t &peer, const cluster_directory_metadata_t *metadata) {
@@ -150,6 +153,29 @@ bool server_status_artificial_table_backend_t::format_row(
                 convert_microtime_to_datum(current_microtime()));
         }
     }
+    {
+        /* The round trip time between the server that runs the query and this one, as
+        measured by the heartbeat pings. `null` for the server that runs the query, and
+        until the first ping returns. */
+        ql::datum_t round_trip = ql::datum_t::null();
+        ql::datum_t round_trip_jitter = ql::datum_t::null();
+        auto_drainer_t::lock_t connection_keepalive;
+        connectivity_cluster_t::connection_t *connection =
+            connectivity_cluster->get_connection(peer_id, &connection_keepalive);
+        if (connection != nullptr && !connection->is_loopback()) {
+            const int64_t usecs = connection->get_round_trip_usecs();
+            const int64_t jitter_usecs = connection->get_round_trip_jitter_usecs();
+            if (usecs >= 0) {
+                round_trip = ql::datum_t(static_cast<double>(usecs) / THOUSAND);
+            }
+            if (jitter_usecs >= 0) {
+                round_trip_jitter =
+                    ql::datum_t(static_cast<double>(jitter_usecs) / THOUSAND);
+            }
+        }
+        net_builder.overwrite("round_trip_time_ms", round_trip);
+        net_builder.overwrite("round_trip_jitter_ms", round_trip_jitter);
+    }
     builder.overwrite("network", std::move(net_builder).to_datum());
 
     *row_out = std::move(builder).to_datum();
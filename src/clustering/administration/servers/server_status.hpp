@@ -11,6 +11,7 @@
 #include "rdb_protocol/artificial_table/backend.hpp"
 #include "rpc/semilattice/view.hpp"
 
+class connectivity_cluster_t;
 class server_config_client_t;
 
 class server_status_artificial_table_backend_t :
@@ -22,6 +23,7 @@ public:
             lifetime_t<name_resolver_t const &> name_resolver,
             watchable_map_t<peer_id_t, cluster_directory_metadata_t> *_directory,
             server_config_client_t *_server_config_client,
+            connectivity_cluster_t *_connectivity_cluster,
             admin_identifier_format_t _admin_format);
     ~server_status_artificial_table_backend_t();
 
@@ -46,6 +48,8 @@ private:
     std::map<peer_id_t, microtime_t> connect_times;
 
     server_config_client_t *server_config_client;
+    /* Used to look up the round trip times between this server and the others */
+    connectivity_cluster_t *connectivity_cluster;
     admin_identifier_format_t admin_format;
     /* We use `directory_subs` to note when a server first connects. */
     watchable_map_t<peer_id_t, cluster_directory_metadata_t>::all_subs_t directory_subs;
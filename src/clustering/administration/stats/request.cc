@@ -34,12 +34,16 @@ const char *table_server_stats_request_t::table_server_request_type = "table_ser
 parsed_stats_t::server_stats_t::server_stats_t() :
     responsive(false),
     queries_per_sec(0), queries_total(0),
-    client_connections(0), clients_active(0) { }
+    client_connections(0), clients_active(0),
+    queries_queued(0), queries_rejected(0),
+    compiled_query_hits(0), compiled_query_misses(0),
+    changefeed_queued_changes(0), changefeed_skipped_changes(0) { }
 
 parsed_stats_t::table_stats_t::table_stats_t() :
     read_docs_per_sec(0), read_docs_total(0),
     written_docs_per_sec(0), written_docs_total(0),
-    in_use_bytes(0), metadata_bytes(0), data_bytes(0),
+    in_use_bytes(0), allocated_bytes(0), reserved_bytes(0),
+    metadata_bytes(0), data_bytes(0),
     garbage_bytes(0), preallocated_bytes(0),
     read_bytes_per_sec(0), read_bytes_total(0),
     written_bytes_per_sec(0), written_bytes_total(0) { }
@@ -65,6 +69,8 @@ parsed_stats_t::parsed_stats_t(const std::vector<ql::datum_t> &stats) {
             std::pair<datum_string_t, ql::datum_t> perf_pair = s.get_pair(i);
             if (perf_pair.first == "query_engine") {
                 store_query_engine_stats(perf_pair.second, &serv_stats);
+            } else if (perf_pair.first == "memory") {
+                serv_stats.memory = perf_pair.second;
             } else {
                 namespace_id_t table_id;
                 res = str_to_uuid(perf_pair.first.to_std(), &table_id);
@@ -125,6 +131,10 @@ void parsed_stats_t::store_shard_values(const ql::datum_t &shard_perf,
                 } else if (key == "cache") {
                     add_perfmon_value(sub_pair.second, "in_use_bytes",
                                       &stats_out->in_use_bytes);
+                    add_perfmon_value(sub_pair.second, "allocated_bytes",
+                                      &stats_out->allocated_bytes);
+                    add_perfmon_value(sub_pair.second, "reserved_bytes",
+                                      &stats_out->reserved_bytes);
                 }
             }
         }
@@ -167,6 +177,16 @@ void parsed_stats_t::store_query_engine_stats(const ql::datum_t &qe_perf,
     store_perfmon_value(qe_perf, "queries_total", &stats_out->queries_total);
     store_perfmon_value(qe_perf, "client_connections", &stats_out->client_connections);
     store_perfmon_value(qe_perf, "clients_active", &stats_out->clients_active);
+    store_perfmon_value(qe_perf, "queries_queued", &stats_out->queries_queued);
+    store_perfmon_value(qe_perf, "queries_rejected", &stats_out->queries_rejected);
+    store_perfmon_value(qe_perf, "compiled_query_hits",
+                        &stats_out->compiled_query_hits);
+    store_perfmon_value(qe_perf, "compiled_query_misses",
+                        &stats_out->compiled_query_misses);
+    store_perfmon_value(qe_perf, "changefeed_queued_changes",
+                        &stats_out->changefeed_queued_changes);
+    store_perfmon_value(qe_perf, "changefeed_skipped_changes",
+                        &stats_out->changefeed_skipped_changes);
 }
 
 void parsed_stats_t::store_table_stats(const namespace_id_t &table_id,
@@ -407,6 +427,7 @@ server_stats_request_t::server_stats_request_t(const server_id_t &_server_id) :
 std::set<std::vector<std::string> > server_stats_request_t::get_filter() const {
     return std::set<std::vector<std::string> >(
         { {"query_engine"},
+          {"memory"},
           {".*", "serializers", "shard_[0-9]+", "btree-.*" } });
 }
 
@@ -452,11 +473,20 @@ bool server_stats_request_t::to_datum(const parsed_stats_t &stats,
         ADD_STAT(qe_builder, server_stats, clients_active);
         ADD_STAT(qe_builder, server_stats, queries_per_sec);
         ADD_STAT(qe_builder, server_stats, queries_total);
+        ADD_STAT(qe_builder, server_stats, queries_queued);
+        ADD_STAT(qe_builder, server_stats, queries_rejected);
+        ADD_STAT(qe_builder, server_stats, compiled_query_hits);
+        ADD_STAT(qe_builder, server_stats, compiled_query_misses);
+        ADD_STAT(qe_builder, server_stats, changefeed_queued_changes);
+        ADD_STAT(qe_builder, server_stats, changefeed_skipped_changes);
         ADD_SERVER_STAT(qe_builder, stats, server_id, read_docs_per_sec);
         ADD_SERVER_STAT(qe_builder, stats, server_id, read_docs_total);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_per_sec);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_total);
         row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
+        if (server_stats.memory.has()) {
+            row_builder.overwrite("memory", server_stats.memory);
+        }
     }
     *result_out = std::move(row_builder).to_datum();
     return true;
@@ -552,6 +582,8 @@ bool table_server_stats_request_t::to_datum(const parsed_stats_t &stats,
 
         ql::datum_object_builder_t se_cache_builder;
         ADD_STAT(se_cache_builder, table_stats, in_use_bytes);
+        ADD_STAT(se_cache_builder, table_stats, allocated_bytes);
+        ADD_STAT(se_cache_builder, table_stats, reserved_bytes);
 
         ql::datum_object_builder_t se_disk_space_builder;
         ADD_STAT(se_disk_space_builder, table_stats, metadata_bytes);
@@ -28,6 +28,8 @@ public:
         double written_docs_per_sec;
         double written_docs_total;
         double in_use_bytes;
+        double allocated_bytes;
+        double reserved_bytes;
         double metadata_bytes;
         double data_bytes;
         double garbage_bytes;
@@ -46,6 +48,15 @@ public:
         double queries_total;
         double client_connections;
         double clients_active;
+        double queries_queued;
+        double queries_rejected;
+        double compiled_query_hits;
+        double compiled_query_misses;
+        double changefeed_queued_changes;
+        double changefeed_skipped_changes;
+
+        // The `memory` stats of the server, which are passed through as they are
+        ql::datum_t memory;
 
         std::map<namespace_id_t, table_stats_t> tables;
     };
@@ -0,0 +1,130 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/tables/auto_rebalancer.hpp"
+
+#include <algorithm>
+
+#include "clustering/administration/real_reql_cluster_interface.hpp"
+#include "clustering/administration/tables/split_points.hpp"
+#include "clustering/table_manager/table_meta_client.hpp"
+#include "logger.hpp"
+
+auto_rebalancer_t::auto_rebalancer_t(
+        const server_id_t &_server_id,
+        table_meta_client_t *_table_meta_client,
+        real_reql_cluster_interface_t *_reql_cluster_interface) :
+    server_id(_server_id),
+    table_meta_client(_table_meta_client),
+    reql_cluster_interface(_reql_cluster_interface),
+    checking(false),
+    timer(AUTO_REBALANCE_CHECK_INTERVAL_MS, this) { }
+
+void auto_rebalancer_t::on_ring() {
+    /* A check can take longer than the timer interval if there are many tables, in
+    which case we just skip this ring. */
+    if (!checking) {
+        checking = true;
+        coro_t::spawn_sometime(std::bind(&auto_rebalancer_t::check_tables,
+                                         this, drainer.lock()));
+    }
+}
+
+void auto_rebalancer_t::check_tables(auto_drainer_t::lock_t keepalive) {
+    signal_t *interruptor = keepalive.get_drain_signal();
+    std::map<namespace_id_t, table_basic_config_t> tables;
+    table_meta_client->list_names(&tables);
+    try {
+        for (const auto &pair : tables) {
+            auto it = last_rebalanced.find(pair.first);
+            if (it != last_rebalanced.end() && current_microtime() <
+                    it->second + AUTO_REBALANCE_MIN_INTERVAL_MS * 1000) {
+                continue;
+            }
+            try {
+                if (rebalance_if_uneven(pair.first, interruptor)) {
+                    last_rebalanced[pair.first] = current_microtime();
+                    break;
+                }
+            } catch (const no_such_table_exc_t &) {
+                /* The table was dropped in the meantime */
+            } catch (const failed_table_op_exc_t &) {
+                /* The table isn't available right now; try again next time. */
+            } catch (const maybe_failed_table_op_exc_t &) {
+                logWRN("Automatic rebalancing of table `%s` (%s) may or may not have "
+                    "succeeded.", pair.second.name.c_str(),
+                    uuid_to_str(pair.first).c_str());
+                last_rebalanced[pair.first] = current_microtime();
+                break;
+            } catch (const config_change_exc_t &) {
+                /* Someone else changed the config at the same time; the next check
+                will look at the table again. */
+            }
+        }
+    } catch (const interrupted_exc_t &) {
+        /* We're shutting down */
+    }
+
+    /* Forget about tables that no longer exist */
+    for (auto it = last_rebalanced.begin(); it != last_rebalanced.end();) {
+        if (tables.count(it->first) == 0) {
+            last_rebalanced.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+    checking = false;
+}
+
+bool auto_rebalancer_t::rebalance_if_uneven(
+        const namespace_id_t &table_id, signal_t *interruptor) {
+    table_config_and_shards_t config;
+    table_meta_client->get_config(table_id, interruptor, &config);
+    const size_t num_shards = config.shard_scheme.num_shards();
+    if (num_shards < 2 || config.config.shards.empty() ||
+            config.config.shards[0].primary_replica != server_id) {
+        return false;
+    }
+
+    /* Don't pile a rebalance on top of backfills that are still running */
+    bool all_replicas_ready;
+    table_meta_client->get_shard_status(
+        table_id, all_replicas_ready_mode_t::INCLUDE_RAFT_TEST, interruptor,
+        nullptr, &all_replicas_ready);
+    if (!all_replicas_ready) {
+        return false;
+    }
+
+    std::map<store_key_t, int64_t> counts;
+    fetch_distribution(table_id, reql_cluster_interface, interruptor, &counts);
+
+    /* Each entry of the distribution counts the documents from its key up to the next
+    entry's key, so we attribute it to the shard that contains its key. */
+    std::vector<int64_t> shard_counts(num_shards, 0);
+    int64_t total = 0;
+    for (const auto &pair : counts) {
+        shard_counts[config.shard_scheme.find_shard_for_key(pair.first)] += pair.second;
+        total += pair.second;
+    }
+    if (total < AUTO_REBALANCE_MIN_DOCUMENTS) {
+        return false;
+    }
+    const int64_t largest = *std::max_element(shard_counts.begin(), shard_counts.end());
+    const double imbalance = static_cast<double>(largest) * num_shards / total;
+    if (imbalance < AUTO_REBALANCE_IMBALANCE_RATIO) {
+        return false;
+    }
+
+    table_shard_scheme_t old_shard_scheme = config.shard_scheme;
+    if (!calculate_split_points_with_distribution(
+            counts, num_shards, &config.shard_scheme)
+            || config.shard_scheme == old_shard_scheme) {
+        return false;
+    }
+
+    logNTC("Rebalancing table `%s` (%s) automatically, because its largest shard has "
+        "%.1f times its share of the documents.", config.config.basic.name.c_str(),
+        uuid_to_str(table_id).c_str(), imbalance);
+    table_config_and_shards_change_t change(
+        table_config_and_shards_change_t::set_table_config_and_shards_t{ config });
+    table_meta_client->set_config(table_id, change, interruptor);
+    return true;
+}
@@ -0,0 +1,53 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_TABLES_AUTO_REBALANCER_HPP_
+#define CLUSTERING_ADMINISTRATION_TABLES_AUTO_REBALANCER_HPP_
+
+#include <map>
+
+#include "arch/timing.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "containers/uuid.hpp"
+#include "rpc/connectivity/server_id.hpp"
+#include "time.hpp"
+
+class real_reql_cluster_interface_t;
+class table_meta_client_t;
+
+/* `auto_rebalancer_t` periodically looks for tables whose shards have grown uneven and
+moves their split points the same way `r.table(...).rebalance()` would. The new split
+points are applied as a normal config change, so the data moves through the usual
+contracts and backfills.
+
+Only the primary replica of a table's first shard checks the table, so with the option
+on several servers each table still has a single server looking after it. To limit how
+much data is moving at once, each check rebalances at most one table, only tables whose
+replicas are all ready are considered, and a table isn't rebalanced again until
+`AUTO_REBALANCE_MIN_INTERVAL_MS` have passed. */
+class auto_rebalancer_t : private repeating_timer_callback_t {
+public:
+    auto_rebalancer_t(
+        const server_id_t &_server_id,
+        table_meta_client_t *_table_meta_client,
+        real_reql_cluster_interface_t *_reql_cluster_interface);
+
+private:
+    void on_ring();
+    void check_tables(auto_drainer_t::lock_t keepalive);
+
+    /* Returns `true` if it changed the table's split points. */
+    bool rebalance_if_uneven(const namespace_id_t &table_id, signal_t *interruptor);
+
+    const server_id_t server_id;
+    table_meta_client_t *const table_meta_client;
+    real_reql_cluster_interface_t *const reql_cluster_interface;
+
+    bool checking;
+    std::map<namespace_id_t, microtime_t> last_rebalanced;
+
+    auto_drainer_t drainer;
+    repeating_timer_t timer;
+
+    DISABLE_COPYING(auto_rebalancer_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_TABLES_AUTO_REBALANCER_HPP_ */
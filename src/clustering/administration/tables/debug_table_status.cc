@@ -265,6 +265,10 @@ ql::datum_t convert_debug_statuses_to_datum(
         peer_builder.overwrite("current_branches",
              convert_debug_current_branches_to_datum(
                 peer.second.raft_state->current_branches));
+        /* The number of branches that the Raft state keeps for the table, so that we
+        can tell if the branch history GC keeps up. */
+        peer_builder.overwrite("branch_history_size", ql::datum_t(static_cast<double>(
+            peer.second.raft_state->branch_history.branches.size())));
         builder.add(std::move(peer_builder).to_datum());
     }
     return std::move(builder).to_datum();
@@ -166,7 +166,9 @@ the given shard.
 `other_usage_cost` is for shards of other tables on the server. `backfill_cost` is the
 cost to copy data to the given server, as computed by
 `estimate_cost_to_get_up_to_date()`. When comparing two pairings, we first prioritize
-`self_usage_cost`, then `backfill_cost`, then `other_usage_cost`.
+`self_usage_cost`, then `backfill_cost`, then `other_usage_cost`. With
+`minimal_movement`, `backfill_cost` comes first, so that replicas stay where they are
+even if that leaves the servers less evenly loaded.
 
 Because we'll be regularly updating `self_usage_cost`, we want to make updating it
 inexpensive. We solve this by storing `self_usage_cost` for an entire group of pairings
@@ -190,6 +192,7 @@ public:
     std::multiset<pairing_t> pairings;
     int other_usage_cost;
     server_id_t server;
+    bool minimal_movement;
 };
 
 bool operator<(const pairing_t &x, const pairing_t &y) {
@@ -200,6 +203,13 @@ bool operator<(const counted_t<countable_wrapper_t<server_pairings_t> > &x,
                const counted_t<countable_wrapper_t<server_pairings_t> > &y) {
     guarantee(!x->pairings.empty());
     guarantee(!y->pairings.empty());
+    if (x->minimal_movement) {
+        if (*x->pairings.begin() < *y->pairings.begin()) {
+            return true;
+        } else if (*y->pairings.begin() < *x->pairings.begin()) {
+            return false;
+        }
+    }
     if (x->self_usage_cost < y->self_usage_cost) {
         return true;
     } else if (x->self_usage_cost > y->self_usage_cost) {
@@ -340,6 +350,7 @@ void table_generate_config(
             server_pairings_t sp;
             sp.server = server;
             sp.self_usage_cost = 0;
+            sp.minimal_movement = params.minimal_movement;
             auto u_it = server_usage.find(server);
             sp.other_usage_cost = (u_it == server_usage.end()) ? 0 : u_it->second;
             for (size_t shard = 0; shard < params.num_shards; ++shard) {
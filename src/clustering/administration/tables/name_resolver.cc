@@ -48,11 +48,12 @@ optional<table_basic_config_t> name_resolver_t::table_id_to_basic_config(
                 m_artificial_reql_cluster_interface.get_table_backends_map()) {
             if (table_backend.second.first != nullptr &&
                     table_backend.second.first->get_table_id() == table_id) {
-                return make_optional(table_basic_config_t{
-                        table_backend.first,
-                        artificial_reql_cluster_interface_t::database_id,
-                        table_backend.second.first->get_primary_key_name()
-                    });
+                table_basic_config_t basic_config;
+                basic_config.name = table_backend.first;
+                basic_config.database = artificial_reql_cluster_interface_t::database_id;
+                basic_config.primary_key =
+                    table_backend.second.first->get_primary_key_name();
+                return make_optional(basic_config);
             }
         }
     }
@@ -156,6 +156,119 @@ bool calculate_split_points_with_distribution(
     return true;
 }
 
+static int64_t count_in_range(
+        const std::map<store_key_t, int64_t> &counts,
+        const key_range_t &range) {
+    int64_t total = 0;
+    for (auto it = counts.lower_bound(range.left);
+            it != counts.end() && range.contains_key(it->first);
+            ++it) {
+        total += it->second;
+    }
+    return total;
+}
+
+/* Picks a key that splits `range` into two halves with about as many documents each,
+or returns `false` if there's no key strictly inside `range`. */
+static bool pick_split_key(
+        const std::map<store_key_t, int64_t> &counts,
+        const key_range_t &range,
+        store_key_t *split_key_out) {
+    const int64_t total = count_in_range(counts, range);
+    int64_t seen = 0;
+    for (auto it = counts.lower_bound(range.left);
+            it != counts.end() && range.contains_key(it->first);
+            ++it) {
+        if (seen > 0 && seen * 2 >= total && it->first > range.left) {
+            *split_key_out = it->first;
+            return true;
+        }
+        seen += it->second;
+    }
+    /* Too few documents to go by; split the key space in the middle instead. */
+    const store_key_t right =
+        range.right.unbounded ? store_key_t::max() : range.right.key();
+    *split_key_out = interpolate_key(range.left, right, 0.5);
+    return *split_key_out > range.left && *split_key_out < right;
+}
+
+void calculate_split_points_with_minimal_movement(
+        const std::map<store_key_t, int64_t> &counts,
+        size_t num_shards,
+        const table_shard_scheme_t &old_split_points,
+        table_shard_scheme_t *split_points_out) {
+    guarantee(num_shards > 0);
+    table_shard_scheme_t scheme = old_split_points;
+    std::set<size_t> unsplittable;
+    while (scheme.num_shards() < num_shards) {
+        /* Split the largest shard that can still be split */
+        optional<size_t> largest;
+        int64_t largest_count = -1;
+        for (size_t i = 0; i < scheme.num_shards(); ++i) {
+            int64_t count = count_in_range(counts, scheme.get_shard_range(i));
+            if (unsplittable.count(i) == 0 && count > largest_count) {
+                largest.set(i);
+                largest_count = count;
+            }
+        }
+        if (!largest) {
+            break;
+        }
+        store_key_t split_key;
+        if (!pick_split_key(counts, scheme.get_shard_range(*largest), &split_key)) {
+            unsplittable.insert(*largest);
+            continue;
+        }
+        scheme.split_points.insert(
+            scheme.split_points.begin() + *largest, split_key);
+        /* The shards to the right of the split moved up by one */
+        std::set<size_t> shifted;
+        for (size_t i : unsplittable) {
+            shifted.insert(i > *largest ? i + 1 : i);
+        }
+        unsplittable = std::move(shifted);
+    }
+    while (scheme.num_shards() > num_shards) {
+        /* Merge the neighbouring shards with the fewest documents between them */
+        size_t best = 0;
+        int64_t best_count = std::numeric_limits<int64_t>::max();
+        int64_t prev_count = count_in_range(counts, scheme.get_shard_range(0));
+        for (size_t i = 0; i < scheme.split_points.size(); ++i) {
+            int64_t next_count = count_in_range(counts, scheme.get_shard_range(i + 1));
+            if (prev_count + next_count < best_count) {
+                best = i;
+                best_count = prev_count + next_count;
+            }
+            prev_count = next_count;
+        }
+        scheme.split_points.erase(scheme.split_points.begin() + best);
+    }
+    if (scheme.num_shards() < num_shards) {
+        /* The key space is too crowded to split without moving the old split points */
+        calculate_split_points_by_interpolation(num_shards, old_split_points, &scheme);
+    }
+    *split_points_out = std::move(scheme);
+}
+
+int64_t estimate_documents_to_move(
+        const std::map<store_key_t, int64_t> &counts,
+        const table_config_and_shards_t &old_config,
+        const table_config_and_shards_t &new_config) {
+    int64_t total = 0;
+    for (const auto &pair : counts) {
+        const table_config_t::shard_t &old_shard = old_config.config.shards.at(
+            old_config.shard_scheme.find_shard_for_key(pair.first));
+        const table_config_t::shard_t &new_shard = new_config.config.shards.at(
+            new_config.shard_scheme.find_shard_for_key(pair.first));
+        for (const server_id_t &server : new_shard.all_replicas) {
+            if (old_shard.all_replicas.count(server) == 0) {
+                total += pair.second;
+            }
+        }
+    }
+    return total;
+}
+
 store_key_t key_for_uuid(uint64_t first_8_bytes) {
     uuid_u uuid;
     memset(uuid.data(), 0, uuid_u::static_size());
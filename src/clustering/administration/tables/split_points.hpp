@@ -12,6 +12,7 @@
 
 class real_reql_cluster_interface_t;
 class signal_t;
+class table_config_and_shards_t;
 class table_shard_scheme_t;
 
 /* `fetch_distribution` fetches the distribution information from the database. */
@@ -46,6 +47,24 @@ void calculate_split_points_by_interpolation(
         const table_shard_scheme_t &old_split_points,
         table_shard_scheme_t *split_points_out);
 
+/* `calculate_split_points_with_minimal_movement` keeps as many of the old split points
+as it can. To add shards it splits the shards with the most documents at their median,
+using the results of `fetch_distribution()`; to remove shards it merges the neighbouring
+pair of shards with the fewest documents. */
+void calculate_split_points_with_minimal_movement(
+        const std::map<store_key_t, int64_t> &counts,
+        size_t num_shards,
+        const table_shard_scheme_t &old_split_points,
+        table_shard_scheme_t *split_points_out);
+
+/* `estimate_documents_to_move` estimates how many documents have to be copied to
+servers that don't have them yet if the table goes from `old_config` to `new_config`,
+counting each copy separately. */
+int64_t estimate_documents_to_move(
+        const std::map<store_key_t, int64_t> &counts,
+        const table_config_and_shards_t &old_config,
+        const table_config_and_shards_t &new_config);
+
 /* `calculate_split_points_intelligently` picks one of the above methods based on its
 input. If the number of shards is being increased, it takes a distribution; if the number
 is being decreased, it interpolates; and if the number stays the same, it uses the old
@@ -1,6 +1,8 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "clustering/administration/tables/table_config.hpp"
 
+#include <limits>
+
 #include "clustering/administration/datum_adapter.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/tables/generate_config.hpp"
@@ -227,6 +229,145 @@ bool convert_durability_from_datum(
     return true;
 }
 
+ql::datum_t convert_key_generation_to_datum(key_generation_t key_generation) {
+    switch (key_generation) {
+        case key_generation_t::RANDOM:
+            return ql::datum_t("random");
+        case key_generation_t::TIME_ORDERED:
+            return ql::datum_t("time_ordered");
+        default:
+            unreachable();
+    }
+}
+
+bool convert_key_generation_from_datum(
+        const ql::datum_t &datum,
+        key_generation_t *key_generation_out,
+        admin_err_t *error_out) {
+    if (datum == ql::datum_t("random")) {
+        *key_generation_out = key_generation_t::RANDOM;
+    } else if (datum == ql::datum_t("time_ordered")) {
+        *key_generation_out = key_generation_t::TIME_ORDERED;
+    } else {
+        *error_out = admin_err_t{
+            "Expected \"random\" or \"time_ordered\", got: " + datum.print(),
+            query_state_t::FAILED};
+        return false;
+    }
+    return true;
+}
+
+ql::datum_t convert_table_cache_config_to_datum(
+        const table_cache_config_t &cache) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("reserved_mb",
+        ql::datum_t(static_cast<double>(cache.reserved_bytes) / MEGABYTE));
+    if (cache.limit_bytes.has_value()) {
+        builder.overwrite("limit_mb",
+            ql::datum_t(static_cast<double>(*cache.limit_bytes) / MEGABYTE));
+    } else {
+        builder.overwrite("limit_mb", ql::datum_t::null());
+    }
+    builder.overwrite("mmap", ql::datum_t::boolean(cache.mmap_reads));
+    return std::move(builder).to_datum();
+}
+
+bool convert_cache_size_mb_from_datum(
+        const ql::datum_t &datum,
+        uint64_t *bytes_out,
+        admin_err_t *error_out) {
+    if (datum.get_type() != ql::datum_t::R_NUM) {
+        *error_out = admin_err_t{
+            "Expected a number, got " + datum.print(),
+            query_state_t::FAILED};
+        return false;
+    }
+    double size_mb = datum.as_num();
+    if (size_mb < 0) {
+        *error_out = admin_err_t{
+            "Cache size cannot be negative.",
+            query_state_t::FAILED};
+        return false;
+    }
+    if (size_mb * MEGABYTE > static_cast<double>(std::numeric_limits<int64_t>::max())) {
+        *error_out = admin_err_t{"Value is too big.", query_state_t::FAILED};
+        return false;
+    }
+    *bytes_out = static_cast<uint64_t>(size_mb * MEGABYTE);
+    return true;
+}
+
+bool convert_table_cache_config_from_datum(
+        const ql::datum_t &datum,
+        table_cache_config_t *cache_out,
+        admin_err_t *error_out) {
+    converter_from_datum_object_t converter;
+    if (!converter.init(datum, error_out)) {
+        return false;
+    }
+
+    if (converter.has("reserved_mb")) {
+        ql::datum_t reserved_datum;
+        if (!converter.get("reserved_mb", &reserved_datum, error_out)) {
+            return false;
+        }
+        if (!convert_cache_size_mb_from_datum(
+                reserved_datum, &cache_out->reserved_bytes, error_out)) {
+            error_out->msg = "In `reserved_mb`: " + error_out->msg;
+            return false;
+        }
+    } else {
+        cache_out->reserved_bytes = 0;
+    }
+
+    cache_out->limit_bytes.reset();
+    if (converter.has("limit_mb")) {
+        ql::datum_t limit_datum;
+        if (!converter.get("limit_mb", &limit_datum, error_out)) {
+            return false;
+        }
+        if (limit_datum.get_type() != ql::datum_t::R_NULL) {
+            uint64_t limit_bytes;
+            if (!convert_cache_size_mb_from_datum(
+                    limit_datum, &limit_bytes, error_out)) {
+                error_out->msg = "In `limit_mb`: " + error_out->msg;
+                return false;
+            }
+            cache_out->limit_bytes.set(limit_bytes);
+        }
+    }
+
+    if (converter.has("mmap")) {
+        ql::datum_t mmap_datum;
+        if (!converter.get("mmap", &mmap_datum, error_out)) {
+            return false;
+        }
+        if (mmap_datum.get_type() != ql::datum_t::R_BOOL) {
+            *error_out = admin_err_t{
+                "In `mmap`: Expected a boolean, got " + mmap_datum.print(),
+                query_state_t::FAILED};
+            return false;
+        }
+        cache_out->mmap_reads = mmap_datum.as_bool();
+    } else {
+        cache_out->mmap_reads = false;
+    }
+
+    if (cache_out->limit_bytes.has_value()
+            && *cache_out->limit_bytes < cache_out->reserved_bytes) {
+        *error_out = admin_err_t{
+            "`limit_mb` cannot be smaller than `reserved_mb`.",
+            query_state_t::FAILED};
+        return false;
+    }
+
+    if (!converter.check_no_extra_keys(error_out)) {
+        return false;
+    }
+
+    return true;
+}
+
 ql::datum_t convert_table_config_shard_to_datum(
         const table_config_t::shard_t &shard,
         admin_identifier_format_t identifier_format,
@@ -399,6 +540,8 @@ ql::datum_t convert_table_config_to_datum(
     builder.overwrite("indexes", convert_sindexes_to_datum(config.sindexes));
     builder.overwrite("write_hook", convert_write_hook_to_datum(config.write_hook));
     builder.overwrite("primary_key", convert_string_to_datum(config.basic.primary_key));
+    builder.overwrite("key_generation",
+        convert_key_generation_to_datum(config.basic.key_generation));
     builder.overwrite("shards",
         convert_vector_to_datum<table_config_t::shard_t>(
             [&](const table_config_t::shard_t &shard) {
@@ -410,6 +553,7 @@ ql::datum_t convert_table_config_to_datum(
         convert_write_ack_config_to_datum(config.write_ack_config));
     builder.overwrite("durability",
         convert_durability_to_datum(config.durability));
+    builder.overwrite("cache", convert_table_cache_config_to_datum(config.cache));
     return std::move(builder).to_datum();
 }
 
@@ -603,6 +747,42 @@ bool convert_table_config_and_name_from_datum(
         config_out->durability = write_durability_t::HARD;
     }
 
+    /* `key_generation` can be omitted even for existing tables, which then keep their
+    old setting. Changing it only affects documents that are inserted afterwards. */
+    if (converter.has("key_generation")) {
+        ql::datum_t key_generation_datum;
+        if (!converter.get("key_generation", &key_generation_datum, error_out)) {
+            return false;
+        }
+        if (!convert_key_generation_from_datum(key_generation_datum,
+                &config_out->basic.key_generation, error_out)) {
+            error_out->msg = "In `key_generation`: " + error_out->msg;
+            return false;
+        }
+    } else if (existed_before) {
+        config_out->basic.key_generation = old_config.config.basic.key_generation;
+    } else {
+        config_out->basic.key_generation = key_generation_t::RANDOM;
+    }
+
+    /* Unlike the other fields, `cache` can be omitted even for existing tables. In
+    that case the table keeps its old cache configuration. */
+    if (converter.has("cache")) {
+        ql::datum_t cache_datum;
+        if (!converter.get("cache", &cache_datum, error_out)) {
+            return false;
+        }
+        if (!convert_table_cache_config_from_datum(cache_datum, &config_out->cache,
+                                                   error_out)) {
+            error_out->msg = "In `cache`: " + error_out->msg;
+            return false;
+        }
+    } else if (existed_before) {
+        config_out->cache = old_config.config.cache;
+    } else {
+        config_out->cache = table_cache_config_t();
+    }
+
     if (converter.has("write_hook")) {
         ql::datum_t write_hook_datum;
         if (!converter.get("write_hook", &write_hook_datum, error_out)) {
@@ -8,16 +8,74 @@
 #include "containers/archive/versioned.hpp"
 #include "rdb_protocol/protocol.hpp"
 
-RDB_IMPL_SERIALIZABLE_3_SINCE_v2_1(table_basic_config_t,
-    name, database, primary_key);
-RDB_IMPL_EQUALITY_COMPARABLE_3(table_basic_config_t,
-    name, database, primary_key);
+template <cluster_version_t W>
+void serialize(write_message_t *wm, const table_basic_config_t &bc) {
+    serialize<W>(wm, bc.name);
+    serialize<W>(wm, bc.database);
+    serialize<W>(wm, bc.primary_key);
+    serialize<W>(wm, bc.key_generation);
+}
+
+INSTANTIATE_SERIALIZE_FOR_CLUSTER_AND_DISK(table_basic_config_t);
+
+/* `key_generation` was added in v2_4; older tables use random keys. */
+template <cluster_version_t W>
+archive_result_t deserialize_table_basic_config_pre_v2_4(
+    read_stream_t *s, table_basic_config_t *bc) {
+    archive_result_t res;
+
+    res = deserialize<W>(s, &bc->name);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &bc->database);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &bc->primary_key);
+    if (bad(res)) { return res; }
+    bc->key_generation = key_generation_t::RANDOM;
+
+    return res;
+}
+
+template <cluster_version_t W>
+archive_result_t deserialize(read_stream_t *s, table_basic_config_t *bc) {
+    archive_result_t res = deserialize_table_basic_config_pre_v2_4<W>(s, bc);
+    if (bad(res)) { return res; }
+    return deserialize<W>(s, &bc->key_generation);
+}
+
+template <>
+archive_result_t deserialize<cluster_version_t::v2_1>(
+    read_stream_t *s, table_basic_config_t *bc) {
+    return deserialize_table_basic_config_pre_v2_4<cluster_version_t::v2_1>(s, bc);
+}
+
+template <>
+archive_result_t deserialize<cluster_version_t::v2_2>(
+    read_stream_t *s, table_basic_config_t *bc) {
+    return deserialize_table_basic_config_pre_v2_4<cluster_version_t::v2_2>(s, bc);
+}
+
+template <>
+archive_result_t deserialize<cluster_version_t::v2_3>(
+    read_stream_t *s, table_basic_config_t *bc) {
+    return deserialize_table_basic_config_pre_v2_4<cluster_version_t::v2_3>(s, bc);
+}
+
+template archive_result_t deserialize<cluster_version_t::v2_4_is_latest>(
+    read_stream_t *, table_basic_config_t *);
+
+RDB_IMPL_EQUALITY_COMPARABLE_4(table_basic_config_t,
+    name, database, primary_key, key_generation);
 
 RDB_IMPL_SERIALIZABLE_3_SINCE_v2_1(table_config_t::shard_t,
     all_replicas, nonvoting_replicas, primary_replica);
 RDB_IMPL_EQUALITY_COMPARABLE_3(table_config_t::shard_t,
     all_replicas, nonvoting_replicas, primary_replica);
 
+RDB_IMPL_SERIALIZABLE_3_SINCE_v2_4(table_cache_config_t,
+    reserved_bytes, limit_bytes, mmap_reads);
+RDB_IMPL_EQUALITY_COMPARABLE_3(table_cache_config_t,
+    reserved_bytes, limit_bytes, mmap_reads);
+
 template <cluster_version_t W>
 void serialize(write_message_t *wm, const table_config_t &tc) {
     table_basic_config_t basic = tc.basic;
@@ -37,6 +95,9 @@ void serialize(write_message_t *wm, const table_config_t &tc) {
 
     write_durability_t durability = tc.durability;
     serialize<W>(wm, durability);
+
+    table_cache_config_t cache = tc.cache;
+    serialize<W>(wm, cache);
 }
 
 INSTANTIATE_SERIALIZE_FOR_CLUSTER_AND_DISK(table_config_t);
@@ -47,7 +108,7 @@ archive_result_t deserialize_table_config_pre_v2_4(
     archive_result_t res;
 
     table_basic_config_t basic;
-    res = deserialize<W>(s, &basic);
+    res = deserialize_table_basic_config_pre_v2_4<W>(s, &basic);
     if (bad(res)) { return res; }
 
     std::vector<table_config_t::shard_t> shards;
@@ -104,12 +165,17 @@ archive_result_t deserialize(
     res = deserialize<W>(s, &durability);
     if (bad(res)) { return res; }
 
+    table_cache_config_t cache;
+    res = deserialize<W>(s, &cache);
+    if (bad(res)) { return res; }
+
     *tc = table_config_t{std::move(basic),
                          std::move(shards),
                          std::move(sindexes),
                          std::move(write_hook),
                          std::move(write_ack_config),
-                         std::move(durability)};
+                         std::move(durability),
+                         std::move(cache)};
 
     return res;
 }
@@ -135,8 +201,8 @@ archive_result_t deserialize<cluster_version_t::v2_3>(
 template archive_result_t deserialize<cluster_version_t::v2_4_is_latest>(
     read_stream_t *, table_config_t *);
 
-RDB_IMPL_EQUALITY_COMPARABLE_6(table_config_t,
-    basic, shards, write_hook, sindexes, write_ack_config, durability);
+RDB_IMPL_EQUALITY_COMPARABLE_7(table_config_t,
+    basic, shards, write_hook, sindexes, write_ack_config, durability, cache);
 
 RDB_IMPL_SERIALIZABLE_1_SINCE_v1_16(table_shard_scheme_t, split_points);
 RDB_IMPL_EQUALITY_COMPARABLE_1(table_shard_scheme_t, split_points);
@@ -28,14 +28,23 @@ parser needs to process queries against the table. A copy of this is stored on e
 thread of every server for every table. */
 class table_basic_config_t {
 public:
+    table_basic_config_t() : key_generation(key_generation_t::RANDOM) { }
+
     name_string_t name;
     database_id_t database;
     std::string primary_key;
+    key_generation_t key_generation;
 };
 
 RDB_DECLARE_SERIALIZABLE(table_basic_config_t);
 RDB_DECLARE_EQUALITY_COMPARABLE(table_basic_config_t);
 
+ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
+    key_generation_t,
+    int8_t,
+    key_generation_t::RANDOM,
+    key_generation_t::TIME_ORDERED);
+
 enum class write_ack_config_t {
     SINGLE,
     MAJORITY
@@ -46,6 +55,29 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
     write_ack_config_t::SINGLE,
     write_ack_config_t::MAJORITY);
 
+/* `table_cache_config_t` bounds how much of each server's cache the cache balancer
+gives to the table. The bounds apply separately on every server that hosts the table,
+and are split evenly between the table's stores on that server. */
+class table_cache_config_t {
+public:
+    table_cache_config_t() : reserved_bytes(0), mmap_reads(false) { }
+
+    /* The balancer doesn't shrink the table's cache below this, unless the
+    reservations of all the tables on the server don't fit into its cache. */
+    uint64_t reserved_bytes;
+    /* The balancer doesn't grow the table's cache beyond this. Must not be smaller
+    than `reserved_bytes`. */
+    optional<uint64_t> limit_bytes;
+    /* For tables that are mostly read, such as archives. Blocks are read through a
+    memory mapping of the table's file, so the OS page cache does most of the
+    caching, and the table only keeps a small cache of its own. The bounds above
+    still apply, but neither can be more than `MMAP_READS_CACHE_SIZE` per store. */
+    bool mmap_reads;
+};
+
+RDB_DECLARE_SERIALIZABLE(table_cache_config_t);
+RDB_DECLARE_EQUALITY_COMPARABLE(table_cache_config_t);
+
 /* `table_config_t` describes the complete contents of the `rethinkdb.table_config`
 artificial table. */
 
@@ -74,6 +106,7 @@ public:
     optional<write_hook_config_t> write_hook;
     write_ack_config_t write_ack_config;
     write_durability_t durability;
+    table_cache_config_t cache;
 };
 
 RDB_DECLARE_EQUALITY_COMPARABLE(table_config_t);
@@ -25,7 +25,21 @@ table_status_artificial_table_backend_t::table_status_artificial_table_backend_t
         _table_meta_client,
         _identifier_format),
       server_config_client(_server_config_client),
-      namespace_repo(_namespace_repo) {
+      namespace_repo(_namespace_repo),
+      cache_generation(0),
+      table_directory_subs(
+        table_meta_client->get_table_manager_directory(),
+        [this](const std::pair<peer_id_t, namespace_id_t> &key,
+                const table_manager_bcard_t *) {
+            invalidate_cache(key.second);
+        },
+        initial_call_t::NO),
+      server_subs(
+        server_config_client->get_server_to_peer_map(),
+        [this](const server_id_t &, const peer_id_t *) {
+            invalidate_cache();
+        },
+        initial_call_t::NO) {
 }
 
 table_status_artificial_table_backend_t::~table_status_artificial_table_backend_t() {
@@ -166,8 +180,20 @@ void table_status_artificial_table_backend_t::format_row(
         THROWS_ONLY(interrupted_exc_t, no_such_table_exc_t, failed_table_op_exc_t) {
     assert_thread();
     table_status_t status;
-    get_table_status(table_id, config, namespace_repo, table_meta_client,
-        server_config_client, interruptor_on_home, &status);
+    auto it = status_cache.find(table_id);
+    if (it != status_cache.end() && it->second.status.config == config &&
+            current_microtime() <
+                it->second.fetch_time + TABLE_STATUS_CACHE_TTL_MS * THOUSAND) {
+        status = it->second.status;
+    } else {
+        microtime_t fetch_time = current_microtime();
+        uint64_t generation = cache_generation;
+        get_table_status(table_id, config, namespace_repo, table_meta_client,
+            server_config_client, interruptor_on_home, &status);
+        if (generation == cache_generation) {
+            status_cache[table_id] = cached_status_t{status, fetch_time};
+        }
+    }
     ql::datum_t status_datum = convert_table_status_to_datum(status, identifier_format);
     ql::datum_object_builder_t builder(status_datum);
     builder.overwrite("id", convert_uuid_to_datum(table_id));
@@ -194,6 +220,35 @@ void table_status_artificial_table_backend_t::format_error_row(
     *row_out = std::move(builder).to_datum();
 }
 
+bool table_status_artificial_table_backend_t::read_row(
+        auth::user_context_t const &user_context,
+        ql::datum_t primary_key,
+        signal_t *interruptor_on_caller,
+        ql::datum_t *row_out,
+        admin_err_t *error_out) {
+    namespace_id_t table_id;
+    admin_err_t dummy_error;
+    if (convert_uuid_from_datum(primary_key, &table_id, &dummy_error)) {
+        on_thread_t thread_switcher(home_thread());
+        invalidate_cache(table_id);
+    }
+    return common_table_artificial_table_backend_t::read_row(
+        user_context, primary_key, interruptor_on_caller, row_out, error_out);
+}
+
+void table_status_artificial_table_backend_t::invalidate_cache(
+        const namespace_id_t &table_id) {
+    assert_thread();
+    status_cache.erase(table_id);
+    ++cache_generation;
+}
+
+void table_status_artificial_table_backend_t::invalidate_cache() {
+    assert_thread();
+    status_cache.clear();
+    ++cache_generation;
+}
+
 bool table_status_artificial_table_backend_t::write_row(
         UNUSED auth::user_context_t const &user_context,
         UNUSED ql::datum_t primary_key,
@@ -2,8 +2,10 @@
 #ifndef CLUSTERING_ADMINISTRATION_TABLES_TABLE_STATUS_HPP_
 #define CLUSTERING_ADMINISTRATION_TABLES_TABLE_STATUS_HPP_
 
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "clustering/administration/tables/calculate_status.hpp"
 #include "clustering/administration/tables/table_common.hpp"
@@ -38,6 +40,15 @@ public:
             signal_t *interruptor_on_caller,
             admin_err_t *error_out);
 
+    /* Reading a single row always fetches the table's status from the servers, rather
+    than using the cache. */
+    bool read_row(
+            auth::user_context_t const &user_context,
+            ql::datum_t primary_key,
+            signal_t *interruptor_on_caller,
+            ql::datum_t *row_out,
+            admin_err_t *error_out);
+
 private:
     void format_row(
             auth::user_context_t const &user_context,
@@ -55,8 +66,29 @@ private:
             const name_string_t &table_name,
             ql::datum_t *row_out);
 
+    void invalidate_cache(const namespace_id_t &table_id);
+    void invalidate_cache();
+
     server_config_client_t *server_config_client;
     namespace_repo_t *namespace_repo;
+
+    /* Fetching a table's status sends a request to every server for the table, which
+    adds up when someone polls the whole `table_status` table. So we keep the last
+    status of each table for up to `TABLE_STATUS_CACHE_TTL_MS`, and drop it early when
+    the table's config changes, when the table's entries in the table directory change,
+    or when a server connects or disconnects. `cache_generation` is incremented on
+    every invalidation, so a status that was being fetched during one isn't cached. */
+    class cached_status_t {
+    public:
+        table_status_t status;
+        microtime_t fetch_time;
+    };
+    std::map<namespace_id_t, cached_status_t> status_cache;
+    uint64_t cache_generation;
+
+    watchable_map_t<std::pair<peer_id_t, namespace_id_t>, table_manager_bcard_t>
+        ::all_subs_t table_directory_subs;
+    watchable_map_t<server_id_t, peer_id_t>::all_subs_t server_subs;
 };
 
 #endif /* CLUSTERING_ADMINISTRATION_TABLES_TABLE_STATUS_HPP_ */
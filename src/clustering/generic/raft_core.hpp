@@ -428,6 +428,17 @@ public:
         raft_term_t log_prev_term,
         raft_log_index_t commit_index) = 0;
 
+    /* `raft_member_t` calls `should_take_snapshot()` after each commit, to decide
+    whether to replace the `num_committed_entries` committed entries in the log with a
+    snapshot. By default it takes a snapshot once there are more than
+    `snapshot_threshold` of them; implementations that know how expensive their
+    snapshots are to write can do better. */
+    virtual bool should_take_snapshot(size_t num_committed_entries) {
+        return num_committed_entries > snapshot_threshold;
+    }
+
+    static const size_t snapshot_threshold = 20;
+
 protected:
     virtual ~raft_storage_interface_t() { }
 };
@@ -747,10 +758,6 @@ private:
     the maximum value set here: */
     const int32_t election_retry_timeout_max_ms = 30000;
 
-    /* When the number of committed entries in the log exceeds this number, we will take
-    a snapshot to compress them. */
-    const size_t snapshot_threshold = 20;
-
     /* Note: Methods prefixed with `follower_`, `candidate_`, or `leader_` are methods
     that are only used when in that state. This convention will hopefully make the code
     slightly clearer. */
@@ -1173,9 +1173,9 @@ void raft_member_t<state_t>::update_commit_index(
     so that the tests will exercise many different code paths. */
     bool should_take_snapshot = (randint(3) == 0);
 #else
-    /* In release mode, snapshot when the log grows beyond a certain margin. */
+    /* In release mode, let the storage decide when the log has grown enough. */
     size_t num_committed_entries = new_commit_index - ps().log.prev_index;
-    bool should_take_snapshot = (num_committed_entries > snapshot_threshold);
+    bool should_take_snapshot = storage->should_take_snapshot(num_committed_entries);
 #endif /* NDEBUG */
     if (should_take_snapshot) {
         /* Take a snapshot as described in Section 7.
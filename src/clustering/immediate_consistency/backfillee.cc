@@ -11,6 +11,12 @@ backfiller. If it's too short, we'll waste resources sending lots of tiny
 acknowledgements; if it's too long, the pipeline might stall. */
 static const int ITEM_ACK_INTERVAL_MS = 100;
 
+/* We also acknowledge items early, without waiting for `ITEM_ACK_INTERVAL_MS`, once we
+have consumed `1 / ITEM_ACK_QUEUE_FRACTION` of the item queue. Otherwise a receiver that
+applies items faster than `item_queue_mem_size` per `ITEM_ACK_INTERVAL_MS` would spend
+most of its time waiting for the backfiller to send more. */
+static const size_t ITEM_ACK_QUEUE_FRACTION = 4;
+
 /* `backfillee_t::session_t` contains all the bits and pieces for managing a single
 backfill session. It's impossible to have multiple sessions running at once, so in
 principle this could have been implemented as some member variables on `backfillee_t`;
@@ -40,7 +46,8 @@ public:
         sent_end_session(false),
         metainfo(region_map_t<version_t>::empty()),
         metainfo_binary(region_map_t<binary_blob_t>::empty()),
-        pulse_when_items_arrive(nullptr)
+        pulse_when_items_arrive(nullptr),
+        pulse_when_ack_needed(nullptr)
     {
         coro_t::spawn_sometime(std::bind(
             &session_t::run, this, drainer.lock()));
@@ -147,6 +154,7 @@ private:
                             *is_item_out = true;
                             *item_out = parent->items.front();
                             parent->items.pop_front();
+                            parent->request_early_ack();
                             return continue_bool_t::CONTINUE;
                         } else if (!parent->items.empty_domain()) {
                             /* There aren't any more items left in the queue, but there's
@@ -202,11 +210,18 @@ private:
                     /* `ack_periodically()` calls `session_t::send_ack_items()` every so
                     often during the backfill, so that the backfiller will keep sending
                     us items as they consume them and so ideally the `items` queue won't
-                    ever bottom out before we're done. */
+                    ever bottom out before we're done. `next_item()` wakes it up early if
+                    we're consuming items quickly. */
                     void ack_periodically(auto_drainer_t::lock_t keepalive2) {
                         try {
                             while (true) {
-                                nap(ITEM_ACK_INTERVAL_MS, keepalive2.get_drain_signal());
+                                cond_t ack_needed;
+                                assignment_sentry_t<cond_t *> sentry(
+                                    &parent->pulse_when_ack_needed, &ack_needed);
+                                signal_timer_t timer(ITEM_ACK_INTERVAL_MS);
+                                wait_any_t waiter(&timer, &ack_needed);
+                                wait_interruptible(
+                                    &waiter, keepalive2.get_drain_signal());
                                 parent->send_ack_items();
                             }
                         } catch (const interrupted_exc_t &) {
@@ -264,6 +279,18 @@ private:
         }
     }
 
+    /* `request_early_ack()` wakes up `ack_periodically()` if we've consumed a large
+    enough part of the item queue since the last acknowledgement. It doesn't block, so
+    it's safe to call while `receive_backfill()` holds B-tree locks. */
+    void request_early_ack() {
+        guarantee(items_mem_size_unacked >= items.get_mem_size());
+        size_t consumed = items_mem_size_unacked - items.get_mem_size();
+        if (pulse_when_ack_needed != nullptr && consumed >=
+                parent->backfill_config.item_queue_mem_size / ITEM_ACK_QUEUE_FRACTION) {
+            pulse_when_ack_needed->pulse_if_not_already_pulsed();
+        }
+    }
+
     void send_end_session_message() {
         guarantee(!sent_end_session);
         sent_end_session = true;
@@ -307,6 +334,10 @@ private:
     `items`. */
     cond_t *pulse_when_items_arrive;
 
+    /* `ack_periodically()` puts a `cond_t` here while it waits to send the next
+    acknowledgement. `request_early_ack()` pulses it. */
+    cond_t *pulse_when_ack_needed;
+
     /* `run()` pulses this when the session is completely over */
     cond_t done_cond;
 
@@ -4,6 +4,7 @@
 #include "clustering/immediate_consistency/backfill_throttler.hpp"
 #include "clustering/immediate_consistency/backfillee.hpp"
 #include "clustering/table_manager/backfill_progress_tracker.hpp"
+#include "concurrency/pmap.hpp"
 #include "stl_utils.hpp"
 #include "store_view.hpp"
 
@@ -168,6 +169,9 @@ remote_replicator_client_t::remote_replicator_client_t(
     write_sync_mailbox_(mailbox_manager,
         std::bind(&remote_replicator_client_t::on_write_sync, this,
             ph::_1, ph::_2, ph::_3, ph::_4, ph::_5, ph::_6)),
+    write_sync_batch_mailbox_(mailbox_manager,
+        std::bind(&remote_replicator_client_t::on_write_sync_batch, this,
+            ph::_1, ph::_2, ph::_3)),
     dummy_write_mailbox_(mailbox_manager,
         std::bind(&remote_replicator_client_t::on_dummy_write, this,
             ph::_1, ph::_2)),
@@ -210,6 +214,7 @@ remote_replicator_client_t::remote_replicator_client_t(
             intro_mailbox.get_address(),
             write_async_mailbox_.get_address(),
             write_sync_mailbox_.get_address(),
+            write_sync_batch_mailbox_.get_address(),
             dummy_write_mailbox_.get_address(),
             read_mailbox_.get_address() };
         registrant_.init(new registrant_t<remote_replicator_client_bcard_t>(
@@ -466,6 +471,32 @@ void remote_replicator_client_t::on_write_sync(
     send(mailbox_manager_, ack_addr, response);
 }
 
+void remote_replicator_client_t::on_write_sync_batch(
+        signal_t *interruptor,
+        const std::vector<remote_replicator_write_t> &writes,
+        const mailbox_t<std::vector<write_response_t> >::address_t &ack_addr)
+        THROWS_ONLY(interrupted_exc_t) {
+    /* The writes in a batch are independent of each other, so we perform them
+    concurrently, as if they had arrived as separate messages. The timestamp enforcer
+    and the `replica_t` take care of ordering them. */
+    std::vector<write_response_t> responses(writes.size());
+    bool interrupted = false;
+    pmap(writes.size(), [&](size_t i) {
+        try {
+            timestamp_enforcer_->complete(writes[i].timestamp);
+            replica_->do_write(
+                writes[i].write, writes[i].timestamp, writes[i].order_token,
+                writes[i].durability, interruptor, &responses[i]);
+        } catch (const interrupted_exc_t &) {
+            interrupted = true;
+        }
+    });
+    if (interrupted) {
+        throw interrupted_exc_t();
+    }
+    send(mailbox_manager_, ack_addr, responses);
+}
+
 void remote_replicator_client_t::on_dummy_write(
         signal_t *interruptor,
         const mailbox_t<write_response_t>::address_t &ack_addr)
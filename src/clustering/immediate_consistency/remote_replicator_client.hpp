@@ -78,9 +78,10 @@ public:
 private:
     class timestamp_range_tracker_t;
 
-    /* `on_write_async()`, `on_write_sync()`, `on_dummy_write()`, and `on_read()`
-    are mailbox callbacks for `write_async_mailbox_`, `write_sync_mailbox_`,
-    `dummy_write_mailbox_` and `read_mailbox_`. */
+    /* `on_write_async()`, `on_write_sync()`, `on_write_sync_batch()`,
+    `on_dummy_write()`, and `on_read()` are mailbox callbacks for `write_async_mailbox_`,
+    `write_sync_mailbox_`, `write_sync_batch_mailbox_`, `dummy_write_mailbox_` and
+    `read_mailbox_`. */
     void on_write_async(
             signal_t *interruptor,
             write_t &&write,
@@ -98,6 +99,12 @@ private:
             const mailbox_t<write_response_t>::address_t &ack_addr)
         THROWS_ONLY(interrupted_exc_t);
 
+    void on_write_sync_batch(
+            signal_t *interruptor,
+            const std::vector<remote_replicator_write_t> &writes,
+            const mailbox_t<std::vector<write_response_t> >::address_t &ack_addr)
+        THROWS_ONLY(interrupted_exc_t);
+
     void on_dummy_write(
             signal_t *interruptor,
             const mailbox_t<write_response_t>::address_t &ack_addr)
@@ -172,6 +179,8 @@ private:
 
     remote_replicator_client_bcard_t::write_async_mailbox_t write_async_mailbox_;
     remote_replicator_client_bcard_t::write_sync_mailbox_t write_sync_mailbox_;
+    remote_replicator_client_bcard_t::write_sync_batch_mailbox_t
+        write_sync_batch_mailbox_;
     remote_replicator_client_bcard_t::dummy_write_mailbox_t dummy_write_mailbox_;
     remote_replicator_client_bcard_t::read_mailbox_t read_mailbox_;
 
@@ -4,10 +4,13 @@
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
     remote_replicator_client_intro_t,
     streaming_begin_timestamp, ready_mailbox);
-RDB_IMPL_SERIALIZABLE_6_FOR_CLUSTER(
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(
+    remote_replicator_write_t,
+    write, timestamp, order_token, durability);
+RDB_IMPL_SERIALIZABLE_7_FOR_CLUSTER(
     remote_replicator_client_bcard_t,
     server_id, intro_mailbox, write_async_mailbox, write_sync_mailbox,
-    dummy_write_mailbox, read_mailbox);
+    write_sync_batch_mailbox, dummy_write_mailbox, read_mailbox);
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
     remote_replicator_server_bcard_t,
     branch, region, registrar);
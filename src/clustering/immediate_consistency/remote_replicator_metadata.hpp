@@ -2,6 +2,8 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_METADATA_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_METADATA_HPP_
 
+#include <vector>
+
 #include "clustering/generic/registration_metadata.hpp"
 #include "clustering/immediate_consistency/history.hpp"
 #include "rdb_protocol/protocol.hpp"
@@ -16,6 +18,17 @@ public:
 
 RDB_DECLARE_SERIALIZABLE(remote_replicator_client_intro_t);
 
+/* A single write in a `write_sync_batch_mailbox_t` message. */
+class remote_replicator_write_t {
+public:
+    write_t write;
+    state_timestamp_t timestamp;
+    order_token_t order_token;
+    write_durability_t durability;
+};
+
+RDB_DECLARE_SERIALIZABLE(remote_replicator_write_t);
+
 class remote_replicator_client_bcard_t {
 public:
     typedef mailbox_t<
@@ -29,6 +42,14 @@ public:
         write_t, state_timestamp_t, order_token_t, write_durability_t,
         mailbox_t<write_response_t>::address_t
         > write_sync_mailbox_t;
+    /* The primary groups sync writes that it sends at about the same time into one
+    message. The client performs them just like separate `write_sync_mailbox_t`
+    messages, but sends back a single message with all of the responses, in the same
+    order. */
+    typedef mailbox_t<
+        std::vector<remote_replicator_write_t>,
+        mailbox_t<std::vector<write_response_t> >::address_t
+        > write_sync_batch_mailbox_t;
     typedef mailbox_t<
         mailbox_t<write_response_t>::address_t
         > dummy_write_mailbox_t;
@@ -41,6 +62,7 @@ public:
     intro_mailbox_t::address_t intro_mailbox;
     write_async_mailbox_t::address_t write_async_mailbox;
     write_sync_mailbox_t::address_t write_sync_mailbox;
+    write_sync_batch_mailbox_t::address_t write_sync_batch_mailbox;
     dummy_write_mailbox_t::address_t dummy_write_mailbox;
     read_mailbox_t::address_t read_mailbox;
 };
@@ -1,6 +1,8 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/remote_replicator_server.hpp"
 
+#include "config/args.hpp"
+
 remote_replicator_server_t::remote_replicator_server_t(
         mailbox_manager_t *_mailbox_manager,
         primary_dispatcher_t *_primary) :
@@ -39,7 +41,8 @@ void remote_replicator_server_t::proxy_replica_t::do_read(
         [&](signal_t *, const read_response_t &response) {
             *response_out = response;
             got_response.pulse();
-        });
+        },
+        mailbox_blocking_t::NEVER_BLOCKS);
     send(parent->mailbox_manager, client_bcard.read_mailbox,
         read, min_timestamp, response_mailbox.get_address());
     wait_interruptible(&got_response, interruptor);
@@ -53,16 +56,45 @@ void remote_replicator_server_t::proxy_replica_t::do_write_sync(
         signal_t *interruptor,
         write_response_t *response_out) {
     guarantee(is_ready);
-    cond_t got_response;
-    mailbox_t<write_response_t> response_mailbox(
-        parent->mailbox_manager,
-        [&](signal_t *, const write_response_t &response) {
-            *response_out = response;
-            got_response.pulse();
-        });
-    send(parent->mailbox_manager, client_bcard.write_sync_mailbox,
-        write, timestamp, order_token, durability, response_mailbox.get_address());
-    wait_interruptible(&got_response, interruptor);
+    if (!pending_batch) {
+        /* Writes that arrive before this coroutine runs will join the batch. */
+        pending_batch = std::make_shared<write_sync_batch_t>(parent->mailbox_manager);
+        coro_t::spawn_sometime(std::bind(
+            &proxy_replica_t::send_pending_batch, this, drainer.lock()));
+    }
+    std::shared_ptr<write_sync_batch_t> batch = pending_batch;
+    size_t index = batch->writes.size();
+    batch->writes.push_back(remote_replicator_write_t {
+        write, timestamp, order_token, durability });
+    if (batch->writes.size() >= REPLICATION_WRITE_BATCH_MAX_WRITES) {
+        send_pending_batch(drainer.lock());
+    }
+    wait_interruptible(&batch->got_responses, interruptor);
+    guarantee(index < batch->responses.size());
+    *response_out = batch->responses[index];
+}
+
+remote_replicator_server_t::proxy_replica_t::write_sync_batch_t::write_sync_batch_t(
+        mailbox_manager_t *mailbox_manager) :
+    response_mailbox(mailbox_manager,
+        [this](signal_t *, const std::vector<write_response_t> &r) {
+            guarantee(r.size() == writes.size());
+            responses = r;
+            got_responses.pulse();
+        })
+    { }
+
+void remote_replicator_server_t::proxy_replica_t::send_pending_batch(
+        UNUSED auto_drainer_t::lock_t keepalive) {
+    if (!pending_batch) {
+        /* The batch filled up and was sent already. */
+        return;
+    }
+    /* Later writes have to go into a new batch, even if `send()` blocks. */
+    std::shared_ptr<write_sync_batch_t> batch = std::move(pending_batch);
+    pending_batch.reset();
+    send(parent->mailbox_manager, client_bcard.write_sync_batch_mailbox,
+        batch->writes, batch->response_mailbox.get_address());
 }
 
 void remote_replicator_server_t::proxy_replica_t::do_dummy_write(
@@ -75,7 +107,8 @@ void remote_replicator_server_t::proxy_replica_t::do_dummy_write(
         [&](signal_t *, const write_response_t &response) {
             *response_out = response;
             got_response.pulse();
-        });
+        },
+        mailbox_blocking_t::NEVER_BLOCKS);
     send(parent->mailbox_manager, client_bcard.dummy_write_mailbox,
         response_mailbox.get_address());
     wait_interruptible(&got_response, interruptor);
@@ -89,7 +122,8 @@ void remote_replicator_server_t::proxy_replica_t::do_write_async(
     cond_t got_ack;
     mailbox_t<> ack_mailbox(
         parent->mailbox_manager,
-        [&](signal_t *) { got_ack.pulse(); });
+        [&](signal_t *) { got_ack.pulse(); },
+        mailbox_blocking_t::NEVER_BLOCKS);
     send(parent->mailbox_manager, client_bcard.write_async_mailbox,
         write, timestamp, order_token, ack_mailbox.get_address());
     wait_interruptible(&got_ack, interruptor);
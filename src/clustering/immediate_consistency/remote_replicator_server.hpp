@@ -2,6 +2,9 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_SERVER_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_SERVER_HPP_
 
+#include <memory>
+#include <vector>
+
 #include "clustering/generic/registrar.hpp"
 #include "clustering/immediate_consistency/primary_dispatcher.hpp"
 #include "clustering/immediate_consistency/remote_replicator_metadata.hpp"
@@ -64,16 +67,38 @@ private:
             write_response_t *response_out);
 
     private:
+        /* `do_write_sync()` doesn't send each write in its own message. It adds the
+        write to `pending_batch`, and `send_pending_batch()` sends all the writes that
+        were added since the last time in one `write_sync_batch_mailbox_t` message.
+        The batch is shared by the `do_write_sync()` calls that wait for its responses,
+        so it survives as long as one of them is still waiting. */
+        class write_sync_batch_t {
+        public:
+            explicit write_sync_batch_t(mailbox_manager_t *mailbox_manager);
+            std::vector<remote_replicator_write_t> writes;
+            std::vector<write_response_t> responses;
+            cond_t got_responses;
+            mailbox_t<std::vector<write_response_t> > response_mailbox;
+        };
+
+        void send_pending_batch(auto_drainer_t::lock_t keepalive);
+
         void on_ready(signal_t *interruptor);
 
         remote_replicator_client_bcard_t client_bcard;
         remote_replicator_server_t *parent;
         bool is_ready;
 
+        std::shared_ptr<write_sync_batch_t> pending_batch;
+
         // The destruction order matters: The `ready_mailbox` callback assumes
         // that `registration` is still valid.
         scoped_ptr_t<primary_dispatcher_t::dispatchee_registration_t> registration;
         remote_replicator_client_intro_t::ready_mailbox_t ready_mailbox;
+
+        /* `drainer` stops the coroutines that `do_write_sync()` spawns to call
+        `send_pending_batch()`. */
+        auto_drainer_t drainer;
     };
 
     mailbox_manager_t *mailbox_manager;
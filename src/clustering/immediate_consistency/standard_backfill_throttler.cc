@@ -1,11 +1,34 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/standard_backfill_throttler.hpp"
 
+#include <algorithm>
+#include <vector>
+
+#include "arch/io/disk.hpp"
+#include "arch/timing.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/wait_any.hpp"
+#include "config/args.hpp"
 
 static const size_t max_active_backfills = 8;
 
+standard_backfill_throttler_t::standard_backfill_throttler_t() :
+    io_backender(nullptr),
+    latency_target_usecs(0),
+    active_limit(max_active_backfills) { }
+
+standard_backfill_throttler_t::standard_backfill_throttler_t(
+        io_backender_t *_io_backender, int64_t latency_target_ms) :
+    io_backender(_io_backender),
+    latency_target_usecs(latency_target_ms * THOUSAND),
+    active_limit(max_active_backfills) {
+    if (io_backender != nullptr && latency_target_usecs > 0) {
+        coro_t::spawn_sometime(std::bind(
+            &standard_backfill_throttler_t::adjust_limit_periodically, this,
+            drainer.lock()));
+    }
+}
+
 standard_backfill_throttler_t::~standard_backfill_throttler_t() {
     guarantee(active.empty());
     guarantee(waiting.empty());
@@ -17,7 +40,7 @@ void standard_backfill_throttler_t::enter(lock_t *lock, signal_t *interruptor_on
     scoped_ptr_t<new_mutex_acq_t> mutex_acq(
         new new_mutex_acq_t(&mutex, &interruptor_on_home));
 
-    if (active.size() < max_active_backfills) {
+    if (has_room_for(lock->priority)) {
         /* There is no contention, so we can start right away */
         active.insert(std::make_pair(lock->priority, lock));
 
@@ -73,10 +96,18 @@ void standard_backfill_throttler_t::exit(lock_t *lock) {
     guarantee(it != active.end());
     active.erase(it);
 
-    /* Find the highest-priority backfill that's waiting to start */
-    auto jt = waiting.end();
-    if (jt != waiting.begin()) {
+    start_waiting_backfills();
+}
+
+void standard_backfill_throttler_t::start_waiting_backfills() {
+    /* Start the highest-priority backfills that are waiting, as long as there's room.
+    There may be room for more than one if `active_limit` has grown. */
+    while (!waiting.empty()) {
+        auto jt = waiting.end();
         --jt;
+        if (!has_room_for(jt->first)) {
+            break;
+        }
 
         /* Pulse the `cond_t` so that `enter()` can return */
         jt->second.second->pulse();
@@ -87,3 +118,57 @@ void standard_backfill_throttler_t::exit(lock_t *lock) {
     }
 }
 
+bool standard_backfill_throttler_t::has_room_for(const priority_t &priority) const {
+    if (priority.critical == priority_t::critical_t::YES) {
+        return active.size() < max_active_backfills;
+    } else {
+        return active.size() < active_limit;
+    }
+}
+
+void standard_backfill_throttler_t::adjust_limit_periodically(
+        auto_drainer_t::lock_t keepalive) {
+    try {
+        while (true) {
+            nap(BACKFILL_THROTTLER_INTERVAL_MS, keepalive.get_drain_signal());
+
+            int64_t latency_usecs, queue_depth;
+            io_backender->sample_load(
+                BACKFILL_THROTTLER_LATENCY_PERCENTILE, &latency_usecs, &queue_depth);
+
+            new_mutex_acq_t mutex_acq(&mutex, keepalive.get_drain_signal());
+            if (latency_usecs > latency_target_usecs) {
+                active_limit = std::max<size_t>(active_limit / 2, 1);
+
+                /* Preempt the lowest-priority non-critical backfills until no more than
+                `active_limit` are left running. Backfills that were already preempted
+                will stop soon anyway, so they don't count. */
+                size_t running = 0;
+                std::vector<lock_t *> candidates;
+                for (auto it = active.rbegin(); it != active.rend(); ++it) {
+                    on_thread_t thread_switcher(it->second->home_thread());
+                    if (!it->second->get_preempt_signal()->is_pulsed()) {
+                        if (it->first.critical == priority_t::critical_t::NO) {
+                            candidates.push_back(it->second);
+                        }
+                        ++running;
+                    }
+                }
+                /* `candidates` are in decreasing order of priority. */
+                while (running > active_limit && !candidates.empty()) {
+                    lock_t *lock = candidates.back();
+                    candidates.pop_back();
+                    on_thread_t thread_switcher(lock->home_thread());
+                    preempt(lock);
+                    --running;
+                }
+            } else if (active_limit < max_active_backfills
+                    && queue_depth <= io_backender->get_max_concurrent_io_requests()) {
+                ++active_limit;
+                start_waiting_backfills();
+            }
+        }
+    } catch (const interrupted_exc_t &) {
+        /* The throttler is being destroyed. */
+    }
+}
@@ -5,26 +5,56 @@
 #include <set>
 
 #include "clustering/immediate_consistency/backfill_throttler.hpp"
+#include "concurrency/auto_drainer.hpp"
 #include "concurrency/new_mutex.hpp"
 
+class io_backender_t;
+
 /* `standard_backfill_throttler_t` is the `backfill_throttler_t` that is used in
 production. It allows a fixed number of backfills total (currently 8); if there are more
 than 8 backfills trying to run, it will always allow the highest-priority backfills to go
-first, preempting the lower-priority backfills if necessary. */
+first, preempting the lower-priority backfills if necessary.
+
+If it's given a latency target, it also watches the disk's read latency and queue depth.
+Whenever the read latency goes over the target, it halves the number of non-critical
+backfills that may run, preempting the lowest-priority ones; while the latency is under
+the target and the disk isn't saturated, it lets one more run at a time. Critical
+backfills are never held back this way, because the table's availability depends on
+them. */
 
 class standard_backfill_throttler_t : public backfill_throttler_t {
 public:
-    standard_backfill_throttler_t() { }
+    standard_backfill_throttler_t();
+    /* A `latency_target_ms` of zero disables the latency-based throttling. */
+    standard_backfill_throttler_t(
+        io_backender_t *io_backender, int64_t latency_target_ms);
     ~standard_backfill_throttler_t();
 
 private:
     void enter(lock_t *lock, signal_t *interruptor);
     void exit(lock_t *lock);
 
+    /* Must be called with `mutex` held. */
+    void start_waiting_backfills();
+
+    /* Returns whether there's room for another backfill with the given priority. */
+    bool has_room_for(const priority_t &priority) const;
+
+    void adjust_limit_periodically(auto_drainer_t::lock_t keepalive);
+
+    io_backender_t *const io_backender;
+    const int64_t latency_target_usecs;
+
     std::multimap<priority_t, std::pair<lock_t *, cond_t *> > waiting;
     std::set<std::pair<priority_t, lock_t *> > active;
 
+    /* The number of backfills that may be active at once, unless they're critical.
+    Only changes if there's a latency target. */
+    size_t active_limit;
+
     new_mutex_t mutex;
+
+    auto_drainer_t drainer;
 };
 
 #endif /* CLUSTERING_IMMEDIATE_CONSISTENCY_STANDARD_BACKFILL_THROTTLER_HPP_ */
@@ -114,7 +114,7 @@ void table_query_client_t::read(
     user_context.require_read_permission(ctx, table_basic_config.database, table_id);
 
     order_token.assert_read_mode();
-    if (r.read_mode == read_mode_t::OUTDATED) {
+    if (r.read_mode == read_mode_t::OUTDATED || r.read_mode == read_mode_t::NEAREST) {
         guarantee(!r.route_to_primary());
         /* This seems kind of silly. We do it this way because
            `dispatch_outdated_read` needs to be able to see `outdated_read_info_t`,
@@ -360,8 +360,9 @@ void table_query_client_t::dispatch_outdated_read(
                 }
             }
             if (!chosen_relationship && !potential_relationships.empty()) {
-                chosen_relationship
-                    = potential_relationships[randint(potential_relationships.size())];
+                chosen_relationship = op.read_mode == read_mode_t::NEAREST
+                    ? choose_nearest_relationship(potential_relationships)
+                    : potential_relationships[randint(potential_relationships.size())];
             }
             if (!chosen_relationship) {
                 /* Don't bother looking for masters; if there are no direct
@@ -370,6 +371,8 @@ void table_query_client_t::dispatch_outdated_read(
                     "no replica is available",
                     query_state_t::FAILED);
             }
+            // The replica doesn't need to know that we picked it by its distance.
+            new_op_info->sharded_op.read_mode = read_mode_t::OUTDATED;
             new_op_info->direct_bcard = chosen_relationship->direct_bcard;
             new_op_info->keepalive = auto_drainer_t::lock_t(
                 &chosen_relationship->drainer);
@@ -396,6 +399,35 @@ void table_query_client_t::dispatch_outdated_read(
     op.unshard(results.data(), results.size(), response, ctx, interruptor);
 }
 
+table_query_client_t::relationship_t *
+table_query_client_t::choose_nearest_relationship(
+        const std::vector<relationship_t *> &potential_relationships) THROWS_NOTHING {
+    rassert(!potential_relationships.empty());
+    connectivity_cluster_t *connectivity_cluster =
+        mailbox_manager->get_connectivity_cluster();
+    relationship_t *nearest = nullptr;
+    int64_t nearest_round_trip_usecs = -1;
+    for (relationship_t *relationship : potential_relationships) {
+        auto_drainer_t::lock_t connection_keepalive;
+        connectivity_cluster_t::connection_t *connection =
+            connectivity_cluster->get_connection(
+                relationship->peer, &connection_keepalive);
+        if (connection == nullptr) {
+            continue;
+        }
+        const int64_t round_trip_usecs = connection->get_round_trip_usecs();
+        if (round_trip_usecs >= 0
+            && (nearest == nullptr || round_trip_usecs < nearest_round_trip_usecs)) {
+            nearest = relationship;
+            nearest_round_trip_usecs = round_trip_usecs;
+        }
+    }
+    if (nearest == nullptr) {
+        nearest = potential_relationships[randint(potential_relationships.size())];
+    }
+    return nearest;
+}
+
 void table_query_client_t::perform_outdated_read(
         std::vector<scoped_ptr_t<outdated_read_info_t> > *replicas_to_contact,
         std::vector<read_response_t> *results,
@@ -410,7 +442,8 @@ void table_query_client_t::perform_outdated_read(
             [&](signal_t *, const read_response_t &res) {
                 results->at(i) = res;
                 done.pulse();
-            });
+            },
+            mailbox_blocking_t::NEVER_BLOCKS);
 
         send(mailbox_manager,
             replica_to_contact->direct_bcard->read_mailbox,
@@ -537,6 +570,7 @@ void table_query_client_t::relationship_coroutine(
         relationship_t relationship_record;
         relationship_record.is_local =
             (key.first == mailbox_manager->get_connectivity_cluster()->get_me());
+        relationship_record.peer = key.first;
         relationship_record.region = bcard.region;
 
         scoped_ptr_t<primary_query_client_t> primary_client;
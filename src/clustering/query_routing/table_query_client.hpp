@@ -71,6 +71,7 @@ private:
     class relationship_t {
     public:
         bool is_local;
+        peer_id_t peer;
         region_t region;
         primary_query_client_t *primary_client;
         const direct_query_bcard_t *direct_bcard;
@@ -129,6 +130,12 @@ private:
             signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t);
 
+    /* Returns the relationship whose server has the lowest round trip time, or a
+    random one if we don't know the round trip time to any of them. */
+    relationship_t *choose_nearest_relationship(
+            const std::vector<relationship_t *> &potential_relationships)
+        THROWS_NOTHING;
+
     void perform_outdated_read(
             std::vector<scoped_ptr_t<outdated_read_info_t> > *direct_readers_to_contact,
             std::vector<read_response_t> *results,
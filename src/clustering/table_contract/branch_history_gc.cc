@@ -70,6 +70,39 @@ void mark_all_ancestors_live(
     }
 }
 
+void mark_ancestors_since_timestamp_live(
+        const branch_id_t &root,
+        const region_t &region,
+        state_timestamp_t since,
+        const branch_history_reader_t *branch_reader,
+        std::set<branch_id_t> *remove_branches_out) {
+    guarantee(!root.is_nil());
+    std::multimap<branch_id_t, region_t> todo;
+    std::set<branch_id_t> done;
+    todo.insert(std::make_pair(root, region));
+    while (!todo.empty()) {
+        std::pair<branch_id_t, region_t> next = *todo.begin();
+        todo.erase(todo.begin());
+        done.insert(next.first);
+        remove_branches_out->erase(next.first);
+        branch_birth_certificate_t bc = branch_reader->get_branch(next.first);
+        if (bc.initial_timestamp < since) {
+            /* Everything since `since` happened on this branch. (If `since` is exactly
+            `initial_timestamp`, the common ancestor might be on the parent, so we keep
+            going in that case.) */
+            continue;
+        }
+        bc.origin.visit(next.second,
+        [&](const region_t &subregion, const version_t &version) {
+            if (version != version_t::zero() &&
+                    branch_reader->is_branch_known(version.branch) &&
+                    done.count(version.branch) == 0) {
+                todo.insert(std::make_pair(version.branch, subregion));
+            }
+        });
+    }
+}
+
 void mark_ancestors_since_base_live(
         const branch_id_t &root,
         const region_t &region,
@@ -41,6 +41,23 @@ void mark_all_ancestors_live(
         const branch_history_reader_t *branch_reader,
         std::set<branch_id_t> *remove_branches_out);
 
+/* `mark_ancestors_since_timestamp_live()` is like `mark_all_ancestors_live()`, except
+that it doesn't trace back past a branch that began before `since`. The coordinator uses
+this when some replicas aren't on `root` yet, but all of them have reported a common
+ancestor with it; the oldest of these common ancestors is `since`. The branches that
+ended before it can't be needed to relate any replica to `root` anymore.
+
+For example, suppose that the branch history looks like this:
+    zero -> A -> B -> C -> root
+If `since` falls within `B`, then `root`, `C`, and `B` would be removed from
+`remove_branches_out`, but `A` wouldn't. */
+void mark_ancestors_since_timestamp_live(
+        const branch_id_t &root,
+        const region_t &region,
+        state_timestamp_t since,
+        const branch_history_reader_t *branch_reader,
+        std::set<branch_id_t> *remove_branches_out);
+
 /* `mark_ancestors_since_base_live()` traces the ancestry of `root` back until it finds a
 branch in `base`, then keeps tracing back until it finds a branch not in `base`. All of
 the branches except the last one will be removed from `remove_branches_out`.
@@ -524,11 +524,30 @@ The output is in the form of a diff instead of a set of new contracts. We need a
 put in the `table_raft_state_t::change_t::new_contracts_t`, and we need to compute the
 diff anyway in order to reuse contract IDs for contracts that haven't changed, so it
 makes sense to combine those two diff processes. */
+void contract_calculation_cache_t::reset_if_changed(
+        raft_log_index_t new_log_index,
+        watchable_map_t<std::pair<server_id_t, server_id_t>, empty_value_t>
+            *connections_map) {
+    std::set<std::pair<server_id_t, server_id_t> > new_connections;
+    connections_map->read_all(
+    [&](const std::pair<server_id_t, server_id_t> &key, const empty_value_t *) {
+        new_connections.insert(key);
+    });
+    if (!log_index.has_value() || *log_index != new_log_index ||
+            new_connections != connections) {
+        entries.clear();
+        log_index = make_optional(new_log_index);
+        connections = std::move(new_connections);
+    }
+    num_hits = num_misses = 0;
+}
+
 void calculate_all_contracts(
         const table_raft_state_t &old_state,
         const std::map<contract_id_t, std::map<server_id_t, contract_ack_t> > &acks,
         watchable_map_t<std::pair<server_id_t, server_id_t>, empty_value_t>
             *connections_map,
+        contract_calculation_cache_t *cache,
         std::set<contract_id_t> *remove_contracts_out,
         std::map<contract_id_t, std::pair<region_t, contract_t> > *add_contracts_out,
         std::map<region_t, branch_id_t> *register_current_branches_out,
@@ -543,6 +562,28 @@ void calculate_all_contracts(
         remove_branches_out->insert(pair.first);
     }
 
+    /* Branch history GC. The key decision is whether we should only keep
+    `current_branch`, or whether we need to keep some or all of its ancestors too. If
+    `history_since` is set, the replicas all have a common ancestor with
+    `current_branch` that's no older than it, so the older ancestors can go. */
+    auto mark_branches_live = [&](const region_t &reg, bool can_gc_branch_history,
+            const optional<state_timestamp_t> &history_since) {
+        old_state.current_branches.visit(reg,
+        [&](const region_t &subregion, const branch_id_t &current_branch) {
+            if (!current_branch.is_nil()) {
+                if (can_gc_branch_history) {
+                    remove_branches_out->erase(current_branch);
+                } else if (static_cast<bool>(history_since)) {
+                    mark_ancestors_since_timestamp_live(current_branch, subregion,
+                        *history_since, &old_state.branch_history, remove_branches_out);
+                } else {
+                    mark_all_ancestors_live(current_branch, subregion,
+                        &old_state.branch_history, remove_branches_out);
+                }
+            }
+        });
+    };
+
     std::vector<region_t> new_contract_region_vector;
     std::vector<contract_t> new_contract_vector;
 
@@ -551,6 +592,37 @@ void calculate_all_contracts(
     iterate over all contracts: */
     for (const std::pair<contract_id_t, std::pair<region_t, contract_t> > &cpair :
             old_state.contracts) {
+        /* Find acks for this contract. If there aren't any acks for this contract,
+        then `acks` might not even have an empty map, so we need to construct an
+        empty map in that case. */
+        const std::map<server_id_t, contract_ack_t> *this_contract_acks;
+        {
+            static const std::map<server_id_t, contract_ack_t> empty_ack_map;
+            auto it = acks.find(cpair.first);
+            this_contract_acks = (it == acks.end()) ? &empty_ack_map : &it->second;
+        }
+
+        /* If the acks are the same as the last time that we calculated this contract
+        against the same Raft state, the results would be the same too. In a large
+        cluster most contracts are in this situation, and this saves us from
+        fragmenting their acks and calling `calculate_contract()` again. */
+        if (cache != nullptr) {
+            auto it = cache->entries.find(cpair.first);
+            if (it != cache->entries.end() && it->second.acks == *this_contract_acks) {
+                for (const auto &frag : it->second.fragments) {
+                    mark_branches_live(
+                        frag.region, frag.can_gc_branch_history, frag.history_since);
+                    new_contract_region_vector.push_back(frag.region);
+                    new_contract_vector.push_back(frag.contract);
+                }
+                ++cache->num_hits;
+                continue;
+            }
+            ++cache->num_misses;
+        }
+        contract_calculation_cache_t::entry_t cache_entry;
+        bool cacheable = true;
+
         /* Next iterate over all shards of the table config and find the ones that
         overlap the contract in question: */
         for (size_t shard_index = 0; shard_index < old_state.config.config.shards.size();
@@ -562,16 +634,6 @@ void calculate_all_contracts(
                 continue;
             }
 
-            /* Find acks for this contract. If there aren't any acks for this contract,
-            then `acks` might not even have an empty map, so we need to construct an
-            empty map in that case. */
-            const std::map<server_id_t, contract_ack_t> *this_contract_acks;
-            {
-                static const std::map<server_id_t, contract_ack_t> empty_ack_map;
-                auto it = acks.find(cpair.first);
-                this_contract_acks = (it == acks.end()) ? &empty_ack_map : &it->second;
-            }
-
             /* Now collect the acks for this contract into `ack_frags`. `ack_frags` is
             homogeneous at first and then it gets fragmented as we iterate over `acks`.
             */
@@ -664,6 +726,9 @@ void calculate_all_contracts(
                             ignore_missing_branches,
                             add_branches_out);
                         registered_new_branch = make_optional(to_register);
+                        /* The branch will be in the Raft state next time, so the
+                        result only holds for this round. */
+                        cacheable = false;
                     }
                 }
 
@@ -695,28 +760,50 @@ void calculate_all_contracts(
                     }
                 }
 
-                /* Branch history GC. The key decision is whether we should only keep
-                `current_branch`, or whether we need to keep all of its ancestors too. */
-                old_state.current_branches.visit(reg,
-                [&](const region_t &subregion, const branch_id_t &current_branch) {
-                    if (!current_branch.is_nil()) {
-                        if (can_gc_branch_history) {
-                            remove_branches_out->erase(current_branch);
-                        } else {
-                            mark_all_ancestors_live(current_branch, subregion,
-                                &old_state.branch_history, remove_branches_out);
+                /* Even if we can't GC all of the branch history, the replicas that
+                aren't on `current_branch` might all have told us where they diverged
+                from it. Then we only need to keep the history back to the oldest of
+                these common ancestors. */
+                optional<state_timestamp_t> history_since;
+                if (!can_gc_branch_history) {
+                    for (const server_id_t &server : new_contract.replicas) {
+                        auto it = acks_map.find(server);
+                        if (it == acks_map.end() ||
+                                !static_cast<bool>(it->second.common_ancestor)) {
+                            history_since.reset();
+                            break;
+                        }
+                        if (!static_cast<bool>(history_since) ||
+                                *it->second.common_ancestor < *history_since) {
+                            history_since = it->second.common_ancestor;
                         }
                     }
-                });
+                }
+
+                mark_branches_live(reg, can_gc_branch_history, history_since);
 
                 if (can_end_after_emergency_repair) {
                     new_contract.after_emergency_repair = false;
                 }
 
+                if (cache != nullptr) {
+                    contract_calculation_cache_t::fragment_t frag;
+                    frag.region = reg;
+                    frag.contract = new_contract;
+                    frag.can_gc_branch_history = can_gc_branch_history;
+                    frag.history_since = history_since;
+                    cache_entry.fragments.push_back(std::move(frag));
+                }
+
                 new_contract_region_vector.push_back(reg);
                 new_contract_vector.push_back(new_contract);
             });
         }
+
+        if (cache != nullptr && cacheable) {
+            cache_entry.acks = *this_contract_acks;
+            cache->entries[cpair.first] = std::move(cache_entry);
+        }
     }
 
     /* Put the new contracts into a `region_map_t` to coalesce adjacent regions that have
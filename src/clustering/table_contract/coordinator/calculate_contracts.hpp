@@ -2,14 +2,64 @@
 #ifndef CLUSTERING_TABLE_CONTRACT_COORDINATOR_CALCULATE_CONTRACTS_HPP_
 #define CLUSTERING_TABLE_CONTRACT_COORDINATOR_CALCULATE_CONTRACTS_HPP_
 
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "clustering/generic/raft_core.hpp"
 #include "clustering/table_contract/contract_metadata.hpp"
 #include "concurrency/watchable_map.hpp"
 
+/* `contract_calculation_cache_t` remembers what `calculate_all_contracts()` computed for
+each contract, and the acks that it computed it from. The results only depend on the
+acks, the Raft state, and which servers are connected to which; so as long as the latter
+two don't change, the next call can reuse the results for every contract whose acks
+didn't change either. Call `reset_if_changed()` before each calculation. */
+class contract_calculation_cache_t {
+public:
+    class fragment_t {
+    public:
+        region_t region;
+        contract_t contract;
+        bool can_gc_branch_history;
+        optional<state_timestamp_t> history_since;
+    };
+    class entry_t {
+    public:
+        std::map<server_id_t, contract_ack_t> acks;
+        std::vector<fragment_t> fragments;
+    };
+
+    contract_calculation_cache_t() : num_hits(0), num_misses(0) { }
+
+    /* Drops all the entries if the Raft state or the connections changed since the
+    last call. Also resets `num_hits` and `num_misses`. */
+    void reset_if_changed(
+        raft_log_index_t log_index,
+        watchable_map_t<std::pair<server_id_t, server_id_t>, empty_value_t>
+            *connections_map);
+
+    std::map<contract_id_t, entry_t> entries;
+
+    /* How many contracts the last calculation took from the cache, and how many it had
+    to calculate */
+    size_t num_hits, num_misses;
+
+private:
+    optional<raft_log_index_t> log_index;
+    std::set<std::pair<server_id_t, server_id_t> > connections;
+
+    DISABLE_COPYING(contract_calculation_cache_t);
+};
+
+/* `cache` may be `nullptr`. */
 void calculate_all_contracts(
         const table_raft_state_t &old_state,
         const std::map<contract_id_t, std::map<server_id_t, contract_ack_t> > &acks,
         watchable_map_t<std::pair<server_id_t, server_id_t>, empty_value_t>
             *connections_map,
+        contract_calculation_cache_t *cache,
         std::set<contract_id_t> *remove_contracts_out,
         std::map<contract_id_t, std::pair<region_t, contract_t> > *add_contracts_out,
         std::map<region_t, branch_id_t> *register_current_branches_out,
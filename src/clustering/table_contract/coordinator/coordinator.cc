@@ -7,6 +7,31 @@
 #include "clustering/table_contract/coordinator/calculate_misc.hpp"
 #include "clustering/table_contract/coordinator/check_ready.hpp"
 #include "logger.hpp"
+#include "perfmon/perfmon.hpp"
+
+/* Global stats for how long `pump_contracts()` spends calculating contracts, and how
+many contracts that calculation could take from `contract_cache`. */
+static perfmon_duration_sampler_t *get_contract_calculation_perfmon() {
+    static perfmon_duration_sampler_t pm_calculation(secs_to_ticks(1));
+    static perfmon_membership_t pm_calculation_membership(
+        &get_global_perfmon_collection(), &pm_calculation, "contract_calculation");
+    return &pm_calculation;
+}
+
+static perfmon_counter_t *get_contract_calculation_cache_hits_perfmon() {
+    static perfmon_counter_t pm_hits;
+    static perfmon_membership_t pm_hits_membership(
+        &get_global_perfmon_collection(), &pm_hits, "contract_calculation_cache_hits");
+    return &pm_hits;
+}
+
+static perfmon_counter_t *get_contract_calculation_cache_misses_perfmon() {
+    static perfmon_counter_t pm_misses;
+    static perfmon_membership_t pm_misses_membership(
+        &get_global_perfmon_collection(), &pm_misses,
+        "contract_calculation_cache_misses");
+    return &pm_misses;
+}
 
 contract_coordinator_t::contract_coordinator_t(
         raft_member_t<table_raft_state_t> *_raft,
@@ -131,8 +156,10 @@ void contract_coordinator_t::pump_contracts(signal_t *interruptor) {
     assert_thread();
 
     /* Wait a little while to give changes time to accumulate, because
-    `calculate_all_contracts()` needs to examine every shard of the table even if
-    nothing about them has changed, and that might be expensive. */
+    `calculate_all_contracts()` still needs to visit every contract of the table even
+    if nothing about them has changed. (`contract_cache` makes this cheap for the
+    contracts whose acks didn't change, but only as long as the Raft state doesn't
+    change either.) */
     nap(200, interruptor);
 
     /* Now we'll apply changes to Raft. We keep trying in a loop in case it
@@ -154,14 +181,19 @@ void contract_coordinator_t::pump_contracts(signal_t *interruptor) {
         table_raft_state_t::change_t::new_contracts_t change;
         raft->get_latest_state()->apply_read(
         [&](const raft_member_t<table_raft_state_t>::state_and_config_t *state) {
+            block_pm_duration timer(get_contract_calculation_perfmon());
+            contract_cache.reset_if_changed(state->log_index, connections_map);
             calculate_all_contracts(
-                state->state, acks_by_contract, connections_map,
+                state->state, acks_by_contract, connections_map, &contract_cache,
                 &change.remove_contracts, &change.add_contracts,
                 &change.register_current_branches,
                 &change.remove_branches, &change.add_branches);
             calculate_server_names(
                 state->state, change.remove_contracts, change.add_contracts,
                 &change.remove_server_names, &change.add_server_names);
+            *get_contract_calculation_cache_hits_perfmon() += contract_cache.num_hits;
+            *get_contract_calculation_cache_misses_perfmon() +=
+                contract_cache.num_misses;
         });
 
         /* Apply the change, unless it's a no-op */
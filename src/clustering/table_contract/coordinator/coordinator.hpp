@@ -4,6 +4,7 @@
 
 #include "clustering/generic/raft_core.hpp"
 #include "clustering/table_contract/contract_metadata.hpp"
+#include "clustering/table_contract/coordinator/calculate_contracts.hpp"
 #include "concurrency/pump_coro.hpp"
 
 /* There is one `contract_coordinator_t` per table, located on whichever server is
@@ -71,6 +72,9 @@ private:
     /* This is the same as `acks` but indexed by contract. */
     std::map<contract_id_t, std::map<server_id_t, contract_ack_t> > acks_by_contract;
 
+    /* The contracts that `pump_contracts()` calculated last time. */
+    contract_calculation_cache_t contract_cache;
+
     /* These `pump_coro_t`s are responsible for calling `pump_contracts()` and
     `pump_configs()`. Destructor order matters here. We have to destroy `ack_subs` first,
     because it notifies `contract_pumper`. Then we have to destroy `contract_pumper`,
@@ -41,6 +41,10 @@ public:
     it can create and destroy sindexes on them. The `table_contract` code should never
     use it, and some unit tests will return `nullptr` from here. */
     virtual store_t *get_underlying_store(size_t i) = 0;
+
+    /* Turns the serializer's mapped reads on or off, see
+    `data_block_manager_t::set_mmap_reads()`. */
+    virtual void set_mmap_reads(bool enabled) = 0;
 };
 
 #endif /* CLUSTERING_TABLE_CONTRACT_CPU_SHARDING_HPP_ */
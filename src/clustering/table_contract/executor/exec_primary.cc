@@ -437,6 +437,7 @@ bool primary_execution_t::on_read(
         }
         break;
     case read_mode_t::OUTDATED: // Fallthrough intentional
+    case read_mode_t::NEAREST: // Fallthrough intentional
     case read_mode_t::DEBUG_DIRECT:
     default:
         // These read modes should not come through the `primary_exection_t`.
@@ -0,0 +1,47 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/table_manager/cache_config_manager.hpp"
+
+#include <algorithm>
+
+#include "config/args.hpp"
+#include "rdb_protocol/store.hpp"
+
+cache_config_manager_t::cache_config_manager_t(
+        multistore_ptr_t *multistore_,
+        const clone_ptr_t<watchable_t<table_config_t> > &table_config_) :
+    multistore(multistore_), table_config(table_config_),
+    update_pumper([this](signal_t *interruptor) { update_blocking(interruptor); }),
+    table_config_subs([this]() { update_pumper.notify(); })
+{
+    watchable_t<table_config_t>::freeze_t freeze(table_config);
+    table_config_subs.reset(table_config, &freeze);
+    update_pumper.notify();
+}
+
+void cache_config_manager_t::update_blocking(UNUSED signal_t *interruptor) {
+    table_cache_config_t config;
+    table_config->apply_read([&](const table_config_t *c) {
+        config = c->cache;
+    });
+
+    /* The bounds are for the whole table on this server, so every store gets an
+    equal share of them. */
+    uint64_t reservation = config.reserved_bytes / CPU_SHARDING_FACTOR;
+    uint64_t limit = config.limit_bytes.has_value()
+        ? std::max(*config.limit_bytes / CPU_SHARDING_FACTOR, reservation)
+        : UINT64_MAX;
+    if (config.mmap_reads) {
+        /* Most of the table's blocks are cached by the OS, so it doesn't need more
+        than a little of our cache. */
+        reservation = std::min<uint64_t>(reservation, MMAP_READS_CACHE_SIZE);
+        limit = std::min<uint64_t>(limit, MMAP_READS_CACHE_SIZE);
+    }
+
+    multistore->set_mmap_reads(config.mmap_reads);
+
+    for (size_t i = 0; i < CPU_SHARDING_FACTOR; ++i) {
+        store_t *store = multistore->get_underlying_store(i);
+        on_thread_t thread_switcher(store->home_thread());
+        store->set_cache_memory_bounds(reservation, limit);
+    }
+}
@@ -80,7 +80,8 @@ public:
         table_persistence_interface_t *_persistence_interface,
         const base_path_t &_base_path,
         io_backender_t *_io_backender,
-        perfmon_collection_repo_t *_perfmon_collection_repo);
+        perfmon_collection_repo_t *_perfmon_collection_repo,
+        int64_t backfill_latency_target_ms);
 
     /* This constructor is used on proxy servers. */
     multi_table_manager_t(
@@ -5,6 +5,7 @@
 #include "clustering/table_contract/coordinator/coordinator.hpp"
 #include "clustering/table_contract/executor/executor.hpp"
 #include "clustering/table_manager/backfill_progress_tracker.hpp"
+#include "clustering/table_manager/cache_config_manager.hpp"
 #include "clustering/table_manager/server_name_cache_updater.hpp"
 #include "clustering/table_manager/sindex_manager.hpp"
 #include "clustering/table_manager/table_metadata.hpp"
@@ -180,6 +181,10 @@ private:
     `multistore_ptr` according to what it sees. */
     sindex_manager_t sindex_manager;
 
+    /* The `cache_config_manager` watches the `table_config_t` and sets the cache
+    memory bounds of the stores in `multistore_ptr` accordingly. */
+    cache_config_manager_t cache_config_manager;
+
     auto_drainer_t drainer;
 
     watchable_map_t<std::pair<peer_id_t, namespace_id_t>, table_manager_bcard_t>
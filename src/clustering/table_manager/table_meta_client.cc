@@ -7,6 +7,38 @@
 #include "clustering/table_contract/emergency_repair.hpp"
 #include "clustering/table_manager/multi_table_manager.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "perfmon/perfmon.hpp"
+
+/* Global stats for how long table creations and drops spend waiting for the servers to
+set up or delete the tables, and then for the change to become visible here. A
+`create_multi()` or `drop_multi()` counts once for all of its tables. */
+static perfmon_duration_sampler_t *get_table_create_setup_perfmon() {
+    static perfmon_duration_sampler_t pm_setup(secs_to_ticks(1));
+    static perfmon_membership_t pm_setup_membership(
+        &get_global_perfmon_collection(), &pm_setup, "table_create_setup");
+    return &pm_setup;
+}
+
+static perfmon_duration_sampler_t *get_table_create_propagation_perfmon() {
+    static perfmon_duration_sampler_t pm_propagation(secs_to_ticks(1));
+    static perfmon_membership_t pm_propagation_membership(
+        &get_global_perfmon_collection(), &pm_propagation, "table_create_propagation");
+    return &pm_propagation;
+}
+
+static perfmon_duration_sampler_t *get_table_drop_setup_perfmon() {
+    static perfmon_duration_sampler_t pm_setup(secs_to_ticks(1));
+    static perfmon_membership_t pm_setup_membership(
+        &get_global_perfmon_collection(), &pm_setup, "table_drop_setup");
+    return &pm_setup;
+}
+
+static perfmon_duration_sampler_t *get_table_drop_propagation_perfmon() {
+    static perfmon_duration_sampler_t pm_propagation(secs_to_ticks(1));
+    static perfmon_membership_t pm_propagation_membership(
+        &get_global_perfmon_collection(), &pm_propagation, "table_drop_propagation");
+    return &pm_propagation;
+}
 
 table_meta_client_t::table_meta_client_t(
         mailbox_manager_t *_mailbox_manager,
@@ -28,7 +60,8 @@ void table_meta_client_t::find(
         const database_id_t &database,
         const name_string_t &name,
         namespace_id_t *table_id_out,
-        std::string *primary_key_out)
+        std::string *primary_key_out,
+        key_generation_t *key_generation_out)
         THROWS_ONLY(no_such_table_exc_t, ambiguous_table_exc_t) {
     size_t count = 0;
     table_basic_configs.get_watchable()->read_all(
@@ -39,6 +72,9 @@ void table_meta_client_t::find(
                 if (primary_key_out != nullptr) {
                     *primary_key_out = value->first.primary_key;
                 }
+                if (key_generation_out != nullptr) {
+                    *key_generation_out = value->first.key_generation;
+                }
             }
         });
     if (count == 0) {
@@ -284,21 +320,35 @@ void table_meta_client_t::get_debug_status(
 void table_meta_client_t::create(
         namespace_id_t table_id,
         const table_config_and_shards_t &initial_config,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t,
+            maybe_failed_table_op_exc_t) {
+    std::map<namespace_id_t, table_config_and_shards_t> new_configs;
+    new_configs.insert(std::make_pair(table_id, initial_config));
+    create_multi(new_configs, interruptor);
+}
+
+void table_meta_client_t::create_multi(
+        const std::map<namespace_id_t, table_config_and_shards_t> &new_configs,
         signal_t *interruptor_on_caller)
         THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t,
             maybe_failed_table_op_exc_t) {
     cross_thread_signal_t interruptor(interruptor_on_caller, home_thread());
     on_thread_t thread_switcher(home_thread());
 
-    /* Sanity-check that `table_id` is unique */
-    multi_table_manager->get_table_basic_configs()->read_key(table_id,
-        [&](const timestamped_basic_config_t *value) {
-            guarantee(value == nullptr);
-        });
+    std::map<namespace_id_t, table_raft_state_t> raft_states;
+    for (const auto &pair : new_configs) {
+        /* Sanity-check that the table ID is unique */
+        multi_table_manager->get_table_basic_configs()->read_key(pair.first,
+            [&](const timestamped_basic_config_t *value) {
+                guarantee(value == nullptr);
+            });
+        raft_states.insert(
+            std::make_pair(pair.first, make_new_table_raft_state(pair.second)));
+    }
 
     create_or_emergency_repair(
-        table_id,
-        make_new_table_raft_state(initial_config),
+        raft_states,
         multi_table_manager_timestamp_t::epoch_t::make(
             multi_table_manager_timestamp_t::epoch_t::min()),
         &interruptor);
@@ -306,56 +356,85 @@ void table_meta_client_t::create(
 
 void table_meta_client_t::drop(
         const namespace_id_t &table_id,
-        signal_t *interruptor_on_caller)
+        signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t, no_such_table_exc_t) {
+    std::set<namespace_id_t> dropped;
+    drop_multi(std::set<namespace_id_t>{table_id}, interruptor, &dropped);
+    if (dropped.empty()) {
+        throw no_such_table_exc_t();
+    }
+}
+
+void table_meta_client_t::drop_multi(
+        const std::set<namespace_id_t> &table_ids,
+        signal_t *interruptor_on_caller,
+        std::set<namespace_id_t> *dropped_out)
+        THROWS_ONLY(interrupted_exc_t, maybe_failed_table_op_exc_t) {
     cross_thread_signal_t interruptor(interruptor_on_caller, home_thread());
     on_thread_t thread_switcher(home_thread());
 
-    if (!exists(table_id)) {
-        throw no_such_table_exc_t();
+    dropped_out->clear();
+    for (const namespace_id_t &table_id : table_ids) {
+        if (exists(table_id)) {
+            dropped_out->insert(table_id);
+        }
+    }
+    if (dropped_out->empty()) {
+        return;
     }
+    std::vector<namespace_id_t> to_drop(dropped_out->begin(), dropped_out->end());
 
-    /* Find business cards for all servers, not just the ones that are hosting the table.
-    This is because sometimes it makes sense to drop a table even if the table is
-    completely unreachable. */
+    /* Find business cards for all servers, not just the ones that are hosting the
+    tables. This is because sometimes it makes sense to drop a table even if the table
+    is completely unreachable. */
     std::map<peer_id_t, multi_table_manager_bcard_t> bcards =
         multi_table_manager_directory->get_all();
     guarantee(!bcards.empty(), "We should be connected to ourself");
 
-    /* Send a message to each server. */
-    size_t num_acked = 0;
-    pmap(bcards.begin(), bcards.end(),
-    [&](const std::pair<peer_id_t, multi_table_manager_bcard_t> &pair) {
-        try {
-            disconnect_watcher_t dw(mailbox_manager, pair.first);
-            cond_t got_ack;
-            mailbox_t<> ack_mailbox(mailbox_manager,
-                [&](signal_t *) { got_ack.pulse(); });
-            send(mailbox_manager, pair.second.action_mailbox,
-                 {table_id,
-                  multi_table_manager_timestamp_t::deletion(),
-                  multi_table_manager_bcard_t::status_t::DELETED,
-                  optional<table_basic_config_t>(),
-                  optional<raft_member_id_t>(),
-                  optional<raft_persistent_state_t<table_raft_state_t> >(),
-                  optional<raft_start_election_immediately_t>(),
-                  ack_mailbox.get_address()});
-            wait_any_t interruptor_combined(&dw, &interruptor);
-            wait_interruptible(&got_ack, &interruptor_combined);
-            ++num_acked;
-        } catch (const interrupted_exc_t &) {
-            /* do nothing */
-        }
-    });
+    /* Send a message for each table to each server. */
+    std::vector<size_t> num_acked(to_drop.size(), 0);
+    {
+        block_pm_duration timer(get_table_drop_setup_perfmon());
+        throttled_pmap(to_drop.size(), [&](int64_t i) {
+            pmap(bcards.begin(), bcards.end(),
+            [&](const std::pair<peer_id_t, multi_table_manager_bcard_t> &pair) {
+                try {
+                    disconnect_watcher_t dw(mailbox_manager, pair.first);
+                    cond_t got_ack;
+                    mailbox_t<> ack_mailbox(mailbox_manager,
+                        [&](signal_t *) { got_ack.pulse(); });
+                    send(mailbox_manager, pair.second.action_mailbox,
+                         {to_drop[i],
+                          multi_table_manager_timestamp_t::deletion(),
+                          multi_table_manager_bcard_t::status_t::DELETED,
+                          optional<table_basic_config_t>(),
+                          optional<raft_member_id_t>(),
+                          optional<raft_persistent_state_t<table_raft_state_t> >(),
+                          optional<raft_start_election_immediately_t>(),
+                          ack_mailbox.get_address()});
+                    wait_any_t interruptor_combined(&dw, &interruptor);
+                    wait_interruptible(&got_ack, &interruptor_combined);
+                    ++num_acked[i];
+                } catch (const interrupted_exc_t &) {
+                    /* do nothing */
+                }
+            });
+        }, TABLE_META_BATCH_CONCURRENCY);
+    }
     if (interruptor.is_pulsed()) {
         throw interrupted_exc_t();
     }
-    guarantee(num_acked != 0, "We should at least have an ack from ourself");
+    for (size_t n : num_acked) {
+        guarantee(n != 0, "We should at least have an ack from ourself");
+    }
 
-    /* Wait until the table disappears from the directory. */
-    wait_until_change_visible(
-        table_id,
-        [](const timestamped_basic_config_t *value) { return value == nullptr; },
+    /* Wait until the tables disappear from the directory. */
+    block_pm_duration timer(get_table_drop_propagation_perfmon());
+    wait_until_changes_visible(
+        *dropped_out,
+        [](const namespace_id_t &, const timestamped_basic_config_t *value) {
+            return value == nullptr;
+        },
         &interruptor);
 }
 
@@ -527,17 +606,17 @@ void table_meta_client_t::emergency_repair(
                 old_epoch = pair->second.epoch;
             });
 
+        std::map<namespace_id_t, table_raft_state_t> raft_states;
+        raft_states.insert(std::make_pair(table_id, new_state));
         create_or_emergency_repair(
-            table_id,
-            new_state,
+            raft_states,
             multi_table_manager_timestamp_t::epoch_t::make(old_epoch),
             &interruptor);
     }
 }
 
 void table_meta_client_t::create_or_emergency_repair(
-        const namespace_id_t &table_id,
-        const table_raft_state_t &raft_state,
+        const std::map<namespace_id_t, table_raft_state_t> &raft_states,
         const multi_table_manager_timestamp_t::epoch_t &epoch,
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t,
@@ -549,88 +628,123 @@ void table_meta_client_t::create_or_emergency_repair(
     timestamp.epoch = epoch;
     timestamp.log_index = 0;
 
-    std::set<server_id_t> all_servers, voting_servers;
-    for (const table_config_t::shard_t &shard : raft_state.config.config.shards) {
-        all_servers.insert(shard.all_replicas.begin(), shard.all_replicas.end());
-        std::set<server_id_t> voters = shard.voting_replicas();
-        voting_servers.insert(voters.begin(), voters.end());
-    }
+    struct table_action_t {
+        namespace_id_t table_id;
+        const table_raft_state_t *raft_state;
+        server_id_t initial_leader;
+        raft_persistent_state_t<table_raft_state_t> raft_ps;
+        std::map<server_id_t, multi_table_manager_bcard_t> bcards;
+        size_t num_acked;
+    };
+    std::vector<table_action_t> actions;
+    actions.reserve(raft_states.size());
+
+    for (const auto &state_pair : raft_states) {
+        const table_raft_state_t &raft_state = state_pair.second;
+        std::set<server_id_t> all_servers, voting_servers;
+        for (const table_config_t::shard_t &shard : raft_state.config.config.shards) {
+            all_servers.insert(shard.all_replicas.begin(), shard.all_replicas.end());
+            std::set<server_id_t> voters = shard.voting_replicas();
+            voting_servers.insert(voters.begin(), voters.end());
+        }
 
-    raft_config_t raft_config;
-    server_id_t initial_leader;
-    for (const server_id_t &server_id : all_servers) {
-        if (voting_servers.count(server_id) == 1) {
-            if (raft_config.voting_members.empty()) {
-                // This is the first voting member we've seen; arbitrarily
-                // choose it as the initial leader
-                initial_leader = server_id;
+        table_action_t action;
+        action.table_id = state_pair.first;
+        action.raft_state = &raft_state;
+        action.num_acked = 0;
+
+        raft_config_t raft_config;
+        for (const server_id_t &server_id : all_servers) {
+            if (voting_servers.count(server_id) == 1) {
+                if (raft_config.voting_members.empty()) {
+                    // This is the first voting member we've seen; arbitrarily
+                    // choose it as the initial leader
+                    action.initial_leader = server_id;
+                }
+                raft_config.voting_members.insert(raft_state.member_ids.at(server_id));
+            } else {
+                raft_config.non_voting_members.insert(
+                    raft_state.member_ids.at(server_id));
             }
-            raft_config.voting_members.insert(raft_state.member_ids.at(server_id));
-        } else {
-            raft_config.non_voting_members.insert(raft_state.member_ids.at(server_id));
         }
-    }
 
-    raft_persistent_state_t<table_raft_state_t> raft_ps =
-        raft_persistent_state_t<table_raft_state_t>::make_initial(
+        action.raft_ps = raft_persistent_state_t<table_raft_state_t>::make_initial(
             raft_state, raft_config);
 
-    /* Find the business cards of the servers we'll be sending to */
-    std::map<server_id_t, multi_table_manager_bcard_t> bcards;
-    multi_table_manager_directory->read_all(
-        [&](const peer_id_t &, const multi_table_manager_bcard_t *bc) {
-            if (all_servers.count(bc->server_id) == 1) {
-                bcards[bc->server_id] = *bc;
-            }
-        });
+        /* Find the business cards of the servers we'll be sending to */
+        multi_table_manager_directory->read_all(
+            [&](const peer_id_t &, const multi_table_manager_bcard_t *bc) {
+                if (all_servers.count(bc->server_id) == 1) {
+                    action.bcards[bc->server_id] = *bc;
+                }
+            });
+
+        /* We check this for every table before we send anything, so that if one of
+        them fails, none of them get created. */
+        if (action.bcards.empty()) {
+            throw failed_table_op_exc_t();
+        }
 
-    if (bcards.empty()) {
-        throw failed_table_op_exc_t();
+        actions.push_back(std::move(action));
     }
 
-    size_t num_acked = 0;
-    pmap(bcards.begin(), bcards.end(),
-    [&](const std::pair<server_id_t, multi_table_manager_bcard_t> &pair) {
-        optional<raft_start_election_immediately_t> start_immediately(
-            pair.first == initial_leader
-                ? raft_start_election_immediately_t::YES
-                : raft_start_election_immediately_t::NO);
-        try {
-            /* Send the message for the server and wait for a reply */
-            disconnect_watcher_t dw(mailbox_manager,
-                pair.second.action_mailbox.get_peer());
-            cond_t got_ack;
-            mailbox_t<> ack_mailbox(mailbox_manager,
-                [&](signal_t *) { got_ack.pulse(); });
-            send(mailbox_manager, pair.second.action_mailbox,
-                 {table_id,
-                  timestamp,
-                  multi_table_manager_bcard_t::status_t::ACTIVE,
-                  optional<table_basic_config_t>(),
-                  optional<raft_member_id_t>(raft_state.member_ids.at(pair.first)),
-                  optional<raft_persistent_state_t<table_raft_state_t> >(raft_ps),
-                  start_immediately,
-                  ack_mailbox.get_address()});
-            wait_any_t interruptor_combined(&dw, interruptor);
-            wait_interruptible(&got_ack, &interruptor_combined);
-
-            ++num_acked;
-        } catch (const interrupted_exc_t &) {
-            /* do nothing */
-        }
-    });
+    /* The servers set up the tables concurrently, since every action message gets its
+    own coroutine on the other end. */
+    {
+        block_pm_duration timer(get_table_create_setup_perfmon());
+        throttled_pmap(actions.size(), [&](int64_t i) {
+            table_action_t *action = &actions[i];
+            pmap(action->bcards.begin(), action->bcards.end(),
+            [&](const std::pair<server_id_t, multi_table_manager_bcard_t> &pair) {
+                optional<raft_start_election_immediately_t> start_immediately(
+                    pair.first == action->initial_leader
+                        ? raft_start_election_immediately_t::YES
+                        : raft_start_election_immediately_t::NO);
+                try {
+                    /* Send the message for the server and wait for a reply */
+                    disconnect_watcher_t dw(mailbox_manager,
+                        pair.second.action_mailbox.get_peer());
+                    cond_t got_ack;
+                    mailbox_t<> ack_mailbox(mailbox_manager,
+                        [&](signal_t *) { got_ack.pulse(); });
+                    send(mailbox_manager, pair.second.action_mailbox,
+                         {action->table_id,
+                          timestamp,
+                          multi_table_manager_bcard_t::status_t::ACTIVE,
+                          optional<table_basic_config_t>(),
+                          optional<raft_member_id_t>(
+                            action->raft_state->member_ids.at(pair.first)),
+                          optional<raft_persistent_state_t<table_raft_state_t> >(
+                            action->raft_ps),
+                          start_immediately,
+                          ack_mailbox.get_address()});
+                    wait_any_t interruptor_combined(&dw, interruptor);
+                    wait_interruptible(&got_ack, &interruptor_combined);
+
+                    ++action->num_acked;
+                } catch (const interrupted_exc_t &) {
+                    /* do nothing */
+                }
+            });
+        }, TABLE_META_BATCH_CONCURRENCY);
+    }
     if (interruptor->is_pulsed()) {
         throw interrupted_exc_t();
     }
 
-    if (num_acked == 0) {
-        throw maybe_failed_table_op_exc_t();
+    std::set<namespace_id_t> table_ids;
+    for (const table_action_t &action : actions) {
+        if (action.num_acked == 0) {
+            throw maybe_failed_table_op_exc_t();
+        }
+        table_ids.insert(action.table_id);
     }
 
-    /* Wait until the table appears in the directory. */
-    wait_until_change_visible(
-        table_id,
-        [&](const timestamped_basic_config_t *value) {
+    /* Wait until the tables appear in the directory. */
+    block_pm_duration timer(get_table_create_propagation_perfmon());
+    wait_until_changes_visible(
+        table_ids,
+        [&](const namespace_id_t &, const timestamped_basic_config_t *value) {
             return value != nullptr &&
                 (value->second.epoch == timestamp.epoch ||
                     value->second.epoch.supersedes(timestamp.epoch));
@@ -829,13 +943,36 @@ void table_meta_client_t::wait_until_change_visible(
         const std::function<bool(const timestamped_basic_config_t *)> &cb,
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t, maybe_failed_table_op_exc_t)
+{
+    wait_until_changes_visible(
+        std::set<namespace_id_t>{table_id},
+        [&](const namespace_id_t &, const timestamped_basic_config_t *value) {
+            return cb(value);
+        },
+        interruptor);
+}
+
+void table_meta_client_t::wait_until_changes_visible(
+        const std::set<namespace_id_t> &table_ids,
+        const std::function<bool(
+            const namespace_id_t &, const timestamped_basic_config_t *)> &cb,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, maybe_failed_table_op_exc_t)
 {
     signal_timer_t timeout;
     timeout.start(10*1000);
     wait_any_t interruptor_combined(interruptor, &timeout);
     try {
-        multi_table_manager->get_table_basic_configs()->run_key_until_satisfied(
-            table_id, cb, &interruptor_combined);
+        /* The changes propagate concurrently, so once we're done waiting for one table
+        the others usually don't take much longer. */
+        for (const namespace_id_t &table_id : table_ids) {
+            multi_table_manager->get_table_basic_configs()->run_key_until_satisfied(
+                table_id,
+                [&](const timestamped_basic_config_t *value) {
+                    return cb(table_id, value);
+                },
+                &interruptor_combined);
+        }
     } catch (const interrupted_exc_t &) {
         if (interruptor->is_pulsed()) {
             throw;
@@ -80,13 +80,22 @@ public:
             *_table_manager_directory,
         server_config_client_t *_server_config_client);
 
+    /* `get_table_manager_directory()` returns the business cards of the table managers
+    on every server. It changes when a server starts or stops hosting a table, enters a
+    new epoch for it, or becomes or stops being its Raft leader. */
+    watchable_map_t<std::pair<peer_id_t, namespace_id_t>, table_manager_bcard_t>
+            *get_table_manager_directory() {
+        return table_manager_directory;
+    }
+
     /* All of these functions can be called from any thread. */
 
     /* `find()` determines the ID of the table with the given name in the given database.
     */
     void find(
         const database_id_t &database, const name_string_t &name,
-        namespace_id_t *table_id_out, std::string *primary_key_out = nullptr)
+        namespace_id_t *table_id_out, std::string *primary_key_out = nullptr,
+        key_generation_t *key_generation_out = nullptr)
         THROWS_ONLY(no_such_table_exc_t, ambiguous_table_exc_t);
 
     /* `exists()` returns `true` if a table with the given `table_id` exists. */
@@ -173,6 +182,18 @@ public:
         THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t,
             maybe_failed_table_op_exc_t);
 
+    /* `create_multi()` is like calling `create()` for each of the tables at once. The
+    servers set up all of the tables' Raft members and files concurrently, and the call
+    waits for all of them to become visible together. If the servers for any of the
+    tables can't be found, it throws `failed_table_op_exc_t` before creating any of
+    them; if any of them can't be confirmed, it throws `maybe_failed_table_op_exc_t`,
+    and the others may or may not have been created. */
+    void create_multi(
+        const std::map<namespace_id_t, table_config_and_shards_t> &new_configs,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t,
+            maybe_failed_table_op_exc_t);
+
     /* `drop()` drops the table with the given ID. It may block. As long as the table
     exists it will always succeed, even if the other servers are not accessible. */
     void drop(
@@ -180,6 +201,14 @@ public:
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t, no_such_table_exc_t);
 
+    /* `drop_multi()` drops all of the given tables that exist at once, in the same way
+    as `create_multi()`, and sets `*dropped_out` to the ones it dropped. */
+    void drop_multi(
+        const std::set<namespace_id_t> &table_ids,
+        signal_t *interruptor,
+        std::set<namespace_id_t> *dropped_out)
+        THROWS_ONLY(interrupted_exc_t, maybe_failed_table_op_exc_t);
+
     /* `set_config()` changes the configuration of the table with the given ID. It may
     block. If it returns successfully, the change will be visible in `find()`, etc. */
     void set_config(
@@ -211,11 +240,10 @@ private:
     typedef std::pair<table_basic_config_t, multi_table_manager_timestamp_t>
         timestamped_basic_config_t;
 
-    /* `create_or_emergency_repair()` factors out the common parts of `create()` and
-    `emergency_repair()`. */
+    /* `create_or_emergency_repair()` factors out the common parts of `create_multi()`
+    and `emergency_repair()`. */
     void create_or_emergency_repair(
-        const namespace_id_t &table_id,
-        const table_raft_state_t &raft_state,
+        const std::map<namespace_id_t, table_raft_state_t> &raft_states,
         const multi_table_manager_timestamp_t::epoch_t &epoch,
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t,
@@ -256,6 +284,15 @@ private:
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t, maybe_failed_table_op_exc_t);
 
+    /* `wait_until_changes_visible()` waits for the changes to all of the tables, with
+    one timeout for all of them. */
+    void wait_until_changes_visible(
+        const std::set<namespace_id_t> &table_ids,
+        const std::function<bool(
+            const namespace_id_t &, const timestamped_basic_config_t *)> &cb,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, maybe_failed_table_op_exc_t);
+
     mailbox_manager_t *const mailbox_manager;
     multi_table_manager_t *const multi_table_manager;
     watchable_map_t<peer_id_t, multi_table_manager_bcard_t>
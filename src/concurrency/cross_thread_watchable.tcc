@@ -1,5 +1,6 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include <functional>
+#include <utility>
 
 template <class value_t>
 cross_thread_watchable_variable_t<value_t>::cross_thread_watchable_variable_t(
@@ -22,9 +23,13 @@ cross_thread_watchable_variable_t<value_t>::cross_thread_watchable_variable_t(
 template <class value_t>
 void cross_thread_watchable_variable_t<value_t>::deliver(
         UNUSED signal_t *interruptor) {
+    /* When the value changes several times while a delivery is on its way,
+    `deliver_pumper` runs this only once more afterwards, so it's copied only once for
+    all of those changes. The copy is moved into place on the other thread instead of
+    being copied again. */
     value_t temp = original->get();
     on_thread_t thread_switcher(dest_thread);
-    value = temp;
+    value = std::move(temp);
     publisher_controller.publish([](const std::function<void()> &f) { f(); });
 }
 
@@ -70,9 +75,9 @@ void cross_thread_watchable_map_var_t<key_t, value_t>::deliver(
     std::map<key_t, optional<value_t> > local_changes;
     std::swap(local_changes, queued_changes);
     on_thread_t thread_switcher(output_thread);
-    for (const auto &pair : local_changes) {
+    for (auto &pair : local_changes) {
         if (static_cast<bool>(pair.second)) {
-            output_var.set_key_no_equals(pair.first, *pair.second);
+            output_var.set_key_no_equals(pair.first, std::move(*pair.second));
         } else {
             output_var.delete_key(pair.first);
         }
@@ -0,0 +1,47 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "concurrency/lock_stats.hpp"
+
+#include "perfmon/perfmon.hpp"
+
+// These are created during static initialization, because registering them later
+// could switch threads, and waits get recorded where that isn't allowed.
+static perfmon_collection_t pm_lock_waits_collection(threadnum_t(0));
+static perfmon_membership_t pm_lock_waits_membership(
+    &get_global_perfmon_collection(), &pm_lock_waits_collection, "lock_waits");
+static perfmon_latency_histogram_t pm_superblock_waits, pm_sindex_block_waits,
+    pm_page_waits, pm_sindex_queue_waits, pm_changefeed_stamp_waits;
+static perfmon_multi_membership_t pm_lock_waits_stats_membership(
+    &pm_lock_waits_collection,
+    &pm_superblock_waits, "superblock",
+    &pm_sindex_block_waits, "sindex_block",
+    &pm_page_waits, "page",
+    &pm_sindex_queue_waits, "sindex_queue",
+    &pm_changefeed_stamp_waits, "changefeed_stamp");
+
+void record_lock_wait(lock_class_t lock_class, ticks_t wait_start) {
+    if (wait_start == 0) {
+        return;
+    }
+    const ticks_t wait_ticks = get_ticks() - wait_start;
+    switch (lock_class) {
+    case lock_class_t::none:
+        break;
+    case lock_class_t::superblock:
+        pm_superblock_waits.record_ticks(wait_ticks);
+        break;
+    case lock_class_t::sindex_block:
+        pm_sindex_block_waits.record_ticks(wait_ticks);
+        break;
+    case lock_class_t::page:
+        pm_page_waits.record_ticks(wait_ticks);
+        break;
+    case lock_class_t::sindex_queue:
+        pm_sindex_queue_waits.record_ticks(wait_ticks);
+        break;
+    case lock_class_t::changefeed_stamp:
+        pm_changefeed_stamp_waits.record_ticks(wait_ticks);
+        break;
+    default:
+        unreachable();
+    }
+}
@@ -0,0 +1,32 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONCURRENCY_LOCK_STATS_HPP_
+#define CONCURRENCY_LOCK_STATS_HPP_
+
+#include "time.hpp"
+
+/* Locks that are worth watching for contention are given a `lock_class_t`.  Whenever
+an acquirer of such a lock can't get it right away, the time until it gets it is
+recorded under the lock's class in the `lock_waits` stats of the global perfmon
+collection (and thereby in `rethinkdb._debug_stats`).  Each class reports the number
+of waits and a histogram of the wait times.  Acquisitions that are granted right away
+are not recorded, so uncontended locks only pay for a comparison. */
+enum class lock_class_t {
+    none,
+    superblock,
+    sindex_block,
+    page,
+    sindex_queue,
+    changefeed_stamp
+};
+
+/* Starts timing a wait for a lock of class `lock_class`.  Returns the value to pass to
+`record_lock_wait()` once the lock has been acquired, which is 0 if the class isn't
+recorded. */
+inline ticks_t start_lock_wait(lock_class_t lock_class) {
+    return lock_class == lock_class_t::none ? 0 : get_ticks();
+}
+
+/* Records the wait that `start_lock_wait()` returned `wait_start` for, if any. */
+void record_lock_wait(lock_class_t lock_class, ticks_t wait_start);
+
+#endif  // CONCURRENCY_LOCK_STATS_HPP_
@@ -12,7 +12,9 @@
 
 class new_mutex_t {
 public:
-    new_mutex_t() { }
+    // Waits for the mutex are recorded under `lock_class`, see lock_stats.hpp.
+    explicit new_mutex_t(lock_class_t lock_class = lock_class_t::none)
+        : rwlock_(lock_class) { }
     ~new_mutex_t() { }
 
 private:
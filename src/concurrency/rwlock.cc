@@ -3,7 +3,7 @@
 #include "concurrency/interruptor.hpp"
 #include "valgrind.hpp"
 
-rwlock_t::rwlock_t() { }
+rwlock_t::rwlock_t(lock_class_t lock_class) : lock_class_(lock_class) { }
 
 rwlock_t::~rwlock_t() {
     guarantee(acqs_.empty());
@@ -12,6 +12,19 @@ rwlock_t::~rwlock_t() {
 void rwlock_t::add_acq(rwlock_in_line_t *acq) {
     acqs_.push_back(acq);
     pulse_pulsables(acq);
+    const cond_t *acq_cond =
+        acq->access_ == access_t::read ? &acq->read_cond_ : &acq->write_cond_;
+    if (!acq_cond->is_pulsed()) {
+        acq->wait_start_ = start_lock_wait(lock_class_);
+    }
+}
+
+// Called right before `p` gets the access it asked for.
+void rwlock_t::record_granted(rwlock_in_line_t *p) {
+    if (p->wait_start_ != 0) {
+        record_lock_wait(lock_class_, p->wait_start_);
+        p->wait_start_ = 0;
+    }
 }
 
 void rwlock_t::remove_acq(rwlock_in_line_t *acq) {
@@ -33,6 +46,7 @@ void rwlock_t::pulse_pulsables(rwlock_in_line_t *p) {
         // read, the subsequent chain of nodes will already have been pulsed for
         // read.)
         if (p->access_ == access_t::write && acqs_.prev(p) == nullptr) {
+            record_granted(p);
             p->write_cond_.pulse_if_not_already_pulsed();
         }
         return;
@@ -46,15 +60,19 @@ void rwlock_t::pulse_pulsables(rwlock_in_line_t *p) {
                 // pulsed read-acquirer.
                 return;
             }
-            p->read_cond_.pulse();
-
             // Should we also pulse p for write (and exit, of course)?
             if (p->access_ == access_t::write) {
                 if (prev == nullptr) {
+                    record_granted(p);
+                    p->read_cond_.pulse();
                     p->write_cond_.pulse();
+                } else {
+                    p->read_cond_.pulse();
                 }
                 return;
             }
+            record_granted(p);
+            p->read_cond_.pulse();
             prev = p;
             p = acqs_.next(p);
         } while (p != nullptr);
@@ -63,10 +81,10 @@ void rwlock_t::pulse_pulsables(rwlock_in_line_t *p) {
 }
 
 rwlock_in_line_t::rwlock_in_line_t()
-    : lock_(nullptr), access_(valgrind_undefined(access_t::read)) { }
+    : lock_(nullptr), access_(valgrind_undefined(access_t::read)), wait_start_(0) { }
 
 rwlock_in_line_t::rwlock_in_line_t(rwlock_t *lock, access_t access)
-    : lock_(lock), access_(access) {
+    : lock_(lock), access_(access), wait_start_(0) {
     lock_->add_acq(this);
 }
 
@@ -74,7 +92,8 @@ rwlock_in_line_t::rwlock_in_line_t(rwlock_in_line_t &&other)
     : lock_(other.lock_),
       access_(other.access_),
       read_cond_(std::move(other.read_cond_)),
-      write_cond_(std::move(other.write_cond_)) {
+      write_cond_(std::move(other.write_cond_)),
+      wait_start_(other.wait_start_) {
     other.lock_ = nullptr;
     other.access_ = valgrind_undefined(access_t::read);
 }
@@ -91,6 +110,7 @@ void rwlock_in_line_t::reset() {
         access_ = valgrind_undefined(access_t::read);
         read_cond_.reset();
         write_cond_.reset();
+        wait_start_ = 0;
     }
 }
 
@@ -3,13 +3,15 @@
 
 #include "concurrency/access.hpp"
 #include "concurrency/cond_var.hpp"
+#include "concurrency/lock_stats.hpp"
 #include "containers/intrusive_list.hpp"
 
 class rwlock_in_line_t;
 
 class rwlock_t {
 public:
-    rwlock_t();
+    // Waits for the lock are recorded under `lock_class`, see lock_stats.hpp.
+    explicit rwlock_t(lock_class_t lock_class = lock_class_t::none);
     ~rwlock_t();
 
 private:
@@ -18,6 +20,9 @@ private:
     void remove_acq(rwlock_in_line_t *acq);
 
     void pulse_pulsables(rwlock_in_line_t *p);
+    void record_granted(rwlock_in_line_t *p);
+
+    const lock_class_t lock_class_;
 
     // Acquirers, in order by acquisition, with the head containing one of the
     // current acquirer, the tail possibly containing a node that does not yet hold
@@ -61,6 +66,8 @@ private:
     access_t access_;
     cond_t read_cond_;
     cond_t write_cond_;
+    // Set by `start_lock_wait()` if we had to get in line behind someone.
+    ticks_t wait_start_;
 
     DISABLE_COPYING(rwlock_in_line_t);
 };
@@ -174,6 +174,7 @@ public:
     `set_key_no_equals()`. */
     void set_key(const key_t &key, const value_t &new_value);
     void set_key_no_equals(const key_t &key, const value_t &new_value);
+    void set_key_no_equals(const key_t &key, value_t &&new_value);
 
     /* `delete_key()` removes `key` from the map if it was present before. */
     void delete_key(const key_t &key);
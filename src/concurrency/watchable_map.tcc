@@ -257,6 +257,15 @@ void watchable_map_var_t<key_t, value_t>::set_key_no_equals(
     watchable_map_t<key_t, value_t>::notify_change(key, &new_value, &write_acq);
 }
 
+template<class key_t, class value_t>
+void watchable_map_var_t<key_t, value_t>::set_key_no_equals(
+        const key_t &key, value_t &&new_value) {
+    rwi_lock_assertion_t::write_acq_t write_acq(&rwi_lock);
+    value_t *stored = &map[key];
+    *stored = std::move(new_value);
+    watchable_map_t<key_t, value_t>::notify_change(key, stored, &write_acq);
+}
+
 template<class key_t, class value_t>
 void watchable_map_var_t<key_t, value_t>::delete_key(const key_t &key) {
     rwi_lock_assertion_t::write_acq_t write_acq(&rwi_lock);
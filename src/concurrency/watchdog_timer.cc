@@ -3,6 +3,7 @@
 
 #include "arch/runtime/coroutines.hpp"
 #include "arch/timing.hpp"
+#include "assignment_sentry.hpp"
 #include "random.hpp"
 #include "utils.hpp"
 
@@ -18,6 +19,9 @@ watchdog_timer_t::blocker_t::~blocker_t() {
     --parent->num_blockers;
     if (parent->num_blockers == 0) {
         parent->notify();
+        if (parent->unblocked != nullptr && !parent->unblocked->is_pulsed()) {
+            parent->unblocked->pulse();
+        }
     }
 }
 
@@ -25,7 +29,7 @@ watchdog_timer_t::watchdog_timer_t(
         int _min, int _max, const std::function<void()> &_callback,
         state_t initial_state) :
     min_timeout_ms(_min), max_timeout_ms(_max), callback(_callback),
-    num_blockers(0), state(initial_state)
+    num_blockers(0), state(initial_state), unblocked(nullptr)
 {
     if (initial_state == state_t::TRIGGERED && static_cast<bool>(callback)) {
         callback();
@@ -47,6 +51,14 @@ void watchdog_timer_t::notify() {
 void watchdog_timer_t::run(auto_drainer_t::lock_t keepalive) {
     try {
         for (;;) {
+            if (num_blockers > 0) {
+                /* `~blocker_t()` will call `notify()`, so there's nothing to do until
+                then. */
+                cond_t cond;
+                assignment_sentry_t<cond_t *> sentry(&unblocked, &cond);
+                wait_interruptible(&cond, keepalive.get_drain_signal());
+                continue;
+            }
             microtime_t now = current_microtime();
             if (now > next_threshold) {
                 ASSERT_NO_CORO_WAITING;
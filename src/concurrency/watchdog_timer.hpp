@@ -5,6 +5,7 @@
 #include <functional>
 
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/interruptor.hpp"
 #include "threading.hpp"
 #include "time.hpp"
@@ -12,7 +13,11 @@
 /* `watchdog_timer_t` keeps track of how long it's been since the `notify()` method was
 last called. If ever `notify()` is not called for a sufficiently long interval (randomly
 chosen between `min_timeout_ms` and `max_timeout_ms`), the watchdog becomes "triggered":
-it periodically calls its `callback` until it is notified or destroyed. */
+it periodically calls its `callback` until it is notified or destroyed.
+
+While there are `blocker_t`s, the watchdog doesn't wake up at all. A server can have
+thousands of Raft members, each with its own watchdogs, and they're blocked for as long
+as there's a leader, so this keeps idle servers from waking up all the time. */
 
 class watchdog_timer_t : public home_thread_mixin_debug_only_t {
 public:
@@ -49,6 +54,8 @@ private:
     microtime_t next_threshold;
     int num_blockers;
     state_t state;
+    /* Set while `run()` is waiting for the last `blocker_t` to go away. */
+    cond_t *unblocked;
     
     auto_drainer_t drainer;
 };
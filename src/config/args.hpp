@@ -44,6 +44,14 @@
 // useful.
 #define DEFAULT_IO_BATCH_FACTOR                   1
 
+// Reads of the same file that are queued at the same time and at most
+// `DISK_MERGE_MAX_GAP` bytes apart get merged into one vectored read of up to
+// `DISK_MERGE_MAX_SIZE` bytes.  The disk manager looks at up to
+// `DISK_MERGE_MAX_LOOKAHEAD` queued operations to find them.
+#define DISK_MERGE_MAX_GAP                        (16 * KILOBYTE)
+#define DISK_MERGE_MAX_SIZE                       MEGABYTE
+#define DISK_MERGE_MAX_LOOKAHEAD                  32
+
 // I/O priority of index writes in the log serializer
 #define INDEX_WRITE_IO_PRIORITY                   128
 
@@ -66,6 +74,26 @@
 // 0 = minimal priority
 #define SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY   5
 
+// How many index entries of a chunk of post construction may be inserted into one
+// secondary index at the same time, so that the reads of their leaves overlap
+#define SINDEX_POST_CONSTRUCTION_MAX_CONCURRENT_WRITES 16
+
+// The blob blocks of deleted values that are at least this large are freed by a
+// background reaper in separate write transactions, at most
+// `BLOB_REAPER_MAX_BLOBS_PER_TXN` blobs per transaction, instead of by the write that
+// deleted the value.
+#define LAZY_BLOB_DELETION_MIN_SIZE               (256 * KILOBYTE)
+#define BLOB_REAPER_MAX_BLOBS_PER_TXN             16
+
+// The cache priority of range reads from queries run with `io_priority: "low"`, on
+// the same scale
+#define LOW_IO_PRIORITY_READS_CACHE_PRIORITY      5
+
+// Disk backed queues write their file and read it back in pieces of this many bytes.
+// A queue keeps up to three of them in memory: the one being filled by pushes, the
+// one being popped from and the next one, which is read ahead.
+#define DBQ_CHUNK_SIZE                            (512 * KILOBYTE)
+
 // Size of the buffer used to perform IO operations (in bytes).
 #define IO_BUFFER_SIZE                            (4 * KILOBYTE)
 
@@ -75,14 +103,76 @@
 // Size of each btree node (in bytes) on disk
 #define DEFAULT_BTREE_BLOCK_SIZE                  (4 * KILOBYTE)
 
+// Each thread keeps the freed block buffers of up to `BLOCK_BUFFER_POOL_MAX_BUFFER_SIZE`
+// bytes around for reuse, up to `BLOCK_BUFFER_POOL_MAX_RETAINED_BYTES` in total.
+#define BLOCK_BUFFER_POOL_MAX_BUFFER_SIZE         (16 * KILOBYTE)
+#define BLOCK_BUFFER_POOL_MAX_RETAINED_BYTES      (4 * MEGABYTE)
+
 // Size of each extent (in bytes)
 // This should not be too small, or garbage collection will become
 // inefficient (especially on rotational drives).
 #define DEFAULT_EXTENT_SIZE                       (2 * MEGABYTE)
 
+// Striped table files go round-robin across their files in units of this many bytes.
+// It's the default extent size so that whole extents end up on a single device.  Files
+// that already exist depend on it, so it must not change.
+#define SERIALIZER_STRIPE_UNIT_SIZE               (2 * MEGABYTE)
+
+// When a btree traversal has read this many sibling blocks in a row, it starts
+// asking the cache to load the following siblings ahead of time.  The number of
+// siblings it loads ahead starts at the minimum batch size and doubles every time
+// the traversal catches up with it, up to the maximum batch size.
+#define BTREE_PREFETCH_SEQUENTIAL_THRESHOLD       2
+#define BTREE_PREFETCH_MIN_BATCH                  2
+#define BTREE_PREFETCH_MAX_BATCH                  64
+
+// With the scan-resistant eviction policy, pages that have only been acquired once
+// are evicted first once they use more than 1/CACHE_PROBATIONARY_SHARE of a cache's
+// memory limit.
+#define CACHE_PROBATIONARY_SHARE                  4
+
+// Btree internal nodes are only evicted after all other disk-backed pages, as long as
+// they use at most 1/CACHE_INTERNAL_NODE_SHARE of a cache's memory limit.  That way
+// descending the tree rarely has to wait for the disk, even after a large scan.
+#define CACHE_INTERNAL_NODE_SHARE                 4
+
+// With `--snapshot-memory-limit`, batched range reads and secondary index construction
+// stop at the next key boundary once the old page versions that snapshots hold on to
+// use more than that share of a cache's memory limit, and go on under a new snapshot.
+// They still handle at least this many rows under every snapshot, so that they keep
+// making progress.
+#define SNAPSHOT_MEMORY_LIMIT_MIN_ROWS            100
+
 // Ratio of free ram to use for the cache by default
 #define DEFAULT_MAX_CACHE_RATIO                   2
 
+// With `--dynamic-cache-size`, an automatically sized cache gets resized every
+// DYNAMIC_CACHE_SIZE_INTERVAL_MS.  It may use the memory that the cgroup limit and the
+// available memory leave next to the rest of the process, minus
+// DYNAMIC_CACHE_SIZE_HEADROOM_PERCENT of it for queries and other overhead.
+#define DYNAMIC_CACHE_SIZE_INTERVAL_MS            (5 * THOUSAND)
+#define DYNAMIC_CACHE_SIZE_HEADROOM_PERCENT       20
+// When more than DYNAMIC_CACHE_SIZE_SHRINK_PRESSURE percent of the last ten seconds were
+// spent waiting for memory (the `some avg10` PSI value), the cache shrinks by
+// 1/DYNAMIC_CACHE_SIZE_SHRINK_DIVISOR, even if its target is larger.  It only grows
+// while the pressure stays below DYNAMIC_CACHE_SIZE_GROW_PRESSURE, and by at most
+// 1/DYNAMIC_CACHE_SIZE_GROW_DIVISOR at a time, so that it doesn't swing back and forth.
+#define DYNAMIC_CACHE_SIZE_SHRINK_PRESSURE        10.0
+#define DYNAMIC_CACHE_SIZE_SHRINK_DIVISOR         8
+#define DYNAMIC_CACHE_SIZE_GROW_PRESSURE          1.0
+#define DYNAMIC_CACHE_SIZE_GROW_DIVISOR           4
+// Smaller changes than 1/DYNAMIC_CACHE_SIZE_MIN_CHANGE_DIVISOR aren't worth rebalancing
+// the caches for.
+#define DYNAMIC_CACHE_SIZE_MIN_CHANGE_DIVISOR     32
+
+// Every LOW_MEMORY_CHECK_INTERVAL_MS, the server compares its resident memory to the
+// memory that it can use at most (its cgroup limit, or the available memory and what
+// it already uses).  Above LOW_MEMORY_SHED_PERCENT of that it turns away new queries,
+// until it drops below LOW_MEMORY_RECOVER_PERCENT again.
+#define LOW_MEMORY_CHECK_INTERVAL_MS              THOUSAND
+#define LOW_MEMORY_SHED_PERCENT                   90
+#define LOW_MEMORY_RECOVER_PERCENT                85
+
 // The maximum number of concurrently active
 // index writes per merger serializer.
 // The smaller the number, the more effective
@@ -95,6 +185,9 @@
 // I/O priority of block writes in the merger_serializer_t
 #define MERGER_BLOCK_WRITE_IO_PRIORITY            64
 
+// The longest that an idle event loop may be told to busy-poll (--event-loop-spin).
+#define MAX_EVENT_LOOP_SPIN_USECS                 100000
+
 // Maximum number of threads we support
 // TODO: make this dynamic where possible
 #define MAX_THREADS                               128
@@ -102,6 +195,14 @@
 // Ticks (in milliseconds) the internal timed tasks are performed at
 #define TIMER_TICKS_IN_MS                         5
 
+// Timers of at least `TIMER_WHEEL_MIN_MS` go into a hashed timer wheel of
+// `TIMER_WHEEL_SLOTS` slots, each `TIMER_WHEEL_TICK_MS` long, instead of into the
+// priority queue, so that adding and canceling them takes constant time.  They may
+// ring up to one tick late.
+#define TIMER_WHEEL_MIN_MS                        100
+#define TIMER_WHEEL_TICK_MS                       10
+#define TIMER_WHEEL_SLOTS                         512
+
 // How many times the page replacement algorithm tries to find an eligible page before giving up.
 // Note that (MAX_UNSAVED_DATA_LIMIT_FRACTION ** PAGE_REPL_NUM_TRIES) is the probability that the
 // page replacement algorithm will succeed on a given try, and if that probability is less than 1/2
@@ -138,6 +239,17 @@
 // doesn't return memory to the OS. If it's set too low, startup will take a longer time.
 #define LBA_READ_BUFFER_SIZE                      (128 * MEGABYTE)
 
+// If the LBA has at least this many extents, the entries of the different LBA shards
+// get applied to the in-memory index on separate threads while loading it.
+#define LBA_MIN_EXTENTS_FOR_PARALLEL_LOAD         16
+
+// How long the first index write of a group commit waits for concurrent index writes
+// to join its metablock write, and how many bytes of block writes a group may cover
+// before it stops waiting.  A window of 0 still groups the index writes that become
+// ready while the previous metablock write is in flight.
+#define DEFAULT_GROUP_COMMIT_WINDOW_MS            0
+#define DEFAULT_GROUP_COMMIT_MAX_BYTES            (MEGABYTE * 16)
+
 // After the LBA has been read, we reconstruct the in-memory LBA index.
 // For huge tables, this can take some considerable CPU time. We break the reconstruction
 // up into smaller batches, each batch reconstructing up to `LBA_RECONSTRUCTION_BATCH_SIZE`
@@ -146,6 +258,180 @@
 
 #define COROUTINE_STACK_SIZE                      131072
 
+// The stack size of coroutines spawned with `coro_stack_class_t::SMALL`.  Code that
+// recurses deeply uses `call_with_enough_stack()`, so it's fine to run it on them.
+#define COROUTINE_SMALL_STACK_SIZE                65536
+
+// Every client connection keeps the compiled term trees of its most recent
+// `QUERY_CACHE_COMPILED_QUERIES` START queries, so that a query with the same text can
+// skip parsing and compilation.  Queries longer than
+// `QUERY_CACHE_MAX_COMPILED_QUERY_SIZE` bytes are never looked up or kept.
+#define QUERY_CACHE_COMPILED_QUERIES              64
+#define QUERY_CACHE_MAX_COMPILED_QUERY_SIZE       (KILOBYTE * 4)
+
+// Streams of queries run with the `prefetch` optarg compute their next batch while the
+// current one is on its way to the client.  A connection stops prefetching batches
+// while its prefetched ones add up to `QUERY_CACHE_MAX_PREFETCH_BYTES` or more.
+#define QUERY_CACHE_MAX_PREFETCH_BYTES            (MEGABYTE * 16)
+
+// Every thread keeps the compiled form of the `WIRE_FUNC_CACHE_SIZE` ReQL functions
+// it most recently received in cluster messages (such as write hooks, which come
+// with every write), so that a function it has seen before doesn't get parsed and
+// compiled again.  Functions that serialize to more than `WIRE_FUNC_CACHE_MAX_SIZE`
+// bytes are never looked up or kept.
+#define WIRE_FUNC_CACHE_SIZE                      64
+#define WIRE_FUNC_CACHE_MAX_SIZE                  (KILOBYTE * 4)
+
+// Queries that take at least `SLOW_QUERY_LOG_THRESHOLD_MS` from the time they're
+// received to the time their last response is sent get written to the log, along with
+// what they cost.  The threshold can be changed with `--slow-query-threshold`.  The
+// query is printed `SLOW_QUERY_LOG_COLUMNS` wide.
+#define SLOW_QUERY_LOG_THRESHOLD_MS               1000
+#define SLOW_QUERY_LOG_COLUMNS                    200
+
+// At most `ADMISSION_MAX_ACTIVE_QUERIES` START queries run at once on each thread.  The
+// others wait in line, no more than `ADMISSION_MAX_QUEUED_QUERIES` of them per thread,
+// and get rejected after waiting for `ADMISSION_MAX_QUEUE_TIME_MS`.  Queries with the
+// `priority` optarg set to "high" may wait four times as long, and those with "low"
+// only a quarter of that.
+#define ADMISSION_MAX_ACTIVE_QUERIES              64
+#define ADMISSION_MAX_QUEUED_QUERIES              1024
+#define ADMISSION_MAX_QUEUE_TIME_MS               1000
+
+// A query of a user that is over the read or write rate of its `--user-quota` waits
+// for the user to get back within it, but fails instead if that would take more than
+// `USER_QUOTA_MAX_WAIT_MS`.
+#define USER_QUOTA_MAX_WAIT_MS                    (5 * THOUSAND)
+
+// The `query_engine.query_shapes` stats keep a latency histogram for each of up to
+// `QUERY_SHAPE_MAX_SHAPES` query shapes per thread, and count the queries of any other
+// shapes together.  Shapes are cut off after `QUERY_SHAPE_MAX_SIZE` characters.
+#define QUERY_SHAPE_MAX_SHAPES                    64
+#define QUERY_SHAPE_MAX_SIZE                      512
+
+// How many query geometries each store remembers the index cell coverings of, for
+// `get_intersecting` queries that repeatedly use the same geometry.
+#define GEO_COVERING_CACHE_SIZE                   64
+
+// Unless `index_create` says otherwise, geospatial indexes cover every geometry with up
+// to this many grid cells, of any level up to the finest one of the S2 grid.
+#define GEO_INDEX_DEFAULT_MAX_CELLS               8
+#define GEO_INDEX_MAX_CELL_LEVEL                  30
+
+// The size of the blocks of the `arena_t` of each `env_t`, which holds the scratch
+// space of evaluating one batch of a query.
+#define ARENA_BLOCK_SIZE                          (KILOBYTE * 32)
+
+// The sampling profiler records backtraces of up to `SAMPLING_PROFILER_MAX_DEPTH`
+// frames into a buffer of `SAMPLING_PROFILER_BUFFER_SIZE` samples per thread, which the
+// admin HTTP server empties every `SAMPLING_PROFILER_COLLECT_INTERVAL_MS`.
+#define SAMPLING_PROFILER_MAX_DEPTH               48
+#define SAMPLING_PROFILER_BUFFER_SIZE             512
+#define SAMPLING_PROFILER_COLLECT_INTERVAL_MS     500
+#define SAMPLING_PROFILER_DEFAULT_HZ              99
+#define SAMPLING_PROFILER_MAX_HZ                  1000
+
+// Batch expressions over at least this many rows, and responses with at least this
+// many items, get evaluated and encoded with `run_stealable()`, so an idle thread can
+// take them over from a busy one.
+#define WORK_STEALING_MIN_ITEMS                   64
+
+// Functions that make `r.http` requests get called on up to this many rows of a batch
+// at once, each in its own coroutine.
+#define MAX_CONCURRENT_EXTERNAL_FUNC_CALLS        16
+
+// An insert of many documents writes up to this many of its batches at once.
+#define MAX_CONCURRENT_INSERT_BATCHES             8
+
+// A `server_t` sends changefeed messages to each client in batches of at most this
+// many messages.
+#define CHANGEFEED_MAX_BATCHED_MSGS               256
+
+// Besides the top `n` rows, an `orderBy.limit` changefeed keeps up to this many of the
+// following rows in memory so that it can replace rows that drop out of the top `n`
+// without reading from disk.
+#define LIMIT_CHANGEFEED_SHADOW_ROWS              100
+
+// A feed's point changefeeds are spread over this many separately locked hash tables.
+#define CHANGEFEED_POINT_SUB_SHARDS               64
+
+// Each store looks at one in this many key accesses to find its hot keys, estimates
+// their counts with a count-min sketch of this many rows of this many counters, and
+// reports this many keys of each kind.  The counts get halved every so many samples.
+#define HOT_KEYS_SAMPLE_RATE                      16
+#define HOT_KEYS_SKETCH_DEPTH                     4
+#define HOT_KEYS_SKETCH_WIDTH                     1024
+#define HOT_KEYS_TRACKED                          16
+#define HOT_KEYS_DECAY_SAMPLES                    (1 << 16)
+
+// A point read that fills the `--point-read-cache-size` cache only gets cached if none
+// of the changes that arrived while it ran hashed to the same one of this many slots.
+#define POINT_READ_CACHE_EPOCH_SLOTS              1024
+
+// With `--coalesce-writes`, this many batches of single-document inserts into a table
+// can be written at once from every thread, and each of them holds at most this many
+// documents.
+#define WRITE_COALESCING_MAX_IN_FLIGHT            4
+#define WRITE_COALESCING_MAX_BATCH_SIZE           256
+
+// With `--primary-key-filter`, each store's filter of its primary keys has this many
+// bits for every key it's made for, and every key sets this many of them, which lets
+// about 1% of the absent keys through.  It's made for twice as many keys as the scan
+// that builds it found, but at least this many, and the scan reads this many at a time.
+#define PRIMARY_KEY_FILTER_BITS_PER_KEY           10
+#define PRIMARY_KEY_FILTER_NUM_HASHES             7
+#define PRIMARY_KEY_FILTER_MIN_KEYS               (1 << 16)
+#define PRIMARY_KEY_FILTER_SCAN_CHUNK_SIZE        1024
+
+// With `--cluster-compression`, messages to other servers that are at least this large
+// get compressed.  Smaller messages don't gain enough to be worth the CPU time.
+#define CLUSTER_COMPRESSION_MIN_MESSAGE_SIZE      (KILOBYTE * 4)
+
+// Datums and strings in a message from another server refer to the message's buffer
+// instead of being copied out of it if they are at least this large.  A smaller
+// value would pin large message buffers in memory for the sake of small values.
+#define DATUM_ZERO_COPY_MIN_SIZE                  KILOBYTE
+
+// Object keys that get parsed from JSON or from a query are looked up in a per-thread
+// table of `DATUM_STRING_INTERN_SLOTS` recent keys, so that all objects with the same
+// key can share its buffer.  Keys longer than `DATUM_STRING_MAX_INTERNED_SIZE` bytes
+// are left alone, and so are those short enough to not need a buffer at all.
+#define DATUM_STRING_INTERN_SLOTS                 1024
+#define DATUM_STRING_MAX_INTERNED_SIZE            64
+
+// `datum_t::append` switches arrays of at least this many elements to a persistent
+// vector, which shares its elements with the arrays that get appended to it.
+#define PERSISTENT_ARRAY_MIN_SIZE                 64
+
+// Cluster messages and client responses of at least this many bytes get written to
+// the socket straight from their own buffers.  Smaller ones are cheaper to copy into
+// the connection's write buffer, where they can share a system call with other writes.
+#define UNBUFFERED_WRITE_MIN_SIZE                 (KILOBYTE * 64)
+
+// JSON client responses that get larger than this are encoded twice: once to find out
+// their size, which goes in front of them, and once more while they're written to the
+// socket in pieces of this size.  That way no response needs a buffer for all of its
+// JSON on top of its datums.
+#define JSON_RESPONSE_CHUNK_SIZE                  (MEGABYTE * 4)
+
+// The primary sends the writes for a replica that it gets during one pass of the event
+// loop as a single message, but puts at most this many writes into a message.
+#define REPLICATION_WRITE_BATCH_MAX_WRITES        64
+
+// With `--backfill-latency-target`, every `BACKFILL_THROTTLER_INTERVAL_MS` the backfill
+// throttler compares this percentile of the disk read latency with the target, and
+// lowers or raises the number of backfills that may run at once.
+#define BACKFILL_THROTTLER_INTERVAL_MS            1000
+#define BACKFILL_THROTTLER_LATENCY_PERCENTILE     0.99
+
+// Between two passes of secondary index post construction, the construction waits
+// for a delay that doubles (up to the maximum for the `--index-build-priority`) while
+// the disk queue is longer than the number of concurrent I/O requests or acquiring
+// the superblock took longer than the latency target, and halves otherwise.
+#define SINDEX_BUILD_MIN_PASS_DELAY_MS            1
+#define SINDEX_BUILD_MAX_PASS_DELAY_MS            100
+#define SINDEX_BUILD_LOW_PRIORITY_MAX_PASS_DELAY_MS 1000
+#define SINDEX_BUILD_SUPERBLOCK_LATENCY_TARGET_MS 10
 
 /**
  * Message scheduler configuration
@@ -184,5 +470,58 @@
 #define CORO_PRIORITY_DIRECTORY_CHANGES         (-2)
 #define CORO_PRIORITY_LBA_GC                    (-2)
 
+// How many keys `store_t::reset_data()` erases per write transaction. Every pass pays
+// for acquiring the superblock and sindex block, a metainfo update and a commit, so
+// bigger passes erase faster, but they also keep other writes to the store waiting for
+// longer.
+#define RESET_DATA_MAX_ERASED_PER_PASS          500
+
+// `r.http` responses with the `cache` optarg are kept in a per-thread LRU cache of at
+// most HTTP_RESPONSE_CACHE_MAX_ENTRIES responses.  Responses whose header and body
+// serialize to more than HTTP_RESPONSE_CACHE_MAX_ENTRY_SIZE bytes are not cached.
+#define HTTP_RESPONSE_CACHE_MAX_ENTRIES         128
+#define HTTP_RESPONSE_CACHE_MAX_ENTRY_SIZE      (128 * KILOBYTE)
+
+// The `r.http` requests that a query makes concurrently are sent to a worker process
+// in jobs of up to HTTP_BATCH_MAX_REQUESTS requests, which the worker runs in
+// parallel.  Requests in a batch time out on their own in the worker, and the job
+// itself times out HTTP_BATCH_TIMEOUT_SLACK_MS after its slowest request should have.
+#define HTTP_BATCH_MAX_REQUESTS                 32
+#define HTTP_BATCH_TIMEOUT_SLACK_MS             5000
+
+// With `--auto-rebalance`, tables are checked every AUTO_REBALANCE_CHECK_INTERVAL_MS.  A
+// table with at least AUTO_REBALANCE_MIN_DOCUMENTS documents is rebalanced when its
+// largest shard holds AUTO_REBALANCE_IMBALANCE_RATIO times its even share of them, but
+// not more than once per AUTO_REBALANCE_MIN_INTERVAL_MS.
+#define AUTO_REBALANCE_CHECK_INTERVAL_MS        (5 * 60 * THOUSAND)
+#define AUTO_REBALANCE_MIN_INTERVAL_MS          (60 * 60 * THOUSAND)
+#define AUTO_REBALANCE_MIN_DOCUMENTS            10000
+#define AUTO_REBALANCE_IMBALANCE_RATIO          1.5
+
+// Rows of `rethinkdb.table_status` are computed from a cached status of each table when
+// it's at most TABLE_STATUS_CACHE_TTL_MS old.
+#define TABLE_STATUS_CACHE_TTL_MS               5000
+
+// Every HOT_BLOCKS_SAVE_INTERVAL_MS, and when a table is shut down, the IDs of up to
+// HOT_BLOCKS_MAX_PER_STORE of the most recently used blocks of each of its caches get
+// saved next to the table's file.  When the table is opened again, those blocks are
+// read back into the cache before it starts serving queries, with at most
+// PAGE_CACHE_WARM_UP_BATCH_SIZE reads in flight per cache.
+#define HOT_BLOCKS_SAVE_INTERVAL_MS             (10 * 60 * THOUSAND)
+#define HOT_BLOCKS_MAX_PER_STORE                65536
+#define PAGE_CACHE_WARM_UP_BATCH_SIZE           64
+
+// The most cache memory each store of a table with mapped reads (see
+// `table_cache_config_t::mmap_reads`) gets from the cache balancer.
+#define MMAP_READS_CACHE_SIZE                   (4 * MEGABYTE)
+
+// When the server starts up, up to TABLE_STARTUP_CONCURRENCY of the tables on disk are
+// opened at the same time.
+#define TABLE_STARTUP_CONCURRENCY               16
+
+// `table_meta_client_t::create_multi()` and `drop_multi()` send the actions for up to
+// this many of their tables to the servers at the same time.
+#define TABLE_META_BATCH_CONCURRENCY            32
+
 #endif  // CONFIG_ARGS_HPP_
 
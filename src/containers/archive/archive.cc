@@ -66,6 +66,7 @@ write_message_t::~write_message_t() {
 }
 
 void write_message_t::append(const void *p, int64_t n) {
+    size_ += n;
     while (n > 0) {
         if (buffers_.empty() || buffers_.tail()->size == write_buffer_t::DATA_SIZE) {
             buffers_.push_back(new write_buffer_t);
@@ -81,15 +82,14 @@ void write_message_t::append(const void *p, int64_t n) {
     }
 }
 
-size_t write_message_t::size() const {
-    size_t ret = 0;
-    for (write_buffer_t *h = buffers_.head(); h != nullptr; h = buffers_.next(h)) {
-        ret += h->size;
-    }
-    return ret;
+void write_message_t::append(write_message_t &&other) {
+    size_ += other.size_;
+    other.size_ = 0;
+    buffers_.append_and_clear(&other.buffers_);
 }
 
 int send_write_message(write_stream_t *s, const write_message_t *wm) {
+    s->expect_write(wm->size_);
     intrusive_list_t<write_buffer_t> *list = const_cast<write_message_t *>(wm)->unsafe_expose_buffers();
     for (write_buffer_t *p = list->head(); p; p = list->next(p)) {
         int64_t res = s->write(p->data, p->size);
@@ -85,6 +85,9 @@ public:
     write_stream_t() { }
     // Returns n, or -1 upon error. Blocks until all bytes are written.
     virtual MUST_USE int64_t write(const void *p, int64_t n) = 0;
+    // A hint that the next writes are going to add up to `n` bytes, so that streams
+    // that buffer everything can allocate the space at once.
+    virtual void expect_write(UNUSED int64_t n) { }
 protected:
     virtual ~write_stream_t() { }
 private:
@@ -111,13 +114,19 @@ private:
 // to a write_message_t, and then flush that to a write_stream_t.
 class write_message_t {
 public:
-    write_message_t() { }
-    explicit write_message_t(write_message_t &&) = default;
+    write_message_t() : size_(0) { }
+    explicit write_message_t(write_message_t &&movee)
+        : buffers_(std::move(movee.buffers_)), size_(movee.size_) {
+        movee.size_ = 0;
+    }
     ~write_message_t();
 
     void append(const void *p, int64_t n);
 
-    size_t size() const;
+    // Moves the buffers of `other` to the end of this message without copying them.
+    void append(write_message_t &&other);
+
+    size_t size() const { return size_; }
 
     intrusive_list_t<write_buffer_t> *unsafe_expose_buffers() { return &buffers_; }
 
@@ -125,6 +134,7 @@ private:
     friend int send_write_message(write_stream_t *s, const write_message_t *wm);
 
     intrusive_list_t<write_buffer_t> buffers_;
+    size_t size_;
 
     DISABLE_COPYING(write_message_t);
 };
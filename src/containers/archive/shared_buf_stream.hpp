@@ -0,0 +1,56 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_ARCHIVE_SHARED_BUF_STREAM_HPP_
+#define CONTAINERS_ARCHIVE_SHARED_BUF_STREAM_HPP_
+
+#include <string.h>
+
+#include <utility>
+
+#include "containers/archive/archive.hpp"
+#include "containers/shared_buffer.hpp"
+
+/* Reads from a `shared_buf_t`. Deserialization functions that know about this stream
+can refer to large parts of the buffer through a `shared_buf_ref_t` instead of
+copying them out of it. Note that such a reference keeps the whole buffer alive. */
+class shared_buf_read_stream_t : public read_stream_t {
+public:
+    explicit shared_buf_read_stream_t(counted_t<const shared_buf_t> &&buf,
+                                      size_t offset = 0)
+        : pos_(offset), buf_(std::move(buf)) {
+        guarantee(buf_.has());
+        guarantee(pos_ <= buf_->size());
+    }
+    virtual ~shared_buf_read_stream_t() { }
+
+    // Implemented in the header file for the same reason as
+    // `buffer_read_stream_t::read()`.
+    virtual MUST_USE int64_t read(void *p, int64_t n) {
+        int64_t num_left = buf_->size() - pos_;
+        int64_t num_to_read = n < num_left ? n : num_left;
+
+        memcpy(p, buf_->data(pos_), num_to_read);
+
+        pos_ += num_to_read;
+
+        return num_to_read;
+    }
+
+    size_t tell() const { return pos_; }
+    size_t remaining() const { return buf_->size() - pos_; }
+
+    const counted_t<const shared_buf_t> &get_buf() const { return buf_; }
+
+    // Skips over `n` bytes that the caller refers to through `get_buf()`.
+    void skip(size_t n) {
+        guarantee(n <= remaining());
+        pos_ += n;
+    }
+
+private:
+    size_t pos_;
+    counted_t<const shared_buf_t> buf_;
+
+    DISABLE_COPYING(shared_buf_read_stream_t);
+};
+
+#endif  // CONTAINERS_ARCHIVE_SHARED_BUF_STREAM_HPP_
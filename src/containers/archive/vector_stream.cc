@@ -14,6 +14,10 @@ int64_t vector_stream_t::write(const void *p, int64_t n) {
     return n;
 }
 
+void vector_stream_t::expect_write(int64_t n) {
+    vec_.reserve(vec_.size() + n);
+}
+
 void vector_stream_t::swap(std::vector<char> *other) {
     other->swap(vec_);
 }
@@ -0,0 +1,58 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "containers/arena.hpp"
+
+#include <stdlib.h>
+
+#include <cstddef>
+
+#include "config/args.hpp"
+#include "memory_utils.hpp"
+
+arena_t::arena_t()
+    : block_used(ARENA_BLOCK_SIZE), bytes_from_blocks_(0), bytes_from_heap_(0) { }
+
+arena_t::~arena_t() {
+    reset();
+    for (char *block : blocks) {
+        free(block);
+    }
+}
+
+void *arena_t::allocate(size_t size, size_t alignment) {
+    rassert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    rassert(alignment <= alignof(std::max_align_t));
+    if (size > ARENA_BLOCK_SIZE / 4) {
+        bytes_from_heap_ += size;
+        large_allocations.push_back(static_cast<char *>(rmalloc(size)));
+        return large_allocations.back();
+    }
+
+    size_t offset = (block_used + alignment - 1) & ~(alignment - 1);
+    if (offset + size > ARENA_BLOCK_SIZE) {
+        add_block();
+        offset = 0;
+    }
+    block_used = offset + size;
+    bytes_from_blocks_ += size;
+    return blocks.back() + offset;
+}
+
+void arena_t::reset() {
+    for (char *allocation : large_allocations) {
+        free(allocation);
+    }
+    large_allocations.clear();
+    while (blocks.size() > 1) {
+        free(blocks.back());
+        blocks.pop_back();
+    }
+    block_used = 0;
+    if (blocks.empty()) {
+        block_used = ARENA_BLOCK_SIZE;
+    }
+}
+
+void arena_t::add_block() {
+    // `rmalloc()` returns memory that is aligned for any type.
+    blocks.push_back(static_cast<char *>(rmalloc(ARENA_BLOCK_SIZE)));
+}
@@ -0,0 +1,85 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_ARENA_HPP_
+#define CONTAINERS_ARENA_HPP_
+
+#include <stddef.h>
+
+#include <new>
+#include <vector>
+
+#include "errors.hpp"
+
+/* An `arena_t` hands out memory from large blocks, and frees all of it at once when it
+gets reset or destroyed.  It is meant for scratch space whose lifetime is bounded
+anyway, such as the intermediate results of evaluating one batch of a query.  Nothing
+that outlives the arena may point into it.  Allocations that are too large for a block
+get their own allocation from the heap, and are counted separately. */
+class arena_t {
+public:
+    arena_t();
+    ~arena_t();
+
+    void *allocate(size_t size, size_t alignment);
+
+    // Frees everything that has been allocated, but keeps the first block around for
+    // the next allocations.
+    void reset();
+
+    // Bytes handed out from blocks and bytes that went straight to the heap, since
+    // the arena was created.
+    size_t bytes_from_blocks() const { return bytes_from_blocks_; }
+    size_t bytes_from_heap() const { return bytes_from_heap_; }
+
+private:
+    void add_block();
+
+    std::vector<char *> blocks;
+    std::vector<char *> large_allocations;
+    size_t block_used;
+    size_t bytes_from_blocks_;
+    size_t bytes_from_heap_;
+
+    DISABLE_COPYING(arena_t);
+};
+
+/* An allocator for standard containers that takes its memory from an `arena_t`, or from
+the heap if the arena is null.  `deallocate()` doesn't give memory back to the arena,
+so containers that grow a lot should reserve their size up front. */
+template <class T>
+class arena_allocator_t {
+public:
+    typedef T value_type;
+
+    explicit arena_allocator_t(arena_t *_arena) : arena(_arena) { }
+    template <class U>
+    arena_allocator_t(const arena_allocator_t<U> &other)  // NOLINT(runtime/explicit)
+        : arena(other.get_arena()) { }
+
+    T *allocate(size_t n) {
+        if (arena == nullptr) {
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *p, size_t) {
+        if (arena == nullptr) {
+            ::operator delete(p);
+        }
+    }
+
+    arena_t *get_arena() const { return arena; }
+
+    template <class U>
+    bool operator==(const arena_allocator_t<U> &other) const {
+        return arena == other.get_arena();
+    }
+    template <class U>
+    bool operator!=(const arena_allocator_t<U> &other) const {
+        return arena != other.get_arena();
+    }
+
+private:
+    arena_t *arena;
+};
+
+#endif  // CONTAINERS_ARENA_HPP_
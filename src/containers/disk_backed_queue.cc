@@ -1,116 +1,102 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "containers/disk_backed_queue.hpp"
 
+#include <algorithm>
+
+#include "arch/arch.hpp"
 #include "arch/io/disk.hpp"
-#include "buffer_cache/alt.hpp"
-#include "buffer_cache/blob.hpp"
-#include "buffer_cache/cache_balancer.hpp"
-#include "buffer_cache/serialize_onto_blob.hpp"
+#include "concurrency/cond_var.hpp"
 #include "serializer/log/log_serializer.hpp"
 
+/* The read of the chunk that follows the one that is being popped from. */
+class dbq_prefetch_t : public linux_iocallback_t {
+public:
+    dbq_prefetch_t(file_t *file, int64_t _offset,
+                   scoped_device_block_aligned_ptr_t<char> &&_buffer)
+        : offset(_offset), buffer(std::move(_buffer)) {
+        if (!buffer.has()) {
+            buffer = scoped_device_block_aligned_ptr_t<char>(DBQ_CHUNK_SIZE);
+        }
+        file->read_async(offset, DBQ_CHUNK_SIZE, buffer.get(), DEFAULT_DISK_ACCOUNT,
+                         this);
+    }
+
+    void on_io_complete() {
+        done.pulse();
+    }
+
+    const int64_t offset;
+    scoped_device_block_aligned_ptr_t<char> buffer;
+    cond_t done;
 
-#define DBQ_MAX_REF_SIZE 251
+private:
+    DISABLE_COPYING(dbq_prefetch_t);
+};
+
+class dbq_write_stream_t : public write_stream_t {
+public:
+    explicit dbq_write_stream_t(internal_disk_backed_queue_t *_parent)
+        : parent(_parent) { }
+
+    MUST_USE int64_t write(const void *p, int64_t n) {
+        parent->append(p, n);
+        return n;
+    }
+
+private:
+    internal_disk_backed_queue_t *parent;
+
+    DISABLE_COPYING(dbq_write_stream_t);
+};
 
 internal_disk_backed_queue_t::internal_disk_backed_queue_t(io_backender_t *io_backender,
                                                            const serializer_filepath_t &filename,
                                                            perfmon_collection_t *stats_parent)
     : perfmon_membership(stats_parent, &perfmon_collection,
                          filename.permanent_path().c_str()),
+      pm_memberships(&perfmon_collection,
+                     &pm_chunks_written, "chunks_written",
+                     &pm_chunks_read, "chunks_read",
+                     &pm_chunks_prefetched, "chunks_prefetched"),
       queue_size(0),
-      head_block_id(NULL_BLOCK_ID),
-      tail_block_id(NULL_BLOCK_ID),
-      file_opener(new filepath_file_opener_t(filename, io_backender)) {
-    log_serializer_t::create(file_opener.get(),
-                                  log_serializer_t::static_config_t());
-
-    serializer.init(new log_serializer_t(log_serializer_t::dynamic_config_t(),
-                                              file_opener.get(),
-                                              &perfmon_collection));
-
-    balancer.init(new dummy_cache_balancer_t(2 * MEGABYTE));
-    cache.init(new cache_t(serializer.get(), balancer.get(), &perfmon_collection));
-    cache_conn.init(new cache_conn_t(cache.get()));
-    // Emulate cache_t::create behavior by zeroing the block with id SUPERBLOCK_ID.
-    txn_t txn(cache_conn.get(), write_durability_t::HARD, 1);
-    {
-        buf_lock_t block(&txn, SUPERBLOCK_ID, alt_create_t::create);
-        buf_write_t write(&block);
-        const block_size_t block_size = cache->max_block_size();
-        void *buf = write.get_data_write(block_size.value());
-        memset(buf, 0, block_size.value());
-    }
-    txn.commit();
+      file_opener(new filepath_file_opener_t(filename, io_backender)),
+      written_size(0),
+      write_buffer(DBQ_CHUNK_SIZE),
+      write_buffer_size(0),
+      read_offset(0),
+      read_buffer_offset(-1) {
+    file_opener->open_serializer_file_create_temporary(&file);
 }
 
 internal_disk_backed_queue_t::~internal_disk_backed_queue_t() {
-    /* First destroy the serializer, then remove the temporary file.
-    This avoids issues with certain file systems (specifically VirtualBox
-    shared folders), see https://github.com/rethinkdb/rethinkdb/issues/3791. */
-    cache_conn.reset();
-    cache.reset();
-    balancer.reset();
-    serializer.reset();
+    wait_for_prefetch();
+
+    /* First close the file, then remove it.  This avoids issues with certain file
+    systems (specifically VirtualBox shared folders), see
+    https://github.com/rethinkdb/rethinkdb/issues/3791. */
+    file.reset();
 
     file_opener->unlink_serializer_file();
 }
 
 void internal_disk_backed_queue_t::push(const write_message_t &wm) {
     mutex_t::acq_t mutex_acq(&mutex);
-
-    // There's no need for hard durability with an unlinked dbq file.
-    txn_t txn(cache_conn.get(), write_durability_t::SOFT, 2);
-
-    push_single(&txn, wm);
-
-    txn.commit();
+    push_single(wm);
 }
 
 void internal_disk_backed_queue_t::push(const scoped_array_t<write_message_t> &wms) {
     mutex_t::acq_t mutex_acq(&mutex);
-
-    // There's no need for hard durability with an unlinked dbq file.
-    txn_t txn(cache_conn.get(), write_durability_t::SOFT, 2);
-
     for (size_t i = 0; i < wms.size(); ++i) {
-        push_single(&txn, wms[i]);
+        push_single(wms[i]);
     }
-
-    txn.commit();
 }
 
-void internal_disk_backed_queue_t::push_single(txn_t *txn, const write_message_t &wm) {
-    if (head_block_id == NULL_BLOCK_ID) {
-        add_block_to_head(txn);
-    }
-
-    auto _head = make_scoped<buf_lock_t>(buf_parent_t(txn), head_block_id,
-                                         access_t::write);
-    auto write = make_scoped<buf_write_t>(_head.get());
-    queue_block_t *head = static_cast<queue_block_t *>(write->get_data_write());
-
-    char buffer[DBQ_MAX_REF_SIZE];
-    memset(buffer, 0, DBQ_MAX_REF_SIZE);
-
-    blob_t blob(cache->max_block_size(), buffer, DBQ_MAX_REF_SIZE);
-
-    write_onto_blob(buf_parent_t(_head.get()), &blob, wm);
-
-    if (static_cast<size_t>((head->data + head->data_size) - reinterpret_cast<char *>(head)) + blob.refsize(cache->max_block_size()) > cache->max_block_size().value()) {
-        // The data won't fit in our current head block, so it's time to make a new one.
-        head = nullptr;
-        write.reset();
-        _head.reset();
-        add_block_to_head(txn);
-        _head.init(new buf_lock_t(buf_parent_t(txn), head_block_id,
-                                  access_t::write));
-        write.init(new buf_write_t(_head.get()));
-        head = static_cast<queue_block_t *>(write->get_data_write());
-    }
-
-    memcpy(head->data + head->data_size, buffer,
-           blob.refsize(cache->max_block_size()));
-    head->data_size += blob.refsize(cache->max_block_size());
-
+void internal_disk_backed_queue_t::push_single(const write_message_t &wm) {
+    const uint64_t record_size = wm.size();
+    append(&record_size, sizeof(record_size));
+    dbq_write_stream_t stream(this);
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
     queue_size++;
 }
 
@@ -118,61 +104,28 @@ void internal_disk_backed_queue_t::pop(buffer_group_viewer_t *viewer) {
     guarantee(size() != 0);
     mutex_t::acq_t mutex_acq(&mutex);
 
-    char buffer[DBQ_MAX_REF_SIZE];
-    // No need for hard durability with an unlinked dbq file.
-    txn_t txn(cache_conn.get(), write_durability_t::SOFT, 2);
-
-    buf_lock_t _tail(buf_parent_t(&txn), tail_block_id, access_t::write);
-
-    /* Grab the data from the blob and delete it. */
-    {
-        buf_read_t read(&_tail);
-        const queue_block_t *tail
-            = static_cast<const queue_block_t *>(read.get_data_read());
-        rassert(tail->data_size != tail->live_data_offset);
-        memcpy(buffer, tail->data + tail->live_data_offset,
-               blob::ref_size(cache->max_block_size(),
-                              tail->data + tail->live_data_offset,
-                              DBQ_MAX_REF_SIZE));
-    }
-
-    /* Grab the data from the blob and delete it. */
-
-    std::vector<char> data_vec;
-
-    blob_t blob(cache->max_block_size(), buffer, DBQ_MAX_REF_SIZE);
-    {
-        blob_acq_t acq_group;
-        buffer_group_t blob_group;
-        blob.expose_all(buf_parent_t(&_tail), access_t::read,
-                        &blob_group, &acq_group);
-
-        viewer->view_buffer_group(const_view(&blob_group));
-    }
-
-    int32_t data_size;
-    int32_t live_data_offset;
-    {
-        buf_write_t write(&_tail);
-        queue_block_t *tail = static_cast<queue_block_t *>(write.get_data_write());
-        /* Record how far along in the blob we are. */
-        tail->live_data_offset += blob.refsize(cache->max_block_size());
-        data_size = tail->data_size;
-        live_data_offset = tail->live_data_offset;
-    }
-
-    blob.clear(buf_parent_t(&_tail));
-
+    uint64_t record_size;
+    consume(&record_size, sizeof(record_size));
+    scoped_array_t<char> data(record_size);
+    consume(data.data(), record_size);
     queue_size--;
 
-    _tail.reset_buf_lock();
-
-    /* If that was the last blob in this block move on to the next one. */
-    if (live_data_offset == data_size) {
-        remove_block_from_tail(&txn);
+    if (queue_size == 0) {
+        // Nothing in the file is needed any more, so the stream can start over at its
+        // beginning.  We keep the write buffer for the next push, but not the ones
+        // for reading, since the queue may stay empty for a long time.
+        guarantee(read_offset == written_size + static_cast<int64_t>(write_buffer_size));
+        wait_for_prefetch();
+        read_buffer.reset();
+        read_buffer_offset = -1;
+        read_offset = 0;
+        written_size = 0;
+        write_buffer_size = 0;
     }
 
-    txn.commit();
+    const_buffer_group_t group;
+    group.add_buffer(record_size, data.data());
+    viewer->view_buffer_group(&group);
 }
 
 bool internal_disk_backed_queue_t::empty() {
@@ -183,46 +136,88 @@ int64_t internal_disk_backed_queue_t::size() {
     return queue_size;
 }
 
-void internal_disk_backed_queue_t::add_block_to_head(txn_t *txn) {
-    buf_lock_t _new_head(buf_parent_t(txn), alt_create_t::create);
-    buf_write_t write(&_new_head);
-    queue_block_t *new_head = static_cast<queue_block_t *>(write.get_data_write());
-    if (head_block_id == NULL_BLOCK_ID) {
-        rassert(tail_block_id == NULL_BLOCK_ID);
-        head_block_id = tail_block_id = _new_head.block_id();
-    } else {
-        buf_lock_t _old_head(buf_parent_t(txn), head_block_id,
-                             access_t::write);
-        buf_write_t old_write(&_old_head);
-        queue_block_t *old_head
-            = static_cast<queue_block_t *>(old_write.get_data_write());
-        rassert(old_head->next == NULL_BLOCK_ID);
-        old_head->next = _new_head.block_id();
-        head_block_id = _new_head.block_id();
+void internal_disk_backed_queue_t::append(const void *data, size_t size) {
+    const char *p = static_cast<const char *>(data);
+    while (size > 0) {
+        const size_t n = std::min<size_t>(size, DBQ_CHUNK_SIZE - write_buffer_size);
+        memcpy(write_buffer.get() + write_buffer_size, p, n);
+        write_buffer_size += n;
+        p += n;
+        size -= n;
+
+        if (write_buffer_size == DBQ_CHUNK_SIZE) {
+            file->set_file_size_at_least(written_size + DBQ_CHUNK_SIZE, DBQ_CHUNK_SIZE);
+            // There's no need for durability with a temporary file.
+            co_write(file.get(), written_size, DBQ_CHUNK_SIZE, write_buffer.get(),
+                     DEFAULT_DISK_ACCOUNT, file_t::NO_DATASYNCS);
+            ++pm_chunks_written;
+            written_size += DBQ_CHUNK_SIZE;
+            write_buffer_size = 0;
+        }
     }
-
-    new_head->next = NULL_BLOCK_ID;
-    new_head->data_size = 0;
-    new_head->live_data_offset = 0;
 }
 
-void internal_disk_backed_queue_t::remove_block_from_tail(txn_t *txn) {
-    rassert(tail_block_id != NULL_BLOCK_ID);
-    buf_lock_t _old_tail(buf_parent_t(txn), tail_block_id,
-                         access_t::write);
+void internal_disk_backed_queue_t::consume(void *data_out, size_t size) {
+    char *p = static_cast<char *>(data_out);
+    while (size > 0) {
+        const char *source;
+        size_t available;
+        if (read_offset >= written_size) {
+            const size_t offset_in_buffer = read_offset - written_size;
+            source = write_buffer.get() + offset_in_buffer;
+            available = write_buffer_size - offset_in_buffer;
+        } else {
+            const int64_t chunk_offset = read_offset - read_offset % DBQ_CHUNK_SIZE;
+            source = get_read_chunk(chunk_offset) + (read_offset - chunk_offset);
+            available = chunk_offset + DBQ_CHUNK_SIZE - read_offset;
+        }
+        guarantee(available > 0, "Disk backed queue ran out of data.");
 
-    {
-        buf_write_t old_write(&_old_tail);
-        queue_block_t *old_tail = static_cast<queue_block_t *>(old_write.get_data_write());
+        const size_t n = std::min(size, available);
+        memcpy(p, source, n);
+        read_offset += n;
+        p += n;
+        size -= n;
+    }
+}
 
-        if (old_tail->next == NULL_BLOCK_ID) {
-            rassert(head_block_id == _old_tail.block_id());
-            tail_block_id = head_block_id = NULL_BLOCK_ID;
+const char *internal_disk_backed_queue_t::get_read_chunk(int64_t offset) {
+    rassert(offset + DBQ_CHUNK_SIZE <= written_size);
+    // The old read buffer, if the prefetched chunk replaces it, is reused for the next
+    // prefetch.
+    scoped_device_block_aligned_ptr_t<char> spare_buffer;
+    if (read_buffer_offset != offset) {
+        if (prefetch.has() && prefetch->offset == offset) {
+            prefetch->done.wait_lazily_unordered();
+            spare_buffer = std::move(read_buffer);
+            read_buffer = std::move(prefetch->buffer);
+            prefetch.reset();
+            ++pm_chunks_prefetched;
         } else {
-            tail_block_id = old_tail->next;
+            wait_for_prefetch();
+            if (!read_buffer.has()) {
+                read_buffer = scoped_device_block_aligned_ptr_t<char>(DBQ_CHUNK_SIZE);
+            }
+            co_read(file.get(), offset, DBQ_CHUNK_SIZE, read_buffer.get(),
+                    DEFAULT_DISK_ACCOUNT);
+            ++pm_chunks_read;
         }
+        read_buffer_offset = offset;
     }
 
-    _old_tail.mark_deleted();
+    // Checked on every call, so that the read ahead also starts if the next chunk
+    // only got written after we got to this one.
+    const int64_t next_offset = offset + DBQ_CHUNK_SIZE;
+    if (!prefetch.has() && next_offset + DBQ_CHUNK_SIZE <= written_size) {
+        prefetch.init(new dbq_prefetch_t(file.get(), next_offset,
+                                         std::move(spare_buffer)));
+    }
+    return read_buffer.get();
 }
 
+void internal_disk_backed_queue_t::wait_for_prefetch() {
+    if (prefetch.has()) {
+        prefetch->done.wait_lazily_unordered();
+        prefetch.reset();
+    }
+}
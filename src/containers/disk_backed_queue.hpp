@@ -11,23 +11,16 @@
 #include "containers/archive/buffer_group_stream.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "containers/scoped.hpp"
-#include "perfmon/core.hpp"
+#include "perfmon/perfmon.hpp"
 #include "serializer/types.hpp"
 
-class cache_balancer_t;
-class cache_conn_t;
-class cache_t;
-class txn_t;
+class dbq_prefetch_t;
+class dbq_write_stream_t;
+class file_t;
 class io_backender_t;
 class perfmon_collection_t;
 class serializer_filepath_t;
 
-ATTR_PACKED(struct queue_block_t {
-    block_id_t next;
-    int32_t data_size, live_data_offset;
-    char data[0];
-});
-
 class value_acquisition_object_t;
 
 class buffer_group_viewer_t {
@@ -41,6 +34,13 @@ protected:
     DISABLE_COPYING(buffer_group_viewer_t);
 };
 
+/* The queue is one stream of records in a temporary file, each of which is its size
+as a `uint64_t` followed by the serialized value.  Pushes append to an in-memory chunk
+of `DBQ_CHUNK_SIZE` bytes that is written out in one piece once it's full, and pops
+read the file back a chunk at a time, starting to read the following chunk in the
+background as soon as they get to a new one.  Records that haven't been written out
+yet are popped straight from memory.  Nothing in the file is ever rewritten; the stream
+starts over at the beginning of the file whenever the queue runs empty. */
 class internal_disk_backed_queue_t {
 public:
     internal_disk_backed_queue_t(io_backender_t *io_backender, const serializer_filepath_t& filename, perfmon_collection_t *stats_parent);
@@ -56,29 +56,46 @@ public:
     int64_t size();
 
 private:
-    void add_block_to_head(txn_t *txn);
-    void remove_block_from_tail(txn_t *txn);
-    void push_single(txn_t *txn, const write_message_t &value);
+    friend class dbq_write_stream_t;
+
+    void push_single(const write_message_t &value);
+
+    // Appends to the stream, writing out the chunk whenever it fills up.
+    void append(const void *data, size_t size);
+    // Copies the next `size` bytes of the stream out and moves past them.
+    void consume(void *data_out, size_t size);
+
+    // Returns the chunk that starts at `offset`, which must have been written out,
+    // and makes sure that the one after it is being read if it has been written too.
+    const char *get_read_chunk(int64_t offset);
+    void wait_for_prefetch();
 
     mutex_t mutex;
 
-    // Serves more as sanity-checking for the cache than this type's ordering.
-    order_source_t cache_order_source;
     perfmon_collection_t perfmon_collection;
     perfmon_membership_t perfmon_membership;
+    perfmon_counter_t pm_chunks_written, pm_chunks_read, pm_chunks_prefetched;
+    perfmon_multi_membership_t pm_memberships;
 
     int64_t queue_size;
 
-    // The end we push onto.
-    block_id_t head_block_id;
-    // The end we pop from.
-    block_id_t tail_block_id;
-
     scoped_ptr_t<serializer_file_opener_t> file_opener;
-    scoped_ptr_t<log_serializer_t> serializer;
-    scoped_ptr_t<cache_balancer_t> balancer;
-    scoped_ptr_t<cache_t> cache;
-    scoped_ptr_t<cache_conn_t> cache_conn;
+    scoped_ptr_t<file_t> file;
+
+    // How much of the stream has been written to the file.  Always a multiple of
+    // `DBQ_CHUNK_SIZE`.
+    int64_t written_size;
+    // The rest of the stream, which is `write_buffer_size` bytes long.
+    scoped_device_block_aligned_ptr_t<char> write_buffer;
+    size_t write_buffer_size;
+
+    // Where the next record to pop starts.
+    int64_t read_offset;
+    // The chunk that starts at `read_buffer_offset`, if that isn't -1.
+    scoped_device_block_aligned_ptr_t<char> read_buffer;
+    int64_t read_buffer_offset;
+    // The read of the chunk after it, if one has been started.
+    scoped_ptr_t<dbq_prefetch_t> prefetch;
 
     DISABLE_COPYING(internal_disk_backed_queue_t);
 };
@@ -0,0 +1,152 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_PERSISTENT_VECTOR_HPP_
+#define CONTAINERS_PERSISTENT_VECTOR_HPP_
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "containers/counted.hpp"
+#include "errors.hpp"
+
+/* An immutable vector whose `push_back` returns a new vector and leaves the old one
+alone.  The two share everything but the path from the root to the last element, so
+`push_back` and `operator[]` take O(log n) time.  The elements live in the leaves of a
+trie with `WIDTH` children per node; the last up to `WIDTH` elements are kept in a
+separate tail leaf, so most pushes only copy that leaf.  The nodes are never modified
+once they're shared, so different threads may read the same vector at the same time,
+as long as `T` allows that. */
+template <class T>
+class persistent_vector_t {
+public:
+    persistent_vector_t() : size_(0), shift_(BITS) { }
+
+    // Builds the leaves straight from `values`, which is cheaper than pushing the
+    // values one at a time.
+    explicit persistent_vector_t(std::vector<T> &&values) : size_(0), shift_(BITS) {
+        for (size_t begin = 0; begin < values.size(); begin += WIDTH) {
+            if (size_ > 0) {
+                move_tail_into_trie();
+            }
+            const size_t end = std::min(values.size(), begin + WIDTH);
+            counted_t<node_t> leaf = make_counted<node_t>();
+            leaf->values.assign(std::make_move_iterator(values.begin() + begin),
+                                std::make_move_iterator(values.begin() + end));
+            tail_ = std::move(leaf);
+            size_ = end;
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const T &operator[](size_t index) const {
+        rassert(index < size_);
+        if (index >= tail_offset()) {
+            return tail_->values[index & MASK];
+        }
+        const node_t *node = root_.get();
+        for (size_t level = shift_; level > 0; level -= BITS) {
+            node = node->children[(index >> level) & MASK].get();
+        }
+        return node->values[index & MASK];
+    }
+
+    persistent_vector_t push_back(T value) const {
+        persistent_vector_t res(*this);
+        if (size_ - tail_offset() < WIDTH) {
+            // There's still room in the tail.
+            counted_t<node_t> tail = make_counted<node_t>();
+            if (tail_.has()) {
+                tail->values.reserve(tail_->values.size() + 1);
+                tail->values.insert(tail->values.end(),
+                                    tail_->values.begin(), tail_->values.end());
+            }
+            tail->values.push_back(std::move(value));
+            res.tail_ = std::move(tail);
+            ++res.size_;
+            return res;
+        }
+
+        res.move_tail_into_trie();
+        counted_t<node_t> tail = make_counted<node_t>();
+        tail->values.push_back(std::move(value));
+        res.tail_ = std::move(tail);
+        ++res.size_;
+        return res;
+    }
+
+private:
+    static const size_t BITS = 5;
+    static const size_t WIDTH = 1 << BITS;
+    static const size_t MASK = WIDTH - 1;
+
+    // Inner nodes only have `children` and leaves only have `values`.
+    struct node_t : public slow_atomic_countable_t<node_t> {
+        std::vector<counted_t<const node_t> > children;
+        std::vector<T> values;
+    };
+
+    // The index of the first element in the tail
+    size_t tail_offset() const {
+        return size_ < WIDTH ? 0 : ((size_ - 1) >> BITS) << BITS;
+    }
+
+    // Moves the full tail into the trie, which may have to grow a level.  Leaves
+    // `tail_` alone.
+    void move_tail_into_trie() {
+        if ((size_ >> BITS) > (static_cast<size_t>(1) << shift_)) {
+            counted_t<node_t> root = make_counted<node_t>();
+            root->children.push_back(root_);
+            root->children.push_back(new_path(shift_, tail_));
+            root_ = counted_t<const node_t>(std::move(root));
+            shift_ += BITS;
+        } else {
+            root_ = push_tail(shift_, root_.get(), tail_);
+        }
+    }
+
+    // Returns a chain of nodes from `level` down to `leaf`.
+    static counted_t<const node_t> new_path(size_t level,
+                                            const counted_t<const node_t> &leaf) {
+        if (level == 0) {
+            return leaf;
+        }
+        counted_t<node_t> node = make_counted<node_t>();
+        node->children.push_back(new_path(level - BITS, leaf));
+        return counted_t<const node_t>(std::move(node));
+    }
+
+    // Returns a copy of `parent` (which is null if the trie is empty) with `tail`
+    // added as the rightmost leaf below it.
+    counted_t<const node_t> push_tail(size_t level, const node_t *parent,
+                                      const counted_t<const node_t> &tail) const {
+        const size_t subindex = ((size_ - 1) >> level) & MASK;
+        counted_t<node_t> node = make_counted<node_t>();
+        if (parent != nullptr) {
+            node->children = parent->children;
+        }
+        counted_t<const node_t> child;
+        if (level == BITS) {
+            child = tail;
+        } else if (subindex < node->children.size()) {
+            child = push_tail(level - BITS, node->children[subindex].get(), tail);
+        } else {
+            child = new_path(level - BITS, tail);
+        }
+        if (subindex < node->children.size()) {
+            node->children[subindex] = std::move(child);
+        } else {
+            node->children.push_back(std::move(child));
+        }
+        return counted_t<const node_t>(std::move(node));
+    }
+
+    size_t size_;
+    // The number of index bits that the levels of the trie above the leaves use
+    size_t shift_;
+    counted_t<const node_t> root_;
+    counted_t<const node_t> tail_;
+};
+
+#endif  // CONTAINERS_PERSISTENT_VECTOR_HPP_
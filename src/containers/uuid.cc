@@ -14,6 +14,7 @@
 #include "containers/name_string.hpp"
 #include "utils.hpp"
 #include "thread_local.hpp"
+#include "time.hpp"
 
 // We keep the sha1 functions in this .cc file to avoid encouraging others from using it.
 namespace sha1 {
@@ -124,6 +125,18 @@ uuid_u generate_uuid() {
     return result;
 }
 
+uuid_u generate_time_ordered_uuid() {
+    uuid_u result = generate_uuid();
+    uint8_t *data = result.data();
+    const uint64_t ms = current_microtime() / 1000;
+    for (size_t i = 1; i <= 5; ++i) {
+        data[i] = static_cast<uint8_t>(ms >> (8 * (5 - i)));
+    }
+    // Set the version to 7.  `generate_uuid()` has already set the variant bits.
+    data[6] = ((data[6] & 0x0f) | 0x70);
+    return result;
+}
+
 uuid_u nil_uuid() {
     uuid_u ret;
     memset(ret.data(), 0, uuid_u::static_size());
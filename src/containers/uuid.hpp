@@ -46,6 +46,13 @@ bool operator<(const uuid_u& x, const uuid_u& y);
 Valgrind won't complain about it. */
 uuid_u generate_uuid();
 
+/* Like `generate_uuid()`, but UUIDs that are generated later sort after the earlier
+ones, like version 7 UUIDs, so that they end up close together as keys in a btree.
+The first byte (which is what the default split points of a table go by) is still
+random, so that inserts are spread across all of a table's shards.  After that come
+the lower 40 bits of the time in milliseconds, and the remaining bits are random. */
+uuid_u generate_time_ordered_uuid();
+
 // Returns boost::uuids::nil_generator()().
 uuid_u nil_uuid();
 
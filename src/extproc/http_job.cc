@@ -10,9 +10,14 @@
 #include <curl/curl.h>
 
 #include <limits>
+#include <map>
+#include <vector>
 
+#include "config/args.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "containers/archive/string_stream.hpp"
+#include "containers/scoped.hpp"
 #include "extproc/extproc_job.hpp"
 #include "http/http_parser.hpp"
 #include "rapidjson/document.h"
@@ -43,6 +48,9 @@ void jsonp_to_datum(const std::string &jsonp,
 void perform_http(http_opts_t *opts,
                   http_result_t *res_out);
 
+void perform_http_batch(std::vector<http_opts_t> *opts,
+                        std::vector<http_result_t> *results_out);
+
 class curl_exc_t : public std::exception {
 public:
     explicit curl_exc_t(std::string err_msg) :
@@ -54,14 +62,28 @@ public:
     const std::string error_string;
 };
 
-class scoped_curl_handle_t {
+// Worker processes are reused across requests, so each one keeps its easy handles
+// around instead of creating new ones per request.  The handles hold on to libcurl's
+// connection cache, so requests to the same host can reuse a kept-alive connection
+// (and its TLS session) rather than going through a new handshake.  All options are
+// reset when a handle is taken from the pool, and `set_default_opts` clears the
+// cookies, so nothing else carries over from one request to the next.
+class pooled_curl_handle_t {
 public:
-    scoped_curl_handle_t() :
-        curl_handle(curl_easy_init()) {
+    pooled_curl_handle_t() {
+        if (idle_handles.empty()) {
+            curl_handle = curl_easy_init();
+        } else {
+            curl_handle = idle_handles.back();
+            idle_handles.pop_back();
+            curl_easy_reset(curl_handle);
+        }
     }
 
-    ~scoped_curl_handle_t() {
-        curl_easy_cleanup(curl_handle);
+    ~pooled_curl_handle_t() {
+        if (curl_handle != nullptr) {
+            idle_handles.push_back(curl_handle);
+        }
     }
 
     CURL *get() {
@@ -69,8 +91,23 @@ public:
     }
 
 private:
+    static std::vector<CURL *> idle_handles;
+
     CURL *curl_handle;
+
+    DISABLE_COPYING(pooled_curl_handle_t);
 };
+std::vector<CURL *> pooled_curl_handle_t::idle_handles;
+
+// The multi handle used for batches.  Like the easy handles, it lives as long as the
+// worker process, because the connections of the requests it runs are kept in it.
+CURLM *get_curl_multi_handle() {
+    static CURLM *multi_handle = nullptr;
+    if (multi_handle == nullptr) {
+        multi_handle = curl_multi_init();
+    }
+    return multi_handle;
+}
 
 // Used for adding headers, which cannot be freed until after the request is done
 class scoped_curl_slist_t {
@@ -183,23 +220,57 @@ size_t curl_data_t::read_internal(char *ptr, size_t size) {
 http_job_t::http_job_t(extproc_pool_t *pool, signal_t *interruptor) :
     extproc_job(pool, &worker_fn, interruptor) { }
 
+// A job sends the number of requests, followed by the requests, and gets back as
+// many results in the same order.
 void http_job_t::http(const http_opts_t &opts,
                       http_result_t *res_out) {
     write_message_t msg;
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, static_cast<uint64_t>(1));
     serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts);
-    {
-        int res = send_write_message(extproc_job.write_stream(), &msg);
-        if (res != 0) {
-            throw extproc_worker_exc_t("failed to send data to the worker");
-        }
+    send_requests(&msg);
+    receive_results(1, res_out);
+}
+
+void http_job_t::http_batch(const std::vector<const std::string *> &serialized_opts,
+                            std::vector<http_result_t> *results_out) {
+    guarantee(serialized_opts.size() <= HTTP_BATCH_MAX_REQUESTS);
+    write_message_t msg;
+    serialize<cluster_version_t::LATEST_OVERALL>(
+        &msg, static_cast<uint64_t>(serialized_opts.size()));
+    for (const std::string *opts : serialized_opts) {
+        msg.append(opts->data(), opts->size());
     }
+    send_requests(&msg);
+    results_out->resize(serialized_opts.size());
+    receive_results(serialized_opts.size(), results_out->data());
+}
 
-    archive_result_t res
-        = deserialize<cluster_version_t::LATEST_OVERALL>(extproc_job.read_stream(),
-                                                         res_out);
-    if (bad(res)) {
-        throw extproc_worker_exc_t(strprintf("failed to deserialize result from worker "
-                                             "(%s)", archive_result_as_str(res)));
+std::string http_job_t::serialize_opts(const http_opts_t &opts) {
+    write_message_t msg;
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts);
+    string_stream_t stream;
+    int res = send_write_message(&stream, &msg);
+    guarantee(res == 0);
+    return std::move(stream.str());
+}
+
+void http_job_t::send_requests(const write_message_t *msg) {
+    int res = send_write_message(extproc_job.write_stream(), msg);
+    if (res != 0) {
+        throw extproc_worker_exc_t("failed to send data to the worker");
+    }
+}
+
+void http_job_t::receive_results(size_t count, http_result_t *results_out) {
+    for (size_t i = 0; i < count; ++i) {
+        archive_result_t res
+            = deserialize<cluster_version_t::LATEST_OVERALL>(extproc_job.read_stream(),
+                                                             &results_out[i]);
+        if (bad(res)) {
+            throw extproc_worker_exc_t(
+                strprintf("failed to deserialize result from worker (%s)",
+                          archive_result_as_str(res)));
+        }
     }
 }
 
@@ -209,16 +280,24 @@ void http_job_t::worker_error() {
 
 bool http_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out) {
     static bool curl_initialized(false);
-    http_opts_t opts;
+    uint64_t count;
     {
         archive_result_t res
-            = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &opts);
+            = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &count);
+        if (bad(res) || count == 0 || count > HTTP_BATCH_MAX_REQUESTS) { return false; }
+    }
+    std::vector<http_opts_t> opts(count);
+    for (http_opts_t &request_opts : opts) {
+        archive_result_t res
+            = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &request_opts);
         if (bad(res)) { return false; }
     }
 
-    http_result_t result;
-    result.header = ql::datum_t::null();
-    result.body = ql::datum_t::null();
+    std::vector<http_result_t> results(count);
+    for (http_result_t &result : results) {
+        result.header = ql::datum_t::null();
+        result.body = ql::datum_t::null();
+    }
 
     CURLcode curl_res = CURLE_OK;
     if (!curl_initialized) {
@@ -228,19 +307,31 @@ bool http_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out)
 
     if (curl_res == CURLE_OK) {
         try {
-            perform_http(&opts, &result);
+            if (count == 1) {
+                perform_http(&opts[0], &results[0]);
+            } else {
+                perform_http_batch(&opts, &results);
+            }
         } catch (const std::exception &ex) {
-            result.error.assign(ex.what());
+            for (http_result_t &result : results) {
+                result.error.assign(ex.what());
+            }
         } catch (...) {
-            result.error.assign("unknown error");
+            for (http_result_t &result : results) {
+                result.error.assign("unknown error");
+            }
         }
     } else {
-        result.error.assign("global initialization");
+        for (http_result_t &result : results) {
+            result.error.assign("global initialization");
+        }
         curl_initialized = false;
     }
 
     write_message_t msg;
-    serialize<cluster_version_t::LATEST_OVERALL>(&msg, result);
+    for (const http_result_t &result : results) {
+        serialize<cluster_version_t::LATEST_OVERALL>(&msg, result);
+    }
     int res = send_write_message(stream_out, &msg);
     if (res != 0) { return false; }
 
@@ -534,59 +625,58 @@ void set_default_opts(CURL *curl_handle,
     // Enable cookies - needed for multiple requests like redirects or digest auth
     exc_setopt(curl_handle, CURLOPT_COOKIEFILE, "", "COOKIEFILE");
 
+    // `curl_easy_reset` keeps the cookies of the previous request on the pooled
+    // handle, and those must not leak into this one.
+    exc_setopt(curl_handle, CURLOPT_COOKIELIST, "ALL", "COOKIELIST");
+
     // Use the proxy set when launched
     if (!proxy.empty()) {
         exc_setopt(curl_handle, CURLOPT_PROXY, proxy.c_str(), "PROXY");
     }
 }
 
-// TODO: implement streaming API support
-void perform_http(http_opts_t *opts, http_result_t *res_out) {
-    scoped_curl_handle_t curl_handle;
-    curl_data_t curl_data;
-
-    if (curl_handle.get() == nullptr) {
-        res_out->error.assign("initialization");
-        return;
+enum class attempt_result_t { DONE, RETRY, FAILED };
+
+// Checks the outcome of one attempt at performing a request.  On `FAILED`, the error
+// has been put in `res_out`.  On `DONE`, or once the request has run out of attempts,
+// the response should be read with `handle_response`.
+attempt_result_t check_attempt(CURL *curl_handle,
+                               CURLcode *curl_res,
+                               long *response_code_out, // NOLINT(runtime/int)
+                               http_result_t *res_out) {
+    if (*curl_res == CURLE_SEND_ERROR ||
+        *curl_res == CURLE_RECV_ERROR ||
+        *curl_res == CURLE_COULDNT_CONNECT) {
+        // Could be a temporary error, try again
+        return attempt_result_t::RETRY;
+    } else if (*curl_res != CURLE_OK) {
+        res_out->error.assign(curl_easy_strerror(*curl_res));
+        return attempt_result_t::FAILED;
     }
 
-    set_default_opts(curl_handle.get(), opts->proxy, curl_data);
-    transfer_opts(opts, curl_handle.get(), &curl_data);
-
-    CURLcode curl_res = CURLE_OK;
-    long response_code = 0; // NOLINT(runtime/int)
-    for (uint64_t attempts = 0; attempts < opts->attempts; ++attempts) {
-        // Do the HTTP operation, then check for errors
-        curl_res = curl_easy_perform(curl_handle.get());
-
-        if (curl_res == CURLE_SEND_ERROR ||
-            curl_res == CURLE_RECV_ERROR ||
-            curl_res == CURLE_COULDNT_CONNECT) {
-            // Could be a temporary error, try again
-            continue;
-        } else if (curl_res != CURLE_OK) {
-            res_out->error.assign(curl_easy_strerror(curl_res));
-            return;
-        }
-
-        curl_res = curl_easy_getinfo(curl_handle.get(),
-                                     CURLINFO_RESPONSE_CODE,
-                                     &response_code);
-
-        // Break on success, retry on temporary error
-        if (curl_res != CURLE_OK ||
-            // Error codes that may be resolved by retrying
-            (response_code != 408 &&
-             response_code != 500 &&
-             response_code != 502 &&
-             response_code != 503 &&
-             response_code != 504)) {
-            break;
-        }
+    *curl_res = curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, response_code_out);
+
+    // Break on success, retry on temporary error
+    if (*curl_res != CURLE_OK ||
+        // Error codes that may be resolved by retrying
+        (*response_code_out != 408 &&
+         *response_code_out != 500 &&
+         *response_code_out != 502 &&
+         *response_code_out != 503 &&
+         *response_code_out != 504)) {
+        return attempt_result_t::DONE;
     }
+    return attempt_result_t::RETRY;
+}
 
-    std::string body_data(curl_data.steal_body_data());
-    std::string header_data(curl_data.steal_header_data());
+void handle_response(http_opts_t *opts,
+                     CURL *curl_handle,
+                     curl_data_t *curl_data,
+                     CURLcode curl_res,
+                     long response_code, // NOLINT(runtime/int)
+                     http_result_t *res_out) {
+    std::string body_data(curl_data->steal_body_data());
+    std::string header_data(curl_data->steal_header_data());
     truncate_header_data(&header_data);
 
     if (opts->attempts == 0) {
@@ -610,7 +700,7 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
         res_out->error = strprintf("status code %ld", response_code);
     } else {
         parse_header(header_data, res_out);
-        save_cookies(curl_handle.get(), res_out);
+        save_cookies(curl_handle, res_out);
 
         // If this was a HEAD request, we should not be handling data, just return R_NULL
         // so the user knows the request succeeded
@@ -626,7 +716,7 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
             {
                 std::string content_type;
                 char *content_type_buffer = nullptr;
-                curl_easy_getinfo(curl_handle.get(),
+                curl_easy_getinfo(curl_handle,
                                   CURLINFO_CONTENT_TYPE,
                                   &content_type_buffer);
 
@@ -690,6 +780,162 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
     }
 }
 
+// TODO: implement streaming API support
+void perform_http(http_opts_t *opts, http_result_t *res_out) {
+    pooled_curl_handle_t curl_handle;
+    curl_data_t curl_data;
+
+    if (curl_handle.get() == nullptr) {
+        res_out->error.assign("initialization");
+        return;
+    }
+
+    set_default_opts(curl_handle.get(), opts->proxy, curl_data);
+    transfer_opts(opts, curl_handle.get(), &curl_data);
+
+    CURLcode curl_res = CURLE_OK;
+    long response_code = 0; // NOLINT(runtime/int)
+    for (uint64_t attempts = 0; attempts < opts->attempts; ++attempts) {
+        // Do the HTTP operation, then check for errors
+        curl_res = curl_easy_perform(curl_handle.get());
+        attempt_result_t result =
+            check_attempt(curl_handle.get(), &curl_res, &response_code, res_out);
+        if (result == attempt_result_t::FAILED) {
+            return;
+        } else if (result == attempt_result_t::DONE) {
+            break;
+        }
+    }
+
+    handle_response(opts, curl_handle.get(), &curl_data, curl_res, response_code,
+                    res_out);
+}
+
+// One of the requests in `perform_http_batch`.
+struct batch_request_t {
+    batch_request_t() :
+        curl_res(CURLE_OK), response_code(0), attempts(0), in_multi(false) { }
+
+    pooled_curl_handle_t curl_handle;
+    curl_data_t curl_data;
+    CURLcode curl_res;
+    long response_code; // NOLINT(runtime/int)
+    uint64_t attempts;
+    bool in_multi;
+};
+
+// Performs all the requests in parallel on the multi handle.  Each request gets the
+// same retries as in `perform_http`, but its timeout is enforced by libcurl, since the
+// job as a whole can only be timed out by the main process once the slowest request
+// of the batch is overdue.
+void perform_http_batch(std::vector<http_opts_t> *opts,
+                        std::vector<http_result_t> *results_out) {
+    CURLM *multi_handle = get_curl_multi_handle();
+    if (multi_handle == nullptr) {
+        for (http_result_t &result : *results_out) {
+            result.error.assign("initialization");
+        }
+        return;
+    }
+
+    std::vector<scoped_ptr_t<batch_request_t> > requests(opts->size());
+    std::map<CURL *, size_t> request_indexes;
+    size_t num_running = 0;
+    for (size_t i = 0; i < opts->size(); ++i) {
+        requests[i].init(new batch_request_t());
+        batch_request_t *request = requests[i].get();
+        CURL *curl_handle = request->curl_handle.get();
+        if (curl_handle == nullptr) {
+            (*results_out)[i].error.assign("initialization");
+            continue;
+        }
+        try {
+            set_default_opts(curl_handle, (*opts)[i].proxy, request->curl_data);
+            transfer_opts(&(*opts)[i], curl_handle, &request->curl_data);
+            long timeout_ms = (*opts)[i].timeout_ms; // NOLINT(runtime/int)
+            exc_setopt(curl_handle, CURLOPT_TIMEOUT_MS, timeout_ms, "TIMEOUT");
+            if ((*opts)[i].attempts == 0) {
+                handle_response(&(*opts)[i], curl_handle, &request->curl_data,
+                                CURLE_OK, 0, &(*results_out)[i]);
+                continue;
+            }
+        } catch (const std::exception &ex) {
+            (*results_out)[i].error.assign(ex.what());
+            continue;
+        }
+        if (curl_multi_add_handle(multi_handle, curl_handle) != CURLM_OK) {
+            (*results_out)[i].error.assign("initialization");
+            continue;
+        }
+        request->in_multi = true;
+        request_indexes[curl_handle] = i;
+        ++num_running;
+    }
+
+    while (num_running > 0) {
+        int still_running;
+        CURLMcode multi_res = curl_multi_perform(multi_handle, &still_running);
+        if (multi_res != CURLM_OK) {
+            for (size_t i = 0; i < requests.size(); ++i) {
+                if (requests[i]->in_multi) {
+                    curl_multi_remove_handle(multi_handle,
+                                             requests[i]->curl_handle.get());
+                    requests[i]->in_multi = false;
+                    (*results_out)[i].error.assign(curl_multi_strerror(multi_res));
+                }
+            }
+            break;
+        }
+
+        int messages_left;
+        while (CURLMsg *message = curl_multi_info_read(multi_handle, &messages_left)) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+            CURL *curl_handle = message->easy_handle;
+            const CURLcode transfer_res = message->data.result;
+            // This invalidates `message`.
+            curl_multi_remove_handle(multi_handle, curl_handle);
+
+            const size_t i = request_indexes.at(curl_handle);
+            batch_request_t *request = requests[i].get();
+            http_result_t *result = &(*results_out)[i];
+            request->in_multi = false;
+            request->curl_res = transfer_res;
+            ++request->attempts;
+
+            if (request->curl_res == CURLE_OPERATION_TIMEDOUT) {
+                result->error = http_timeout_error((*opts)[i].timeout_ms);
+                --num_running;
+                continue;
+            }
+
+            attempt_result_t attempt_result = check_attempt(
+                curl_handle, &request->curl_res, &request->response_code, result);
+            if (attempt_result == attempt_result_t::RETRY &&
+                request->attempts < (*opts)[i].attempts &&
+                curl_multi_add_handle(multi_handle, curl_handle) == CURLM_OK) {
+                request->in_multi = true;
+                continue;
+            }
+
+            --num_running;
+            if (attempt_result != attempt_result_t::FAILED) {
+                try {
+                    handle_response(&(*opts)[i], curl_handle, &request->curl_data,
+                                    request->curl_res, request->response_code, result);
+                } catch (const std::exception &ex) {
+                    result->error.assign(ex.what());
+                }
+            }
+        }
+
+        if (num_running > 0) {
+            curl_multi_wait(multi_handle, nullptr, 0, 1000, nullptr);
+        }
+    }
+}
+
 class header_parser_singleton_t {
 public:
     static ql::datum_t parse(const std::string &header);
@@ -865,17 +1111,19 @@ void save_cookies(CURL *curl_handle, http_result_t *res_out) {
 
 void json_to_datum(const std::string &json,
                    const ql::configured_limits_t &limits,
-                   reql_version_t reql_version,
+                   UNUSED reql_version_t reql_version,
                    attach_json_to_error_t attach_json,
                    http_result_t *res_out) {
-    rapidjson::Document doc;
-    doc.Parse(json.c_str());
-    if (!doc.HasParseError()) {
-        res_out->body = ql::to_datum(doc, limits, reql_version);
+    // `parse_json_to_datum` parses in situ, so it needs a copy that it can modify.
+    std::vector<char> json_buf(json.c_str(), json.c_str() + json.size() + 1);
+    ql::datum_t body;
+    rapidjson::ParseErrorCode error;
+    if (ql::parse_json_to_datum(json_buf.data(), limits, &body, &error)) {
+        res_out->body = std::move(body);
     } else {
         res_out->error.assign(
             strprintf("failed to parse JSON response: %s",
-                      rapidjson::GetParseError_En(doc.GetParseError())));
+                      rapidjson::GetParseError_En(error)));
         if (attach_json == attach_json_to_error_t::YES) {
             res_out->body = ql::datum_t(datum_string_t(json));
         }
@@ -2,6 +2,9 @@
 #ifndef EXTPROC_HTTP_JOB_HPP_
 #define EXTPROC_HTTP_JOB_HPP_
 
+#include <string>
+#include <vector>
+
 #include "errors.hpp"
 
 #include "extproc/extproc_pool.hpp"
@@ -16,10 +19,20 @@ public:
 
     void http(const http_opts_t &opts, http_result_t *res_out);
 
+    // Runs several requests in parallel, `serialized_opts` being the results of
+    // `serialize_opts`.  The results are in the same order.
+    void http_batch(const std::vector<const std::string *> &serialized_opts,
+                    std::vector<http_result_t> *results_out);
+
+    static std::string serialize_opts(const http_opts_t &opts);
+
     // Marks the extproc worker as errored to simplify cleanup later
     void worker_error();
 
 private:
+    void send_requests(const write_message_t *msg);
+    void receive_results(size_t count, http_result_t *results_out);
+
     static bool worker_fn(read_stream_t *stream_in, write_stream_t *stream_out);
 
     extproc_job_t extproc_job;
@@ -1,17 +1,29 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "extproc/http_runner.hpp"
 
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
 #include "extproc/http_job.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "containers/lru_cache.hpp"
+#include "arch/runtime/coroutines.hpp"
 #include "arch/timing.hpp"
+#include "config/args.hpp"
+#include "perfmon/perfmon.hpp"
 #include "protocol_api.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "thread_local.hpp"
 
 RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(http_result_t, header, body, cookies, error);
 RDB_IMPL_SERIALIZABLE_3_SINCE_v1_13(http_opts_t::http_auth_t, type, username, password);
-RDB_IMPL_SERIALIZABLE_16(http_opts_t,
+RDB_IMPL_SERIALIZABLE_17(http_opts_t,
                          auth, method, result_format, url, proxy, url_params,
                          header, cookies, data, form_data, limits, version, timeout_ms,
-                         attempts, max_redirects, verify);
+                         attempts, max_redirects, verify, cache);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(http_opts_t);
 
 std::string http_method_to_str(http_method_t method) {
@@ -42,7 +54,8 @@ http_opts_t::http_opts_t() :
     timeout_ms(30000),
     attempts(5),
     max_redirects(1),
-    verify(true) { }
+    verify(true),
+    cache(false) { }
 
 http_opts_t::http_auth_t::http_auth_t() :
     type(http_auth_type_t::NONE),
@@ -68,17 +81,295 @@ void http_opts_t::http_auth_t::make_digest_auth(std::string &&user,
     password.assign(std::move(pass));
 }
 
-http_runner_t::http_runner_t(extproc_pool_t *_pool) :
-    pool(_pool) { }
+static perfmon_thread_counter_t pm_http_cache_hits, pm_http_cache_misses;
+static perfmon_multi_membership_t pm_http_cache_membership(
+    &get_global_perfmon_collection(),
+    &pm_http_cache_hits, "http_cache_hits",
+    &pm_http_cache_misses, "http_cache_misses");
+
+struct http_cache_entry_t {
+    http_result_t result;
+    ticks_t expires;
+};
+
+typedef lru_cache_t<std::string, http_cache_entry_t> http_response_cache_t;
+
+// The cached results hold datums, which can't be shared between threads, so every
+// thread has its own cache.  It is created on first use and never freed.
+TLS_with_init(http_response_cache_t *, http_response_cache, nullptr);
+
+http_response_cache_t *get_http_response_cache() {
+    http_response_cache_t *cache = TLS_get_http_response_cache();
+    if (cache == nullptr) {
+        cache = new http_response_cache_t(HTTP_RESPONSE_CACHE_MAX_ENTRIES);
+        TLS_set_http_response_cache(cache);
+    }
+    return cache;
+}
+
+std::string lowercase(std::string str) {
+    for (size_t i = 0; i < str.length(); ++i) {
+        str[i] = tolower(str[i]);
+    }
+    return str;
+}
+
+// Returns the cache key for the request, or an empty string if the request may not
+// be cached.  Responses to requests with credentials or cookies could be specific to
+// the user, so those are never cached.
+std::string http_cache_key(const http_opts_t &opts) {
+    if (!opts.cache ||
+        opts.method != http_method_t::GET ||
+        opts.auth.type != http_auth_type_t::NONE ||
+        !opts.data.empty() ||
+        !opts.form_data.empty() ||
+        !opts.cookies.empty()) {
+        return std::string();
+    }
+
+    std::string key = strprintf("%d %d %" PRIu32 " %zu %s\n",
+                                static_cast<int>(opts.result_format),
+                                opts.verify ? 1 : 0,
+                                opts.max_redirects,
+                                opts.limits.array_size_limit(),
+                                opts.url.c_str());
+    key += opts.url_params.print();
+    for (const std::string &line : opts.header) {
+        // A `Cache-Control: no-cache` request header asks for a fresh response.
+        std::string lower_line = lowercase(line);
+        if (lower_line.find("cache-control:") == 0 &&
+            lower_line.find("no-cache") != std::string::npos) {
+            return std::string();
+        }
+        key += "\n" + line;
+    }
+    return key;
+}
+
+// Returns how many seconds the response may be served from a shared cache, according
+// to its `Cache-Control` and `Age` headers, or 0 if it may not be cached at all.
+int64_t http_cache_lifetime_secs(const http_result_t &res) {
+    if (!res.error.empty() || !res.cookies.empty() || !res.header.has() ||
+        res.header.get_type() != ql::datum_t::R_OBJECT) {
+        return 0;
+    }
+    ql::datum_t cache_control = res.header.get_field("cache-control", ql::NOTHROW);
+    if (!cache_control.has() || cache_control.get_type() != ql::datum_t::R_STR) {
+        return 0;
+    }
+
+    int64_t max_age = -1;
+    int64_t s_maxage = -1;
+    const std::string directives = lowercase(cache_control.as_str().to_std());
+    size_t start = 0;
+    while (start < directives.length()) {
+        size_t end = directives.find(',', start);
+        if (end == std::string::npos) {
+            end = directives.length();
+        }
+        std::string directive = directives.substr(start, end - start);
+        start = end + 1;
+
+        const size_t first = directive.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            continue;
+        }
+        directive = directive.substr(first, directive.find_last_not_of(" \t") + 1 - first);
+
+        if (directive == "no-store" || directive == "no-cache" ||
+            directive == "private" || directive.find("no-cache=") == 0 ||
+            directive.find("private=") == 0) {
+            return 0;
+        } else if (directive.find("max-age=") == 0) {
+            max_age = strtoll(directive.c_str() + strlen("max-age="), nullptr, 10);
+        } else if (directive.find("s-maxage=") == 0) {
+            s_maxage = strtoll(directive.c_str() + strlen("s-maxage="), nullptr, 10);
+        }
+    }
+
+    int64_t lifetime = s_maxage >= 0 ? s_maxage : max_age;
+    ql::datum_t age = res.header.get_field("age", ql::NOTHROW);
+    if (age.has() && age.get_type() == ql::datum_t::R_STR) {
+        lifetime -= strtoll(age.as_str().to_std().c_str(), nullptr, 10);
+    }
+    return std::max<int64_t>(0, lifetime);
+}
+
+std::string http_timeout_error(uint64_t timeout_ms) {
+    return strprintf("timed out after %" PRIu64 ".%03" PRIu64 " seconds",
+                     timeout_ms / 1000, timeout_ms % 1000);
+}
+
+struct http_batcher_t::pending_request_t {
+    explicit pending_request_t(const http_opts_t &opts) :
+        serialized_opts(http_job_t::serialize_opts(opts)),
+        timeout_ms(opts.timeout_ms) { }
+
+    // The request is serialized right away, because the caller may stop waiting for
+    // it (and destroy its options) while the request is still queued or running.
+    const std::string serialized_opts;
+    const uint64_t timeout_ms;
+
+    http_result_t result;
+    std::exception_ptr error;
+    cond_t done;
+};
+
+http_batcher_t::http_batcher_t() : running(false) { }
+
+void http_batcher_t::http(extproc_pool_t *pool,
+                          const http_opts_t &opts,
+                          http_result_t *res_out,
+                          signal_t *interruptor) {
+    assert_thread();
+    auto request = std::make_shared<pending_request_t>(opts);
+    queue.push_back(request);
+
+    if (!running) {
+        run_batches(pool, interruptor);
+        guarantee(request->done.is_pulsed());
+    } else {
+        try {
+            wait_interruptible(&request->done, interruptor);
+        } catch (const interrupted_exc_t &) {
+            auto it = std::find(queue.begin(), queue.end(), request);
+            if (it != queue.end()) {
+                queue.erase(it);
+            }
+            throw;
+        }
+    }
+
+    if (request->error) {
+        std::rethrow_exception(request->error);
+    }
+    *res_out = std::move(request->result);
+}
+
+void http_batcher_t::run_batches(extproc_pool_t *pool, signal_t *interruptor) {
+    running = true;
+    std::vector<std::shared_ptr<pending_request_t> > batch;
+    try {
+        // Let the other coroutines of the query queue their requests.
+        coro_t::yield();
+        while (!queue.empty()) {
+            batch.clear();
+            while (!queue.empty() && batch.size() < HTTP_BATCH_MAX_REQUESTS) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            run_batch(pool, batch, interruptor);
+        }
+    } catch (...) {
+        // Fail everything that is left, including the requests of this coroutine.
+        std::exception_ptr error = std::current_exception();
+        for (const auto &request : batch) {
+            if (!request->done.is_pulsed()) {
+                request->error = error;
+                request->done.pulse();
+            }
+        }
+        for (const auto &request : queue) {
+            request->error = error;
+            request->done.pulse();
+        }
+        queue.clear();
+    }
+    running = false;
+}
+
+void http_batcher_t::run_batch(
+        extproc_pool_t *pool,
+        const std::vector<std::shared_ptr<pending_request_t> > &batch,
+        signal_t *interruptor) {
+    std::vector<const std::string *> serialized_opts;
+    uint64_t timeout_ms = 0;
+    for (const auto &request : batch) {
+        serialized_opts.push_back(&request->serialized_opts);
+        timeout_ms = std::max(timeout_ms, request->timeout_ms);
+    }
+
+    signal_timer_t timeout;
+    wait_any_t combined_interruptor(interruptor, &timeout);
+    http_job_t job(pool, &combined_interruptor);
+    // A lone request isn't timed out in the worker, see `perform_http_batch`.
+    timeout.start(batch.size() == 1
+                  ? timeout_ms
+                  : timeout_ms + HTTP_BATCH_TIMEOUT_SLACK_MS);
+
+    std::vector<http_result_t> results;
+    try {
+        job.http_batch(serialized_opts, &results);
+    } catch (const interrupted_exc_t &ex) {
+        if (!timeout.is_pulsed()) {
+            throw;
+        }
+        for (const auto &request : batch) {
+            request->result.error = http_timeout_error(request->timeout_ms);
+            request->done.pulse();
+        }
+        return;
+    } catch (...) {
+        job.worker_error();
+        throw;
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        batch[i]->result = std::move(results[i]);
+        batch[i]->done.pulse();
+    }
+}
+
+http_runner_t::http_runner_t(extproc_pool_t *_pool, http_batcher_t *_batcher) :
+    pool(_pool), batcher(_batcher) { }
 
 void http_runner_t::http(const http_opts_t &opts,
                          http_result_t *res_out,
                          signal_t *interruptor) {
+    assert_thread();
+    const std::string cache_key = http_cache_key(opts);
+    if (cache_key.empty()) {
+        perform_http(opts, res_out, interruptor);
+        return;
+    }
+
+    http_response_cache_t *cache = get_http_response_cache();
+    auto it = cache->find(cache_key);
+    if (it != cache->end() && get_ticks() < it->second.expires) {
+        ++pm_http_cache_hits;
+        *res_out = it->second.result;
+        return;
+    }
+    ++pm_http_cache_misses;
+
+    perform_http(opts, res_out, interruptor);
+
+    const int64_t lifetime = http_cache_lifetime_secs(*res_out);
+    if (lifetime > 0 &&
+        ql::datum_serialized_size(res_out->header,
+                                  ql::check_datum_serialization_errors_t::NO)
+        + ql::datum_serialized_size(res_out->body,
+                                    ql::check_datum_serialization_errors_t::NO)
+            <= HTTP_RESPONSE_CACHE_MAX_ENTRY_SIZE) {
+        // `perform_http` may have blocked, so look the entry up again.
+        http_cache_entry_t *entry = &(*cache)[cache_key];
+        entry->result = *res_out;
+        entry->expires = get_ticks() + secs_to_ticks(lifetime);
+    }
+}
+
+void http_runner_t::perform_http(const http_opts_t &opts,
+                                 http_result_t *res_out,
+                                 signal_t *interruptor) {
+    if (batcher != nullptr) {
+        batcher->http(pool, opts, res_out, interruptor);
+        return;
+    }
+
     signal_timer_t timeout;
     wait_any_t combined_interruptor(interruptor, &timeout);
     http_job_t job(pool, &combined_interruptor);
 
-    assert_thread();
     timeout.start(opts.timeout_ms);
 
     try {
@@ -87,9 +378,7 @@ void http_runner_t::http(const http_opts_t &opts,
         if (!timeout.is_pulsed()) {
             throw;
         }
-        res_out->error =
-            strprintf("timed out after %" PRIu64 ".%03" PRIu64 " seconds",
-                      opts.timeout_ms / 1000, opts.timeout_ms % 1000);
+        res_out->error = http_timeout_error(opts.timeout_ms);
     } catch (...) {
         // This will mark the worker as errored so we don't try to re-sync with it
         //  on the next line (since we're in a catch statement, we aren't allowed)
@@ -2,10 +2,12 @@
 #ifndef EXTPROC_HTTP_RUNNER_HPP_
 #define EXTPROC_HTTP_RUNNER_HPP_
 
+#include <deque>
 #include <exception>
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <utility>
 
 #include "errors.hpp"
@@ -13,6 +15,7 @@
 
 #include "containers/counted.hpp"
 #include "rdb_protocol/datum.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/signal.hpp"
 #include "extproc/extproc_job.hpp"
 
@@ -117,23 +120,68 @@ struct http_opts_t {
     uint32_t max_redirects;
 
     bool verify;
+
+    // Whether the response may be served from, and stored in, the server's response
+    // cache (see `http_runner_t`).
+    bool cache;
 };
 
 RDB_DECLARE_SERIALIZABLE(http_opts_t);
 RDB_DECLARE_SERIALIZABLE(http_opts_t::http_auth_t);
 
+std::string http_timeout_error(uint64_t timeout_ms);
+
+// Collects the requests that the coroutines of a query make concurrently, e.g. when a
+// map function calls `r.http` on the rows of a batch (see `call_on_rows`), and sends
+// them to a worker process together, which performs them in parallel.  The first
+// request to arrive while no job is running yields once so that the others can join,
+// and then keeps sending jobs until no requests are left.  All the requests are
+// expected to come with the same interruptor, that of the query.
+class http_batcher_t : public home_thread_mixin_t {
+public:
+    http_batcher_t();
+
+    void http(extproc_pool_t *pool,
+              const http_opts_t &opts,
+              http_result_t *res_out,
+              signal_t *interruptor);
+
+private:
+    struct pending_request_t;
+
+    void run_batches(extproc_pool_t *pool, signal_t *interruptor);
+    void run_batch(extproc_pool_t *pool,
+                   const std::vector<std::shared_ptr<pending_request_t> > &batch,
+                   signal_t *interruptor);
 
-// A handle to a running "HTTP fetcher" job.
+    std::deque<std::shared_ptr<pending_request_t> > queue;
+    bool running;
+
+    DISABLE_COPYING(http_batcher_t);
+};
+
+
+// A handle to a running "HTTP fetcher" job.  Requests with `opts.cache` set go
+// through a per-thread response cache first, which is shared by all the queries on
+// the thread.  Only `GET` requests without credentials, data or cookies are cached,
+// and only for as long as the server allows it with `Cache-Control`.
 class http_runner_t : public home_thread_mixin_t {
 public:
-    explicit http_runner_t(extproc_pool_t *_pool);
+    // If `_batcher` is given, requests that miss the cache go through it.
+    explicit http_runner_t(extproc_pool_t *_pool, http_batcher_t *_batcher = nullptr);
 
     void http(const http_opts_t &opts,
               http_result_t *res_out,
               signal_t *interruptor);
 
 private:
+    // Runs the request in a worker process, bypassing the cache.
+    void perform_http(const http_opts_t &opts,
+                      http_result_t *res_out,
+                      signal_t *interruptor);
+
     extproc_pool_t *pool;
+    http_batcher_t *batcher;
 
     DISABLE_COPYING(http_runner_t);
 };
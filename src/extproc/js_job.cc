@@ -7,6 +7,8 @@
 #include <stdint.h>
 
 #include <limits>
+#include <map>
+#include <memory>
 
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
@@ -22,6 +24,9 @@ const js_id_t MAX_ID = std::numeric_limits<js_id_t>::max();
 // Picked from a hat.
 #define TO_JSON_RECURSION_LIMIT  500
 
+// How many compiled scripts a worker process keeps around for later jobs.
+const size_t COMPILED_SCRIPT_CACHE_SIZE = 100;
+
 // Returns an empty counted_t on error.
 ql::datum_t js_to_datum(const v8::Handle<v8::Value> &value,
                         const ql::configured_limits_t &limits,
@@ -48,12 +53,47 @@ public:
 };
 #endif
 
+// Wrapper around `v8::Persistent<v8::UnboundScript>` that calls `Reset()` on
+// destruction
+class persistent_script_t {
+public:
+    explicit persistent_script_t(uint64_t _last_use) : last_use(_last_use) { }
+    ~persistent_script_t() {
+        script.Reset();
+    }
+    v8::Persistent<v8::UnboundScript> script;
+    uint64_t last_use;
+};
+
+/* Keeps the compiled scripts of a worker process by their source.  The jobs that a
+worker runs come and go with the queries that use `r.js` (every query that uses it gets
+a job of its own), so without this cache every query would compile its functions again.
+Unbound scripts don't belong to any context, so each evaluation still runs in a clean
+one. */
+class compiled_script_cache_t {
+public:
+    compiled_script_cache_t() : use_counter(0) { }
+
+    // Returns an empty handle if the source doesn't compile, in which case the
+    // caller's `v8::TryCatch` has the error.
+    v8::Local<v8::UnboundScript> get(v8::Isolate *isolate, const std::string &source);
+
+private:
+    void trim();
+
+    uint64_t use_counter;
+    std::map<std::string, std::shared_ptr<persistent_script_t> > scripts;
+
+    DISABLE_COPYING(compiled_script_cache_t);
+};
+
 // Each worker process should have a single instance of this class before using the v8 API
 class js_instance_t {
 public:
     static void run_other_tasks();
     static void maybe_initialize_v8();
     static v8::Isolate *isolate();
+    static compiled_script_cache_t *script_cache();
 
 private:
     js_instance_t();
@@ -62,6 +102,7 @@ private:
     static js_instance_t *instance;
 
     v8::Isolate *isolate_;
+    compiled_script_cache_t script_cache_;
 
     scoped_ptr_t<v8::Platform> platform;
 #ifdef V8_NEEDS_BUFFER_ALLOCATOR
@@ -101,12 +142,56 @@ v8::Isolate *js_instance_t::isolate() {
     return instance->isolate_;
 }
 
+compiled_script_cache_t *js_instance_t::script_cache() {
+    return &instance->script_cache_;
+}
+
 void js_instance_t::maybe_initialize_v8() {
     if (instance == nullptr) {
         instance = new js_instance_t;
     }
 }
 
+v8::Local<v8::UnboundScript> compiled_script_cache_t::get(v8::Isolate *isolate,
+                                                          const std::string &source) {
+    ++use_counter;
+    auto it = scripts.find(source);
+    if (it != scripts.end()) {
+        it->second->last_use = use_counter;
+        return v8::Local<v8::UnboundScript>::New(isolate, it->second->script);
+    }
+
+    // TODO: use an "external resource" to avoid copy?
+    v8::Handle<v8::String> src = v8::String::NewFromUtf8(isolate,
+                                                         source.data(),
+                                                         v8::String::NewStringType::kNormalString,
+                                                         source.size());
+    v8::ScriptCompiler::Source script_source(src);
+    v8::Local<v8::UnboundScript> script
+        = v8::ScriptCompiler::CompileUnbound(isolate, &script_source);
+    if (!script.IsEmpty()) {
+        trim();
+        std::shared_ptr<persistent_script_t> persistent_handle(
+            new persistent_script_t(use_counter));
+        persistent_handle->script.Reset(isolate, script);
+        scripts.insert(std::make_pair(source, persistent_handle));
+    }
+    return script;
+}
+
+void compiled_script_cache_t::trim() {
+    if (scripts.size() < COMPILED_SCRIPT_CACHE_SIZE) {
+        return;
+    }
+    auto oldest = scripts.begin();
+    for (auto it = ++scripts.begin(); it != scripts.end(); ++it) {
+        if (it->second->last_use < oldest->second->last_use) {
+            oldest = it;
+        }
+    }
+    scripts.erase(oldest);
+}
+
 // Wrapper around `v8::Persistent<v8::Value> >` that calls `Reset()` on destruction
 class persistent_value_t {
 public:
@@ -124,10 +209,19 @@ public:
     js_result_t eval(const std::string &source, const ql::configured_limits_t &limits);
     js_result_t call(js_id_t id, const std::vector<ql::datum_t> &args,
                      const ql::configured_limits_t &limits);
+    // Calls the function on each of the rows, stopping after the first one that
+    // doesn't return a datum.
+    std::vector<js_result_t> call_batch(js_id_t id,
+                                        const std::vector<ql::datum_t> &rows,
+                                        const ql::configured_limits_t &limits);
     void release(js_id_t id);
     void run_other_tasks(uint64_t task_counter);
 
 private:
+    js_result_t call_in_current_context(js_id_t id,
+                                        const std::vector<ql::datum_t> &args,
+                                        const ql::configured_limits_t &limits);
+
     js_id_t remember_value(const v8::Handle<v8::Value> &value);
     const std::shared_ptr<persistent_value_t> find_value(js_id_t id);
 
@@ -151,6 +245,7 @@ public:
 enum js_task_t {
     TASK_EVAL,
     TASK_CALL,
+    TASK_CALL_BATCH,
     TASK_RELEASE,
     TASK_EXIT
 };
@@ -209,6 +304,35 @@ js_result_t js_job_t::call(js_id_t id, const std::vector<ql::datum_t> &args) {
     return result;
 }
 
+std::vector<js_result_t> js_job_t::call_batch(js_id_t id,
+                                              const std::vector<ql::datum_t> &rows) {
+    js_task_t task = js_task_t::TASK_CALL_BATCH;
+    write_message_t wm;
+    wm.append(&task, sizeof(task));
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, id);
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, rows);
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, limits);
+    {
+        int res = send_write_message(extproc_job.write_stream(), &wm);
+        if (res != 0) {
+            throw extproc_worker_exc_t("failed to send data to the worker");
+        }
+    }
+
+    std::vector<js_result_t> results;
+    archive_result_t res
+        = deserialize<cluster_version_t::LATEST_OVERALL>(extproc_job.read_stream(),
+                                                         &results);
+    if (bad(res)) {
+        throw extproc_worker_exc_t(strprintf("failed to deserialize call result from worker "
+                                             "(%s)", archive_result_as_str(res)));
+    }
+    if (results.size() > rows.size()) {
+        throw extproc_worker_exc_t("worker returned more results than it got rows");
+    }
+    return results;
+}
+
 void js_job_t::release(js_id_t id) {
     js_task_t task = js_task_t::TASK_RELEASE;
     write_message_t wm;
@@ -341,6 +465,38 @@ bool run_call(read_stream_t *stream_in,
     return send_js_result(stream_out, js_result);
 }
 
+bool run_call_batch(read_stream_t *stream_in,
+                    write_stream_t *stream_out,
+                    js_env_t *js_env,
+                    uint64_t task_counter) {
+    js_id_t id;
+    std::vector<ql::datum_t> rows;
+    ql::configured_limits_t limits;
+    {
+        archive_result_t res
+            = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &id);
+        if (bad(res)) { return false; }
+        res = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &rows);
+        if (bad(res)) { return false; }
+        res = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &limits);
+        if (bad(res)) { return false; }
+    }
+
+    std::vector<js_result_t> js_results;
+    try {
+        js_results = js_env->call_batch(id, rows, limits);
+    } catch (const std::exception &e) {
+        js_results.push_back(std::string(e.what()));
+    } catch (...) {
+        js_results.push_back(std::string("encountered an unknown exception"));
+    }
+
+    js_env->run_other_tasks(task_counter);
+    write_message_t wm;
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, js_results);
+    return send_write_message(stream_out, &wm) == 0;
+}
+
 bool run_release(read_stream_t *stream_in,
                  write_stream_t *stream_out,
                  js_env_t *js_env,
@@ -385,6 +541,11 @@ bool js_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out) {
                 return false;
             }
             break;
+        case TASK_CALL_BATCH:
+            if (!run_call_batch(stream_in, stream_out, &js_env, task_counter)) {
+                return false;
+            }
+            break;
         case TASK_RELEASE:
             if (!run_release(stream_in, stream_out, &js_env, task_counter)) {
                 return false;
@@ -422,25 +583,20 @@ js_result_t js_env_t::eval(const std::string &source,
 
     v8::HandleScope handle_scope(isolate);
 
-    // TODO: use an "external resource" to avoid copy?
-    v8::Handle<v8::String> src = v8::String::NewFromUtf8(isolate,
-                                                         source.data(),
-                                                         v8::String::NewStringType::kNormalString,
-                                                         source.size());
-
     // This constructor registers itself with v8 so that any errors generated
     // within v8 will be available within this object.
     v8::TryCatch try_catch;
 
     // Firstly, compilation may fail (because of say a syntax error)
-    v8::Handle<v8::Script> script = v8::Script::Compile(src);
+    v8::Handle<v8::UnboundScript> script
+        = js_instance_t::script_cache()->get(isolate, source);
     if (script.IsEmpty()) {
         // Get the error out of the TryCatch object
         append_caught_error(err_out, try_catch);
     } else {
         // Secondly, evaluation may fail because of an exception generated
         // by the code
-        v8::Handle<v8::Value> result_val = script->Run();
+        v8::Handle<v8::Value> result_val = script->BindToCurrentContext()->Run();
         if (result_val.IsEmpty()) {
             // Get the error from the TryCatch object
             append_caught_error(err_out, try_catch);
@@ -519,6 +675,30 @@ js_result_t js_env_t::call(js_id_t id,
                            const std::vector<ql::datum_t> &args,
                            const ql::configured_limits_t &limits) {
     js_context_t clean_context;
+    return call_in_current_context(id, args, limits);
+}
+
+std::vector<js_result_t> js_env_t::call_batch(js_id_t id,
+                                              const std::vector<ql::datum_t> &rows,
+                                              const ql::configured_limits_t &limits) {
+    // Creating a context takes longer than most function calls, so all rows share one.
+    js_context_t clean_context;
+    std::vector<js_result_t> results;
+    results.reserve(rows.size());
+    std::vector<ql::datum_t> args(1);
+    for (const ql::datum_t &row : rows) {
+        args[0] = row;
+        results.push_back(call_in_current_context(id, args, limits));
+        if (boost::get<ql::datum_t>(&results.back()) == nullptr) {
+            break;
+        }
+    }
+    return results;
+}
+
+js_result_t js_env_t::call_in_current_context(js_id_t id,
+                                              const std::vector<ql::datum_t> &args,
+                                              const ql::configured_limits_t &limits) {
     js_result_t result("");
     std::string *err_out = boost::get<std::string>(&result);
 
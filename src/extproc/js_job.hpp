@@ -21,6 +21,9 @@ public:
 
     js_result_t eval(const std::string &source);
     js_result_t call(js_id_t id, const std::vector<ql::datum_t> &args);
+    // Calls the function with each of the rows as its argument, in a single message
+    // to the worker.  The results stop after the first row that fails.
+    std::vector<js_result_t> call_batch(js_id_t id, const std::vector<ql::datum_t> &rows);
     void release(js_id_t id);
     void exit();
 
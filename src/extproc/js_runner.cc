@@ -225,6 +225,47 @@ js_result_t js_runner_t::call(const std::string &source,
     return result;
 }
 
+std::vector<js_result_t> js_runner_t::call_batch(const std::string &source,
+                                                const std::vector<ql::datum_t> &rows,
+                                                const req_config_t &config) {
+    assert_thread();
+    guarantee(job_data.has());
+
+    js_result_t fn = eval(source, config);
+    js_id_t *fn_id = boost::get<js_id_t>(&fn);
+    if (fn_id == nullptr) {
+        return std::vector<js_result_t>();
+    }
+
+    object_buffer_t<js_timeout_t::sentry_t> sentry;
+    sentry.create(&job_data->js_timeout, config.timeout_ms * rows.size());
+
+    std::vector<js_result_t> results;
+    bool is_timeout = false;
+    try {
+        try {
+            results = job_data->js_job.call_batch(*fn_id, rows);
+        } catch (...) {
+            // See `call()`.
+            is_timeout = job_data->js_timeout.get_signal()->is_pulsed();
+            sentry.reset();
+            job_data->js_job.worker_error();
+            job_data.reset();
+
+            throw;
+        }
+    } catch (interrupted_exc_t const &e) {
+        // The caller calls the function on each row again, so that the row that took
+        // too long gets the same error as without batching.
+        if (is_timeout) {
+            return std::vector<js_result_t>();
+        } else {
+            throw;
+        }
+    }
+    return results;
+}
+
 void js_runner_t::cache_id(js_id_t id, const std::string &source) {
     guarantee(job_data.has());
     guarantee(id != INVALID_ID);
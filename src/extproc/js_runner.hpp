@@ -57,6 +57,15 @@ public:
                      const std::vector<ql::datum_t> &args,
                      const req_config_t &config);
 
+    // Calls a function that takes one argument on each of the rows, with a single
+    // round trip to the worker.  The results end with the first row that doesn't
+    // return a datum, whose result is the error.  Returns no results at all if the
+    // source isn't a function, or if the batch takes longer than the timeout times
+    // the number of rows.
+    std::vector<js_result_t> call_batch(const std::string &source,
+                                        const std::vector<ql::datum_t> &rows,
+                                        const req_config_t &config);
+
 private:
     static const size_t CACHE_SIZE;
 
@@ -0,0 +1,63 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "perfmon/memory_accounting.hpp"
+
+#include <atomic>
+
+#include "concurrency/cache_line_padded.hpp"
+#include "perfmon/perfmon.hpp"
+#include "rdb_protocol/datum.hpp"
+
+static cache_line_padded_t<std::atomic<int64_t> >
+    accounted_memory[NUM_MEMORY_CATEGORIES];
+
+static std::atomic<bool> low_memory(false);
+
+const char *memory_category_name(memory_category_t category) {
+    switch (category) {
+    case memory_category_t::coroutine_stacks: return "coroutine_stacks";
+    case memory_category_t::changefeed_queues: return "changefeed_queues";
+    case memory_category_t::prefetched_results: return "prefetched_results";
+    case memory_category_t::lba_index: return "lba_index";
+    default: unreachable();
+    }
+}
+
+void account_memory(memory_category_t category, int64_t bytes) {
+    accounted_memory[static_cast<int>(category)].value.fetch_add(
+        bytes, std::memory_order_relaxed);
+}
+
+int64_t get_accounted_memory(memory_category_t category) {
+    return accounted_memory[static_cast<int>(category)].value.load(
+        std::memory_order_relaxed);
+}
+
+void set_memory_is_low(bool is_low) {
+    low_memory.store(is_low, std::memory_order_relaxed);
+}
+
+bool memory_is_low() {
+    return low_memory.load(std::memory_order_relaxed);
+}
+
+/* The counters aren't per thread, so there's nothing to collect on the threads. */
+class memory_accounting_perfmon_t : public perfmon_t {
+public:
+    void *begin_stats() final { return nullptr; }
+    void visit_stats(void *) final { }
+    ql::datum_t end_stats(void *) final {
+        ql::datum_object_builder_t builder;
+        for (int i = 0; i < NUM_MEMORY_CATEGORIES; ++i) {
+            const memory_category_t category = static_cast<memory_category_t>(i);
+            builder.overwrite(memory_category_name(category),
+                              ql::datum_t(static_cast<double>(
+                                  get_accounted_memory(category))));
+        }
+        builder.overwrite("low_memory", ql::datum_t::boolean(memory_is_low()));
+        return std::move(builder).to_datum();
+    }
+};
+
+static memory_accounting_perfmon_t pm_memory;
+static perfmon_membership_t pm_memory_membership(
+    &get_global_perfmon_collection(), &pm_memory, "memory");
@@ -0,0 +1,57 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef PERFMON_MEMORY_ACCOUNTING_HPP_
+#define PERFMON_MEMORY_ACCOUNTING_HPP_
+
+#include <stdint.h>
+
+#include "errors.hpp"
+
+/* Counts the memory that the larger users of memory outside of the cache hold on to.
+The counts show up in the `memory` stats of the server, and `memory_checker_t` logs
+them when it runs low on memory.  They're kept in one atomic counter per category,
+which is fine as long as they don't change on every little allocation. */
+enum class memory_category_t {
+    coroutine_stacks = 0,
+    changefeed_queues,
+    prefetched_results,
+    lba_index
+};
+const int NUM_MEMORY_CATEGORIES = 4;
+
+const char *memory_category_name(memory_category_t category);
+
+void account_memory(memory_category_t category, int64_t bytes);
+int64_t get_accounted_memory(memory_category_t category);
+
+/* Some amount of memory in one category, which gets released when this gets
+destroyed. */
+class accounted_memory_t {
+public:
+    explicit accounted_memory_t(memory_category_t _category)
+        : category(_category), bytes(0) { }
+    ~accounted_memory_t() {
+        account_memory(category, -bytes);
+    }
+
+    void add(int64_t delta) {
+        bytes += delta;
+        account_memory(category, delta);
+    }
+    void set(int64_t new_bytes) {
+        add(new_bytes - bytes);
+    }
+    int64_t get() const { return bytes; }
+
+private:
+    const memory_category_t category;
+    int64_t bytes;
+
+    DISABLE_COPYING(accounted_memory_t);
+};
+
+/* `memory_checker_t` sets this while the server is so close to its memory limit that
+it should turn away new queries instead of risking getting killed. */
+void set_memory_is_low(bool is_low);
+bool memory_is_low();
+
+#endif  // PERFMON_MEMORY_ACCOUNTING_HPP_
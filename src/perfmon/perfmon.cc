@@ -2,6 +2,7 @@
 #include "perfmon/perfmon.hpp"
 
 #include <stdarg.h>
+#include <string.h>
 
 #include <cmath>
 #include <map>
@@ -58,6 +59,18 @@ ql::datum_t perfmon_counter_t::output_stat(const int64_t &stat) {
     return ql::datum_t(static_cast<double>(stat));
 }
 
+/* perfmon_thread_counter_t */
+
+ql::datum_t perfmon_thread_counter_t::end_stats(void *v_data) {
+    std::unique_ptr<padded_int64_t[]> data(static_cast<padded_int64_t *>(v_data));
+    ql::datum_object_builder_t builder;
+    for (int i = 0; i < get_num_threads(); i++) {
+        builder.overwrite(strprintf("%d", i).c_str(),
+                          ql::datum_t(static_cast<double>(data[i].value)));
+    }
+    return std::move(builder).to_datum();
+}
+
 scoped_perfmon_counter_t::scoped_perfmon_counter_t(perfmon_counter_t *_counter)
     : counter(_counter) {
     ++(*counter);
@@ -299,6 +312,158 @@ ql::datum_t perfmon_rate_monitor_t::output_stat(const double &stat) {
     return ql::datum_t(stat / ticks_to_secs(length));
 }
 
+/* latency_histogram_t */
+
+const uint64_t latency_histogram_t::MAX_VALUE;
+
+latency_histogram_t::latency_histogram_t() : total(0), max_value(0) {
+    memset(buckets, 0, sizeof(buckets));
+}
+
+size_t latency_histogram_t::bucket_index(uint64_t value) {
+    const uint64_t num_sub_buckets = uint64_t(1) << SUB_BUCKET_BITS;
+    if (value < num_sub_buckets) {
+        return value;
+    }
+    // The position of the highest set bit decides the power of two, and the
+    // `SUB_BUCKET_BITS` bits below it decide the sub-bucket.
+    const int shift = (63 - __builtin_clzll(value)) - SUB_BUCKET_BITS;
+    return ((shift + 1) << SUB_BUCKET_BITS) + ((value >> shift) - num_sub_buckets);
+}
+
+uint64_t latency_histogram_t::bucket_upper_bound(size_t index) {
+    const uint64_t num_sub_buckets = uint64_t(1) << SUB_BUCKET_BITS;
+    if (index < num_sub_buckets) {
+        return index;
+    }
+    const int shift = (index >> SUB_BUCKET_BITS) - 1;
+    const uint64_t sub_bucket = num_sub_buckets + (index & (num_sub_buckets - 1));
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void latency_histogram_t::record(uint64_t value) {
+    value = std::min(value, MAX_VALUE);
+    ++buckets[bucket_index(value)];
+    ++total;
+    max_value = std::max(max_value, value);
+}
+
+void latency_histogram_t::merge(const latency_histogram_t &other) {
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    total += other.total;
+    max_value = std::max(max_value, other.max_value);
+}
+
+uint64_t latency_histogram_t::percentile(double fraction) const {
+    if (total == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(fraction * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(bucket_upper_bound(i), max_value);
+        }
+    }
+    return max_value;
+}
+
+ql::datum_t latency_histogram_t::to_datum() const {
+    ql::datum_object_builder_t builder;
+    builder.overwrite(stat_count, ql::datum_t(static_cast<double>(total)));
+    const std::pair<const char *, double> points[] = {
+        {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p999", 0.999}};
+    for (const auto &point : points) {
+        builder.overwrite(point.first, ql::datum_t(
+            percentile(point.second) / static_cast<double>(MILLION)));
+    }
+    builder.overwrite(stat_max, ql::datum_t(max_value / static_cast<double>(MILLION)));
+    return std::move(builder).to_datum();
+}
+
+/* perfmon_latency_histogram_t */
+
+perfmon_latency_histogram_t::perfmon_latency_histogram_t()
+    : perfmon_perthread_t<latency_histogram_t>() { }
+
+void perfmon_latency_histogram_t::record(uint64_t microseconds) {
+    rassert(get_thread_id().threadnum >= 0);
+    scoped_ptr_t<latency_histogram_t> *histogram =
+        &thread_data[get_thread_id().threadnum].value;
+    if (!histogram->has()) {
+        histogram->init(new latency_histogram_t());
+    }
+    (*histogram)->record(microseconds);
+}
+
+void perfmon_latency_histogram_t::get_thread_stat(latency_histogram_t *stat) {
+    const scoped_ptr_t<latency_histogram_t> &histogram =
+        thread_data[get_thread_id().threadnum].value;
+    if (histogram.has()) {
+        *stat = *histogram;
+    }
+}
+
+latency_histogram_t perfmon_latency_histogram_t::combine_stats(
+        const latency_histogram_t *stats) {
+    latency_histogram_t combined;
+    for (int i = 0; i < get_num_threads(); ++i) {
+        combined.merge(stats[i]);
+    }
+    return combined;
+}
+
+ql::datum_t perfmon_latency_histogram_t::output_stat(
+        const latency_histogram_t &stat) {
+    return stat.to_datum();
+}
+
+/* perfmon_keyed_latency_t */
+
+perfmon_keyed_latency_t::perfmon_keyed_latency_t(size_t _max_keys,
+                                                 const std::string &_other_key)
+    : max_keys(_max_keys), other_key(_other_key) { }
+
+void perfmon_keyed_latency_t::record(const std::string &key, uint64_t microseconds) {
+    rassert(get_thread_id().threadnum >= 0);
+    histograms_t *histograms = &thread_data[get_thread_id().threadnum].value;
+    auto it = histograms->find(key);
+    if (it == histograms->end()) {
+        const std::string &new_key = histograms->size() < max_keys ? key : other_key;
+        it = histograms->insert(std::make_pair(new_key, latency_histogram_t())).first;
+    }
+    it->second.record(microseconds);
+}
+
+void *perfmon_keyed_latency_t::begin_stats() {
+    return new histograms_t[get_num_threads()];
+}
+
+void perfmon_keyed_latency_t::visit_stats(void *data) {
+    const int thread = get_thread_id().threadnum;
+    static_cast<histograms_t *>(data)[thread] = thread_data[thread].value;
+}
+
+ql::datum_t perfmon_keyed_latency_t::end_stats(void *v_data) {
+    std::unique_ptr<histograms_t[]> data(static_cast<histograms_t *>(v_data));
+    histograms_t combined;
+    for (int i = 0; i < get_num_threads(); ++i) {
+        for (const auto &pair : data[i]) {
+            combined[pair.first].merge(pair.second);
+        }
+    }
+
+    ql::datum_object_builder_t builder;
+    for (const auto &pair : combined) {
+        builder.overwrite(datum_string_t(pair.first), pair.second.to_datum());
+    }
+    return std::move(builder).to_datum();
+}
+
 perfmon_duration_sampler_t::perfmon_duration_sampler_t(ticks_t length, bool _ignore_global_full_perfmon)
     : stat(), active(), total(), recent(length, true),
       active_membership(&stat, &active, "active_count"),
@@ -78,6 +78,14 @@ public:
     void operator-=(int64_t num) { get() -= num; }
 };
 
+/* perfmon_thread_counter_t is like perfmon_counter_t, but it reports the value of
+ * each thread separately instead of their sum.
+ */
+class perfmon_thread_counter_t : public perfmon_counter_t {
+public:
+    ql::datum_t end_stats(void *v_data);
+};
+
 class scoped_perfmon_counter_t {
 public:
     explicit scoped_perfmon_counter_t(perfmon_counter_t *_counter);
@@ -188,6 +196,90 @@ private:
     cache_line_padded_t<stddev_t> thread_data[MAX_THREADS];
 };
 
+/* A histogram of latencies in the style of HdrHistogram: every power of two is split
+into `1 << SUB_BUCKET_BITS` linear sub-buckets, so the percentiles it reports are
+within about 12% of the real values while it only takes a few hundred counters.
+Values are in microseconds; larger ones than `MAX_VALUE` are counted as `MAX_VALUE`.
+*/
+class latency_histogram_t {
+public:
+    static const int SUB_BUCKET_BITS = 3;
+    static const int MAX_VALUE_BITS = 36;
+    static const uint64_t MAX_VALUE = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+    static const size_t NUM_BUCKETS =
+        (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    latency_histogram_t();
+
+    void record(uint64_t value);
+    void merge(const latency_histogram_t &other);
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_value; }
+    // The upper bound of the bucket that contains the value that `fraction` of all
+    // recorded values are smaller than or equal to, or 0 if nothing was recorded.
+    uint64_t percentile(double fraction) const;
+
+    // The count, the percentiles that the perfmons report, and the maximum.
+    ql::datum_t to_datum() const;
+
+private:
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_upper_bound(size_t index);
+
+    uint64_t total;
+    uint64_t max_value;
+    uint32_t buckets[NUM_BUCKETS];
+};
+
+/* `perfmon_latency_histogram_t` keeps a `latency_histogram_t` of the latencies that
+are recorded on each thread, and reports the count, the 50th, 90th, 99th and 99.9th
+percentile and the maximum in seconds.  Recording only touches the histogram of the
+current thread, which is allocated the first time that thread records something, so
+there is no locking and threads that never record anything cost a pointer. */
+class perfmon_latency_histogram_t
+    : public perfmon_perthread_t<latency_histogram_t> {
+public:
+    perfmon_latency_histogram_t();
+
+    void record(uint64_t microseconds);
+    void record_ticks(ticks_t duration) { record(duration / THOUSAND); }
+
+protected:
+    void get_thread_stat(latency_histogram_t *);
+    latency_histogram_t combine_stats(const latency_histogram_t *);
+    ql::datum_t output_stat(const latency_histogram_t &);
+
+private:
+    cache_line_padded_t<scoped_ptr_t<latency_histogram_t> > thread_data[MAX_THREADS];
+
+    DISABLE_COPYING(perfmon_latency_histogram_t);
+};
+
+/* `perfmon_keyed_latency_t` keeps a `latency_histogram_t` for each of up to
+`max_keys` keys on each thread, and reports the same values as `perfmon_latency_histogram_t` for
+each key.  Once a thread has seen `max_keys` different
+keys, it counts any new ones under `other_key`. */
+class perfmon_keyed_latency_t : public perfmon_t {
+public:
+    perfmon_keyed_latency_t(size_t _max_keys, const std::string &_other_key);
+
+    void record(const std::string &key, uint64_t microseconds);
+
+    void *begin_stats();
+    void visit_stats(void *data);
+    ql::datum_t end_stats(void *data);
+
+private:
+    typedef std::map<std::string, latency_histogram_t> histograms_t;
+
+    const size_t max_keys;
+    const std::string other_key;
+    cache_line_padded_t<histograms_t> thread_data[MAX_THREADS];
+
+    DISABLE_COPYING(perfmon_keyed_latency_t);
+};
+
 /* `perfmon_rate_monitor_t` keeps track of the number of times some event
  * happens per second. It is different from `perfmon_sampler_t` in that it does
  * not associate a number with each event, but you can record many events at
@@ -4,10 +4,13 @@
 
 class perfmon_collection_t;
 class perfmon_counter_t;
+class perfmon_thread_counter_t;
 class perfmon_sampler_t;
 struct perfmon_stddev_t;
 struct perfmon_duration_sampler_t;
 class perfmon_rate_monitor_t;
+class perfmon_latency_histogram_t;
+class perfmon_keyed_latency_t;
 struct perfmon_function_t;
 
 #endif  // PERFMON_TYPES_HPP_
@@ -815,6 +815,8 @@ static void pprint_update_reminder() {
     case Term::SPLIT:
     case Term::UPCASE:
     case Term::DOWNCASE:
+    case Term::TRIGRAMS:
+    case Term::TOKENS:
     case Term::SAMPLE:
     case Term::IS_EMPTY:
     case Term::DEFAULT:
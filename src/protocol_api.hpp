@@ -173,12 +173,15 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(durability_requirement_t,
                                       DURABILITY_REQUIREMENT_DEFAULT,
                                       DURABILITY_REQUIREMENT_SOFT);
 
-enum class read_mode_t { MAJORITY, SINGLE, OUTDATED, DEBUG_DIRECT };
+// `NEAREST` is an outdated read that goes to the replica with the lowest round trip
+// time instead of a random one.  It's turned into `OUTDATED` before the read gets sent
+// to the replica, so that servers that don't know about it can handle the read.
+enum class read_mode_t { MAJORITY, SINGLE, OUTDATED, DEBUG_DIRECT, NEAREST };
 
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(read_mode_t,
                                       int8_t,
                                       read_mode_t::MAJORITY,
-                                      read_mode_t::DEBUG_DIRECT);
+                                      read_mode_t::NEAREST);
 
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
         reql_version_t, int8_t,
@@ -0,0 +1,122 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/admission_control.hpp"
+
+#include "arch/timing.hpp"
+#include "concurrency/wait_any.hpp"
+#include "config/args.hpp"
+#include "perfmon/perfmon.hpp"
+
+namespace ql {
+
+bool parse_query_priority(const std::string &name, query_priority_t *priority_out) {
+    if (name == "high") {
+        *priority_out = query_priority_t::HIGH;
+    } else if (name == "normal") {
+        *priority_out = query_priority_t::NORMAL;
+    } else if (name == "low") {
+        *priority_out = query_priority_t::LOW;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int64_t max_queue_time_ms(query_priority_t priority) {
+    switch (priority) {
+    case query_priority_t::HIGH: return ADMISSION_MAX_QUEUE_TIME_MS * 4;
+    case query_priority_t::NORMAL: return ADMISSION_MAX_QUEUE_TIME_MS;
+    case query_priority_t::LOW: return ADMISSION_MAX_QUEUE_TIME_MS / 4;
+    default: unreachable();
+    }
+}
+
+admission_control_t::ticket_t::ticket_t() : parent(nullptr) { }
+
+admission_control_t::ticket_t::~ticket_t() {
+    if (parent != nullptr) {
+        parent->release();
+    }
+}
+
+admission_control_t::admission_control_t(perfmon_counter_t *_queued_stat,
+                                         perfmon_counter_t *_rejected_stat) :
+    queued_stat(_queued_stat),
+    rejected_stat(_rejected_stat),
+    active(0),
+    num_waiting(0) { }
+
+admission_control_t::~admission_control_t() {
+    guarantee(active == 0);
+    guarantee(num_waiting == 0);
+}
+
+bool admission_control_t::admit(query_priority_t priority,
+                                ticket_t *ticket_out,
+                                signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+    guarantee(ticket_out->parent == nullptr);
+    const int p = static_cast<int>(priority);
+
+    bool anyone_ahead = false;
+    for (int i = 0; i <= p; ++i) {
+        anyone_ahead |= !waiting[i].empty();
+    }
+    if (!anyone_ahead && active < ADMISSION_MAX_ACTIVE_QUERIES) {
+        ++active;
+        ticket_out->parent = this;
+        return true;
+    }
+
+    // If the first query in our line has already waited for as long as we could, the
+    // line doesn't move fast enough for us to get through in time.
+    const int64_t max_wait_ms = max_queue_time_ms(priority);
+    const microtime_t now = current_microtime();
+    if (num_waiting >= ADMISSION_MAX_QUEUED_QUERIES
+        || (!waiting[p].empty()
+            && now - waiting[p].head()->enqueued_at
+                >= static_cast<microtime_t>(max_wait_ms) * 1000)) {
+        ++*rejected_stat;
+        return false;
+    }
+
+    waiter_t waiter;
+    waiter.enqueued_at = now;
+    waiting[p].push_back(&waiter);
+    ++num_waiting;
+    ++*queued_stat;
+
+    signal_timer_t timeout(max_wait_ms);
+    wait_any_t done(&waiter.granted, &timeout, interruptor);
+    done.wait_lazily_unordered();
+    if (waiter.granted.is_pulsed()) {
+        // `release()` took us out of the line and left its slot to us.
+        ticket_out->parent = this;
+        return true;
+    }
+
+    waiting[p].remove(&waiter);
+    --num_waiting;
+    --*queued_stat;
+    if (interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+    ++*rejected_stat;
+    return false;
+}
+
+void admission_control_t::release() {
+    assert_thread();
+    for (int i = 0; i < NUM_QUERY_PRIORITIES; ++i) {
+        if (!waiting[i].empty()) {
+            waiter_t *next = waiting[i].head();
+            waiting[i].remove(next);
+            --num_waiting;
+            --*queued_stat;
+            next->granted.pulse();
+            return;
+        }
+    }
+    --active;
+}
+
+} // namespace ql
@@ -0,0 +1,75 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_ADMISSION_CONTROL_HPP_
+#define RDB_PROTOCOL_ADMISSION_CONTROL_HPP_
+
+#include <string>
+
+#include "concurrency/cond_var.hpp"
+#include "concurrency/interruptor.hpp"
+#include "containers/intrusive_list.hpp"
+#include "threading.hpp"
+#include "time.hpp"
+
+class perfmon_counter_t;
+class signal_t;
+
+namespace ql {
+
+/* Set with the `priority` optarg of `run`.  Queries of a higher priority are let in
+before any of a lower one, and may wait in line for longer. */
+enum class query_priority_t { HIGH = 0, NORMAL, LOW };
+const int NUM_QUERY_PRIORITIES = 3;
+
+// Returns false if `name` isn't "high", "normal" or "low".
+bool parse_query_priority(const std::string &name, query_priority_t *priority_out);
+
+/* Limits how many START queries run on a thread at the same time.  The queries that
+don't get a slot right away wait in one line per priority.  A query is rejected instead
+of waiting if the line is too long, or if it moves too slowly for the query to get
+through in time; otherwise it's rejected once it has waited for as long as its priority
+allows.  So when the server is overloaded, the queries that it can't handle fail fast
+and may be retried, instead of making all the other queries slow. */
+class admission_control_t : public home_thread_mixin_t {
+public:
+    // `queued_stat` counts the waiting queries and `rejected_stat` the rejected ones.
+    admission_control_t(perfmon_counter_t *_queued_stat,
+                        perfmon_counter_t *_rejected_stat);
+    ~admission_control_t();
+
+    // Holds a slot while it exists.
+    class ticket_t {
+    public:
+        ticket_t();
+        ~ticket_t();
+    private:
+        friend class admission_control_t;
+        admission_control_t *parent;
+        DISABLE_COPYING(ticket_t);
+    };
+
+    // Returns false if the query is rejected, and fills in `ticket_out` otherwise.
+    bool admit(query_priority_t priority,
+               ticket_t *ticket_out,
+               signal_t *interruptor) THROWS_ONLY(interrupted_exc_t);
+
+private:
+    struct waiter_t : public intrusive_list_node_t<waiter_t> {
+        microtime_t enqueued_at;
+        cond_t granted;
+    };
+
+    // Hands the slot over to the first waiting query of the highest priority.
+    void release();
+
+    perfmon_counter_t *queued_stat;
+    perfmon_counter_t *rejected_stat;
+    int64_t active;
+    size_t num_waiting;
+    intrusive_list_t<waiter_t> waiting[NUM_QUERY_PRIORITIES];
+
+    DISABLE_COPYING(admission_control_t);
+};
+
+} // namespace ql
+
+#endif // RDB_PROTOCOL_ADMISSION_CONTROL_HPP_
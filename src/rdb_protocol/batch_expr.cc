@@ -0,0 +1,331 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/batch_expr.hpp"
+
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+#include "rdb_protocol/error.hpp"
+#include "rdb_protocol/ql2.pb.h"
+
+namespace ql {
+
+/* Every node computes one column of results, with one entry per row of the batch.  An
+empty entry means that the row has to be evaluated by the regular term classes.  The
+columns live in the arena, since they all go away once the batch is done. */
+typedef std::vector<datum_t, arena_allocator_t<datum_t> > column_t;
+typedef std::vector<column_t, arena_allocator_t<column_t> > columns_t;
+
+class batch_expr_node_t {
+public:
+    virtual ~batch_expr_node_t() { }
+    virtual void eval(const std::vector<datum_t> &rows,
+                      arena_t *arena,
+                      column_t *out) const = 0;
+};
+
+namespace {
+
+class var_node_t : public batch_expr_node_t {
+public:
+    void eval(const std::vector<datum_t> &rows, arena_t *, column_t *out) const {
+        out->assign(rows.begin(), rows.end());
+    }
+};
+
+class literal_node_t : public batch_expr_node_t {
+public:
+    explicit literal_node_t(datum_t _value) : value(std::move(_value)) { }
+    void eval(const std::vector<datum_t> &rows, arena_t *, column_t *out) const {
+        out->assign(rows.size(), value);
+    }
+private:
+    datum_t value;
+};
+
+class get_field_node_t : public batch_expr_node_t {
+public:
+    get_field_node_t(scoped_ptr_t<batch_expr_node_t> &&_object,
+                     datum_string_t _field)
+        : object(std::move(_object)), field(std::move(_field)) { }
+    void eval(const std::vector<datum_t> &rows, arena_t *arena, column_t *out) const {
+        object->eval(rows, arena, out);
+        for (auto it = out->begin(); it != out->end(); ++it) {
+            // Pseudotypes get special treatment from the field access terms, and a
+            // missing field is a non-existence error that a `default` might catch.
+            if (it->has() && it->get_type() == datum_t::R_OBJECT && !it->is_ptype()) {
+                *it = it->get_field(field, NOTHROW);
+            } else {
+                *it = datum_t();
+            }
+        }
+    }
+private:
+    scoped_ptr_t<batch_expr_node_t> object;
+    datum_string_t field;
+};
+
+class nary_node_t : public batch_expr_node_t {
+public:
+    explicit nary_node_t(std::vector<scoped_ptr_t<batch_expr_node_t> > &&_args)
+        : args(std::move(_args)) { }
+    void eval(const std::vector<datum_t> &rows, arena_t *arena, column_t *out) const {
+        columns_t columns(args.size(), column_t(arena_allocator_t<datum_t>(arena)),
+                          arena_allocator_t<column_t>(arena));
+        for (size_t i = 0; i < args.size(); ++i) {
+            columns[i].reserve(rows.size());
+            args[i]->eval(rows, arena, &columns[i]);
+        }
+        out->resize(rows.size());
+        for (size_t row = 0; row < rows.size(); ++row) {
+            (*out)[row] = combine(columns, row);
+        }
+    }
+private:
+    virtual datum_t combine(const columns_t &columns, size_t row) const = 0;
+    std::vector<scoped_ptr_t<batch_expr_node_t> > args;
+};
+
+// Matches `predicate_term_t`.
+class compare_node_t : public nary_node_t {
+public:
+    compare_node_t(Term::TermType _type,
+                   std::vector<scoped_ptr_t<batch_expr_node_t> > &&_args)
+        : nary_node_t(std::move(_args)), type(_type) { }
+private:
+    datum_t combine(const columns_t &columns, size_t row) const {
+        for (const auto &column : columns) {
+            if (!column[row].has()) {
+                return datum_t();
+            }
+        }
+        const bool invert = type == Term::NE;
+        try {
+            for (size_t i = 1; i < columns.size(); ++i) {
+                if (!holds(columns[i - 1][row], columns[i][row])) {
+                    return datum_t::boolean(false ^ invert);
+                }
+            }
+        } catch (const base_exc_t &) {
+            return datum_t();
+        }
+        return datum_t::boolean(true ^ invert);
+    }
+    bool holds(const datum_t &lhs, const datum_t &rhs) const {
+        switch (static_cast<int>(type)) {
+        case Term::EQ: // fallthru
+        case Term::NE: return lhs == rhs;
+        case Term::LT: return lhs.cmp(rhs) < 0;
+        case Term::LE: return lhs.cmp(rhs) <= 0;
+        case Term::GT: return lhs.cmp(rhs) > 0;
+        case Term::GE: return lhs.cmp(rhs) >= 0;
+        default: unreachable();
+        }
+    }
+    Term::TermType type;
+};
+
+// Matches `arith_term_t`, but only for numbers.
+class arith_node_t : public nary_node_t {
+public:
+    arith_node_t(Term::TermType _type,
+                 std::vector<scoped_ptr_t<batch_expr_node_t> > &&_args)
+        : nary_node_t(std::move(_args)), type(_type) { }
+private:
+    datum_t combine(const columns_t &columns, size_t row) const {
+        for (const auto &column : columns) {
+            if (!column[row].has() || column[row].get_type() != datum_t::R_NUM) {
+                return datum_t();
+            }
+        }
+        double acc = columns[0][row].as_num();
+        for (size_t i = 1; i < columns.size(); ++i) {
+            const double rhs = columns[i][row].as_num();
+            switch (static_cast<int>(type)) {
+            case Term::ADD: acc += rhs; break;
+            case Term::SUB: acc -= rhs; break;
+            case Term::MUL: acc *= rhs; break;
+            case Term::DIV:
+                if (rhs == 0) {
+                    return datum_t();
+                }
+                acc /= rhs;
+                break;
+            default: unreachable();
+            }
+            // `datum_t` refuses non-finite numbers.
+            if (!std::isfinite(acc)) {
+                return datum_t();
+            }
+        }
+        return datum_t(acc);
+    }
+    Term::TermType type;
+};
+
+// Matches `and_term_t` and `or_term_t`.  All arguments get evaluated, which is fine
+// since none of the supported terms have side effects.
+class logic_node_t : public nary_node_t {
+public:
+    logic_node_t(bool _is_or, std::vector<scoped_ptr_t<batch_expr_node_t> > &&_args)
+        : nary_node_t(std::move(_args)), is_or(_is_or) { }
+private:
+    datum_t combine(const columns_t &columns, size_t row) const {
+        datum_t res = datum_t::boolean(!is_or);
+        for (const auto &column : columns) {
+            res = column[row];
+            if (!res.has() || res.as_bool() == is_or) {
+                break;
+            }
+        }
+        return res;
+    }
+    bool is_or;
+};
+
+class not_node_t : public nary_node_t {
+public:
+    explicit not_node_t(std::vector<scoped_ptr_t<batch_expr_node_t> > &&_args)
+        : nary_node_t(std::move(_args)) { }
+private:
+    datum_t combine(const columns_t &columns, size_t row) const {
+        const datum_t &arg = columns[0][row];
+        return arg.has() ? datum_t::boolean(!arg.as_bool()) : datum_t();
+    }
+};
+
+scoped_ptr_t<batch_expr_node_t> compile_node(const std::vector<sym_t> &arg_names,
+                                             const raw_term_t &term) {
+    scoped_ptr_t<batch_expr_node_t> none;
+    if (term.num_optargs() != 0) {
+        return none;
+    }
+
+    switch (static_cast<int>(term.type())) {
+    case Term::VAR: {
+        if (term.num_args() != 1 || term.arg(0).type() != Term::DATUM) {
+            return none;
+        }
+        const datum_t var = term.arg(0).datum();
+        if (var.get_type() != datum_t::R_NUM || var.as_num() != arg_names[0].value) {
+            return none;
+        }
+        return make_scoped<var_node_t>();
+    }
+    case Term::IMPLICIT_VAR:
+        if (!function_emits_implicit_variable(arg_names)) {
+            return none;
+        }
+        return make_scoped<var_node_t>();
+    case Term::DATUM: {
+        const datum_t value = term.datum();
+        switch (value.get_type()) {
+        case datum_t::R_NULL: // fallthru
+        case datum_t::R_BOOL: // fallthru
+        case datum_t::R_NUM: // fallthru
+        case datum_t::R_STR:
+            return make_scoped<literal_node_t>(value);
+        default:
+            return none;
+        }
+    }
+    case Term::GET_FIELD: // fallthru
+    case Term::BRACKET: {
+        if (term.num_args() != 2 || term.arg(1).type() != Term::DATUM) {
+            return none;
+        }
+        const datum_t field = term.arg(1).datum();
+        if (field.get_type() != datum_t::R_STR) {
+            return none;
+        }
+        scoped_ptr_t<batch_expr_node_t> object = compile_node(arg_names, term.arg(0));
+        if (!object.has()) {
+            return none;
+        }
+        return make_scoped<get_field_node_t>(std::move(object), field.as_str());
+    }
+    default:
+        break;
+    }
+
+    size_t min_args;
+    size_t max_args = SIZE_MAX;
+    switch (static_cast<int>(term.type())) {
+    case Term::EQ: // fallthru
+    case Term::NE: // fallthru
+    case Term::LT: // fallthru
+    case Term::LE: // fallthru
+    case Term::GT: // fallthru
+    case Term::GE: min_args = 2; break;
+    case Term::ADD: // fallthru
+    case Term::SUB: // fallthru
+    case Term::MUL: // fallthru
+    case Term::DIV: min_args = 1; break;
+    case Term::AND: // fallthru
+    case Term::OR: min_args = 0; break;
+    case Term::NOT: min_args = 1; max_args = 1; break;
+    default: return none;
+    }
+    if (term.num_args() < min_args || term.num_args() > max_args) {
+        return none;
+    }
+
+    std::vector<scoped_ptr_t<batch_expr_node_t> > args;
+    args.reserve(term.num_args());
+    for (size_t i = 0; i < term.num_args(); ++i) {
+        args.push_back(compile_node(arg_names, term.arg(i)));
+        if (!args.back().has()) {
+            return none;
+        }
+    }
+
+    switch (static_cast<int>(term.type())) {
+    case Term::AND: return make_scoped<logic_node_t>(false, std::move(args));
+    case Term::OR: return make_scoped<logic_node_t>(true, std::move(args));
+    case Term::NOT: return make_scoped<not_node_t>(std::move(args));
+    case Term::ADD: // fallthru
+    case Term::SUB: // fallthru
+    case Term::MUL: // fallthru
+    case Term::DIV: return make_scoped<arith_node_t>(term.type(), std::move(args));
+    default: return make_scoped<compare_node_t>(term.type(), std::move(args));
+    }
+}
+
+}  // namespace
+
+batch_expr_t::batch_expr_t(scoped_ptr_t<batch_expr_node_t> &&_root)
+    : root(std::move(_root)) { }
+
+batch_expr_t::~batch_expr_t() { }
+
+scoped_ptr_t<batch_expr_t> batch_expr_t::compile(const std::vector<sym_t> &arg_names,
+                                                 const raw_term_t &body) {
+    // A constant body isn't worth it, and `filter` treats literal objects specially.
+    if (arg_names.size() != 1 || body.type() == Term::DATUM) {
+        return scoped_ptr_t<batch_expr_t>();
+    }
+    scoped_ptr_t<batch_expr_node_t> root = compile_node(arg_names, body);
+    if (!root.has()) {
+        return scoped_ptr_t<batch_expr_t>();
+    }
+    return scoped_ptr_t<batch_expr_t>(new batch_expr_t(std::move(root)));
+}
+
+void batch_expr_t::eval(const std::vector<datum_t> &rows,
+                        std::vector<datum_t> *results_out,
+                        arena_t *arena) const {
+    {
+        column_t column{arena_allocator_t<datum_t>(arena)};
+        column.reserve(rows.size());
+        root->eval(rows, arena, &column);
+        rassert(column.size() == rows.size());
+        results_out->clear();
+        results_out->reserve(column.size());
+        std::move(column.begin(), column.end(), std::back_inserter(*results_out));
+    }
+    if (arena != nullptr) {
+        arena->reset();
+    }
+}
+
+}  // namespace ql
@@ -0,0 +1,52 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_BATCH_EXPR_HPP_
+#define RDB_PROTOCOL_BATCH_EXPR_HPP_
+
+#include <vector>
+
+#include "containers/arena.hpp"
+#include "containers/scoped.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/sym.hpp"
+#include "rdb_protocol/term_storage.hpp"
+
+namespace ql {
+
+class batch_expr_node_t;
+
+/* A `batch_expr_t` evaluates the body of a one-argument function over a whole batch of
+rows at once, one term at a time instead of one row at a time.  Only a handful of pure
+terms are supported: variable and field access, scalar literals, comparisons, numeric
+arithmetic and `and`/`or`/`not`.
+
+Evaluation never throws.  If a row hits anything the batch evaluator doesn't handle
+exactly like the regular term classes (a missing field, a type mismatch, a division by
+zero, ...), its result is left empty and the caller has to evaluate the function on
+that row the usual way.  That way errors and default values behave exactly as before. */
+class batch_expr_t {
+public:
+    ~batch_expr_t();
+
+    // Returns an empty pointer if `body` uses anything we can't evaluate in batches.
+    static scoped_ptr_t<batch_expr_t> compile(const std::vector<sym_t> &arg_names,
+                                              const raw_term_t &body);
+
+    // Sets `(*results_out)[i]` to the result for `rows[i]`, or to an empty datum if
+    // the row needs to be evaluated by the regular function.  The intermediate columns
+    // get allocated from `arena` if it's not null, and the arena gets reset afterwards,
+    // so nothing else may be using it.
+    void eval(const std::vector<datum_t> &rows,
+              std::vector<datum_t> *results_out,
+              arena_t *arena = nullptr) const;
+
+private:
+    explicit batch_expr_t(scoped_ptr_t<batch_expr_node_t> &&_root);
+
+    scoped_ptr_t<batch_expr_node_t> root;
+
+    DISABLE_COPYING(batch_expr_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_BATCH_EXPR_HPP_
@@ -2,8 +2,11 @@
 #include "rdb_protocol/btree.hpp"
 
 #include <algorithm>
+#include <exception>
 #include <functional>
 #include <iterator>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -11,12 +14,14 @@
 #include "btree/concurrent_traversal.hpp"
 #include "btree/get_distribution.hpp"
 #include "btree/operations.hpp"
+#include "btree/primary_key_filter.hpp"
 #include "btree/reql_specific.hpp"
 #include "btree/superblock.hpp"
 #include "buffer_cache/serialize_onto_blob.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/new_mutex.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
+#include "config/args.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/buffer_group_stream.hpp"
 #include "containers/archive/buffer_stream.hpp"
@@ -24,6 +29,7 @@
 #include "rdb_protocol/geo/exceptions.hpp"
 #include "rdb_protocol/geo/indexing.hpp"
 #include "rdb_protocol/blob_wrapper.hpp"
+#include "rdb_protocol/field_predicate.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/geo_traversal.hpp"
 #include "rdb_protocol/lazy_btree_val.hpp"
@@ -141,7 +147,8 @@ kv_location_set(keyvalue_location_t *kv_location,
                 ql::datum_t data,
                 repli_timestamp_t timestamp,
                 const deletion_context_t *deletion_context,
-                rdb_modification_info_t *mod_info_out) THROWS_NOTHING {
+                rdb_modification_info_t *mod_info_out,
+                const shared_buf_t *checked_buf = nullptr) THROWS_NOTHING {
     scoped_malloc_t<rdb_value_t> new_value(blob::btree_maxreflen);
     memset(new_value.get(), 0, blob::btree_maxreflen);
 
@@ -150,7 +157,7 @@ kv_location_set(keyvalue_location_t *kv_location,
         blob_t blob(block_size, new_value->value_ref(), blob::btree_maxreflen);
         ql::serialization_result_t res
             = datum_serialize_onto_blob(buf_parent_t(&kv_location->buf),
-                                        &blob, data);
+                                        &blob, data, checked_buf);
         if (bad(res)) return res;
     }
 
@@ -220,6 +227,11 @@ batched_replace_response_t rdb_replace_and_return_superblock(
     const datum_string_t &primary_key = info.btree->primary_key;
     const store_key_t &key = *info.key;
 
+    if (info.btree->slice->primary_key_filter != nullptr) {
+        // This has to happen while we still hold the superblock.
+        info.btree->slice->primary_key_filter->add(key);
+    }
+
     try {
         keyvalue_location_t kv_location;
         rdb_value_sizer_t sizer(info.superblock->cache()->max_block_size());
@@ -269,10 +281,15 @@ batched_replace_response_t rdb_replace_and_return_superblock(
                                    mod_info_out);
             } else {
                 r_sanity_check(new_val.get_field(primary_key, ql::NOTHROW).has());
+                // Fields that `replacer` took over from the old row unchanged still
+                // point into its buffer, so we can copy their serialization.
+                const shared_buf_ref_t<char> *old_buf = old_val.get_buf_ref();
                 ql::serialization_result_t res =
                     kv_location_set(&kv_location, *info.key, new_val,
                                     info.btree->timestamp, deletion_context,
-                                    mod_info_out);
+                                    mod_info_out,
+                                    old_buf != nullptr ? old_buf->get_buf().get()
+                                                       : nullptr);
                 if (res & ql::serialization_result_t::ARRAY_TOO_BIG) {
                     rfail_typed_target(&new_val, "Array too large for disk writes "
                                        "(limit 100,000 elements).");
@@ -510,6 +527,10 @@ void rdb_set(const store_key_t &key,
              rdb_modification_info_t *mod_info,
              profile::trace_t *trace,
              promise_t<superblock_t *> *pass_back_superblock) {
+    if (slice->primary_key_filter != nullptr) {
+        // This has to happen while we still hold the superblock.
+        slice->primary_key_filter->add(key);
+    }
     keyvalue_location_t kv_location;
     rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
     find_keyvalue_location_for_write(&sizer, superblock, key.btree_key(), timestamp,
@@ -580,6 +601,17 @@ void rdb_value_deleter_t::delete_value(buf_parent_t parent, const void *value) c
     rdb_value_sizer_t sizer(parent.cache()->max_block_size());
     scoped_malloc_t<rdb_value_t> value_copy(sizer.max_possible_size());
     memcpy(value_copy.get(), value, sizer.size(value));
+    if (lazy_blob_store != nullptr) {
+        blob_t blob(parent.cache()->max_block_size(),
+                    value_copy->value_ref(),
+                    blob::btree_maxreflen);
+        if (blob.valuesize() >= LAZY_BLOB_DELETION_MIN_SIZE) {
+            const char *data = reinterpret_cast<const char *>(value_copy.get());
+            lazy_blob_store->delete_blob_later(
+                std::vector<char>(data, data + sizer.size(value)));
+            return;
+        }
+    }
     actually_delete_rdb_value(parent, value_copy.get());
 }
 
@@ -637,6 +669,7 @@ public:
         : env(_env),
           batcher(make_scoped<ql::batcher_t>(batchspec.to_batcher())),
           sorting(_sorting),
+          batched(!_terminal.has_value()),
           accumulator(_terminal.has_value()
                       ? ql::make_terminal(*_terminal)
                       : ql::make_append(std::move(region),
@@ -648,6 +681,31 @@ public:
             transformers.push_back(ql::make_op(_transforms[i]));
         }
         guarantee(transformers.size() == _transforms.size());
+
+        // If the first transformation only picks out some top-level fields of the
+        // row, the rest of the row never needs to be read.
+        if (!_transforms.empty()) {
+            const ql::map_wire_func_t *map
+                = boost::get<ql::map_wire_func_t>(&_transforms[0]);
+            std::vector<datum_string_t> fields;
+            if (map != nullptr
+                && map->compile_wire_func()->get_top_level_fields_read(&fields)) {
+                projected_fields.set(std::move(fields));
+            }
+
+            // If the first transformation is a filter comparing one field with a
+            // constant, rows failing it don't need to be loaded at all.  Profiling
+            // wants to see the filter being evaluated on every row.
+            const ql::filter_wire_func_t *filter
+                = boost::get<ql::filter_wire_func_t>(&_transforms[0]);
+            if (filter != nullptr
+                && env->profile() == profile_bool_t::DONT_PROFILE) {
+                counted_t<const ql::func_t> f = filter->filter_func.compile_wire_func();
+                if (f->get_field_predicate() != nullptr) {
+                    prefilter = std::move(f);
+                }
+            }
+        }
     }
     job_data_t(job_data_t &&) = default;
 
@@ -659,7 +717,13 @@ private:
     ql::env_t *const env;
     scoped_ptr_t<ql::batcher_t> batcher;
     std::vector<scoped_ptr_t<ql::op_t> > transformers;
+    // The only fields of a row that the transformations look at, if we know them.
+    optional<std::vector<datum_string_t> > projected_fields;
+    // The first transformation's filter function, if it has a field predicate.
+    counted_t<const ql::func_t> prefilter;
     sorting_t sorting;
+    // Whether the read may stop before the end of its range.  Terminals can't.
+    bool batched;
     scoped_ptr_t<ql::accumulator_t> accumulator;
 };
 
@@ -674,6 +738,16 @@ private:
 };
 
 
+// Returns true if `pred` is certainly false for the stored row, reading only the
+// fields it needs.
+bool prefilter_rejects(const ql::field_predicate_t *pred, const lazy_btree_val_t &row) {
+    optional<bool> res = pred->eval_field(row.get_field(pred->get_field()));
+    // Field accesses on pseudotypes behave differently, so we leave those to the
+    // real filter.
+    return res.has_value() && !*res
+        && !row.get_field(ql::datum_t::reql_type_string).has();
+}
+
 class rget_cb_t {
 public:
     rget_cb_t(rget_io_data_t &&_io,
@@ -697,6 +771,8 @@ private:
     // State for internal bookkeeping.
     bool bad_init;
     optional<std::string> last_truncated_secondary_for_abort;
+    // How many rows have gone into the accumulator
+    uint64_t rows_accumulated;
     scoped_ptr_t<profile::disabler_t> disabler;
     scoped_ptr_t<profile::sampler_t> sampler;
 };
@@ -726,13 +802,54 @@ private:
     optional<std::string> skey_left;
 };
 
+/* Like `rget_cb_wrapper_t`, but only passes on the given primary keys, each with its
+own number of copies. This lets a `get_all` on the primary index read all of its keys
+in a single traversal, which skips the subtrees that contain none of the keys and
+acquires each leaf once for all of the keys in it, instead of descending from the root
+once for every key. */
+class rget_keys_cb_wrapper_t : public concurrent_traversal_callback_t {
+public:
+    rget_keys_cb_wrapper_t(
+            rget_cb_t *_cb,
+            const std::map<store_key_t, uint64_t> *_keys)
+        : cb(_cb), keys(_keys) { }
+    virtual void filter_range(
+            const btree_key_t *left_excl_or_null,
+            const btree_key_t *right_incl,
+            bool *skip_out) {
+        auto it = left_excl_or_null == nullptr
+            ? keys->begin()
+            : keys->upper_bound(store_key_t(left_excl_or_null));
+        *skip_out = it == keys->end() || store_key_t(right_incl) < it->first;
+    }
+    virtual void filter_key(const btree_key_t *key, bool *skip_out) {
+        *skip_out = keys->count(store_key_t(key)) == 0;
+    }
+    virtual continue_bool_t handle_pair(
+        scoped_key_value_t &&keyvalue,
+        concurrent_traversal_fifo_enforcer_signal_t waiter)
+        THROWS_ONLY(interrupted_exc_t) {
+        auto it = keys->find(store_key_t(keyvalue.key()));
+        guarantee(it != keys->end());
+        return cb->handle_pair(
+            std::move(keyvalue),
+            it->second,
+            r_nullopt,
+            std::move(waiter));
+    }
+private:
+    rget_cb_t *cb;
+    const std::map<store_key_t, uint64_t> *keys;
+};
+
 rget_cb_t::rget_cb_t(rget_io_data_t &&_io,
                      job_data_t &&_job,
                      optional<rget_sindex_data_t> &&_sindex)
     : io(std::move(_io)),
       job(std::move(_job)),
       sindex(std::move(_sindex)),
-      bad_init(false) {
+      bad_init(false),
+      rows_accumulated(0) {
 
     if (sindex) {
         // Secondary index functions are deterministic (so no need for an
@@ -772,18 +889,36 @@ continue_bool_t rget_cb_t::handle_pair(
     }
     // Load the key and value.
     store_key_t key(keyvalue.key());
+    ql::query_stats_t *query_stats = job.env->query_stats();
+    if (sindex && query_stats != nullptr) {
+        ++query_stats->sindex_entries_scanned;
+    }
     if (sindex && !sindex->pkey_range.contains_key(ql::datum_t::extract_primary(key))) {
         return continue_bool_t::CONTINUE;
     }
+    if (query_stats != nullptr) {
+        ++query_stats->rows_read;
+    }
     lazy_btree_val_t row(static_cast<const rdb_value_t *>(keyvalue.value()),
                          keyvalue.expose_buf());
     ql::datum_t val;
     // Count stats whether or not we deserialize the value
     io.slice->stats.pm_keys_read.record();
     io.slice->stats.pm_total_keys_read += 1;
+    // Rows that the first filter is going to drop anyway don't need to be loaded.
+    // We still pass an empty batch through the transformations and the accumulator
+    // below, just as the filter would.  Secondary index reads look at the whole row
+    // earlier on, so they don't bother.
+    const bool prefiltered = job.prefilter.has() && !sindex
+        && prefilter_rejects(job.prefilter->get_field_predicate(), row);
     // We only load the value if we actually use it (`count` does not).
-    if (job.accumulator->uses_val() || job.transformers.size() != 0 || sindex) {
-        val = row.get();
+    if (prefiltered) {
+        row.reset();
+    } else if (job.accumulator->uses_val() || job.transformers.size() != 0 || sindex) {
+        // The sindex function might look at any part of the row.
+        val = job.projected_fields.has_value() && !sindex
+            ? row.get_projection(*job.projected_fields)
+            : row.get();
     } else {
         row.reset();
     }
@@ -862,7 +997,7 @@ continue_bool_t rget_cb_t::handle_pair(
         // Check whether we're outside the sindex range.
         // We only need to check this if we are on the boundary of the sindex range, and
         // the involved keys are truncated.
-        size_t copies = default_copies;
+        size_t copies = prefiltered ? 0 : default_copies;
         if (sindex) {
             /* Here's an attempt at explaining the different case distinctions handled in
                this check (for the left bound; the right bound check is similar):
@@ -950,14 +1085,20 @@ continue_bool_t rget_cb_t::handle_pair(
             },
             [&](const std::map<ql::datum_t, uint64_t> &) {
                 guarantee(skey_left);
-                std::string skey_current =
-                    ql::datum_t::extract_secondary(key_to_unescaped_str(key));
-                const bool skey_current_is_truncated =
-                    skey_current.size() >= max_trunc_size;
-                const bool skey_left_is_truncated = skey_left->size() >= max_trunc_size;
-
-                if (skey_current_is_truncated || skey_left_is_truncated) {
-                    copies = sindex->datumspec.copies(lazy_sindex_val());
+                // `skey_left` is the untruncated key of the value we're looking up,
+                // so we only have to compute the sindex value if the current key
+                // was truncated when it was written, and even then only if the
+                // part that's left matches.
+                ql::components_t components =
+                    ql::datum_t::extract_all(key_to_unescaped_str(key));
+                const std::string &skey_current = components.secondary;
+                if (ql::datum_t::secondary_is_truncated(components)) {
+                    if (skey_left->compare(
+                            0, skey_current.size(), skey_current) == 0) {
+                        copies = sindex->datumspec.copies(lazy_sindex_val());
+                    } else {
+                        copies = 0;
+                    }
                 } else if (*skey_left != skey_current) {
                     copies = 0;
                 }
@@ -974,7 +1115,23 @@ continue_bool_t rget_cb_t::handle_pair(
         }
         // We need lots of extra data for the accumulation because we might be
         // accumulating `rget_item_t`s for a batch.
+        bool accumulates_rows = false;
+        for (const auto &pair : data) {
+            accumulates_rows |= !pair.second.empty();
+        }
         continue_bool_t cont = (*job.accumulator)(job.env, &data, key, lazy_sindex_val);
+        // Range reads are snapshotted, and while the cache's snapshots hold on to too
+        // many old versions of pages, a batched read ends with this key as if the
+        // batch were full.  The next batch goes on from here with a new snapshot.
+        if (accumulates_rows) {
+            ++rows_accumulated;
+            if (cont == continue_bool_t::CONTINUE
+                && job.batched
+                && rows_accumulated >= SNAPSHOT_MEMORY_LIMIT_MIN_ROWS
+                && io.slice->cache()->snapshot_memory_limit_exceeded()) {
+                cont = continue_bool_t::ABORT;
+            }
+        }
         if (remember_key_for_sindex_batching) {
             if (cont == continue_bool_t::ABORT) {
                 last_truncated_secondary_for_abort.set(
@@ -1034,33 +1191,27 @@ void rdb_rget_slice(
     direction_t direction = reversed(sorting) ? BACKWARD : FORWARD;
     continue_bool_t cont = continue_bool_t::CONTINUE;
     if (primary_keys.has_value()) {
-        auto cb = [&](const std::pair<store_key_t, uint64_t> &pair, bool is_last) {
-            rget_cb_wrapper_t wrapper(&callback, pair.second, r_nullopt);
-            return btree_concurrent_traversal(
+        // The traversal skips the subtrees without any of the keys, so it helps to
+        // drop the keys that the primary key filter rules out first.
+        const std::map<store_key_t, uint64_t> *keys = &*primary_keys;
+        std::map<store_key_t, uint64_t> filtered_keys;
+        if (slice->primary_key_filter != nullptr) {
+            for (const auto &pair : *primary_keys) {
+                if (slice->primary_key_filter->may_contain(pair.first)) {
+                    filtered_keys.insert(filtered_keys.end(), pair);
+                }
+            }
+            keys = &filtered_keys;
+        }
+        if (!keys->empty()) {
+            rget_keys_cb_wrapper_t wrapper(&callback, keys);
+            cont = btree_concurrent_traversal(
                 superblock,
-                key_range_t::one_key(pair.first),
+                key_range_t(key_range_t::closed, keys->begin()->first,
+                            key_range_t::closed, keys->rbegin()->first),
                 &wrapper,
                 direction,
-                is_last ? release_superblock : release_superblock_t::KEEP);
-        };
-        if (!reversed(sorting)) {
-            for (auto it = primary_keys->begin(); it != primary_keys->end();) {
-                auto this_it = it++;
-                if (cb(*this_it, it == primary_keys->end()) == continue_bool_t::ABORT) {
-                    // If required the superblock will get released further up the stack.
-                    cont = continue_bool_t::ABORT;
-                    break;
-                }
-            }
-        } else {
-            for (auto it = primary_keys->rbegin(); it != primary_keys->rend();) {
-                auto this_it = it++;
-                if (cb(*this_it, it == primary_keys->rend()) == continue_bool_t::ABORT) {
-                    // If required the superblock will get released further up the stack.
-                    cont = continue_bool_t::ABORT;
-                    break;
-                }
-            }
+                release_superblock);
         }
     } else {
         rget_cb_wrapper_t wrapper(&callback, 1, r_nullopt);
@@ -1124,7 +1275,8 @@ void rdb_rget_secondary_slice(
         rget_cb_wrapper_t wrapper(
             &callback,
             pair.second,
-            make_optional(key_to_unescaped_str(sindex_keyrange.left)));
+            make_optional(
+                pair.first.get_left_bound_untrunc_key(sindex_func_reql_version)));
         key_range_t active_range = active_region_range.intersection(sindex_keyrange);
         // This can happen sometimes with truncated keys.
         if (active_range.is_empty()) return continue_bool_t::CONTINUE;
@@ -1152,6 +1304,7 @@ void rdb_get_intersecting_slice(
         const key_range_t &pk_range,
         const sindex_disk_info_t &sindex_info,
         is_stamp_read_t is_stamp_read,
+        geo_covering_cache_t *covering_cache,
         rget_read_response_t *response) {
     guarantee(query_geometry.has());
 
@@ -1176,6 +1329,7 @@ void rdb_get_intersecting_slice(
         geo_sindex_data_t(pk_range, sindex_info.mapping,
                           sindex_func_reql_version, sindex_info.multi),
         query_geometry,
+        covering_cache,
         response);
     continue_bool_t cont = btree_concurrent_traversal(
         superblock, sindex_range, &callback,
@@ -1242,6 +1396,13 @@ void rdb_get_nearest_slice(
                       std::back_inserter(*full_res));
         }
     } while (state.proceed_to_next_batch() == continue_bool_t::CONTINUE);
+    // Every batch covers a ring that is farther out than the previous one, so the
+    // results are sorted by distance already.
+    auto full_res = boost::get<nearest_geo_read_response_t::result_t>(
+        &response->results_or_error);
+    if (full_res->size() > max_results) {
+        full_res->resize(max_results);
+    }
 }
 
 void rdb_distribution_get(int max_depth,
@@ -1385,21 +1546,36 @@ void rdb_modification_report_cb_t::on_mod_report(
     new_mutex_in_line_t *sindex_spot,
     rwlock_in_line_t *cfeed_stamp_spot) {
     if (report.info.deleted.first.has() || report.info.added.first.has()) {
+        sindex_spot->acq_signal()->wait_lazily_unordered();
+        auto cserver = store_->changefeed_server(report.primary_key);
+        if (sindexes_.empty() && cserver.first == nullptr) {
+            // Without indexes or changefeeds, all that's left to do is to hand the
+            // report to indexes that are still being constructed (if any) and to
+            // free the old value.
+            store_->sindex_queue_push(report, sindex_spot);
+            if (report.info.deleted.first.has()) {
+                rdb_live_deletion_context_t deletion_context(store_);
+                deletion_context.post_deleter()->delete_value(
+                    buf_parent_t(sindex_block_->txn()),
+                    report.info.deleted.second.data());
+            }
+            return;
+        }
+
         // We spawn the sindex update in its own coroutine because we don't want to
-        // hold the sindex update for the changefeed update or vice-versa.
+        // hold the sindex update for the changefeed update or vice-versa.  It can
+        // refer to `report` because we wait for it below.
         cond_t sindexes_updated_cond, keys_available_cond;
         index_vals_t old_cfeed_keys, new_cfeed_keys;
-        sindex_spot->acq_signal()->wait_lazily_unordered();
         coro_t::spawn_now_dangerously(
             std::bind(&rdb_modification_report_cb_t::on_mod_report_sub,
                       this,
-                      report,
+                      std::cref(report),
                       sindex_spot,
                       &keys_available_cond,
                       &sindexes_updated_cond,
                       &old_cfeed_keys,
                       &new_cfeed_keys));
-        auto cserver = store_->changefeed_server(report.primary_key);
         if (update_pkey_cfeeds && cserver.first != nullptr) {
             cserver.first->foreach_limit(
                 r_nullopt,
@@ -1451,7 +1627,7 @@ void rdb_modification_report_cb_t::on_mod_report_sub(
     index_vals_t *cfeed_old_keys_out,
     index_vals_t *cfeed_new_keys_out) {
     store_->sindex_queue_push(mod_report, spot);
-    rdb_live_deletion_context_t deletion_context;
+    rdb_live_deletion_context_t deletion_context(store_);
     rdb_update_sindexes(store_,
                         sindexes_,
                         &mod_report,
@@ -1464,11 +1640,19 @@ void rdb_modification_report_cb_t::on_mod_report_sub(
     done_cond->pulse();
 }
 
+/* The grid keys of the geometries that `compute_keys()` covered for one modification.
+The old and the new version of a row usually have the same geometry, because most
+writes change other fields, and then the second `compute_keys()` can skip computing
+the geometry's covering again. */
+typedef std::map<ql::datum_t, std::vector<std::string> > geo_grid_keys_memo_t;
+
 std::vector<std::string> expand_geo_key(
         reql_version_t reql_version,
         const ql::datum_t &key,
         const store_key_t &primary_key,
-        optional<uint64_t> tag_num) {
+        optional<uint64_t> tag_num,
+        const geo_covering_t &geo_covering,
+        geo_grid_keys_memo_t *memo) {
     // Ignore non-geometry objects in geo indexes.
     // TODO (daniel): This needs to be changed once compound geo index
     // support gets added.
@@ -1477,8 +1661,16 @@ std::vector<std::string> expand_geo_key(
     }
 
     try {
-        std::vector<std::string> grid_keys =
-            compute_index_grid_keys(key, GEO_INDEX_GOAL_GRID_CELLS);
+        std::vector<std::string> grid_keys;
+        if (memo != nullptr && memo->count(key) != 0) {
+            grid_keys = memo->at(key);
+        } else {
+            grid_keys = compute_index_grid_keys(key, geo_covering.max_cells,
+                geo_covering.min_level, geo_covering.max_level);
+            if (memo != nullptr) {
+                memo->insert(std::make_pair(key, grid_keys));
+            }
+        }
 
         std::vector<std::string> result;
         result.reserve(grid_keys.size());
@@ -1506,36 +1698,55 @@ std::vector<std::string> expand_geo_key(
     }
 }
 
+/* The definition of a secondary index together with the environment its function is
+evaluated in, so that the rows of a batch don't each build their own.  Secondary index
+functions are deterministic (so no need for an rdb_context_t) and evaluated in a
+pristine environment (without global optargs).  Must not be shared between
+coroutines. */
+class sindex_env_t {
+public:
+    explicit sindex_env_t(std::shared_ptr<const sindex_disk_info_t> _info)
+        : info(std::move(_info)),
+          env(&non_interruptor,
+              ql::return_empty_normal_batches_t::NO,
+              info->mapping_version_info.latest_compatible_reql_version) { }
+
+    ql::env_t *get_env() { return &env; }
+
+    const std::shared_ptr<const sindex_disk_info_t> info;
+
+private:
+    cond_t non_interruptor;
+    ql::env_t env;
+
+    DISABLE_COPYING(sindex_env_t);
+};
+
+/* `geo_memo` may be null. */
 void compute_keys(const store_key_t &primary_key,
                   ql::datum_t doc,
-                  const sindex_disk_info_t &index_info,
+                  sindex_env_t *sindex_env,
                   std::vector<std::pair<store_key_t, ql::datum_t> > *keys_out,
-                  std::vector<index_pair_t> *cfeed_keys_out) {
+                  std::vector<index_pair_t> *cfeed_keys_out,
+                  geo_grid_keys_memo_t *geo_memo = nullptr) {
 
     guarantee(keys_out->empty());
 
+    const sindex_disk_info_t &index_info = *sindex_env->info;
     const reql_version_t reql_version =
         index_info.mapping_version_info.latest_compatible_reql_version;
 
-    // Secondary index functions are deterministic (so no need for an rdb_context_t)
-    // and evaluated in a pristine environment (without global optargs).
-    cond_t non_interruptor;
-    ql::env_t sindex_env(&non_interruptor,
-                         ql::return_empty_normal_batches_t::NO,
-                         reql_version);
-
-    ql::datum_t index =
-        index_info.mapping.compile_wire_func()->call(&sindex_env, doc)->as_datum();
+    ql::datum_t index = index_info.mapping.compile_wire_func()->call(
+        sindex_env->get_env(), doc)->as_datum();
 
     if (index_info.multi == sindex_multi_bool_t::MULTI
         && index.get_type() == ql::datum_t::R_ARRAY) {
         for (uint64_t i = 0; i < index.arr_size(); ++i) {
             const ql::datum_t &skey = index.get(i, ql::THROW);
             if (index_info.geo == sindex_geo_bool_t::GEO) {
-                std::vector<std::string> geo_keys = expand_geo_key(reql_version,
-                                                                   skey,
-                                                                   primary_key,
-                                                                   make_optional(i));
+                std::vector<std::string> geo_keys = expand_geo_key(
+                    reql_version, skey, primary_key, make_optional(i),
+                    index_info.geo_covering, geo_memo);
                 for (auto it = geo_keys.begin(); it != geo_keys.end(); ++it) {
                     keys_out->push_back(std::make_pair(store_key_t(*it), skey));
                 }
@@ -1574,7 +1785,9 @@ void compute_keys(const store_key_t &primary_key,
             std::vector<std::string> geo_keys = expand_geo_key(reql_version,
                                                                index,
                                                                primary_key,
-                                                               r_nullopt);
+                                                               r_nullopt,
+                                                               index_info.geo_covering,
+                                                               geo_memo);
             for (auto it = geo_keys.begin(); it != geo_keys.end(); ++it) {
                 keys_out->push_back(std::make_pair(store_key_t(*it), index));
             }
@@ -1613,7 +1826,7 @@ void serialize_sindex_info(write_message_t *wm,
 
     serialize<cluster_version_t::LATEST_DISK>(wm, info.mapping);
     serialize<cluster_version_t::LATEST_DISK>(wm, info.multi);
-    serialize<cluster_version_t::LATEST_DISK>(wm, info.geo);
+    serialize_sindex_geo(wm, info.geo, info.geo_covering);
 }
 
 void deserialize_sindex_info(
@@ -1691,7 +1904,8 @@ void deserialize_sindex_info(
     case cluster_version_t::v2_2: // fallthru
     case cluster_version_t::v2_3: // fallthru
     case cluster_version_t::v2_4_is_latest:
-        success = deserialize_for_version(cluster_version, &read_stream, &info_out->geo);
+        success = deserialize_sindex_geo(
+            &read_stream, &info_out->geo, &info_out->geo_covering);
         throw_if_bad_deserialization(success, "sindex description");
         break;
     default: unreachable();
@@ -1724,12 +1938,14 @@ void deserialize_sindex_info_or_crash(
         });
 }
 
-/* Used below by rdb_update_sindexes. */
+/* Used below by rdb_update_sindexes.  `sindex_env` can be shared by the updates of a
+batch; if it's null, the update makes its own. */
 void rdb_update_single_sindex(
         store_t *store,
         const store_t::sindex_access_t *sindex,
         const deletion_context_t *deletion_context,
         const rdb_modification_report_t *modification,
+        sindex_env_t *sindex_env,
         size_t *updates_left,
         auto_drainer_t::lock_t,
         cond_t *keys_available_cond,
@@ -1745,12 +1961,12 @@ void rdb_update_single_sindex(
     guarantee(cfeed_old_keys_out == nullptr || cfeed_old_keys_out->size() == 0);
     guarantee(cfeed_new_keys_out == nullptr || cfeed_new_keys_out->size() == 0);
 
-    sindex_disk_info_t sindex_info;
-    try {
-        deserialize_sindex_info_or_crash(sindex->sindex.opaque_definition, &sindex_info);
-    } catch (const archive_exc_t &e) {
-        crash("%s", e.what());
+    scoped_ptr_t<sindex_env_t> local_sindex_env;
+    if (sindex_env == nullptr) {
+        local_sindex_env.init(new sindex_env_t(store->get_sindex_info(sindex->sindex)));
+        sindex_env = local_sindex_env.get();
     }
+    const sindex_disk_info_t &sindex_info = *sindex_env->info;
     // TODO(2015-01): Actually get real profiling information for
     // secondary index updates.
     profile::trace_t *const trace = nullptr;
@@ -1759,6 +1975,50 @@ void rdb_update_single_sindex(
 
     auto cserver = store->changefeed_server(modification->primary_key);
 
+    // If the secondary index is being deleted, we don't add any new values to
+    // the sindex tree.
+    // This is so we don't race against any sindex erase about who is faster
+    // (we with inserting new entries, or the erase with removing them).
+    const bool sindex_is_being_deleted = sindex->sindex.being_deleted;
+
+    // We compute the new keys before removing the old ones, so that entries that keep
+    // their key don't get deleted just to be inserted again: setting the new value
+    // overwrites them in place.  If computing them fails, the error is rethrown where
+    // we add the new entries, as if it had happened there.
+    //
+    // Both sets of keys get sorted, so that the entries of a multi index, which can
+    // be many, are visited in key order, and neighbouring entries find their leaf in
+    // the cache.
+    const auto key_less = [](const std::pair<store_key_t, ql::datum_t> &a,
+                             const std::pair<store_key_t, ql::datum_t> &b) {
+        return a.first < b.first;
+    };
+    std::vector<std::pair<store_key_t, ql::datum_t> > added_keys;
+    std::exception_ptr added_keys_error;
+    std::set<store_key_t> keys_to_overwrite;
+    geo_grid_keys_memo_t geo_memo;
+    if (!sindex_is_being_deleted && modification->info.added.first.has()) {
+        try {
+            compute_keys(
+                modification->primary_key, modification->info.added.first,
+                sindex_env, &added_keys, cfeed_new_keys_out, &geo_memo);
+        } catch (const ql::base_exc_t &) {
+            added_keys.clear();
+            added_keys_error = std::current_exception();
+        }
+        std::sort(added_keys.begin(), added_keys.end(), key_less);
+        for (const auto &pair : added_keys) {
+            keys_to_overwrite.insert(pair.first);
+        }
+    }
+    // If the row's value didn't change either, there's nothing to do for those keys.
+    const bool value_unchanged = modification->info.deleted.first.has()
+        && modification->info.added.first.has()
+        && modification->info.deleted.second == modification->info.added.second;
+    std::set<store_key_t> unchanged_keys;
+    // The entries that this removes and adds, for `store_t::sindex_stats`.
+    std::vector<store_key_t> stats_deleted_keys, stats_added_keys;
+
     if (modification->info.deleted.first.has()) {
         guarantee(!modification->info.deleted.second.empty());
         try {
@@ -1766,8 +2026,12 @@ void rdb_update_single_sindex(
 
             std::vector<std::pair<store_key_t, ql::datum_t> > keys;
             compute_keys(
-                modification->primary_key, deleted, sindex_info,
-                &keys, cfeed_old_keys_out);
+                modification->primary_key, deleted, sindex_env,
+                &keys, cfeed_old_keys_out, &geo_memo);
+            std::sort(keys.begin(), keys.end(), key_less);
+            for (const auto &pair : keys) {
+                stats_deleted_keys.push_back(pair.first);
+            }
             if (cserver.first != nullptr) {
                 cserver.first->foreach_limit(
                     make_optional(sindex->name.name),
@@ -1785,6 +2049,12 @@ void rdb_update_single_sindex(
                     }, cserver.second);
             }
             for (auto it = keys.begin(); it != keys.end(); ++it) {
+                if (keys_to_overwrite.count(it->first) != 0) {
+                    if (value_unchanged) {
+                        unchanged_keys.insert(it->first);
+                    }
+                    continue;
+                }
                 promise_t<superblock_t *> return_superblock_local;
                 {
                     keyvalue_location_t kv_location;
@@ -1822,21 +2092,19 @@ void rdb_update_single_sindex(
         }
     }
 
-    // If the secondary index is being deleted, we don't add any new values to
-    // the sindex tree.
-    // This is so we don't race against any sindex erase about who is faster
-    // (we with inserting new entries, or the erase with removing them).
-    const bool sindex_is_being_deleted = sindex->sindex.being_deleted;
     if (!sindex_is_being_deleted && modification->info.added.first.has()) {
         bool decremented_updates_left = false;
         try {
             ql::datum_t added = modification->info.added.first;
 
-            std::vector<std::pair<store_key_t, ql::datum_t> > keys;
-
-            compute_keys(
-                modification->primary_key, added, sindex_info,
-                &keys, cfeed_new_keys_out);
+            if (added_keys_error) {
+                std::rethrow_exception(added_keys_error);
+            }
+            std::vector<std::pair<store_key_t, ql::datum_t> > keys
+                = std::move(added_keys);
+            for (const auto &pair : keys) {
+                stats_added_keys.push_back(pair.first);
+            }
             if (keys_available_cond != nullptr) {
                 guarantee(*updates_left > 0);
                 decremented_updates_left = true;
@@ -1862,6 +2130,9 @@ void rdb_update_single_sindex(
                     }, cserver.second);
             }
             for (auto it = keys.begin(); it != keys.end(); ++it) {
+                if (unchanged_keys.count(it->first) != 0) {
+                    continue;
+                }
                 promise_t<superblock_t *> return_superblock_local;
                 {
                     keyvalue_location_t kv_location;
@@ -1877,6 +2148,10 @@ void rdb_update_single_sindex(
                         trace,
                         &return_superblock_local);
 
+                    // The index entry gets a copy of the row's value reference,
+                    // so reads from the index find the whole row right in the index
+                    // leaf (or in the row's blob, for large rows) and never go back
+                    // to the primary btree.
                     ql::serialization_result_t res =
                         kv_location_set(&kv_location, it->first,
                                         modification->info.added.second,
@@ -1931,6 +2206,11 @@ void rdb_update_single_sindex(
                         sindex->btree, superblock, &sindex_info});
             }, cserver.second);
     }
+
+    if (!sindex_is_being_deleted) {
+        store->sindex_stats.on_update(
+            sindex->sindex.id, sindex->name.name, stats_deleted_keys, stats_added_keys);
+    }
 }
 
 void rdb_update_sindexes(
@@ -1976,6 +2256,7 @@ void rdb_update_sindexes(
                         sindex.get(),
                         actual_deletion_context,
                         modification,
+                        nullptr,
                         &counter,
                         auto_drainer_t::lock_t(&drainer),
                         keys_available_cond,
@@ -2000,6 +2281,172 @@ void rdb_update_sindexes(
     }
 }
 
+void rdb_update_single_sindex_batch(
+        store_t *store,
+        const store_t::sindex_access_t *sindex,
+        const deletion_context_t *deletion_context,
+        const std::vector<rdb_modification_report_t> *modifications,
+        auto_drainer_t::lock_t lock)
+    THROWS_NOTHING {
+    // See the comment in `rdb_update_sindexes` about the deletion context for indexes
+    // that aren't done constructing yet.
+    rdb_noop_deletion_context_t noop_deletion_context;
+    const deletion_context_t *actual_deletion_context =
+        sindex->sindex.post_construction_complete()
+        ? deletion_context
+        : &noop_deletion_context;
+    sindex_env_t sindex_env(store->get_sindex_info(sindex->sindex));
+    for (const auto &modification : *modifications) {
+        if (!sindex->sindex.needs_post_construction_range.contains_key(
+                modification.primary_key)) {
+            rdb_update_single_sindex(store,
+                                     sindex,
+                                     actual_deletion_context,
+                                     &modification,
+                                     &sindex_env,
+                                     nullptr,
+                                     lock,
+                                     nullptr,
+                                     nullptr,
+                                     nullptr);
+        }
+    }
+}
+
+void rdb_update_sindexes(
+    store_t *store,
+    const store_t::sindex_access_vector_t &sindexes,
+    const std::vector<rdb_modification_report_t> &modifications,
+    txn_t *txn,
+    const deletion_context_t *deletion_context) {
+    {
+        auto_drainer_t drainer;
+        for (const auto &sindex : sindexes) {
+            coro_t::spawn_sometime(
+                std::bind(
+                    &rdb_update_single_sindex_batch,
+                    store,
+                    sindex.get(),
+                    deletion_context,
+                    &modifications,
+                    auto_drainer_t::lock_t(&drainer)));
+        }
+    }
+
+    /* All of the sindexes have been updated, so we can clear the deleted blobs. */
+    for (const auto &modification : modifications) {
+        if (modification.info.deleted.first.has()) {
+            deletion_context->post_deleter()->delete_value(buf_parent_t(txn),
+                    modification.info.deleted.second.data());
+        }
+    }
+}
+
+/* Inserts one index entry of `rdb_post_construct_single_sindex`. The superblock is
+passed back as soon as the insertion has descended past it, so that the next entry
+can start descending while this one still waits for its leaf. */
+void post_construct_sindex_entry(
+        sindex_superblock_t *superblock,
+        const store_key_t *key,
+        const std::vector<char> *value,
+        const rdb_post_construction_deletion_context_t *deletion_context,
+        promise_t<superblock_t *> *return_superblock,
+        auto_drainer_t::lock_t) {
+    rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+    keyvalue_location_t kv_location;
+    find_keyvalue_location_for_write(
+        &sizer,
+        superblock,
+        key->btree_key(),
+        repli_timestamp_t::distant_past,
+        deletion_context->balancing_detacher(),
+        &kv_location,
+        nullptr,
+        return_superblock);
+
+    ql::serialization_result_t res =
+        kv_location_set(&kv_location, *key, *value, repli_timestamp_t::distant_past,
+                        deletion_context);
+    // this particular context cannot fail AT THE MOMENT.
+    guarantee(!bad(res));
+}
+
+/* Inserts the index entries for a batch of rows that are being post-constructed into
+`sindex`.  Unlike `rdb_update_single_sindex`, it first computes the index keys of all
+the rows and then inserts them in index key order, so that consecutive insertions go
+to the same leaves (and keys that only grow are appended to) instead of each one
+descending to a random leaf of the index.  An index that is still being constructed
+can't have any changefeeds on it, so there's no changefeed bookkeeping to do. */
+void rdb_post_construct_single_sindex(
+        const store_t::sindex_access_t *sindex,
+        const std::vector<rdb_modification_report_t> *modifications,
+        auto_drainer_t::lock_t)
+    THROWS_NOTHING {
+    // See the comment in `rdb_update_single_sindex`.
+    if (sindex->sindex.being_deleted) {
+        return;
+    }
+
+    auto sindex_info = std::make_shared<sindex_disk_info_t>();
+    try {
+        deserialize_sindex_info_or_crash(sindex->sindex.opaque_definition,
+                                         sindex_info.get());
+    } catch (const archive_exc_t &e) {
+        crash("%s", e.what());
+    }
+    sindex_env_t sindex_env(std::move(sindex_info));
+
+    // Pairs of an index key and the index into `modifications` of its row.
+    std::vector<std::pair<store_key_t, size_t> > entries;
+    for (size_t i = 0; i < modifications->size(); ++i) {
+        const rdb_modification_report_t &modification = (*modifications)[i];
+        guarantee(!modification.info.deleted.first.has());
+        if (!modification.info.added.first.has()) {
+            continue;
+        }
+        std::vector<std::pair<store_key_t, ql::datum_t> > keys;
+        try {
+            compute_keys(modification.primary_key, modification.info.added.first,
+                         &sindex_env, &keys, nullptr);
+        } catch (const ql::base_exc_t &) {
+            // Do nothing (we just drop the row from the index).
+            continue;
+        }
+        for (auto &&pair : keys) {
+            entries.push_back(std::make_pair(std::move(pair.first), i));
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    // The entries go to disjoint keys, so their insertions are independent of each
+    // other. The buf locks keep insertions into the same leaf in order.
+    const rdb_post_construction_deletion_context_t deletion_context;
+    sindex_superblock_t *superblock = sindex->superblock.get();
+    unlimited_fifo_queue_t<std::function<void()> > coro_queue;
+    struct callback_t : public coro_pool_callback_t<std::function<void()> > {
+        virtual void coro_pool_callback(std::function<void()> f, signal_t *) {
+            f();
+        }
+    } callback;
+    coro_pool_t<std::function<void()> > coro_pool(
+        SINDEX_POST_CONSTRUCTION_MAX_CONCURRENT_WRITES, &coro_queue, &callback);
+    auto_drainer_t drainer;
+    for (const auto &entry : entries) {
+        promise_t<superblock_t *> return_superblock_local;
+        coro_queue.push(
+            std::bind(
+                &post_construct_sindex_entry,
+                superblock,
+                &entry.first,
+                &(*modifications)[entry.second].info.added.second,
+                &deletion_context,
+                &return_superblock_local,
+                auto_drainer_t::lock_t(&drainer)));
+        superblock = static_cast<sindex_superblock_t *>(
+            return_superblock_local.wait());
+    }
+}
+
 class post_construct_traversal_helper_t : public concurrent_traversal_callback_t {
 public:
     post_construct_traversal_helper_t(
@@ -2023,6 +2470,10 @@ public:
     }
 
     ~post_construct_traversal_helper_t() {
+        if (wtxn_.has()) {
+            new_mutex_acq_t wtxn_acq(&wtxn_lock_);
+            flush_pending_rows(&wtxn_acq);
+        }
         sindexes_.clear();
         if (wtxn_.has()) {
             wtxn_->commit();
@@ -2056,23 +2507,14 @@ public:
                 std::vector<char>(rdb_value->value_ref(),
                     rdb_value->value_ref() + rdb_value->inline_size(block_size)));
 
-        // Store the value into the secondary indexes
+        // Queue the row up for the secondary indexes.  It gets stored into them
+        // together with the rest of the chunk, before the write transaction commits.
         {
-            // We need this mutex because we don't want `wtxn` to be destructed,
-            // but also because only one coroutine can be traversing the indexes
-            // through `rdb_update_sindexes` at a time (or else the btree will get
-            // corrupted!).
+            // We need this mutex because we don't want `wtxn` to be destructed while
+            // the chunk is being written.
             new_mutex_acq_t wtxn_acq(&wtxn_lock_, interruptor_);
             guarantee(wtxn_.has());
-            const rdb_post_construction_deletion_context_t deletion_context;
-            rdb_update_sindexes(store_,
-                                sindexes_,
-                                &mod_report,
-                                wtxn_.get(),
-                                &deletion_context,
-                                nullptr,
-                                nullptr,
-                                nullptr);
+            pending_rows_.push_back(std::move(mod_report));
         }
 
         // Account for the sindex writes in the stats
@@ -2094,6 +2536,7 @@ public:
             ++current_chunk_size_;
             if (current_chunk_size_ >= MAX_CHUNK_SIZE) {
                 current_chunk_size_ = 0;
+                flush_pending_rows(&wtxn_acq);
                 sindexes_.clear();
                 wtxn_->commit();
                 wtxn_.reset();
@@ -2124,6 +2567,24 @@ private:
     // Also see the comment above `scoped_ptr_t<txn_t> wtxn;` below.
     static const int MAX_CHUNK_SIZE = 32;
 
+    // Stores the rows in `pending_rows_` into all the secondary indexes.
+    void flush_pending_rows(new_mutex_acq_t *wtxn_acq) {
+        wtxn_acq->guarantee_is_holding(&wtxn_lock_);
+        guarantee(wtxn_.has());
+        {
+            auto_drainer_t drainer;
+            for (const auto &sindex : sindexes_) {
+                coro_t::spawn_sometime(
+                    std::bind(
+                        &rdb_post_construct_single_sindex,
+                        sindex.get(),
+                        &pending_rows_,
+                        auto_drainer_t::lock_t(&drainer)));
+            }
+        }
+        pending_rows_.clear();
+    }
+
     void start_write_transaction(new_mutex_acq_t *wtxn_acq) {
         wtxn_acq->guarantee_is_holding(&wtxn_lock_);
         guarantee(!wtxn_.has());
@@ -2170,13 +2631,6 @@ private:
             // All indexes have been deleted. Interrupt the traversal.
             on_indexes_deleted_->pulse_if_not_already_pulsed();
         }
-
-        // We pretend that the indexes have been fully constructed, so that when we call
-        // `rdb_update_sindexes` above, it actually updates the range we're currently
-        // constructing. This is a bit hacky, but works.
-        for (auto &&access : sindexes_) {
-            access->sindex.needs_post_construction_range = key_range_t::empty();
-        }
     }
 
     store_t *store_;
@@ -2202,6 +2656,8 @@ private:
     scoped_ptr_t<txn_t> wtxn_;
     store_t::sindex_access_vector_t sindexes_;
     int current_chunk_size_;
+    // The rows of the current chunk that haven't been stored into the indexes yet.
+    std::vector<rdb_modification_report_t> pending_rows_;
     // Controls access to `sindexes_` and `wtxn_`.
     new_mutex_t wtxn_lock_;
 };
@@ -2248,7 +2704,8 @@ void post_construct_secondary_index_range(
         interruptor);
 
     cache_account
-        = txn->cache()->create_cache_account(SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY);
+        = txn->cache()->create_cache_account(SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY,
+                                             "sindex_post_construction");
     txn->set_account(&cache_account);
 
     continue_bool_t cont = btree_concurrent_traversal(
@@ -184,6 +184,7 @@ void rdb_get_intersecting_slice(
     const key_range_t &pk_range,
     const sindex_disk_info_t &sindex_info,
     is_stamp_read_t is_stamp_read,
+    geo_covering_cache_t *covering_cache,
     rget_read_response_t *response);
 
 void rdb_get_nearest_slice(
@@ -262,13 +263,15 @@ struct sindex_disk_info_t {
     sindex_disk_info_t(const ql::map_wire_func_t &_mapping,
                        const sindex_reql_version_info_t &_mapping_version_info,
                        sindex_multi_bool_t _multi,
-                       sindex_geo_bool_t _geo) :
+                       sindex_geo_bool_t _geo,
+                       const geo_covering_t &_geo_covering = geo_covering_t()) :
         mapping(_mapping), mapping_version_info(_mapping_version_info),
-        multi(_multi), geo(_geo) { }
+        multi(_multi), geo(_geo), geo_covering(_geo_covering) { }
     ql::map_wire_func_t mapping;
     sindex_reql_version_info_t mapping_version_info;
     sindex_multi_bool_t multi;
     sindex_geo_bool_t geo;
+    geo_covering_t geo_covering;
 };
 
 void serialize_sindex_info(write_message_t *wm,
@@ -337,6 +340,17 @@ void rdb_update_sindexes(
     index_vals_t *old_keys_out,
     index_vals_t *new_keys_out);
 
+/* Applies a whole batch of modifications to the secondary indexes.  Each index gets
+its own coroutine that goes through the batch in order, so the indexes are updated
+concurrently with each other for the whole batch, rather than one modification at a
+time. */
+void rdb_update_sindexes(
+    store_t *store,
+    const store_t::sindex_access_vector_t &sindexes,
+    const std::vector<rdb_modification_report_t> &modifications,
+    txn_t *txn,
+    const deletion_context_t *deletion_context);
+
 void post_construct_secondary_index_range(
         store_t *store,
         const std::set<uuid_u> &sindexes_to_post_construct,
@@ -345,10 +359,16 @@ void post_construct_secondary_index_range(
         signal_t *interruptor)
     THROWS_ONLY(interrupted_exc_t);
 
-/* This deleter actually deletes the value and all associated blocks. */
+/* This deleter actually deletes the value and all associated blocks. If it has a
+ * `lazy_blob_store`, the blocks of large values are left to that store's blob reaper
+ * instead (see `store_t::delete_blob_later`). */
 class rdb_value_deleter_t : public value_deleter_t {
 public:
+    explicit rdb_value_deleter_t(store_t *_lazy_blob_store = nullptr)
+        : lazy_blob_store(_lazy_blob_store) { }
     void delete_value(buf_parent_t parent, const void *_value) const;
+private:
+    store_t *lazy_blob_store;
 };
 
 /* A deleter that doesn't actually delete the values. Needed for secondary
@@ -363,7 +383,8 @@ public:
  * the post_deleter. */
 class rdb_live_deletion_context_t : public deletion_context_t {
 public:
-    rdb_live_deletion_context_t() { }
+    explicit rdb_live_deletion_context_t(store_t *lazy_blob_store = nullptr)
+        : deleter(lazy_blob_store) { }
     const value_deleter_t *balancing_detacher() const { return &detacher; }
     const value_deleter_t *in_tree_deleter() const { return &detacher; }
     const value_deleter_t *post_deleter() const { return &deleter; }
@@ -1,12 +1,15 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/store.hpp"  // NOLINT(build/include_order)
 
+#include <algorithm>  // NOLINT(build/include_order)
 #include <functional>  // NOLINT(build/include_order)
+#include <memory>  // NOLINT(build/include_order)
 
 #include "arch/runtime/coroutines.hpp"
 #include "btree/depth_first_traversal.hpp"
 #include "btree/node.hpp"
 #include "btree/operations.hpp"
+#include "btree/primary_key_filter.hpp"
 #include "btree/reql_specific.hpp"
 #include "btree/secondary_operations.hpp"
 #include "buffer_cache/alt.hpp"
@@ -90,13 +93,21 @@ store_t::store_t(const region_t &_region,
     : store_view_t(_region),
       perfmon_collection(),
       io_backender_(io_backender), base_path_(base_path),
+      sindex_build_priority(sindex_build_priority_t::normal),
       perfmon_collection_membership(parent_perfmon_collection, &perfmon_collection, perfmon_name),
+      sindex_stats_membership(&perfmon_collection, &sindex_stats, "sindexes"),
+      hot_keys_membership(&perfmon_collection, &hot_keys, "hot_keys"),
+      sindex_queue_mutex(lock_class_t::sindex_queue),
+      cfeed_stamp_lock(lock_class_t::changefeed_stamp),
       ctx(_ctx),
       table_id(_table_id),
-      write_superblock_acq_semaphore(WRITE_SUPERBLOCK_ACQ_WAITERS_LIMIT)
+      write_superblock_acq_semaphore(WRITE_SUPERBLOCK_ACQ_WAITERS_LIMIT),
+      blob_reaper_active(false)
 {
     cache.init(new cache_t(serializer, balancer, &perfmon_collection));
     general_cache_conn.init(new cache_conn_t(cache.get()));
+    low_io_priority_read_account = cache->create_cache_account(
+        LOW_IO_PRIORITY_READS_CACHE_PRIORITY, "low_priority_reads");
 
     if (create) {
         vector_stream_t key;
@@ -182,6 +193,24 @@ store_t::~store_t() {
     drainer.drain();
 }
 
+void store_t::set_cache_memory_bounds(uint64_t memory_reservation,
+                                      uint64_t max_memory_limit) {
+    assert_thread();
+    cache->set_memory_bounds(memory_reservation, max_memory_limit);
+}
+
+void store_t::enable_primary_key_filter() {
+    assert_thread();
+    guarantee(!primary_key_filter.has());
+    primary_key_filter.init(new primary_key_filter_t([this]() {
+        coro_t::spawn_sometime(std::bind(
+            &store_t::build_primary_key_filter, this, drainer.lock()));
+    }));
+    btree->primary_key_filter = primary_key_filter.get();
+    coro_t::spawn_sometime(std::bind(
+        &store_t::build_primary_key_filter, this, drainer.lock()));
+}
+
 void store_t::read(
         DEBUG_ONLY(const metainfo_checker_t& metainfo_checker, )
         const read_t &_read,
@@ -250,7 +279,7 @@ void store_t::reset_data(
 
     // Erase the data in small chunks
     always_true_key_tester_t key_tester;
-    const uint64_t max_erased_per_pass = 100;
+    const uint64_t max_erased_per_pass = RESET_DATA_MAX_ERASED_PER_PASS;
     for (continue_bool_t done_erasing = continue_bool_t::CONTINUE;
          done_erasing == continue_bool_t::CONTINUE;) {
         scoped_ptr_t<txn_t> txn;
@@ -335,6 +364,7 @@ std::map<std::string, std::pair<sindex_config_t, sindex_status_t> > store_t::sin
         res->first.func_version = disk_info.mapping_version_info.original_reql_version;
         res->first.multi = disk_info.multi;
         res->first.geo = disk_info.geo;
+        res->first.geo_covering = disk_info.geo_covering;
 
         res->second.outdated =
             (disk_info.mapping_version_info.latest_compatible_reql_version !=
@@ -381,7 +411,8 @@ void store_t::sindex_create(
     version_info.original_reql_version = config.func_version;
     version_info.latest_compatible_reql_version = config.func_version;
     version_info.latest_checked_reql_version = reql_version_t::LATEST;
-    sindex_disk_info_t info(config.func, version_info, config.multi, config.geo);
+    sindex_disk_info_t info(
+        config.func, version_info, config.multi, config.geo, config.geo_covering);
 
     write_message_t wm;
     serialize_sindex_info(&wm, info);
@@ -394,6 +425,7 @@ void store_t::sindex_create(
     optional<uuid_u> sindex_id = add_sindex_internal(
         sindex_name, stream.vector(), &sindex_block);
     guarantee(sindex_id, "sindex_create() called with a sindex name that exists");
+    sindex_stats.on_create(*sindex_id);
 
     // Kick off index post construction
     coro_t::spawn_sometime(std::bind(&rdb_protocol::resume_construct_sindex,
@@ -558,17 +590,8 @@ void store_t::update_sindexes(
             sindex_block->reset_buf_lock();
         }
 
-        rdb_live_deletion_context_t deletion_context;
-        for (size_t i = 0; i < mod_reports.size(); ++i) {
-            rdb_update_sindexes(this,
-                                sindexes,
-                                &mod_reports[i],
-                                txn,
-                                &deletion_context,
-                                NULL,
-                                NULL,
-                                NULL);
-        }
+        rdb_live_deletion_context_t deletion_context(this);
+        rdb_update_sindexes(this, sindexes, mod_reports, txn, &deletion_context);
     }
 
     // Write mod reports onto the sindex queue. We are in line for the
@@ -576,6 +599,115 @@ void store_t::update_sindexes(
     sindex_queue_push(mod_reports, &acq);
 }
 
+void store_t::delete_blob_later(std::vector<char> &&value) {
+    assert_thread();
+    blobs_to_reap.push_back(std::move(value));
+    if (!blob_reaper_active) {
+        blob_reaper_active = true;
+        coro_t::spawn_sometime(std::bind(&store_t::reap_blobs, this, drainer.lock()));
+    }
+}
+
+void store_t::reap_blobs(auto_drainer_t::lock_t) {
+    assert_thread();
+    // We don't stop for the drain signal, since the blocks of any blobs that are left
+    // over would never be freed.
+    cond_t non_interruptor;
+    rdb_value_deleter_t deleter;
+    while (!blobs_to_reap.empty()) {
+        write_token_t token;
+        new_write_token(&token);
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        acquire_superblock_for_write(2,
+                                     write_durability_t::SOFT,
+                                     &token,
+                                     &txn,
+                                     &superblock,
+                                     &non_interruptor);
+        superblock.reset();
+        for (int i = 0; i < BLOB_REAPER_MAX_BLOBS_PER_TXN && !blobs_to_reap.empty();
+             ++i) {
+            std::vector<char> value = std::move(blobs_to_reap.front());
+            blobs_to_reap.pop_front();
+            deleter.delete_value(buf_parent_t(txn.get()), value.data());
+        }
+        txn->commit();
+    }
+    blob_reaper_active = false;
+}
+
+class primary_key_filter_traversal_cb_t
+        : public depth_first_traversal_callback_t {
+public:
+    explicit primary_key_filter_traversal_cb_t(primary_key_filter_t *_filter)
+        : filter(_filter), num_traversed(0) { }
+    continue_bool_t handle_pair(scoped_key_value_t &&keyvalue, signal_t *) {
+        last_traversed_key = store_key_t(keyvalue.key());
+        filter->add_scanned(last_traversed_key);
+        ++num_traversed;
+        if (num_traversed >= PRIMARY_KEY_FILTER_SCAN_CHUNK_SIZE) {
+            return continue_bool_t::ABORT;
+        } else {
+            return continue_bool_t::CONTINUE;
+        }
+    }
+    primary_key_filter_t *filter;
+    uint64_t num_traversed;
+    store_key_t last_traversed_key;
+};
+
+void store_t::build_primary_key_filter(auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    uint64_t capacity = std::max<uint64_t>(
+        PRIMARY_KEY_FILTER_MIN_KEYS, 2 * primary_key_filter->size());
+    try {
+        for (;;) {
+            primary_key_filter->start_build(capacity);
+            uint64_t num_keys = 0;
+            key_range_t remaining_range = key_range_t::universe();
+            for (bool reached_end = false; !reached_end;) {
+                coro_t::yield();
+                // Writes add their keys to the new filter from now on, so we don't
+                // need a consistent view of the B-tree, just one that has all the keys
+                // that were there before `start_build()`.
+                read_token_t token;
+                new_read_token(&token);
+                scoped_ptr_t<txn_t> txn;
+                scoped_ptr_t<real_superblock_t> superblock;
+                acquire_superblock_for_read(&token, &txn, &superblock,
+                                            keepalive.get_drain_signal(), true);
+                // The account outlives the transaction, so we don't have to reset it.
+                txn->set_account(&low_io_priority_read_account);
+
+                primary_key_filter_traversal_cb_t traversal_cb(
+                    primary_key_filter.get());
+                reached_end =
+                    (continue_bool_t::CONTINUE == btree_depth_first_traversal(
+                        superblock.get(),
+                        remaining_range,
+                        &traversal_cb,
+                        access_t::read,
+                        direction_t::FORWARD,
+                        release_superblock_t::RELEASE,
+                        keepalive.get_drain_signal()));
+                num_keys += traversal_cb.num_traversed;
+                remaining_range = key_range_t(
+                    key_range_t::open, traversal_cb.last_traversed_key,
+                    key_range_t::none, store_key_t());
+            }
+            if (primary_key_filter->finish_build()) {
+                break;
+            }
+            // The B-tree had more keys than we thought, or the writes added them
+            // faster than the scan went.
+            capacity = std::max(2 * capacity, 2 * num_keys);
+        }
+    } catch (const interrupted_exc_t &) {
+        // The store is going away.
+    }
+}
+
 void store_t::sindex_queue_push(const rdb_modification_report_t &mod_report,
                                 const new_mutex_in_line_t *acq) {
     assert_thread();
@@ -840,6 +972,7 @@ void store_t::drop_sindex(uuid_u sindex_id) THROWS_NOTHING {
     buf_lock_t sindex_block(superblock->expose_buf(),
                             superblock->get_sindex_block_id(),
                             access_t::write);
+    sindex_block.set_lock_class(lock_class_t::sindex_block);
     superblock->release();
 
     secondary_index_t sindex;
@@ -910,6 +1043,8 @@ void store_t::drop_sindex(uuid_u sindex_id) THROWS_NOTHING {
     sindex_superblock_lock.write_acq_signal()->wait_lazily_unordered();
     sindex_superblock_lock.mark_deleted();
     ::delete_secondary_index(&sindex_block, compute_sindex_deletion_name(sindex.id));
+    sindex_stats.on_drop(sindex.id);
+    sindex_info_cache.erase(sindex.id);
     size_t num_erased = secondary_index_slices.erase(sindex.id);
     guarantee(num_erased == 1);
 
@@ -927,6 +1062,7 @@ bool secondary_indexes_are_equivalent(const std::vector<char> &left,
 
     if (sindex_info_left.multi == sindex_info_right.multi &&
         sindex_info_left.geo == sindex_info_right.geo &&
+        sindex_info_left.geo_covering == sindex_info_right.geo_covering &&
         sindex_info_left.mapping_version_info.original_reql_version ==
             sindex_info_right.mapping_version_info.original_reql_version) {
         // Need to determine if the mapping function is the same, re-serialize them
@@ -1028,6 +1164,7 @@ MUST_USE bool store_t::acquire_sindex_superblock_for_read(
     /* Acquire the sindex block. */
     buf_lock_t sindex_block(superblock->expose_buf(), superblock->get_sindex_block_id(),
                             access_t::read);
+    sindex_block.set_lock_class(lock_class_t::sindex_block);
     superblock->release();
 
     /* Figure out what the superblock for this index is. */
@@ -1063,6 +1200,7 @@ MUST_USE bool store_t::acquire_sindex_superblock_for_write(
     buf_lock_t sindex_block(superblock->expose_buf(),
                             superblock->get_sindex_block_id(),
                             access_t::write);
+    sindex_block.set_lock_class(lock_class_t::sindex_block);
     superblock->release();
 
     /* Figure out what the superblock for this index is. */
@@ -1154,6 +1292,24 @@ bool store_t::acquire_sindex_superblocks_for_write(
     return !sindexes_to_acquire || sindex_sbs_out->size() == sindexes_to_acquire->size();
 }
 
+std::shared_ptr<const sindex_disk_info_t> store_t::get_sindex_info(
+        const secondary_index_t &sindex) {
+    assert_thread();
+    auto it = sindex_info_cache.find(sindex.id);
+    if (it != sindex_info_cache.end()
+        && it->second.first == sindex.opaque_definition) {
+        return it->second.second;
+    }
+    auto info = std::make_shared<sindex_disk_info_t>();
+    try {
+        deserialize_sindex_info_or_crash(sindex.opaque_definition, info.get());
+    } catch (const archive_exc_t &e) {
+        crash("%s", e.what());
+    }
+    sindex_info_cache[sindex.id] = std::make_pair(sindex.opaque_definition, info);
+    return info;
+}
+
 region_map_t<binary_blob_t> store_t::get_metainfo(
         UNUSED order_token_t order_token,  // TODO
         read_token_t *token,
@@ -1,14 +1,20 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/changefeed.hpp"
 
+#include <algorithm>
+#include <iterator>
 #include <queue>
+#include <unordered_map>
 
 #include "btree/reql_specific.hpp"
 #include "clustering/administration/auth/user_context.hpp"
 #include "clustering/administration/tables/name_resolver.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/interruptor.hpp"
+#include "config/args.hpp"
 #include "containers/archive/boost_types.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "perfmon/memory_accounting.hpp"
 #include "rdb_protocol/artificial_table/backend.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/env.hpp"
@@ -167,24 +173,64 @@ void debug_print(printf_buffer_t *buf, const T &t) {
 enum class pop_type_t { RANGE, POINT };
 class maybe_squashing_queue_t {
 public:
-    virtual ~maybe_squashing_queue_t() { }
+    // If `queued_stat` isn't NULL, the size of the queue gets added to it.
+    explicit maybe_squashing_queue_t(perfmon_counter_t *_queued_stat)
+        : queued_bytes(memory_category_t::changefeed_queues),
+          queued_stat(_queued_stat), reported_size(0) { }
+    virtual ~maybe_squashing_queue_t() {
+        if (queued_stat != nullptr) {
+            *queued_stat -= reported_size;
+        }
+    }
     virtual void add(change_val_t change_val) = 0;
     virtual size_t size() const = 0;
     virtual void clear() = 0;
     virtual change_val_t pop() = 0;
     virtual const change_val_t &peek() = 0;
     virtual void purge_below(std::map<uuid_u, uint64_t> stamps) = 0;
+protected:
+    // Has to be called whenever the size of the queue changes.
+    void update_queued_stat() {
+        const int64_t new_size = size();
+        if (queued_stat != nullptr) {
+            *queued_stat += new_size - reported_size;
+        }
+        reported_size = new_size;
+    }
+    // An estimate of the memory that `change` takes up in the queue
+    static int64_t change_bytes(const change_val_t &change) {
+        int64_t bytes = sizeof(change_val_t) + change.pkey.size();
+        if (change.old_val) {
+            bytes += serialized_size<cluster_version_t::CLUSTER>(change.old_val->val);
+        }
+        if (change.new_val) {
+            bytes += serialized_size<cluster_version_t::CLUSTER>(change.new_val->val);
+        }
+        return bytes;
+    }
+    accounted_memory_t queued_bytes;
+private:
+    perfmon_counter_t *queued_stat;
+    int64_t reported_size;
 };
 
 class nonsquashing_queue_t final : public maybe_squashing_queue_t {
+public:
+    explicit nonsquashing_queue_t(perfmon_counter_t *_queued_stat)
+        : maybe_squashing_queue_t(_queued_stat) { }
+private:
     void add(change_val_t change_val) final {
+        queued_bytes.add(change_bytes(change_val));
         queue.push_back(std::move(change_val));
+        update_queued_stat();
     }
     size_t size() const final {
         return queue.size();
     }
     void clear() final {
         queue.clear();
+        queued_bytes.set(0);
+        update_queued_stat();
     }
     const change_val_t &peek() final {
         guarantee(size() != 0);
@@ -194,6 +240,8 @@ class nonsquashing_queue_t final : public maybe_squashing_queue_t {
         guarantee(size() != 0);
         auto ret = std::move(queue.front());
         queue.pop_front();
+        queued_bytes.add(-change_bytes(ret));
+        update_queued_stat();
         return ret;
     }
     void purge_below(std::map<uuid_u, uint64_t> stamps) final {
@@ -201,6 +249,8 @@ class nonsquashing_queue_t final : public maybe_squashing_queue_t {
         std::deque<change_val_t> old_queue;
         old_queue.swap(queue);
         guarantee(queue.empty());
+        // `add` accounts for the changes we keep again.
+        queued_bytes.set(0);
         for (auto &&cv : old_queue) {
             auto it = stamps.find(cv.source_stamp.first);
             orig.insert(std::make_pair(cv.source_stamp.first, 0)).first->second += 1;
@@ -213,12 +263,15 @@ class nonsquashing_queue_t final : public maybe_squashing_queue_t {
                 add(std::move(cv));
             }
         }
+        update_queued_stat();
     }
     std::deque<change_val_t> queue;
 };
 
 class squashing_queue_t final : public maybe_squashing_queue_t {
 public:
+    explicit squashing_queue_t(perfmon_counter_t *_queued_stat)
+        : maybe_squashing_queue_t(_queued_stat) { }
     void add(change_val_t change_val) final {
         auto it = queue.find(change_val.pkey);
         if (it == queue.end()) {
@@ -229,8 +282,10 @@ public:
             auto res = queue.insert(std::move(pair));
             it = res.first;
             guarantee(res.second);
+            queued_bytes.add(change_bytes(it->second.first));
         } else {
             change_val_t *change = &it->second.first;
+            queued_bytes.add(-change_bytes(*change));
             change_val.old_val = std::move(change->old_val);
             *change = std::move(change_val);
             bool has_old_val = change->old_val
@@ -242,8 +297,11 @@ public:
                     && change->old_val->val == change->new_val->val)) {
                 queue_order.erase(it->second.second);
                 queue.erase(it);
+            } else {
+                queued_bytes.add(change_bytes(*change));
             }
         }
+        update_queued_stat();
     }
     size_t size() const final {
         guarantee(queue.size() == queue_order.size());
@@ -252,6 +310,8 @@ public:
     void clear() final {
         queue.clear();
         queue_order.clear();
+        queued_bytes.set(0);
+        update_queued_stat();
     }
     const change_val_t &peek() final {
         guarantee(size() != 0);
@@ -266,6 +326,8 @@ public:
         auto ret = std::move(it->second.first);
         queue.erase(it);
         queue_order.pop_front();
+        queued_bytes.add(-change_bytes(ret));
+        update_queued_stat();
         return ret;
     }
     void purge_below(std::map<uuid_u, uint64_t>) final {
@@ -416,8 +478,11 @@ void server_t::add_client(
         //   `keepalive` in. This is no longer the case.
         //   We're keeping the `spawn_now_dangerously` for now to make sure that
         //   we don't introduce any subtle new bugs in 2.1.2.
+        // There is one of these waiting for every subscription, so it gets a small
+        // stack.
         coro_t::spawn_now_dangerously(
-            std::bind(&server_t::add_client_cb, this, stopped, addr, keepalive));
+            std::bind(&server_t::add_client_cb, this, stopped, addr, keepalive),
+            coro_stack_class_t::SMALL);
     }
 }
 
@@ -517,7 +582,7 @@ void server_t::send_one_with_lock(
         ASSERT_NO_CORO_WAITING;
         stamp = client->second.stamp++;
     }
-    send(manager, client->first, stamped_msg_t(uuid, stamp, std::move(msg)));
+    enqueue(client->first, stamped_msg_t(uuid, stamp, std::move(msg)), keepalive);
 }
 
 void server_t::send_all(
@@ -544,7 +609,51 @@ void server_t::send_all(
     acq.reset();
     stamp_spot->reset(); // Done stamping, no need to hold onto it while we send.
     for (const auto &pair : stamps) {
-        send(manager, pair.first, stamped_msg_t(uuid, pair.second, msg));
+        enqueue(pair.first, stamped_msg_t(uuid, pair.second, msg), keepalive);
+    }
+}
+
+void server_t::enqueue(
+        const client_t::addr_t &addr,
+        stamped_msg_t &&msg,
+        const auto_drainer_t::lock_t &keepalive) {
+    keepalive.assert_is_holding(&drainer);
+    ASSERT_NO_CORO_WAITING;
+    auto res = pending.insert(std::make_pair(addr, std::vector<stamped_msg_t>()));
+    res.first->second.push_back(std::move(msg));
+    if (res.second) {
+        // We copy `keepalive` rather than acquiring a new lock because we may be
+        // sending a `stop_t` while draining.
+        coro_t::spawn_sometime(std::bind(&server_t::flush_cb, this, addr, keepalive),
+                               coro_stack_class_t::SMALL);
+    }
+}
+
+void server_t::flush_cb(client_t::addr_t addr, auto_drainer_t::lock_t keepalive) {
+    keepalive.assert_is_holding(&drainer);
+    for (;;) {
+        std::vector<stamped_msg_t> batch;
+        {
+            ASSERT_NO_CORO_WAITING;
+            auto it = pending.find(addr);
+            guarantee(it != pending.end());
+            std::vector<stamped_msg_t> *msgs = &it->second;
+            if (msgs->empty()) {
+                pending.erase(it);
+                return;
+            }
+            if (msgs->size() <= CHANGEFEED_MAX_BATCHED_MSGS) {
+                batch.swap(*msgs);
+            } else {
+                auto end = msgs->begin() + CHANGEFEED_MAX_BATCHED_MSGS;
+                batch.assign(std::make_move_iterator(msgs->begin()),
+                             std::make_move_iterator(end));
+                msgs->erase(msgs->begin(), end);
+            }
+        }
+        // Messages queued while we block here go into the next batch.  The client
+        // reorders by stamp anyway, so batches don't need to arrive in order.
+        send(manager, addr, batch);
     }
 }
 
@@ -875,6 +984,8 @@ limit_manager_t::limit_manager_t(
       spec(std::move(_spec)),
       gt(std::move(_gt)),
       item_queue(gt),
+      shadow(gt),
+      shadow_exhausted(item_vec.size() < spec.limit + LIMIT_CHANGEFEED_SHADOW_ROWS),
       aborted(false) {
     guarantee(clients_lock->read_signal()->is_pulsed());
 
@@ -898,9 +1009,34 @@ limit_manager_t::limit_manager_t(
         bool inserted = item_queue.insert(pair).second;
         guarantee(inserted);
     }
+    // The initial read includes the shadow window, which the client doesn't see.
+    truncate_into_shadow();
+    item_vec.erase(
+        std::remove_if(item_vec.begin(), item_vec.end(),
+                       [this](const item_t &item) {
+                           return shadow.find_id(item.first) != shadow.end();
+                       }),
+        item_vec.end());
     send(msg_t(msg_t::limit_start_t(uuid, std::move(item_vec))));
 }
 
+std::vector<std::string> limit_manager_t::truncate_into_shadow() {
+    std::vector<std::string> truncated;
+    while (item_queue.size() > spec.limit) {
+        // `begin` is the last row in our ordering.  Whatever we push out of the top
+        // `n` still beats everything in `shadow`, so `shadow` stays contiguous.
+        auto it = item_queue.begin();
+        truncated.push_back((*it)->first);
+        bool inserted = shadow.insert(**it).second;
+        guarantee(inserted);
+        item_queue.erase(it);
+    }
+    if (shadow.truncate_top(LIMIT_CHANGEFEED_SHADOW_ROWS).size() != 0) {
+        shadow_exhausted = false;
+    }
+    return truncated;
+}
+
 void limit_manager_t::add(
     rwlock_in_line_t *spot,
     const store_key_t &sk,
@@ -946,14 +1082,18 @@ public:
                   const keyspec_t::limit_t *_spec,
                   sorting_t _sorting,
                   optional<item_t> _start,
-                  const item_queue_t *_item_queue)
+                  const item_queue_t *_item_queue,
+                  size_t _n,
+                  bool *_exhausted_out)
         : env(_env),
           ops(_ops),
           pk_range(_pk_range),
           spec(_spec),
           sorting(_sorting),
           start(std::move(_start)),
-          item_queue(_item_queue) { }
+          item_queue(_item_queue),
+          n(_n),
+          exhausted_out(_exhausted_out) { }
 
     std::vector<item_t> operator()(const primary_ref_t &ref) {
         rget_read_response_t resp;
@@ -976,7 +1116,6 @@ public:
         case sorting_t::UNORDERED: // fallthru
         default: unreachable();
         }
-        size_t n = spec->limit - item_queue->size();
         rdb_rget_slice(
             ref.btree,
             region_t(),
@@ -1019,6 +1158,7 @@ public:
         } else {
             guarantee(item_vec.size() == 0);
         }
+        *exhausted_out = item_vec.size() < n;
         return item_vec;
     }
 
@@ -1031,7 +1171,6 @@ public:
                 [](const datum_range_t &) { return true; },
                 [](const std::map<datum_t, uint64_t> &) { return false; }));
         datum_range_t srange = spec->range.datumspec.covering_range();
-        size_t n = spec->limit - item_queue->size();
         if (start) {
             datum_t dstart = start->second.first;
             switch (sorting) {
@@ -1098,6 +1237,7 @@ public:
         } else {
             guarantee(item_vec.size() == 0);
         }
+        *exhausted_out = item_vec.size() < n;
         return item_vec;
     }
 
@@ -1109,14 +1249,22 @@ private:
     sorting_t sorting;
     optional<item_t> start;
     const item_queue_t *item_queue;
+    // The number of rows to read past `start` (the secondary index case adds the
+    // rows it will read again because of the closed bound).
+    size_t n;
+    bool *exhausted_out;
 };
 
 std::vector<item_t> limit_manager_t::read_more(
     const boost::variant<primary_ref_t, sindex_ref_t> &ref,
-    const optional<item_t> &start) {
+    const optional<item_t> &start,
+    bool *exhausted_out) {
     guarantee(item_queue.size() < spec.limit);
+    guarantee(shadow.size() == 0);
     ref_visitor_t visitor(
-        env.get(), &ops, &region.inner, &spec, spec.range.sorting, start, &item_queue);
+        env.get(), &ops, &region.inner, &spec, spec.range.sorting, start, &item_queue,
+        spec.limit - item_queue.size() + LIMIT_CHANGEFEED_SHADOW_ROWS,
+        exhausted_out);
     return boost::apply_visitor(visitor, ref);
 }
 
@@ -1129,14 +1277,24 @@ void limit_manager_t::commit(
     }
 
     // Before we delete anything, we get the boundary between the active set and
-    // the data that didn't make it into the set.  Anything <= that according to
-    // our ordering could never be kicked out of the set because of a read from
-    // disk.
+    // the data that didn't make it into the set, and the boundary of the rows we
+    // know about (which is further out if there's anything in the shadow window, and
+    // doesn't exist if we're holding every row there is).  Anything <= that
+    // according to our ordering could never be kicked out of the set because of a
+    // read from disk.
     optional<item_t> active_boundary;
     auto item_queue_it = item_queue.begin();
     if (item_queue_it != item_queue.end()) {
         active_boundary.set(**item_queue_it);
     }
+    optional<item_t> known_boundary;
+    if (!shadow_exhausted) {
+        if (shadow.size() != 0) {
+            known_boundary.set(**shadow.begin());
+        } else {
+            known_boundary = active_boundary;
+        }
+    }
 
     item_queue_t real_added(gt);
     std::set<std::string> real_deleted;
@@ -1145,10 +1303,11 @@ void limit_manager_t::commit(
         if (data_deleted) {
             bool inserted = real_deleted.insert(id).second;
             guarantee(inserted);
+        } else {
+            UNUSED bool shadow_deleted = shadow.del_id(id);
         }
     }
     deleted.clear();
-    bool added_on_disk = false;
     for (const auto &pair : added) {
         // We only add to the set if we know we beat anything that might be read
         // off of disk below.  This is fine because if the resulting set is
@@ -1161,13 +1320,16 @@ void limit_manager_t::commit(
             guarantee(inserted);
             inserted = real_added.insert(pair).second;
             guarantee(inserted);
-        } else {
-            added_on_disk = true;
+        } else if (!(known_boundary && gt(item_t(pair), *known_boundary))) {
+            // It lands among the rows we know about, so the shadow window stays
+            // contiguous.
+            bool inserted = shadow.insert(pair).second;
+            guarantee(inserted);
         }
     }
     added.clear();
 
-    std::vector<std::string> truncated = item_queue.truncate_top(spec.limit);
+    std::vector<std::string> truncated = truncate_into_shadow();
     for (auto &&id : truncated) {
         auto it = real_added.find_id(id);
         if (it != real_added.end()) {
@@ -1178,12 +1340,28 @@ void limit_manager_t::commit(
         }
     }
 
-    bool anything_on_disk = real_deleted.size() != 0 || added_on_disk;
-    if (item_queue.size() < spec.limit && anything_on_disk) {
+    // Replacements come out of the shadow window first.
+    while (item_queue.size() < spec.limit && shadow.size() != 0) {
+        auto it = std::prev(shadow.end());
+        bool inserted = item_queue.insert(**it).second;
+        guarantee(inserted);
+        inserted = real_added.insert(**it).second;
+        guarantee(inserted);
+        shadow.erase(it);
+    }
+
+    if (item_queue.size() < spec.limit && !shadow_exhausted) {
+        // Everything that beats our last row is in the set now (or was deleted), so
+        // we can read on from there.
+        optional<item_t> read_start;
+        if (item_queue.size() != 0) {
+            read_start.set(**item_queue.begin());
+        }
         std::vector<item_t> s;
         optional<exc_t> exc;
+        bool exhausted = false;
         try {
-            s = read_more(sindex_ref, active_boundary);
+            s = read_more(sindex_ref, read_start, &exhausted);
         } catch (const exc_t &e) {
             exc.set(e);
         }
@@ -1193,6 +1371,7 @@ void limit_manager_t::commit(
             abort(*exc);
             return;
         }
+        shadow_exhausted = exhausted;
         for (auto &&pair : s) {
             bool inserted = item_queue.insert(pair).second;
             // Reading duplicates from disk is fine.
@@ -1201,9 +1380,9 @@ void limit_manager_t::commit(
                 guarantee(added_insert);
             }
         }
-        // We need to truncate again because `read_more` may read too much in
-        // the secondary index case.
-        std::vector<std::string> read_trunc = item_queue.truncate_top(spec.limit);
+        // We read past the top `n` to refill the shadow window, and may have read
+        // too much in the secondary index case.
+        std::vector<std::string> read_trunc = truncate_into_shadow();
         for (auto &&id : read_trunc) {
             auto it = real_added.find_id(id);
             if (it != real_added.end()) {
@@ -1386,6 +1565,10 @@ protected:
     void maybe_signal_cond() THROWS_NOTHING;
     void maybe_signal_queue_nearly_full_cond() THROWS_NOTHING;
     void destructor_cleanup(std::function<void()> del_sub) THROWS_NOTHING;
+    // The query engine stats of the server, or NULL if we don't have a context.
+    rdb_context_t::stats_t *get_stats() {
+        return rdb_context != nullptr ? &rdb_context->stats : nullptr;
+    }
 
     datum_t maybe_add_type(datum_t &&datum, change_type_t type);
     // If an error occurs, we're detached and `exc` is set to an exception to rethrow.
@@ -1547,10 +1730,13 @@ public:
     explicit flat_sub_t(init_squashing_queue_t init_squashing_queue, Args &&... args)
         : subscription_t(std::forward<Args>(args)...),
           last_stamp(std::make_pair(nil_uuid(), std::numeric_limits<uint64_t>::max())) {
+        perfmon_counter_t *queued_stat = get_stats() != nullptr
+            ? &get_stats()->changefeed_queued_changes
+            : nullptr;
         if (init_squashing_queue == init_squashing_queue_t::YES && squash) {
-            queue = make_scoped<squashing_queue_t>();
+            queue = make_scoped<squashing_queue_t>(queued_stat);
         } else {
-            queue = make_scoped<nonsquashing_queue_t>();
+            queue = make_scoped<nonsquashing_queue_t>(queued_stat);
         }
     }
     virtual void add_el(
@@ -1575,6 +1761,9 @@ public:
                 DEBUG_ONLY(, sindex)));
             if (queue->size() > limits.changefeed_queue_size()) {
                 skipped += queue->size();
+                if (get_stats() != nullptr) {
+                    get_stats()->changefeed_skipped_changes += queue->size();
+                }
                 queue->clear();
             } else if (queue->size() > limits.changefeed_queue_size() / 2) {
                 // We do this even if the queue is only half full because we
@@ -1624,7 +1813,10 @@ public:
     void add_limit_sub(limit_sub_t *sub, const uuid_u &uuid) THROWS_NOTHING;
     void del_limit_sub(limit_sub_t *sub, const uuid_u &uuid) THROWS_NOTHING;
 
+    // Only calls `f` on the subs whose filter the change might pass.
     void each_range_sub(const auto_drainer_t::lock_t &lock,
+                        const datum_t &old_val,
+                        const datum_t &new_val,
                         const std::function<void(range_sub_t *)> &f) THROWS_NOTHING;
     void update_stamps(uuid_u server_uuid, uint64_t stamp);
     std::map<uuid_u, uint64_t> get_stamps();
@@ -1639,6 +1831,11 @@ public:
 
     bool can_be_removed();
 
+    // Once a feed drops the keys that change from a `point_read_cache_t`, it stays
+    // until it's detached, and then drops all the keys of the table.
+    void set_point_read_cache(point_read_cache_t *cache);
+    void invalidate_cached(const store_key_t &key);
+
     virtual void abort_feed() = 0;
     void stop_subs(const auto_drainer_t::lock_t &lock);
     void mark_detached() { detached = true; }
@@ -1676,8 +1873,11 @@ private:
                             const std::vector<std::set<Sub *> > &vec,
                             const std::vector<int> &sub_threads,
                             int i);
-    void each_point_sub_cb(const std::function<void(point_sub_t *)> &f, int i);
+    void each_point_sub_cb(const std::function<void(point_sub_t *)> &f,
+                           size_t shard,
+                           int i);
     void each_point_sub_with_lock(
+        size_t shard,
         rwlock_in_line_t *spot,
         const std::function<void(point_sub_t *)> &f) THROWS_NOTHING;
     void each_limit_sub_cb(const std::function<void(limit_sub_t *)> &f, int i);
@@ -1685,11 +1885,36 @@ private:
         rwlock_in_line_t *spot,
         const std::function<void(limit_sub_t *)> &f) THROWS_NOTHING;
 
-    std::map<store_key_t, std::vector<std::set<point_sub_t *> > > point_subs;
-    rwlock_t point_subs_lock;
+    struct store_key_hash_t {
+        size_t operator()(const store_key_t &key) const {
+            // FNV-1a
+            uint64_t hash = 14695981039346656037ULL;
+            for (int i = 0; i < key.size(); ++i) {
+                hash = (hash ^ key.contents()[i]) * 1099511628211ULL;
+            }
+            return hash;
+        }
+    };
+    // Point subs are spread over `CHANGEFEED_POINT_SUB_SHARDS` hash tables by their
+    // key, each with its own lock, so that subscribing to, unsubscribing from and
+    // looking up one key doesn't wait on changes to the subs of the other keys.
+    struct point_subs_shard_t {
+        std::unordered_map<store_key_t,
+                           std::vector<std::set<point_sub_t *> >,
+                           store_key_hash_t> subs;
+        rwlock_t lock;
+    };
+    point_subs_shard_t *point_subs_shard(const store_key_t &key);
+    scoped_array_t<point_subs_shard_t> point_subs;
     std::vector<std::set<empty_sub_t *> > empty_subs;
     rwlock_t empty_subs_lock;
     std::vector<std::set<range_sub_t *> > range_subs;
+    // Range subs with a `filter_key` go here instead of into `range_subs`, so that a
+    // change only has to be shown to those whose filter it might pass.  We keep
+    // track of how many of them filter on every field.
+    std::map<std::pair<datum_string_t, std::string>,
+             std::vector<std::set<range_sub_t *> > > filtered_range_subs;
+    std::map<datum_string_t, size_t> filtered_range_sub_fields;
     rwlock_t range_subs_lock;
     std::map<uuid_u, std::vector<std::set<limit_sub_t *> > > limit_subs;
     rwlock_t limit_subs_lock;
@@ -1705,6 +1930,8 @@ private:
     // every sub do a thread switch to read the value.
     one_per_thread_t<stamps_t> stamps;
 
+    point_read_cache_t *point_read_cache;
+
     namespace_id_t table_id;
     name_resolver_t const &name_resolver;
 };
@@ -1745,14 +1972,14 @@ private:
     virtual void maybe_remove_feed() { client->maybe_remove_feed(client_lock, table_id); }
     virtual void stop_limit_sub(limit_sub_t *sub);
 
-    void mailbox_cb(signal_t *interruptor, stamped_msg_t msg);
+    void mailbox_cb(signal_t *interruptor, std::vector<stamped_msg_t> msgs);
     void constructor_cb();
 
     auto_drainer_t::lock_t client_lock;
     client_t *client;
     namespace_id_t table_id;
     mailbox_manager_t *manager;
-    mailbox_t<stamped_msg_t> mailbox;
+    mailbox_t<std::vector<stamped_msg_t> > mailbox;
     std::vector<server_t::addr_t> stop_addrs;
     std::vector<scoped_ptr_t<disconnect_watcher_t> > disconnect_watchers;
 
@@ -2190,6 +2417,20 @@ public:
         for (const auto &transform : spec.transforms) {
             ops.push_back(make_op(transform));
         }
+        if (has_ops()) {
+            // Like `sindex_config_t`, we compare the transformations by comparing
+            // their serializations.  The array size limit decides which values
+            // the transformations fail on.
+            write_message_t wm;
+            serialize<cluster_version_t::CLUSTER>(&wm, spec.transforms);
+            serialize<cluster_version_t::CLUSTER>(
+                &wm, static_cast<uint64_t>(env->limits().array_size_limit()));
+            vector_stream_t stream;
+            int res = send_write_message(&stream, &wm);
+            guarantee(res == 0);
+            ops_key.assign(stream.vector().begin(), stream.vector().end());
+            init_filter_key();
+        }
         store_keys = spec.datumspec.primary_key_map();
         if (!store_keys.has_value()) {
             store_key_range.set(spec.datumspec.covering_range().to_primary_keyrange());
@@ -2248,6 +2489,17 @@ public:
         return has_ops() ? apply_ops(std::move(val)) : make_optional(std::move(val));
     }
 
+    // Equal for two subscriptions exactly if `apply_ops` returns the same results for
+    // both of them.  Empty if there are no transformations.
+    const std::string &get_ops_key() const { return ops_key; }
+
+    // Set if the first transformation only keeps rows whose field `first` is equal
+    // to the value encoded as `second` (see `encode_group_key`).  We never see
+    // other changes, because `apply_ops` would filter them out anyway.
+    const optional<std::pair<datum_string_t, std::string> > &get_filter_key() const {
+        return filter_key;
+    }
+
     bool update_stamp(const uuid_u &uuid, uint64_t new_stamp) final {
         guarantee(active());
         auto it = next_stamps.find(uuid);
@@ -2291,7 +2543,10 @@ public:
     void maybe_enable_squashing() {
         if (squash) {
             scoped_ptr_t<maybe_squashing_queue_t> old_queue = std::move(queue);
-            queue = make_scoped<squashing_queue_t>();
+            queue = make_scoped<squashing_queue_t>(
+                get_stats() != nullptr
+                    ? &get_stats()->changefeed_queued_changes
+                    : nullptr);
             while (old_queue->size() != 0) {
                 queue->add(old_queue->pop());
             }
@@ -2386,6 +2641,22 @@ public:
     const std::map<uuid_u, uint64_t> &get_next_stamps() { return next_stamps; }
     const std::map<uuid_u, uint64_t> &get_orig_stamps() { return orig_stamps; }
 private:
+    void init_filter_key() {
+        const filter_wire_func_t *filter
+            = boost::get<filter_wire_func_t>(&spec.transforms[0]);
+        // With a default value, rows without the field can pass the filter.
+        if (filter == nullptr || filter->default_filter_val.has_value()) {
+            return;
+        }
+        datum_string_t field;
+        datum_t value;
+        std::string encoded;
+        if (filter->filter_func.compile_wire_func()->get_equality_filter(&field, &value)
+            && encode_group_key(value, &encoded)) {
+            filter_key.set(std::make_pair(std::move(field), std::move(encoded)));
+        }
+    }
+
     scoped_ptr_t<env_t> make_env(env_t *outer_env) {
         // This is to support fake environments from the unit tests that don't
         // actually have a context.
@@ -2406,6 +2677,10 @@ private:
 
     scoped_ptr_t<env_t> env;
     std::vector<scoped_ptr_t<op_t> > ops;
+    // See `get_ops_key`.
+    std::string ops_key;
+    // See `get_filter_key`.
+    optional<std::pair<datum_string_t, std::string> > filter_key;
 
     // The stamp (see `stamped_msg_t`) associated with our `changefeed_stamp_t`
     // read.  We use these to make sure we don't see changes from writes before
@@ -2808,6 +3083,8 @@ public:
 
     auto_drainer_t *get_drainer() final { return &drainer; }
     auto_drainer_t drainer;
+private:
+    std::string ops_key;
 };
 
 void real_feed_t::stop_limit_sub(limit_sub_t *sub) {
@@ -2846,23 +3123,38 @@ public:
     void operator()(const msg_t::change_t &change) const {
         datum_t null = datum_t::null();
 
-        feed->each_range_sub(*lock, [&](range_sub_t *sub) {
+        // Lots of clients often subscribe to the same changes, so subscriptions with
+        // the same transformations share one evaluation of them per thread.  Every
+        // thread only touches its own map.
+        std::vector<std::map<std::string, std::pair<datum_t, datum_t> > >
+            transformed(get_num_threads());
+        feed->each_range_sub(
+            *lock, change.old_val, change.new_val, [&](range_sub_t *sub) {
             datum_t new_val = null, old_val = null;
             if (!sub->active()) return;
             bool trivial = false;
             if (sub->has_ops()) {
-                if (change.new_val.has()) {
-                    if (optional<datum_t> d = sub->apply_ops(change.new_val)) {
-                        new_val = *d;
+                auto *cache = &transformed[get_thread_id().threadnum];
+                auto it = cache->find(sub->get_ops_key());
+                if (it != cache->end()) {
+                    new_val = it->second.first;
+                    old_val = it->second.second;
+                } else {
+                    if (change.new_val.has()) {
+                        if (optional<datum_t> d = sub->apply_ops(change.new_val)) {
+                            new_val = *d;
+                        }
                     }
-                }
-                if (!sub->active()) return;
-                if (change.old_val.has()) {
-                    if (optional<datum_t> d = sub->apply_ops(change.old_val)) {
-                        old_val = *d;
+                    if (!sub->active()) return;
+                    if (change.old_val.has()) {
+                        if (optional<datum_t> d = sub->apply_ops(change.old_val)) {
+                            old_val = *d;
+                        }
                     }
+                    if (!sub->active()) return;
+                    cache->insert(std::make_pair(sub->get_ops_key(),
+                                                 std::make_pair(new_val, old_val)));
                 }
-                if (!sub->active()) return;
                 // Duplicate values are caught before being written to disk and
                 // don't generate a `mod_report`, but if we have transforms the
                 // values might have changed.
@@ -2949,6 +3241,7 @@ public:
                                         indexed_datum_t(change.new_val, r_nullopt))
                                 : r_nullopt);
             });
+        feed->invalidate_cached(change.pkey);
     }
     void operator()(const msg_t::stop_t &) const {
         feed->abort_feed();
@@ -2970,7 +3263,7 @@ void msg_visit(feed_t *feed,
     feed->update_stamps(server_uuid, stamp);
 }
 
-void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
+void real_feed_t::mailbox_cb(signal_t *, std::vector<stamped_msg_t> msgs) {
     // We stop receiving messages when detached (we're only receiving
     // messages because we haven't managed to get a message to the
     // stop mailboxes for some of the primary replicas yet).  This also stops
@@ -2985,9 +3278,12 @@ void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
         wait_any.wait_lazily_unordered();
         if (detached) return;
         if (!lock.get_drain_signal()->is_pulsed()) {
+            // Every batch comes from a single server.
+            guarantee(msgs.size() != 0);
+            const uuid_u server_uuid = msgs[0].server_uuid;
             // We don't need a lock for this because the set of `uuid_u`s never
             // changes after it's initialized.
-            auto it = queues.find(msg.server_uuid);
+            auto it = queues.find(server_uuid);
             guarantee(it != queues.end());
             queue_t *queue = it->second.get();
             guarantee(queue != NULL);
@@ -2997,8 +3293,11 @@ void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
             if (detached) return;
 
             // Add us to the queue.
-            guarantee(msg.stamp >= queue->next);
-            queue->map.push(std::move(msg));
+            for (auto &&msg : msgs) {
+                guarantee(msg.server_uuid == server_uuid);
+                guarantee(msg.stamp >= queue->next);
+                queue->map.push(std::move(msg));
+            }
 
             // Read as much as we can from the queue (this enforces ordering.)
             while (queue->map.size() != 0 && queue->map.top().stamp == queue->next) {
@@ -3034,6 +3333,22 @@ private:
 
         while (ret.size() == 0) {
             r_sanity_check(!batcher.should_send_batch());
+            // Whether a change gets discarded depends on the ranges we've read, so
+            // the read ahead has to be applied before we look at any more changes.
+            bool applied_prefetch = false;
+            if (prefetch_done.has()) {
+                wait_interruptible(prefetch_done.get(), env->interruptor);
+                prefetch_done.reset();
+                std::vector<datum_t> batch = std::move(prefetched_batch);
+                prefetched_batch.clear();
+                if (prefetch_error) {
+                    std::exception_ptr error = prefetch_error;
+                    prefetch_error = std::exception_ptr();
+                    std::rethrow_exception(error);
+                }
+                apply_src_batch(std::move(batch), &ret);
+                applied_prefetch = true;
+            }
             // If there's nothing left to read, behave like a normal feed.  `ready`
             // should only be called after we've confirmed `is_exhausted` returns
             // true.
@@ -3074,25 +3389,10 @@ private:
                                       change_type_t::STATE));
                 }
             }
-            if (!src->is_exhausted() && !batcher.should_send_batch()) {
-                // Sorting must be UNORDERED for our last_read range calculation to work.
-                batchspec_t new_bs = bs.with_lazy_sorting_override(sorting_t::UNORDERED);
-                std::vector<datum_t> batch = src->next_batch(env, new_bs);
-                update_ranges();
-                r_sanity_check(active_state);
-                read_once = true;
-                if (batch.size() == 0) {
-                    r_sanity_check(src->is_exhausted());
-                } else {
-                    ret.reserve(ret.size() + batch.size());
-                    for (auto &&datum : batch) {
-                        datum_t cv = vals_to_change(datum_t(), std::move(datum), true);
-                        if (cv.has()) {
-                            ret.push_back(
-                                sub->maybe_add_type(std::move(cv), change_type_t::INITIAL));
-                        }
-                    }
-                }
+            if (applied_prefetch) {
+                // We've already read once for this batch.
+            } else if (!src->is_exhausted() && !batcher.should_send_batch()) {
+                apply_src_batch(src->next_batch(env, src_batchspec(bs)), &ret);
             } else {
                 if (ret.size() == 0) {
                     // If we've exhausted the stream but aren't ready yet then
@@ -3108,9 +3408,70 @@ private:
         }
 
         r_sanity_check(ret.size() != 0);
+        maybe_launch_prefetch(env, bs);
         return ret;
     }
 
+    static batchspec_t src_batchspec(const batchspec_t &bs) {
+        // Sorting must be UNORDERED for our last_read range calculation to work.
+        return bs.with_lazy_sorting_override(sorting_t::UNORDERED);
+    }
+
+    void apply_src_batch(std::vector<datum_t> &&batch, std::vector<datum_t> *ret) {
+        update_ranges();
+        r_sanity_check(active_state);
+        read_once = true;
+        if (batch.size() == 0) {
+            r_sanity_check(src->is_exhausted());
+        } else {
+            ret->reserve(ret->size() + batch.size());
+            for (auto &&datum : batch) {
+                datum_t cv = vals_to_change(datum_t(), std::move(datum), true);
+                if (cv.has()) {
+                    ret->push_back(
+                        sub->maybe_add_type(std::move(cv), change_type_t::INITIAL));
+                }
+            }
+        }
+    }
+
+    // While the consumer handles a batch, we read the next batch of initial values in
+    // the background.  (The read itself goes to all the shards at once.)  We don't
+    // read ahead for profiled queries, since the read wouldn't show up in the
+    // profile.
+    void maybe_launch_prefetch(env_t *env, const batchspec_t &bs) {
+        if (!read_once
+            || prefetch_done.has()
+            || src->is_exhausted()
+            || env->trace != nullptr) {
+            return;
+        }
+        if (!prefetch_env.has()) {
+            prefetch_env = make_scoped<env_t>(
+                env->get_rdb_ctx(),
+                env->return_empty_normal_batches,
+                drainer.get_drain_signal(),
+                env->get_serializable_env(),
+                nullptr);
+        }
+        batchspec_t prefetch_bs = src_batchspec(bs);
+        if (prefetch_bs.get_batch_type() == batch_type_t::NORMAL_FIRST) {
+            prefetch_bs = prefetch_bs.with_new_batch_type(batch_type_t::NORMAL);
+        }
+        prefetch_done = make_scoped<cond_t>();
+        coro_t::spawn_sometime(std::bind(&splice_stream_t::prefetch, this,
+                                         prefetch_bs, drainer.lock()));
+    }
+
+    void prefetch(const batchspec_t &bs, auto_drainer_t::lock_t) {
+        try {
+            prefetched_batch = src->next_batch(prefetch_env.get(), bs);
+        } catch (...) {
+            prefetch_error = std::current_exception();
+        }
+        prefetch_done->pulse();
+    }
+
     bool discard(const store_key_t &pkey,
                  const std::pair<uuid_u, uint64_t> &source_stamp,
                  const indexed_datum_t &val) {
@@ -3227,6 +3588,15 @@ private:
     counted_t<datum_stream_t> src;
     optional<active_state_t> active_state;
     std::map<uuid_u, stamped_range_t> stamped_ranges;
+
+    // Set while a read ahead of `src` is in flight or hasn't been applied yet.
+    scoped_ptr_t<cond_t> prefetch_done;
+    scoped_ptr_t<env_t> prefetch_env;
+    std::vector<datum_t> prefetched_batch;
+    std::exception_ptr prefetch_error;
+
+    // Destroyed first, so that the prefetch coroutine is gone before the rest.
+    auto_drainer_t drainer;
 };
 
 subscription_t::subscription_t(
@@ -3509,29 +3879,47 @@ size_t map_del_sub(Map *map, const Key &key, Sub *sub) THROWS_NOTHING {
 
 // If this throws we might leak the increment to `num_subs`.
 void feed_t::add_point_sub(point_sub_t *sub, const store_key_t &key) THROWS_NOTHING {
-    add_sub_with_lock(&point_subs_lock, [this, sub, &key]() {
-            map_add_sub(&point_subs, key, sub);
+    point_subs_shard_t *shard = point_subs_shard(key);
+    add_sub_with_lock(&shard->lock, [shard, sub, &key]() {
+            map_add_sub(&shard->subs, key, sub);
         });
 }
 
 // Can't throw because it's called in a destructor.
 void feed_t::del_point_sub(point_sub_t *sub, const store_key_t &key) THROWS_NOTHING {
-    del_sub_with_lock(&point_subs_lock, [this, sub, &key]() {
-            return map_del_sub(&point_subs, key, sub);
+    point_subs_shard_t *shard = point_subs_shard(key);
+    del_sub_with_lock(&shard->lock, [shard, sub, &key]() {
+            return map_del_sub(&shard->subs, key, sub);
         });
 }
 
 // If this throws we might leak the increment to `num_subs`.
 void feed_t::add_range_sub(range_sub_t *sub) THROWS_NOTHING {
     add_sub_with_lock(&range_subs_lock, [this, sub]() {
-            auto pair = range_subs[sub->home_thread().threadnum].insert(sub);
-            guarantee(pair.second);
+            if (const auto &key = sub->get_filter_key()) {
+                map_add_sub(&filtered_range_subs, *key, sub);
+                filtered_range_sub_fields[key->first] += 1;
+            } else {
+                auto pair = range_subs[sub->home_thread().threadnum].insert(sub);
+                guarantee(pair.second);
+            }
         });
 }
 
 // Can't throw because it's called in a destructor.
 void feed_t::del_range_sub(range_sub_t *sub) THROWS_NOTHING {
     del_sub_with_lock(&range_subs_lock, [this, sub]() {
+            if (const auto &key = sub->get_filter_key()) {
+                size_t erased = map_del_sub(&filtered_range_subs, *key, sub);
+                if (erased != 0) {
+                    auto it = filtered_range_sub_fields.find(key->first);
+                    guarantee(it != filtered_range_sub_fields.end());
+                    if (--it->second == 0) {
+                        filtered_range_sub_fields.erase(it);
+                    }
+                }
+                return erased;
+            }
             return range_subs[sub->home_thread().threadnum].erase(sub);
         });
 }
@@ -3594,15 +3982,51 @@ void feed_t::each_sub_in_vec(
 
 void feed_t::each_range_sub(
     const auto_drainer_t::lock_t &lock,
+    const datum_t &old_val,
+    const datum_t &new_val,
     const std::function<void(range_sub_t *)> &f) THROWS_NOTHING {
     assert_thread();
     rwlock_in_line_t spot(&range_subs_lock, access_t::read);
     each_sub_in_vec(range_subs, &spot, lock, f);
+    for (const auto &field : filtered_range_sub_fields) {
+        // A sub can only be interested in the change if the old or the new value
+        // passes its filter.  We're careful not to show it the change twice.
+        std::string encoded[2];
+        bool has_key[2];
+        const datum_t *vals[2] = { &old_val, &new_val };
+        for (size_t i = 0; i < 2; ++i) {
+            has_key[i] = false;
+            if (vals[i]->has()
+                && vals[i]->get_type() == datum_t::R_OBJECT
+                && !vals[i]->is_ptype()) {
+                datum_t value = vals[i]->get_field(field.first, NOTHROW);
+                has_key[i] = value.has() && encode_group_key(value, &encoded[i]);
+            }
+        }
+        if (has_key[1] && has_key[0] && encoded[0] == encoded[1]) {
+            has_key[1] = false;
+        }
+        for (size_t i = 0; i < 2; ++i) {
+            if (!has_key[i]) {
+                continue;
+            }
+            auto it = filtered_range_subs.find(std::make_pair(field.first, encoded[i]));
+            if (it != filtered_range_subs.end()) {
+                each_sub_in_vec(it->second, &spot, lock, f);
+            }
+        }
+    }
 }
 
-void feed_t::each_point_sub_cb(const std::function<void(point_sub_t *)> &f, int i) {
+feed_t::point_subs_shard_t *feed_t::point_subs_shard(const store_key_t &key) {
+    return &point_subs[store_key_hash_t()(key) % point_subs.size()];
+}
+
+void feed_t::each_point_sub_cb(const std::function<void(point_sub_t *)> &f,
+                               size_t shard,
+                               int i) {
     on_thread_t th((threadnum_t(i)));
-    for (auto const &pair : point_subs) {
+    for (auto const &pair : point_subs[shard].subs) {
         for (point_sub_t *sub : pair.second[i]) {
             f(sub);
         }
@@ -3610,6 +4034,7 @@ void feed_t::each_point_sub_cb(const std::function<void(point_sub_t *)> &f, int
 }
 
 void feed_t::each_point_sub_with_lock(
+    size_t shard,
     rwlock_in_line_t *spot,
     const std::function<void(point_sub_t *)> &f) THROWS_NOTHING {
     spot->read_signal()->wait_lazily_unordered();
@@ -3617,6 +4042,7 @@ void feed_t::each_point_sub_with_lock(
          std::bind(&feed_t::each_point_sub_cb,
                    this,
                    std::cref(f),
+                   shard,
                    ph::_1));
 }
 
@@ -3647,11 +4073,12 @@ void feed_t::on_point_sub(
     const std::function<void(point_sub_t *)> &f) THROWS_NOTHING {
     assert_thread();
     guarantee(lock.has_lock());
-    rwlock_in_line_t spot(&point_subs_lock, access_t::read);
+    point_subs_shard_t *shard = point_subs_shard(key);
+    rwlock_in_line_t spot(&shard->lock, access_t::read);
     spot.read_signal()->wait_lazily_unordered();
 
-    auto point_sub = point_subs.find(key);
-    if (point_sub != point_subs.end()) {
+    auto point_sub = shard->subs.find(key);
+    if (point_sub != shard->subs.end()) {
         each_sub_in_vec(point_sub->second, &spot, lock, f);
     }
 }
@@ -3673,7 +4100,19 @@ void feed_t::on_limit_sub(
 
 bool feed_t::can_be_removed() {
     assert_thread();
-    return num_subs == 0;
+    return num_subs == 0 && point_read_cache == nullptr;
+}
+
+void feed_t::set_point_read_cache(point_read_cache_t *cache) {
+    assert_thread();
+    guarantee(!detached);
+    point_read_cache = cache;
+}
+
+void feed_t::invalidate_cached(const store_key_t &key) {
+    if (point_read_cache != nullptr) {
+        point_read_cache->invalidate(table_id, key);
+    }
 }
 
 // This should only be called after the feed has been removed from the client,
@@ -3681,6 +4120,10 @@ bool feed_t::can_be_removed() {
 // the middle.
 void feed_t::stop_subs(const auto_drainer_t::lock_t &lock) {
     assert_thread();
+    if (point_read_cache != nullptr) {
+        // We won't hear about the changes anymore.
+        point_read_cache->invalidate_table(table_id);
+    }
     const char *msg = "Changefeed aborted (unavailable).";
     auto f = std::bind(&subscription_t::stop,
                        ph::_1,
@@ -3695,6 +4138,14 @@ void feed_t::stop_subs(const auto_drainer_t::lock_t &lock) {
             num_subs -= set.size();
             set.clear();
         }
+        for (auto &&pair : filtered_range_subs) {
+            each_sub_in_vec<range_sub_t>(pair.second, &spot, lock, f);
+            for (auto &&set : pair.second) {
+                num_subs -= set.size();
+            }
+        }
+        filtered_range_subs.clear();
+        filtered_range_sub_fields.clear();
     }
     {
         rwlock_in_line_t spot(&empty_subs_lock, access_t::write);
@@ -3705,16 +4156,16 @@ void feed_t::stop_subs(const auto_drainer_t::lock_t &lock) {
             set.clear();
         }
     }
-    {
-        rwlock_in_line_t spot(&point_subs_lock, access_t::write);
+    for (size_t i = 0; i < point_subs.size(); ++i) {
+        rwlock_in_line_t spot(&point_subs[i].lock, access_t::write);
         spot.write_signal()->wait_lazily_unordered();
-        each_point_sub_with_lock(&spot, f);
-        for (auto &&pair : point_subs) {
+        each_point_sub_with_lock(i, &spot, f);
+        for (auto &&pair : point_subs[i].subs) {
             for (auto &&set : pair.second) {
                 num_subs -= set.size();
             }
         }
-        point_subs.clear();
+        point_subs[i].subs.clear();
     }
     {
         rwlock_in_line_t spot(&limit_subs_lock, access_t::write);
@@ -3735,8 +4186,10 @@ feed_t::feed_t(
         lifetime_t<name_resolver_t const &>_name_resolver)
   : detached(false),
     num_subs(0),
+    point_subs(CHANGEFEED_POINT_SUB_SHARDS),
     empty_subs(get_num_threads()),
     range_subs(get_num_threads()),
+    point_read_cache(nullptr),
     table_id(_table_id),
     name_resolver(_name_resolver) { }
 
@@ -3752,10 +4205,12 @@ client_t::client_t(
                 const namespace_id_t &,
                 signal_t *)
             > &_namespace_source,
-        lifetime_t<name_resolver_t const &> _name_resolver) :
+        lifetime_t<name_resolver_t const &> _name_resolver,
+        uint64_t point_read_cache_size) :
     manager(_manager),
     namespace_source(_namespace_source),
-    name_resolver(_name_resolver)
+    name_resolver(_name_resolver),
+    point_read_cache(point_read_cache_size)
 {
     guarantee(manager != NULL);
 }
@@ -3888,22 +4343,11 @@ counted_t<datum_stream_t> client_t::new_stream(
 
                 if (feed_it == feeds.end()) {
                     spot.write_signal()->wait_lazily_unordered();
-                    namespace_interface_access_t access =
-                        namespace_source(table_id, &interruptor);
                     // Even though we have the user's feed here, multiple
                     // users may share a feed_t, and this code path will
                     // only be run for the first one.  Rather than mess
                     // about, just use the defaults.
-                    auto val = make_scoped<real_feed_t>(
-                        lock,
-                        this,
-                        manager,
-                        access.get(),
-                        table_id,
-                        &interruptor,
-                        make_lifetime(name_resolver));
-                    feed_it = feeds.insert(
-                        std::make_pair(table_id, std::move(val))).first;
+                    feed_it = add_feed(lock, table_id, &interruptor);
                 }
 
                 guarantee(feed_it != feeds.end());
@@ -3942,6 +4386,67 @@ counted_t<datum_stream_t> client_t::new_stream(
     }
 }
 
+client_t::feeds_t::iterator client_t::add_feed(
+        const auto_drainer_t::lock_t &lock,
+        const namespace_id_t &table_id,
+        signal_t *interruptor) {
+    namespace_interface_access_t access = namespace_source(table_id, interruptor);
+    auto val = make_scoped<real_feed_t>(
+        lock,
+        this,
+        manager,
+        access.get(),
+        table_id,
+        interruptor,
+        make_lifetime(name_resolver));
+    return feeds.insert(std::make_pair(table_id, std::move(val))).first;
+}
+
+void client_t::watch_for_point_read_cache(
+        const namespace_id_t &table_id, signal_t *interruptor) {
+    cross_thread_signal_t ct_interruptor(interruptor, home_thread());
+    on_thread_t th(home_thread());
+    auto_drainer_t::lock_t lock(&drainer, throw_if_draining_t::YES);
+    rwlock_in_line_t spot(&feeds_lock, access_t::write);
+    spot.write_signal()->wait_lazily_unordered();
+    auto feed_it = feeds.find(table_id);
+    if (feed_it == feeds.end()) {
+        feed_it = add_feed(lock, table_id, &ct_interruptor);
+    }
+    feed_it->second->set_point_read_cache(&point_read_cache);
+}
+
+datum_t client_t::cached_point_read(
+        env_t *env,
+        const namespace_id_t &table_id,
+        const store_key_t &key,
+        const std::function<datum_t()> &read) {
+    rdb_context_t::stats_t *stats = &env->get_rdb_ctx()->stats;
+    datum_t value;
+    if (point_read_cache.get(table_id, key, &value)) {
+        ++stats->point_read_cache_hits;
+        return value;
+    }
+    ++stats->point_read_cache_misses;
+
+    // The ticket has to be made before the feed is subscribed, so that we notice if
+    // the feed goes away again before we remember that the table is watched.
+    point_read_cache_t::ticket_t ticket = point_read_cache.start_fill(key);
+    if (!point_read_cache.is_watched(table_id)) {
+        try {
+            watch_for_point_read_cache(table_id, env->interruptor);
+        } catch (const cannot_perform_query_exc_t &) {
+            // We can't keep the cache up to date without the feed, but the read
+            // might still work, so we just don't cache its result.
+            return read();
+        }
+        point_read_cache.set_watched(table_id, ticket);
+    }
+    value = read();
+    point_read_cache.put(table_id, key, ticket, value);
+    return value;
+}
+
 void client_t::maybe_remove_feed(
     const auto_drainer_t::lock_t &lock, const uuid_u &uuid) {
     assert_thread();
@@ -25,6 +25,7 @@
 #include "protocol_api.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/datumspec.hpp"
+#include "rdb_protocol/point_read_cache.hpp"
 #include "rdb_protocol/shards.hpp"
 #include "region/region.hpp"
 #include "repli_timestamp.hpp"
@@ -131,7 +132,8 @@ RDB_DECLARE_SERIALIZABLE(msg_t);
 class real_feed_t;
 struct stamped_msg_t;
 
-typedef mailbox_addr_t<stamped_msg_t> client_addr_t;
+// Servers send their messages to a client in batches, see `server_t::enqueue`.
+typedef mailbox_addr_t<std::vector<stamped_msg_t> > client_addr_t;
 
 struct keyspec_t {
     struct range_t {
@@ -209,6 +211,9 @@ RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(keyspec_t::point_t);
 // <table, client> pair, to prevent redundant cluster messages.)  The actual
 // logic for subscribing to a changefeed server and distributing writes to
 // streams can be found in the `real_feed_t` class.
+//
+// The `client_t` also keeps the `point_read_cache_t`, because the feeds it keeps for
+// the tables in the cache tell it which keys to drop.
 class client_t : public home_thread_mixin_t {
 public:
     typedef client_addr_t addr_t;
@@ -219,7 +224,8 @@ public:
                 const namespace_id_t &,
                 signal_t *)
             > &_namespace_source,
-        lifetime_t<name_resolver_t const &> _name_resolver);
+        lifetime_t<name_resolver_t const &> _name_resolver,
+        uint64_t point_read_cache_size = 0);
     ~client_t();
     // Throws QL exceptions.
     counted_t<datum_stream_t> new_stream(
@@ -227,6 +233,15 @@ public:
         const streamspec_t &ss,
         const namespace_id_t &table_id,
         backtrace_id_t bt);
+    bool point_read_cache_enabled() const { return point_read_cache.is_enabled(); }
+    // Returns the cached value of `key` if there is one, and otherwise the result of
+    // `read`, which must read `key` from the primary replicas.  Throws what `read`
+    // throws.
+    datum_t cached_point_read(
+        env_t *env,
+        const namespace_id_t &table_id,
+        const store_key_t &key,
+        const std::function<datum_t()> &read);
     void maybe_remove_feed(
         const auto_drainer_t::lock_t &lock, const namespace_id_t &uuid);
     scoped_ptr_t<real_feed_t> detach_feed(
@@ -234,6 +249,17 @@ public:
         real_feed_t *expected_feed);
 private:
     friend class subscription_t;
+    typedef std::map<namespace_id_t, scoped_ptr_t<real_feed_t> > feeds_t;
+    // Must be called with a write lock on `feeds_lock`.
+    feeds_t::iterator add_feed(
+        const auto_drainer_t::lock_t &lock,
+        const namespace_id_t &table_id,
+        signal_t *interruptor);
+    // Makes sure there's a feed for `table_id` that drops the keys that change from
+    // `point_read_cache`.
+    void watch_for_point_read_cache(
+        const namespace_id_t &table_id, signal_t *interruptor);
+
     mailbox_manager_t *const manager;
     std::function<
         namespace_interface_access_t(
@@ -241,7 +267,8 @@ private:
             signal_t *)
         > const namespace_source;
     name_resolver_t const &name_resolver;
-    std::map<namespace_id_t, scoped_ptr_t<real_feed_t> > feeds;
+    point_read_cache_t point_read_cache;
+    feeds_t feeds;
     // This lock manages access to the `feeds` map.  The `feeds` map needs to be
     // read whenever `new_stream` is called, and needs to be written to whenever
     // `new_stream` is called with a table not already in the `feeds` map, or
@@ -434,9 +461,15 @@ public:
     const uuid_u uuid;
 private:
     // Can throw `exc_t` exceptions if an error occurs while reading from disk.
+    // Reads enough rows after `start` to fill the top `n` and the shadow window, and
+    // sets `*exhausted_out` if there were no more rows than that.
     std::vector<item_t> read_more(
         const boost::variant<primary_ref_t, sindex_ref_t> &ref,
-        const optional<item_t> &start);
+        const optional<item_t> &start,
+        bool *exhausted_out);
+    // Truncates `item_queue` to the top `n`, moving the rows that don't fit into
+    // `shadow`, and returns their ids.
+    std::vector<std::string> truncate_into_shadow();
     void send(msg_t &&msg);
 
     scoped_ptr_t<env_t> env;
@@ -449,6 +482,13 @@ private:
 
     limit_order_t gt;
     item_queue_t item_queue;
+    // Up to `LIMIT_CHANGEFEED_SHADOW_ROWS` rows that come right after the top `n`,
+    // so that rows dropping out of the top `n` can usually be replaced without
+    // reading from disk.  Every row in the region that sorts before the last row of
+    // `shadow` (or of `item_queue` if `shadow` is empty) is in one of the two, and
+    // if `shadow_exhausted` is true the region has no other rows at all.
+    item_queue_t shadow;
+    bool shadow_exhausted;
 
     std::map<std::string, std::pair<datum_t, datum_t> > added;
     std::set<std::string> deleted;
@@ -553,6 +593,18 @@ private:
                             msg_t msg,
                             const auto_drainer_t::lock_t &lock);
 
+    // Messages are sent to each client in batches rather than one cluster message
+    // per change.  `enqueue` adds a stamped message to the client's pending batch and
+    // spawns a `flush_cb` coroutine for the client if there isn't one already.  That
+    // coroutine sends the batch once the current coroutine yields, and keeps sending
+    // whatever piled up in the meantime until nothing is pending.
+    void enqueue(const client_t::addr_t &addr,
+                 stamped_msg_t &&msg,
+                 const auto_drainer_t::lock_t &keepalive);
+    void flush_cb(client_t::addr_t addr, auto_drainer_t::lock_t keepalive);
+    // There is an entry in here exactly while a `flush_cb` is running for the client.
+    std::map<client_t::addr_t, std::vector<stamped_msg_t> > pending;
+
     // Controls access to `clients`.  A `server_t` needs to read `clients` when:
     // * `send_all` is called
     // * `get_stamp` is called
@@ -3,16 +3,77 @@
 
 #include "clustering/administration/metadata.hpp"
 #include "concurrency/cross_thread_watchable.hpp"
+#include "config/args.hpp"
 #include "rdb_protocol/query_cache.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rpc/semilattice/view/field.hpp"
 #include "rpc/semilattice/watchable.hpp"
 #include "time.hpp"
 
+geo_covering_t::geo_covering_t()
+    : max_cells(GEO_INDEX_DEFAULT_MAX_CELLS),
+      min_level(0),
+      max_level(GEO_INDEX_MAX_CELL_LEVEL) { }
+
+bool geo_covering_t::is_default() const {
+    return *this == geo_covering_t();
+}
+
+bool geo_covering_t::is_valid() const {
+    return max_cells >= 1 && min_level >= 0 && min_level <= max_level &&
+        max_level <= GEO_INDEX_MAX_CELL_LEVEL;
+}
+
+void serialize_sindex_geo(write_message_t *wm,
+                          sindex_geo_bool_t geo,
+                          const geo_covering_t &geo_covering) {
+    if (geo == sindex_geo_bool_t::GEO && !geo_covering.is_default()) {
+        serialize_universal(wm, static_cast<int8_t>(2));
+        serialize_universal(wm, geo_covering.max_cells);
+        serialize_universal(wm, geo_covering.min_level);
+        serialize_universal(wm, geo_covering.max_level);
+    } else {
+        serialize_universal(wm, static_cast<int8_t>(geo));
+    }
+}
+
+archive_result_t deserialize_sindex_geo(read_stream_t *s,
+                                        sindex_geo_bool_t *geo_out,
+                                        geo_covering_t *geo_covering_out) {
+    int8_t tag;
+    archive_result_t res = deserialize_universal(s, &tag);
+    if (bad(res)) { return res; }
+    *geo_covering_out = geo_covering_t();
+    switch (tag) {
+    case static_cast<int8_t>(sindex_geo_bool_t::REGULAR):
+        *geo_out = sindex_geo_bool_t::REGULAR;
+        return archive_result_t::SUCCESS;
+    case static_cast<int8_t>(sindex_geo_bool_t::GEO):
+        *geo_out = sindex_geo_bool_t::GEO;
+        return archive_result_t::SUCCESS;
+    case 2:
+        *geo_out = sindex_geo_bool_t::GEO;
+        res = deserialize_universal(s, &geo_covering_out->max_cells);
+        if (bad(res)) { return res; }
+        res = deserialize_universal(s, &geo_covering_out->min_level);
+        if (bad(res)) { return res; }
+        res = deserialize_universal(s, &geo_covering_out->max_level);
+        if (bad(res)) { return res; }
+        return geo_covering_out->is_valid()
+            ? archive_result_t::SUCCESS
+            : archive_result_t::RANGE_ERROR;
+    default:
+        return archive_result_t::RANGE_ERROR;
+    }
+}
+
 bool sindex_config_t::operator==(const sindex_config_t &o) const {
     if (func_version != o.func_version || multi != o.multi || geo != o.geo) {
         return false;
     }
+    if (geo == sindex_geo_bool_t::GEO && geo_covering != o.geo_covering) {
+        return false;
+    }
     /* This is kind of a hack--we compare the functions by serializing them and comparing
     the serialized values. */
     write_message_t wm1, wm2;
@@ -26,8 +87,26 @@ bool sindex_config_t::operator==(const sindex_config_t &o) const {
     return stream1.vector() == stream2.vector();
 }
 
-RDB_IMPL_SERIALIZABLE_4_SINCE_v2_1(sindex_config_t,
-    func, func_version, multi, geo);
+template <cluster_version_t W>
+void serialize(write_message_t *wm, const sindex_config_t &config) {
+    serialize<W>(wm, config.func);
+    serialize<W>(wm, config.func_version);
+    serialize<W>(wm, config.multi);
+    serialize_sindex_geo(wm, config.geo, config.geo_covering);
+}
+
+template <cluster_version_t W>
+archive_result_t deserialize(read_stream_t *s, sindex_config_t *config) {
+    archive_result_t res = deserialize<W>(s, &config->func);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &config->func_version);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &config->multi);
+    if (bad(res)) { return res; }
+    return deserialize_sindex_geo(s, &config->geo, &config->geo_covering);
+}
+
+INSTANTIATE_SERIALIZABLE_SINCE_v2_1(sindex_config_t);
 
 bool write_hook_config_t::operator==(const write_hook_config_t &o) const {
     if (func_version != o.func_version) {
@@ -68,17 +147,50 @@ rdb_context_t::stats_t::stats_t(perfmon_collection_t *global_stats)
                                     &client_connections, "client_connections"),
       clients_active_membership(&qe_stats_collection,
                                 &clients_active, "clients_active"),
+      queries_queued_membership(&qe_stats_collection,
+                                &queries_queued, "queries_queued"),
+      queries_rejected_membership(&qe_stats_collection,
+                                  &queries_rejected, "queries_rejected"),
       queries_per_sec(secs_to_ticks(1)),
       queries_per_sec_membership(&qe_stats_collection,
                                  &queries_per_sec, "queries_per_sec"),
       queries_total_membership(&qe_stats_collection,
-                               &queries_total, "queries_total") { }
+                               &queries_total, "queries_total"),
+      thread_queries_active_membership(&qe_stats_collection,
+                                       &thread_queries_active,
+                                       "thread_queries_active"),
+      compiled_query_hits_membership(&qe_stats_collection,
+                                     &compiled_query_hits, "compiled_query_hits"),
+      compiled_query_misses_membership(&qe_stats_collection,
+                                       &compiled_query_misses,
+                                       "compiled_query_misses"),
+      point_read_cache_hits_membership(&qe_stats_collection,
+                                       &point_read_cache_hits, "point_read_cache_hits"),
+      point_read_cache_misses_membership(&qe_stats_collection,
+                                         &point_read_cache_misses,
+                                         "point_read_cache_misses"),
+      eval_arena_bytes_membership(&qe_stats_collection,
+                                  &eval_arena_bytes, "eval_arena_bytes"),
+      eval_arena_heap_bytes_membership(&qe_stats_collection,
+                                       &eval_arena_heap_bytes, "eval_arena_heap_bytes"),
+      changefeed_queued_changes_membership(&qe_stats_collection,
+                                           &changefeed_queued_changes,
+                                           "changefeed_queued_changes"),
+      changefeed_skipped_changes_membership(&qe_stats_collection,
+                                            &changefeed_skipped_changes,
+                                            "changefeed_skipped_changes"),
+      query_latency_membership(&qe_stats_collection,
+                               &query_latency, "query_latency"),
+      query_shape_latency(QUERY_SHAPE_MAX_SHAPES, "other"),
+      query_shape_latency_membership(&qe_stats_collection,
+                                     &query_shape_latency, "query_shapes") { }
 
 rdb_context_t::rdb_context_t()
     : extproc_pool(nullptr),
       cluster_interface(nullptr),
       manager(nullptr),
       reql_http_proxy(),
+      slow_query_threshold_ms(SLOW_QUERY_LOG_THRESHOLD_MS),
       stats(&get_global_perfmon_collection()) { }
 
 rdb_context_t::rdb_context_t(
@@ -90,6 +202,7 @@ rdb_context_t::rdb_context_t(
       cluster_interface(_cluster_interface),
       manager(nullptr),
       reql_http_proxy(),
+      slow_query_threshold_ms(SLOW_QUERY_LOG_THRESHOLD_MS),
       stats(&get_global_perfmon_collection()) {
     init_auth_watchables(auth_semilattice_view);
 }
@@ -101,11 +214,13 @@ rdb_context_t::rdb_context_t(
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
         perfmon_collection_t *global_stats,
-        const std::string &_reql_http_proxy)
+        const std::string &_reql_http_proxy,
+        uint64_t _slow_query_threshold_ms)
     : extproc_pool(_extproc_pool),
       cluster_interface(_cluster_interface),
       manager(_mailbox_manager),
       reql_http_proxy(_reql_http_proxy),
+      slow_query_threshold_ms(_slow_query_threshold_ms),
       stats(global_stats) {
     init_auth_watchables(auth_semilattice_view);
 }
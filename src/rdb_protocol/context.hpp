@@ -58,12 +58,49 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(sindex_multi_bool_t, int8_t,
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(sindex_geo_bool_t, int8_t,
         sindex_geo_bool_t::REGULAR, sindex_geo_bool_t::GEO);
 
+/* `geo_covering_t` says how a geospatial index covers each geometry with cells of the
+S2 grid: with up to `max_cells` cells, whose levels are between `min_level` and
+`max_level` (see `s2regioncoverer.h`). More and smaller cells fit the geometry more
+tightly, so that queries have fewer false matches to filter out, but every cell is one
+more index entry to write. It's set when the index is created and can't change. */
+class geo_covering_t {
+public:
+    geo_covering_t();
+
+    bool is_default() const;
+    bool is_valid() const;
+
+    bool operator==(const geo_covering_t &o) const {
+        return max_cells == o.max_cells && min_level == o.min_level &&
+            max_level == o.max_level;
+    }
+    bool operator!=(const geo_covering_t &o) const {
+        return !(*this == o);
+    }
+
+    int32_t max_cells;
+    int32_t min_level;
+    int32_t max_level;
+};
+
+/* A `sindex_geo_bool_t` is serialized as one byte. For a geo index that doesn't have the
+default `geo_covering_t`, the byte is 2 instead and the covering follows it, so that the
+format of every other index stays the same. */
+void serialize_sindex_geo(write_message_t *wm,
+                          sindex_geo_bool_t geo,
+                          const geo_covering_t &geo_covering);
+MUST_USE archive_result_t deserialize_sindex_geo(read_stream_t *s,
+                                                 sindex_geo_bool_t *geo_out,
+                                                 geo_covering_t *geo_covering_out);
+
 class sindex_config_t {
 public:
     sindex_config_t() { }
     sindex_config_t(const ql::map_wire_func_t &_func, reql_version_t _func_version,
-            sindex_multi_bool_t _multi, sindex_geo_bool_t _geo) :
-        func(_func), func_version(_func_version), multi(_multi), geo(_geo) { }
+            sindex_multi_bool_t _multi, sindex_geo_bool_t _geo,
+            const geo_covering_t &_geo_covering = geo_covering_t()) :
+        func(_func), func_version(_func_version), multi(_multi), geo(_geo),
+        geo_covering(_geo_covering) { }
 
     bool operator==(const sindex_config_t &o) const;
     bool operator!=(const sindex_config_t &o) const {
@@ -74,6 +111,8 @@ public:
     reql_version_t func_version;
     sindex_multi_bool_t multi;
     sindex_geo_bool_t geo;
+    // Only matters if `geo` is `GEO`
+    geo_covering_t geo_covering;
 };
 RDB_DECLARE_SERIALIZABLE(sindex_config_t);
 
@@ -134,12 +173,16 @@ public:
         p.num_shards = 1;
         p.primary_replica_tag = name_string_t::guarantee_valid("default");
         p.num_replicas[p.primary_replica_tag] = 1;
+        p.minimal_movement = false;
         return p;
     }
     size_t num_shards;
     std::map<name_string_t, size_t> num_replicas;
     std::set<name_string_t> nonvoting_replica_tags;
     name_string_t primary_replica_tag;
+    /* If set, keep the old split points and replicas wherever possible, rather than
+    picking the best balanced configuration. */
+    bool minimal_movement;
 };
 
 enum class admin_identifier_format_t {
@@ -153,10 +196,22 @@ namespace ql {
 class reader_t;
 }
 
+/* How `insert` generates the primary keys of documents that don't have one. */
+enum class key_generation_t {
+    // Random (version 4) UUIDs
+    RANDOM = 0,
+    // UUIDs that sort by the time they were generated, from
+    // `generate_time_ordered_uuid()`
+    TIME_ORDERED = 1
+};
+
 class base_table_t : public slow_atomic_countable_t<base_table_t> {
 public:
     virtual namespace_id_t get_id() const = 0;
     virtual const std::string &get_pkey() const = 0;
+    virtual key_generation_t get_key_generation() const {
+        return key_generation_t::RANDOM;
+    }
 
     virtual scoped_ptr_t<ql::reader_t> read_all_with_sindexes(
         ql::env_t *,
@@ -274,6 +329,7 @@ public:
             counted_t<const ql::db_t> db,
             const table_generate_config_params_t &config_params,
             const std::string &primary_key,
+            key_generation_t key_generation,
             write_durability_t durability,
             signal_t *interruptor,
             ql::datum_t *result_out,
@@ -468,7 +524,8 @@ public:
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
         perfmon_collection_t *global_stats,
-        const std::string &_reql_http_proxy);
+        const std::string &_reql_http_proxy,
+        uint64_t _slow_query_threshold_ms);
 
     ~rdb_context_t();
 
@@ -479,6 +536,9 @@ public:
 
     const std::string reql_http_proxy;
 
+    // Queries that take at least this long are written to the log.  0 means never.
+    const uint64_t slow_query_threshold_ms;
+
     class stats_t {
     public:
         explicit stats_t(perfmon_collection_t *global_stats);
@@ -489,10 +549,50 @@ public:
         perfmon_membership_t client_connections_membership;
         perfmon_counter_t clients_active;
         perfmon_membership_t clients_active_membership;
+        // How many START queries are waiting for `admission_control_t` to let them
+        // in, and how many it turned away
+        perfmon_counter_t queries_queued;
+        perfmon_membership_t queries_queued_membership;
+        perfmon_counter_t queries_rejected;
+        perfmon_membership_t queries_rejected_membership;
         perfmon_rate_monitor_t queries_per_sec;
         perfmon_membership_t queries_per_sec_membership;
         perfmon_counter_t queries_total;
         perfmon_membership_t queries_total_membership;
+        // How many client queries are running on each thread
+        perfmon_thread_counter_t thread_queries_active;
+        perfmon_membership_t thread_queries_active_membership;
+        // How many START queries reused a compiled term tree from the query cache,
+        // and how many had to be compiled
+        perfmon_counter_t compiled_query_hits;
+        perfmon_membership_t compiled_query_hits_membership;
+        perfmon_counter_t compiled_query_misses;
+        perfmon_membership_t compiled_query_misses_membership;
+        // How many outdated `get()`s were answered from the `--point-read-cache-size`
+        // cache, and how many had to be read from the table
+        perfmon_counter_t point_read_cache_hits;
+        perfmon_membership_t point_read_cache_hits_membership;
+        perfmon_counter_t point_read_cache_misses;
+        perfmon_membership_t point_read_cache_misses_membership;
+        // How many bytes of scratch space evaluating batches took from the arenas of
+        // the queries, and how many had to come from the heap because they were too
+        // large for an arena block
+        perfmon_counter_t eval_arena_bytes;
+        perfmon_membership_t eval_arena_bytes_membership;
+        perfmon_counter_t eval_arena_heap_bytes;
+        perfmon_membership_t eval_arena_heap_bytes_membership;
+        // How many changes are waiting in the queues of changefeed subscriptions, and
+        // how many were dropped because a queue exceeded `changefeed_queue_size`
+        perfmon_counter_t changefeed_queued_changes;
+        perfmon_membership_t changefeed_queued_changes_membership;
+        perfmon_counter_t changefeed_skipped_changes;
+        perfmon_membership_t changefeed_skipped_changes_membership;
+        // How long queries take from the time they're received to the time their
+        // last response is sent, in total and by `query_shape()`
+        perfmon_latency_histogram_t query_latency;
+        perfmon_membership_t query_latency_membership;
+        perfmon_keyed_latency_t query_shape_latency;
+        perfmon_membership_t query_shape_latency_membership;
     private:
         DISABLE_COPYING(stats_t);
     } stats;
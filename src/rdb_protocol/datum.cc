@@ -4,7 +4,9 @@
 #include <float.h>
 #include <math.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <algorithm>
 #include <cmath>
@@ -20,6 +22,7 @@
 #include "containers/scoped.hpp"
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/rapidjson.h"
+#include "rapidjson/reader.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "rdb_protocol/datum_stream/array.hpp"
@@ -126,6 +129,11 @@ datum_t::data_wrapper_t::data_wrapper_t(
 #endif
 }
 
+datum_t::data_wrapper_t::data_wrapper_t(persistent_vector_t<datum_t> &&array) :
+    r_persistent_array(
+        new countable_wrapper_t<persistent_vector_t<datum_t> >(std::move(array))),
+    internal_type(internal_type_t::PERSISTENT_R_ARRAY) { }
+
 datum_t::data_wrapper_t::data_wrapper_t(type_t type, shared_buf_ref_t<char> &&_buf_ref) {
     switch (type) {
     case R_BINARY: {
@@ -159,6 +167,7 @@ datum_t::data_wrapper_t::~data_wrapper_t() {
     // An optimization similar to what we do in `call_with_enough_stack_datum`,
     // except that we can also ignore recursion for BUF_R_ARRAY and BUF_R_OBJECT.
     if (internal_type == internal_type_t::R_ARRAY ||
+        internal_type == internal_type_t::PERSISTENT_R_ARRAY ||
         internal_type == internal_type_t::R_OBJECT) {
         call_with_enough_stack([&] { destruct(); }, MIN_DATUM_RECURSION_STACK_SPACE);
     } else {
@@ -190,6 +199,8 @@ datum_t::type_t datum_t::data_wrapper_t::get_type() const {
         return type_t::R_ARRAY;
     case internal_type_t::BUF_R_OBJECT:
         return type_t::R_OBJECT;
+    case internal_type_t::PERSISTENT_R_ARRAY:
+        return type_t::R_ARRAY;
     case internal_type_t::MAXVAL:
         return type_t::MAXVAL;
     default:
@@ -222,6 +233,10 @@ void datum_t::data_wrapper_t::destruct() {
     case internal_type_t::BUF_R_OBJECT: {
         buf_ref.~shared_buf_ref_t<char>();
     } break;
+    case internal_type_t::PERSISTENT_R_ARRAY: {
+        r_persistent_array.~counted_t<
+            countable_wrapper_t<persistent_vector_t<datum_t> > >();
+    } break;
     default: unreachable();
     }
     internal_type = internal_type_t::UNINITIALIZED;
@@ -255,6 +270,11 @@ void datum_t::data_wrapper_t::assign_copy(const datum_t::data_wrapper_t &copyee)
     case internal_type_t::BUF_R_OBJECT: {
         new(&buf_ref) shared_buf_ref_t<char>(copyee.buf_ref);
     } break;
+    case internal_type_t::PERSISTENT_R_ARRAY: {
+        new(&r_persistent_array)
+            counted_t<countable_wrapper_t<persistent_vector_t<datum_t> > >(
+                copyee.r_persistent_array);
+    } break;
     default: unreachable();
     }
 }
@@ -288,6 +308,11 @@ void datum_t::data_wrapper_t::assign_move(datum_t::data_wrapper_t &&movee) noexc
     case internal_type_t::BUF_R_OBJECT: {
         new(&buf_ref) shared_buf_ref_t<char>(std::move(movee.buf_ref));
     } break;
+    case internal_type_t::PERSISTENT_R_ARRAY: {
+        new(&r_persistent_array)
+            counted_t<countable_wrapper_t<persistent_vector_t<datum_t> > >(
+                std::move(movee.r_persistent_array));
+    } break;
     default: unreachable();
     }
 #ifndef NDEBUG
@@ -335,6 +360,8 @@ datum_t::datum_t(std::vector<datum_t> &&_array,
 datum_t::datum_t(std::vector<datum_t> &&_array,
                  no_array_size_limit_check_t) : data(std::move(_array)) { }
 
+datum_t::datum_t(persistent_vector_t<datum_t> &&_array) : data(std::move(_array)) { }
+
 datum_t::datum_t(std::map<datum_string_t, datum_t> &&_object,
                  const std::set<std::string> &allowed_pts)
     : data(to_sorted_vec(std::move(_object))) {
@@ -476,8 +503,8 @@ datum_t to_datum(const rapidjson::Value &json, const configured_limits_t &limits
                  ++it) {
                 fail_if_invalid(it->name.GetString(),
                                 it->name.GetStringLength());
-                datum_string_t key(it->name.GetStringLength(),
-                                   it->name.GetString());
+                datum_string_t key = datum_string_t::intern(
+                    it->name.GetStringLength(), it->name.GetString());
                 bool dup = builder.add(key, to_datum(it->value, limits, reql_version));
                 rcheck_datum(!dup, base_exc_t::LOGIC,
                              strprintf("Duplicate key %s in JSON.",
@@ -510,6 +537,100 @@ datum_t to_datum(const rapidjson::Value &json, const configured_limits_t &limits
     }
 }
 
+/* Receives the events of a `rapidjson::Reader` and builds the datum from them, so that
+we don't have to build a `rapidjson::Document` first.  Values of unfinished arrays and
+objects are kept on `values`, and combined when the array or object ends.  This
+needs to produce the same datums as `to_datum(const rapidjson::Value &, ...)`. */
+class datum_json_handler_t {
+public:
+    explicit datum_json_handler_t(const configured_limits_t &_limits)
+        : limits(_limits) { }
+
+    bool Null() { return push(datum_t::null()); }
+    bool Bool(bool b) { return push(datum_t::boolean(b)); }
+    bool Int(int i) { return push(datum_t(static_cast<double>(i))); }
+    bool Uint(unsigned i) { return push(datum_t(static_cast<double>(i))); }
+    bool Int64(int64_t i) { return push(datum_t(static_cast<double>(i))); }
+    bool Uint64(uint64_t i) { return push(datum_t(static_cast<double>(i))); }
+    bool Double(double d) { return push(datum_t(d)); }
+    bool String(const char *str, rapidjson::SizeType length, bool) {
+        fail_if_invalid(str, length);
+        return push(datum_t(datum_string_t(length, str)));
+    }
+    bool StartObject() { return true; }
+    bool Key(const char *str, rapidjson::SizeType length, bool) {
+        fail_if_invalid(str, length);
+        keys.push_back(datum_string_t::intern(length, str));
+        return true;
+    }
+    bool EndObject(rapidjson::SizeType member_count) {
+        guarantee(member_count <= values.size() && member_count <= keys.size());
+        const size_t values_start = values.size() - member_count;
+        const size_t keys_start = keys.size() - member_count;
+        datum_object_builder_t builder;
+        for (size_t i = 0; i < member_count; ++i) {
+            const datum_string_t &key = keys[keys_start + i];
+            bool dup = builder.add(key, std::move(values[values_start + i]));
+            rcheck_datum(!dup, base_exc_t::LOGIC,
+                         strprintf("Duplicate key %s in JSON.",
+                                   datum_t(key).print().c_str()));
+        }
+        values.resize(values_start);
+        keys.resize(keys_start);
+        const std::set<std::string> pts = { pseudo::literal_string };
+        return push(std::move(builder).to_datum(pts));
+    }
+    bool StartArray() { return true; }
+    bool EndArray(rapidjson::SizeType element_count) {
+        guarantee(element_count <= values.size());
+        const size_t values_start = values.size() - element_count;
+        datum_array_builder_t builder(limits);
+        builder.reserve(element_count);
+        for (size_t i = values_start; i < values.size(); ++i) {
+            builder.add(std::move(values[i]));
+        }
+        values.resize(values_start);
+        return push(std::move(builder).to_datum());
+    }
+
+    datum_t result() {
+        guarantee(values.size() == 1 && keys.empty());
+        return std::move(values[0]);
+    }
+
+private:
+    bool push(datum_t &&d) {
+        values.push_back(std::move(d));
+        return true;
+    }
+
+    const configured_limits_t &limits;
+    std::vector<datum_t> values;
+    std::vector<datum_string_t> keys;
+
+    DISABLE_COPYING(datum_json_handler_t);
+};
+
+bool parse_json_to_datum(char *json,
+                         const configured_limits_t &limits,
+                         datum_t *datum_out,
+                         rapidjson::ParseErrorCode *error_out) {
+    datum_json_handler_t handler(limits);
+    rapidjson::InsituStringStream stream(json);
+    rapidjson::Reader reader;
+    // The iterative parser doesn't recurse, so we don't need to worry about the stack
+    // for deeply nested documents here.
+    reader.Parse<rapidjson::kParseDefaultFlags
+                 | rapidjson::kParseInsituFlag
+                 | rapidjson::kParseIterativeFlag>(stream, handler);
+    if (reader.HasParseError()) {
+        *error_out = reader.GetParseErrorCode();
+        return false;
+    }
+    *datum_out = handler.result();
+    return true;
+}
+
 const shared_buf_ref_t<char> *datum_t::get_buf_ref() const {
     if (data.get_internal_type() == internal_type_t::BUF_R_ARRAY
         || data.get_internal_type() == internal_type_t::BUF_R_OBJECT) {
@@ -646,9 +767,14 @@ void datum_t::num_to_str_key(std::string *str_out) const {
         // highest bit flipped as well).
         packed.u ^= (1ULL << 63);
     }
-    // The formatting here is sensitive.  Talk to mlucy before changing it.
-    str_out->append(strprintf("%.*" PRIx64, static_cast<int>(sizeof(double)*2), packed.u));
-    str_out->append(strprintf("#%" PR_RECONSTRUCTABLE_DOUBLE, value));
+    // The formatting here is sensitive.  Talk to mlucy before changing it.  This is
+    // called for every number in every secondary index key, so it formats into a
+    // buffer on the stack rather than going through `strprintf`.
+    char buf[64];
+    int size = snprintf(buf, sizeof(buf), "%.*" PRIx64 "#%" PR_RECONSTRUCTABLE_DOUBLE,
+                        static_cast<int>(sizeof(double)*2), packed.u, value);
+    guarantee(size > 0 && static_cast<size_t>(size) < sizeof(buf));
+    str_out->append(buf, size);
 }
 
 void datum_t::binary_to_str_key(std::string *str_out) const {
@@ -826,7 +952,7 @@ void datum_t::array_to_str_key(
         default:
             unreachable();
         }
-        str_out->append(std::string(1, '\0'));
+        str_out->push_back('\0');
     }
 }
 
@@ -1303,6 +1429,19 @@ optional<uint64_t> datum_t::extract_tag(const store_key_t &key) {
 store_key_t datum_t::truncated_secondary(
     reql_version_t reql_version,
     extrema_ok_t extrema_ok) const {
+    std::string s = untruncated_secondary(reql_version, extrema_ok);
+
+    // Truncate the key if necessary
+    size_t mts = max_trunc_size();
+    if (s.length() >= mts) {
+        s.erase(mts);
+    }
+    return store_key_t(s);
+}
+
+std::string datum_t::untruncated_secondary(
+    reql_version_t reql_version,
+    extrema_ok_t extrema_ok) const {
 
     escape_nulls_t escape_nulls =
         escape_nulls_from_reql_version_for_sindex(reql_version);
@@ -1337,14 +1476,12 @@ store_key_t datum_t::truncated_secondary(
     guarantee(skey_version == skey_version_t::post_1_16);
     s.push_back('\0');
 
-    // Truncate the key if necessary
-    size_t mts = max_trunc_size();
-    if (s.length() >= mts) {
-        s.erase(mts);
+    if (s.length() > MAX_KEY_SIZE + 1) {
+        s.erase(MAX_KEY_SIZE + 1);
     }
 
     tag_skey_version(skey_version, &s);
-    return store_key_t(s);
+    return s;
 }
 
 void datum_t::check_type(type_t desired, const char *msg) const {
@@ -1427,6 +1564,8 @@ size_t datum_t::arr_size() const {
     check_type(R_ARRAY);
     if (data.get_internal_type() == internal_type_t::BUF_R_ARRAY) {
         return datum_get_array_size(data.buf_ref);
+    } else if (data.get_internal_type() == internal_type_t::PERSISTENT_R_ARRAY) {
+        return data.r_persistent_array->size();
     } else {
         r_sanity_check(data.get_internal_type() == internal_type_t::R_ARRAY);
         return data.r_array->size();
@@ -1449,12 +1588,40 @@ datum_t datum_t::unchecked_get(size_t index) const {
     if (data.get_internal_type() == internal_type_t::BUF_R_ARRAY) {
         const size_t offset = datum_get_element_offset(data.buf_ref, index);
         return datum_deserialize_from_buf(data.buf_ref, offset);
+    } else if (data.get_internal_type() == internal_type_t::PERSISTENT_R_ARRAY) {
+        return (*data.r_persistent_array)[index];
     } else {
         r_sanity_check(data.get_internal_type() == internal_type_t::R_ARRAY);
         return (*data.r_array)[index];
     }
 }
 
+datum_t datum_t::append(datum_t val, const configured_limits_t &limits) const {
+    const size_t size = arr_size();
+    rcheck_datum(size + 1 <= limits.array_size_limit(),
+                 base_exc_t::RESOURCE,
+                 format_array_size_error(limits.array_size_limit()).c_str());
+    if (size + 1 < PERSISTENT_ARRAY_MIN_SIZE) {
+        std::vector<datum_t> array;
+        array.reserve(size + 1);
+        for (size_t i = 0; i < size; ++i) {
+            array.push_back(unchecked_get(i));
+        }
+        array.push_back(std::move(val));
+        return datum_t(std::move(array), no_array_size_limit_check_t());
+    }
+    if (data.get_internal_type() == internal_type_t::PERSISTENT_R_ARRAY) {
+        return datum_t(data.r_persistent_array->push_back(std::move(val)));
+    }
+    std::vector<datum_t> array;
+    array.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        array.push_back(unchecked_get(i));
+    }
+    return datum_t(persistent_vector_t<datum_t>(std::move(array)).push_back(
+        std::move(val)));
+}
+
 size_t datum_t::obj_size() const {
     check_type(R_OBJECT);
     if (data.get_internal_type() == internal_type_t::BUF_R_OBJECT) {
@@ -1482,9 +1649,18 @@ std::pair<datum_string_t, datum_t> datum_t::unchecked_get_pair(size_t index) con
 }
 
 datum_t datum_t::get_field(const datum_string_t &key, throw_bool_t throw_bool) const {
+    check_type(R_OBJECT);
+    if (data.get_internal_type() == internal_type_t::BUF_R_OBJECT) {
+        datum_t res = datum_get_field_from_buf(data.buf_ref, key);
+        if (res.has() || throw_bool == NOTHROW) {
+            return res;
+        }
+        rfail(base_exc_t::NON_EXISTENCE,
+              "No attribute `%s` in object:\n%s", key.to_std().c_str(), print().c_str());
+    }
+
     // Use binary search on top of unchecked_get_pair()
     size_t range_beg = 0;
-    // The obj_size() also makes sure that this has the right type (R_OBJECT)
     size_t range_end = obj_size();
     while (range_beg < range_end) {
         const size_t center = range_beg + ((range_end - range_beg) / 2);
@@ -1535,6 +1711,12 @@ void datum_t::write_json_unchecked_stack(json_writer_t *writer) const {
     } break;
     case R_STR: writer->String(as_str().data(), as_str().size()); break;
     case R_ARRAY: {
+        if (get_buf_ref() != nullptr) {
+            // Serialized arrays and objects get written straight from their buffer,
+            // without constructing a `datum_t` for every element.
+            datum_write_json_from_buf(*get_buf_ref(), false, writer);
+            break;
+        }
         writer->StartArray();
         const size_t sz = arr_size();
         for (size_t i = 0; i < sz; ++i) {
@@ -1543,6 +1725,10 @@ void datum_t::write_json_unchecked_stack(json_writer_t *writer) const {
         writer->EndArray();
     } break;
     case R_OBJECT: {
+        if (get_buf_ref() != nullptr) {
+            datum_write_json_from_buf(*get_buf_ref(), true, writer);
+            break;
+        }
         writer->StartObject();
         const size_t sz = obj_size();
         for (size_t i = 0; i < sz; ++i) {
@@ -1835,6 +2021,86 @@ int datum_t::cmp(const datum_t &rhs) const {
         });
 }
 
+// Deeper arrays are rare enough to just fall back to `cmp`, which also saves us from
+// having to worry about the stack.
+const int MAX_SORT_KEY_DEPTH = 16;
+
+bool append_sort_key_at_depth(const datum_t &datum, int depth, std::string *key_out) {
+    // The first byte of every key is the type, in the order in which `cmp` sorts
+    // values of different types.  Arrays end with a 0 byte, which sorts before the
+    // first byte of any element.
+    const datum_t::type_t type = datum.get_type();
+    switch (type) {
+    case datum_t::MINVAL: // fallthru
+    case datum_t::R_NULL: // fallthru
+    case datum_t::MAXVAL:
+        key_out->push_back(static_cast<char>(type));
+        return true;
+    case datum_t::R_BOOL:
+        key_out->push_back(static_cast<char>(type));
+        key_out->push_back(datum.as_bool() ? 1 : 0);
+        return true;
+    case datum_t::R_NUM: {
+        key_out->push_back(static_cast<char>(type));
+        // The same mangling as in `num_to_str_key`, in big-endian order.
+        double value = datum.as_num();
+        if (value == -0.0) {
+            value = 0.0;
+        }
+        uint64_t bits;
+        static_assert(sizeof(bits) == sizeof(value), "unexpected double size");
+        memcpy(&bits, &value, sizeof(bits));
+        bits = (bits & (1ULL << 63)) ? ~bits : bits ^ (1ULL << 63);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            key_out->push_back(static_cast<char>((bits >> shift) & 0xFF));
+        }
+        return true;
+    }
+    case datum_t::R_STR: {
+        key_out->push_back(static_cast<char>(type));
+        // 0 bytes are escaped as `\x00\xFF`, and the string ends with `\x00\x00`, so that
+        // a string sorts before any longer string that it is a prefix of.
+        const datum_string_t &str = datum.as_str();
+        const char *data = str.data();
+        const size_t size = str.size();
+        for (size_t i = 0; i < size; ++i) {
+            key_out->push_back(data[i]);
+            if (data[i] == '\0') {
+                key_out->push_back('\xFF');
+            }
+        }
+        key_out->append(2, '\0');
+        return true;
+    }
+    case datum_t::R_ARRAY: {
+        if (depth >= MAX_SORT_KEY_DEPTH) {
+            return false;
+        }
+        key_out->push_back(static_cast<char>(type));
+        const size_t size = datum.arr_size();
+        for (size_t i = 0; i < size; ++i) {
+            if (!append_sort_key_at_depth(datum.get(i), depth + 1, key_out)) {
+                return false;
+            }
+        }
+        key_out->push_back('\0');
+        return true;
+    }
+    case datum_t::R_OBJECT: // fallthru
+    case datum_t::R_BINARY:
+        // Pseudotypes sort by their type name, which would need type-specific keys.  We
+        // don't bother with objects either.
+        return false;
+    case datum_t::UNINITIALIZED: // fallthru
+    default:
+        unreachable();
+    }
+}
+
+bool datum_t::append_sort_key(std::string *key_out) const {
+    return append_sort_key_at_depth(*this, 0, key_out);
+}
+
 bool datum_t::operator==(const datum_t &rhs) const { return cmp(rhs) == 0; }
 bool datum_t::operator!=(const datum_t &rhs) const { return cmp(rhs) != 0; }
 bool datum_t::operator<(const datum_t &rhs) const { return cmp(rhs) < 0; }
@@ -1888,7 +2154,8 @@ datum_t to_datum(const Datum *d, const configured_limits_t &limits,
         const int count = d->r_object_size();
         for (int i = 0; i < count; ++i) {
             const Datum_AssocPair *ap = &d->r_object(i);
-            datum_string_t key(ap->key());
+            datum_string_t key = datum_string_t::intern(ap->key().size(),
+                                                        ap->key().data());
             fail_if_invalid(ap->key());
             auto res = map.insert(std::make_pair(key,
                                                  to_datum(&ap->val(), limits,
@@ -1963,6 +2230,10 @@ size_t datum_t::trunc_size(size_t primary_key_size) {
     return MAX_KEY_SIZE - terminated_primary_key_size - tag_size - 2;
 }
 
+bool datum_t::secondary_is_truncated(const components_t &components) {
+    return components.secondary.size() >= trunc_size(components.primary.size());
+}
+
 bool datum_t::key_is_truncated(const store_key_t &key) {
     std::string key_str = key_to_unescaped_str(key);
     if (extract_tag(key_str).has_value()) {
@@ -2301,6 +2572,9 @@ void debug_print(printf_buffer_t *buf, const datum_t &d) {
     case datum_t::internal_type_t::BUF_R_OBJECT:
         buf->appendf("d/buf_r_object(...)");
         break;
+    case datum_t::internal_type_t::PERSISTENT_R_ARRAY:
+        buf->appendf("d/persistent_r_array(size=%zu)", d.data.r_persistent_array->size());
+        break;
     default:
         buf->appendf("datum/garbage{internal_type=%d}", static_cast<int>(d.data.get_internal_type()));
         break;
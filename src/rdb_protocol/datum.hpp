@@ -15,6 +15,7 @@
 #include "containers/archive/archive.hpp"
 #include "containers/counted.hpp"
 #include "containers/optional.hpp"
+#include "containers/persistent_vector.hpp"
 #include "rdb_protocol/datum_string.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
@@ -120,6 +121,7 @@ private:
         R_STR,
         BUF_R_ARRAY,
         BUF_R_OBJECT,
+        PERSISTENT_R_ARRAY,
         MAXVAL
     };
 public:
@@ -260,6 +262,14 @@ public:
     store_key_t truncated_secondary(
         reql_version_t reql_version,
         extrema_ok_t extrema_ok = extrema_ok_t::NOT_OK) const;
+    /* Like `truncated_secondary`, but only cut down to `MAX_KEY_SIZE + 1` bytes, which
+    is still enough to tell whether a stored key matches exactly. */
+    std::string untruncated_secondary(
+        reql_version_t reql_version,
+        extrema_ok_t extrema_ok = extrema_ok_t::NOT_OK) const;
+    /* Whether the secondary part of a key that `print_secondary` produced got
+    truncated, going by the length of the key's own primary key. */
+    static bool secondary_is_truncated(const components_t &components);
     void check_type(type_t desired, const char *msg = NULL) const;
     NORETURN void type_error(const std::string &msg) const;
 
@@ -273,6 +283,11 @@ public:
     size_t arr_size() const;
     // Access an element of an array.
     datum_t get(size_t index, throw_bool_t throw_bool = THROW) const;
+    // Returns a copy of this array with `val` appended.  Arrays of at least
+    // `PERSISTENT_ARRAY_MIN_SIZE` elements share their elements with the copy, so
+    // building an array by appending to it one element at a time takes O(n log n)
+    // instead of O(n^2) time.
+    datum_t append(datum_t val, const configured_limits_t &limits) const;
 
     // Object interface
     size_t obj_size() const;
@@ -317,6 +332,13 @@ public:
     // alphabetically by type name.
     int cmp(const datum_t &rhs) const;
 
+    // Appends a key to `key_out` such that comparing the keys of two datums with
+    // `memcmp` (i.e. `std::string::compare`) gives the same result as `cmp`.  Only
+    // numbers, strings, booleans, `null`, `r.minval`, `r.maxval` and arrays of those
+    // have such a key; for anything else this returns false, and `key_out` is left in
+    // an unspecified state.
+    bool append_sort_key(std::string *key_out) const;
+
     // operator== and operator!= don't take a reql_version_t, unlike other comparison
     // functions, because we know (by inspection) that the behavior of cmp() hasn't
     // changed with respect to the question of equality vs. inequality.
@@ -361,6 +383,9 @@ private:
     template<class callable_t>
     inline void call_with_enough_stack_datum(callable_t &&fun) const;
 
+    // Used by `append`
+    explicit datum_t(persistent_vector_t<datum_t> &&_array);
+
     friend void pseudo::sanitize_time(datum_t *time);
     // Must only be used during pseudo type sanitization.
     // The key must already exist.
@@ -434,6 +459,7 @@ private:
         explicit data_wrapper_t(
                 std::vector<std::pair<datum_string_t, datum_t> > &&object);
         data_wrapper_t(type_t type, shared_buf_ref_t<char> &&_buf_ref);
+        explicit data_wrapper_t(persistent_vector_t<datum_t> &&array);
 
         ~data_wrapper_t();
 
@@ -448,6 +474,8 @@ private:
             counted_t<countable_wrapper_t<std::vector< //NOLINT(whitespace/operators)
                 std::pair<datum_string_t, datum_t> > > > r_object;
             shared_buf_ref_t<char> buf_ref;
+            counted_t<countable_wrapper_t<persistent_vector_t<datum_t> > >
+                r_persistent_array;
         };
     private:
         void assign_copy(const data_wrapper_t &copyee);
@@ -469,6 +497,16 @@ datum_t to_datum(
     const configured_limits_t &,
     reql_version_t);
 
+// Parses the null-terminated JSON string `json` into a datum the same way as
+// `to_datum(const rapidjson::Value &, ...)`, but without building a
+// `rapidjson::Document` on the way.  Parses in situ, so it modifies `json`.  Returns
+// false and sets `error_out` if `json` isn't valid JSON, and throws if it doesn't make
+// a valid datum.
+MUST_USE bool parse_json_to_datum(char *json,
+                                  const configured_limits_t &limits,
+                                  datum_t *datum_out,
+                                  rapidjson::ParseErrorCode *error_out);
+
 // DEPRECATED: Used in the r.json term for pre 2.1 backwards compatibility
 datum_t to_datum(cJSON *json, const configured_limits_t &, reql_version_t);
 
@@ -7,6 +7,7 @@
 #include "rdb_protocol/datum_stream/array.hpp"
 #include "rdb_protocol/datum_stream/eq_join.hpp"
 #include "rdb_protocol/datum_stream/fold.hpp"
+#include "rdb_protocol/datum_stream/hash_join.hpp"
 #include "rdb_protocol/datum_stream/indexed_sort.hpp"
 #include "rdb_protocol/datum_stream/lazy.hpp"
 #include "rdb_protocol/datum_stream/map.hpp"
@@ -45,6 +46,7 @@ read_mode_t up_to_date_read_mode(read_mode_t in) {
     case read_mode_t::MAJORITY: return in;
     case read_mode_t::SINGLE:   return in;
     case read_mode_t::OUTDATED: return read_mode_t::SINGLE;
+    case read_mode_t::NEAREST:  return read_mode_t::SINGLE;
     case read_mode_t::DEBUG_DIRECT:
         rfail_datum(base_exc_t::LOGIC,
                     "DEBUG_DIRECT is not a legal read mode for this operation "
@@ -1670,6 +1672,104 @@ offsets_of_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &bs) {
     return ret;
 }
 
+// HASH_JOIN_DATUM_STREAM_T
+hash_join_datum_stream_t::hash_join_datum_stream_t(counted_t<datum_stream_t> _left,
+                                                   counted_t<datum_stream_t> _right,
+                                                   datum_string_t _left_field,
+                                                   datum_string_t _right_field,
+                                                   counted_t<const func_t> _f)
+    : wrapper_datum_stream_t(_left),
+      right(std::move(_right)),
+      left_field(std::move(_left_field)),
+      right_field(std::move(_right_field)),
+      f(std::move(_f)),
+      built(false),
+      use_index(true) {
+    guarantee(source.has() && right.has() && f.has());
+}
+
+void hash_join_datum_stream_t::build(env_t *env) {
+    // Like the nested loop, we don't read the right side if the left side is empty.
+    built = true;
+    batchspec_t bs = batchspec_t::all();
+    for (;;) {
+        std::vector<datum_t> v = right->next_batch(env, bs);
+        if (v.size() == 0) {
+            break;
+        }
+        std::move(v.begin(), v.end(), std::back_inserter(right_rows));
+        rcheck_array_size(right_rows, env->limits());
+    }
+    std::string encoded;
+    for (size_t i = 0; i < right_rows.size() && use_index; ++i) {
+        const datum_t &row = right_rows[i];
+        if (row.get_type() != datum_t::R_OBJECT || row.is_ptype()) {
+            use_index = false;
+            break;
+        }
+        datum_t value = row.get_field(right_field, NOTHROW);
+        if (!value.has()) {
+            use_index = false;
+        } else if (encode_group_key(value, &encoded)) {
+            index[encoded].push_back(i);
+        }
+        // Other values can't be equal to a scalar, so left rows that hit the index
+        // never have to see them.
+    }
+    if (!use_index) {
+        index.clear();
+    }
+}
+
+void hash_join_datum_stream_t::probe(env_t *env,
+                                     const datum_t &left_row,
+                                     std::vector<datum_t> *out) {
+    std::string encoded;
+    if (use_index
+        && left_row.get_type() == datum_t::R_OBJECT
+        && !left_row.is_ptype()) {
+        datum_t value = left_row.get_field(left_field, NOTHROW);
+        if (value.has() && encode_group_key(value, &encoded)) {
+            auto it = index.find(encoded);
+            if (it != index.end()) {
+                for (size_t i : it->second) {
+                    out->push_back(datum_t(std::map<datum_string_t, datum_t>{
+                        std::make_pair(datum_string_t("left"), left_row),
+                        std::make_pair(datum_string_t("right"), right_rows[i])}));
+                }
+            }
+            return;
+        }
+    }
+    for (const datum_t &right_row : right_rows) {
+        if (f->call(env, left_row, right_row)->as_bool()) {
+            out->push_back(datum_t(std::map<datum_string_t, datum_t>{
+                std::make_pair(datum_string_t("left"), left_row),
+                std::make_pair(datum_string_t("right"), right_row)}));
+        }
+    }
+}
+
+std::vector<datum_t>
+hash_join_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &bs) {
+    std::vector<datum_t> ret;
+    profile::sampler_t sampler("Hash joining eagerly.", env->trace);
+    while (ret.size() == 0) {
+        std::vector<datum_t> v = source->next_batch(env, bs);
+        if (v.size() == 0) {
+            break;
+        }
+        if (!built) {
+            build(env);
+        }
+        for (const datum_t &left_row : v) {
+            probe(env, left_row, &ret);
+            sampler.new_sample();
+        }
+    }
+    return ret;
+}
+
 // SLICE_DATUM_STREAM_T
 slice_datum_stream_t::slice_datum_stream_t(
     uint64_t _left, uint64_t _right, counted_t<datum_stream_t> _src)
@@ -1799,6 +1899,7 @@ public:
     void maybe_launch_read() {
         if (!stream->is_exhausted() && !running) {
             running = true;
+            parent->reads_in_flight += 1;
             auto_drainer_t::lock_t lock(&parent->drainer);
             if (stream->cfeed_type() == feed_type_t::not_feed) {
                 // We only launch a limited number of non-feed reads per union
@@ -1860,6 +1961,7 @@ private:
             }
         }
         running = false;
+        parent->reads_in_flight -= 1;
     }
     bool running, is_first_batch;
     union_datum_stream_t *parent;
@@ -1993,6 +2095,12 @@ bool ordered_union_datum_stream_t::is_exhausted() const {
 // at a time. This limit does not apply to changefeed streams.
 const size_t MAX_CONCURRENT_UNION_READS = 32;
 
+// The maximum number of batches that a union_datum_stream reads ahead of its consumer,
+// counting both the batches in its queue and the reads that are in flight. The actual
+// depth adapts between 1 and this, depending on whether the consumer has to wait for
+// data. This doesn't apply to changefeed streams either.
+const size_t MAX_UNION_PREFETCH_BATCHES = 8;
+
 union_datum_stream_t::union_datum_stream_t(
     env_t *env,
     std::vector<counted_t<datum_stream_t> > &&streams,
@@ -2005,6 +2113,9 @@ union_datum_stream_t::union_datum_stream_t(
       ready_needed(expected_states),
       read_coro_pool(MAX_CONCURRENT_UNION_READS, &read_queue, &read_coro_callback),
       active(0),
+      reads_in_flight(0),
+      prefetch_depth(1),
+      next_prefetch(0),
       coros_exhausted(false) {
 
     for (const auto &stream : streams) {
@@ -2037,10 +2148,17 @@ union_datum_stream_t::next_batch_impl(env_t *env, const batchspec_t &batchspec)
     auto_drainer_t::lock_t lock(&drainer);
     wait_any_t interruptor(env->interruptor, lock.get_drain_signal(),
                            abort_exc.get_ready_signal());
+    if (union_type == feed_type_t::not_feed && coro_batchspec.has()) {
+        // If the consumer finds nothing waiting for it, we didn't read far enough
+        // ahead. If batches pile up, the reads ahead are wasted memory.
+        if (queue.size() == 0) {
+            prefetch_depth = std::min(prefetch_depth + 1, MAX_UNION_PREFETCH_BATCHES);
+        } else if (queue.size() > 1) {
+            prefetch_depth = std::max<size_t>(prefetch_depth - 1, 1);
+        }
+    }
     for (;;) {
         try {
-            // The client is already doing prefetching, so we don't want to do
-            // *double* prefetching by prefetching on the server as well.
             while (queue.size() == 0) {
                 std::exception_ptr exc;
                 if (abort_exc.try_get_value(&exc)) std::rethrow_exception(exc);
@@ -2103,10 +2221,30 @@ union_datum_stream_t::next_batch_impl(env_t *env, const batchspec_t &batchspec)
             }
         }
         if (active == 0 && queue.size() == 0) coros_exhausted = true;
+        prefetch();
         return data;
     }
 }
 
+void union_datum_stream_t::prefetch() {
+    // Changefeed reads can block indefinitely, so they are only launched when the
+    // consumer actually waits for data.
+    if (union_type != feed_type_t::not_feed) {
+        return;
+    }
+    // We start with a different substream every time so that reading ahead doesn't
+    // favor the first substreams.
+    for (size_t i = 0; i < coro_streams.size(); ++i) {
+        if (queue.size() + reads_in_flight >= prefetch_depth) {
+            break;
+        }
+        coro_streams[(next_prefetch + i) % coro_streams.size()]->maybe_launch_read();
+    }
+    if (!coro_streams.empty()) {
+        next_prefetch = (next_prefetch + 1) % coro_streams.size();
+    }
+}
+
 void union_datum_stream_t::add_transformation(transform_variant_t &&tv,
                                               backtrace_id_t _bt) {
     for (auto &&coro_stream : coro_streams) {
@@ -0,0 +1,50 @@
+#ifndef RDB_PROTOCOL_DATUM_STREAM_HASH_JOIN_HPP_
+#define RDB_PROTOCOL_DATUM_STREAM_HASH_JOIN_HPP_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rdb_protocol/datum_stream.hpp"
+
+namespace ql {
+
+/* Implements `inner_join` when the join condition is an equality between a field of
+each side, as in `function(l, r) { return l('a').eq(r('b')); }`.  The right side is
+read into memory once (up to the array size limit) and indexed by the value of its
+field, and then every left row only has to look at the right rows with the same
+value.  Rows come out in the same order as with the nested loop.
+
+Rows the index can't handle exactly like the condition would (a left value that
+isn't a scalar, or a right row without the field) are matched by calling the
+condition on every right row, so that the results and errors stay the same. */
+class hash_join_datum_stream_t : public wrapper_datum_stream_t {
+public:
+    hash_join_datum_stream_t(counted_t<datum_stream_t> _left,
+                             counted_t<datum_stream_t> _right,
+                             datum_string_t _left_field,
+                             datum_string_t _right_field,
+                             counted_t<const func_t> _f);
+
+private:
+    std::vector<datum_t>
+    next_raw_batch(env_t *env, const batchspec_t &batchspec);
+    void build(env_t *env);
+    void probe(env_t *env, const datum_t &left_row, std::vector<datum_t> *out);
+
+    counted_t<datum_stream_t> right;
+    datum_string_t left_field, right_field;
+    counted_t<const func_t> f;
+
+    bool built;
+    // False if some right row doesn't have `right_field`, in which case every left
+    // row is matched with the condition.
+    bool use_index;
+    std::vector<datum_t> right_rows;
+    // Indexes into `right_rows` for every encoded value of `right_field`, in order.
+    std::unordered_map<std::string, std::vector<size_t> > index;
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_DATUM_STREAM_HASH_JOIN_HPP_
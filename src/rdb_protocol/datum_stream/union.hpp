@@ -34,6 +34,10 @@ private:
     std::vector<datum_t >
     next_batch_impl(env_t *env, const batchspec_t &batchspec);
 
+    // Launches reads on idle substreams so that up to `prefetch_depth` batches are
+    // queued or being read by the time the consumer asks for the next one.
+    void prefetch();
+
     // We need to keep these around to apply transformations to even though we
     // spawn coroutines to read from them.
     std::vector<scoped_ptr_t<coro_stream_t> > coro_streams;
@@ -63,6 +67,9 @@ private:
     coro_pool_t<std::function<void()> > read_coro_pool;
 
     size_t active;
+    size_t reads_in_flight;
+    size_t prefetch_depth;
+    size_t next_prefetch;
     // We recompute this only when `next_batch_impl` returns to retain the
     // invariant that a stream won't change from unexhausted to exhausted
     // without attempting to read more from it.
@@ -11,23 +11,47 @@
 #include "containers/archive/archive.hpp"
 #include "containers/archive/buffer_stream.hpp"
 #include "containers/archive/varint.hpp"
+#include "config/args.hpp"
 #include "containers/scoped.hpp"
 #include "debug.hpp"
+#include "thread_local.hpp"
 #include "utils.hpp"
 
+TLS_with_init(datum_string_t *, interned_strings, nullptr);
+
+static_assert(sizeof(size_t) <= datum_string_t::MAX_INLINE_SIZE + 1,
+              "datum_string_t::inline_ must cover offset_");
+
 datum_string_t::datum_string_t() {
-    init(0, "");
+    init_inline(0, "");
+}
+
+datum_string_t::datum_string_t(datum_string_t &&movee) noexcept
+    : buf_(std::move(movee.buf_)) {
+    memcpy(&inline_, &movee.inline_, sizeof(inline_));
+    movee.init_inline(0, "");
+}
+
+datum_string_t &datum_string_t::operator=(datum_string_t &&movee) noexcept {
+    if (this != &movee) {
+        buf_ = std::move(movee.buf_);
+        memcpy(&inline_, &movee.inline_, sizeof(inline_));
+        movee.init_inline(0, "");
+    }
+    return *this;
 }
 
 datum_string_t::datum_string_t(size_t _size, const char *_data) {
     init(_size, _data);
 }
 
-datum_string_t::datum_string_t(const shared_buf_ref_t<char> &_ref)
-    : data_(_ref) { }
+datum_string_t::datum_string_t(const shared_buf_ref_t<char> &_ref) {
+    init_from_buf_ref(shared_buf_ref_t<char>(_ref));
+}
 
-datum_string_t::datum_string_t(shared_buf_ref_t<char> &&_ref)
-    : data_(std::move(_ref)) { }
+datum_string_t::datum_string_t(shared_buf_ref_t<char> &&_ref) {
+    init_from_buf_ref(std::move(_ref));
+}
 
 datum_string_t::datum_string_t(const char *c_str) {
     init(strlen(c_str), c_str);
@@ -38,27 +62,84 @@ datum_string_t::datum_string_t(const std::string &str) {
 }
 
 void datum_string_t::init(size_t _size, const char *_data) {
+    if (_size <= MAX_INLINE_SIZE) {
+        init_inline(_size, _data);
+        return;
+    }
     const size_t str_offset = varint_uint64_serialized_size(_size);
     counted_t<shared_buf_t> buffer = shared_buf_t::create(str_offset + _size);
     serialize_varint_uint64_into_buf(_size, reinterpret_cast<uint8_t *>(buffer->data()));
     memcpy(buffer->data() + str_offset, _data, _size);
-    data_ = shared_buf_ref_t<char>(std::move(buffer), 0);
+    buf_ = std::move(buffer);
+    offset_ = 0;
+}
+
+void datum_string_t::init_from_buf_ref(shared_buf_ref_t<char> &&_ref) {
+    uint64_t str_size = 0;
+    static_assert(sizeof(uint8_t) == sizeof(char), "sizeof(uint8_t) != sizeof(char)");
+    buffer_read_stream_t data_stream(_ref.get(), _ref.get_safety_boundary());
+    guarantee_deserialization(deserialize_varint_uint64(&data_stream, &str_size),
+                              "wire_string size");
+    guarantee(str_size <= static_cast<uint64_t>(std::numeric_limits<size_t>::max()));
+    const size_t data_offset = data_stream.tell();
+    _ref.guarantee_in_boundary(data_offset + str_size);
+
+    // Copying a short string is cheaper than keeping the buffer alive for it.
+    if (str_size <= MAX_INLINE_SIZE) {
+        init_inline(str_size, _ref.get() + data_offset);
+    } else {
+        buf_ = _ref.get_buf();
+        offset_ = _ref.get_offset();
+    }
+}
+
+void datum_string_t::init_inline(size_t _size, const char *_data) {
+    rassert(_size <= MAX_INLINE_SIZE);
+    rassert(!buf_.has());
+    memcpy(inline_.data, _data, _size);
+    inline_.size = _size;
+}
+
+datum_string_t datum_string_t::intern(size_t _size, const char *_data) {
+    if (_size <= MAX_INLINE_SIZE || _size > DATUM_STRING_MAX_INTERNED_SIZE) {
+        return datum_string_t(_size, _data);
+    }
+
+    datum_string_t *table = TLS_get_interned_strings();
+    if (table == nullptr) {
+        // The table of each thread lives as long as the process.
+        table = new datum_string_t[DATUM_STRING_INTERN_SLOTS];
+        TLS_set_interned_strings(table);
+    }
+
+    // FNV-1a.  A key replaces whatever other key was in its slot.
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < _size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(_data[i])) * 1099511628211ULL;
+    }
+    datum_string_t *slot = &table[hash % DATUM_STRING_INTERN_SLOTS];
+    if (slot->compare(_size, _data) != 0) {
+        *slot = datum_string_t(_size, _data);
+    }
+    return *slot;
 }
 
 const char *datum_string_t::data() const {
-    const size_t str_size = size();
-    size_t data_offset = varint_uint64_serialized_size(str_size);
-    data_.guarantee_in_boundary(data_offset + str_size);
-    return data_.get() + data_offset;
+    if (!buf_.has()) {
+        return inline_.data;
+    }
+    // `init_from_buf_ref()` has checked that the buffer is large enough.
+    return buf_->data(offset_ + varint_uint64_serialized_size(size()));
 }
 
 size_t datum_string_t::size() const {
+    if (!buf_.has()) {
+        return inline_.size;
+    }
     uint64_t res = 0;
-    static_assert(sizeof(uint8_t) == sizeof(char), "sizeof(uint8_t) != sizeof(char)");
-    buffer_read_stream_t data_stream(data_.get(), data_.get_safety_boundary());
+    buffer_read_stream_t data_stream(buf_->data(offset_), buf_->size() - offset_);
     guarantee_deserialization(deserialize_varint_uint64(&data_stream, &res),
                               "wire_string size");
-    guarantee(res <= static_cast<uint64_t>(std::numeric_limits<size_t>::max()));
     return static_cast<size_t>(res);
 }
 
@@ -67,6 +148,9 @@ bool datum_string_t::empty() const {
 }
 
 int datum_string_t::compare(const datum_string_t &other) const {
+    if (same_buf_ref(other)) {
+        return 0;
+    }
     return compare(other.size(), other.data());
 }
 
@@ -97,6 +181,10 @@ bool datum_string_t::operator!=(const char *other) const {
 }
 
 bool datum_string_t::operator==(const datum_string_t &other) const {
+    // Interned strings share their buffer.
+    if (same_buf_ref(other)) {
+        return true;
+    }
     if (size() != other.size()) {
         return false;
     }
@@ -126,6 +214,12 @@ std::string datum_string_t::to_std() const {
 datum_string_t concat(const datum_string_t &a, const datum_string_t &b) {
     const size_t a_size = a.size();
     const size_t b_size = b.size();
+    if (a_size + b_size <= datum_string_t::MAX_INLINE_SIZE) {
+        char data[datum_string_t::MAX_INLINE_SIZE];
+        memcpy(data, a.data(), a_size);
+        memcpy(data + a_size, b.data(), b_size);
+        return datum_string_t(a_size + b_size, data);
+    }
     const size_t str_offset = varint_uint64_serialized_size(a_size + b_size);
     counted_t<shared_buf_t> buf = shared_buf_t::create(str_offset + a_size + b_size);
     serialize_varint_uint64_into_buf(a_size + b_size,
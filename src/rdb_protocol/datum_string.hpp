@@ -2,6 +2,8 @@
 #ifndef RDB_PROTOCOL_DATUM_STRING_HPP_
 #define RDB_PROTOCOL_DATUM_STRING_HPP_
 
+#include <stdint.h>
+
 #include <string>
 
 #include "containers/archive/archive.hpp"
@@ -13,13 +15,22 @@
  * - it can contain any character, including '\0'
  *
  * Underneath `datum_string_t` uses a `shared_buf_ref_t`. This makes it
- * relatively cheap to copy.
+ * relatively cheap to copy.  Strings of up to `MAX_INLINE_SIZE` bytes, which
+ * includes most object keys, are stored inside the `datum_string_t` instead, so
+ * that they don't need a buffer of their own.
  */
 class datum_string_t {
 public:
+    static const size_t MAX_INLINE_SIZE = 7;
+
     // Creates an empty datum_string_t
     datum_string_t();
 
+    datum_string_t(const datum_string_t &) = default;
+    datum_string_t(datum_string_t &&movee) noexcept;
+    datum_string_t &operator=(const datum_string_t &) = default;
+    datum_string_t &operator=(datum_string_t &&movee) noexcept;
+
     // Creates a datum_string_t with its content copied from _data
     datum_string_t(size_t _size, const char *_data);
 
@@ -35,6 +46,12 @@ public:
     explicit datum_string_t(const shared_buf_ref_t<char> &_ref);
     explicit datum_string_t(shared_buf_ref_t<char> &&_ref);
 
+    // Like `datum_string_t(_size, _data)`, but for object keys.  Equal keys up to
+    // `DATUM_STRING_MAX_INTERNED_SIZE` bytes that get created on the same thread
+    // usually share their buffer, which saves allocations and makes comparing them
+    // cheap.
+    static datum_string_t intern(size_t _size, const char *_data);
+
     // The result of data() is not automatically null terminated. Do not use
     // as a C string.
     const char *data() const;
@@ -42,6 +59,8 @@ public:
     bool empty() const;
 
     int compare(const datum_string_t &other) const;
+    // Compares to the `other_size` bytes at `other_data`.
+    int compare(size_t other_size, const char *other_data) const;
 
     // Short cut for comparing to C-strings and STD strings
     bool operator==(const char *other) const;
@@ -57,11 +76,25 @@ public:
 
 private:
     void init(size_t _size, const char *_data);
-    int compare(size_t other_size, const char *other_data) const;
+    void init_from_buf_ref(shared_buf_ref_t<char> &&_ref);
+    void init_inline(size_t _size, const char *_data);
+
+    // Whether the two strings refer to the same place in the same buffer.
+    bool same_buf_ref(const datum_string_t &other) const {
+        return buf_.has() && buf_.get() == other.buf_.get() && offset_ == other.offset_;
+    }
 
-    // Contains the length of the string in varint encoding, followed by the actual
+    // Empty for strings that are stored in `inline_`.  Otherwise the buffer contains
+    // the length of the string in varint encoding at `offset_`, followed by the actual
     // string content.
-    shared_buf_ref_t<char> data_;
+    counted_t<const shared_buf_t> buf_;
+    union {
+        size_t offset_;
+        struct {
+            char data[MAX_INLINE_SIZE];
+            uint8_t size;
+        } inline_;
+    };
 };
 
 datum_string_t concat(const datum_string_t &a, const datum_string_t &b);
@@ -121,6 +121,11 @@ std::string datum_range_t::get_right_bound_trunc_key(reql_version_t reql_ver) co
         ql::extrema_ok_t::OK));
 }
 
+std::string datum_range_t::get_left_bound_untrunc_key(reql_version_t reql_ver) const {
+    guarantee(left_bound_type != key_range_t::bound_t::none);
+    return left_bound.untruncated_secondary(reql_ver, ql::extrema_ok_t::OK);
+}
+
 datum_range_t datum_range_t::with_left_bound(datum_t d, key_range_t::bound_t type) {
     r_sanity_check(d.has() && right_bound.has());
     return datum_range_t(d, type, right_bound, right_bound_type);
@@ -40,6 +40,8 @@ public:
     // respectively.
     std::string get_left_bound_trunc_key(reql_version_t ver) const;
     std::string get_right_bound_trunc_key(reql_version_t ver) const;
+    // Like `get_left_bound_trunc_key`, but see `datum_t::untruncated_secondary`.
+    std::string get_left_bound_untrunc_key(reql_version_t ver) const;
 
     datum_range_t with_left_bound(datum_t d, key_range_t::bound_t type);
     datum_range_t with_right_bound(datum_t d, key_range_t::bound_t type);
@@ -77,7 +77,8 @@ env_t::env_t(rdb_context_t *ctx,
       trace(_trace),
       evals_since_yield_(0),
       rdb_ctx_(ctx),
-      eval_callback_(NULL) {
+      eval_callback_(NULL),
+      query_stats_(nullptr) {
     rassert(ctx != NULL);
     rassert(interruptor != NULL);
 }
@@ -113,11 +114,29 @@ env_t::env_t(signal_t *_interruptor,
       trace(NULL),
       evals_since_yield_(0),
       rdb_ctx_(NULL),
-      eval_callback_(NULL) {
+      eval_callback_(NULL),
+      query_stats_(nullptr) {
     rassert(interruptor != NULL);
 }
 
-env_t::~env_t() { }
+env_t::~env_t() {
+    if (rdb_ctx_ != NULL) {
+        rdb_ctx_->stats.eval_arena_bytes += arena_.bytes_from_blocks();
+        rdb_ctx_->stats.eval_arena_heap_bytes += arena_.bytes_from_heap();
+    }
+}
+
+datum_t env_t::find_hoisted_value(const runtime_term_t *term) const {
+    auto it = hoisted_values_.find(term);
+    return it == hoisted_values_.end() ? datum_t() : it->second.second;
+}
+
+void env_t::add_hoisted_value(const runtime_term_t *term, const datum_t &value) {
+    if (hoisted_values_.size() < MAX_HOISTED_VALUES) {
+        hoisted_values_[term] =
+            std::make_pair(counted_t<const runtime_term_t>(term), value);
+    }
+}
 
 void env_t::maybe_yield() {
     if (++evals_since_yield_ > EVALS_BEFORE_YIELD) {
@@ -10,8 +10,10 @@
 
 #include "clustering/administration/auth/user_context.hpp"
 #include "concurrency/one_per_thread.hpp"
+#include "containers/arena.hpp"
 #include "containers/counted.hpp"
 #include "containers/lru_cache.hpp"
+#include "extproc/http_runner.hpp"
 #include "extproc/js_runner.hpp"
 #include "rdb_protocol/configured_limits.hpp"
 #include "rdb_protocol/context.hpp"
@@ -31,6 +33,7 @@ class RE2;
 
 namespace ql {
 class datum_t;
+class runtime_term_t;
 class term_t;
 
 scoped_ptr_t<profile::trace_t> maybe_make_profile_trace(profile_bool_t profile);
@@ -75,6 +78,9 @@ public:
     // already been called.
     js_runner_t *get_js_runner();
 
+    // Used to send the query's concurrent `r.http` requests to the workers together.
+    http_batcher_t *get_http_batcher() { return &http_batcher_; }
+
     reql_cluster_interface_t *reql_cluster_interface();
 
     std::string get_reql_http_proxy();
@@ -128,6 +134,12 @@ public:
 
     regex_cache_t &regex_cache() { return regex_cache_; }
 
+    // The values of the hoisted terms that have been evaluated in this environment,
+    // see `term_t::hoist_invariants()`.  Returns an empty `datum_t` if `term` hasn't
+    // been evaluated yet.
+    datum_t find_hoisted_value(const runtime_term_t *term) const;
+    void add_hoisted_value(const runtime_term_t *term, const datum_t &value);
+
     reql_version_t reql_version() const { return reql_version_; }
 
 private:
@@ -157,16 +169,37 @@ public:
 
     rdb_context_t *get_rdb_ctx() { return rdb_ctx_; }
 
+    // Scratch space for evaluating batches, see `batch_expr_t::eval()`.
+    arena_t *arena() { return &arena_; }
+
+    // The reads that the query does add their `read_response_t::stats` to this, unless
+    // it's null.
+    query_stats_t *query_stats() { return query_stats_; }
+    void set_query_stats(query_stats_t *query_stats) { query_stats_ = query_stats; }
+
 private:
     static const uint32_t EVALS_BEFORE_YIELD = 256;
     uint32_t evals_since_yield_;
 
+    // Some terms compile functions while they're evaluated, so the entries hold a
+    // reference to their term to keep its address from being reused, and there's a
+    // limit on how many there can be.
+    static const size_t MAX_HOISTED_VALUES = 1024;
+    std::map<const runtime_term_t *,
+             std::pair<counted_t<const runtime_term_t>, datum_t> > hoisted_values_;
+
     rdb_context_t *const rdb_ctx_;
 
     js_runner_t js_runner_;
 
+    http_batcher_t http_batcher_;
+
     eval_callback_t *eval_callback_;
 
+    arena_t arena_;
+
+    query_stats_t *query_stats_;
+
     DISABLE_COPYING(env_t);
 };
 
@@ -0,0 +1,60 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/field_predicate.hpp"
+
+#include <utility>
+
+#include "rdb_protocol/error.hpp"
+
+namespace ql {
+
+field_predicate_t::field_predicate_t(optional<sym_t> _var,
+                                     datum_string_t _field,
+                                     Term::TermType _comparison,
+                                     datum_t _constant,
+                                     bool _constant_on_left)
+    : var(std::move(_var)),
+      field(std::move(_field)),
+      comparison(_comparison),
+      constant(std::move(_constant)),
+      constant_on_left(_constant_on_left) { }
+
+bool field_predicate_t::uses_argument_of(const std::vector<sym_t> &arg_names) const {
+    if (arg_names.size() != 1) {
+        return false;
+    }
+    return var.has_value()
+        ? var->value == arg_names[0].value
+        : function_emits_implicit_variable(arg_names);
+}
+
+optional<bool> field_predicate_t::eval(const datum_t &row) const {
+    // Pseudotypes are treated specially by the field access terms.
+    if (!row.has() || row.get_type() != datum_t::R_OBJECT || row.is_ptype()) {
+        return r_nullopt;
+    }
+    return eval_field(row.get_field(field, NOTHROW));
+}
+
+optional<bool> field_predicate_t::eval_field(const datum_t &value) const {
+    if (!value.has()) {
+        return r_nullopt;
+    }
+    const datum_t &lhs = constant_on_left ? constant : value;
+    const datum_t &rhs = constant_on_left ? value : constant;
+    try {
+        // This matches `predicate_term_t`.
+        switch (static_cast<int>(comparison)) {
+        case Term::EQ: return make_optional(lhs == rhs);
+        case Term::NE: return make_optional(!(lhs == rhs));
+        case Term::LT: return make_optional(lhs.cmp(rhs) < 0);
+        case Term::LE: return make_optional(lhs.cmp(rhs) <= 0);
+        case Term::GT: return make_optional(lhs.cmp(rhs) > 0);
+        case Term::GE: return make_optional(lhs.cmp(rhs) >= 0);
+        default: unreachable();
+        }
+    } catch (const base_exc_t &) {
+        return r_nullopt;
+    }
+}
+
+}  // namespace ql
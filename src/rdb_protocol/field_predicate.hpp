@@ -0,0 +1,55 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_FIELD_PREDICATE_HPP_
+#define RDB_PROTOCOL_FIELD_PREDICATE_HPP_
+
+#include <vector>
+
+#include "containers/optional.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/sym.hpp"
+
+namespace ql {
+
+/* A comparison of a top-level field of a variable with a constant, as in
+`r.row('age').gt(30)` or `r.expr('DE').eq(x('country'))`.  `predicate_term_t`
+recognizes these when it gets compiled, and functions whose body is one of them
+evaluate it directly on the row, without going through the term tree. */
+class field_predicate_t {
+public:
+    // `var` is empty for the implicit variable.
+    field_predicate_t(optional<sym_t> var,
+                      datum_string_t field,
+                      Term::TermType comparison,
+                      datum_t constant,
+                      bool constant_on_left);
+
+    // Whether the variable being compared is the argument of a function with these
+    // argument names.
+    bool uses_argument_of(const std::vector<sym_t> &arg_names) const;
+
+    // Returns the result of the comparison, or `r_nullopt` if the row has to be
+    // evaluated the regular way (for example because the field is missing, so that
+    // the right error gets thrown).
+    optional<bool> eval(const datum_t &row) const;
+
+    // Like `eval`, but takes the field's value (or an empty datum if the row doesn't
+    // have it).  Lets callers that can read single fields out of a serialized row
+    // avoid loading the whole row.
+    optional<bool> eval_field(const datum_t &value) const;
+
+    const datum_string_t &get_field() const { return field; }
+    Term::TermType get_comparison() const { return comparison; }
+    const datum_t &get_constant() const { return constant; }
+
+private:
+    optional<sym_t> var;
+    datum_string_t field;
+    Term::TermType comparison;
+    datum_t constant;
+    bool constant_on_left;
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_FIELD_PREDICATE_HPP_
@@ -3,11 +3,14 @@
 
 #include "pprint/js_pprint.hpp"
 #include "pprint/pprint.hpp"
+#include "rdb_protocol/batch_expr.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/field_predicate.hpp"
 #include "rdb_protocol/minidriver.hpp"
 #include "rdb_protocol/pseudo_literal.hpp"
 #include "rdb_protocol/ql2.pb.h"
 #include "rdb_protocol/term_walker.hpp"
+#include "rdb_protocol/terms/obj_or_seq.hpp"
 #include "stl_utils.hpp"
 
 namespace ql {
@@ -33,19 +36,53 @@ scoped_ptr_t<val_t> func_t::call(env_t *env,
     return call(env, make_vector(arg1, arg2), eval_flags);
 }
 
+scoped_ptr_t<batch_expr_t> func_t::make_batch_expr() const {
+    return scoped_ptr_t<batch_expr_t>();
+}
+
 void func_t::assert_deterministic(const char *extra_msg) const {
     rcheck(is_deterministic() == deterministic_t::always,
            base_exc_t::LOGIC,
            strprintf("Could not prove function deterministic.  %s", extra_msg));
 }
 
+const field_predicate_t *find_field_predicate(const term_t *body,
+                                              const std::vector<sym_t> &arg_names) {
+    const field_predicate_t *pred = body->get_field_predicate();
+    return pred != nullptr && pred->uses_argument_of(arg_names) ? pred : nullptr;
+}
+
+void find_external_calls(const raw_term_t &term, bool *http_out, bool *js_out) {
+    if (term.type() == Term::HTTP) {
+        *http_out = true;
+    } else if (term.type() == Term::JAVASCRIPT) {
+        *js_out = true;
+    } else if (term.type() == Term::DATUM) {
+        return;
+    }
+    for (size_t i = 0; i < term.num_args(); ++i) {
+        find_external_calls(term.arg(i), http_out, js_out);
+    }
+    term.each_optarg([&](const raw_term_t &optarg, const std::string &) {
+        find_external_calls(optarg, http_out, js_out);
+    });
+}
+
+bool only_makes_http_requests(const term_t *body) {
+    bool http = false, js = false;
+    find_external_calls(body->get_src(), &http, &js);
+    return http && !js;
+}
+
 reql_func_t::reql_func_t(const var_scope_t &_captured_scope,
                          std::vector<sym_t> _arg_names,
                          counted_t<const term_t> _body)
     : func_t(_body->backtrace()),
       captured_scope(_captured_scope),
       arg_names(std::move(_arg_names)),
-      body(std::move(_body)) { }
+      body(std::move(_body)),
+      field_predicate(find_field_predicate(body.get(), arg_names)),
+      makes_http_requests(only_makes_http_requests(body.get())) { }
 
 reql_func_t::reql_func_t(scoped_ptr_t<term_storage_t> &&_storage,
                          const var_scope_t &_captured_scope,
@@ -55,7 +92,9 @@ reql_func_t::reql_func_t(scoped_ptr_t<term_storage_t> &&_storage,
       captured_scope(_captured_scope),
       arg_names(std::move(_arg_names)),
       term_storage(std::move(_storage)),
-      body(std::move(_body)) { }
+      body(std::move(_body)),
+      field_predicate(find_field_predicate(body.get(), arg_names)),
+      makes_http_requests(only_makes_http_requests(body.get())) { }
 
 reql_func_t::~reql_func_t() { }
 
@@ -75,6 +114,15 @@ scoped_ptr_t<val_t> reql_func_t::call(env_t *env,
                          arg_names.size(),
                          (arg_names.size() == 1 ? "" : "s")));
 
+        // Profiling wants to see the terms being evaluated.
+        if (field_predicate != nullptr
+            && env->profile() == profile_bool_t::DONT_PROFILE) {
+            optional<bool> res = field_predicate->eval(args[0]);
+            if (res.has_value()) {
+                return make_scoped<val_t>(datum_t::boolean(*res), backtrace());
+            }
+        }
+
         var_scope_t new_scope = arg_names.size() == 0
             ? captured_scope
             : captured_scope.with_func_arg_list(arg_names, args);
@@ -99,6 +147,103 @@ bool reql_func_t::is_simple_selector() const {
     return body->is_simple_selector();
 }
 
+bool reql_func_t::get_top_level_fields_read(
+        std::vector<datum_string_t> *fields_out) const {
+    if (arg_names.size() != 1 || captured_scope.size() != 0) {
+        return false;
+    }
+    const raw_term_t &term = body->get_src();
+    if (term.num_optargs() != 0 || term.num_args() < 2) {
+        return false;
+    }
+    switch (term.type()) {
+    case Term::GET_FIELD: // fallthru
+    case Term::BRACKET:
+        if (term.num_args() != 2) {
+            return false;
+        }
+        break;
+    case Term::PLUCK:
+        break;
+    default:
+        return false;
+    }
+
+    const raw_term_t object = term.arg(0);
+    if (object.type() == Term::VAR) {
+        if (object.num_args() != 1 || object.arg(0).type() != Term::DATUM) {
+            return false;
+        }
+        const datum_t var = object.arg(0).datum();
+        if (var.get_type() != datum_t::R_NUM
+            || var.as_int() != arg_names[0].value) {
+            return false;
+        }
+    } else if (object.type() != Term::IMPLICIT_VAR
+               || !function_emits_implicit_variable(arg_names)) {
+        return false;
+    }
+
+    std::vector<datum_string_t> fields;
+    for (size_t i = 1; i < term.num_args(); ++i) {
+        const raw_term_t field = term.arg(i);
+        if (field.type() != Term::DATUM) {
+            return false;
+        }
+        const datum_t name = field.datum();
+        if (name.get_type() != datum_t::R_STR) {
+            return false;
+        }
+        fields.push_back(name.as_str());
+    }
+    *fields_out = std::move(fields);
+    return true;
+}
+
+bool reql_func_t::get_single_field_read(datum_string_t *field_out) const {
+    std::vector<datum_string_t> fields;
+    if (!get_top_level_fields_read(&fields)
+        || body->get_src().type() == Term::PLUCK) {
+        return false;
+    }
+    guarantee(fields.size() == 1);
+    *field_out = fields[0];
+    return true;
+}
+
+// Returns true if `term` reads a top-level field with a constant name from the only
+// argument of a function with the arguments `arg_names`, as `x('a')` does.
+static bool match_argument_field_access(const raw_term_t &term,
+                                        const std::vector<sym_t> &arg_names,
+                                        datum_string_t *field_out) {
+    optional<sym_t> var;
+    if (arg_names.size() != 1 || !match_var_field_access(term, &var, field_out)) {
+        return false;
+    }
+    return var.has_value()
+        ? var->value == arg_names[0].value
+        : function_emits_implicit_variable(arg_names);
+}
+
+bool reql_func_t::get_field_term_read(Term::TermType type,
+                                      datum_string_t *field_out) const {
+    const raw_term_t &term = body->get_src();
+    return captured_scope.size() == 0
+        && term.type() == type
+        && term.num_args() == 1
+        && term.num_optargs() == 0
+        && match_argument_field_access(term.arg(0), arg_names, field_out);
+}
+
+scoped_ptr_t<batch_expr_t> reql_func_t::make_batch_expr() const {
+    // Evaluating a field predicate directly is cheaper than going through the batch
+    // evaluator's columns.
+    if (field_predicate != nullptr) {
+        return scoped_ptr_t<batch_expr_t>();
+    }
+    return batch_expr_t::compile(arg_names, body->get_src());
+}
+
 js_func_t::js_func_t(const std::string &_js_source,
                      uint64_t timeout_ms,
                      backtrace_id_t _backtrace)
@@ -136,6 +281,32 @@ scoped_ptr_t<val_t> js_func_t::call(
     }
 }
 
+void js_func_t::call_batch(env_t *env,
+                           const std::vector<datum_t> &rows,
+                           std::vector<datum_t> *results_out) const {
+    js_runner_t::req_config_t config;
+    config.timeout_ms = js_timeout_ms;
+
+    r_sanity_check(!js_source.empty());
+    std::vector<js_result_t> results;
+    try {
+        results = env->get_js_runner()->call_batch(js_source, rows, config);
+    } catch (const extproc_worker_exc_t &) {
+        // `call()` reports the crash if it happens again.
+        return;
+    }
+
+    results_out->clear();
+    results_out->reserve(results.size());
+    for (js_result_t &result : results) {
+        datum_t *datum = boost::get<datum_t>(&result);
+        if (datum == nullptr) {
+            break;
+        }
+        results_out->push_back(std::move(*datum));
+    }
+}
+
 optional<size_t> js_func_t::arity() const {
     return r_nullopt;
 }
@@ -200,6 +371,7 @@ func_term_t::func_term_t(compile_env_t *env, const raw_term_t &t)
 
     counted_t<const term_t> compiled_body = compile_term(&body_env, raw_body);
     r_sanity_check(compiled_body.has());
+    compiled_body->hoist_invariants();
 
     var_captures_t captures;
     compiled_body->accumulate_captures(&captures);
@@ -260,6 +432,81 @@ bool filter_match(datum_t predicate, datum_t value,
     }
 }
 
+bool reql_func_t::get_equality_filter(datum_string_t *field_out,
+                                      datum_t *value_out) const {
+    datum_t value;
+    if (field_predicate != nullptr) {
+        if (field_predicate->get_comparison() != Term::EQ) {
+            return false;
+        }
+        *field_out = field_predicate->get_field();
+        value = field_predicate->get_constant();
+    } else if (arg_names.size() == 1 && body->get_src().type() == Term::DATUM) {
+        // `filter_helper` matches literal objects against the row.
+        const datum_t pattern = body->get_src().datum();
+        if (pattern.get_type() != datum_t::R_OBJECT
+            || pattern.is_ptype()
+            || pattern.obj_size() != 1) {
+            return false;
+        }
+        auto pair = pattern.get_pair(0);
+        *field_out = pair.first;
+        value = pair.second;
+    } else {
+        return false;
+    }
+    switch (value.get_type()) {
+    case datum_t::R_NULL: // fallthru
+    case datum_t::R_BOOL: // fallthru
+    case datum_t::R_NUM: // fallthru
+    case datum_t::R_STR:
+        *value_out = value;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool reql_func_t::get_match_filter(datum_string_t *field_out,
+                                   std::string *pattern_out) const {
+    const raw_term_t &term = body->get_src();
+    if (term.type() != Term::MATCH
+        || term.num_args() != 2
+        || term.num_optargs() != 0
+        || term.arg(1).type() != Term::DATUM) {
+        return false;
+    }
+    const datum_t pattern = term.arg(1).datum();
+    if (pattern.get_type() != datum_t::R_STR
+        || !match_argument_field_access(term.arg(0), arg_names, field_out)) {
+        return false;
+    }
+    *pattern_out = pattern.as_str().to_std();
+    return true;
+}
+
+bool reql_func_t::get_contains_filter(Term::TermType *type_out,
+                                      datum_string_t *field_out,
+                                      datum_t *value_out) const {
+    const raw_term_t &term = body->get_src();
+    if (term.type() != Term::CONTAINS
+        || term.num_args() < 2
+        || term.arg(1).type() != Term::DATUM) {
+        return false;
+    }
+    const raw_term_t array = term.arg(0);
+    const datum_t value = term.arg(1).datum();
+    if (value.get_type() != datum_t::R_STR
+        || array.num_args() != 1
+        || array.num_optargs() != 0
+        || !match_argument_field_access(array.arg(0), arg_names, field_out)) {
+        return false;
+    }
+    *type_out = array.type();
+    *value_out = value;
+    return true;
+}
+
 bool reql_func_t::filter_helper(env_t *env, datum_t arg) const {
     datum_t d = call(env, make_vector(arg), NO_FLAGS)->as_datum();
     if (d.get_type() == datum_t::R_OBJECT &&
@@ -24,6 +24,8 @@ class js_runner_t;
 
 namespace ql {
 
+class batch_expr_t;
+class field_predicate_t;
 class func_visitor_t;
 
 class func_t : public slow_atomic_countable_t<func_t>, public bt_rcheckable_t {
@@ -69,6 +71,78 @@ public:
         return false;
     }
 
+    // Returns true if the function takes one argument and returns either one or a
+    // handful of its top-level fields, as `x('a')` and `x.pluck('a', 'b')` do.  The
+    // names of those fields get put into `fields_out`.  Reads use this to only pull
+    // those fields out of a stored row.
+    virtual bool get_top_level_fields_read(
+            std::vector<datum_string_t> *) const {
+        return false;
+    }
+
+    // Returns true if the function takes one argument and returns one of its top-level
+    // fields, as `x('a')` does.  Filters use this to find the indexes that are
+    // keyed by a field.
+    virtual bool get_single_field_read(datum_string_t *) const {
+        return false;
+    }
+
+    // Returns true if the function takes one argument and applies a term of type
+    // `type` to one of its top-level fields, as `x('a').trigrams()` does for
+    // `Term::TRIGRAMS`.  Filters use this to find the multi indexes that `match` and
+    // `contains` filters on that field can read from.
+    virtual bool get_field_term_read(Term::TermType, datum_string_t *) const {
+        return false;
+    }
+
+    // Returns an evaluator that computes the function over a whole batch of rows at
+    // once, or an empty pointer if the function is too complicated for that.  See
+    // `batch_expr_t`.
+    virtual scoped_ptr_t<batch_expr_t> make_batch_expr() const;
+
+    // Calls the function on every row at once, for functions that can do that faster
+    // than one `call()` per row.  Sets `(*results_out)[i]` to the result for
+    // `rows[i]`, but may stop early (or not start at all), so that the remaining rows
+    // have to be evaluated with `call()`.  That way errors behave as usual.
+    virtual void call_batch(env_t *,
+                            const std::vector<datum_t> &,
+                            std::vector<datum_t> *) const { }
+
+    // Returns the comparison the function consists of if it takes one argument and
+    // compares a field of it with a constant.  See `field_predicate_t`.
+    virtual const field_predicate_t *get_field_predicate() const {
+        return nullptr;
+    }
+
+    // Returns true if `filter` with this function keeps exactly the objects whose field
+    // `*field_out` is equal to `*value_out`, which is null, a boolean, a number or a
+    // string.  Changefeeds use this to only show changes to the filters they can pass.
+    virtual bool get_equality_filter(datum_string_t *, datum_t *) const {
+        return false;
+    }
+
+    // Returns true if `filter` with this function keeps exactly the objects whose
+    // field `*field_out` is a string that the regular expression `*pattern_out`
+    // matches, as `x('a').match('smith')` does.
+    virtual bool get_match_filter(datum_string_t *, std::string *) const {
+        return false;
+    }
+
+    // Returns true if `filter` with this function only keeps objects for which a term
+    // of type `*type_out`, applied to their field `*field_out`, returns an array that
+    // contains the string `*value_out`, as `x('a').tokens().contains('b', 'c')` does.
+    virtual bool get_contains_filter(Term::TermType *, datum_string_t *,
+                                     datum_t *) const {
+        return false;
+    }
+
+    // Returns true if the function makes `r.http` requests, so that calling it mostly
+    // means waiting, and calls on different rows may as well overlap.  (JavaScript
+    // functions don't count, since an `env_t` only has one JavaScript runner.)
+    virtual bool waits_on_external_calls() const {
+        return false;
+    }
+
 protected:
     explicit func_t(backtrace_id_t bt);
 
@@ -108,6 +182,24 @@ public:
     void visit(func_visitor_t *visitor) const;
 
     bool is_simple_selector() const final;
+    bool get_top_level_fields_read(std::vector<datum_string_t> *fields_out) const final;
+    bool get_single_field_read(datum_string_t *field_out) const final;
+    bool get_field_term_read(Term::TermType type,
+                             datum_string_t *field_out) const final;
+    scoped_ptr_t<batch_expr_t> make_batch_expr() const final;
+    const field_predicate_t *get_field_predicate() const final {
+        return field_predicate;
+    }
+    bool get_equality_filter(datum_string_t *field_out,
+                             datum_t *value_out) const final;
+    bool get_match_filter(datum_string_t *field_out,
+                          std::string *pattern_out) const final;
+    bool get_contains_filter(Term::TermType *type_out,
+                             datum_string_t *field_out,
+                             datum_t *value_out) const final;
+    bool waits_on_external_calls() const final {
+        return makes_http_requests;
+    }
 
 private:
     template <cluster_version_t> friend class wire_func_serialization_visitor_t;
@@ -126,6 +218,13 @@ private:
     // The body of the function, which gets ->eval(...) called when call(...) is called.
     counted_t<const term_t> body;
 
+    // Set if `body` compares a field of our argument with a constant.  Owned by
+    // `body`.
+    const field_predicate_t *field_predicate;
+
+    // Whether `body` contains `r.http` but no `r.js`.
+    bool makes_http_requests;
+
     DISABLE_COPYING(reql_func_t);
 };
 
@@ -142,6 +241,11 @@ public:
                              const std::vector<datum_t> &args,
                              eval_flags_t eval_flags) const;
 
+    // Sends all rows to the JavaScript worker in a single message.
+    void call_batch(env_t *env,
+                    const std::vector<datum_t> &rows,
+                    std::vector<datum_t> *results_out) const final;
+
     optional<size_t> arity() const;
 
     deterministic_t is_deterministic() const;
@@ -1,12 +1,14 @@
 // Copyright 2010-2016 RethinkDB, all rights reserved.
 #include "rdb_protocol/geo/indexing.hpp"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
 #include "btree/keys.hpp"
 #include "btree/leaf_node.hpp"
 #include "concurrency/interruptor.hpp"
+#include "config/args.hpp"
 #include "concurrency/signal.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/geo/exceptions.hpp"
@@ -32,19 +34,18 @@ using geo::S2Region;
 using geo::S2RegionCoverer;
 using ql::datum_t;
 
-// TODO (daniel): Consider making this configurable through an opt-arg
-//   (...at index creation?)
-extern const int GEO_INDEX_GOAL_GRID_CELLS = 8;
-
 class compute_covering_t : public s2_geo_visitor_t<scoped_ptr_t<std::vector<S2CellId> > > {
 public:
-    explicit compute_covering_t(int goal_cells) {
+    compute_covering_t(int goal_cells, int min_level, int max_level)
+        : max_level_(max_level) {
         coverer_.set_max_cells(goal_cells);
+        coverer_.set_min_level(min_level);
+        coverer_.set_max_level(max_level);
     }
 
     scoped_ptr_t<std::vector<S2CellId> > on_point(const S2Point &point) {
         scoped_ptr_t<std::vector<S2CellId> > result(new std::vector<S2CellId>());
-        result->push_back(S2CellId::FromPoint(point));
+        result->push_back(S2CellId::FromPoint(point).parent(max_level_));
         return result;
     }
     scoped_ptr_t<std::vector<S2CellId> > on_line(const S2Polyline &line) {
@@ -65,6 +66,7 @@ public:
 
 private:
     S2RegionCoverer coverer_;
+    int max_level_;
 };
 
 /* The interior covering is a set of grid cells that are guaranteed to be fully
@@ -259,9 +261,10 @@ std::pair<S2CellId, bool> order_btree_key_relative_to_s2cellid_keys(
 }
 
 std::vector<std::string> compute_index_grid_keys(
-        const ql::datum_t &key, int goal_cells) {
+        const ql::datum_t &key, int goal_cells, int min_level, int max_level) {
     // Compute a cover of grid cells
-    std::vector<S2CellId> covering = compute_cell_covering(key, goal_cells);
+    std::vector<S2CellId> covering =
+        compute_cell_covering(key, goal_cells, min_level, max_level);
 
     // Generate keys
     std::vector<std::string> result;
@@ -276,6 +279,11 @@ std::vector<std::string> compute_index_grid_keys(
 // Helper for `compute_cell_covering` and `compute_interior_cell_covering`
 std::vector<S2CellId> compute_cell_covering(
         const ql::datum_t &key, int goal_cells) {
+    return compute_cell_covering(key, goal_cells, 0, S2CellId::kMaxLevel);
+}
+
+std::vector<S2CellId> compute_cell_covering(
+        const ql::datum_t &key, int goal_cells, int min_level, int max_level) {
     rassert(key.has());
     if (!key.is_ptype(ql::pseudo::geometry_string)) {
         throw geo_exception_t(
@@ -285,8 +293,13 @@ std::vector<S2CellId> compute_cell_covering(
         throw geo_exception_t("goal_cells must be positive (and should be >= 4).");
     }
 
+    if (min_level < 0 || min_level > max_level || max_level > S2CellId::kMaxLevel) {
+        throw geo_exception_t("The cell levels must satisfy "
+                              "0 <= min_level <= max_level <= 30.");
+    }
+
     // Compute a covering of grid cells
-    compute_covering_t coverer(goal_cells);
+    compute_covering_t coverer(goal_cells, min_level, max_level);
     scoped_ptr_t<std::vector<S2CellId> > covering = visit_geojson(&coverer, key);
     return *covering;
 }
@@ -304,6 +317,24 @@ std::vector<S2CellId> compute_interior_cell_covering(
     return *covering;
 }
 
+geo_covering_cache_t::geo_covering_cache_t() : cache(GEO_COVERING_CACHE_SIZE) { }
+
+geo_query_covering_t geo_covering_cache_t::get(
+        const datum_t &query_geometry, int goal_cells) {
+    assert_thread();
+    std::pair<datum_t, int> key(query_geometry, goal_cells);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    geo_query_covering_t covering;
+    covering.cells = compute_cell_covering(query_geometry, goal_cells);
+    covering.interior_cells =
+        compute_interior_cell_covering(query_geometry, covering.cells);
+    cache[std::move(key)] = covering;
+    return covering;
+}
+
 geo_index_traversal_helper_t::geo_index_traversal_helper_t(
         ql::skey_version_t skey_version, const signal_t *interruptor)
     : is_initialized_(false), skey_version_(skey_version), interruptor_(interruptor) { }
@@ -312,12 +343,32 @@ void geo_index_traversal_helper_t::init_query(
         const std::vector<geo::S2CellId> &query_cell_covering,
         const std::vector<geo::S2CellId> &query_interior_cell_covering) {
     guarantee(!is_initialized_);
-    rassert(query_cells_.empty());
-    query_cells_ = query_cell_covering;
-    query_interior_cells_ = query_interior_cell_covering;
+    rassert(query_ranges_.empty());
+    query_ranges_ = to_merged_ranges(query_cell_covering);
+    query_interior_ranges_ = to_merged_ranges(query_interior_cell_covering);
     is_initialized_ = true;
 }
 
+std::vector<geo_index_traversal_helper_t::cell_range_t>
+geo_index_traversal_helper_t::to_merged_ranges(const std::vector<S2CellId> &cells) {
+    std::vector<cell_range_t> ranges;
+    ranges.reserve(cells.size());
+    for (const auto &cell : cells) {
+        ranges.push_back(std::make_pair(cell.range_min(), cell.range_max()));
+    }
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<cell_range_t> merged;
+    for (const auto &range : ranges) {
+        // Leaf cells are adjacent if there is no leaf cell between them.
+        if (!merged.empty() && range.first <= merged.back().second.next()) {
+            merged.back().second = std::max(merged.back().second, range.second);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+
 continue_bool_t
 geo_index_traversal_helper_t::handle_pair(
     scoped_key_value_t &&keyvalue,
@@ -330,9 +381,9 @@ geo_index_traversal_helper_t::handle_pair(
     }
 
     const S2CellId key_cell = btree_key_to_s2cellid(keyvalue.key());
-    if (any_cell_intersects(query_cells_, key_cell.range_min(), key_cell.range_max())) {
+    if (any_range_intersects(query_ranges_, key_cell.range_min(), key_cell.range_max())) {
         bool definitely_intersects_if_point =
-            any_cell_contains(query_interior_cells_, key_cell);
+            any_range_contains(query_interior_ranges_, key_cell);
         return on_candidate(std::move(keyvalue), waiter, definitely_intersects_if_point);
     } else {
         return continue_bool_t::CONTINUE;
@@ -386,36 +437,32 @@ bool geo_index_traversal_helper_t::any_query_cell_intersects(
     S2CellId range_min = left_cell.parent(common_level).range_min();
     S2CellId range_max = right_cell.parent(common_level).range_max();
 
-    return any_cell_intersects(query_cells_, range_min, range_max);
+    return any_range_intersects(query_ranges_, range_min, range_max);
 }
 
-bool geo_index_traversal_helper_t::any_cell_intersects(
-        const std::vector<S2CellId> &cells,
+bool geo_index_traversal_helper_t::any_range_intersects(
+        const std::vector<cell_range_t> &ranges,
         const S2CellId left_min, const S2CellId right_max) {
-    // Check if any of the cells intersects with the given range
-    for (const auto &cell : cells) {
-        if (cell_intersects_with_range(cell, left_min, right_max)) {
-            return true;
-        }
-    }
-    return false;
+    // The ranges are sorted and disjoint, so only the first range that doesn't end
+    // before `left_min` can intersect with [left_min, right_max].
+    auto it = std::lower_bound(
+        ranges.begin(), ranges.end(), left_min,
+        [](const cell_range_t &range, const S2CellId &cell) {
+            return range.second < cell;
+        });
+    return it != ranges.end() && it->first <= right_max;
 }
 
-bool geo_index_traversal_helper_t::cell_intersects_with_range(
-        const S2CellId c,
-        const S2CellId left_min, const S2CellId right_max) {
-    return left_min <= c.range_max() && right_max >= c.range_min();
-}
-
-bool geo_index_traversal_helper_t::any_cell_contains(
-        const std::vector<S2CellId> &cells,
+bool geo_index_traversal_helper_t::any_range_contains(
+        const std::vector<cell_range_t> &ranges,
         const S2CellId key) {
-    // Check if any of the cells contains `key`
-    for (const auto &cell : cells) {
-        if (cell.contains(key)) {
-            return true;
-        }
-    }
-    return false;
+    const S2CellId key_min = key.range_min();
+    const S2CellId key_max = key.range_max();
+    auto it = std::lower_bound(
+        ranges.begin(), ranges.end(), key_min,
+        [](const cell_range_t &range, const S2CellId &cell) {
+            return range.second < cell;
+        });
+    return it != ranges.end() && it->first <= key_min && key_max <= it->second;
 }
 
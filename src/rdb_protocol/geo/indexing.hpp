@@ -3,14 +3,16 @@
 #define RDB_PROTOCOL_GEO_INDEXING_HPP_
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "btree/concurrent_traversal.hpp"
 #include "containers/counted.hpp"
+#include "containers/lru_cache.hpp"
+#include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/geo/s2/s2cellid.h"
 
 namespace ql {
-class datum_t;
 enum class skey_version_t;
 }
 class signal_t;
@@ -18,24 +20,53 @@ class signal_t;
 
 /* Polygons and lines are inserted into an index by computing a coverage of them
 consisting of cells on a pre-defined multi-level grid.
-This constant determines how many grid cells should be used to cover the polygon/line.
+`goal_cells` determines how many grid cells should be used to cover the polygon/line,
+and `min_level` and `max_level` how large and how small they can be. Each geo index
+has its own values (see `geo_covering_t`).
 If the number is small, index insertion becomes more efficient, but querying the
 index becomes less efficient. High values make geo indexes larger and inserting
 into them slower, while usually improving query efficiency.
 See the comments in s2regioncoverer.h for further explanation and for statistics
 on the effects of different choices of this parameter.*/
-extern const int GEO_INDEX_GOAL_GRID_CELLS;
-
 std::vector<std::string> compute_index_grid_keys(
         const ql::datum_t &key,
-        int goal_cells);
+        int goal_cells,
+        int min_level,
+        int max_level);
 std::vector<geo::S2CellId> compute_cell_covering(
         const ql::datum_t &key,
         int goal_cells);
+std::vector<geo::S2CellId> compute_cell_covering(
+        const ql::datum_t &key,
+        int goal_cells,
+        int min_level,
+        int max_level);
 std::vector<geo::S2CellId> compute_interior_cell_covering(
         const ql::datum_t &key,
         const std::vector<geo::S2CellId> &exterior_covering);
 
+/* The exterior and interior cell coverings of a query geometry. */
+struct geo_query_covering_t {
+    std::vector<geo::S2CellId> cells;
+    std::vector<geo::S2CellId> interior_cells;
+};
+
+/* Remembers the coverings of recently queried geometries, so that a geometry that gets
+queried over and over (a geofence, for example) is only covered once. Each store has
+one, and it's only used on the store's home thread. */
+class geo_covering_cache_t : public home_thread_mixin_debug_only_t {
+public:
+    geo_covering_cache_t();
+
+    // Throws `geo_exception_t` like `compute_cell_covering()`.
+    geo_query_covering_t get(const ql::datum_t &query_geometry, int goal_cells);
+
+private:
+    lru_cache_t<std::pair<ql::datum_t, int>, geo_query_covering_t> cache;
+
+    DISABLE_COPYING(geo_covering_cache_t);
+};
+
 // TODO (daniel): Support compound indexes somehow.
 class geo_index_traversal_helper_t : public concurrent_traversal_callback_t {
 public:
@@ -76,19 +107,24 @@ public:
             bool *skip_out);
 
 private:
-    static bool cell_intersects_with_range(const geo::S2CellId c,
-                                           const geo::S2CellId left_min,
-                                           const geo::S2CellId right_max);
+    // An inclusive range of leaf cell ids.
+    typedef std::pair<geo::S2CellId, geo::S2CellId> cell_range_t;
+
+    // Turns `cells` into a sorted list of ranges, merging the ranges of cells that are
+    // adjacent or nested into one.
+    static std::vector<cell_range_t> to_merged_ranges(
+            const std::vector<geo::S2CellId> &cells);
+
     bool any_query_cell_intersects(const btree_key_t *left_excl_or_null,
                                    const btree_key_t *right_incl) const;
-    static bool any_cell_intersects(const std::vector<geo::S2CellId> &cells,
-                                    const geo::S2CellId left_min,
-                                    const geo::S2CellId right_max);
-    static bool any_cell_contains(const std::vector<geo::S2CellId> &cells,
-                                  const geo::S2CellId key);
-
-    std::vector<geo::S2CellId> query_cells_;
-    std::vector<geo::S2CellId> query_interior_cells_;
+    static bool any_range_intersects(const std::vector<cell_range_t> &ranges,
+                                     const geo::S2CellId left_min,
+                                     const geo::S2CellId right_max);
+    static bool any_range_contains(const std::vector<cell_range_t> &ranges,
+                                   const geo::S2CellId key);
+
+    std::vector<cell_range_t> query_ranges_;
+    std::vector<cell_range_t> query_interior_ranges_;
     bool is_initialized_;
     const ql::skey_version_t skey_version_;
     const signal_t *interruptor_;
@@ -1,6 +1,7 @@
 // Copyright 2010-2016 RethinkDB, all rights reserved.
 #include "rdb_protocol/geo_traversal.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 #include "rdb_protocol/batching.hpp"
@@ -98,12 +99,20 @@ geo_intersecting_cb_t::geo_intersecting_cb_t(
                                         env->trace));
 }
 
-void geo_intersecting_cb_t::init_query(const ql::datum_t &_query_geometry) {
+void geo_intersecting_cb_t::init_query(const ql::datum_t &_query_geometry,
+                                       geo_covering_cache_t *covering_cache) {
     query_geometry = _query_geometry;
-    std::vector<geo::S2CellId> covering(
-        compute_cell_covering(query_geometry, QUERYING_GOAL_GRID_CELLS));
-    geo_index_traversal_helper_t::init_query(
-        covering, compute_interior_cell_covering(query_geometry, covering));
+    if (covering_cache != nullptr) {
+        geo_query_covering_t covering =
+            covering_cache->get(query_geometry, QUERYING_GOAL_GRID_CELLS);
+        geo_index_traversal_helper_t::init_query(
+            covering.cells, covering.interior_cells);
+    } else {
+        std::vector<geo::S2CellId> covering(
+            compute_cell_covering(query_geometry, QUERYING_GOAL_GRID_CELLS));
+        geo_index_traversal_helper_t::init_query(
+            covering, compute_interior_cell_covering(query_geometry, covering));
+    }
 }
 
 continue_bool_t geo_intersecting_cb_t::on_candidate(
@@ -218,11 +227,12 @@ collect_all_geo_intersecting_cb_t::collect_all_geo_intersecting_cb_t(
         geo_job_data_t &&_job,
         geo_sindex_data_t &&_sindex,
         const ql::datum_t &_query_geometry,
+        geo_covering_cache_t *_covering_cache,
         rget_read_response_t *_resp_out)
     : geo_intersecting_cb_t(_slice, std::move(_sindex), _job.env, &distinct_emitted),
       job(std::move(_job)), response(_resp_out) {
     guarantee(response != NULL);
-    init_query(_query_geometry);
+    init_query(_query_geometry, _covering_cache);
 }
 
 void collect_all_geo_intersecting_cb_t::finish(
@@ -262,6 +272,13 @@ void collect_all_geo_intersecting_cb_t::emit_error(
 
 
 /* ----------- nearest traversal -----------*/
+bool nearest_pairs_less(
+        const std::pair<double, ql::datum_t> &p1,
+        const std::pair<double, ql::datum_t> &p2) {
+    // We only care about the distance, don't compare the actual data.
+    return p1.first < p2.first;
+}
+
 nearest_traversal_state_t::nearest_traversal_state_t(
         const lon_lat_point_t &_center,
         uint64_t _max_results,
@@ -319,7 +336,11 @@ nearest_traversal_cb_t::nearest_traversal_cb_t(
         ql::env_t *_env,
         nearest_traversal_state_t *_state) :
     geo_intersecting_cb_t(_slice, std::move(_sindex), _env, &_state->distinct_emitted),
+    results_needed(_state->max_results - _state->previous_size),
+    post_filter_dist(0.0),
     state(_state) {
+    // `proceed_to_next_batch()` stops once we have found enough results.
+    guarantee(_state->previous_size < _state->max_results);
     init_query_geometry();
 }
 
@@ -383,20 +404,31 @@ bool nearest_traversal_cb_t::post_filter(
     const S2Point s2center =
         S2LatLng::FromDegrees(state->center.latitude, state->center.longitude).ToPoint();
     const double dist = geodesic_distance(s2center, sindex_val, state->reference_ellipsoid);
-    return dist <= state->current_inradius;
+    if (dist > state->current_inradius) {
+        return false;
+    }
+    // Once this batch has all the results it needs, only results that are closer than
+    // the farthest of them can still make it into the final result.
+    if (result_acc.size() >= results_needed && dist >= result_acc.front().first) {
+        return false;
+    }
+    post_filter_dist = dist;
+    return true;
 }
 
 continue_bool_t nearest_traversal_cb_t::emit_result(
-        ql::datum_t &&sindex_val,
+        UNUSED ql::datum_t &&sindex_val,
         UNUSED store_key_t &&key,
         ql::datum_t &&val)
         THROWS_ONLY(interrupted_exc_t, ql::base_exc_t, geo_exception_t) {
-    // TODO (daniel): Could we avoid re-computing the distance? We have already
-    //   done it in post_filter().
-    const S2Point s2center =
-        S2LatLng::FromDegrees(state->center.latitude, state->center.longitude).ToPoint();
-    const double dist = geodesic_distance(s2center, sindex_val, state->reference_ellipsoid);
-    result_acc.push_back(std::make_pair(dist, std::move(val)));
+    // `on_candidate()` calls this right after `post_filter()` accepted `sindex_val`,
+    // so we can use the distance it computed.
+    result_acc.push_back(std::make_pair(post_filter_dist, std::move(val)));
+    std::push_heap(result_acc.begin(), result_acc.end(), &nearest_pairs_less);
+    if (result_acc.size() > results_needed) {
+        std::pop_heap(result_acc.begin(), result_acc.end(), &nearest_pairs_less);
+        result_acc.pop_back();
+    }
 
     return continue_bool_t::CONTINUE;
 }
@@ -407,13 +439,6 @@ void nearest_traversal_cb_t::emit_error(
     error.set(_error);
 }
 
-bool nearest_pairs_less(
-        const std::pair<double, ql::datum_t> &p1,
-        const std::pair<double, ql::datum_t> &p2) {
-    // We only care about the distance, don't compare the actual data.
-    return p1.first < p2.first;
-}
-
 void nearest_traversal_cb_t::finish(
         nearest_geo_read_response_t *resp_out) {
     guarantee(resp_out != NULL);
@@ -88,7 +88,10 @@ public:
                 *_distinct_emitted_in_out);
     virtual ~geo_intersecting_cb_t() { }
 
-    void init_query(const ql::datum_t &_query_geometry);
+    // If `covering_cache` isn't null, the query geometry's coverings are looked up in
+    // it instead of being computed.
+    void init_query(const ql::datum_t &_query_geometry,
+                    geo_covering_cache_t *covering_cache = nullptr);
 
     continue_bool_t on_candidate(scoped_key_value_t &&keyvalue,
                                  concurrent_traversal_fifo_enforcer_signal_t waiter,
@@ -139,6 +142,7 @@ public:
             geo_job_data_t &&_job,
             geo_sindex_data_t &&_sindex,
             const ql::datum_t &_query_geometry,
+            geo_covering_cache_t *_covering_cache,
             rget_read_response_t *_resp_out);
 
     void finish(continue_bool_t last_cb) THROWS_ONLY(interrupted_exc_t);
@@ -225,10 +229,17 @@ protected:
 private:
     void init_query_geometry();
 
-    // Accumulate results for the current batch until finish() is called
+    // Accumulate results for the current batch until finish() is called. This is a
+    // max-heap by distance that holds no more than `results_needed` results, since the
+    // results that are farther away can't be among the `max_results` nearest ones.
     std::vector<std::pair<double, ql::datum_t> > result_acc;
+    const uint64_t results_needed;
     optional<ql::exc_t> error;
 
+    // The distance that `post_filter()` computed for the result that `emit_result()`
+    // gets called with next.
+    double post_filter_dist;
+
     nearest_traversal_state_t *state;
 };
 
@@ -0,0 +1,145 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/hot_keys.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "btree/keys.hpp"
+#include "config/args.hpp"
+#include "random.hpp"
+#include "rdb_protocol/datum.hpp"
+
+hot_keys_t::hot_keys_t()
+    : sketch(HOT_KEYS_SKETCH_DEPTH * HOT_KEYS_SKETCH_WIDTH, 0), additions(0) { }
+
+void hot_keys_t::add(const std::string &key) {
+    // Spread `std::hash` over all bits like `hyperloglog_t::add` does, and derive the
+    // column of each row from two halves of it.
+    uint64_t hash = std::hash<std::string>()(key);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    const uint64_t h1 = hash & 0xffffffff;
+    const uint64_t h2 = (hash >> 32) | 1;
+
+    uint64_t estimate = UINT64_MAX;
+    for (size_t row = 0; row < HOT_KEYS_SKETCH_DEPTH; ++row) {
+        const size_t column = (h1 + row * h2) % HOT_KEYS_SKETCH_WIDTH;
+        uint32_t *counter = &sketch[row * HOT_KEYS_SKETCH_WIDTH + column];
+        if (*counter < UINT32_MAX) {
+            ++*counter;
+        }
+        estimate = std::min<uint64_t>(estimate, *counter);
+    }
+
+    auto it = tracked.find(key);
+    if (it != tracked.end()) {
+        it->second = estimate;
+    } else if (tracked.size() < HOT_KEYS_TRACKED) {
+        tracked.insert(std::make_pair(key, estimate));
+    } else {
+        // There are only a few tracked keys, so looking for the coldest one is cheap.
+        auto coldest = std::min_element(
+            tracked.begin(), tracked.end(),
+            [](const std::pair<const std::string, uint64_t> &a,
+               const std::pair<const std::string, uint64_t> &b) {
+                return a.second < b.second;
+            });
+        if (coldest->second < estimate) {
+            tracked.erase(coldest);
+            tracked.insert(std::make_pair(key, estimate));
+        }
+    }
+
+    if (++additions % HOT_KEYS_DECAY_SAMPLES == 0) {
+        decay();
+    }
+}
+
+void hot_keys_t::decay() {
+    for (uint32_t &counter : sketch) {
+        counter /= 2;
+    }
+    for (auto it = tracked.begin(); it != tracked.end();) {
+        it->second /= 2;
+        if (it->second == 0) {
+            tracked.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<std::pair<std::string, uint64_t> > hot_keys_t::top() const {
+    std::vector<std::pair<std::string, uint64_t> > res(tracked.begin(), tracked.end());
+    std::sort(res.begin(), res.end(),
+              [](const std::pair<std::string, uint64_t> &a,
+                 const std::pair<std::string, uint64_t> &b) {
+                  return a.second > b.second;
+              });
+    return res;
+}
+
+static bool sample_access() {
+    return randint(HOT_KEYS_SAMPLE_RATE) == 0;
+}
+
+store_hot_keys_t::store_hot_keys_t() { }
+
+void store_hot_keys_t::on_read(const store_key_t &primary_key) {
+    assert_thread();
+    if (sample_access()) {
+        reads.add(key_to_debug_str(primary_key));
+    }
+}
+
+void store_hot_keys_t::on_write(const store_key_t &primary_key) {
+    assert_thread();
+    if (sample_access()) {
+        writes.add(key_to_debug_str(primary_key));
+    }
+}
+
+void store_hot_keys_t::on_sindex_read(const std::string &sindex_name,
+                                      const std::string &value) {
+    assert_thread();
+    if (sample_access()) {
+        sindex_reads.add(sindex_name + ": " + value);
+    }
+}
+
+void *store_hot_keys_t::begin_stats() {
+    return new ql::datum_t();
+}
+
+static ql::datum_t hot_keys_to_datum(const hot_keys_t &hot_keys) {
+    ql::datum_array_builder_t builder(ql::configured_limits_t::unlimited);
+    for (const auto &pair : hot_keys.top()) {
+        ql::datum_object_builder_t key;
+        key.overwrite("key", ql::datum_t(datum_string_t(pair.first)));
+        key.overwrite("count",
+            ql::datum_t(static_cast<double>(pair.second * HOT_KEYS_SAMPLE_RATE)));
+        builder.add(std::move(key).to_datum());
+    }
+    return std::move(builder).to_datum();
+}
+
+void store_hot_keys_t::visit_stats(void *data) {
+    if (get_thread_id() != home_thread()) {
+        return;
+    }
+    ql::datum_object_builder_t builder;
+    builder.overwrite("reads", hot_keys_to_datum(reads));
+    builder.overwrite("writes", hot_keys_to_datum(writes));
+    builder.overwrite("sindex_reads", hot_keys_to_datum(sindex_reads));
+    *static_cast<ql::datum_t *>(data) = std::move(builder).to_datum();
+}
+
+ql::datum_t store_hot_keys_t::end_stats(void *data) {
+    ql::datum_t *result = static_cast<ql::datum_t *>(data);
+    ql::datum_t res = result->has() ? *result : ql::datum_t::empty_object();
+    delete result;
+    return res;
+}
@@ -0,0 +1,62 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_HOT_KEYS_HPP_
+#define RDB_PROTOCOL_HOT_KEYS_HPP_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfmon/perfmon.hpp"
+#include "threading.hpp"
+
+struct store_key_t;
+
+/* Finds the keys that were added most often.  A count-min sketch (Cormode and
+Muthukrishnan, 2005) of `HOT_KEYS_SKETCH_DEPTH` rows of `HOT_KEYS_SKETCH_WIDTH` counters
+estimates how often each key was added, and the `HOT_KEYS_TRACKED` keys with the highest
+estimates are kept by name.  Every `HOT_KEYS_DECAY_SAMPLES` additions all the counts get
+halved, so that keys that stopped being hot drop out again. */
+class hot_keys_t {
+public:
+    hot_keys_t();
+
+    void add(const std::string &key);
+
+    // The tracked keys and their estimated counts, highest first.
+    std::vector<std::pair<std::string, uint64_t> > top() const;
+
+private:
+    void decay();
+
+    std::vector<uint32_t> sketch;
+    std::map<std::string, uint64_t> tracked;
+    uint64_t additions;
+};
+
+/* Samples the keys that a `store_t` reads and writes, to find the hot ones.  Only one
+in `HOT_KEYS_SAMPLE_RATE` accesses are looked at, and the reported counts are scaled
+back up.  Like `store_sindex_stats_t`, this isn't stored anywhere; it shows up under
+the store's perfmon collection in `rethinkdb._debug_stats`. */
+class store_hot_keys_t : public perfmon_t, public home_thread_mixin_t {
+public:
+    store_hot_keys_t();
+
+    void on_read(const store_key_t &primary_key);
+    void on_write(const store_key_t &primary_key);
+    // `value` is the printed secondary index value that a `get_all` looked up.
+    void on_sindex_read(const std::string &sindex_name, const std::string &value);
+
+    void *begin_stats();
+    void visit_stats(void *data);
+    ql::datum_t end_stats(void *data);
+
+private:
+    hot_keys_t reads, writes, sindex_reads;
+
+    DISABLE_COPYING(store_hot_keys_t);
+};
+
+#endif  // RDB_PROTOCOL_HOT_KEYS_HPP_
@@ -4,6 +4,7 @@
 #include "containers/archive/buffer_group_stream.hpp"
 #include "containers/archive/versioned.hpp"
 #include "rdb_protocol/blob_wrapper.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 
 ql::datum_t get_data(const rdb_value_t *value, buf_parent_t parent) {
     // TODO: Just use deserialize_from_blob?
@@ -24,6 +25,31 @@ ql::datum_t get_data(const rdb_value_t *value, buf_parent_t parent) {
     return data;
 }
 
+// Returns false if the value isn't worth or able to be read a region at a time.
+bool get_data_field(const rdb_value_t *value, buf_parent_t parent,
+                    const datum_string_t &key, ql::datum_t *field_out) {
+    const max_block_size_t block_size = parent.cache()->max_block_size();
+    rdb_blob_wrapper_t blob(block_size,
+                            const_cast<rdb_value_t *>(value)->value_ref(),
+                            blob::btree_maxreflen);
+    // Values that fit into a single block cost the same to read in full.
+    if (blob.valuesize() <= static_cast<int64_t>(block_size.value())) {
+        return false;
+    }
+
+    auto read_region = [&](int64_t offset, int64_t size, char *out) {
+        blob_acq_t acq_group;
+        buffer_group_t buffer_group;
+        blob.expose_region(parent, access_t::read, offset, size,
+                           &buffer_group, &acq_group);
+        buffer_group_read_stream_t read_stream(const_view(&buffer_group));
+        int64_t num_read = force_read(&read_stream, out, size);
+        guarantee(num_read == size);
+    };
+    return ql::datum_get_field_from_serialized(blob.valuesize(), read_region, key,
+                                               field_out);
+}
+
 const ql::datum_t &lazy_btree_val_t::get() const {
     guarantee(pointee.has());
     if (!pointee->ptr.has()) {
@@ -38,6 +64,40 @@ bool lazy_btree_val_t::references_parent() const {
     return pointee.has() && !pointee->parent.empty();
 }
 
+ql::datum_t lazy_btree_val_t::get_field(const datum_string_t &key) const {
+    guarantee(pointee.has());
+    if (!pointee->ptr.has()) {
+        ql::datum_t field;
+        if (get_data_field(pointee->rdb_value, pointee->parent, key, &field)) {
+            return field;
+        }
+    }
+    return get().get_field(key, ql::NOTHROW);
+}
+
+ql::datum_t lazy_btree_val_t::get_projection(
+        const std::vector<datum_string_t> &fields) const {
+    guarantee(pointee.has());
+    if (!pointee->ptr.has()) {
+        ql::datum_object_builder_t builder;
+        bool read_fields = true;
+        for (const auto &key : fields) {
+            ql::datum_t field;
+            if (!get_data_field(pointee->rdb_value, pointee->parent, key, &field)) {
+                read_fields = false;
+                break;
+            }
+            if (field.has()) {
+                builder.overwrite(key, std::move(field));
+            }
+        }
+        if (read_fields) {
+            return std::move(builder).to_datum();
+        }
+    }
+    return get();
+}
+
 void lazy_btree_val_t::reset() {
     pointee.reset();
 }
@@ -2,6 +2,8 @@
 #ifndef RDB_PROTOCOL_LAZY_BTREE_VAL_HPP_
 #define RDB_PROTOCOL_LAZY_BTREE_VAL_HPP_
 
+#include <vector>
+
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/blob.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -64,6 +66,15 @@ public:
         : pointee(new lazy_btree_val_pointee_t(rdb_value, parent)) { }
 
     const ql::datum_t &get() const;
+    // Returns the top-level field `key` of the value, or an empty datum if the value
+    // doesn't have it.  Unless the value has been loaded already, a large object only
+    // has the blob blocks read that cover its header, offset table, the keys visited
+    // by the lookup and the field itself.
+    ql::datum_t get_field(const datum_string_t &key) const;
+    // Returns an object with only the top-level `fields` of the value, reading them
+    // as `get_field` does.  Returns the whole value instead if it has been loaded
+    // already or if reading it in full is just as cheap.
+    ql::datum_t get_projection(const std::vector<datum_string_t> &fields) const;
     bool references_parent() const;
     void reset();
 
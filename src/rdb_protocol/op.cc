@@ -283,6 +283,15 @@ const std::vector<counted_t<const term_t> > &op_term_t::get_original_args() cons
     return arg_terms->get_original_args();
 }
 
+void op_term_t::each_subterm(const std::function<void(const term_t *)> &f) const {
+    for (const auto &arg : arg_terms->get_original_args()) {
+        f(arg.get());
+    }
+    for (const auto &optarg_pair : optargs) {
+        f(optarg_pair.second.get());
+    }
+}
+
 deterministic_t worst_determinism(const deterministic_t a, const deterministic_t b) {
     return a < b ? a : b;
 }
@@ -142,6 +142,8 @@ protected:
 
     virtual deterministic_t is_deterministic() const;
 
+    void each_subterm(const std::function<void(const term_t *)> &f) const;
+
     bool recursive_is_simple_selector() const {
         for (const auto &term : get_original_args()) {
             if (!term->is_simple_selector()) {
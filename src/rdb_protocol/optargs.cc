@@ -43,6 +43,7 @@ static const std::set<std::string> acceptable_optargs({
     "array_limit",
     "attempts",
     "auth",
+    "auto_index",
     "base",
     "binary_format",
     "changefeed_queue_size",
@@ -71,7 +72,9 @@ static const std::set<std::string> acceptable_optargs({
     "include_types",
     "index",
     "interleave",
+    "io_priority",
     "ordered",
+    "key_generation",
     "left_bound",
     "max_batch_bytes",
     "max_batch_rows",
@@ -80,6 +83,7 @@ static const std::set<std::string> acceptable_optargs({
     "max_results",
     "method",
     "min_batch_rows",
+    "minimal_movement",
     "multi",
     "non_atomic",
     "nonvoting_replica_tags",
@@ -89,8 +93,10 @@ static const std::set<std::string> acceptable_optargs({
     "page",
     "page_limit",
     "params",
+    "prefetch",
     "primary_key",
     "primary_replica_tag",
+    "priority",
     "profile",
     "read_mode",
     "redirects",
@@ -1,8 +1,10 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/order_util.hpp"
 
+#include <algorithm>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/error.hpp"
@@ -140,4 +142,74 @@ bool lt_cmp_t::operator()(env_t *env,
     return false;
 }
 
+void lt_cmp_t::sort(env_t *env,
+                    profile::sampler_t *sampler,
+                    std::vector<datum_t> *rows) const {
+    const size_t num_rows = rows->size();
+    const size_t num_comparisons = comparisons.size();
+
+    // The value of comparison `j` for row `i` is at `i * num_comparisons + j`.  Values
+    // are left empty for rows that don't have them.
+    std::vector<datum_t> values(num_rows * num_comparisons);
+    std::vector<std::string> keys(num_rows * num_comparisons);
+    std::vector<bool> has_key(num_rows * num_comparisons, false);
+    for (size_t i = 0; i < num_rows; ++i) {
+        for (size_t j = 0; j < num_comparisons; ++j) {
+            if (sampler != nullptr) {
+                sampler->new_sample();
+            }
+            const size_t ix = i * num_comparisons + j;
+            try {
+                values[ix] = comparisons[j].second->call(env, (*rows)[i])->as_datum();
+            } catch (const base_exc_t &e) {
+                if (e.get_type() != base_exc_t::NON_EXISTENCE) {
+                    throw;
+                }
+            }
+            if (values[ix].has()) {
+                has_key[ix] = values[ix].append_sort_key(&keys[ix]);
+                if (!has_key[ix]) {
+                    keys[ix].clear();
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> order(num_rows);
+    for (size_t i = 0; i < num_rows; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+        for (size_t j = 0; j < num_comparisons; ++j) {
+            const size_t lix = l * num_comparisons + j;
+            const size_t rix = r * num_comparisons + j;
+            const bool desc = comparisons[j].first == DESC;
+            if (!values[lix].has() && !values[rix].has()) {
+                continue;
+            }
+            if (!values[lix].has()) {
+                return true != desc;
+            }
+            if (!values[rix].has()) {
+                return false != desc;
+            }
+            const int cmp_res = has_key[lix] && has_key[rix]
+                ? keys[lix].compare(keys[rix])
+                : values[lix].cmp(values[rix]);
+            if (cmp_res == 0) {
+                continue;
+            }
+            return (cmp_res < 0) != desc;
+        }
+        return false;
+    });
+
+    std::vector<datum_t> sorted;
+    sorted.reserve(num_rows);
+    for (size_t i : order) {
+        sorted.push_back(std::move((*rows)[i]));
+    }
+    rows->swap(sorted);
+}
+
 } // namespace ql
@@ -5,9 +5,11 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "errors.hpp"
 
+#include "containers/archive/archive.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/profile.hpp"
 #include "containers/counted.hpp"
@@ -15,6 +17,7 @@
 namespace ql {
 
 enum order_direction_t { ASC, DESC };
+ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(order_direction_t, int8_t, ASC, DESC);
 
 class scope_env_t;
 class env_t;
@@ -54,6 +57,13 @@ public:
                     datum_t l,
                     datum_t r) const;
 
+    // Does the same as `std::stable_sort` with this comparator, but evaluates the
+    // comparison functions only once per row, and compares their results by their
+    // sort keys (see `datum_t::append_sort_key`) where they have them.
+    void sort(env_t *env,
+              profile::sampler_t *sampler,
+              std::vector<datum_t> *rows) const;
+
 private:
     const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
         comparisons;
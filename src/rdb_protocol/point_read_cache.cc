@@ -0,0 +1,122 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/point_read_cache.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+
+#include "concurrency/pmap.hpp"
+#include "config/args.hpp"
+
+namespace ql {
+
+point_read_cache_t::thread_cache_t::thread_cache_t()
+    : epochs(POINT_READ_CACHE_EPOCH_SLOTS, 0), table_clears(0) { }
+
+point_read_cache_t::point_read_cache_t(uint64_t max_entries)
+    : max_entries_per_thread(
+          max_entries == 0
+              ? 0
+              : std::max<uint64_t>(1, max_entries / get_num_threads())) { }
+
+size_t point_read_cache_t::epoch_slot(const store_key_t &key) {
+    const std::string str(reinterpret_cast<const char *>(key.contents()), key.size());
+    return std::hash<std::string>()(str) % POINT_READ_CACHE_EPOCH_SLOTS;
+}
+
+bool point_read_cache_t::get(
+        const namespace_id_t &table, const store_key_t &key, datum_t *out) {
+    thread_cache_t *cache = caches.get();
+    auto it = cache->entries.find(std::make_pair(table, key));
+    if (it == cache->entries.end()) {
+        return false;
+    }
+    cache->lru.splice(cache->lru.begin(), cache->lru, it->second);
+    *out = it->second->value;
+    return true;
+}
+
+point_read_cache_t::ticket_t point_read_cache_t::start_fill(const store_key_t &key) {
+    thread_cache_t *cache = caches.get();
+    ticket_t ticket;
+    ticket.epoch = cache->epochs[epoch_slot(key)];
+    ticket.table_clears = cache->table_clears;
+    return ticket;
+}
+
+void point_read_cache_t::put(const namespace_id_t &table,
+                             const store_key_t &key,
+                             const ticket_t &ticket,
+                             const datum_t &value) {
+    thread_cache_t *cache = caches.get();
+    if (ticket.epoch != cache->epochs[epoch_slot(key)]
+        || ticket.table_clears != cache->table_clears
+        || cache->watched.count(table) == 0) {
+        // The value might be older than a change we've already dropped it for.
+        return;
+    }
+    erase(cache, table, key);
+    entry_t entry;
+    entry.table = table;
+    entry.key = key;
+    entry.value = value;
+    cache->lru.push_front(std::move(entry));
+    cache->entries[std::make_pair(table, key)] = cache->lru.begin();
+    while (cache->lru.size() > max_entries_per_thread) {
+        const entry_t &last = cache->lru.back();
+        cache->entries.erase(std::make_pair(last.table, last.key));
+        cache->lru.pop_back();
+    }
+}
+
+bool point_read_cache_t::is_watched(const namespace_id_t &table) {
+    return caches.get()->watched.count(table) == 1;
+}
+
+void point_read_cache_t::set_watched(
+        const namespace_id_t &table, const ticket_t &ticket) {
+    thread_cache_t *cache = caches.get();
+    if (ticket.table_clears == cache->table_clears) {
+        cache->watched.insert(table);
+    }
+}
+
+void point_read_cache_t::invalidate(
+        const namespace_id_t &table, const store_key_t &key) {
+    const size_t slot = epoch_slot(key);
+    pmap(get_num_threads(), [&](int thread) {
+        on_thread_t th((threadnum_t(thread)));
+        thread_cache_t *cache = caches.get();
+        ++cache->epochs[slot];
+        erase(cache, table, key);
+    });
+}
+
+void point_read_cache_t::invalidate_table(const namespace_id_t &table) {
+    pmap(get_num_threads(), [&](int thread) {
+        on_thread_t th((threadnum_t(thread)));
+        thread_cache_t *cache = caches.get();
+        ++cache->table_clears;
+        cache->watched.erase(table);
+        for (auto it = cache->lru.begin(); it != cache->lru.end();) {
+            if (it->table == table) {
+                cache->entries.erase(std::make_pair(it->table, it->key));
+                it = cache->lru.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    });
+}
+
+void point_read_cache_t::erase(thread_cache_t *cache,
+                               const namespace_id_t &table,
+                               const store_key_t &key) {
+    auto it = cache->entries.find(std::make_pair(table, key));
+    if (it != cache->entries.end()) {
+        cache->lru.erase(it->second);
+        cache->entries.erase(it);
+    }
+}
+
+}  // namespace ql
@@ -0,0 +1,96 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_POINT_READ_CACHE_HPP_
+#define RDB_PROTOCOL_POINT_READ_CACHE_HPP_
+
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "concurrency/one_per_thread.hpp"
+#include "containers/uuid.hpp"
+#include "rdb_protocol/datum.hpp"
+
+namespace ql {
+
+/* Caches the results of point reads with `read_mode: "outdated"` on the server that
+runs the query, which is most useful on proxies.  It's owned by the
+`changefeed::client_t`, which subscribes to the changefeeds of every table that has
+something in the cache and drops the keys that changed.  When a table's feed goes away,
+all of its keys are dropped.
+
+Like outdated reads, a hit may be slightly behind the primary replica: a write that
+was acknowledged to its client has its change in flight to us for a moment.  Unlike
+outdated reads, the lag is only that of the change message, because the reads that
+fill the cache go to the primary replicas.
+
+Every thread has its own least recently used list of at most `max_entries` divided by
+the number of threads keys, because the `datum_t`s can't be shared between threads.
+The methods apply to the current thread's cache, except for `invalidate()` and
+`invalidate_table()`, which block until they've reached every thread. */
+class point_read_cache_t {
+public:
+    // What the cache looked like before a read, to check that no change to the key
+    // arrived while the read was running.
+    struct ticket_t {
+        uint64_t epoch;
+        uint64_t table_clears;
+    };
+
+    // A `max_entries` of 0 disables the cache.
+    explicit point_read_cache_t(uint64_t max_entries);
+
+    bool is_enabled() const { return max_entries_per_thread > 0; }
+
+    bool get(const namespace_id_t &table, const store_key_t &key, datum_t *out);
+
+    // Call this before the read whose result goes to `put()`.
+    ticket_t start_fill(const store_key_t &key);
+    void put(const namespace_id_t &table,
+             const store_key_t &key,
+             const ticket_t &ticket,
+             const datum_t &value);
+
+    // Whether the changes to `table` invalidate our keys yet.  `set_watched()` does
+    // nothing if the table's feed went away since `ticket` was made.
+    bool is_watched(const namespace_id_t &table);
+    void set_watched(const namespace_id_t &table, const ticket_t &ticket);
+
+    void invalidate(const namespace_id_t &table, const store_key_t &key);
+    void invalidate_table(const namespace_id_t &table);
+
+private:
+    struct entry_t {
+        namespace_id_t table;
+        store_key_t key;
+        datum_t value;
+    };
+    struct thread_cache_t {
+        thread_cache_t();
+        // Most recently used first
+        std::list<entry_t> lru;
+        std::map<std::pair<namespace_id_t, store_key_t>,
+                 std::list<entry_t>::iterator> entries;
+        std::set<namespace_id_t> watched;
+        // Bumped by the changes to the keys that hash to each slot
+        std::vector<uint64_t> epochs;
+        uint64_t table_clears;
+    };
+    static size_t epoch_slot(const store_key_t &key);
+
+    void erase(thread_cache_t *cache, const namespace_id_t &table,
+               const store_key_t &key);
+
+    const uint64_t max_entries_per_thread;
+    one_per_thread_t<thread_cache_t> caches;
+
+    DISABLE_COPYING(point_read_cache_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_POINT_READ_CACHE_HPP_
@@ -6,10 +6,13 @@
 
 #include "stl_utils.hpp"
 
+#include "arch/io/disk.hpp"
+#include "arch/timing.hpp"
 #include "btree/operations.hpp"
 #include "btree/reql_specific.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/cross_thread_watchable.hpp"
+#include "config/args.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/optional.hpp"
 #include "containers/disk_backed_queue.hpp"
@@ -102,14 +105,17 @@ void resume_construct_sindex(
     start the next pass. */
     const int64_t PAIRS_TO_CONSTRUCT_PER_PASS = 512;
     key_range_t remaining_range = construct_range;
+    int64_t pass_delay_ms = 0;
     while (!remaining_range.is_empty()) {
         scoped_ptr_t<disk_backed_queue_wrapper_t<rdb_modification_report_t> > mod_queue;
+        bool store_is_busy;
         {
             /* Start a transaction and acquire the sindex_block */
             write_token_t token;
             store->new_write_token(&token);
             scoped_ptr_t<txn_t> txn;
             scoped_ptr_t<real_superblock_t> superblock;
+            const ticks_t start_ticks = get_ticks();
             try {
                 store->acquire_superblock_for_write(1,
                                                     write_durability_t::SOFT,
@@ -120,6 +126,10 @@ void resume_construct_sindex(
             } catch (const interrupted_exc_t &) {
                 return;
             }
+            /* The superblock is also what foreground writes queue up for, so a long
+            wait for it means that the table is busy. */
+            store_is_busy = get_ticks() - start_ticks
+                > SINDEX_BUILD_SUPERBLOCK_LATENCY_TARGET_MS * MILLION;
             buf_lock_t sindex_block(superblock->expose_buf(),
                                     superblock->get_sindex_block_id(),
                                     access_t::write);
@@ -174,6 +184,39 @@ void resume_construct_sindex(
 
         // Update the progress value
         current_progress = progress_estimator.estimate_progress(remaining_range.left);
+
+        /* Back off while the foreground load is high, so that index construction
+        doesn't take the disk away from queries. */
+        int64_t max_pass_delay_ms;
+        switch (store->sindex_build_priority) {
+        case sindex_build_priority_t::low:
+            max_pass_delay_ms = SINDEX_BUILD_LOW_PRIORITY_MAX_PASS_DELAY_MS;
+            break;
+        case sindex_build_priority_t::normal:
+            max_pass_delay_ms = SINDEX_BUILD_MAX_PASS_DELAY_MS;
+            break;
+        case sindex_build_priority_t::high:
+            max_pass_delay_ms = 0;
+            break;
+        default:
+            unreachable();
+        }
+        const bool disk_is_busy = store->io_backender_->get_queue_depth()
+            > store->io_backender_->get_max_concurrent_io_requests();
+        if (store_is_busy || disk_is_busy) {
+            pass_delay_ms = std::max<int64_t>(SINDEX_BUILD_MIN_PASS_DELAY_MS,
+                                              pass_delay_ms * 2);
+        } else {
+            pass_delay_ms /= 2;
+        }
+        pass_delay_ms = std::min(pass_delay_ms, max_pass_delay_ms);
+        if (pass_delay_ms > 0 && !remaining_range.is_empty()) {
+            try {
+                nap(pass_delay_ms, store_keepalive.get_drain_signal());
+            } catch (const interrupted_exc_t &) {
+                return;
+            }
+        }
     }
 }
 
@@ -206,10 +249,13 @@ void post_construct_and_drain_queue(
             sindexes_to_bring_up_to_date,
             construction_range_inout,
             // Abort if the mod_queue gets larger than the `MOD_QUEUE_SIZE_LIMIT`, or
-            // we've constructed `max_pairs_to_construct` pairs.
+            // we've constructed `max_pairs_to_construct` pairs, or the snapshot we
+            // read the primary btree from holds on to too much of the cache.
             [&](int64_t pairs_constructed) {
                 return pairs_constructed >= max_pairs_to_construct
-                    || mod_queue->size() > MOD_QUEUE_SIZE_LIMIT;
+                    || mod_queue->size() > MOD_QUEUE_SIZE_LIMIT
+                    || (pairs_constructed >= SNAPSHOT_MEMORY_LIMIT_MIN_ROWS
+                        && store->cache->snapshot_memory_limit_exceeded());
             },
             lock.get_drain_signal());
 
@@ -1052,6 +1098,11 @@ void read_t::unshard(read_response_t *responses, size_t count,
             response_out->n_shards += responses[i].n_shards;
         }
     }
+
+    response_out->stats = ql::query_stats_t();
+    for (size_t i = 0; i < count; ++i) {
+        response_out->stats.add(responses[i].stats);
+    }
 }
 
 struct use_snapshot_visitor_t : public boost::static_visitor<bool> {
@@ -1484,7 +1535,7 @@ RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(
     changefeed_point_stamp_response_t, resp);
 
-RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(read_response_t, response, event_log, n_shards);
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(read_response_t, response, event_log, n_shards, stats);
 RDB_IMPL_SERIALIZABLE_0_FOR_CLUSTER(dummy_read_response_t);
 
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
@@ -27,6 +27,7 @@
 #include "rdb_protocol/geo/ellipsoid.hpp"
 #include "rdb_protocol/geo/lon_lat_types.hpp"
 #include "rdb_protocol/optargs.hpp"
+#include "rdb_protocol/query_stats.hpp"
 #include "rdb_protocol/shards.hpp"
 #include "region/region.hpp"
 #include "repli_timestamp.hpp"
@@ -232,6 +233,8 @@ struct read_response_t {
     variant_t response;
     profile::event_log_t event_log;
     size_t n_shards;
+    // Filled in by every read, whether or not it's being profiled.
+    ql::query_stats_t stats;
 
     read_response_t() { }
     explicit read_response_t(const variant_t &r)
@@ -3,6 +3,7 @@
 
 #include <time.h>
 #include <math.h>
+#include <ctype.h>
 
 #include "errors.hpp"
 #include <boost/date_time.hpp>
@@ -684,5 +685,46 @@ void time_to_str_key(const datum_t &d, std::string *str_out) {
     d.get_field(epoch_time_key).num_to_str_key(str_out);
 }
 
+bool time_to_compact(const datum_t &d, double *epoch_time_out, int16_t *tz_minutes_out) {
+    if (d.get_type() != datum_t::R_OBJECT || d.obj_size() != 3
+        || !d.is_ptype(time_string)) {
+        return false;
+    }
+    datum_t epoch_time = d.get_field(epoch_time_key, NOTHROW);
+    datum_t tz = d.get_field(timezone_key, NOTHROW);
+    if (!epoch_time.has() || epoch_time.get_type() != datum_t::R_NUM
+        || !tz.has() || tz.get_type() != datum_t::R_STR) {
+        return false;
+    }
+    const datum_string_t &tz_str = tz.as_str();
+    if (tz_str.size() != 6) {
+        return false;
+    }
+    const char *c = tz_str.data();
+    if ((c[0] != '+' && c[0] != '-') || c[3] != ':'
+        || !isdigit(c[1]) || !isdigit(c[2]) || !isdigit(c[4]) || !isdigit(c[5])) {
+        return false;
+    }
+    int minutes = ((c[1] - '0') * 10 + (c[2] - '0')) * 60
+        + (c[4] - '0') * 10 + (c[5] - '0');
+    if (c[0] == '-') {
+        // "-00:00" wouldn't come back the same.
+        if (minutes == 0) {
+            return false;
+        }
+        minutes = -minutes;
+    }
+    *epoch_time_out = epoch_time.as_num();
+    *tz_minutes_out = minutes;
+    return true;
+}
+
+datum_t time_from_compact(double epoch_time, int16_t tz_minutes) {
+    const int abs_minutes = tz_minutes < 0 ? -tz_minutes : tz_minutes;
+    return make_time(epoch_time, strprintf("%c%02d:%02d",
+                                           tz_minutes < 0 ? '-' : '+',
+                                           abs_minutes / 60, abs_minutes % 60));
+}
+
 } // namespace pseudo
 } // namespace ql
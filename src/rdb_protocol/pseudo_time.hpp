@@ -2,6 +2,8 @@
 #ifndef RDB_PROTOCOL_PSEUDO_TIME_HPP_
 #define RDB_PROTOCOL_PSEUDO_TIME_HPP_
 
+#include <stdint.h>
+
 #include <string>
 
 #include "version.hpp"
@@ -52,6 +54,13 @@ datum_t time_of_day(datum_t time);
 
 void time_to_str_key(const datum_t &d, std::string *str_out);
 
+// A time that has no other fields, and whose timezone is in the canonical `[+-]HH:MM`
+// form, is fully described by its epoch time and the offset of its timezone in
+// minutes.  That's how `datum_serialize` stores it.  Returns false for other times
+// (and for anything that isn't a time).
+bool time_to_compact(const datum_t &d, double *epoch_time_out, int16_t *tz_minutes_out);
+datum_t time_from_compact(double epoch_time, int16_t tz_minutes);
+
 } // namespace pseudo
 } // namespace ql
 
@@ -1,13 +1,58 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/query_cache.hpp"
 
+#include <algorithm>
+#include <functional>
+
+#include "logger.hpp"
+#include "perfmon/memory_accounting.hpp"
+#include "pprint/js_pprint.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/pseudo_time.hpp"
+#include "rdb_protocol/query_shape.hpp"
 #include "rdb_protocol/response.hpp"
 #include "rdb_protocol/term_walker.hpp"
 
 namespace ql {
 
+compiled_query_t::compiled_query_t(scoped_ptr_t<term_storage_t> &&_term_storage,
+                                   global_optargs_t &&_global_optargs,
+                                   counted_t<const term_t> &&_term_tree,
+                                   bool _noreply,
+                                   bool _profile,
+                                   query_priority_t _priority) :
+        term_storage(std::move(_term_storage)),
+        global_optargs(std::move(_global_optargs)),
+        term_tree(std::move(_term_tree)),
+        noreply(_noreply),
+        profile(_profile),
+        priority(_priority),
+        shape(query_shape(term_storage->root_term())),
+        writes(query_writes(term_storage->root_term())) { }
+
+query_record_t::query_record_t(counted_t<const compiled_query_t> _compiled_query,
+                               microtime_t _start_time) :
+        compiled_query(std::move(_compiled_query)),
+        start_time(_start_time),
+        done(false),
+        logged(false) { }
+
+/* Adds the time that the current coroutine spends running during the lifetime of the
+`running_ticks_counter_t` to `*ticks_out`. */
+class running_ticks_counter_t {
+public:
+    explicit running_ticks_counter_t(ticks_t *_ticks_out) :
+        ticks_out(_ticks_out), start_ticks(coro_t::self()->get_running_ticks()) { }
+    ~running_ticks_counter_t() {
+        *ticks_out += coro_t::self()->get_running_ticks() - start_ticks;
+    }
+private:
+    ticks_t *const ticks_out;
+    const ticks_t start_ticks;
+
+    DISABLE_COPYING(running_ticks_counter_t);
+};
+
 query_cache_t::query_cache_t(
             rdb_context_t *_rdb_ctx,
             ip_and_port_t _client_addr_port,
@@ -17,6 +62,8 @@ query_cache_t::query_cache_t(
         client_addr_port(_client_addr_port),
         return_empty_normal_batches(_return_empty_normal_batches),
         user_context(std::move(_user_context)),
+        prefetched_bytes(0),
+        compiled_queries(QUERY_CACHE_COMPILED_QUERIES),
         next_query_id(0),
         oldest_outstanding_query_id(0) {
     auto res = rdb_ctx->get_query_caches_for_this_thread()->insert(this);
@@ -26,6 +73,9 @@ query_cache_t::query_cache_t(
 query_cache_t::~query_cache_t() {
     size_t res = rdb_ctx->get_query_caches_for_this_thread()->erase(this);
     guarantee(res == 1);
+    // The entries that still hold a prefetched batch go away with `queries`.
+    account_memory(memory_category_t::prefetched_results,
+                   -static_cast<int64_t>(prefetched_bytes));
 }
 
 query_cache_t::const_iterator query_cache_t::begin() const {
@@ -46,29 +96,51 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::create(query_params_t *query_p
             backtrace_registry_t::EMPTY_BACKTRACE);
     }
 
-    global_optargs_t global_optargs;
-    counted_t<const term_t> term_tree;
-    try {
-        query_params->term_storage->preprocess();
-        global_optargs = query_params->term_storage->global_optargs();
-
-        compile_env_t compile_env((var_visibility_t()));
-        term_tree = compile_term(&compile_env, query_params->term_storage->root_term());
-
-    } catch (const exc_t &e) {
-        throw bt_exc_t(Response::COMPILE_ERROR,
-            e.get_error_type(),
-            e.what(),
-            query_params->term_storage->backtrace_registry().datum_backtrace(e));
-    } catch (const datum_exc_t &e) {
-        throw bt_exc_t(Response::COMPILE_ERROR,
-                       e.get_error_type(),
-                       e.what(),
-                       backtrace_registry_t::EMPTY_BACKTRACE);
+    counted_t<const compiled_query_t> compiled_query
+        = std::move(query_params->compiled_query);
+    if (compiled_query.has()) {
+        ++rdb_ctx->stats.compiled_query_hits;
+    } else {
+        ++rdb_ctx->stats.compiled_query_misses;
+
+        global_optargs_t global_optargs;
+        counted_t<const term_t> term_tree;
+        try {
+            query_params->term_storage->preprocess();
+            global_optargs = query_params->term_storage->global_optargs();
+
+            compile_env_t compile_env((var_visibility_t()));
+            term_tree = compile_term(&compile_env,
+                                     query_params->term_storage->root_term());
+
+        } catch (const exc_t &e) {
+            throw bt_exc_t(Response::COMPILE_ERROR,
+                e.get_error_type(),
+                e.what(),
+                query_params->term_storage->backtrace_registry().datum_backtrace(e));
+        } catch (const datum_exc_t &e) {
+            throw bt_exc_t(Response::COMPILE_ERROR,
+                           e.get_error_type(),
+                           e.what(),
+                           backtrace_registry_t::EMPTY_BACKTRACE);
+        }
+
+        const bool cacheable = !query_params->compiled_query_key.empty()
+            && !query_params->term_storage->is_specific_to_preprocess_time();
+        compiled_query = make_counted<compiled_query_t>(
+            std::move(query_params->term_storage),
+            std::move(global_optargs),
+            std::move(term_tree),
+            query_params->noreply,
+            query_params->profile,
+            query_params->priority);
+        if (cacheable) {
+            compiled_queries[std::move(query_params->compiled_query_key)]
+                = compiled_query;
+        }
     }
-    scoped_ptr_t<entry_t> entry(new entry_t(query_params,
-                                            std::move(global_optargs),
-                                            std::move(term_tree)));
+    scoped_ptr_t<entry_t> entry(new entry_t(query_params, std::move(compiled_query)));
+    query_params->record = entry->record;
 
     scoped_ptr_t<ref_t> ref(new ref_t(this,
                                       query_params->token,
@@ -81,6 +153,16 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::create(query_params_t *query_p
     return ref;
 }
 
+counted_t<const compiled_query_t> query_cache_t::find_compiled_query(
+        const std::string &query_text) {
+    assert_thread();
+    auto it = compiled_queries.find(query_text);
+    if (it == compiled_queries.end()) {
+        return counted_t<const compiled_query_t>();
+    }
+    return it->second;
+}
+
 scoped_ptr_t<query_cache_t::ref_t> query_cache_t::get(query_params_t *query_params,
                                                       signal_t *interruptor) {
     guarantee(this == query_params->query_cache);
@@ -92,6 +174,7 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::get(query_params_t *query_para
             backtrace_registry_t::EMPTY_BACKTRACE);
     }
 
+    query_params->record = it->second->record;
     return scoped_ptr_t<ref_t>(new ref_t(this,
                                          query_params->token,
                                          std::move(query_params->throttler),
@@ -130,6 +213,41 @@ void query_cache_t::stop_query(query_params_t *query_params, signal_t *interrupt
     get(query_params, interruptor);
 }
 
+void query_cache_t::note_response_sent(query_params_t *query_params,
+                                       size_t bytes_sent) {
+    assert_thread();
+    counted_t<query_record_t> record = std::move(query_params->record);
+    if (!record.has()) {
+        return;
+    }
+    record->stats.bytes_sent += bytes_sent;
+    if (!record->done || record->logged) {
+        return;
+    }
+    record->logged = true;
+
+    const microtime_t now = current_microtime();
+    const microtime_t duration = now - std::min(record->start_time, now);
+    rdb_ctx->stats.query_latency.record(duration);
+    rdb_ctx->stats.query_shape_latency.record(record->compiled_query->shape, duration);
+    if (rdb_ctx->slow_query_threshold_ms != 0 &&
+        duration >= rdb_ctx->slow_query_threshold_ms * THOUSAND) {
+        std::string query = pprint::pretty_print(
+            SLOW_QUERY_LOG_COLUMNS,
+            pprint::render_as_javascript(
+                record->compiled_query->term_storage->root_term()));
+        std::replace(query.begin(), query.end(), '\n', ' ');
+        logINF("Slow query (%.3fs) from %s:%d by %s: %s (shape %s) (%s)",
+               duration / static_cast<double>(MILLION),
+               client_addr_port.ip().to_string().c_str(),
+               client_addr_port.port().value(),
+               user_context.to_string().c_str(),
+               query.c_str(),
+               record->compiled_query->shape.c_str(),
+               record->stats.print().c_str());
+    }
+}
+
 void query_cache_t::terminate_internal(query_cache_t::entry_t *entry) {
     if (entry->state == entry_t::state_t::START ||
         entry->state == entry_t::state_t::STREAM) {
@@ -173,6 +291,8 @@ query_cache_t::ref_t::~ref_t() {
         //     removed, including the one in this reference
         // We remove the entry from the cache so no new queries can acquire it
         entry->state = entry_t::state_t::DELETING;
+        entry->record->done = true;
+        query_cache->discard_prefetched_batch(entry);
 
         auto it = query_cache->queries.find(token);
         guarantee(it != query_cache->queries.end());
@@ -207,10 +327,17 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
             &combined_interruptor,
             serializable,
             trace.get_or_null());
+        env.set_query_stats(&entry->record->stats);
+        // Evaluating the query yields, so we only count the time this coroutine runs.
+        running_ticks_counter_t cpu_counter(&entry->record->stats.cpu_ticks);
 
         if (entry->state == entry_t::state_t::START) {
             run(&env, res);
             entry->term_tree.reset();
+            if (entry->state == entry_t::state_t::STREAM) {
+                scoped_ptr_t<val_t> prefetch = env.get_optarg(&env, "prefetch");
+                entry->prefetch = prefetch.has() && prefetch->as_bool();
+            }
         }
 
         if (entry->state == entry_t::state_t::STREAM) {
@@ -314,11 +441,20 @@ void query_cache_t::ref_t::serve(env_t *env, response_t *res) {
         throttler.reset();
     }
 
-    batch_type_t batch_type = entry->has_sent_batch
-                                  ? batch_type_t::NORMAL
-                                  : batch_type_t::NORMAL_FIRST;
-    std::vector<datum_t> ds = entry->stream->next_batch(
-            env, batchspec_t::user(batch_type, env));
+    std::vector<datum_t> ds;
+    if (entry->has_prefetched_batch) {
+        std::exception_ptr error = entry->prefetch_error;
+        ds = std::move(entry->prefetched_batch);
+        query_cache->discard_prefetched_batch(entry);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    } else {
+        batch_type_t batch_type = entry->has_sent_batch
+                                      ? batch_type_t::NORMAL
+                                      : batch_type_t::NORMAL_FIRST;
+        ds = entry->stream->next_batch(env, batchspec_t::user(batch_type, env));
+    }
     entry->has_sent_batch = true;
     res->set_data(std::move(ds));
 
@@ -356,22 +492,108 @@ void query_cache_t::ref_t::serve(env_t *env, response_t *res) {
     default: unreachable();
     }
     entry->stream->set_notes(res);
+
+    if (cfeed_type == feed_type_t::not_feed
+        && res->type() == Response::SUCCESS_PARTIAL) {
+        query_cache->maybe_prefetch(entry);
+    }
+}
+
+void query_cache_t::maybe_prefetch(entry_t *entry) {
+    // A profile has to be part of the response that the batch goes out with, so we
+    // don't prefetch profiled queries.
+    if (entry->prefetch
+        && entry->profile == profile_bool_t::DONT_PROFILE
+        && !entry->has_prefetched_batch
+        && prefetched_bytes < QUERY_CACHE_MAX_PREFETCH_BYTES) {
+        coro_t::spawn_sometime(std::bind(&query_cache_t::prefetch, this, entry,
+                                         entry->drainer.lock()));
+    }
+}
+
+void query_cache_t::prefetch(entry_t *entry, auto_drainer_t::lock_t entry_lock) {
+    assert_thread();
+    wait_any_t interruptor(&entry->persistent_interruptor,
+                           entry_lock.get_drain_signal());
+    // This gets in line behind the ref that spawned us, and behind a `CONTINUE` that
+    // may have arrived in the meantime, in which case there's nothing to do.
+    new_mutex_in_line_t mutex_lock(&entry->mutex);
+    try {
+        wait_interruptible(mutex_lock.acq_signal(), &interruptor);
+    } catch (const interrupted_exc_t &) {
+        return;
+    }
+    if (entry->state != entry_t::state_t::STREAM
+        || entry->has_prefetched_batch
+        || entry->stream->is_exhausted()) {
+        return;
+    }
+
+    std::vector<datum_t> batch;
+    std::exception_ptr error;
+    try {
+        serializable_env_t serializable{
+                entry->global_optargs,
+                get_user_context(),
+                pseudo::time_now()};
+        env_t env(rdb_ctx, return_empty_normal_batches, &interruptor, serializable,
+                  nullptr);
+        env.set_query_stats(&entry->record->stats);
+        running_ticks_counter_t cpu_counter(&entry->record->stats.cpu_ticks);
+        batch = entry->stream->next_batch(
+            &env, batchspec_t::user(batch_type_t::NORMAL, &env));
+    } catch (const interrupted_exc_t &) {
+        // The query is being stopped, so nobody is going to ask for the batch.
+        return;
+    } catch (...) {
+        // Reported along with the batch that would have contained it.
+        error = std::current_exception();
+    }
+
+    if (entry->state != entry_t::state_t::STREAM) {
+        return;
+    }
+    size_t bytes = 0;
+    for (const datum_t &d : batch) {
+        bytes += serialized_size<cluster_version_t::CLUSTER>(d);
+    }
+    entry->has_prefetched_batch = true;
+    entry->prefetched_batch = std::move(batch);
+    entry->prefetch_error = error;
+    entry->prefetched_bytes = bytes;
+    prefetched_bytes += bytes;
+    account_memory(memory_category_t::prefetched_results, bytes);
+}
+
+void query_cache_t::discard_prefetched_batch(entry_t *entry) {
+    guarantee(prefetched_bytes >= entry->prefetched_bytes);
+    prefetched_bytes -= entry->prefetched_bytes;
+    account_memory(memory_category_t::prefetched_results,
+                   -static_cast<int64_t>(entry->prefetched_bytes));
+    entry->has_prefetched_batch = false;
+    entry->prefetched_batch.clear();
+    entry->prefetch_error = std::exception_ptr();
+    entry->prefetched_bytes = 0;
 }
 
 query_cache_t::entry_t::entry_t(query_params_t *query_params,
-                                global_optargs_t &&_global_optargs,
-                                counted_t<const term_t> &&_term_tree) :
+                                counted_t<const compiled_query_t> &&_compiled_query) :
         state(state_t::START),
         interrupt_reason(interrupt_reason_t::UNKNOWN),
         job_id(generate_uuid()),
         noreply(query_params->noreply),
         profile(query_params->profile ? profile_bool_t::PROFILE :
                                         profile_bool_t::DONT_PROFILE),
-        term_storage(std::move(query_params->term_storage)),
-        global_optargs(std::move(_global_optargs)),
+        compiled_query(std::move(_compiled_query)),
+        term_storage(compiled_query->term_storage.get()),
+        global_optargs(compiled_query->global_optargs),
         start_time(current_microtime()),
-        term_tree(std::move(_term_tree)),
-        has_sent_batch(false) { }
+        record(make_counted<query_record_t>(compiled_query, start_time)),
+        term_tree(compiled_query->term_tree),
+        has_sent_batch(false),
+        prefetch(false),
+        has_prefetched_batch(false),
+        prefetched_bytes(0) { }
 
 query_cache_t::entry_t::~entry_t() { }
 
@@ -8,6 +8,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "arch/address.hpp"
 #include "clustering/administration/auth/user_context.hpp"
@@ -19,6 +20,7 @@
 #include "containers/scoped.hpp"
 #include "containers/counted.hpp"
 #include "containers/intrusive_list.hpp"
+#include "containers/lru_cache.hpp"
 #include "containers/object_buffer.hpp"
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/rdb_backtrace.hpp"
@@ -32,6 +34,52 @@
 
 namespace ql {
 
+/* A START query after preprocessing and compilation. The term tree points into the
+term storage, so the two are kept together. Evaluating a term tree doesn't modify it,
+so all the queries with the same text can share one `compiled_query_t`. */
+class compiled_query_t : public single_threaded_countable_t<compiled_query_t> {
+public:
+    compiled_query_t(scoped_ptr_t<term_storage_t> &&_term_storage,
+                     global_optargs_t &&_global_optargs,
+                     counted_t<const term_t> &&_term_tree,
+                     bool _noreply,
+                     bool _profile,
+                     query_priority_t _priority);
+
+    const scoped_ptr_t<const term_storage_t> term_storage;
+    const global_optargs_t global_optargs;
+    const counted_t<const term_t> term_tree;
+    const bool noreply;
+    const bool profile;
+    const query_priority_t priority;
+    // See `query_shape()` and `query_writes()`.
+    const std::string shape;
+    const bool writes;
+
+private:
+    DISABLE_COPYING(compiled_query_t);
+};
+
+/* What a query in the `query_cache_t` has cost so far.  The `query_params_t` of the
+client request that runs the query holds on to it as well, so that the size of the
+response can be added after it has been sent, even if it was the last one and the
+cache entry is gone by then. */
+class query_record_t : public single_threaded_countable_t<query_record_t> {
+public:
+    query_record_t(counted_t<const compiled_query_t> _compiled_query,
+                   microtime_t _start_time);
+
+    const counted_t<const compiled_query_t> compiled_query;
+    const microtime_t start_time;
+    query_stats_t stats;
+    // Set once the query has produced its last response, and once it's been logged.
+    bool done;
+    bool logged;
+
+private:
+    DISABLE_COPYING(query_record_t);
+};
+
 class query_cache_t : public home_thread_mixin_t {
     class entry_t;
 public:
@@ -88,12 +136,21 @@ public:
     scoped_ptr_t<ref_t> get(query_params_t *query_params,
                             signal_t *interruptor);
 
+    // Returns the compiled form of an earlier START query with the text `query_text`,
+    // or an empty pointer if there is none.
+    counted_t<const compiled_query_t> find_compiled_query(const std::string &query_text);
+
     void noreply_wait(const query_params_t &query_params,
                       signal_t *interruptor);
 
     // Issue a stop query to the cache
     void stop_query(query_params_t *query_params, signal_t *interruptor);
 
+    // Called once the response to `query_params` has been sent, or wasn't sent because
+    // of `noreply`.  Adds `bytes_sent` to the query's stats, and logs the query if it
+    // has finished and was slow.
+    void note_response_sent(query_params_t *query_params, size_t bytes_sent);
+
     // Directly stop a query by its entry
     void terminate_internal(entry_t *entry);
 
@@ -105,8 +162,7 @@ private:
     class entry_t {
     public:
         entry_t(query_params_t *query_params,
-                global_optargs_t &&_global_optargs,
-                counted_t<const term_t> &&_term_tree);
+                counted_t<const compiled_query_t> &&_compiled_query);
         ~entry_t();
 
         enum class state_t { START, STREAM, DONE, DELETING } state;
@@ -115,10 +171,14 @@ private:
         const uuid_u job_id;
         const bool noreply;
         const profile_bool_t profile;
-        const scoped_ptr_t<const term_storage_t> term_storage;
+        // This may be shared with other queries that have the same text
+        const counted_t<const compiled_query_t> compiled_query;
+        const term_storage_t *const term_storage;
         const global_optargs_t global_optargs;
         const microtime_t start_time;
 
+        const counted_t<query_record_t> record;
+
         cond_t persistent_interruptor;
 
         // This will be empty if the root term has already been run
@@ -130,6 +190,16 @@ private:
         counted_t<datum_stream_t> stream;
         bool has_sent_batch;
 
+        // Set if the query was run with the `prefetch` optarg.  If
+        // `has_prefetched_batch` is set, the next batch of `stream` has already been
+        // computed, and is either `prefetched_batch` or the exception in
+        // `prefetch_error`.
+        bool prefetch;
+        bool has_prefetched_batch;
+        std::vector<datum_t> prefetched_batch;
+        std::exception_ptr prefetch_error;
+        size_t prefetched_bytes;
+
         // The order of these is very important, do not move them around
         new_mutex_t mutex; // Only one coroutine may be using this query at a time
         auto_drainer_t drainer; // Keep this entry alive until all refs are destroyed
@@ -140,12 +210,24 @@ private:
 
     static void async_destroy_entry(entry_t *entry);
 
+    // Computes the next batch of `entry`'s stream in the background, once the
+    // current one has been handed to the client.
+    void maybe_prefetch(entry_t *entry);
+    void prefetch(entry_t *entry, auto_drainer_t::lock_t entry_lock);
+    void discard_prefetched_batch(entry_t *entry);
+
     rdb_context_t *const rdb_ctx;
     ip_and_port_t client_addr_port;
     return_empty_normal_batches_t return_empty_normal_batches;
     auth::user_context_t user_context;
     std::map<int64_t, scoped_ptr_t<entry_t> > queries;
 
+    // The sum of the `prefetched_bytes` of all entries
+    size_t prefetched_bytes;
+
+    // The most recently compiled START queries, by query text
+    lru_cache_t<std::string, counted_t<const compiled_query_t> > compiled_queries;
+
     // Used for noreply waiting, this contains all allocated-but-incomplete query ids
     friend class query_params_t::query_id_t;
     uint64_t next_query_id;
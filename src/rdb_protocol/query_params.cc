@@ -68,11 +68,31 @@ query_params_t::query_params_t(int64_t _token,
                                scoped_ptr_t<term_storage_t> &&_term_storage) :
         query_cache(_query_cache),
         term_storage(std::move(_term_storage)),
-        id(query_cache), token(_token), noreply(false), profile(false) {
+        id(query_cache), token(_token), noreply(false), profile(false),
+        priority(query_priority_t::NORMAL) {
     // Parse out information that is needed before query evaluation
     type = term_storage->query_type();
     noreply = term_storage->static_optarg_as_bool("noreply", noreply);
     profile = term_storage->static_optarg_as_bool("profile", profile);
+    const std::string priority_name =
+        term_storage->static_optarg_as_string("priority", "normal");
+    if (!parse_query_priority(priority_name, &priority)) {
+        throw bt_exc_t(Response::CLIENT_ERROR, Response::QUERY_LOGIC,
+                       strprintf("Unrecognized priority `%s` (expected `high`, "
+                                 "`normal` or `low`).", priority_name.c_str()),
+                       backtrace_registry_t::EMPTY_BACKTRACE);
+    }
 }
 
+query_params_t::query_params_t(int64_t _token,
+                               ql::query_cache_t *_query_cache,
+                               counted_t<const compiled_query_t> &&_compiled_query) :
+        query_cache(_query_cache),
+        compiled_query(std::move(_compiled_query)),
+        id(query_cache), token(_token), type(Query::START),
+        noreply(compiled_query->noreply), profile(compiled_query->profile),
+        priority(compiled_query->priority) { }
+
+query_params_t::~query_params_t() { }
+
 } // namespace ql
@@ -2,15 +2,21 @@
 #ifndef RDB_PROTOCOL_QUERY_PARAMS_HPP_
 #define RDB_PROTOCOL_QUERY_PARAMS_HPP_
 
+#include <string>
+
 #include "concurrency/new_semaphore.hpp"
+#include "containers/counted.hpp"
 #include "containers/intrusive_list.hpp"
 #include "containers/scoped.hpp"
+#include "rdb_protocol/admission_control.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/ql2.pb.h"
 
 namespace ql {
 
+class compiled_query_t;
 class query_cache_t;
+class query_record_t;
 class term_storage_t;
 
 class query_params_t {
@@ -18,6 +24,11 @@ public:
     query_params_t(int64_t _token,
                    ql::query_cache_t *_query_cache,
                    scoped_ptr_t<term_storage_t> &&_term_storage);
+    // For a START query whose text matched one of the query cache's compiled queries
+    query_params_t(int64_t _token,
+                   ql::query_cache_t *_query_cache,
+                   counted_t<const compiled_query_t> &&_compiled_query);
+    ~query_params_t();
 
     // A query id is allocated when each query is received from the client
     // in order, so order can be checked for in queries that require it
@@ -38,16 +49,24 @@ public:
     void maybe_release_query_id();
 
     query_cache_t *query_cache;
+    // Exactly one of `term_storage` and `compiled_query` is set.
     scoped_ptr_t<term_storage_t> term_storage;
+    counted_t<const compiled_query_t> compiled_query;
+    // The text of the query, if the query cache may keep its compiled form around
+    std::string compiled_query_key;
     query_id_t id;
 
     int64_t token;
     Query::QueryType type;
     bool noreply;
     bool profile;
+    query_priority_t priority;
 
     new_semaphore_in_line_t throttler;
 
+    // Set by the query cache, see `query_cache_t::note_response_sent()`.
+    counted_t<query_record_t> record;
+
 private:
     DISABLE_COPYING(query_params_t);
 };
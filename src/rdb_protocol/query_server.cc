@@ -1,6 +1,9 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/query_server.hpp"
 
+#include <algorithm>
+
+#include "perfmon/memory_accounting.hpp"
 #include "perfmon/perfmon.hpp"
 #include "rdb_protocol/rdb_backtrace.hpp"
 #include "rdb_protocol/ql2.pb.h"
@@ -10,15 +13,21 @@
 
 rdb_query_server_t::rdb_query_server_t(
     const std::set<ip_address_t> &local_addresses, int port,
+    const optional<std::string> &unix_socket_path,
     rdb_context_t *_rdb_ctx, server_config_client_t *_server_config_client,
-    const server_id_t &_server_id, tls_ctx_t *tls_ctx
+    const server_id_t &_server_id, tls_ctx_t *tls_ctx,
+    ql::user_quotas_t *_user_quotas
 ) :
+    admission_control(&_rdb_ctx->stats.queries_queued,
+                      &_rdb_ctx->stats.queries_rejected),
     server(
-        _rdb_ctx, local_addresses, port, this, default_http_timeout_sec, tls_ctx
+        _rdb_ctx, local_addresses, port, unix_socket_path, this,
+        default_http_timeout_sec, tls_ctx
     ),
     rdb_ctx(_rdb_ctx),
     server_config_client(_server_config_client),
     server_id(_server_id),
+    user_quotas(_user_quotas),
     thread_counters(0) { }
 
 http_app_t *rdb_query_server_t::get_http_app() {
@@ -29,6 +38,32 @@ int rdb_query_server_t::get_port() const {
     return server.get_port();
 }
 
+ql::user_quotas_t::usage_t *rdb_query_server_t::get_quota_usage(
+        ql::query_params_t *query_params) {
+    const auth::username_t *username =
+        query_params->query_cache->get_user_context().get_username();
+    if (user_quotas == nullptr || username == nullptr) {
+        return nullptr;
+    }
+    return user_quotas->find(username->to_string());
+}
+
+static void fill_retryable_error(ql::response_t *response_out,
+                                 const std::string &reason) {
+    response_out->fill_error(
+        Response::RUNTIME_ERROR,
+        Response::OP_FAILED,
+        reason + "  The query was not run and may be retried later.",
+        ql::backtrace_registry_t::EMPTY_BACKTRACE);
+}
+
+// How many bytes the query has read so far, across all of its batches
+static uint64_t get_read_bytes(ql::query_params_t *query_params) {
+    return query_params->record.has()
+        ? query_params->record->stats.cache_bytes_read
+        : 0;
+}
+
 void rdb_query_server_t::run_query(ql::query_params_t *query_params,
                                    ql::response_t *response_out,
                                    signal_t *interruptor) {
@@ -40,14 +75,54 @@ void rdb_query_server_t::run_query(ql::query_params_t *query_params,
 
         switch (query_params->type) {
         case Query::START: {
+            if (memory_is_low()) {
+                response_out->fill_error(Response::RUNTIME_ERROR,
+                                         Response::RESOURCE_LIMIT,
+                                         "The server is running out of memory and "
+                                         "rejects new queries until it has more room.",
+                                         ql::backtrace_registry_t::EMPTY_BACKTRACE);
+                break;
+            }
+            ql::user_quotas_t::usage_t *usage = get_quota_usage(query_params);
+            ql::user_quotas_t::running_query_t running;
+            ql::query_priority_t priority = query_params->priority;
+            if (usage != nullptr) {
+                priority = std::max(priority, usage->quota.max_priority);
+                std::string error;
+                if (!usage->start_query(&running, &error, interruptor)) {
+                    fill_retryable_error(response_out, error);
+                    break;
+                }
+            }
+            ql::admission_control_t::ticket_t ticket;
+            if (!admission_control.get()->admit(priority, &ticket, interruptor)) {
+                fill_retryable_error(response_out,
+                                     "The server is overloaded and could not start "
+                                     "the query in time.");
+                break;
+            }
             scoped_ptr_t<ql::query_cache_t::ref_t> query_ref =
                 query_params->query_cache->create(query_params, interruptor);
             query_ref->fill_response(response_out);
+            if (usage != nullptr) {
+                usage->charge(get_read_bytes(query_params),
+                              query_params->record->compiled_query->writes ? 1 : 0);
+            }
         } break;
         case Query::CONTINUE: {
+            // The stream is already running, so its batches get slowed down instead
+            // of failing.
+            ql::user_quotas_t::usage_t *usage = get_quota_usage(query_params);
+            if (usage != nullptr) {
+                usage->throttle(interruptor);
+            }
             scoped_ptr_t<ql::query_cache_t::ref_t> query_ref =
                 query_params->query_cache->get(query_params, interruptor);
+            const uint64_t read_bytes_before = get_read_bytes(query_params);
             query_ref->fill_response(response_out);
+            if (usage != nullptr) {
+                usage->charge(get_read_bytes(query_params) - read_bytes_before, 0);
+            }
         } break;
         case Query::STOP: {
             query_params->query_cache->stop_query(query_params, interruptor);
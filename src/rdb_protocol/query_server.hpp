@@ -9,6 +9,8 @@
 #include "concurrency/one_per_thread.hpp"
 #include "client_protocol/server.hpp"
 #include "clustering/administration/servers/config_client.hpp"
+#include "rdb_protocol/admission_control.hpp"
+#include "rdb_protocol/user_quotas.hpp"
 
 namespace ql {
 class query_params_t;
@@ -22,8 +24,10 @@ class rdb_query_server_t : public query_handler_t {
 public:
     rdb_query_server_t(
       const std::set<ip_address_t> &local_addresses, int port,
+      const optional<std::string> &unix_socket_path,
       rdb_context_t *_rdb_ctx, server_config_client_t *_server_config_client,
-      const server_id_t &_server_id, tls_ctx_t *tls_ctx);
+      const server_id_t &_server_id, tls_ctx_t *tls_ctx,
+      ql::user_quotas_t *_user_quotas);
 
     http_app_t *get_http_app();
     int get_port() const;
@@ -34,12 +38,18 @@ public:
 private:
     void fill_server_info(ql::response_t *out);
 
+    // The usage of the user who sent the query, if that user has a quota
+    ql::user_quotas_t::usage_t *get_quota_usage(ql::query_params_t *query_params);
+
     static const uint32_t default_http_timeout_sec = 300;
 
+    // This has to outlive `server`, whose connections hold on to its tickets.
+    one_per_thread_t<ql::admission_control_t> admission_control;
     query_server_t server;
     rdb_context_t *rdb_ctx;
     server_config_client_t *server_config_client;
     server_id_t server_id;
+    ql::user_quotas_t *user_quotas;
     one_per_thread_t<int> thread_counters;
 
     DISABLE_COPYING(rdb_query_server_t);
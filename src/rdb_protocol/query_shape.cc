@@ -0,0 +1,131 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/query_shape.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "config/args.hpp"
+#include "containers/optional.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/term_storage.hpp"
+
+namespace ql {
+
+static const char *const literal_shape = "?";
+
+// Whether the string arguments of terms of type `type` are kept in the shape.
+static bool keeps_string_args(Term::TermType type) {
+    switch (type) {
+    case Term::DB:
+    case Term::TABLE:
+    case Term::GET_FIELD:
+    case Term::BRACKET:
+    case Term::PLUCK:
+    case Term::WITHOUT:
+    case Term::HAS_FIELDS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void append_shape(const raw_term_t &term, bool keep_strings, std::string *out) {
+    if (out->size() >= QUERY_SHAPE_MAX_SIZE) {
+        return;
+    }
+
+    const Term::TermType type = term.type();
+    if (type == Term::DATUM) {
+        datum_t datum = term.datum();
+        if (keep_strings && datum.get_type() == datum_t::R_STR) {
+            out->append(1, '"');
+            out->append(datum.as_str().to_std());
+            out->append(1, '"');
+        } else {
+            out->append(literal_shape);
+        }
+        return;
+    }
+
+    std::vector<std::pair<std::string, raw_term_t> > optargs;
+    term.each_optarg([&](const raw_term_t &optarg, const std::string &name) {
+        optargs.push_back(std::make_pair(name, optarg));
+    });
+    std::sort(optargs.begin(), optargs.end(),
+              [](const std::pair<std::string, raw_term_t> &a,
+                 const std::pair<std::string, raw_term_t> &b) {
+                  return a.first < b.first;
+              });
+
+    // Array and object literals are literals as well, however many elements they
+    // have, as long as all of them are.
+    const size_t start = out->size();
+    out->append(Term::TermType_Name(type));
+    out->append(1, '(');
+    bool all_literals = (type == Term::MAKE_ARRAY || type == Term::MAKE_OBJ);
+    bool first = true;
+    for (size_t i = 0; i < term.num_args(); ++i) {
+        if (!first) {
+            out->append(", ");
+        }
+        first = false;
+        const size_t arg_start = out->size();
+        append_shape(term.arg(i), keeps_string_args(type), out);
+        all_literals = all_literals && out->compare(arg_start, std::string::npos,
+                                                    literal_shape) == 0;
+    }
+    for (const auto &optarg : optargs) {
+        if (!first) {
+            out->append(", ");
+        }
+        first = false;
+        out->append(optarg.first);
+        out->append(1, '=');
+        const size_t arg_start = out->size();
+        append_shape(optarg.second, optarg.first == "index", out);
+        all_literals = all_literals && out->compare(arg_start, std::string::npos,
+                                                    literal_shape) == 0;
+    }
+    out->append(1, ')');
+
+    if (all_literals) {
+        out->replace(start, std::string::npos, literal_shape);
+    }
+}
+
+std::string query_shape(const raw_term_t &term) {
+    std::string shape;
+    append_shape(term, false, &shape);
+    if (shape.size() > QUERY_SHAPE_MAX_SIZE) {
+        shape.resize(QUERY_SHAPE_MAX_SIZE);
+    }
+    return shape;
+}
+
+bool query_writes(const raw_term_t &term) {
+    switch (term.type()) {
+    case Term::INSERT:
+    case Term::UPDATE:
+    case Term::REPLACE:
+    case Term::DELETE:
+        return true;
+    case Term::DATUM:
+        return false;
+    default:
+        break;
+    }
+    for (size_t i = 0; i < term.num_args(); ++i) {
+        if (query_writes(term.arg(i))) {
+            return true;
+        }
+    }
+    bool res = false;
+    term.each_optarg([&](const raw_term_t &optarg, const std::string &) {
+        res = res || query_writes(optarg);
+    });
+    return res;
+}
+
+}  // namespace ql
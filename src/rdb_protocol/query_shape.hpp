@@ -0,0 +1,24 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_QUERY_SHAPE_HPP_
+#define RDB_PROTOCOL_QUERY_SHAPE_HPP_
+
+#include <string>
+
+namespace ql {
+
+class raw_term_t;
+
+/* Returns the shape of the query `term`, which is the same for all the queries that
+only differ in their literal values.  For example `r.table("users").get(5)` and
+`r.table("users").get(6)` both have the shape `GET(TABLE("users"), ?)`.  Database and
+table names, field names and the `index` optarg are kept, because queries that read
+different tables or use different indexes behave differently.  Optargs are sorted by
+name, and the result is cut off after `QUERY_SHAPE_MAX_SIZE` characters. */
+std::string query_shape(const raw_term_t &term);
+
+// Whether the query `term` contains an insert, update, replace or delete.
+bool query_writes(const raw_term_t &term);
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_QUERY_SHAPE_HPP_
@@ -0,0 +1,53 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/query_stats.hpp"
+
+#include <inttypes.h>
+
+#include "rdb_protocol/datum.hpp"
+#include "utils.hpp"
+
+namespace ql {
+
+query_stats_t::query_stats_t()
+    : rows_read(0),
+      sindex_entries_scanned(0),
+      cache_bytes_read(0),
+      disk_bytes_read(0),
+      cpu_ticks(0),
+      bytes_sent(0) { }
+
+void query_stats_t::add(const query_stats_t &other) {
+    rows_read += other.rows_read;
+    sindex_entries_scanned += other.sindex_entries_scanned;
+    cache_bytes_read += other.cache_bytes_read;
+    disk_bytes_read += other.disk_bytes_read;
+    cpu_ticks += other.cpu_ticks;
+    bytes_sent += other.bytes_sent;
+}
+
+datum_t query_stats_t::to_datum() const {
+    datum_object_builder_t builder;
+    builder.overwrite("rows_read", datum_t(static_cast<double>(rows_read)));
+    builder.overwrite("sindex_entries_scanned",
+                      datum_t(static_cast<double>(sindex_entries_scanned)));
+    builder.overwrite("cache_bytes_read", datum_t(static_cast<double>(cache_bytes_read)));
+    builder.overwrite("disk_bytes_read", datum_t(static_cast<double>(disk_bytes_read)));
+    builder.overwrite("cpu_time", datum_t(ticks_to_secs(cpu_ticks)));
+    builder.overwrite("bytes_sent", datum_t(static_cast<double>(bytes_sent)));
+    return std::move(builder).to_datum();
+}
+
+std::string query_stats_t::print() const {
+    return strprintf(
+        "rows read %" PRIu64 ", sindex entries scanned %" PRIu64 ", "
+        "bytes read from cache %" PRIu64 ", bytes read from disk %" PRIu64 ", "
+        "cpu time %.3fs, bytes sent %" PRIu64,
+        rows_read, sindex_entries_scanned, cache_bytes_read, disk_bytes_read,
+        ticks_to_secs(cpu_ticks), bytes_sent);
+}
+
+RDB_IMPL_SERIALIZABLE_6_FOR_CLUSTER(
+    query_stats_t, rows_read, sindex_entries_scanned, cache_bytes_read,
+    disk_bytes_read, cpu_ticks, bytes_sent);
+
+}  // namespace ql
@@ -0,0 +1,43 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_QUERY_STATS_HPP_
+#define RDB_PROTOCOL_QUERY_STATS_HPP_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "rpc/serialize_macros.hpp"
+#include "time.hpp"
+
+namespace ql {
+
+class datum_t;
+
+/* What a query has cost so far.  These are counted for every query, not just for the
+ones that are being profiled, so they have to be cheap to update.  The shards fill in
+the read counters and send them back in `read_response_t::stats`, and the server that
+runs the query adds them up in the query's `query_cache_t` entry. */
+struct query_stats_t {
+    query_stats_t();
+
+    void add(const query_stats_t &other);
+
+    // For the `rethinkdb.jobs` table.
+    datum_t to_datum() const;
+    // For the log.
+    std::string print() const;
+
+    uint64_t rows_read;
+    uint64_t sindex_entries_scanned;
+    uint64_t cache_bytes_read;
+    uint64_t disk_bytes_read;
+    // How long the query's coroutine on the server that parsed it was running for.
+    // Waiting for reads and writes doesn't count.
+    ticks_t cpu_ticks;
+    uint64_t bytes_sent;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(query_stats_t);
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_QUERY_STATS_HPP_
@@ -1,9 +1,14 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved
 #include "rdb_protocol/real_table.hpp"
 
+#include <algorithm>
+#include <exception>
+
 #include "clustering/administration/auth/permission_error.hpp"
 #include "clustering/administration/tables/table_metadata.hpp"
 #include "clustering/table_manager/table_meta_client.hpp"
+#include "concurrency/pmap.hpp"
+#include "config/args.hpp"
 #include "math.hpp"
 #include "rdb_protocol/geo/ellipsoid.hpp"
 #include "rdb_protocol/geo/distances.hpp"
@@ -15,6 +20,7 @@
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/math_utils.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/write_coalescer.hpp"
 
 
 namespace_id_t real_table_t::get_id() const {
@@ -27,8 +33,23 @@ const std::string &real_table_t::get_pkey() const {
 
 ql::datum_t real_table_t::read_row(
     ql::env_t *env, ql::datum_t pval, read_mode_t read_mode) {
-    read_t read(point_read_t(store_key_t(pval.print_primary())),
-                env->profile(), read_mode);
+    store_key_t key(pval.print_primary());
+    // Outdated reads can be answered from the point read cache, if there is one.  The
+    // reads that fill it go to the primary replicas, so that the changes it hears
+    // about from them can't be older than what it has.
+    if (read_mode == read_mode_t::OUTDATED
+        && env->profile() == profile_bool_t::DONT_PROFILE
+        && changefeed_client->point_read_cache_enabled()) {
+        return changefeed_client->cached_point_read(
+            env, uuid, key,
+            [&]() { return point_read(env, key, read_mode_t::SINGLE); });
+    }
+    return point_read(env, key, read_mode);
+}
+
+ql::datum_t real_table_t::point_read(
+    ql::env_t *env, const store_key_t &key, read_mode_t read_mode) {
+    read_t read(point_read_t(key), env->profile(), read_mode);
     read_response_t res;
     read_with_profile(env, read, &res);
     point_read_response_t *p_res = boost::get<point_read_response_t>(&res.response);
@@ -219,6 +240,33 @@ std::vector<std::vector<T> > split(std::vector<T> &&v) {
     return out;
 }
 
+/* Sorts `inserts` by primary key, so that each batch `split()` makes of them goes to as
+few shards as possible. Returns false and leaves `inserts` alone if two of them have
+the same primary key, because their batches have to run in order then. */
+bool sort_inserts_by_primary_key(const std::string &pkey,
+                                 std::vector<ql::datum_t> *inserts) {
+    std::vector<std::pair<store_key_t, size_t> > keys;
+    keys.reserve(inserts->size());
+    for (size_t i = 0; i < inserts->size(); ++i) {
+        keys.emplace_back(
+            store_key_t((*inserts)[i].get_field(datum_string_t(pkey)).print_primary()),
+            i);
+    }
+    std::sort(keys.begin(), keys.end());
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (keys[i - 1].first == keys[i].first) {
+            return false;
+        }
+    }
+    std::vector<ql::datum_t> sorted;
+    sorted.reserve(inserts->size());
+    for (const auto &key : keys) {
+        sorted.push_back(std::move((*inserts)[key.second]));
+    }
+    *inserts = std::move(sorted);
+    return true;
+}
+
 optional<counted_t<const ql::func_t> > real_table_t::get_write_hook(
     ql::env_t *env,
     ignore_write_hook_t ignore_write_hook) {
@@ -304,23 +352,90 @@ ql::datum_t real_table_t::write_batched_insert(
     optional<counted_t<const ql::func_t> > write_hook =
         get_write_hook(env, ignore_write_hook);
 
+    /* Single inserts from concurrent queries can be written together, as long as they
+    don't run functions, which would need their own query's environment. */
+    if (write_coalescer != nullptr
+        && inserts.size() == 1
+        && env->profile() == profile_bool_t::DONT_PROFILE
+        && env->limits().array_size_limit() >= WRITE_COALESCING_MAX_BATCH_SIZE
+        && conflict_behavior != conflict_behavior_t::FUNCTION
+        && !write_hook.has_value()) {
+        write_coalescer_t::spec_t spec;
+        spec.table_id = uuid;
+        spec.user_context = env->get_user_context();
+        spec.durability = durability;
+        spec.conflict_behavior = conflict_behavior;
+        counted_t<real_table_t> self(this);
+        optional<ql::datum_t> res = write_coalescer->insert(
+            env, spec, datum_string_t(pkey), inserts[0], return_changes,
+            [self, conflict_behavior, durability](
+                    ql::env_t *batch_env, std::vector<ql::datum_t> &&docs) {
+                return self->do_batched_insert(
+                    batch_env, std::move(docs), conflict_behavior, r_nullopt,
+                    return_changes_t::ALWAYS, durability, r_nullopt);
+            });
+        if (res.has_value()) {
+            return *res;
+        }
+    }
+    return do_batched_insert(env, std::move(inserts), conflict_behavior,
+                             conflict_func, return_changes, durability, write_hook);
+}
+
+ql::datum_t real_table_t::do_batched_insert(
+        ql::env_t *env,
+        std::vector<ql::datum_t> &&inserts,
+        conflict_behavior_t conflict_behavior,
+        optional<counted_t<const ql::func_t> > conflict_func,
+        return_changes_t return_changes,
+        durability_requirement_t durability,
+        const optional<counted_t<const ql::func_t> > &write_hook) {
+    /* The batches of a large insert, such as the ones from `rethinkdb import`, are
+    written concurrently. They cover disjoint sets of keys, so the outcome doesn't
+    depend on their order. That isn't true if two documents have the same primary
+    key, so then the batches run one after the other. */
+    const bool concurrent = inserts.size() > split_size
+        && env->profile() != profile_bool_t::PROFILE
+        && sort_inserts_by_primary_key(pkey, &inserts);
+    std::vector<std::vector<ql::datum_t> > batches = split(std::move(inserts));
+    std::vector<write_response_t> responses(batches.size());
+    std::vector<std::exception_ptr> errors(batches.size());
+    auto write_batch = [&](int64_t i) {
+        try {
+            batched_insert_t write(
+                std::move(batches[i]),
+                pkey,
+                write_hook,
+                conflict_behavior,
+                conflict_func,
+                env->limits(),
+                env->get_serializable_env(),
+                return_changes);
+            write_t w(std::move(write), durability, env->profile(), env->limits());
+            write_with_profile(env, &w, &responses[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    if (concurrent) {
+        throttled_pmap(batches.size(), write_batch, MAX_CONCURRENT_INSERT_BATCHES);
+    } else {
+        for (size_t i = 0; i < batches.size(); ++i) {
+            write_batch(i);
+            if (errors[i]) {
+                break;
+            }
+        }
+    }
+
+    /* As with a sequential loop, the first failed batch determines the error. */
     ql::datum_t stats((std::map<datum_string_t, ql::datum_t>()));
     std::set<std::string> conditions;
-    std::vector<std::vector<ql::datum_t> > batches = split(std::move(inserts));
-    for (auto &&batch : batches) {
-        batched_insert_t write(
-            std::move(batch),
-            pkey,
-            write_hook,
-            conflict_behavior,
-            conflict_func,
-            env->limits(),
-            env->get_serializable_env(),
-            return_changes);
-        write_t w(std::move(write), durability, env->profile(), env->limits());
-        write_response_t response;
-        write_with_profile(env, &w, &response);
-        auto dp = boost::get<ql::datum_t>(&response.response);
+    for (size_t i = 0; i < batches.size(); ++i) {
+        if (errors[i]) {
+            std::rethrow_exception(errors[i]);
+        }
+        auto dp = boost::get<ql::datum_t>(&responses[i].response);
         r_sanity_check(dp != NULL);
         stats = stats.merge(*dp, ql::stats_merge, env->limits(), &conditions);
     }
@@ -345,9 +460,10 @@ void real_table_t::read_with_profile(ql::env_t *env, const read_t &read,
     PROFILE_STARTER_IF_ENABLED(
         env->profile() == profile_bool_t::PROFILE,
         (read.read_mode == read_mode_t::OUTDATED ? "Perform outdated read." :
+         (read.read_mode == read_mode_t::NEAREST ? "Perform nearest read." :
          (read.read_mode == read_mode_t::DEBUG_DIRECT ? "Perform debug_direct read." :
          (read.read_mode == read_mode_t::SINGLE ? "Perform read." :
-                                                  "Perform majority read."))),
+                                                  "Perform majority read.")))),
         env->trace);
     profile::splitter_t splitter(env->trace);
     /* propagate whether or not we're doing profiles */
@@ -367,6 +483,10 @@ void real_table_t::read_with_profile(ql::env_t *env, const read_t &read,
         rfail_datum(ql::base_exc_t::PERMISSION_ERROR, "%s", error.what());
     }
 
+    if (env->query_stats() != nullptr) {
+        env->query_stats()->add(response->stats);
+    }
+
     /* Append the results of the profile to the current task */
     splitter.give_splits(response->n_shards, response->event_log);
 }
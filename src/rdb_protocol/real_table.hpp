@@ -18,6 +18,7 @@ class client_t;
 }
 }
 class table_meta_client_t;
+class write_coalescer_t;
 
 /* `real_table_t` is a concrete subclass of `base_table_t` that routes its queries across
 the network via the clustering logic to a B-tree. The administration logic is responsible
@@ -35,15 +36,20 @@ public:
             namespace_interface_access_t _namespace_access,
             const std::string &_pkey,
             ql::changefeed::client_t *_changefeed_client,
-            table_meta_client_t *table_meta_client) :
+            table_meta_client_t *table_meta_client,
+            key_generation_t _key_generation = key_generation_t::RANDOM,
+            write_coalescer_t *_write_coalescer = nullptr) :
         uuid(_uuid),
         namespace_access(_namespace_access),
         pkey(_pkey),
+        key_generation(_key_generation),
         changefeed_client(_changefeed_client),
-        m_table_meta_client(table_meta_client) { }
+        m_table_meta_client(table_meta_client),
+        write_coalescer(_write_coalescer) { }
 
     namespace_id_t get_id() const;
     const std::string &get_pkey() const;
+    key_generation_t get_key_generation() const { return key_generation; }
 
     ql::datum_t read_row(ql::env_t *env, ql::datum_t pval, read_mode_t read_mode);
     counted_t<ql::datum_stream_t> read_all(
@@ -119,6 +125,16 @@ public:
     void write_with_profile(ql::env_t *env, write_t *, write_response_t *response);
 
 private:
+    ql::datum_t point_read(ql::env_t *env, const store_key_t &key, read_mode_t read_mode);
+    ql::datum_t do_batched_insert(
+        ql::env_t *env,
+        std::vector<ql::datum_t> &&inserts,
+        conflict_behavior_t conflict_behavior,
+        optional<counted_t<const ql::func_t> > conflict_func,
+        return_changes_t return_changes,
+        durability_requirement_t durability,
+        const optional<counted_t<const ql::func_t> > &write_hook);
+
     optional<counted_t<const ql::func_t> > get_write_hook(
         ql::env_t *env,
         ignore_write_hook_t ignore_write_hook);
@@ -126,8 +142,11 @@ private:
     namespace_id_t uuid;
     namespace_interface_access_t namespace_access;
     std::string pkey;
+    key_generation_t key_generation;
     ql::changefeed::client_t *changefeed_client;
     table_meta_client_t *m_table_meta_client;
+    // Only set with `--coalesce-writes`
+    write_coalescer_t *write_coalescer;
 };
 
 #endif /* RDB_PROTOCOL_REAL_TABLE_HPP_ */
@@ -1,6 +1,8 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/serialize_datum.hpp"
 
+#include <string.h>
+
 #include <cmath>
 #include <functional>
 #include <limits>
@@ -8,14 +10,20 @@
 #include <vector>
 
 #include "arch/runtime/coroutines.hpp"
+#include "config/args.hpp"
 #include "containers/archive/buffer_stream.hpp"
+#include "containers/archive/shared_buf_stream.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "containers/archive/versioned.hpp"
 #include "containers/counted.hpp"
 #include "containers/shared_buffer.hpp"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/error.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
 
 namespace ql {
 
@@ -38,6 +46,10 @@ enum class datum_serialized_type_t {
     UNINITIALIZED = 12,
     MINVAL = 13,
     MAXVAL = 14,
+    // A time that `pseudo::time_to_compact` accepts, stored as its epoch time
+    // (a double) and the offset of its timezone in minutes (an int16_t), instead of
+    // as an object with three fields.  It's deserialized back into the same object.
+    TIME = 15,
 };
 
 // Objects and arrays use different word sizes for storing offsets,
@@ -74,7 +86,7 @@ struct size_tree_node_t {
 
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(datum_serialized_type_t, int8_t,
                                       datum_serialized_type_t::R_ARRAY,
-                                      datum_serialized_type_t::MAXVAL);
+                                      datum_serialized_type_t::TIME);
 
 serialization_result_t datum_serialize(write_message_t *wm,
                                        datum_serialized_type_t type) {
@@ -97,13 +109,27 @@ inline serialization_result_t operator |(const serialization_result_t &first,
 /* Forward declarations */
 size_t datum_serialized_size(const datum_t &datum,
                              check_datum_serialization_errors_t check_errors,
+                             const shared_buf_t *checked_buf,
                              std::vector<size_tree_node_t> *child_sizes_out);
 serialization_result_t datum_serialize(
         write_message_t *wm,
         const datum_t &datum,
         check_datum_serialization_errors_t check_errors,
+        const shared_buf_t *checked_buf,
         const size_tree_node_t &precomputed_size);
 
+// Whether we can copy the existing serialization `buf_ref` of an array or object
+// (which is null if there is none) instead of serializing its elements again.  We
+// have to look at every element to check for errors, unless the serialization is
+// part of `checked_buf`, which has been checked before.
+bool can_reuse_serialization(const shared_buf_ref_t<char> *buf_ref,
+                             check_datum_serialization_errors_t check_errors,
+                             const shared_buf_t *checked_buf) {
+    return buf_ref != NULL
+        && (check_errors == check_datum_serialization_errors_t::NO
+            || (checked_buf != NULL && buf_ref->get_buf().get() == checked_buf));
+}
+
 // Some of the following looks like it duplicates code of other deserialization
 // functions.  It does. Keeping this separate means that we don't have to worry
 // about whether datum serialization has changed from cluster version to cluster
@@ -253,13 +279,13 @@ size_t datum_array_inner_serialized_size(
 // Keep in sync with datum_array_serialize.
 size_t datum_array_serialized_size(const datum_t &datum,
                                    check_datum_serialization_errors_t check_errors,
+                                   const shared_buf_t *checked_buf,
                                    std::vector<size_tree_node_t> *element_sizes_out) {
     size_t sz = 0;
 
     // Can we use an existing serialization?
     const shared_buf_ref_t<char> *existing_buf_ref = datum.get_buf_ref();
-    if (existing_buf_ref != NULL
-        && check_errors == check_datum_serialization_errors_t::NO) {
+    if (can_reuse_serialization(existing_buf_ref, check_errors, checked_buf)) {
 
         // We don't initialize element_sizes_out, but that's ok. We don't need it
         // if there already is a serialization.
@@ -270,7 +296,7 @@ size_t datum_array_serialized_size(const datum_t &datum,
         for (size_t i = 0; i < datum.arr_size(); ++i) {
             auto elem = datum.get(i);
             size_tree_node_t elem_size;
-            elem_size.size = datum_serialized_size(elem, check_errors,
+            elem_size.size = datum_serialized_size(elem, check_errors, checked_buf,
                                                    &elem_size.child_sizes);
             elem_sizes.push_back(std::move(elem_size));
         }
@@ -296,12 +322,12 @@ serialization_result_t datum_array_serialize(
         write_message_t *wm,
         const datum_t &datum,
         check_datum_serialization_errors_t check_errors,
+        const shared_buf_t *checked_buf,
         const size_tree_node_t &precomputed_sizes) {
 
     // Can we use an existing serialization?
     const shared_buf_ref_t<char> *existing_buf_ref = datum.get_buf_ref();
-    if (existing_buf_ref != NULL
-        && check_errors == check_datum_serialization_errors_t::NO) {
+    if (can_reuse_serialization(existing_buf_ref, check_errors, checked_buf)) {
 
         // Subtract 1 for the type byte, which we don't have to rewrite
         wm->append(existing_buf_ref->get(), precomputed_sizes.size - 1);
@@ -323,7 +349,7 @@ serialization_result_t datum_array_serialize(
     for (size_t i = 0; i < datum.arr_size(); ++i) {
         auto elem = datum.get(i);
         const size_tree_node_t &child_size = precomputed_sizes.child_sizes[i];
-        res = res | datum_serialize(wm, elem, check_errors, child_size);
+        res = res | datum_serialize(wm, elem, check_errors, checked_buf, child_size);
     }
 
     return res;
@@ -358,13 +384,13 @@ datum_deserialize(read_stream_t *s, std::vector<datum_t> *v) {
 // Keep in sync with datum_object_serialize.
 size_t datum_object_serialized_size(const datum_t &datum,
                                     check_datum_serialization_errors_t check_errors,
+                                    const shared_buf_t *checked_buf,
                                     std::vector<size_tree_node_t> *child_sizes_out) {
     size_t sz = 0;
 
     // Can we use an existing serialization?
     const shared_buf_ref_t<char> *existing_buf_ref = datum.get_buf_ref();
-    if (existing_buf_ref != NULL
-        && check_errors == check_datum_serialization_errors_t::NO) {
+    if (can_reuse_serialization(existing_buf_ref, check_errors, checked_buf)) {
 
         // We don't initialize element_sizes_out, but that's ok. We don't need it
         // if there already is a serialization.
@@ -378,7 +404,7 @@ size_t datum_object_serialized_size(const datum_t &datum,
             key_size.size = datum_serialized_size(pair.first);
             size_tree_node_t val_size;
             val_size.size = datum_serialized_size(pair.second, check_errors,
-                                                  &val_size.child_sizes);
+                                                  checked_buf, &val_size.child_sizes);
             child_sizes.push_back(std::move(key_size));
             child_sizes.push_back(std::move(val_size));
         }
@@ -404,12 +430,12 @@ serialization_result_t datum_object_serialize(
         write_message_t *wm,
         const datum_t &datum,
         check_datum_serialization_errors_t check_errors,
+        const shared_buf_t *checked_buf,
         const size_tree_node_t &precomputed_sizes) {
 
     // Can we use an existing serialization?
     const shared_buf_ref_t<char> *existing_buf_ref = datum.get_buf_ref();
-    if (existing_buf_ref != NULL
-        && check_errors == check_datum_serialization_errors_t::NO) {
+    if (can_reuse_serialization(existing_buf_ref, check_errors, checked_buf)) {
 
         // Subtract 1 for the type byte, which we don't have to rewrite
         wm->append(existing_buf_ref->get(), precomputed_sizes.size - 1);
@@ -432,7 +458,8 @@ serialization_result_t datum_object_serialize(
         auto pair = datum.get_pair(i);
         const size_tree_node_t &val_size = precomputed_sizes.child_sizes[i*2+1];
         res = res | datum_serialize(wm, pair.first);
-        res = res | datum_serialize(wm, pair.second, check_errors, val_size);
+        res = res | datum_serialize(wm, pair.second, check_errors, checked_buf,
+                                    val_size);
     }
 
     return res;
@@ -474,11 +501,12 @@ MUST_USE archive_result_t datum_deserialize(
 
 size_t datum_serialized_size(const datum_t &datum,
                              check_datum_serialization_errors_t check_errors) {
-    return datum_serialized_size(datum, check_errors, NULL);
+    return datum_serialized_size(datum, check_errors, NULL, NULL);
 }
 
 size_t datum_serialized_size(const datum_t &datum,
                              check_datum_serialization_errors_t check_errors,
+                             const shared_buf_t *checked_buf,
                              std::vector<size_tree_node_t> *child_sizes_out) {
     rassert(child_sizes_out == NULL || child_sizes_out->empty());
     // Update datum_object_serialize() and datum_array_serialize() if the size of
@@ -490,6 +518,7 @@ size_t datum_serialized_size(const datum_t &datum,
         sz += call_with_enough_stack<size_t>([&] () {
                 return datum_array_serialized_size(datum,
                                                    check_errors,
+                                                   checked_buf,
                                                    child_sizes_out);
             }, MIN_DATUM_SERIALIZATION_STACK_SPACE);
     } break;
@@ -510,9 +539,17 @@ size_t datum_serialized_size(const datum_t &datum,
         }
     } break;
     case datum_t::R_OBJECT: {
+        double epoch_time;
+        int16_t tz_minutes;
+        if (pseudo::time_to_compact(datum, &epoch_time, &tz_minutes)) {
+            sz += serialize_universal_size_t<double>::value
+                + serialize_universal_size_t<int16_t>::value;
+            break;
+        }
         sz += call_with_enough_stack<size_t>([&] () {
                 return datum_object_serialized_size(datum,
                                                     check_errors,
+                                                    checked_buf,
                                                     child_sizes_out);
             }, MIN_DATUM_SERIALIZATION_STACK_SPACE);
     } break;
@@ -531,6 +568,7 @@ serialization_result_t datum_serialize(
         write_message_t *wm,
         const datum_t &datum,
         check_datum_serialization_errors_t check_errors,
+        const shared_buf_t *checked_buf,
         const size_tree_node_t &precomputed_size) {
     serialization_result_t res = serialization_result_t::SUCCESS;
 
@@ -548,6 +586,7 @@ serialization_result_t datum_serialize(
                 return datum_array_serialize(wm,
                                              datum,
                                              check_errors,
+                                             checked_buf,
                                              precomputed_size);
             }, MIN_DATUM_SERIALIZATION_STACK_SPACE);
     } break;
@@ -585,11 +624,20 @@ serialization_result_t datum_serialize(
         }
     } break;
     case datum_t::R_OBJECT: {
+        double epoch_time;
+        int16_t tz_minutes;
+        if (pseudo::time_to_compact(datum, &epoch_time, &tz_minutes)) {
+            res = res | datum_serialize(wm, datum_serialized_type_t::TIME);
+            serialize_universal(wm, epoch_time);
+            serialize_universal(wm, tz_minutes);
+            break;
+        }
         res = res | datum_serialize(wm, datum_serialized_type_t::BUF_R_OBJECT);
         res = res | call_with_enough_stack<serialization_result_t>([&] () {
                 return datum_object_serialize(wm,
                                               datum,
                                               check_errors,
+                                              checked_buf,
                                               precomputed_size);
             }, MIN_DATUM_SERIALIZATION_STACK_SPACE);
     } break;
@@ -615,12 +663,43 @@ serialization_result_t datum_serialize(
 serialization_result_t datum_serialize(
         write_message_t *wm,
         const datum_t &datum,
-        check_datum_serialization_errors_t check_errors) {
+        check_datum_serialization_errors_t check_errors,
+        const shared_buf_t *checked_buf) {
     // Precompute serialized sizes
     size_tree_node_t size;
-    size.size = datum_serialized_size(datum, check_errors, &size.child_sizes);
+    size.size = datum_serialized_size(datum, check_errors, checked_buf,
+                                      &size.child_sizes);
 
-    return datum_serialize(wm, datum, check_errors, size);
+    return datum_serialize(wm, datum, check_errors, checked_buf, size);
+}
+
+/* Called after reading the varint size prefix of `size` bytes of data from `s`. If `s`
+reads from a shared buffer and the data is large enough, this points `ref_out` at the
+prefix in that buffer, skips the data and returns `true`. Otherwise the caller has to
+copy the data out of the stream. */
+bool ref_prefixed_data_in_stream(read_stream_t *s,
+                                 uint64_t size,
+                                 shared_buf_ref_t<char> *ref_out) {
+    if (size < DATUM_ZERO_COPY_MIN_SIZE) {
+        return false;
+    }
+    shared_buf_read_stream_t *buf_stream = dynamic_cast<shared_buf_read_stream_t *>(s);
+    if (buf_stream == nullptr || size > buf_stream->remaining()) {
+        return false;
+    }
+    // A non-canonical encoding of the prefix would confuse the `datum_t`, which
+    // decodes it again.
+    uint8_t prefix[10];
+    const size_t prefix_size = serialize_varint_uint64_into_buf(size, prefix);
+    if (buf_stream->tell() < prefix_size
+        || memcmp(buf_stream->get_buf()->data(buf_stream->tell() - prefix_size),
+                  prefix, prefix_size) != 0) {
+        return false;
+    }
+    *ref_out = shared_buf_ref_t<char>(buf_stream->get_buf(),
+                                      buf_stream->tell() - prefix_size);
+    buf_stream->skip(size);
+    return true;
 }
 
 archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum) {
@@ -763,15 +842,20 @@ archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum) {
             return archive_result_t::RANGE_ERROR;
         }
 
-        // Then read the data into a shared_buf_t
-        counted_t<shared_buf_t> buf = shared_buf_t::create(static_cast<size_t>(ser_size) + ser_size_sz);
-        serialize_varint_uint64_into_buf(ser_size, reinterpret_cast<uint8_t *>(buf->data()));
-        int64_t num_read = force_read(s, buf->data() + ser_size_sz, ser_size);
-        if (num_read == -1) {
-            return archive_result_t::SOCK_ERROR;
-        }
-        if (static_cast<uint64_t>(num_read) < ser_size) {
-            return archive_result_t::SOCK_EOF;
+        // Then refer to the data in the stream's buffer, or read it into a
+        // shared_buf_t
+        shared_buf_ref_t<char> buf_ref;
+        if (!ref_prefixed_data_in_stream(s, ser_size, &buf_ref)) {
+            counted_t<shared_buf_t> buf = shared_buf_t::create(static_cast<size_t>(ser_size) + ser_size_sz);
+            serialize_varint_uint64_into_buf(ser_size, reinterpret_cast<uint8_t *>(buf->data()));
+            int64_t num_read = force_read(s, buf->data() + ser_size_sz, ser_size);
+            if (num_read == -1) {
+                return archive_result_t::SOCK_ERROR;
+            }
+            if (static_cast<uint64_t>(num_read) < ser_size) {
+                return archive_result_t::SOCK_EOF;
+            }
+            buf_ref = shared_buf_ref_t<char>(std::move(buf), 0);
         }
 
         // ...from which we create the datum_t
@@ -779,7 +863,7 @@ archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum) {
                                 ? datum_t::R_ARRAY
                                 : datum_t::R_OBJECT;
         try {
-            *datum = datum_t(dtype, shared_buf_ref_t<char>(std::move(buf), 0));
+            *datum = datum_t(dtype, std::move(buf_ref));
         } catch (const base_exc_t &) {
             return archive_result_t::RANGE_ERROR;
         }
@@ -791,6 +875,26 @@ archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum) {
             return archive_result_t::RANGE_ERROR;
         }
     } break;
+    case datum_serialized_type_t::TIME: {
+        double epoch_time;
+        res = deserialize_universal(s, &epoch_time);
+        if (bad(res)) {
+            return res;
+        }
+        int16_t tz_minutes;
+        res = deserialize_universal(s, &tz_minutes);
+        if (bad(res)) {
+            return res;
+        }
+        if (!std::isfinite(epoch_time) || tz_minutes < -5999 || tz_minutes > 5999) {
+            return archive_result_t::RANGE_ERROR;
+        }
+        try {
+            *datum = pseudo::time_from_compact(epoch_time, tz_minutes);
+        } catch (const base_exc_t &) {
+            return archive_result_t::RANGE_ERROR;
+        }
+    } break;
     case datum_serialized_type_t::UNINITIALIZED: {
         *datum = datum_t();
     } break;
@@ -840,6 +944,7 @@ datum_t datum_deserialize_from_buf(const shared_buf_ref_t<char> &buf, size_t at_
     case datum_serialized_type_t::INT_POSITIVE: // fallthru
     case datum_serialized_type_t::MINVAL: // fallthru
     case datum_serialized_type_t::MAXVAL: // fallthru
+    case datum_serialized_type_t::TIME: // fallthru
     case datum_serialized_type_t::UNINITIALIZED: {
         buffer_read_stream_t data_read_stream(buf.get() + at_offset,
                                               buf.get_safety_boundary() - at_offset);
@@ -882,6 +987,56 @@ size_t datum_get_array_size(const shared_buf_ref_t<char> &array) {
     return static_cast<size_t>(num_elements);
 }
 
+size_t offset_serialized_size(datum_offset_size_t offset_size) {
+    switch (offset_size) {
+    case datum_offset_size_t::U8BIT:
+        return serialize_universal_size_t<uint8_t>::value;
+    case datum_offset_size_t::U16BIT:
+        return serialize_universal_size_t<uint16_t>::value;
+    case datum_offset_size_t::U32BIT:
+        return serialize_universal_size_t<uint32_t>::value;
+    case datum_offset_size_t::U64BIT:
+        return serialize_universal_size_t<uint64_t>::value;
+    default:
+        unreachable();
+    }
+}
+
+size_t deserialize_element_offset(read_stream_t *s, datum_offset_size_t offset_size) {
+    uint64_t element_offset;
+    switch (offset_size) {
+    case datum_offset_size_t::U8BIT: {
+        uint8_t off;
+        guarantee_deserialization(deserialize_universal(s, &off),
+                                  "datum decode array offset");
+        element_offset = off;
+    } break;
+    case datum_offset_size_t::U16BIT: {
+        uint16_t off;
+        guarantee_deserialization(deserialize_universal(s, &off),
+                                  "datum decode array offset");
+        element_offset = off;
+    } break;
+    case datum_offset_size_t::U32BIT: {
+        uint32_t off;
+        guarantee_deserialization(deserialize_universal(s, &off),
+                                  "datum decode array offset");
+        element_offset = off;
+    } break;
+    case datum_offset_size_t::U64BIT: {
+        uint64_t off;
+        guarantee_deserialization(deserialize_universal(s, &off),
+                                  "datum decode array offset");
+        element_offset = off;
+    } break;
+    default:
+        unreachable();
+    }
+    guarantee(element_offset <= std::numeric_limits<size_t>::max(),
+              "Datum too large for this architecture.");
+    return static_cast<size_t>(element_offset);
+}
+
 /* The format of `array` is:
      varint ser_size
      varint num_elements
@@ -893,19 +1048,7 @@ size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t inde
     guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &ser_size),
                               "datum decode array");
     const datum_offset_size_t offset_size = get_offset_size_from_inner_size(ser_size);
-    size_t serialized_offset_size;
-    switch (offset_size) {
-    case datum_offset_size_t::U8BIT:
-        serialized_offset_size = serialize_universal_size_t<uint8_t>::value; break;
-    case datum_offset_size_t::U16BIT:
-        serialized_offset_size = serialize_universal_size_t<uint16_t>::value; break;
-    case datum_offset_size_t::U32BIT:
-        serialized_offset_size = serialize_universal_size_t<uint32_t>::value; break;
-    case datum_offset_size_t::U64BIT:
-        serialized_offset_size = serialize_universal_size_t<uint64_t>::value; break;
-    default:
-        unreachable();
-    }
+    const size_t serialized_offset_size = offset_serialized_size(offset_size);
 
     uint64_t num_elements = 0;
     guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &num_elements),
@@ -932,40 +1075,161 @@ size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t inde
             array.get() + element_offset_offset,
             array.get_safety_boundary() - element_offset_offset);
 
-        uint64_t element_offset;
-        switch (offset_size) {
-        case datum_offset_size_t::U8BIT: {
-            uint8_t off;
-            guarantee_deserialization(deserialize_universal(&read_stream, &off),
-                                      "datum decode array offset");
-            element_offset = off;
-        } break;
-        case datum_offset_size_t::U16BIT: {
-            uint16_t off;
-            guarantee_deserialization(deserialize_universal(&read_stream, &off),
-                                      "datum decode array offset");
-            element_offset = off;
-        } break;
-        case datum_offset_size_t::U32BIT: {
-            uint32_t off;
-            guarantee_deserialization(deserialize_universal(&read_stream, &off),
-                                      "datum decode array offset");
-            element_offset = off;
-        } break;
-        case datum_offset_size_t::U64BIT: {
-            uint64_t off;
-            guarantee_deserialization(deserialize_universal(&read_stream, &off),
-                                      "datum decode array offset");
-            element_offset = off;
-        } break;
-        }
-        guarantee(element_offset <= std::numeric_limits<size_t>::max(),
-                  "Datum too large for this architecture.");
-
-        return data_offset + static_cast<size_t>(element_offset);
+        return data_offset + deserialize_element_offset(&read_stream, offset_size);
     }
 }
 
+datum_t datum_get_field_from_buf(const shared_buf_ref_t<char> &object,
+                                 const datum_string_t &key) {
+    buffer_read_stream_t header_stream(object.get(), object.get_safety_boundary());
+    uint64_t ser_size = 0;
+    guarantee_deserialization(deserialize_varint_uint64(&header_stream, &ser_size),
+                              "datum decode object");
+    uint64_t num_elements = 0;
+    guarantee_deserialization(deserialize_varint_uint64(&header_stream, &num_elements),
+                              "datum decode object");
+    if (num_elements == 0) {
+        return datum_t();
+    }
+
+    const datum_offset_size_t offset_size = get_offset_size_from_inner_size(ser_size);
+    const size_t serialized_offset_size = offset_serialized_size(offset_size);
+    const size_t table_offset = static_cast<size_t>(header_stream.tell());
+    const size_t data_offset =
+        table_offset + (num_elements - 1) * serialized_offset_size;
+    object.guarantee_in_boundary(data_offset);
+
+    uint64_t range_beg = 0;
+    uint64_t range_end = num_elements;
+    while (range_beg < range_end) {
+        const uint64_t center = range_beg + ((range_end - range_beg) / 2);
+        size_t pair_offset = data_offset;
+        if (center > 0) {
+            const size_t entry_offset =
+                table_offset + (center - 1) * serialized_offset_size;
+            buffer_read_stream_t entry_stream(
+                object.get() + entry_offset,
+                object.get_safety_boundary() - entry_offset);
+            pair_offset += deserialize_element_offset(&entry_stream, offset_size);
+        }
+
+        // Compare the key where it is, rather than constructing a `datum_string_t`.
+        object.guarantee_in_boundary(pair_offset);
+        buffer_read_stream_t key_stream(object.get() + pair_offset,
+                                        object.get_safety_boundary() - pair_offset);
+        uint64_t key_size = 0;
+        guarantee_deserialization(deserialize_varint_uint64(&key_stream, &key_size),
+                                  "datum decode object key");
+        const size_t key_offset = pair_offset + static_cast<size_t>(key_stream.tell());
+        object.guarantee_in_boundary(key_offset + key_size);
+        const int cmp_res = key.compare(key_size, object.get() + key_offset);
+        if (cmp_res == 0) {
+            return datum_deserialize_from_buf(object, key_offset + key_size);
+        } else if (cmp_res < 0) {
+            range_end = center;
+        } else {
+            range_beg = center + 1;
+        }
+    }
+    return datum_t();
+}
+
+// The most bytes that a serialized varint can take up.
+const int64_t MAX_VARINT_SERIALIZED_SIZE = 10;
+
+bool datum_get_field_from_serialized(
+        int64_t serialized_size,
+        const std::function<void(int64_t, int64_t, char *)> &read_region,
+        const datum_string_t &key,
+        datum_t *field_out) {
+    // Reads up to `max_size` bytes at `offset`, stopping at the end of the datum.
+    auto read_at_most = [&](int64_t offset, int64_t max_size, std::vector<char> *out) {
+        guarantee(offset <= serialized_size);
+        out->resize(std::min(max_size, serialized_size - offset));
+        read_region(offset, out->size(), out->data());
+    };
+
+    // The type tag, followed by the format described above `datum_get_element_offset`.
+    std::vector<char> header;
+    read_at_most(0, 1 + 2 * MAX_VARINT_SERIALIZED_SIZE, &header);
+    buffer_read_stream_t header_stream(header.data(), header.size());
+    datum_serialized_type_t type;
+    guarantee_deserialization(datum_deserialize(&header_stream, &type), "datum type");
+    if (type != datum_serialized_type_t::BUF_R_OBJECT) {
+        return false;
+    }
+    uint64_t ser_size = 0;
+    guarantee_deserialization(deserialize_varint_uint64(&header_stream, &ser_size),
+                              "datum decode object");
+    const int64_t end_offset = header_stream.tell() + ser_size;
+    uint64_t num_elements = 0;
+    guarantee_deserialization(deserialize_varint_uint64(&header_stream, &num_elements),
+                              "datum decode object");
+    guarantee(end_offset <= serialized_size);
+
+    *field_out = datum_t();
+    if (num_elements == 0) {
+        return true;
+    }
+
+    const datum_offset_size_t offset_size = get_offset_size_from_inner_size(ser_size);
+    const int64_t serialized_offset_size = offset_serialized_size(offset_size);
+    const int64_t table_offset = header_stream.tell();
+    const int64_t data_offset =
+        table_offset + (num_elements - 1) * serialized_offset_size;
+    auto element_offset = [&](uint64_t index) -> int64_t {
+        if (index == 0) {
+            return data_offset;
+        }
+        std::vector<char> buf;
+        read_at_most(table_offset + (index - 1) * serialized_offset_size,
+                     serialized_offset_size, &buf);
+        buffer_read_stream_t read_stream(buf.data(), buf.size());
+        return data_offset + deserialize_element_offset(&read_stream, offset_size);
+    };
+
+    // Same binary search as in `datum_t::get_field`, except that we only read the
+    // keys that it visits.
+    uint64_t range_beg = 0;
+    uint64_t range_end = num_elements;
+    while (range_beg < range_end) {
+        const uint64_t center = range_beg + ((range_end - range_beg) / 2);
+        const int64_t pair_offset = element_offset(center);
+
+        std::vector<char> buf;
+        read_at_most(pair_offset, MAX_VARINT_SERIALIZED_SIZE, &buf);
+        buffer_read_stream_t key_size_stream(buf.data(), buf.size());
+        uint64_t key_size = 0;
+        guarantee_deserialization(deserialize_varint_uint64(&key_size_stream, &key_size),
+                                  "datum decode object key");
+        const int64_t key_offset = pair_offset + key_size_stream.tell();
+        guarantee(key_offset + key_size <= static_cast<uint64_t>(end_offset));
+        read_at_most(key_offset, key_size, &buf);
+
+        const int cmp_res = key.compare(datum_string_t(buf.size(), buf.data()));
+        if (cmp_res == 0) {
+            const int64_t value_offset = key_offset + key_size;
+            const int64_t value_end = center + 1 < num_elements
+                ? element_offset(center + 1)
+                : end_offset;
+            guarantee(value_offset < value_end);
+            counted_t<shared_buf_t> value_buf = shared_buf_t::create(
+                static_cast<size_t>(value_end - value_offset));
+            read_region(value_offset, value_end - value_offset, value_buf->data());
+            *field_out = datum_deserialize_from_buf(
+                shared_buf_ref_t<char>(std::move(value_buf), 0), 0);
+            return true;
+        } else if (cmp_res < 0) {
+            range_end = center;
+        } else {
+            range_beg = center + 1;
+        }
+    }
+
+    // Didn't find it
+    return true;
+}
+
 size_t datum_serialized_size(const datum_string_t &s) {
     const size_t s_size = s.size();
     return varint_uint64_serialized_size(s_size) + s_size;
@@ -989,6 +1253,25 @@ MUST_USE archive_result_t datum_deserialize(
         return archive_result_t::RANGE_ERROR;
     }
 
+    shared_buf_ref_t<char> buf_ref;
+    if (ref_prefixed_data_in_stream(s, sz, &buf_ref)) {
+        *out = datum_string_t(std::move(buf_ref));
+        return archive_result_t::SUCCESS;
+    }
+
+    if (sz <= datum_string_t::MAX_INLINE_SIZE) {
+        char data[datum_string_t::MAX_INLINE_SIZE];
+        int64_t num_read = force_read(s, data, sz);
+        if (num_read == -1) {
+            return archive_result_t::SOCK_ERROR;
+        }
+        if (static_cast<uint64_t>(num_read) < sz) {
+            return archive_result_t::SOCK_EOF;
+        }
+        *out = datum_string_t(sz, data);
+        return archive_result_t::SUCCESS;
+    }
+
     const size_t str_offset = varint_uint64_serialized_size(sz);
     counted_t<shared_buf_t> buf =
         shared_buf_t::create(str_offset + static_cast<size_t>(sz));
@@ -1006,4 +1289,162 @@ MUST_USE archive_result_t datum_deserialize(
     return archive_result_t::SUCCESS;
 }
 
+template <class json_writer_t>
+size_t write_json_from_serialized_container(const shared_buf_ref_t<char> &buf,
+                                            size_t offset,
+                                            bool is_object,
+                                            json_writer_t *writer);
+
+// Writes the serialized datum at `offset` in `buf` as JSON, and returns the offset
+// right after it.  Needs to produce the same output as `datum_t::write_json()`.
+template <class json_writer_t>
+size_t write_json_from_serialized_datum(const shared_buf_ref_t<char> &buf,
+                                        size_t offset,
+                                        json_writer_t *writer) {
+    buf.guarantee_in_boundary(offset);
+    buffer_read_stream_t s(buf.get() + offset, buf.get_safety_boundary() - offset);
+    datum_serialized_type_t type = datum_serialized_type_t::R_NULL;
+    guarantee_deserialization(datum_deserialize(&s, &type), "datum type from buf");
+
+    switch (type) {
+    case datum_serialized_type_t::R_NULL: {
+        writer->Null();
+    } break;
+    case datum_serialized_type_t::R_BOOL: {
+        bool value;
+        guarantee_deserialization(deserialize_universal(&s, &value), "datum bool");
+        writer->Bool(value);
+    } break;
+    case datum_serialized_type_t::DOUBLE: {
+        double value;
+        guarantee_deserialization(deserialize_universal(&s, &value), "datum double");
+        int64_t i;
+        if (!(value == 0.0 && std::signbit(value)) && number_as_integer(value, &i)) {
+            writer->Int64(i);
+        } else {
+            writer->Double(value);
+        }
+    } break;
+    case datum_serialized_type_t::INT_NEGATIVE: // fallthru
+    case datum_serialized_type_t::INT_POSITIVE: {
+        uint64_t value;
+        guarantee_deserialization(deserialize_varint_uint64(&s, &value), "datum int");
+        guarantee(value <= max_dbl_int);
+        if (type == datum_serialized_type_t::INT_POSITIVE) {
+            writer->Int64(static_cast<int64_t>(value));
+        } else if (value == 0) {
+            // `datum_t::write_json()` prints -0.0 as a double.
+            writer->Double(-0.0);
+        } else {
+            writer->Int64(-static_cast<int64_t>(value));
+        }
+    } break;
+    case datum_serialized_type_t::R_STR: {
+        uint64_t size;
+        guarantee_deserialization(deserialize_varint_uint64(&s, &size), "datum string");
+        const size_t data_offset = offset + static_cast<size_t>(s.tell());
+        guarantee(size <= buf.get_safety_boundary() - data_offset);
+        writer->String(buf.get() + data_offset, size);
+        return data_offset + size;
+    }
+    case datum_serialized_type_t::BUF_R_ARRAY: // fallthru
+    case datum_serialized_type_t::BUF_R_OBJECT: {
+        const size_t container_offset = offset + static_cast<size_t>(s.tell());
+        return call_with_enough_stack<size_t>([&] () {
+                return write_json_from_serialized_container(
+                    buf, container_offset,
+                    type == datum_serialized_type_t::BUF_R_OBJECT, writer);
+            }, MIN_DATUM_SERIALIZATION_STACK_SPACE);
+    }
+    case datum_serialized_type_t::R_ARRAY: // fallthru
+    case datum_serialized_type_t::R_OBJECT: // fallthru
+    case datum_serialized_type_t::R_BINARY: // fallthru
+    case datum_serialized_type_t::MINVAL: // fallthru
+    case datum_serialized_type_t::MAXVAL: // fallthru
+    case datum_serialized_type_t::TIME: // fallthru
+    case datum_serialized_type_t::UNINITIALIZED: {
+        // These are rare enough (or need the error from `write_json()`, or, for
+        // times, their fields spelled out) that we just go through a `datum_t`.
+        buffer_read_stream_t datum_stream(buf.get() + offset,
+                                          buf.get_safety_boundary() - offset);
+        datum_t datum;
+        guarantee_deserialization(datum_deserialize(&datum_stream, &datum),
+                                  "datum from buf");
+        datum.write_json(writer);
+        return offset + static_cast<size_t>(datum_stream.tell());
+    }
+    default:
+        unreachable();
+    }
+    return offset + static_cast<size_t>(s.tell());
+}
+
+// `offset` points to the serialized size of the array or object, right after the type.
+// See `datum_get_element_offset` for the format.
+template <class json_writer_t>
+size_t write_json_from_serialized_container(const shared_buf_ref_t<char> &buf,
+                                            size_t offset,
+                                            bool is_object,
+                                            json_writer_t *writer) {
+    buf.guarantee_in_boundary(offset);
+    buffer_read_stream_t s(buf.get() + offset, buf.get_safety_boundary() - offset);
+    uint64_t ser_size = 0;
+    guarantee_deserialization(deserialize_varint_uint64(&s, &ser_size),
+                              "datum decode container");
+    const size_t end_offset = offset + static_cast<size_t>(s.tell()) + ser_size;
+    uint64_t num_elements = 0;
+    guarantee_deserialization(deserialize_varint_uint64(&s, &num_elements),
+                              "datum decode container");
+
+    // The elements are stored one after the other, so we can skip the offset table.
+    size_t pos = offset + static_cast<size_t>(s.tell());
+    if (num_elements > 0) {
+        pos += (num_elements - 1)
+            * offset_serialized_size(get_offset_size_from_inner_size(ser_size));
+    }
+
+    if (is_object) {
+        writer->StartObject();
+    } else {
+        writer->StartArray();
+    }
+    for (uint64_t i = 0; i < num_elements; ++i) {
+        if (is_object) {
+            buf.guarantee_in_boundary(pos);
+            buffer_read_stream_t key_stream(buf.get() + pos,
+                                            buf.get_safety_boundary() - pos);
+            uint64_t key_size;
+            guarantee_deserialization(deserialize_varint_uint64(&key_stream, &key_size),
+                                      "datum decode object key");
+            pos += static_cast<size_t>(key_stream.tell());
+            guarantee(key_size <= buf.get_safety_boundary() - pos);
+            writer->Key(buf.get() + pos, key_size);
+            pos += key_size;
+        }
+        pos = write_json_from_serialized_datum(buf, pos, writer);
+    }
+    if (is_object) {
+        writer->EndObject();
+    } else {
+        writer->EndArray();
+    }
+    guarantee(pos == end_offset);
+    return end_offset;
+}
+
+template <class json_writer_t>
+void datum_write_json_from_buf(const shared_buf_ref_t<char> &buf,
+                               bool is_object,
+                               json_writer_t *writer) {
+    write_json_from_serialized_container(buf, 0, is_object, writer);
+}
+
+// Explicit instantiation
+template void datum_write_json_from_buf(
+    const shared_buf_ref_t<char> &buf, bool is_object,
+    rapidjson::Writer<rapidjson::StringBuffer> *writer);
+template void datum_write_json_from_buf(
+    const shared_buf_ref_t<char> &buf, bool is_object,
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> *writer);
+
 }  // namespace ql
@@ -1,6 +1,7 @@
 #ifndef RDB_PROTOCOL_SERIALIZE_DATUM_HPP_
 #define RDB_PROTOCOL_SERIALIZE_DATUM_HPP_
 
+#include <functional>
 #include <utility>
 
 #include "containers/archive/archive.hpp"
@@ -45,8 +46,12 @@ enum class check_datum_serialization_errors_t { YES, NO };
 // the FAQ at the end of this file.
 size_t datum_serialized_size(const datum_t &datum,
                              check_datum_serialization_errors_t check_errors);
+// Arrays and objects that are still stored in `checked_buf` (typically the old
+// version of a row that's being rewritten) are known to be free of errors, so their
+// serialization gets copied as it is even if `check_errors` is `YES`.
 serialization_result_t datum_serialize(write_message_t *wm, const datum_t &datum,
-                                       check_datum_serialization_errors_t check_errors);
+                                       check_datum_serialization_errors_t check_errors,
+                                       const shared_buf_t *checked_buf = nullptr);
 archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum);
 
 datum_t datum_deserialize_from_buf(const shared_buf_ref_t<char> &buf, size_t at_offset);
@@ -57,6 +62,33 @@ std::pair<datum_string_t, datum_t> datum_deserialize_pair_from_buf(
 size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t index);
 // Reads the number of elements in the array stored in the buffer
 size_t datum_get_array_size(const shared_buf_ref_t<char> &array);
+// Looks up a field of the object stored in the buffer, returning an empty datum if
+// there is no such field.  Keys are compared in place, and only the value that is
+// found gets deserialized.
+datum_t datum_get_field_from_buf(const shared_buf_ref_t<char> &object,
+                                 const datum_string_t &key);
+
+// Looks up the field `key` of a serialized object without needing all of it in
+// memory.  `read_region(offset, size, out)` must copy `size` bytes of the serialized
+// datum, starting at `offset`, into `out`; only the object's header, the parts of its
+// offset table and keys that the lookup visits, and the field's value get read.
+// Returns false if the datum isn't an object that can be read like that, in which
+// case the caller has to deserialize all of it.  Otherwise returns true and sets
+// `*field_out` to the field, or to an empty datum if the object doesn't have it.
+bool datum_get_field_from_serialized(
+        int64_t serialized_size,
+        const std::function<void(int64_t, int64_t, char *)> &read_region,
+        const datum_string_t &key,
+        datum_t *field_out);
+
+// Writes the serialized array or object that `buf` refers to (as returned by
+// `datum_t::get_buf_ref()`) as JSON, the same way as `datum_t::write_json()`.  Reads
+// the elements straight out of the buffer instead of constructing a `datum_t` for
+// each of them.
+template <class json_writer_t>
+void datum_write_json_from_buf(const shared_buf_ref_t<char> &buf,
+                               bool is_object,
+                               json_writer_t *writer);
 
 size_t datum_serialized_size(const datum_string_t &s);
 serialization_result_t datum_serialize(write_message_t *wm, const datum_string_t &s);
@@ -5,7 +5,8 @@
 
 inline ql::serialization_result_t
 datum_serialize_onto_blob(buf_parent_t parent, blob_t *blob,
-                          const ql::datum_t &value) {
+                          const ql::datum_t &value,
+                          const shared_buf_t *checked_buf = nullptr) {
     // We still make an unnecessary copy: serializing to a write_message_t instead of
     // directly onto the stream.  (However, don't be so sure it would be more
     // efficient to serialize onto an abstract stream type -- you've got a whole
@@ -13,10 +14,11 @@ datum_serialize_onto_blob(buf_parent_t parent, blob_t *blob,
     // abstract stream type already, so what's the big deal?)
     write_message_t wm;
     // Check for errors to enforce the static array size limit when writing
-    // to disk
+    // to disk, except in the parts of `value` that are still stored in
+    // `checked_buf`.
     ql::serialization_result_t res =
         datum_serialize(&wm, value,
-                        ql::check_datum_serialization_errors_t::YES);
+                        ql::check_datum_serialization_errors_t::YES, checked_buf);
     if (bad(res)) return res;
     write_onto_blob(parent, blob, wm);
     return res;
@@ -1,12 +1,23 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/shards.hpp"
 
+#include <string.h>
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "errors.hpp"
 #include <boost/variant.hpp>
 
+#include "arch/runtime/work_stealing.hpp"
+#include "concurrency/pmap.hpp"
+#include "config/args.hpp"
 #include "debug.hpp"
+#include "rdb_protocol/batch_expr.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/profile.hpp"
 #include "rdb_protocol/protocol.hpp"
@@ -67,6 +78,41 @@ void dprint(const char *s, const datum_t &t) {
 }
 #endif // NDEBUG
 
+bool encode_group_key(const datum_t &key, std::string *out) {
+    if (!key.has()) {
+        out->assign(1, 'u');
+        return true;
+    }
+    switch (key.get_type()) {
+    case datum_t::R_NULL:
+        out->assign(1, 'n');
+        return true;
+    case datum_t::R_BOOL:
+        out->assign(1, key.as_bool() ? 't' : 'f');
+        return true;
+    case datum_t::R_NUM: {
+        double num = key.as_num();
+        if (num == 0) {
+            // Turns -0.0 into 0.0, which compares equal to it.
+            num = 0;
+        }
+        char buf[sizeof(double)];
+        memcpy(buf, &num, sizeof(double));
+        out->assign(1, 'd');
+        out->append(buf, sizeof(double));
+        return true;
+    }
+    case datum_t::R_STR: {
+        const datum_string_t &str = key.as_str();
+        out->assign(1, 's');
+        out->append(str.data(), str.size());
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
 template<class T>
 class grouped_acc_t : public accumulator_t {
 protected:
@@ -78,6 +124,37 @@ protected:
         *out = grouped_t<T>();
         boost::get<grouped_t<T> >(*out).swap(acc);
         guarantee(acc.size() == 0);
+        group_index.clear();
+    }
+
+    /* Returns the entry of `acc` for `key`, inserting the default value if there is
+    none yet, and whether it got inserted.  Grouping on a high-cardinality field calls
+    this for every row, so keys with a compact encoding are looked up in
+    `group_index` instead of through a chain of full datum comparisons. */
+    std::pair<typename grouped_t<T>::iterator, bool> find_or_insert_group(
+            const datum_t &key) {
+        std::string encoded;
+        if (!encode_group_key(key, &encoded)) {
+            return acc.insert(std::make_pair(key, default_val));
+        }
+        auto index_it = group_index.find(encoded);
+        if (index_it != group_index.end()) {
+            return std::make_pair(index_it->second, false);
+        }
+        auto res = acc.insert(std::make_pair(key, default_val));
+        group_index.insert(std::make_pair(std::move(encoded), res.first));
+        return res;
+    }
+    void erase_group(typename grouped_t<T>::iterator it) {
+        std::string encoded;
+        if (encode_group_key(it->first, &encoded)) {
+            group_index.erase(encoded);
+        }
+        acc.erase(it);
+    }
+    void clear_groups() {
+        group_index.clear();
+        acc.clear();
     }
 private:
     virtual continue_bool_t operator()(
@@ -86,14 +163,14 @@ private:
             const store_key_t &key,
             const std::function<datum_t()> &lazy_sindex_val) {
         for (auto it = groups->begin(); it != groups->end(); ++it) {
-            auto pair = acc.insert(std::make_pair(it->first, default_val));
+            auto pair = find_or_insert_group(it->first);
             auto t_it = pair.first;
             bool keep = !pair.second;
             for (auto el = it->second.begin(); el != it->second.end(); ++el) {
                 keep |= accumulate(env, *el, &t_it->second, key, lazy_sindex_val);
             }
             if (!keep) {
-                acc.erase(t_it);
+                erase_group(t_it);
             }
         }
         return should_send_batch() ? continue_bool_t::ABORT : continue_bool_t::CONTINUE;
@@ -106,21 +183,61 @@ private:
 
     virtual bool should_send_batch() = 0;
 
+    /* Every shard's groups are sorted by the same comparator, so we merge them like
+    sorted runs instead of collecting them in another map first.  A heap holds the
+    next group of every shard, and each group's results are combined and freed before
+    the next group is looked at.  With a great many groups this takes
+    O(groups * log(shards)) comparisons, and the groups are only held about once. */
     virtual void unshard(env_t *env, const std::vector<result_t *> &results) {
         guarantee(acc.size() == 0);
-        std::map<datum_t, std::vector<T *>, optional_datum_less_t> vecs;
         r_sanity_check(results.size() != 0);
+        typedef std::pair<typename grouped_t<T>::iterator, grouped_t<T> *> run_t;
+        std::vector<run_t> runs;
         for (auto res = results.begin(); res != results.end(); ++res) {
             guarantee(*res);
             grouped_t<T> *gres = boost::get<grouped_t<T> >(*res);
             guarantee(gres);
-            for (auto kv = gres->begin(); kv != gres->end(); ++kv) {
-                vecs[kv->first].push_back(&kv->second);
+            if (gres->size() != 0) {
+                runs.push_back(std::make_pair(gres->begin(), gres));
             }
         }
-        for (auto kv = vecs.begin(); kv != vecs.end(); ++kv) {
-            auto t_it = acc.insert(std::make_pair(kv->first, default_val)).first;
-            unshard_impl(env, &t_it->second, kv->second);
+        const optional_datum_less_t less;
+        // The heap functions keep the greatest element on top, so this puts the run
+        // with the smallest next group there.
+        auto later = [&](const run_t &a, const run_t &b) {
+            return less(b.first->first, a.first->first);
+        };
+        std::make_heap(runs.begin(), runs.end(), later);
+        std::vector<T *> ts;
+        while (!runs.empty()) {
+            // Pop the runs whose next group is the smallest to the back of `runs`.
+            size_t heap_size = runs.size();
+            std::pop_heap(runs.begin(), runs.begin() + heap_size, later);
+            --heap_size;
+            const datum_t group = runs[heap_size].first->first;
+            while (heap_size > 0 && !less(group, runs[0].first->first)) {
+                std::pop_heap(runs.begin(), runs.begin() + heap_size, later);
+                --heap_size;
+            }
+            ts.clear();
+            for (size_t i = heap_size; i < runs.size(); ++i) {
+                ts.push_back(&runs[i].first->second);
+            }
+            // The groups come in order, so they all go at the end.
+            auto t_it = acc.get_underlying_map()->insert(
+                acc.end(), std::make_pair(group, default_val));
+            unshard_impl(env, &t_it->second, ts);
+
+            for (size_t i = heap_size; i < runs.size(); ++i) {
+                run_t run = runs[i];
+                run.first = run.second->get_underlying_map()->erase(run.first);
+                if (run.first != run.second->end()) {
+                    runs[heap_size] = run;
+                    ++heap_size;
+                    std::push_heap(runs.begin(), runs.begin() + heap_size, later);
+                }
+            }
+            runs.resize(heap_size);
         }
     }
     virtual void unshard_impl(env_t *env, T *acc, const std::vector<T *> &ts) = 0;
@@ -131,6 +248,9 @@ protected:
 private:
     const T default_val;
     grouped_t<T> acc;
+    // Points into `acc`.  Entries of `acc` that get inserted without going through
+    // `find_or_insert_group` just don't have an entry here.
+    std::unordered_map<std::string, typename grouped_t<T>::iterator> group_index;
 };
 
 class append_t : public grouped_acc_t<stream_t> {
@@ -512,17 +632,15 @@ protected:
     explicit terminal_t(T &&t) : grouped_acc_t<T>(std::move(t)) { }
 private:
     virtual void operator()(env_t *env, groups_t *groups) {
-        grouped_t<T> *_acc = grouped_acc_t<T>::get_acc();
-        const T *_default_val = grouped_acc_t<T>::get_default_val();
         for (auto it = groups->begin(); it != groups->end(); ++it) {
-            auto pair = _acc->insert(std::make_pair(it->first, *_default_val));
+            auto pair = grouped_acc_t<T>::find_or_insert_group(it->first);
             auto t_it = pair.first;
             bool keep = !pair.second;
             for (auto el = it->second.begin(); el != it->second.end(); ++el) {
                 keep |= accumulate(env, *el, &t_it->second);
             }
             if (!keep) {
-                _acc->erase(t_it);
+                grouped_acc_t<T>::erase_group(t_it);
             }
         }
         groups->clear();
@@ -551,7 +669,7 @@ private:
             r_sanity_check(_acc->size() == 1 && !_acc->begin()->first.has());
             retval = make_scoped<val_t>(unpack(&_acc->begin()->second), bt);
         }
-        _acc->clear();
+        grouped_acc_t<T>::clear_groups();
         return retval;
     }
     virtual datum_t unpack(T *t) = 0;
@@ -806,6 +924,76 @@ private:
     counted_t<const func_t> f;
 };
 
+/* Keeps the first `n` rows of every group in the order of the comparisons.  Rows
+are buffered until there are `2 * n` of them, and then the buffer is sorted (stably,
+so that ties come out the way the full sort would return them) and cut down to `n`.
+The accumulator hooks that don't get an `env_t` need one to call the comparison
+functions, so we remember the one from the last call that did. */
+class top_k_terminal_t : public terminal_t<datums_t> {
+public:
+    explicit top_k_terminal_t(const top_k_wire_func_t &f)
+        : terminal_t<datums_t>(datums_t()),
+          lt_cmp(f.compile_comparisons()),
+          n(f.n),
+          bt(f.bt),
+          env(nullptr) {
+        guarantee(n > 0);
+    }
+private:
+    void finish_impl(continue_bool_t last_cb, result_t *out) final {
+        // Every shard sends back at most `n` rows per group.
+        for (auto &&pair : *get_acc()) {
+            compact(&pair.second);
+        }
+        grouped_acc_t<datums_t>::finish_impl(last_cb, out);
+    }
+    virtual bool accumulate(env_t *_env,
+                            const datum_t &el,
+                            datums_t *out) {
+        env = _env;
+        out->push_back(el);
+        if (out->size() >= 2 * n) {
+            compact(out);
+        }
+        return true;
+    }
+    virtual datum_t unpack(datums_t *rows) {
+        compact(rows);
+        return datum_t(std::move(*rows), configured_limits_t::unlimited);
+    }
+    virtual void unshard_impl(env_t *_env, datums_t *out, datums_t *el) {
+        env = _env;
+        out->reserve(out->size() + el->size());
+        for (auto &&row : *el) {
+            out->push_back(std::move(row));
+        }
+        if (out->size() >= 2 * n) {
+            compact(out);
+        }
+    }
+    void compact(datums_t *rows) {
+        if (rows->size() <= 1) {
+            return;
+        }
+        r_sanity_check(env != nullptr);
+        try {
+            std::stable_sort(
+                rows->begin(), rows->end(),
+                std::bind(lt_cmp, env, nullptr, ph::_1, ph::_2));
+        } catch (const datum_exc_t &e) {
+            throw exc_t(e, bt);
+        }
+        if (rows->size() > n) {
+            rows->resize(n);
+        }
+    }
+
+    lt_cmp_t lt_cmp;
+    uint64_t n;
+    backtrace_id_t bt;
+    env_t *env;
+};
+
 template<class T>
 class terminal_visitor_t : public boost::static_visitor<T *> {
 public:
@@ -827,6 +1015,9 @@ public:
     T *operator()(const reduce_wire_func_t &f) const {
         return new reduce_terminal_t(f);
     }
+    T *operator()(const top_k_wire_func_t &f) const {
+        return new top_k_terminal_t(f);
+    }
     T *operator()(const limit_read_t &lr) const {
         return new limit_append_t(
             lr.is_primary,
@@ -980,22 +1171,85 @@ private:
     backtrace_id_t bt;
 };
 
+// Puts the results of the rows that can be evaluated all at once, either by `batch_f`
+// or by `f` itself, into `results_out`.  Profiling wants to see every term being
+// evaluated, so it gets the row-at-a-time path.
+void eval_batch(env_t *env,
+                const counted_t<const func_t> &f,
+                const scoped_ptr_t<batch_expr_t> &batch_f,
+                const datums_t &rows,
+                datums_t *results_out) {
+    if (env->profile() == profile_bool_t::PROFILE) {
+        return;
+    }
+    if (batch_f.has()) {
+        // `batch_expr_t::eval()` doesn't touch anything but the rows and the arena,
+        // so another thread may run it while we wait.
+        if (rows.size() >= WORK_STEALING_MIN_ITEMS) {
+            run_stealable([&]() { batch_f->eval(rows, results_out, env->arena()); });
+        } else {
+            batch_f->eval(rows, results_out, env->arena());
+        }
+    } else if (rows.size() > 1) {
+        f->call_batch(env, rows, results_out);
+    }
+}
+
+/* Calls `fn(i)` for every `i` below `n`.  If `f` spends its time waiting on `r.http`
+requests, the calls overlap, each in its own coroutine.  Exceptions get rethrown once
+all calls are done, the one for the lowest `i` first, so the error is the same as
+with a sequential loop (although calls on later rows may have happened already). */
+template <class callable_t>
+void call_on_rows(env_t *env,
+                  const counted_t<const func_t> &f,
+                  size_t n,
+                  const callable_t &fn) {
+    if (n <= 1
+        || !f->waits_on_external_calls()
+        || env->profile() == profile_bool_t::PROFILE) {
+        for (size_t i = 0; i < n; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    std::vector<std::exception_ptr> errors(n);
+    throttled_pmap(n, [&](int64_t i) {
+        try {
+            fn(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    }, MAX_CONCURRENT_EXTERNAL_FUNC_CALLS);
+    for (const auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
 class map_trans_t : public ungrouped_op_t {
 public:
     explicit map_trans_t(const map_wire_func_t &_f)
-        : f(_f.compile_wire_func()) { }
+        : f(_f.compile_wire_func()), batch_f(f->make_batch_expr()) { }
 private:
     virtual void lst_transform(
         env_t *env, datums_t *lst, const std::function<datum_t()> &) {
+        datums_t batch_results;
+        eval_batch(env, f, batch_f, *lst, &batch_results);
         try {
-            for (auto it = lst->begin(); it != lst->end(); ++it) {
-                *it = f->call(env, *it)->as_datum();
-            }
+            call_on_rows(env, f, lst->size(), [&](size_t i) {
+                if (i < batch_results.size() && batch_results[i].has()) {
+                    (*lst)[i] = std::move(batch_results[i]);
+                } else {
+                    (*lst)[i] = f->call(env, (*lst)[i])->as_datum();
+                }
+            });
         } catch (const datum_exc_t &e) {
             throw exc_t(e, f->backtrace(), 1);
         }
     }
     counted_t<const func_t> f;
+    scoped_ptr_t<batch_expr_t> batch_f;
 };
 
 // Note: this removes duplicates ONLY TO SAVE NETWORK TRAFFIC.  It's possible
@@ -1036,25 +1290,34 @@ public:
         : f(_f.filter_func.compile_wire_func()),
           default_val(_f.default_filter_val.has_value()
                       ? _f.default_filter_val->compile_wire_func()
-                      : counted_t<const func_t>()) { }
+                      : counted_t<const func_t>()),
+          batch_f(f->make_batch_expr()) { }
 private:
     virtual void lst_transform(
         env_t *env, datums_t *lst, const std::function<datum_t()> &) {
-        auto it = lst->begin();
-        auto loc = it;
+        datums_t batch_results;
+        eval_batch(env, f, batch_f, *lst, &batch_results);
+        std::vector<char> keep(lst->size());
         try {
-            for (it = lst->begin(); it != lst->end(); ++it) {
-                if (f->filter_call(env, *it, default_val)) {
-                    std::swap(*loc, *it);
-                    ++loc;
-                }
-            }
+            call_on_rows(env, f, lst->size(), [&](size_t i) {
+                keep[i] = i < batch_results.size() && batch_results[i].has()
+                    ? batch_results[i].as_bool()
+                    : f->filter_call(env, (*lst)[i], default_val);
+            });
         } catch (const datum_exc_t &e) {
             throw exc_t(e, f->backtrace(), 1);
         }
+        auto loc = lst->begin();
+        for (auto it = lst->begin(); it != lst->end(); ++it) {
+            if (keep[it - lst->begin()]) {
+                std::swap(*loc, *it);
+                ++loc;
+            }
+        }
         lst->erase(loc, lst->end());
     }
     counted_t<const func_t> f, default_val;
+    scoped_ptr_t<batch_expr_t> batch_f;
 };
 
 class concatmap_trans_t : public ungrouped_op_t {
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <limits>
 #include <map>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -268,6 +269,8 @@ public:
     // since the parallel map provides its own ordering (that you specify).  This
     // way, we know it's OK for the map ordering to use any reql_version (instead of
     // taking that as a parameter, which would be completely impracticable).
+    typedef typename std::map<datum_t, T, optional_datum_less_t>::iterator iterator;
+
     typename std::map<datum_t, T, optional_datum_less_t>::iterator begin() {
         return m.begin();
     }
@@ -345,6 +348,7 @@ typedef boost::variant<
     grouped_t<ql::datum_t>, // Reduce (may be NULL)
     grouped_t<optimizer_t>, // min, max
     grouped_t<stream_t>, // No terminal.
+    grouped_t<datums_t>, // Top-k
     exc_t // Don't re-order (we don't want this to initialize to an error.)
     > result_t;
 
@@ -384,7 +388,8 @@ typedef boost::variant<count_wire_func_t,
                        min_wire_func_t,
                        max_wire_func_t,
                        reduce_wire_func_t,
-                       limit_read_t
+                       limit_read_t,
+                       top_k_wire_func_t
                        > terminal_variant_t;
 
 class accumulator_t {
@@ -432,6 +437,11 @@ scoped_ptr_t<eager_acc_t> make_to_array();
 scoped_ptr_t<eager_acc_t> make_eager_terminal(const terminal_variant_t &t);
 scoped_ptr_t<op_t> make_op(const transform_variant_t &tv);
 
+// Encodes keys that are null, booleans, numbers or strings into a string that is
+// equal for two keys exactly if the keys are equal, so that they can be hashed.
+// Returns false for other keys.
+bool encode_group_key(const datum_t &key, std::string *out);
+
 } // namespace ql
 
 #endif  // RDB_PROTOCOL_SHARDS_HPP_
@@ -0,0 +1,124 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/sindex_stats.hpp"
+
+#include <math.h>
+
+#include <algorithm>
+#include <functional>
+
+#include "btree/keys.hpp"
+#include "rdb_protocol/datum.hpp"
+
+hyperloglog_t::hyperloglog_t() : registers(size_t(1) << PRECISION_BITS, 0) { }
+
+void hyperloglog_t::add(const std::string &value) {
+    // `std::hash` is the identity for integers in some standard libraries, so its
+    // result goes through the finalizer of MurmurHash3 to spread it over all bits.
+    uint64_t hash = std::hash<std::string>()(value);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    // The first `PRECISION_BITS` bits pick the register, and the register keeps the
+    // longest run of leading zeros plus one that it has seen in the remaining bits.
+    const size_t index = hash >> (64 - PRECISION_BITS);
+    const uint64_t rest = (hash << PRECISION_BITS) | (uint64_t(1) << (PRECISION_BITS - 1));
+    const uint8_t rank = __builtin_clzll(rest) + 1;
+    if (rank > registers[index]) {
+        registers[index] = rank;
+    }
+}
+
+void hyperloglog_t::merge(const hyperloglog_t &other) {
+    for (size_t i = 0; i < registers.size(); ++i) {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+}
+
+double hyperloglog_t::estimate() const {
+    const double m = registers.size();
+    double sum = 0;
+    size_t zero_registers = 0;
+    for (uint8_t r : registers) {
+        sum += ldexp(1.0, -r);
+        if (r == 0) {
+            ++zero_registers;
+        }
+    }
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    const double raw = alpha * m * m / sum;
+    // Small cardinalities are estimated better by counting the empty registers.
+    if (raw <= 2.5 * m && zero_registers != 0) {
+        return m * log(m / zero_registers);
+    }
+    return raw;
+}
+
+store_sindex_stats_t::store_sindex_stats_t() { }
+
+void store_sindex_stats_t::on_create(const uuid_u &sindex_id) {
+    assert_thread();
+    sindex_stats_t *sindex = &stats[sindex_id];
+    *sindex = sindex_stats_t();
+    sindex->complete = true;
+}
+
+void store_sindex_stats_t::on_drop(const uuid_u &sindex_id) {
+    assert_thread();
+    stats.erase(sindex_id);
+}
+
+void store_sindex_stats_t::on_update(const uuid_u &sindex_id,
+                                     const std::string &name,
+                                     const std::vector<store_key_t> &deleted_keys,
+                                     const std::vector<store_key_t> &added_keys) {
+    assert_thread();
+    sindex_stats_t *sindex = &stats[sindex_id];
+    if (sindex->name != name) {
+        sindex->name = name;
+    }
+    sindex->entries += static_cast<int64_t>(added_keys.size())
+        - static_cast<int64_t>(deleted_keys.size());
+    for (const store_key_t &key : added_keys) {
+        sindex->distinct_keys.add(ql::datum_t::extract_truncated_secondary(
+            key_to_unescaped_str(key)));
+    }
+}
+
+const std::map<uuid_u, sindex_stats_t> &store_sindex_stats_t::get() const {
+    assert_thread();
+    return stats;
+}
+
+void *store_sindex_stats_t::begin_stats() {
+    return new ql::datum_t();
+}
+
+void store_sindex_stats_t::visit_stats(void *data) {
+    if (get_thread_id() != home_thread()) {
+        return;
+    }
+    ql::datum_object_builder_t builder;
+    for (const auto &pair : stats) {
+        if (pair.second.name.empty()) {
+            continue;
+        }
+        ql::datum_object_builder_t sindex;
+        sindex.overwrite("entries",
+            ql::datum_t(static_cast<double>(pair.second.entries)));
+        sindex.overwrite("distinct_keys",
+            ql::datum_t(round(pair.second.distinct_keys.estimate())));
+        sindex.overwrite("complete", ql::datum_t::boolean(pair.second.complete));
+        builder.overwrite(pair.second.name.c_str(), std::move(sindex).to_datum());
+    }
+    *static_cast<ql::datum_t *>(data) = std::move(builder).to_datum();
+}
+
+ql::datum_t store_sindex_stats_t::end_stats(void *data) {
+    ql::datum_t *result = static_cast<ql::datum_t *>(data);
+    ql::datum_t res = result->has() ? *result : ql::datum_t::empty_object();
+    delete result;
+    return res;
+}
@@ -0,0 +1,83 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_SINDEX_STATS_HPP_
+#define RDB_PROTOCOL_SINDEX_STATS_HPP_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "containers/uuid.hpp"
+#include "perfmon/perfmon.hpp"
+#include "threading.hpp"
+
+struct store_key_t;
+
+/* A HyperLogLog sketch (Flajolet et al., 2007) that estimates how many distinct values
+were added to it in `1 << PRECISION_BITS` bytes, with a standard error of about
+`1.04 / sqrt(1 << PRECISION_BITS)`.  Values can't be taken out again, so once some of
+them are gone it over-estimates. */
+class hyperloglog_t {
+public:
+    static const int PRECISION_BITS = 10;
+
+    hyperloglog_t();
+
+    void add(const std::string &value);
+    void merge(const hyperloglog_t &other);
+    double estimate() const;
+
+private:
+    std::vector<uint8_t> registers;
+};
+
+/* What a store has seen of the entries of one of its secondary indexes. */
+struct sindex_stats_t {
+    sindex_stats_t() : entries(0), complete(false) { }
+
+    std::string name;
+    // The entries that were added to the index minus the ones that were removed.
+    int64_t entries;
+    // The distinct secondary keys (as they're stored, so long ones are truncated) of
+    // the entries that were added.
+    hyperloglog_t distinct_keys;
+    // Whether this was there when the index got constructed, so that it saw all of the
+    // index's entries get added.  Otherwise it only counts the changes since the server
+    // started.
+    bool complete;
+};
+
+/* The `sindex_stats_t` of the secondary indexes of a `store_t`, which keeps them up to
+date as the indexes get constructed and modified.  They aren't stored on disk.  The
+number of rows of the store is already kept in the stat block of its primary btree. */
+class store_sindex_stats_t : public perfmon_t, public home_thread_mixin_t {
+public:
+    store_sindex_stats_t();
+
+    // Done as the index starts getting constructed from scratch.
+    void on_create(const uuid_u &sindex_id);
+    void on_drop(const uuid_u &sindex_id);
+
+    // `deleted_keys` and `added_keys` are the index entries that a modification of a
+    // row removed and added.
+    void on_update(const uuid_u &sindex_id,
+                   const std::string &name,
+                   const std::vector<store_key_t> &deleted_keys,
+                   const std::vector<store_key_t> &added_keys);
+
+    const std::map<uuid_u, sindex_stats_t> &get() const;
+
+    // Reports the stats of each index by name.  Indexes that are being deleted are
+    // left out.
+    void *begin_stats();
+    void visit_stats(void *data);
+    ql::datum_t end_stats(void *data);
+
+private:
+    std::map<uuid_u, sindex_stats_t> stats;
+
+    DISABLE_COPYING(store_sindex_stats_t);
+};
+
+#endif  // RDB_PROTOCOL_SINDEX_STATS_HPP_
@@ -4,11 +4,13 @@
 #include <list>
 
 #include "btree/backfill_debug.hpp"
+#include "btree/primary_key_filter.hpp"
 #include "btree/reql_specific.hpp"
 #include "btree/superblock.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/cross_thread_watchable.hpp"
 #include "concurrency/wait_any.hpp"
+#include "config/args.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -193,6 +195,36 @@ scoped_ptr_t<sindex_superblock_t> acquire_sindex_for_read(
     return sindex_sb;
 }
 
+/* Answers an unfiltered `count()` of everything in the store from the population in the
+primary btree's stat block instead of traversing the btree. That's only correct if the
+read covers the store's entire region; otherwise the btree can also hold keys (of other
+shards hosted on this server, for example) that aren't part of the read. */
+bool do_count_from_stat_block(store_t *store,
+                              real_superblock_t *superblock,
+                              const rget_read_t &rget,
+                              rget_read_response_t *res,
+                              release_superblock_t release_superblock) {
+    if (rget.primary_keys.has_value()
+        || !rget.transforms.empty()
+        || !rget.terminal.has_value()
+        || boost::get<ql::count_wire_func_t>(&*rget.terminal) == nullptr
+        || !region_is_superset(rget.region, store->get_region())) {
+        return false;
+    }
+    int64_t population;
+    if (!get_btree_population(superblock, &population)) {
+        return false;
+    }
+    guarantee(population >= 0);
+    if (release_superblock == release_superblock_t::RELEASE) {
+        superblock->release();
+    }
+    ql::grouped_t<uint64_t> counts;
+    counts.insert(std::make_pair(ql::datum_t(), static_cast<uint64_t>(population)));
+    res->result = counts;
+    return true;
+}
+
 void do_read(ql::env_t *env,
              store_t *store,
              btree_slice_t *btree,
@@ -207,6 +239,9 @@ void do_read(ql::env_t *env,
         if (sindex_id_out != nullptr) {
             *sindex_id_out = r_nullopt;
         }
+        if (do_count_from_stat_block(store, superblock, rget, res, release_superblock)) {
+            return;
+        }
         rdb_rget_slice(
             btree,
             *rget.current_shard,
@@ -287,6 +322,21 @@ void do_read(ql::env_t *env,
     }
 }
 
+/* Whether the query was run with `io_priority: "low"`, as `rethinkdb dump` does, so
+that its range reads yield the disk to other queries. The `table` term has already
+checked the value of the optarg. */
+bool has_low_io_priority(ql::env_t *env) {
+    if (!env->get_all_optargs().has_optarg("io_priority")) {
+        return false;
+    }
+    try {
+        scoped_ptr_t<ql::val_t> v = env->get_optarg(env, "io_priority");
+        return v->as_str() == "low";
+    } catch (const ql::base_exc_t &) {
+        return false;
+    }
+}
+
 // TODO: get rid of this extra response_t copy on the stack
 struct rdb_read_visitor_t : public boost::static_visitor<void> {
     void operator()(const changefeed_subscribe_t &s) {
@@ -309,6 +359,8 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             trace);
         ql::raw_stream_t stream;
         optional<uuid_u> sindex_id;
+        // We also read the rows for the `limit_manager_t`'s shadow window.
+        const size_t n = s.spec.limit + LIMIT_CHANGEFEED_SHADOW_ROWS;
         {
             std::vector<scoped_ptr_t<ql::op_t> > ops;
             for (const auto &transform : s.spec.range.transforms) {
@@ -322,7 +374,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             if (s.spec.range.sindex) {
                 rget.terminal.set(ql::limit_read_t{
                     is_primary_t::NO,
-                    s.spec.limit,
+                    n,
                     s.region,
                     !reversed(s.spec.range.sorting)
                         ? store_key_t::min()
@@ -336,7 +388,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             } else {
                 rget.terminal.set(ql::limit_read_t{
                     is_primary_t::YES,
-                    s.spec.limit,
+                    n,
                     s.region,
                     !reversed(s.spec.range.sorting)
                         ? store_key_t::min()
@@ -370,7 +422,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             std::move(stream),
             s.spec.range.sindex ? is_primary_t::NO : is_primary_t::YES,
             s.spec.range.sorting,
-            s.spec.limit);
+            n);
 
         guarantee(s.current_shard.has_value());
         auto cserver = store->get_or_make_changefeed_server(*s.current_shard);
@@ -451,7 +503,17 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         response->response = point_read_response_t();
         point_read_response_t *res =
             boost::get<point_read_response_t>(&response->response);
+        store->hot_keys.on_read(get.key);
+        if (store->primary_key_filter.has()
+            && !store->primary_key_filter->may_contain(get.key)) {
+            // The key isn't in the B-tree, so there's no need to look for its leaf.
+            res->data = ql::datum_t::null();
+            return;
+        }
         rdb_get(get.key, btree, superblock, res, trace);
+        if (res->data.get_type() != ql::datum_t::R_NULL) {
+            ++response->stats.rows_read;
+        }
     }
 
     void operator()(const intersecting_geo_read_t &geo_read) {
@@ -531,6 +593,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             geo_read.region.inner,
             sindex_info,
             geo_read.stamp ? is_stamp_read_t::YES : is_stamp_read_t::NO,
+            &store->geo_covering_cache,
             res);
     }
 
@@ -626,6 +689,21 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             superblock->get()->snapshot_subdag();
         }
 
+        if (rget.primary_keys) {
+            for (const auto &pair : *rget.primary_keys) {
+                store->hot_keys.on_read(pair.first);
+            }
+        } else if (rget.sindex) {
+            rget.sindex->datumspec.visit<void>(
+                [](const ql::datum_range_t &) { },
+                [&](const std::map<ql::datum_t, uint64_t> &values) {
+                    for (const auto &pair : values) {
+                        store->hot_keys.on_sindex_read(
+                            rget.sindex->id, pair.first.print());
+                    }
+                });
+        }
+
         if (rget.transforms.size() != 0 || rget.terminal) {
             // This asserts that the optargs have been initialized.  (There is always
             // a 'db' optarg.)  We have the same assertion in
@@ -638,6 +716,12 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             interruptor,
             rget.serializable_env,
             trace);
+        ql_env.set_query_stats(&response->stats);
+        if (has_low_io_priority(&ql_env)) {
+            // The account outlives the transaction, so we don't have to reset it.
+            superblock->get()->txn()->set_account(
+                &store->low_io_priority_read_account);
+        }
         do_read(&ql_env, store, btree, superblock, rget, res,
                 release_superblock_t::RELEASE, nullptr);
     }
@@ -703,14 +787,26 @@ void store_t::protocol_read(const read_t &_read,
                             signal_t *interruptor) {
     scoped_ptr_t<profile::trace_t> trace = ql::maybe_make_profile_trace(_read.profile);
 
+    // The visitor may release the superblock early, but the transaction outlives it.
+    txn_t *txn = superblock->get()->txn();
+    txn_read_stats_t txn_read_stats;
+    txn->set_read_stats(&txn_read_stats);
     {
         PROFILE_STARTER_IF_ENABLED(
             _read.profile == profile_bool_t::PROFILE, "Perform read on shard.", trace);
         rdb_read_visitor_t v(btree.get(), this,
                              superblock,
                              ctx, response, trace.get_or_null(), interruptor);
-        boost::apply_visitor(v, _read.read);
+        try {
+            boost::apply_visitor(v, _read.read);
+        } catch (...) {
+            txn->set_read_stats(nullptr);
+            throw;
+        }
     }
+    txn->set_read_stats(nullptr);
+    response->stats.cache_bytes_read += txn_read_stats.cache_bytes_read;
+    response->stats.disk_bytes_read += txn_read_stats.disk_bytes_read;
 
     response->n_shards = 1;
     if (trace.has()) {
@@ -815,6 +911,9 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
                                  br.f,
                                  write_hook,
                                  br.return_changes);
+        for (const store_key_t &key : br.keys) {
+            store->hot_keys.on_write(key);
+        }
 
         response->response =
             rdb_batched_replace(
@@ -844,6 +943,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         keys.reserve(bi.inserts.size());
         for (auto it = bi.inserts.begin(); it != bi.inserts.end(); ++it) {
             keys.emplace_back(it->get_field(datum_string_t(bi.pkey)).print_primary());
+            store->hot_keys.on_write(keys.back());
         }
         response->response =
             rdb_batched_replace(
@@ -864,6 +964,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
             boost::get<point_write_response_t>(&response->response);
 
         backfill_debug_key(w.key, strprintf("upsert %" PRIu64, timestamp.longtime));
+        store->hot_keys.on_write(w.key);
 
         rdb_live_deletion_context_t deletion_context;
         rdb_modification_report_t mod_report(w.key);
@@ -880,6 +981,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
             boost::get<point_delete_response_t>(&response->response);
 
         backfill_debug_key(d.key, strprintf("delete %" PRIu64, timestamp.longtime));
+        store->hot_keys.on_write(d.key);
 
         rdb_live_deletion_context_t deletion_context;
         rdb_modification_report_t mod_report(d.key);
@@ -927,6 +1029,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         sindex_block((*superblock)->expose_buf(),
                      (*superblock)->get_sindex_block_id(),
                      access_t::write) {
+        sindex_block.set_lock_class(lock_class_t::sindex_block);
     }
 
 private:
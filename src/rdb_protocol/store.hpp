@@ -2,7 +2,9 @@
 #ifndef RDB_PROTOCOL_STORE_HPP_
 #define RDB_PROTOCOL_STORE_HPP_
 
+#include <deque>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -10,6 +12,7 @@
 #include "btree/node.hpp"
 #include "btree/parallel_traversal.hpp"
 #include "btree/secondary_operations.hpp"
+#include "buffer_cache/cache_account.hpp"
 #include "buffer_cache/types.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/queue/disk_backed_queue_wrapper.hpp"
@@ -23,7 +26,10 @@
 #include "paths.hpp"
 #include "protocol_api.hpp"
 #include "rdb_protocol/changefeed.hpp"
+#include "rdb_protocol/geo/indexing.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/hot_keys.hpp"
+#include "rdb_protocol/sindex_stats.hpp"
 #include "rdb_protocol/store_metainfo.hpp"
 #include "rpc/mailbox/typed.hpp"
 #include "store_view.hpp"
@@ -31,6 +37,7 @@
 
 class store_t;
 class btree_slice_t;
+class primary_key_filter_t;
 class cache_conn_t;
 class cache_t;
 class internal_disk_backed_queue_t;
@@ -41,6 +48,7 @@ class superblock_t;
 class txn_t;
 class cache_balancer_t;
 struct rdb_modification_report_t;
+struct sindex_disk_info_t;
 
 class sindex_not_ready_exc_t : public std::exception {
 public:
@@ -93,6 +101,15 @@ public:
 
     void note_reshard(const region_t &shard_region);
 
+    /* Bounds how much memory the cache balancer gives to this store's cache. See
+    `table_cache_config_t`. */
+    void set_cache_memory_bounds(uint64_t memory_reservation, uint64_t max_memory_limit);
+
+    /* Starts keeping a `primary_key_filter_t` of the primary B-tree's keys, for
+    `--primary-key-filter`, and builds it in the background. Must be called right
+    after the store is constructed. */
+    void enable_primary_key_filter();
+
     /* store_view_t interface */
 
     void new_read_token(read_token_t *token_out);
@@ -222,6 +239,11 @@ public:
             const std::vector<rdb_modification_report_t> &mod_reports,
             bool release_sindex_block);
 
+    // Frees the blob blocks of the deleted value `value` (a copy of its
+    // `rdb_value_t`) in a later write transaction of the blob reaper. The value must
+    // already have been detached from all the trees.
+    void delete_blob_later(std::vector<char> &&value);
+
     void sindex_queue_push(
             const rdb_modification_report_t &mod_report,
             const new_mutex_in_line_t *acq);
@@ -297,6 +319,11 @@ public:
         return secondary_index_slices.at(id).get();
     }
 
+    // The deserialized definition of `sindex`, which is cached so that index updates
+    // don't have to deserialize (and compile) the index function for every write.
+    std::shared_ptr<const sindex_disk_info_t> get_sindex_info(
+            const secondary_index_t &sindex);
+
     void protocol_read(const read_t &read,
                        read_response_t *response,
                        real_superblock_t *superblock,
@@ -373,14 +400,38 @@ public:
     // before we destruct perfmon_collection
     scoped_ptr_t<cache_t> cache;
     scoped_ptr_t<cache_conn_t> general_cache_conn;
+    // Used by range reads from queries run with `io_priority: "low"`
+    cache_account_t low_io_priority_read_account;
     scoped_ptr_t<btree_slice_t> btree;
     io_backender_t *io_backender_;
     base_path_t base_path_;
+    // How much `resume_construct_sindex` holds back while the disk or the store is
+    // busy. Only accessed on the home thread.
+    sindex_build_priority_t sindex_build_priority;
     perfmon_membership_t perfmon_collection_membership;
     scoped_ptr_t<store_metainfo_manager_t> metainfo;
 
+    store_sindex_stats_t sindex_stats;
+    perfmon_membership_t sindex_stats_membership;
+
+    store_hot_keys_t hot_keys;
+    perfmon_membership_t hot_keys_membership;
+
+    // Only if `enable_primary_key_filter()` was called. `btree` points to it too.
+    scoped_ptr_t<primary_key_filter_t> primary_key_filter;
+
+    // Used by `get_intersecting` reads.
+    geo_covering_cache_t geo_covering_cache;
+
     std::map<uuid_u, scoped_ptr_t<btree_slice_t> > secondary_index_slices;
 
+    // The cache of `get_sindex_info`.  Every entry keeps the serialized definition it
+    // was deserialized from, and it's replaced if the index's definition no longer
+    // matches.  Only accessed on the home thread.
+    std::map<uuid_u, std::pair<std::vector<char>,
+                               std::shared_ptr<const sindex_disk_info_t> > >
+        sindex_info_cache;
+
     // We construct secondary indexes by starting with a `universe()` construction_range,
     // and then making the range increasingly smaller until it is `empty()`.
     // While we are in that process, we must put any write for a primary key that is in
@@ -437,6 +488,15 @@ private:
     // the superblock, if any).
     new_semaphore_t write_superblock_acq_semaphore;
 
+    void reap_blobs(auto_drainer_t::lock_t keepalive);
+
+    // Scans the primary B-tree into a new `primary_key_filter`.
+    void build_primary_key_filter(auto_drainer_t::lock_t keepalive);
+
+    // The values of `delete_blob_later`, and whether `reap_blobs` is running.
+    std::deque<std::vector<char> > blobs_to_reap;
+    bool blob_reaper_active;
+
 public:
     // This lock is used to pause backfills while secondary indexes are being
     // post constructed. Secondary index post construction gets in line for a write
@@ -8,6 +8,7 @@
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/op.hpp"
 #include "rdb_protocol/query_cache.hpp"
 #include "rdb_protocol/response.hpp"
 #include "rdb_protocol/term_walker.hpp"
@@ -143,6 +144,8 @@ counted_t<const term_t> compile_on_current_stack(
     case Term::SPLIT:              return make_split_term(env, t);
     case Term::UPCASE:             return make_upcase_term(env, t);
     case Term::DOWNCASE:           return make_downcase_term(env, t);
+    case Term::TRIGRAMS:           return make_trigrams_term(env, t);
+    case Term::TOKENS:             return make_tokens_term(env, t);
     case Term::SAMPLE:             return make_sample_term(env, t);
     case Term::IS_EMPTY:           return make_is_empty_term(env, t);
     case Term::DEFAULT:            return make_default_term(env, t);
@@ -221,7 +224,7 @@ counted_t<const term_t> compile_term(compile_env_t *env, const raw_term_t &t) {
 }
 
 runtime_term_t::runtime_term_t(backtrace_id_t _bt)
-    : bt_rcheckable_t(_bt) { }
+    : bt_rcheckable_t(_bt), hoisted(false) { }
 
 runtime_term_t::~runtime_term_t() { }
 
@@ -231,6 +234,24 @@ term_t::term_t(const raw_term_t &_src)
 
 term_t::~term_t() { }
 
+void term_t::hoist_invariants() const {
+    call_with_enough_stack([&]() {
+        // Literals are already as cheap as a lookup, and functions don't evaluate to
+        // datums.
+        const Term::TermType type = src.type();
+        if (type != Term::DATUM && type != Term::FUNC
+            && is_deterministic() != deterministic_t::no) {
+            var_captures_t captures;
+            accumulate_captures(&captures);
+            if (captures.vars_captured.empty() && !captures.implicit_is_captured) {
+                hoisted = true;
+                return;
+            }
+        }
+        each_subterm([](const term_t *subterm) { subterm->hoist_invariants(); });
+    }, MIN_COMPILE_STACK_SPACE);
+}
+
 // Uncomment the define to enable instrumentation (you'll be able to see where
 // you are in query execution when something goes wrong).
 // #define INSTRUMENT 1
@@ -295,9 +316,22 @@ scoped_ptr_t<val_t> runtime_term_t::eval_on_current_stack(
 scoped_ptr_t<val_t> runtime_term_t::eval(
         scope_env_t *env,
         eval_flags_t eval_flags) const {
-    return call_with_enough_stack<scoped_ptr_t<val_t> >([&]() {
+    // Flags like `LITERAL_OK` can change the result, so only plain evaluations are
+    // reused.
+    const bool reuse = hoisted && eval_flags == NO_FLAGS;
+    if (reuse) {
+        datum_t d = env->env->find_hoisted_value(this);
+        if (d.has()) {
+            return new_val(std::move(d));
+        }
+    }
+    scoped_ptr_t<val_t> ret = call_with_enough_stack<scoped_ptr_t<val_t> >([&]() {
             return eval_on_current_stack(env, std::move(eval_flags));
         }, MIN_EVAL_STACK_SPACE);
+    if (reuse && ret->get_type().get_raw_type() == val_t::type_t::DATUM) {
+        env->env->add_hoisted_value(this, ret->as_datum());
+    }
+    return ret;
 }
 
 } // namespace ql
@@ -2,6 +2,8 @@
 #ifndef RDB_PROTOCOL_TERM_HPP_
 #define RDB_PROTOCOL_TERM_HPP_
 
+#include <functional>
+
 #include "containers/counted.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/error.hpp"
@@ -15,6 +17,7 @@ class datum_stream_t;
 class datum_t;
 class db_t;
 class env_t;
+class field_predicate_t;
 class func_t;
 class scope_env_t;
 class table_t;
@@ -47,6 +50,10 @@ public:
 
 protected:
     explicit runtime_term_t(backtrace_id_t bt);
+
+    // Set by `term_t::hoist_invariants()`.  The first value of a hoisted term is
+    // reused for the rest of the `env_t`.
+    mutable bool hoisted;
 private:
     scoped_ptr_t<val_t> eval_on_current_stack(
             scope_env_t *env,
@@ -67,6 +74,24 @@ public:
     // in sindex_manager.
     virtual bool is_simple_selector() const { return false; }
 
+    // Comparisons of a variable's field with a constant return an object that can
+    // evaluate them natively.  See `field_predicate_t`.
+    virtual const field_predicate_t *get_field_predicate() const { return nullptr; }
+
+    // A `limit` with a constant count calls this on its sequence argument when it
+    // gets compiled, so terms like an unindexed `order_by` that would otherwise keep
+    // the whole sequence in memory only keep the first `n` results around.
+    virtual void limit_results_to(UNUSED size_t n) const { }
+
+    // Called on the body of a function once it's compiled.  Marks the largest
+    // subterms that don't refer to any variable and are deterministic, so that a
+    // function that gets called for every row evaluates them only once.
+    void hoist_invariants() const;
+
+    // Calls `f` on each argument and optional argument.
+    virtual void each_subterm(
+        UNUSED const std::function<void(const term_t *)> &f) const { }
+
 protected:
     // Union term is a friend so we can steal arguments from an array in an optarg.
     friend class union_term_t;
@@ -229,6 +229,14 @@ bool term_storage_t::static_optarg_as_bool(UNUSED const std::string &key,
     unreachable();
 }
 
+std::string term_storage_t::static_optarg_as_string(
+        UNUSED const std::string &key,
+        UNUSED const std::string &default_value) const {
+    r_sanity_check(false, "static_optarg_as_string() is unimplemented "
+                   "for this term_storage_t type");
+    unreachable();
+}
+
 global_optargs_t term_storage_t::global_optargs() {
     r_sanity_check(false, "global_optargs() is unimplemented "
                    "for this term_storage_t type");
@@ -287,7 +295,8 @@ Query::QueryType json_term_storage_t::query_type() const {
 
 void json_term_storage_t::preprocess() {
     r_sanity_check(query_json.Size() >= 2);
-    preprocess_term_tree(&query_json[1], &query_json.GetAllocator(), &bt_reg);
+    depends_on_preprocess_time |=
+        preprocess_term_tree(&query_json[1], &query_json.GetAllocator(), &bt_reg);
 }
 
 raw_term_t json_term_storage_t::root_term() const {
@@ -322,6 +331,32 @@ bool json_term_storage_t::static_optarg_as_bool(const std::string &key,
 
 }
 
+std::string json_term_storage_t::static_optarg_as_string(
+        const std::string &key, const std::string &default_value) const {
+    r_sanity_check(query_json.IsArray());
+    if (query_json.Size() < 3) {
+        return default_value;
+    }
+
+    const rapidjson::Value *_global_optargs = &query_json[2];
+    r_sanity_check(_global_optargs->IsObject());
+
+    const auto it = _global_optargs->FindMember(key.c_str());
+    if (it == _global_optargs->MemberEnd()) {
+        return default_value;
+    } else if (it->value.IsString()) {
+        return std::string(it->value.GetString(), it->value.GetStringLength());
+    } else if (!it->value.IsArray() ||
+               it->value.Size() != 2 ||
+               !it->value[0].IsNumber() ||
+               static_cast<Term::TermType>(it->value[0].GetInt()) != Term::DATUM) {
+        return default_value;
+    } else if (!it->value[1].IsString()) {
+        return default_value;
+    }
+    return std::string(it->value[1].GetString(), it->value[1].GetStringLength());
+}
+
 global_optargs_t json_term_storage_t::global_optargs() {
     auto &allocator = query_json.GetAllocator();
     rapidjson::Value *src;
@@ -354,7 +389,7 @@ global_optargs_t json_term_storage_t::global_optargs() {
 
     // This must be done last, because adding the 'db' optarg may cause reallocation
     for (auto it = src->MemberBegin(); it != src->MemberEnd(); ++it) {
-        preprocess_global_optarg(&it->value, &allocator);
+        depends_on_preprocess_time |= preprocess_global_optarg(&it->value, &allocator);
         res.add_optarg(raw_term_t(&it->value), it->name.GetString());
     }
 
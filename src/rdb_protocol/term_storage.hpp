@@ -120,10 +120,15 @@ private:
 
 class term_storage_t {
 public:
+    term_storage_t() : depends_on_preprocess_time(false) { }
     virtual ~term_storage_t() { }
 
     const backtrace_registry_t &backtrace_registry() const;
 
+    // True if `preprocess()` or `global_optargs()` turned an `r.now()` into a literal,
+    // in which case the preprocessed terms mustn't be reused for a later query.
+    bool is_specific_to_preprocess_time() const { return depends_on_preprocess_time; }
+
     // These functions must be implemented by descendants
     virtual raw_term_t root_term() const = 0;
 
@@ -131,11 +136,14 @@ public:
     virtual Query::QueryType query_type() const;
     virtual bool static_optarg_as_bool(const std::string &key,
                                        bool default_value) const;
+    virtual std::string static_optarg_as_string(
+        const std::string &key, const std::string &default_value) const;
     virtual void preprocess();
     virtual global_optargs_t global_optargs();
 
 protected:
     backtrace_registry_t bt_reg;
+    bool depends_on_preprocess_time;
 };
 
 class json_term_storage_t : public term_storage_t {
@@ -145,6 +153,8 @@ public:
     Query::QueryType query_type() const;
     bool static_optarg_as_bool(const std::string &key,
                                bool default_value) const;
+    std::string static_optarg_as_string(const std::string &key,
+                                        const std::string &default_value) const;
     void preprocess();
     raw_term_t root_term() const;
     global_optargs_t global_optargs();
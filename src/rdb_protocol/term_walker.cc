@@ -34,6 +34,10 @@ public:
         toplevel_frame.walk(src, backtrace_id_t::empty());
     }
 
+    bool rewrote_time_now() const {
+        return time_now.has();
+    }
+
 private:
     class walker_frame_t : public intrusive_list_node_t<walker_frame_t> {
     public:
@@ -195,21 +199,23 @@ private:
     datum_t time_now;
 };
 
-void preprocess_term_tree(rapidjson::Value *term_tree,
+bool preprocess_term_tree(rapidjson::Value *term_tree,
                           rapidjson::Value::AllocatorType *allocator,
                           backtrace_registry_t *bt_reg) {
     r_sanity_check(term_tree != nullptr);
     r_sanity_check(allocator != nullptr);
     term_walker_t term_walker(allocator, bt_reg);
     term_walker.walk(term_tree);
+    return term_walker.rewrote_time_now();
 }
 
-void preprocess_global_optarg(rapidjson::Value *term_tree,
+bool preprocess_global_optarg(rapidjson::Value *term_tree,
                               rapidjson::Value::AllocatorType *allocator) {
     r_sanity_check(term_tree != nullptr);
     r_sanity_check(allocator != nullptr);
     term_walker_t term_walker(allocator, nullptr);
     term_walker.walk(term_tree);
+    return term_walker.rewrote_time_now();
 }
 
 bool term_type_is_valid(Term::TermType type) {
@@ -321,6 +327,8 @@ bool term_type_is_valid(Term::TermType type) {
     case Term::SPLIT:
     case Term::UPCASE:
     case Term::DOWNCASE:
+    case Term::TRIGRAMS:
+    case Term::TOKENS:
     case Term::SAMPLE:
     case Term::IS_EMPTY:
     case Term::DEFAULT:
@@ -512,6 +520,8 @@ bool term_is_write_or_meta(Term::TermType type) {
     case Term::SPLIT:
     case Term::UPCASE:
     case Term::DOWNCASE:
+    case Term::TRIGRAMS:
+    case Term::TOKENS:
     case Term::SAMPLE:
     case Term::IS_EMPTY:
     case Term::DEFAULT:
@@ -707,6 +717,8 @@ bool term_forbids_writes(Term::TermType type) {
     case Term::SPLIT:
     case Term::UPCASE:
     case Term::DOWNCASE:
+    case Term::TRIGRAMS:
+    case Term::TOKENS:
     case Term::SAMPLE:
     case Term::IS_EMPTY:
     case Term::DEFAULT:
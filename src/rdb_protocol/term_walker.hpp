@@ -15,13 +15,15 @@ class backtrace_registry_t;
 //   r.now() is rewritten to a literal datum
 //   objects are rewritten to MAKE_OBJ terms
 //   it is enforced that each term has exactly zero or one set each of args and optargs
-void preprocess_term_tree(rapidjson::Value *query_json,
+// Returns true if it rewrote an r.now() term, which makes the result specific to the
+// time of preprocessing.
+bool preprocess_term_tree(rapidjson::Value *query_json,
                           rapidjson::Value::AllocatorType *allocator,
                           backtrace_registry_t *bt_reg);
 
 // `preprocess_global_optarg(...)` performs the same tasks as `preprocess_term_tree`,
 // except that the backtraces it attaches are all the 'root' backtrace: []
-void preprocess_global_optarg(rapidjson::Value *optarg,
+bool preprocess_global_optarg(rapidjson::Value *optarg,
                               rapidjson::Value::AllocatorType *allocator);
 
 } // namespace ql
@@ -1,6 +1,8 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/terms/arr.hpp"
 
+#include <limits>
+
 #include "math.hpp"
 #include "parsing/utf8.hpp"
 #include "rdb_protocol/error.hpp"
@@ -22,6 +24,9 @@ protected:
     scoped_ptr_t<val_t> pend(scope_env_t *env, args_t *args, which_pend_t which_pend) const {
         datum_t arr = args->arg(env, 0)->as_datum();
         datum_t new_el = args->arg(env, 1)->as_datum();
+        if (which_pend == AP) {
+            return new_val(arr.append(std::move(new_el), env->env->limits()));
+        }
         datum_array_builder_t out(env->env->limits());
         out.reserve(arr.arr_size() + 1);
         if (which_pend == PRE) {
@@ -335,7 +340,19 @@ private:
 class limit_term_t : public op_term_t {
 public:
     limit_term_t(compile_env_t *env, const raw_term_t &term)
-        : op_term_t(env, term, argspec_t(2)) { }
+        : op_term_t(env, term, argspec_t(2)) {
+        if (term.num_args() == 2 && term.arg(1).type() == Term::DATUM) {
+            const datum_t n = term.arg(1).datum();
+            // A limit of 0 still has to evaluate (and possibly fail on) the whole
+            // sequence, so we leave that alone.
+            if (n.get_type() == datum_t::R_NUM
+                && n.as_num() >= 1
+                && n.as_num() <= std::numeric_limits<int32_t>::max()
+                && n.as_num() == static_cast<int32_t>(n.as_num())) {
+                get_original_args()[0]->limit_results_to(n.as_num());
+            }
+        }
+    }
 private:
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
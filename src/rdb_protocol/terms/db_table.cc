@@ -162,7 +162,7 @@ public:
         : meta_op_term_t(env, term, argspec_t(1, 2),
             optargspec_t({"primary_key", "shards", "replicas",
                           "nonvoting_replica_tags", "primary_replica_tag",
-                          "durability"})) { }
+                          "durability", "key_generation"})) { }
 private:
     virtual scoped_ptr_t<val_t> eval_impl(
             scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -189,6 +189,19 @@ private:
             primary_key = v->as_str().to_std();
         }
 
+        key_generation_t key_generation = key_generation_t::RANDOM;
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "key_generation")) {
+            const std::string str = v->as_str().to_std();
+            if (str == "time_ordered") {
+                key_generation = key_generation_t::TIME_ORDERED;
+            } else {
+                rcheck_target(v.get(), str == "random", base_exc_t::LOGIC,
+                              strprintf("Unrecognized key_generation value `%s` "
+                                        "(options are \"random\" and "
+                                        "\"time_ordered\").", str.c_str()));
+            }
+        }
+
         write_durability_t durability =
             parse_durability_optarg(args->optarg(env, "durability")) ==
                 DURABILITY_REQUIREMENT_SOFT ?
@@ -216,6 +229,7 @@ private:
                     db,
                     config_params,
                     primary_key,
+                    key_generation,
                     durability,
                     env->env->interruptor,
                     &result,
@@ -550,8 +564,9 @@ class reconfigure_term_t : public table_or_db_meta_term_t {
 public:
     reconfigure_term_t(compile_env_t *env, const raw_term_t &term)
         : table_or_db_meta_term_t(env, term,
-            optargspec_t({"dry_run", "emergency_repair", "nonvoting_replica_tags",
-                "primary_replica_tag", "replicas", "shards"})) { }
+            optargspec_t({"dry_run", "emergency_repair", "minimal_movement",
+                "nonvoting_replica_tags", "primary_replica_tag", "replicas",
+                "shards"})) { }
 private:
     scoped_ptr_t<val_t> required_optarg(scope_env_t *env,
                                         args_t *args,
@@ -602,6 +617,11 @@ private:
                                      args->optarg(env, "primary_replica_tag"),
                                      &config_params);
 
+            // Parse the 'minimal_movement' optarg
+            if (scoped_ptr_t<val_t> v = args->optarg(env, "minimal_movement")) {
+                config_params.minimal_movement = v->as_bool();
+            }
+
             bool success;
             datum_t result;
             admin_err_t error;
@@ -655,7 +675,8 @@ private:
 
             /* Make sure none of the optargs that are used with regular reconfigurations
             are present, to avoid user confusion. */
-            if (args->optarg(env, "nonvoting_replica_tags").has() ||
+            if (args->optarg(env, "minimal_movement").has() ||
+                    args->optarg(env, "nonvoting_replica_tags").has() ||
                     args->optarg(env, "primary_replica_tag").has() ||
                     args->optarg(env, "replicas").has() ||
                     args->optarg(env, "shards").has()) {
@@ -842,15 +863,27 @@ private:
                 read_mode = read_mode_t::SINGLE;
             } else if (str == "outdated") {
                 read_mode = read_mode_t::OUTDATED;
+            } else if (str == "nearest") {
+                read_mode = read_mode_t::NEAREST;
             } else if (str == "_debug_direct") {
                 read_mode = read_mode_t::DEBUG_DIRECT;
             } else {
                 rfail(base_exc_t::LOGIC, "Read mode `%s` unrecognized (options "
-                      "are \"majority\", \"single\", and \"outdated\").",
+                      "are \"majority\", \"single\", \"outdated\", and "
+                      "\"nearest\").",
                       str.to_std().c_str());
             }
         }
 
+        // Only a global optarg, because that's what the range reads get to see.
+        if (scoped_ptr_t<val_t> v = env->env->get_optarg(env->env, "io_priority")) {
+            const datum_string_t &str = v->as_str();
+            if (str != "normal" && str != "low") {
+                rfail(base_exc_t::LOGIC, "I/O priority `%s` unrecognized (options "
+                      "are \"normal\" and \"low\").", str.to_std().c_str());
+            }
+        }
+
         optional<admin_identifier_format_t> identifier_format;
         if (scoped_ptr_t<val_t> v = args->optarg(env, "identifier_format")) {
             const datum_string_t &str = v->as_str();
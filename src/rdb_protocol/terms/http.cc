@@ -30,7 +30,8 @@ public:
                                   "page",
                                   "page_limit",
                                   "auth",
-                                  "result_format" }))
+                                  "result_format",
+                                  "cache" }))
     { }
 private:
     virtual const char *name() const { return "http"; }
@@ -253,7 +254,7 @@ scoped_ptr_t<val_t> http_term_t::eval_impl(scope_env_t *env, args_t *args,
 
     // Otherwise, just run the http operation and return the datum
     http_result_t res;
-    http_runner_t runner(env->env->get_extproc_pool());
+    http_runner_t runner(env->env->get_extproc_pool(), env->env->get_http_batcher());
     dispatch_http(env->env, opts, &runner, &res, this);
 
     return new_val(res.body);
@@ -449,6 +450,7 @@ void http_term_t::get_optargs(scope_env_t *env,
     get_attempts(env, args, &opts_out->attempts);
     get_redirects(env, args, &opts_out->max_redirects);
     get_bool_optarg("verify", env, args, &opts_out->verify);
+    get_bool_optarg("cache", env, args, &opts_out->cache);
 }
 
 // The `timeout` optarg specifies the number of seconds to wait before erroring
@@ -769,7 +771,7 @@ void http_term_t::get_redirects(scope_env_t *env,
 }
 
 // This is a generic function for parsing out a boolean optarg yet still providing a
-// helpful message.  At the moment, it is only used for `page` and `verify`.
+// helpful message.  At the moment, it is only used for `verify` and `cache`.
 void http_term_t::get_bool_optarg(const std::string &optarg_name,
                                   scope_env_t *env,
                                   args_t *args,
@@ -381,4 +381,41 @@ counted_t<term_t> make_merge_term(
     return make_counted<merge_term_t>(env, term);
 }
 
+bool match_var_field_access(const raw_term_t &term,
+                            optional<sym_t> *var_out,
+                            datum_string_t *field_out) {
+    // `bracket` also indexes arrays, but not with a string.  Its optarg is used by
+    // `make_obj_or_seq_func` above.
+    if ((term.type() != Term::GET_FIELD && term.type() != Term::BRACKET)
+        || term.num_args() != 2 || term.num_optargs() != 0) {
+        return false;
+    }
+    const raw_term_t field = term.arg(1);
+    if (field.type() != Term::DATUM) {
+        return false;
+    }
+    const datum_t name = field.datum();
+    if (name.get_type() != datum_t::R_STR) {
+        return false;
+    }
+
+    const raw_term_t object = term.arg(0);
+    if (object.type() == Term::VAR) {
+        if (object.num_args() != 1 || object.arg(0).type() != Term::DATUM) {
+            return false;
+        }
+        const datum_t var = object.arg(0).datum();
+        if (var.get_type() != datum_t::R_NUM) {
+            return false;
+        }
+        var_out->set(sym_t(var.as_int()));
+    } else if (object.type() == Term::IMPLICIT_VAR) {
+        var_out->reset();
+    } else {
+        return false;
+    }
+    *field_out = name.as_str();
+    return true;
+}
+
 } // namespace ql
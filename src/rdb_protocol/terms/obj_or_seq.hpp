@@ -5,6 +5,7 @@
 #include <functional>
 
 #include "containers/counted.hpp"
+#include "containers/optional.hpp"
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/minidriver.hpp"
 #include "utils.hpp"
@@ -58,6 +59,13 @@ private:
     obj_or_seq_op_impl_t impl;
 };
 
+// If `term` reads a top-level field with a constant name from a variable, as
+// `r.row('a')` and `x('a')` do, sets `*var_out` to the variable (empty for the
+// implicit variable) and `*field_out` to the name of the field.
+bool match_var_field_access(const raw_term_t &term,
+                            optional<sym_t> *var_out,
+                            datum_string_t *field_out);
+
 } // namespace ql
 
 #endif // RDB_PROTOCOL_TERMS_OBJ_OR_SEQ_HPP_
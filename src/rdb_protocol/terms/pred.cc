@@ -1,7 +1,9 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/terms/terms.hpp"
 
+#include "rdb_protocol/field_predicate.hpp"
 #include "rdb_protocol/op.hpp"
+#include "rdb_protocol/terms/obj_or_seq.hpp"
 
 namespace ql {
 
@@ -62,8 +64,40 @@ public:
         default: unreachable();
         }
         guarantee(namestr && pred);
+        init_field_predicate(term);
+    }
+
+    const field_predicate_t *get_field_predicate() const final {
+        return field_predicate.get_or_null();
     }
 private:
+    // Recognizes `row(field) <op> constant` and `constant <op> row(field)`.
+    void init_field_predicate(const raw_term_t &term) {
+        if (term.num_args() != 2) {
+            return;
+        }
+        for (size_t i = 0; i < 2; ++i) {
+            const raw_term_t constant_term = term.arg(1 - i);
+            if (constant_term.type() != Term::DATUM) {
+                continue;
+            }
+            const datum_t constant = constant_term.datum();
+            if (constant.get_type() == datum_t::R_OBJECT
+                || constant.get_type() == datum_t::R_ARRAY) {
+                continue;
+            }
+            optional<sym_t> var;
+            datum_string_t field;
+            if (!match_var_field_access(term.arg(i), &var, &field)) {
+                continue;
+            }
+            field_predicate = make_scoped<field_predicate_t>(
+                std::move(var), std::move(field), term.type(), constant,
+                i == 1);
+            return;
+        }
+    }
+
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
         datum_t lhs = args->arg(env, 0)->as_datum();
@@ -80,6 +114,7 @@ private:
     virtual const char *name() const { return namestr; }
     bool invert;
     bool (*pred)(const datum_t &lhs, const datum_t &rhs);
+    scoped_ptr_t<field_predicate_t> field_predicate;
 };
 
 class not_term_t : public op_term_t {
@@ -3,10 +3,13 @@
 
 #include <string>
 
+#include "rdb_protocol/datum_stream/hash_join.hpp"
 #include "rdb_protocol/error.hpp"
+#include "rdb_protocol/func.hpp"
 #include "rdb_protocol/minidriver.hpp"
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/term_walker.hpp"
+#include "rdb_protocol/terms/obj_or_seq.hpp"
 
 namespace ql {
 
@@ -39,18 +42,88 @@ private:
         return real->is_deterministic();
     }
 
+protected:
     virtual scoped_ptr_t<val_t> term_eval(scope_env_t *env, eval_flags_t) const {
         return real->eval(env);
     }
 
+private:
     raw_term_t rewrite_src;
     counted_t<const term_t> real;
 };
 
+// Recognizes `function(l, r) { return l('a').eq(r('b')); }`, with the sides of the
+// `eq` in either order.
+bool match_equi_join(const raw_term_t &func,
+                     datum_string_t *left_field_out,
+                     datum_string_t *right_field_out) {
+    if (func.type() != Term::FUNC || func.num_args() != 2
+        || func.num_optargs() != 0) {
+        return false;
+    }
+    std::vector<double> params;
+    const raw_term_t vars = func.arg(0);
+    if (vars.type() == Term::DATUM) {
+        const datum_t d = vars.datum();
+        if (d.get_type() != datum_t::R_ARRAY) {
+            return false;
+        }
+        for (size_t i = 0; i < d.arr_size(); ++i) {
+            if (d.get(i).get_type() != datum_t::R_NUM) {
+                return false;
+            }
+            params.push_back(d.get(i).as_num());
+        }
+    } else if (vars.type() == Term::MAKE_ARRAY) {
+        for (size_t i = 0; i < vars.num_args(); ++i) {
+            if (vars.arg(i).type() != Term::DATUM
+                || vars.arg(i).datum().get_type() != datum_t::R_NUM) {
+                return false;
+            }
+            params.push_back(vars.arg(i).datum().as_num());
+        }
+    } else {
+        return false;
+    }
+    if (params.size() != 2 || params[0] == params[1]) {
+        return false;
+    }
+
+    const raw_term_t body = func.arg(1);
+    if (body.type() != Term::EQ || body.num_args() != 2 || body.num_optargs() != 0) {
+        return false;
+    }
+    optional<sym_t> vars_out[2];
+    datum_string_t fields_out[2];
+    for (size_t i = 0; i < 2; ++i) {
+        if (!match_var_field_access(body.arg(i), &vars_out[i], &fields_out[i])
+            || !vars_out[i].has_value()) {
+            return false;
+        }
+    }
+    if (vars_out[0]->value == params[0] && vars_out[1]->value == params[1]) {
+        *left_field_out = fields_out[0];
+        *right_field_out = fields_out[1];
+        return true;
+    } else if (vars_out[0]->value == params[1] && vars_out[1]->value == params[0]) {
+        *left_field_out = fields_out[1];
+        *right_field_out = fields_out[0];
+        return true;
+    }
+    return false;
+}
+
 class inner_join_term_t : public rewrite_term_t {
 public:
     inner_join_term_t(compile_env_t *env, const raw_term_t &term)
-        : rewrite_term_t(env, term, argspec_t(3), rewrite) { }
+        : rewrite_term_t(env, term, argspec_t(3), rewrite) {
+        // `rewrite_term_t` already checked the number of arguments.
+        if (match_equi_join(term.arg(2), &left_field, &right_field)) {
+            left = compile_term(env, term.arg(0));
+            right = compile_term(env, term.arg(1));
+            func = compile_term(env, term.arg(2));
+        }
+    }
 
     static minidriver_t::reql_t rewrite(const raw_term_t &in) {
         minidriver_t r(in.bt());
@@ -77,6 +150,35 @@ public:
     }
 
     virtual const char *name() const { return "inner_join"; }
+
+private:
+    virtual scoped_ptr_t<val_t> term_eval(scope_env_t *env, eval_flags_t flags) const {
+        if (!func.has()) {
+            return rewrite_term_t::term_eval(env, flags);
+        }
+        // The nested loop evaluates the right side once for every left row.  We only
+        // do it once, which is no different since table reads aren't snapshots.
+        counted_t<datum_stream_t> left_seq = left->eval(env)->as_seq(env->env);
+        counted_t<datum_stream_t> right_seq = right->eval(env)->as_seq(env->env);
+        if (left_seq->is_grouped() || right_seq->is_grouped()
+            || right_seq->is_infinite()) {
+            // Creating the streams doesn't read anything, so evaluating the sides
+            // again is cheap.
+            return rewrite_term_t::term_eval(env, flags);
+        }
+        return new_val(
+            env->env,
+            counted_t<datum_stream_t>(make_counted<hash_join_datum_stream_t>(
+                std::move(left_seq),
+                std::move(right_seq),
+                left_field,
+                right_field,
+                func->eval(env)->as_func())));
+    }
+
+    datum_string_t left_field, right_field;
+    // Only set if the join condition is an equality `match_equi_join` recognizes.
+    counted_t<const term_t> left, right, func;
 };
 
 class outer_join_term_t : public rewrite_term_t {
@@ -5,6 +5,8 @@
 #include <utility>
 #include <vector>
 
+#include "clustering/administration/admin_op_exc.hpp"
+#include "containers/name_string.hpp"
 #include "parsing/utf8.hpp"
 #include "rdb_protocol/datum_stream/eq_join.hpp"
 #include "rdb_protocol/datum_stream/fold.hpp"
@@ -18,6 +20,7 @@
 #include "rdb_protocol/math_utils.hpp"
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/order_util.hpp"
+#include "rdb_protocol/trigrams.hpp"
 
 namespace ql {
 
@@ -415,10 +418,77 @@ private:
     virtual const char *name() const { return "group"; }
 };
 
+/* Returns the name of an index that `table.get_all(value, {index: name})` can read the
+rows whose top-level field `field` is equal to `value` from, or `r_nullopt` if there is
+none.  The primary key wins over secondary indexes, since it doesn't have to be looked
+up and its reads don't have to go through a second tree. */
+static optional<std::string> find_equality_index(env_t *env,
+                                                 const counted_t<table_t> &table,
+                                                 const datum_string_t &field) {
+    if (field.to_std() == table->get_pkey()) {
+        return make_optional(table->get_pkey());
+    }
+
+    admin_err_t error;
+    std::map<std::string, std::pair<sindex_config_t, sindex_status_t> >
+        configs_and_statuses;
+    if (!env->reql_cluster_interface()->sindex_list(
+            table->db, name_string_t::guarantee_valid(table->name.c_str()),
+            env->interruptor, &error, &configs_and_statuses)) {
+        // Scanning the table still works, so this isn't worth failing the query over.
+        return r_nullopt;
+    }
+    for (const auto &pair : configs_and_statuses) {
+        const sindex_config_t &config = pair.second.first;
+        const sindex_status_t &status = pair.second.second;
+        datum_string_t index_field;
+        if (config.multi == sindex_multi_bool_t::SINGLE
+            && config.geo == sindex_geo_bool_t::REGULAR
+            && status.ready
+            && !status.outdated
+            && config.func.compile_wire_func()->get_single_field_read(&index_field)
+            && index_field == field) {
+            return make_optional(pair.first);
+        }
+    }
+    return r_nullopt;
+}
+
+/* Returns the name of a multi index on a term of type `type` applied to the field
+`field`, as in `r.row(field).trigrams()`, or `r_nullopt` if there is none. */
+static optional<std::string> find_field_term_index(env_t *env,
+                                                   const counted_t<table_t> &table,
+                                                   Term::TermType type,
+                                                   const datum_string_t &field) {
+    admin_err_t error;
+    std::map<std::string, std::pair<sindex_config_t, sindex_status_t> >
+        configs_and_statuses;
+    if (!env->reql_cluster_interface()->sindex_list(
+            table->db, name_string_t::guarantee_valid(table->name.c_str()),
+            env->interruptor, &error, &configs_and_statuses)) {
+        return r_nullopt;
+    }
+    for (const auto &pair : configs_and_statuses) {
+        const sindex_config_t &config = pair.second.first;
+        const sindex_status_t &status = pair.second.second;
+        datum_string_t index_field;
+        if (config.multi == sindex_multi_bool_t::MULTI
+            && config.geo == sindex_geo_bool_t::REGULAR
+            && status.ready
+            && !status.outdated
+            && config.func.compile_wire_func()->get_field_term_read(type, &index_field)
+            && index_field == field) {
+            return make_optional(pair.first);
+        }
+    }
+    return r_nullopt;
+}
+
 class filter_term_t : public grouped_seq_op_term_t {
 public:
     filter_term_t(compile_env_t *env, const raw_term_t &term)
-        : grouped_seq_op_term_t(env, term, argspec_t(2), optargspec_t({"default"})),
+        : grouped_seq_op_term_t(env, term, argspec_t(2),
+                                optargspec_t({"auto_index", "default"})),
           default_filter_term(lazy_literal_optarg(env, "default")) { }
 
 private:
@@ -432,6 +502,78 @@ private:
             defval.set(wire_func_t(default_filter_term->eval_to_func(env->scope)));
         }
 
+        // With `auto_index`, an equality filter directly on a table reads the rows
+        // through an index on the filtered field instead of scanning the table.  The
+        // filter still gets applied to the rows that the index returns.  Range filters
+        // are left alone because ReQL compares values of different types, so
+        // `r.row('age').gt(30)` also keeps rows whose `age` is an object, which no
+        // index has entries for.  Rows without the field fail the filter unless there
+        // is a default, and indexes don't have entries for them either.
+        datum_string_t field;
+        datum_t value;
+        if (!defval.has_value()
+            && v0->get_type().get_raw_type() == val_t::type_t::TABLE
+            && f->get_equality_filter(&field, &value)
+            && value.get_type() != datum_t::R_NULL) {
+            scoped_ptr_t<val_t> auto_index = args->optarg(env, "auto_index");
+            if (auto_index.has() && auto_index->as_bool()) {
+                counted_t<table_t> table = v0->as_table();
+                optional<std::string> index = find_equality_index(env->env, table, field);
+                if (index.has_value()) {
+                    std::map<datum_t, uint64_t> keys;
+                    keys.insert(std::make_pair(value, 1));
+                    counted_t<selection_t> ts = make_counted<selection_t>(
+                        table,
+                        table->get_all(env->env, datumspec_t(std::move(keys)), *index,
+                                       backtrace()));
+                    ts->seq->add_transformation(
+                        filter_wire_func_t(f, defval), backtrace());
+                    return new_val(ts);
+                }
+            }
+        }
+
+        // Similarly, a `match` filter whose regular expression requires some text
+        // reads the rows that a trigram index has for one of the text's trigrams, and
+        // a filter like `r.row(field).tokens().contains(word, ...)` reads the rows that
+        // a multi index on `r.row(field).tokens()` has for the first word.  The index
+        // doesn't have entries for rows whose field isn't a string, so these get
+        // skipped instead of failing the query as they would in a table scan.
+        Term::TermType index_term = Term::TRIGRAMS;
+        datum_t index_value;
+        std::string pattern;
+        std::string trigram;
+        bool use_index_term = false;
+        if (!defval.has_value()
+            && v0->get_type().get_raw_type() == val_t::type_t::TABLE) {
+            if (f->get_match_filter(&field, &pattern)
+                && find_required_trigram(pattern, &trigram)) {
+                index_value = datum_t(datum_string_t(trigram));
+                use_index_term = true;
+            } else if (f->get_contains_filter(&index_term, &field, &index_value)) {
+                use_index_term = true;
+            }
+        }
+        if (use_index_term) {
+            scoped_ptr_t<val_t> auto_index = args->optarg(env, "auto_index");
+            if (auto_index.has() && auto_index->as_bool()) {
+                counted_t<table_t> table = v0->as_table();
+                optional<std::string> index =
+                    find_field_term_index(env->env, table, index_term, field);
+                if (index.has_value()) {
+                    std::map<datum_t, uint64_t> keys;
+                    keys.insert(std::make_pair(index_value, 1));
+                    counted_t<selection_t> ts = make_counted<selection_t>(
+                        table,
+                        table->get_all(env->env, datumspec_t(std::move(keys)), *index,
+                                       backtrace()));
+                    ts->seq->add_transformation(
+                        filter_wire_func_t(f, defval), backtrace());
+                    return new_val(ts);
+                }
+            }
+        }
+
         if (v0->get_type().is_convertible(val_t::type_t::SELECTION)) {
             counted_t<selection_t> ts = v0->as_selection(env->env);
             ts->seq->add_transformation(filter_wire_func_t(f, defval), backtrace());
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "clustering/administration/admin_op_exc.hpp"
+#include "config/args.hpp"
 #include "containers/archive/string_stream.hpp"
 #include "rdb_protocol/real_table.hpp"
 #include "rdb_protocol/btree.hpp"
@@ -26,7 +27,8 @@ datum_string_t sindex_config_to_string(const sindex_config_t &config) {
     version.original_reql_version = config.func_version;
     version.latest_compatible_reql_version = config.func_version;
     version.latest_checked_reql_version = reql_version_t::LATEST;
-    sindex_disk_info_t disk_info(config.func, version, config.multi, config.geo);
+    sindex_disk_info_t disk_info(
+        config.func, version, config.multi, config.geo, config.geo_covering);
 
     write_message_t wm;
     serialize_sindex_info(&wm, disk_info);
@@ -87,7 +89,8 @@ sindex_config_t sindex_config_from_string(
         sindex_info.mapping,
         sindex_info.mapping_version_info.original_reql_version,
         sindex_info.multi,
-        sindex_info.geo);
+        sindex_info.geo,
+        sindex_info.geo_covering);
 }
 
 // Helper for `sindex_status_to_datum()`
@@ -116,6 +119,12 @@ std::string format_index_create_query(
             ret += ", ";
         }
         ret += "geo: true";
+        if (!config.geo_covering.is_default()) {
+            ret += strprintf(", geoMaxCells: %d, geoMinLevel: %d, geoMaxLevel: %d",
+                             config.geo_covering.max_cells,
+                             config.geo_covering.min_level,
+                             config.geo_covering.max_level);
+        }
     }
     if (!first_optarg) {
         ret += "}";
@@ -154,7 +163,9 @@ ql::datum_t sindex_status_to_datum(
 class sindex_create_term_t : public op_term_t {
 public:
     sindex_create_term_t(compile_env_t *env, const raw_term_t &term)
-        : op_term_t(env, term, argspec_t(2, 3), optargspec_t({"multi", "geo"})) { }
+        : op_term_t(env, term, argspec_t(2, 3),
+                    optargspec_t({"multi", "geo", "geo_max_cells", "geo_min_level",
+                                  "geo_max_level"})) { }
 
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -218,6 +229,30 @@ public:
                 ? sindex_geo_bool_t::GEO
                 : sindex_geo_bool_t::REGULAR;
         }
+        /* How should a geo index cover the geometries with grid cells? */
+        bool got_geo_covering = false;
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "geo_max_cells")) {
+            config.geo_covering.max_cells = v->as_int<int32_t>();
+            got_geo_covering = true;
+        }
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "geo_min_level")) {
+            config.geo_covering.min_level = v->as_int<int32_t>();
+            got_geo_covering = true;
+        }
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "geo_max_level")) {
+            config.geo_covering.max_level = v->as_int<int32_t>();
+            got_geo_covering = true;
+        }
+        if (got_geo_covering) {
+            rcheck(config.geo == sindex_geo_bool_t::GEO, base_exc_t::LOGIC,
+                   "`geo_max_cells`, `geo_min_level` and `geo_max_level` only apply "
+                   "to geospatial indexes (created with `geo: true`).");
+            rcheck(config.geo_covering.is_valid(), base_exc_t::LOGIC,
+                   strprintf("Invalid geospatial covering: `geo_max_cells` must be at "
+                             "least 1, and `geo_min_level` and `geo_max_level` must "
+                             "satisfy 0 <= geo_min_level <= geo_max_level <= %d.",
+                             GEO_INDEX_MAX_CELL_LEVEL));
+        }
 
         try {
             admin_err_t error;
@@ -51,6 +51,10 @@ public:
     orderby_term_t(compile_env_t *env, const raw_term_t &term)
         : op_term_t(env, term, argspec_t(1, -1),
           optargspec_t({"index"})) { }
+
+    void limit_results_to(size_t n) const final {
+        result_limit.set(n);
+    }
 private:
     virtual scoped_ptr_t<val_t>
     eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -105,23 +109,32 @@ private:
             }
             rcheck(!comparisons.empty(), base_exc_t::LOGIC,
                    "Must specify something to order by.");
-            std::vector<datum_t> to_sort;
-            batchspec_t batchspec = batchspec_t::user(batch_type_t::TERMINAL, env->env);
-            for (;;) {
-                std::vector<datum_t> data
-                    = seq->next_batch(env->env, batchspec);
-                if (data.size() == 0) {
-                    break;
+            if (result_limit.has_value() && !seq->is_grouped()) {
+                // Only the first `*result_limit` rows can make it out of the `limit`,
+                // so every shard only sends back its own first rows.
+                scoped_ptr_t<val_t> top = seq->run_terminal(
+                    env->env,
+                    top_k_wire_func_t(comparisons, *result_limit, backtrace()));
+                seq = make_counted<array_datum_stream_t>(top->as_datum(), backtrace());
+            } else {
+                std::vector<datum_t> to_sort;
+                batchspec_t batchspec
+                    = batchspec_t::user(batch_type_t::TERMINAL, env->env);
+                profile::sampler_t sampler("Sorting in-memory.", env->env->trace);
+                for (;;) {
+                    std::vector<datum_t> data
+                        = seq->next_batch(env->env, batchspec);
+                    if (data.size() == 0) {
+                        break;
+                    }
+                    std::move(data.begin(), data.end(), std::back_inserter(to_sort));
+                    rcheck_array_size(to_sort, env->env->limits());
                 }
-                std::move(data.begin(), data.end(), std::back_inserter(to_sort));
-                rcheck_array_size(to_sort, env->env->limits());
+                lt_cmp.sort(env->env, &sampler, &to_sort);
+                seq = make_counted<array_datum_stream_t>(
+                    datum_t(std::move(to_sort), env->env->limits()),
+                    backtrace());
             }
-            profile::sampler_t sampler("Sorting in-memory.", env->env->trace);
-            auto fn = std::bind(lt_cmp, env->env, &sampler, ph::_1, ph::_2);
-            std::stable_sort(to_sort.begin(), to_sort.end(), fn);
-            seq = make_counted<array_datum_stream_t>(
-                datum_t(std::move(to_sort), env->env->limits()),
-                backtrace());
         }
         return tbl_slice.has()
             ? new_val(make_counted<selection_t>(tbl_slice->get_tbl(), seq))
@@ -129,6 +142,9 @@ private:
     }
 
     virtual const char *name() const { return "orderby"; }
+
+    // Set at compile time by a parent `limit` term.
+    mutable optional<size_t> result_limit;
 };
 
 class distinct_term_t : public op_term_t {
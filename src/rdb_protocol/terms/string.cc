@@ -10,6 +10,7 @@
 #include "parsing/utf8.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/op.hpp"
+#include "rdb_protocol/trigrams.hpp"
 
 namespace ql {
 
@@ -269,6 +270,66 @@ private:
     virtual const char *name() const { return "split"; }
 };
 
+class trigrams_term_t : public op_term_t {
+public:
+    trigrams_term_t(compile_env_t *env, const raw_term_t &term)
+        : op_term_t(env, term, argspec_t(1)) { }
+private:
+    virtual scoped_ptr_t<val_t> eval_impl(
+        scope_env_t *env, args_t *args, eval_flags_t) const {
+        std::vector<datum_t> res;
+        for (const std::string &trigram
+                 : string_trigrams(args->arg(env, 0)->as_str().to_std())) {
+            res.push_back(datum_t(datum_string_t(trigram)));
+        }
+        return new_val(datum_t(std::move(res), env->env->limits()));
+    }
+    virtual const char *name() const { return "trigrams"; }
+};
+
+class tokens_term_t : public op_term_t {
+public:
+    tokens_term_t(compile_env_t *env, const raw_term_t &term)
+        : op_term_t(env, term, argspec_t(1)) { }
+private:
+    virtual scoped_ptr_t<val_t> eval_impl(
+        scope_env_t *env, args_t *args, eval_flags_t) const {
+        const std::string s = args->arg(env, 0)->as_str().to_std();
+        std::vector<std::string> words;
+        std::string word;
+        std::string::const_iterator current = s.cbegin();
+        while (current != s.cend()) {
+            char32_t codepoint;
+            std::string::const_iterator next =
+                utf8::next_codepoint(current, s.cend(), &codepoint);
+            if (u_isalnum(codepoint)) {
+                for (; current != next; ++current) {
+                    word.push_back(*current >= 'A' && *current <= 'Z'
+                                   ? *current - 'A' + 'a'
+                                   : *current);
+                }
+            } else if (!word.empty()) {
+                words.push_back(std::move(word));
+                word.clear();
+            }
+            current = next;
+        }
+        if (!word.empty()) {
+            words.push_back(std::move(word));
+        }
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+
+        std::vector<datum_t> res;
+        res.reserve(words.size());
+        for (const std::string &w : words) {
+            res.push_back(datum_t(datum_string_t(w)));
+        }
+        return new_val(datum_t(std::move(res), env->env->limits()));
+    }
+    virtual const char *name() const { return "tokens"; }
+};
+
 counted_t<term_t> make_match_term(
         compile_env_t *env, const raw_term_t &term) {
     return make_counted<match_term_t>(env, term);
@@ -277,5 +338,13 @@ counted_t<term_t> make_split_term(
         compile_env_t *env, const raw_term_t &term) {
     return make_counted<split_term_t>(env, term);
 }
+counted_t<term_t> make_trigrams_term(
+        compile_env_t *env, const raw_term_t &term) {
+    return make_counted<trigrams_term_t>(env, term);
+}
+counted_t<term_t> make_tokens_term(
+        compile_env_t *env, const raw_term_t &term) {
+    return make_counted<tokens_term_t>(env, term);
+}
 
 }  // namespace ql
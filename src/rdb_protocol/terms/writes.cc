@@ -97,7 +97,10 @@ private:
                                    datum_t *datum_out,
                                    bool *pkey_was_autogenerated_out) {
         if (!(*datum_out).get_field(datum_string_t(tbl->get_pkey()), NOTHROW).has()) {
-            std::string key = uuid_to_str(generate_uuid());
+            std::string key = uuid_to_str(
+                tbl->get_key_generation() == key_generation_t::TIME_ORDERED
+                    ? generate_time_ordered_uuid()
+                    : generate_uuid());
             datum_t keyd((datum_string_t(key)));
             {
                 datum_object_builder_t d;
@@ -116,10 +119,10 @@ private:
                 *keys_skipped_out += 1;
             }
             /* NOTE: If we ever support other pkey autogeneration schemes, it's important
-            that this be set to `true` only if a regular UUID is generated, and not for
-            any other pkey autogeneration scheme. This is because the artificial tables
-            will assume that if this is set to `true`, then the pkey is a newly-generated
-            UUID. */
+            that this be set to `true` only if a UUID is generated, and not for any other
+            pkey autogeneration scheme. This is because the artificial tables will
+            assume that if this is set to `true`, then the pkey is a newly-generated
+            UUID. (Time-ordered keys are UUIDs too.) */
             *pkey_was_autogenerated_out = true;
         } else {
             *pkey_was_autogenerated_out = false;
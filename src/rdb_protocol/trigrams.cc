@@ -0,0 +1,217 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/trigrams.hpp"
+
+#include <re2/re2.h>
+
+#include <algorithm>
+
+#include "parsing/utf8.hpp"
+
+namespace ql {
+
+// Splits `str` into its code points, lowercasing ASCII letters.  Invalid UTF-8 ends
+// up in the pieces too, so that no bytes get lost.
+static std::vector<std::string> split_folded_codepoints(const std::string &str) {
+    std::vector<std::string> res;
+    std::string::const_iterator it = str.begin();
+    while (it != str.end()) {
+        std::string::const_iterator next = utf8::next_codepoint(it, str.end());
+        res.push_back(std::string(it, next));
+        if (res.back().size() == 1 && res.back()[0] >= 'A' && res.back()[0] <= 'Z') {
+            res.back()[0] += 'a' - 'A';
+        }
+        it = next;
+    }
+    return res;
+}
+
+std::vector<std::string> string_trigrams(const std::string &str) {
+    const std::vector<std::string> codepoints = split_folded_codepoints(str);
+    std::vector<std::string> res;
+    for (size_t i = 0; i + 2 < codepoints.size(); ++i) {
+        res.push_back(codepoints[i] + codepoints[i + 1] + codepoints[i + 2]);
+    }
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+static bool is_ascii_alnum(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// Returns the position after the character class that starts at `pos`.
+static size_t skip_char_class(const std::string &pattern, size_t pos) {
+    size_t i = pos + 1;
+    if (i < pattern.size() && pattern[i] == '^') {
+        ++i;
+    }
+    // A `]` right at the start is part of the class.
+    if (i < pattern.size() && pattern[i] == ']') {
+        ++i;
+    }
+    while (i < pattern.size()) {
+        if (pattern[i] == '\\') {
+            i += 2;
+        } else if (pattern.compare(i, 2, "[:") == 0) {
+            const size_t close = pattern.find(":]", i + 2);
+            i = close == std::string::npos ? pattern.size() : close + 2;
+        } else if (pattern[i] == ']') {
+            return i + 1;
+        } else {
+            ++i;
+        }
+    }
+    return pattern.size();
+}
+
+// Returns the position after the escape sequence that starts at `pos`, whose second
+// character is a letter or a digit, as in `\d`, `\x41` or `\p{Greek}`.
+static size_t skip_escape(const std::string &pattern, size_t pos) {
+    const char c = pattern[pos + 1];
+    size_t i = pos + 2;
+    if (c == 'x' || c == 'p' || c == 'P') {
+        if (i < pattern.size() && pattern[i] == '{') {
+            const size_t close = pattern.find('}', i);
+            i = close == std::string::npos ? pattern.size() : close + 1;
+        } else {
+            i += c == 'x' ? 2 : 1;
+        }
+    } else if (c >= '0' && c <= '9') {
+        // Octal escapes have up to three digits.
+        for (size_t end = pos + 4; i < end && i < pattern.size()
+                 && pattern[i] >= '0' && pattern[i] <= '9'; ++i) { }
+    }
+    return std::min(i, pattern.size());
+}
+
+bool find_required_trigram(const std::string &pattern, std::string *trigram_out) {
+    // Patterns that RE2 rejects have to fail the same way with or without an index.
+    re2::RE2 regexp(pattern, re2::RE2::Quiet);
+    if (!regexp.ok()) {
+        return false;
+    }
+    // Without flags, the pattern is case-sensitive, so that the index only has to
+    // fold the case of the strings to find the ones that match case-insensitively.
+    // With `(?i)`, RE2 matches `k` and `s` with the Kelvin sign and the long s too,
+    // whose trigrams the index doesn't fold.
+    const bool may_fold_case = pattern.find("(?") != std::string::npos;
+
+    // The runs of literal text that the pattern requires, and for every open group
+    // the number of runs in front of it
+    std::vector<std::string> runs;
+    std::vector<size_t> groups;
+    std::string run;
+    auto end_run = [&]() {
+        if (!run.empty()) {
+            runs.push_back(std::move(run));
+            run.clear();
+        }
+    };
+    // A quantifier makes the code point in front of it optional.
+    auto drop_last_codepoint = [&]() {
+        while (!run.empty() && (run.back() & 0xC0) == 0x80) {
+            run.pop_back();
+        }
+        if (!run.empty()) {
+            run.pop_back();
+        }
+    };
+
+    size_t i = 0;
+    while (i < pattern.size()) {
+        switch (pattern[i]) {
+        case '|':
+            // An alternative doesn't have to contain the text around it.
+            return false;
+        case '*': // fallthru
+        case '?':
+            drop_last_codepoint();
+            end_run();
+            ++i;
+            break;
+        case '{': {
+            drop_last_codepoint();
+            end_run();
+            const size_t close = pattern.find('}', i);
+            i = close == std::string::npos ? pattern.size() : close + 1;
+        } break;
+        case '[':
+            end_run();
+            i = skip_char_class(pattern, i);
+            break;
+        case '(':
+            end_run();
+            groups.push_back(runs.size());
+            ++i;
+            if (i < pattern.size() && pattern[i] == '?') {
+                // Skips flags and names, as in `(?i)`, `(?s:` and `(?P<name>`.
+                const size_t close = pattern[i + 1] == 'P'
+                    ? pattern.find('>', i)
+                    : pattern.find_first_of(":)", i);
+                i = close == std::string::npos ? pattern.size() : close + 1;
+                if (pattern[i - 1] == ')' && !groups.empty()) {
+                    groups.pop_back();
+                }
+            }
+            break;
+        case ')':
+            end_run();
+            ++i;
+            if (!groups.empty()) {
+                // The text in an optional group isn't required.
+                if (i < pattern.size()
+                    && (pattern[i] == '*' || pattern[i] == '?' || pattern[i] == '{')) {
+                    runs.resize(groups.back());
+                }
+                groups.pop_back();
+            }
+            break;
+        case '\\':
+            if (i + 1 >= pattern.size()) {
+                return false;
+            }
+            if (is_ascii_alnum(pattern[i + 1])) {
+                // `\Q...\E` quotes text that would otherwise look like operators.
+                if (pattern[i + 1] == 'Q') {
+                    return false;
+                }
+                end_run();
+                i = skip_escape(pattern, i);
+            } else {
+                run.push_back(pattern[i + 1]);
+                i += 2;
+            }
+            break;
+        case '+': // fallthru
+        case '.': // fallthru
+        case '^': // fallthru
+        case '$':
+            end_run();
+            ++i;
+            break;
+        default:
+            run.push_back(pattern[i]);
+            ++i;
+            break;
+        }
+    }
+    end_run();
+
+    for (const std::string &literal : runs) {
+        const std::vector<std::string> codepoints = split_folded_codepoints(literal);
+        for (size_t j = 0; j + 2 < codepoints.size(); ++j) {
+            std::string trigram = codepoints[j] + codepoints[j + 1] + codepoints[j + 2];
+            if (may_fold_case
+                && (trigram.size() != 3
+                    || trigram.find_first_of("ks") != std::string::npos)) {
+                continue;
+            }
+            *trigram_out = std::move(trigram);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace ql
@@ -0,0 +1,27 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_TRIGRAMS_HPP_
+#define RDB_PROTOCOL_TRIGRAMS_HPP_
+
+#include <string>
+#include <vector>
+
+namespace ql {
+
+/* `str.trigrams()` returns the trigrams of a string, which are its substrings of three
+code points, with ASCII letters lowercased.  A multi index on the trigrams of a field
+has an entry for every substring that any of the strings in the field contain, so a
+`match` filter whose regular expression requires some literal text only has to look at
+the rows that the index has for one of that text's trigrams. */
+
+// Returns the distinct trigrams of `str`, in sorted order.
+std::vector<std::string> string_trigrams(const std::string &str);
+
+// Sets `*trigram_out` to a trigram that every string that the RE2 regular expression
+// `pattern` matches contains, and returns true, or returns false if there is no such
+// trigram or this can't tell.  Only literal text outside of alternations and optional
+// groups counts.
+bool find_required_trigram(const std::string &pattern, std::string *trigram_out);
+
+} // namespace ql
+
+#endif // RDB_PROTOCOL_TRIGRAMS_HPP_
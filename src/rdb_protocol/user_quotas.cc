@@ -0,0 +1,188 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/user_quotas.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "arch/timing.hpp"
+#include "config/args.hpp"
+#include "utils.hpp"
+
+namespace ql {
+
+user_quota_t::user_quota_t() :
+    max_concurrent_queries(0),
+    max_read_bytes_per_sec(0),
+    max_write_ops_per_sec(0),
+    max_priority(query_priority_t::HIGH) { }
+
+bool parse_user_quota(const std::string &spec,
+                      std::string *username_out,
+                      user_quota_t *quota_out,
+                      std::string *error_out) {
+    const size_t colon = spec.rfind(':');
+    if (colon == std::string::npos || colon == 0) {
+        *error_out = "expected `user:key=value,...`";
+        return false;
+    }
+    *username_out = spec.substr(0, colon);
+    *quota_out = user_quota_t();
+
+    size_t begin = colon + 1;
+    while (begin < spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        const std::string setting = spec.substr(begin, end - begin);
+        begin = end + 1;
+
+        const size_t equals = setting.find('=');
+        if (equals == std::string::npos) {
+            *error_out = strprintf("expected `key=value` instead of `%s`",
+                                   setting.c_str());
+            return false;
+        }
+        const std::string key = setting.substr(0, equals);
+        const std::string value = setting.substr(equals + 1);
+        if (key == "priority") {
+            if (!parse_query_priority(value, &quota_out->max_priority)) {
+                *error_out = strprintf("unknown priority `%s`", value.c_str());
+                return false;
+            }
+            continue;
+        }
+        uint64_t *limit_out;
+        if (key == "concurrent_queries") {
+            limit_out = &quota_out->max_concurrent_queries;
+        } else if (key == "read_bytes_per_sec") {
+            limit_out = &quota_out->max_read_bytes_per_sec;
+        } else if (key == "write_ops_per_sec") {
+            limit_out = &quota_out->max_write_ops_per_sec;
+        } else {
+            *error_out = strprintf("unknown key `%s`", key.c_str());
+            return false;
+        }
+        if (!strtou64_strict(value, 10, limit_out)) {
+            *error_out = strprintf("expected a number for `%s` instead of `%s`",
+                                   key.c_str(), value.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+user_quotas_t::user_quotas_t(const std::map<std::string, user_quota_t> &quotas) {
+    for (const auto &pair : quotas) {
+        usages[pair.first].init(new usage_t(pair.second));
+    }
+}
+
+user_quotas_t::~user_quotas_t() { }
+
+user_quotas_t::usage_t *user_quotas_t::find(const std::string &username) {
+    auto it = usages.find(username);
+    return it == usages.end() ? nullptr : it->second.get();
+}
+
+user_quotas_t::running_query_t::running_query_t() : parent(nullptr) { }
+
+user_quotas_t::running_query_t::~running_query_t() {
+    if (parent != nullptr) {
+        parent->running.fetch_sub(1);
+    }
+}
+
+// Both budgets start out full, and hold up to one second worth of their rate.
+user_quotas_t::usage_t::usage_t(const user_quota_t &_quota) :
+    quota(_quota),
+    running(0),
+    read_budget(quota.max_read_bytes_per_sec),
+    write_budget(quota.max_write_ops_per_sec),
+    last_refill(current_microtime()) { }
+
+int64_t user_quotas_t::usage_t::refill_and_get_wait_ms() {
+    const microtime_t now = current_microtime();
+    const double secs = (now - std::min(last_refill, now)) / static_cast<double>(MILLION);
+    last_refill = now;
+
+    int64_t wait_ms = 0;
+    if (quota.max_read_bytes_per_sec != 0) {
+        const double rate = quota.max_read_bytes_per_sec;
+        read_budget = std::min(rate, read_budget + secs * rate);
+        if (read_budget < 0) {
+            wait_ms = std::max<int64_t>(wait_ms, -read_budget * THOUSAND / rate + 1);
+        }
+    }
+    if (quota.max_write_ops_per_sec != 0) {
+        const double rate = quota.max_write_ops_per_sec;
+        write_budget = std::min(rate, write_budget + secs * rate);
+        if (write_budget < 0) {
+            wait_ms = std::max<int64_t>(wait_ms, -write_budget * THOUSAND / rate + 1);
+        }
+    }
+    return wait_ms;
+}
+
+bool user_quotas_t::usage_t::start_query(running_query_t *running_out,
+                                         std::string *error_out,
+                                         signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    guarantee(running_out->parent == nullptr);
+    const uint64_t already_running = running.fetch_add(1);
+    running_out->parent = this;
+    if (quota.max_concurrent_queries != 0
+        && already_running >= quota.max_concurrent_queries) {
+        *error_out = strprintf("The user already runs the %" PRIu64 " concurrent "
+                               "queries that its quota allows.",
+                               quota.max_concurrent_queries);
+        return false;
+    }
+
+    if (!wait_for_budget(USER_QUOTA_MAX_WAIT_MS, interruptor)) {
+        *error_out = "The user has used up its quota of reads or writes for now.";
+        return false;
+    }
+    return true;
+}
+
+void user_quotas_t::usage_t::throttle(signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    bool res = wait_for_budget(std::numeric_limits<int64_t>::max(), interruptor);
+    guarantee(res);
+}
+
+bool user_quotas_t::usage_t::wait_for_budget(int64_t max_wait_ms,
+                                             signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    int64_t waited_ms = 0;
+    for (;;) {
+        int64_t wait_ms;
+        {
+            spinlock_acq_t acq(&lock);
+            wait_ms = refill_and_get_wait_ms();
+        }
+        if (wait_ms == 0) {
+            return true;
+        }
+        if (wait_ms > max_wait_ms - waited_ms) {
+            return false;
+        }
+        nap(wait_ms, interruptor);
+        waited_ms += wait_ms;
+    }
+}
+
+void user_quotas_t::usage_t::charge(uint64_t read_bytes, uint64_t write_ops) {
+    spinlock_acq_t acq(&lock);
+    if (quota.max_read_bytes_per_sec != 0) {
+        read_budget -= read_bytes;
+    }
+    if (quota.max_write_ops_per_sec != 0) {
+        write_budget -= write_ops;
+    }
+}
+
+}  // namespace ql
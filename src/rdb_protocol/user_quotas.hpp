@@ -0,0 +1,115 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_USER_QUOTAS_HPP_
+#define RDB_PROTOCOL_USER_QUOTAS_HPP_
+
+#include <atomic>
+#include <map>
+#include <string>
+
+#include "arch/spinlock.hpp"
+#include "concurrency/interruptor.hpp"
+#include "containers/scoped.hpp"
+#include "rdb_protocol/admission_control.hpp"
+#include "time.hpp"
+
+namespace ql {
+
+/* What the queries of one user may use on this server, set with `--user-quota`.  A
+limit of 0 means that there is none.  Each write query counts as one write operation,
+however many documents it writes.  The reads and writes of a query are only known once
+it has run, so they're charged afterwards, and the user's next queries wait until the
+rates have caught up with them. */
+struct user_quota_t {
+    user_quota_t();
+
+    uint64_t max_concurrent_queries;
+    uint64_t max_read_bytes_per_sec;
+    uint64_t max_write_ops_per_sec;
+    // The user's queries run at this priority if they ask for a higher one.
+    query_priority_t max_priority;
+};
+
+/* Parses `user:key=value,...`, where the keys are `concurrent_queries`,
+`read_bytes_per_sec`, `write_ops_per_sec` and `priority`.  Returns false and sets
+`*error_out` if `spec` is invalid. */
+bool parse_user_quota(const std::string &spec,
+                      std::string *username_out,
+                      user_quota_t *quota_out,
+                      std::string *error_out);
+
+/* Keeps track of what the users with a quota use, across all threads.  The set of users
+doesn't change once this is constructed, so only the usage of each user has to be
+synchronized. */
+class user_quotas_t {
+public:
+    class usage_t;
+
+    explicit user_quotas_t(const std::map<std::string, user_quota_t> &quotas);
+    ~user_quotas_t();
+
+    // The usage of `username`, or null if the user doesn't have a quota.
+    usage_t *find(const std::string &username);
+
+    /* Counts one running query of a user while it exists. */
+    class running_query_t {
+    public:
+        running_query_t();
+        ~running_query_t();
+    private:
+        friend class usage_t;
+        usage_t *parent;
+        DISABLE_COPYING(running_query_t);
+    };
+
+    class usage_t {
+    public:
+        explicit usage_t(const user_quota_t &_quota);
+
+        const user_quota_t quota;
+
+        /* Waits until the user's reads and writes are back within their rates, and
+        counts the query in `running_out`.  Returns false and sets `*error_out` if the
+        user already runs its maximum number of queries, or if it would have to wait
+        for longer than `USER_QUOTA_MAX_WAIT_MS`. */
+        bool start_query(running_query_t *running_out,
+                         std::string *error_out,
+                         signal_t *interruptor) THROWS_ONLY(interrupted_exc_t);
+
+        /* Waits for as long as it takes the user to get back within its rates.  This
+        is for the later batches of streams, which shouldn't fail once they started. */
+        void throttle(signal_t *interruptor) THROWS_ONLY(interrupted_exc_t);
+
+        // Called once a query has read `read_bytes` and written `write_ops` times.
+        void charge(uint64_t read_bytes, uint64_t write_ops);
+
+    private:
+        friend class running_query_t;
+
+        // How many milliseconds pass until the budgets have caught up.  Has to be
+        // called with `lock` held.
+        int64_t refill_and_get_wait_ms();
+
+        // Returns false if that would take longer than `max_wait_ms`.
+        bool wait_for_budget(int64_t max_wait_ms, signal_t *interruptor)
+            THROWS_ONLY(interrupted_exc_t);
+
+        std::atomic<uint64_t> running;
+        spinlock_t lock;
+        // The reads and writes that the user may make right away, which go below 0
+        // when a query used more than there was.
+        double read_budget;
+        double write_budget;
+        microtime_t last_refill;
+
+        DISABLE_COPYING(usage_t);
+    };
+
+private:
+    std::map<std::string, scoped_ptr_t<usage_t> > usages;
+
+    DISABLE_COPYING(user_quotas_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_USER_QUOTAS_HPP_
@@ -480,6 +480,10 @@ const std::string &table_t::get_pkey() const {
     return tbl->get_pkey();
 }
 
+key_generation_t table_t::get_key_generation() const {
+    return tbl->get_key_generation();
+}
+
 datum_t table_t::get_row(env_t *env, datum_t pval) {
     return tbl->read_row(env, pval, read_mode);
 }
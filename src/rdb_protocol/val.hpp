@@ -35,6 +35,7 @@ public:
             read_mode_t _read_mode, backtrace_id_t src);
     namespace_id_t get_id() const;
     const std::string &get_pkey() const;
+    key_generation_t get_key_generation() const;
     datum_t get_row(env_t *env, datum_t pval);
     counted_t<datum_stream_t> get_all(
             env_t *env,
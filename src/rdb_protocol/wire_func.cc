@@ -1,15 +1,24 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/wire_func.hpp"
 
+#include "config/args.hpp"
 #include "containers/archive/optional.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "containers/archive/archive.hpp"
+#include "containers/archive/string_stream.hpp"
+#include "containers/lru_cache.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rdb_protocol/ql2.pb.h"
 #include "rdb_protocol/term_walker.hpp"
 #include "stl_utils.hpp"
+#include "thread_local.hpp"
+
+// The compiled ReQL functions that this thread recently deserialized, keyed by their
+// serialized captured scope, argument names and body.  See `WIRE_FUNC_CACHE_SIZE`.
+typedef lru_cache_t<std::string, counted_t<const ql::func_t> > compiled_wire_funcs_t;
+TLS_with_init(compiled_wire_funcs_t *, compiled_wire_funcs, nullptr);
 
 namespace ql {
 
@@ -22,8 +31,9 @@ wire_func_t::wire_func_t(const counted_t<const func_t> &f) : func(f) {
 wire_func_t::wire_func_t(const raw_term_t &body,
                          std::vector<sym_t> arg_names) {
     compile_env_t env(var_visibility_t().with_func_arg_name_list(arg_names));
-    func = make_counted<reql_func_t>(var_scope_t(),
-                                     arg_names, compile_term(&env, body));
+    counted_t<const term_t> term_tree = compile_term(&env, body);
+    term_tree->hoist_invariants();
+    func = make_counted<reql_func_t>(var_scope_t(), arg_names, std::move(term_tree));
 }
 
 wire_func_t::wire_func_t(const wire_func_t &copyee)
@@ -127,6 +137,7 @@ archive_result_t deserialize(read_stream_t *s, wire_func_t *wf) {
         compile_env_t env(scope.compute_visibility().with_func_arg_name_list(arg_names));
         counted_t<const term_t> term_tree =
             compile_term(&env, term_storage->root_term());
+        term_tree->hoist_invariants();
         wf->func = make_counted<reql_func_t>(std::move(term_storage),
                                              scope, arg_names,
                                              std::move(term_tree));
@@ -162,6 +173,77 @@ template archive_result_t deserialize<cluster_version_t::v1_16>(
 template archive_result_t deserialize<cluster_version_t::v2_0>(
         read_stream_t *, wire_func_t *);
 
+/* Reads the body of a ReQL function with the given captured scope and arguments, and
+compiles it.  From 2.2 on, the body is serialized as JSON text, which we use to look up
+the function in the thread's cache of compiled functions before parsing it. */
+template <cluster_version_t W>
+archive_result_t deserialize_reql_func_body(
+        read_stream_t *s,
+        const var_scope_t &scope,
+        const std::vector<sym_t> &arg_names,
+        counted_t<const func_t> *func_out) {
+    scoped_ptr_t<term_storage_t> term_storage;
+    std::string cache_key;
+    if (W == cluster_version_t::v2_1) {
+        archive_result_t res = deserialize_term_tree<W>(s, &term_storage);
+        if (bad(res)) { return res; }
+    } else {
+        // The same format as `deserialize_term_tree<cluster_version_t::v2_2>()`
+        int32_t size;
+        archive_result_t res = deserialize_universal(s, &size);
+        if (bad(res)) { return res; }
+        if (size < 0) { return archive_result_t::RANGE_ERROR; }
+
+        scoped_array_t<char> data(size);
+        int64_t read_res = force_read(s, data.data(), data.size());
+        if (read_res != size) { return archive_result_t::SOCK_ERROR; }
+
+        if (size <= WIRE_FUNC_CACHE_MAX_SIZE) {
+            write_message_t wm;
+            serialize<cluster_version_t::CLUSTER>(&wm, scope);
+            serialize<cluster_version_t::CLUSTER>(&wm, arg_names);
+            string_stream_t stream;
+            int write_res = send_write_message(&stream, &wm);
+            guarantee(write_res == 0);
+            cache_key = std::move(stream.str());
+            cache_key.append(data.data(), data.size());
+            if (cache_key.size() > WIRE_FUNC_CACHE_MAX_SIZE) {
+                cache_key.clear();
+            }
+        }
+        compiled_wire_funcs_t *cache = TLS_get_compiled_wire_funcs();
+        if (!cache_key.empty() && cache != nullptr) {
+            auto it = cache->find(cache_key);
+            if (it != cache->end()) {
+                *func_out = it->second;
+                return archive_result_t::SUCCESS;
+            }
+        }
+
+        rapidjson::Document doc;
+        doc.ParseInsitu(data.data());
+        term_storage.init(new wire_term_storage_t(std::move(data), std::move(doc)));
+    }
+
+    compile_env_t env(scope.compute_visibility().with_func_arg_name_list(arg_names));
+    counted_t<const term_t> term_tree = compile_term(&env, term_storage->root_term());
+    term_tree->hoist_invariants();
+    *func_out = make_counted<reql_func_t>(std::move(term_storage),
+                                          scope, arg_names,
+                                          std::move(term_tree));
+
+    if (!cache_key.empty()) {
+        compiled_wire_funcs_t *cache = TLS_get_compiled_wire_funcs();
+        if (cache == nullptr) {
+            // The cache of each thread lives as long as the process.
+            cache = new compiled_wire_funcs_t(WIRE_FUNC_CACHE_SIZE);
+            TLS_set_compiled_wire_funcs(cache);
+        }
+        (*cache)[std::move(cache_key)] = *func_out;
+    }
+    return archive_result_t::SUCCESS;
+}
+
 // deserialize function for 2.1 and above
 template <cluster_version_t W>
 archive_result_t deserialize_wire_func(
@@ -181,20 +263,15 @@ archive_result_t deserialize_wire_func(
         res = deserialize<W>(s, &arg_names);
         if (bad(res)) { return res; }
 
-        scoped_ptr_t<term_storage_t> term_storage;
-        res = deserialize_term_tree<W>(s, &term_storage);
+        counted_t<const func_t> func;
+        res = deserialize_reql_func_body<W>(s, scope, arg_names, &func);
         if (bad(res)) { return res; }
 
         backtrace_id_t bt;
         res = deserialize<W>(s, &bt);
         if (bad(res)) { return res; }
 
-        compile_env_t env(scope.compute_visibility().with_func_arg_name_list(arg_names));
-        counted_t<const term_t> term_tree =
-            compile_term(&env, term_storage->root_term());
-        wf->func = make_counted<reql_func_t>(std::move(term_storage),
-                                             scope, arg_names,
-                                             std::move(term_tree));
+        wf->func = std::move(func);
         return res;
     }
     case wire_func_type_t::JS: {
@@ -304,6 +381,31 @@ backtrace_id_t group_wire_func_t::get_bt() const {
     return bt;
 }
 
+top_k_wire_func_t::top_k_wire_func_t(
+        const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+            &comparisons,
+        uint64_t _n,
+        backtrace_id_t _bt)
+    : n(_n), bt(_bt) {
+    funcs.reserve(comparisons.size());
+    directions.reserve(comparisons.size());
+    for (const auto &pair : comparisons) {
+        directions.push_back(pair.first);
+        funcs.push_back(wire_func_t(pair.second));
+    }
+}
+
+std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+top_k_wire_func_t::compile_comparisons() const {
+    guarantee(funcs.size() == directions.size());
+    std::vector<std::pair<order_direction_t, counted_t<const func_t> > > ret;
+    ret.reserve(funcs.size());
+    for (size_t i = 0; i < funcs.size(); ++i) {
+        ret.push_back(std::make_pair(directions[i], funcs[i].compile_wire_func()));
+    }
+    return ret;
+}
+
 bool wire_func_t::is_simple_selector() const {
     return func->is_simple_selector();
 }
@@ -318,4 +420,6 @@ RDB_IMPL_SERIALIZABLE_2_SINCE_v1_13(filter_wire_func_t, filter_func, default_fil
 
 RDB_MAKE_SERIALIZABLE_1_FOR_CLUSTER(distinct_wire_func_t, use_index);
 
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(top_k_wire_func_t, funcs, directions, n, bt);
+
 }  // namespace ql
@@ -2,12 +2,14 @@
 #ifndef RDB_PROTOCOL_WIRE_FUNC_HPP_
 #define RDB_PROTOCOL_WIRE_FUNC_HPP_
 
+#include <utility>
 #include <vector>
 
 #include "containers/counted.hpp"
 #include "containers/optional.hpp"
 #include "rdb_protocol/sym.hpp"
 #include "rdb_protocol/error.hpp"
+#include "rdb_protocol/order_util.hpp"
 #include "rpc/serialize_macros.hpp"
 #include "version.hpp"
 
@@ -141,6 +143,26 @@ public:
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(distinct_wire_func_t);
 
+// The first `n` rows of `orderBy(...).limit(n)` on a stream without an index.  Every
+// shard only sends back its own first `n` rows, and those get merged.
+class top_k_wire_func_t {
+public:
+    top_k_wire_func_t() : n(0), bt(backtrace_id_t::empty()) { }
+    top_k_wire_func_t(
+        const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+            &comparisons,
+        uint64_t _n,
+        backtrace_id_t _bt);
+    std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+    compile_comparisons() const;
+
+    std::vector<wire_func_t> funcs;
+    std::vector<order_direction_t> directions;
+    uint64_t n;
+    backtrace_id_t bt;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(top_k_wire_func_t);
+
 template <class T>
 class skip_terminal_t;
 
@@ -0,0 +1,210 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/write_coalescer.hpp"
+
+#include <algorithm>
+#include <map>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/wait_any.hpp"
+#include "config/args.hpp"
+#include "rdb_protocol/env.hpp"
+
+bool write_coalescer_t::spec_t::operator==(const spec_t &other) const {
+    return table_id == other.table_id
+        && user_context == other.user_context
+        && durability == other.durability
+        && conflict_behavior == other.conflict_behavior;
+}
+
+/* The primary key of the document that a change from `return_changes: "always"` is
+about.  For errors, `fake_new_val` has the document that failed to be inserted, or
+`old_val` has the document that was in the way. */
+static optional<store_key_t> change_key(const ql::datum_t &change,
+                                        const datum_string_t &pkey) {
+    for (const char *field : {"fake_new_val", "new_val", "old_val"}) {
+        ql::datum_t row = change.get_field(field, ql::NOTHROW);
+        if (row.has() && row.get_type() == ql::datum_t::R_OBJECT) {
+            ql::datum_t pval = row.get_field(pkey, ql::NOTHROW);
+            if (pval.has()) {
+                return make_optional(store_key_t(pval.print_primary()));
+            }
+        }
+    }
+    return r_nullopt;
+}
+
+/* What `rdb_batched_replace()` would have returned for a batch of just the document
+that `change` is about. */
+static ql::datum_t single_insert_result(const ql::datum_t &change,
+                                        return_changes_t return_changes,
+                                        const ql::datum_t &warnings) {
+    ql::datum_object_builder_t result;
+    bool changed = false;
+    ql::datum_t error = change.get_field("error", ql::NOTHROW);
+    if (error.has()) {
+        result.add_error(error.as_str().to_std().c_str());
+    } else {
+        ql::datum_t old_val = change.get_field("old_val");
+        ql::datum_t new_val = change.get_field("new_val");
+        const bool started_empty = old_val.get_type() == ql::datum_t::R_NULL;
+        const bool ended_empty = new_val.get_type() == ql::datum_t::R_NULL;
+        changed = old_val != new_val;
+        const char *field = started_empty
+            ? (ended_empty ? "skipped" : "inserted")
+            : (ended_empty ? "deleted" : (changed ? "replaced" : "unchanged"));
+        result.overwrite(field, ql::datum_t(1.0));
+    }
+    ql::datum_array_builder_t changes(ql::configured_limits_t::unlimited);
+    switch (return_changes) {
+    case return_changes_t::NO: break;
+    case return_changes_t::YES:
+        if (changed) {
+            changes.add(change);
+        }
+        result.overwrite("changes", std::move(changes).to_datum());
+        break;
+    case return_changes_t::ALWAYS:
+        changes.add(change);
+        result.overwrite("changes", std::move(changes).to_datum());
+        break;
+    default: unreachable();
+    }
+    if (warnings.has()) {
+        result.overwrite("warnings", warnings);
+    }
+    return std::move(result).to_datum();
+}
+
+write_coalescer_t::write_coalescer_t() { }
+
+optional<ql::datum_t> write_coalescer_t::insert(ql::env_t *env,
+                                                const spec_t &spec,
+                                                const datum_string_t &pkey,
+                                                ql::datum_t doc,
+                                                return_changes_t return_changes,
+                                                const batch_writer_t &write) {
+    thread_state_t *state = states.get();
+    store_key_t key(doc.get_field(pkey).print_primary());
+    auto group = std::find_if(state->groups.begin(), state->groups.end(),
+                              [&](const group_t &g) { return g.spec == spec; });
+    if (group == state->groups.end()) {
+        group_t new_group;
+        new_group.spec = spec;
+        new_group.pkey = pkey;
+        new_group.in_flight = 0;
+        group = state->groups.insert(state->groups.end(), std::move(new_group));
+    } else if (group->queued_keys.count(key) != 0) {
+        // The two inserts would get mixed up in the batch's result.
+        return r_nullopt;
+    }
+
+    auto waiter = std::make_shared<waiter_t>();
+    waiter->key = key;
+    waiter->doc = std::move(doc);
+    waiter->return_changes = return_changes;
+    waiter->write = write;
+    waiter->ctx = env->get_rdb_ctx();
+    waiter->serializable_env = env->get_serializable_env();
+    waiter->sent = false;
+    group->queued.push_back(waiter);
+    group->queued_keys.insert(key);
+    maybe_send(state, group);
+
+    try {
+        wait_interruptible(&waiter->done, env->interruptor);
+    } catch (const interrupted_exc_t &) {
+        // If the insert hasn't been sent yet we can still take it back.  Otherwise
+        // its batch is responsible for it.
+        if (!waiter->sent) {
+            group->queued.erase(
+                std::find(group->queued.begin(), group->queued.end(), waiter));
+            group->queued_keys.erase(key);
+            if (group->in_flight == 0 && group->queued.empty()) {
+                state->groups.erase(group);
+            }
+        }
+        throw;
+    }
+    if (waiter->error) {
+        std::rethrow_exception(waiter->error);
+    }
+    return make_optional(waiter->result);
+}
+
+void write_coalescer_t::maybe_send(thread_state_t *state,
+                                   std::list<group_t>::iterator group) {
+    while (group->in_flight < WRITE_COALESCING_MAX_IN_FLIGHT
+           && !group->queued.empty()) {
+        const size_t size = std::min<size_t>(group->queued.size(),
+                                             WRITE_COALESCING_MAX_BATCH_SIZE);
+        std::vector<std::shared_ptr<waiter_t> > batch(
+            group->queued.begin(), group->queued.begin() + size);
+        group->queued.erase(group->queued.begin(), group->queued.begin() + size);
+        for (const auto &waiter : batch) {
+            group->queued_keys.erase(waiter->key);
+            waiter->sent = true;
+        }
+        ++group->in_flight;
+        coro_t::spawn_sometime(std::bind(&write_coalescer_t::write_batch,
+                                         this, state, group, std::move(batch),
+                                         state->drainer.lock()));
+    }
+}
+
+void write_coalescer_t::write_batch(thread_state_t *state,
+                                    std::list<group_t>::iterator group,
+                                    std::vector<std::shared_ptr<waiter_t> > batch,
+                                    auto_drainer_t::lock_t keepalive) {
+    // The batch is written in the environment of its first insert, but with our own
+    // interruptor, because it mustn't fail when just that query is interrupted.
+    const waiter_t &first = *batch[0];
+    std::vector<ql::datum_t> docs;
+    docs.reserve(batch.size());
+    for (const auto &waiter : batch) {
+        docs.push_back(waiter->doc);
+    }
+    try {
+        ql::env_t env(first.ctx,
+                      ql::return_empty_normal_batches_t::NO,
+                      keepalive.get_drain_signal(),
+                      first.serializable_env,
+                      nullptr);
+        ql::datum_t res = first.write(&env, std::move(docs));
+
+        std::map<store_key_t, ql::datum_t> changes_by_key;
+        ql::datum_t changes = res.get_field("changes", ql::NOTHROW);
+        if (changes.has()) {
+            for (size_t i = 0; i < changes.arr_size(); ++i) {
+                ql::datum_t change = changes.get(i);
+                if (optional<store_key_t> key = change_key(change, group->pkey)) {
+                    changes_by_key[*key] = change;
+                }
+            }
+        }
+        ql::datum_t warnings = res.get_field("warnings", ql::NOTHROW);
+        for (const auto &waiter : batch) {
+            auto it = changes_by_key.find(waiter->key);
+            if (it != changes_by_key.end()) {
+                waiter->result = single_insert_result(
+                    it->second, waiter->return_changes, warnings);
+            } else {
+                waiter->error = std::make_exception_ptr(ql::datum_exc_t(
+                    ql::base_exc_t::OP_INDETERMINATE,
+                    "The result of the insert got lost in a coalesced write."));
+            }
+        }
+    } catch (...) {
+        for (const auto &waiter : batch) {
+            waiter->error = std::current_exception();
+        }
+    }
+    for (const auto &waiter : batch) {
+        waiter->done.pulse();
+    }
+
+    --group->in_flight;
+    maybe_send(state, group);
+    if (group->in_flight == 0 && group->queued.empty()) {
+        state->groups.erase(group);
+    }
+}
@@ -0,0 +1,106 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_WRITE_COALESCER_HPP_
+#define RDB_PROTOCOL_WRITE_COALESCER_HPP_
+
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "clustering/administration/auth/user_context.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/one_per_thread.hpp"
+#include "containers/uuid.hpp"
+#include "protocol_api.hpp"
+#include "rdb_protocol/context.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/protocol.hpp"
+
+namespace ql {
+class env_t;
+}
+
+/* With `--coalesce-writes`, the single-document inserts that queries on the same thread
+make into the same table are merged into one `batched_insert_t` while the table's
+earlier batches are still being written.  An insert is sent right away if fewer than
+`WRITE_COALESCING_MAX_IN_FLIGHT` batches of its kind are in flight, so a lone insert
+doesn't get slower.  Otherwise it waits for one of them to finish, and all the inserts
+that collected by then are sent together.  The router splits the batch by shards, and
+every shard writes its part in one transaction.
+
+The batches are written with `return_changes: "always"`, so that every insert's result
+can be told apart by its primary key.  Only inserts with the same table, user,
+durability and conflict behavior can share a batch, and only if they have neither a
+write hook nor a conflict function, because those would run in the wrong query's
+environment. */
+class write_coalescer_t {
+public:
+    // What inserts must agree on to be written together
+    struct spec_t {
+        bool operator==(const spec_t &other) const;
+
+        namespace_id_t table_id;
+        auth::user_context_t user_context;
+        durability_requirement_t durability;
+        conflict_behavior_t conflict_behavior;
+    };
+
+    // Inserts `docs` with `return_changes_t::ALWAYS` in the given environment and
+    // returns the combined result.
+    typedef std::function<ql::datum_t(ql::env_t *, std::vector<ql::datum_t> &&)>
+        batch_writer_t;
+
+    write_coalescer_t();
+
+    // Returns the result that the insert of `doc` would have had by itself, or
+    // `r_nullopt` if it can't be coalesced because a waiting insert has the same key.
+    // Throws what `write` throws.
+    optional<ql::datum_t> insert(ql::env_t *env,
+                                 const spec_t &spec,
+                                 const datum_string_t &pkey,
+                                 ql::datum_t doc,
+                                 return_changes_t return_changes,
+                                 const batch_writer_t &write);
+
+private:
+    struct waiter_t {
+        store_key_t key;
+        ql::datum_t doc;
+        return_changes_t return_changes;
+        batch_writer_t write;
+        rdb_context_t *ctx;
+        serializable_env_t serializable_env;
+        // Whether it's been taken out of `group_t::queued` for a batch
+        bool sent;
+        cond_t done;
+        ql::datum_t result;
+        std::exception_ptr error;
+    };
+    struct group_t {
+        spec_t spec;
+        datum_string_t pkey;
+        size_t in_flight;
+        std::vector<std::shared_ptr<waiter_t> > queued;
+        std::set<store_key_t> queued_keys;
+    };
+    struct thread_state_t {
+        std::list<group_t> groups;
+        auto_drainer_t drainer;
+    };
+
+    void maybe_send(thread_state_t *state, std::list<group_t>::iterator group);
+    void write_batch(thread_state_t *state,
+                     std::list<group_t>::iterator group,
+                     std::vector<std::shared_ptr<waiter_t> > batch,
+                     auto_drainer_t::lock_t keepalive);
+
+    one_per_thread_t<thread_state_t> states;
+
+    DISABLE_COPYING(write_coalescer_t);
+};
+
+#endif  // RDB_PROTOCOL_WRITE_COALESCER_HPP_
@@ -5,8 +5,12 @@
 #include <netinet/in.h>
 #endif
 
+#include <zlib.h>
+
 #include <algorithm>
+#include <cstdlib>
 #include <functional>
+#include <limits>
 
 #include "arch/io/network.hpp"
 #include "arch/timing.hpp"
@@ -21,6 +25,7 @@
 #include "containers/object_buffer.hpp"
 #include "containers/uuid.hpp"
 #include "logger.hpp"
+#include "rpc/connectivity/failure_detector.hpp"
 #include "rpc/semilattice/watchable.hpp"
 #include "stl_utils.hpp"
 #include "utils.hpp"
@@ -133,7 +138,8 @@ connectivity_cluster_t::connection_t::connection_t(
         const peer_id_t &_peer_id,
         const server_id_t &_server_id,
         keepalive_tcp_conn_stream_t *_conn,
-        const peer_address_t &_peer_address) THROWS_NOTHING :
+        const peer_address_t &_peer_address,
+        bool _compress_messages) THROWS_NOTHING :
     conn(_conn),
     peer_address(_peer_address),
     flusher([&](signal_t *) {
@@ -145,13 +151,26 @@ connectivity_cluster_t::connection_t::connection_t(
         // must be handled elsewhere.
         this->conn->flush_buffer();
     }, 1),
+    compress_messages(_compress_messages),
+    round_trip_usecs(-1),
+    round_trip_jitter_usecs(-1),
+    last_round_trip_usecs(-1),
     pm_collection(),
     pm_bytes_sent(secs_to_ticks(1), true),
+    pm_bytes_before_compression(),
+    pm_bytes_after_compression(),
+    pm_compression(secs_to_ticks(1), true),
     pm_collection_membership(
         &_parent->parent->connectivity_collection,
         &pm_collection,
         uuid_to_str(_peer_id.get_uuid())),
     pm_bytes_sent_membership(&pm_collection, &pm_bytes_sent, "bytes_sent"),
+    pm_bytes_before_compression_membership(
+        &pm_collection, &pm_bytes_before_compression, "bytes_before_compression"),
+    pm_bytes_after_compression_membership(
+        &pm_collection, &pm_bytes_after_compression, "bytes_after_compression"),
+    pm_compression_membership(&pm_collection, &pm_compression, "compression"),
+    pm_round_trip_membership(&pm_collection, &pm_round_trip, "round_trip"),
     parent(_parent),
     peer_id(_peer_id),
     server_id(_server_id),
@@ -165,6 +184,19 @@ connectivity_cluster_t::connection_t::connection_t(
     });
 }
 
+void connectivity_cluster_t::connection_t::record_round_trip(int64_t usecs) {
+    pm_round_trip.record(usecs);
+    const int64_t previous = round_trip_usecs.load();
+    round_trip_usecs.store(previous < 0 ? usecs : (previous * 7 + usecs) / 8);
+    if (last_round_trip_usecs >= 0) {
+        const int64_t difference = std::abs(usecs - last_round_trip_usecs);
+        const int64_t jitter = round_trip_jitter_usecs.load();
+        round_trip_jitter_usecs.store(
+            jitter < 0 ? difference : jitter + (difference - jitter) / 16);
+    }
+    last_round_trip_usecs = usecs;
+}
+
 connectivity_cluster_t::connection_t::~connection_t() THROWS_NOTHING {
     // Drain out any users
     pmap(get_num_threads(), [this](int thread_id) {
@@ -221,11 +253,13 @@ connectivity_cluster_t::run_t::run_t(
             _heartbeat_sl_view,
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t> >
             _auth_sl_view,
-        tls_ctx_t *_tls_ctx)
+        tls_ctx_t *_tls_ctx,
+        bool _compress_messages)
         THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t) :
     parent(_parent),
     server_id(_server_id),
     tls_ctx(_tls_ctx),
+    compress_messages(_compress_messages),
 
     /* Create the socket to use when listening for connections from peers */
     cluster_listener_socket(new tcp_bound_socket_t(local_addresses, port)),
@@ -257,7 +291,8 @@ connectivity_cluster_t::run_t::run_t(
     `connection_map` on each thread and notifying any listeners that we're now
     connected to ourself. The destructor will remove us from the
     `connection_map` and again notify any listeners. */
-    connection_to_ourself(this, parent->me, _server_id, nullptr, routing_table[parent->me]),
+    connection_to_ourself(
+        this, parent->me, _server_id, nullptr, routing_table[parent->me], false),
 
     heartbeat_sl_view(_heartbeat_sl_view),
     auth_sl_view(_auth_sl_view),
@@ -452,10 +487,44 @@ private:
     DISABLE_COPYING(cluster_conn_closing_subscription_t);
 };
 
+/* `ping_writer_t` writes the body of a `ping_tag` message. A ping carries the
+`get_ticks()` of the server that sent it, and the other server sends it back as a reply
+unchanged. */
+class ping_writer_t : public cluster_send_message_write_callback_t {
+public:
+    ping_writer_t(bool _is_reply, ticks_t _ticks) : is_reply(_is_reply), ticks(_ticks) { }
+    virtual ~ping_writer_t() { }
+
+    void write(write_stream_t *stream) {
+        write_message_t wm;
+        serialize_universal(&wm, is_reply);
+        serialize_universal(&wm, static_cast<uint64_t>(ticks));
+        int res = send_write_message(stream, &wm);
+        if (res) { throw fake_archive_exc_t(); }
+    }
+
+#ifdef ENABLE_MESSAGE_PROFILER
+    const char *message_profiler_tag() const {
+        return "ping";
+    }
+#endif
+
+private:
+    bool is_reply;
+    ticks_t ticks;
+};
+
 /* `heartbeat_manager_t` is responsible for sending heartbeats over a single connection
-and making sure that heartbeats have arrived on time.
-`connectivity_cluster_t::run_t::handle()` constructs one after constructing the
-`connection_t`. */
+and making sure that heartbeats have arrived on time. Any other message that we sent
+during an interval counts as a heartbeat, so on a busy connection we send no heartbeats
+at all. If the other server answers pings, we also send a ping every
+`PING_INTERVALS` intervals, and instead of a heartbeat, so that we learn the round trip
+time.
+
+We give up on the connection if we haven't read anything for more than
+`HEARTBEAT_TIMEOUT_INTERVALS` intervals, or earlier if `failure_detector` says that the
+silence is very unusual for this connection. `connectivity_cluster_t::run_t::handle()`
+constructs one after constructing the `connection_t`. */
 class connectivity_cluster_t::heartbeat_manager_t :
     public keepalive_tcp_conn_stream_t::keepalive_callback_t,
     private repeating_timer_callback_t,
@@ -463,20 +532,29 @@ class connectivity_cluster_t::heartbeat_manager_t :
 {
 public:
     static const int HEARTBEAT_TIMEOUT_INTERVALS = 5;
+    static const int PING_INTERVALS = 5;
+    /* `failure_detector` can only kill the connection after this many intervals
+    without reads, and only if the suspicion level is above `PHI_THRESHOLD`. */
+    static const int MIN_SUSPECT_INTERVALS = 3;
+    static const int PHI_THRESHOLD = 8;
 
     heartbeat_manager_t(
             connectivity_cluster_t::connection_t *connection_,
             auto_drainer_t::lock_t connection_keepalive_,
             const std::string &peer_str_,
             clone_ptr_t<watchable_t<heartbeat_semilattice_metadata_t> >
-                heartbeat_sl_view_) :
+                heartbeat_sl_view_,
+            bool send_pings_) :
         connection(connection_),
         connection_keepalive(connection_keepalive_),
+        send_pings(send_pings_),
         read_done(false),
         write_done(false),
         intervals_since_last_read_done(0),
+        intervals_since_last_ping(0),
         peer_str(peer_str_),
         timeout(0),
+        failure_detector(1),
         heartbeat_sl_view(std::move(heartbeat_sl_view_)),
         heartbeat_sl_view_sub(std::bind(&heartbeat_manager_t::on_heartbeat_change, this))
     {
@@ -504,6 +582,7 @@ public:
     void on_ring() {
         ASSERT_FINITE_CORO_WAITING;
 
+        const int64_t now_ms = get_ticks() / MILLION;
         if (intervals_since_last_read_done > HEARTBEAT_TIMEOUT_INTERVALS) {
             logERR("Heartbeat timeout, killing connection to peer %s", peer_str.c_str());
 
@@ -513,7 +592,28 @@ public:
             connection->kill_connection();
             return;
         }
-        if (write_done) {
+        if (!read_done && intervals_since_last_read_done >= MIN_SUSPECT_INTERVALS) {
+            const double phi = failure_detector.phi(now_ms);
+            if (phi > PHI_THRESHOLD) {
+                logERR("Peer %s has been silent for unusually long (phi = %.1f), "
+                       "killing connection", peer_str.c_str(), phi);
+                connection->kill_connection();
+                return;
+            }
+        }
+        ++intervals_since_last_ping;
+        if (send_pings && (!write_done || intervals_since_last_ping >= PING_INTERVALS)) {
+            write_done = false;
+            intervals_since_last_ping = 0;
+            auto_drainer_t::lock_t this_keepalive(&drainer);
+            coro_t::spawn_later_ordered(
+                [this, this_keepalive /* important to capture */] {
+                    ping_writer_t writer(false, get_ticks());
+                    connection->parent->parent->send_message(
+                        connection, connection_keepalive,
+                        connectivity_cluster_t::ping_tag, &writer);
+                });
+        } else if (write_done) {
             write_done = false;
         } else {
             /* The purpose of `heartbeat_manager_keepalive` is to ensure that we don't
@@ -536,6 +636,7 @@ public:
                 intervals_since_last_read_done++;
             }
             read_done = false;
+            failure_detector.heartbeat(now_ms);
         } else {
             intervals_since_last_read_done++;
         }
@@ -571,15 +672,24 @@ public:
         timeout = timeout_new;
         timer = scoped_ptr_t<repeating_timer_t>(new repeating_timer_t(
             timeout / HEARTBEAT_TIMEOUT_INTERVALS, this));
+        /* We only notice reads once per interval, so the history is only accurate to
+        within an interval. The old history doesn't apply to the new interval. */
+        failure_detector.reset(
+            std::max<int64_t>(1, timeout / HEARTBEAT_TIMEOUT_INTERVALS / 4));
     }
 
 private:
     connectivity_cluster_t::connection_t *connection;
     auto_drainer_t::lock_t connection_keepalive;
+    bool send_pings;
     bool read_done, write_done;
     int64_t intervals_since_last_read_done;
+    int intervals_since_last_ping;
     std::string peer_str;
     int64_t timeout;
+    /* Fed with the times (in milliseconds) of the intervals in which we read
+    something */
+    phi_accrual_failure_detector_t failure_detector;
 
     /* Order is important here. When destroying the `heartbeat_manager_t`, we must first
     destroy the timer so that new `on_ring()` calls don't get spawned; then destroy the
@@ -739,6 +849,13 @@ public:
     static handshake_result_t success() {
         return handshake_result_t(handshake_result_code_t::SUCCESS);
     }
+    /* Servers that don't know about capabilities ignore the additional info of a
+    successful handshake, so we can use it to tell the other server what we support. */
+    static handshake_result_t success(const std::string &capabilities) {
+        handshake_result_t result(handshake_result_code_t::SUCCESS);
+        result.additional_info = capabilities;
+        return result;
+    }
     static handshake_result_t error(handshake_result_code_t error_code,
                                     const std::string &additional_info) {
         return handshake_result_t(error_code, additional_info);
@@ -748,6 +865,13 @@ public:
         return code;
     }
 
+    bool has_capability(const std::string &capability) const {
+        guarantee(code == handshake_result_code_t::SUCCESS);
+        std::vector<std::string> capabilities = split_string(additional_info, ' ');
+        return std::find(capabilities.begin(), capabilities.end(), capability)
+            != capabilities.end();
+    }
+
     std::string get_error_reason() const {
         if (code == handshake_result_code_t::UNKNOWN_ERROR) {
             return error_code_string + " (" + additional_info + ")";
@@ -834,6 +958,53 @@ archive_result_t deserialize_universal(read_stream_t *s, handshake_result_t *out
     return res;
 }
 
+/* Servers that can decompress `compressed_tag` messages announce this capability in
+their successful handshake result. */
+const char *const compression_capability = "deflate";
+
+/* Servers that answer `ping_tag` messages announce this capability. */
+const char *const ping_capability = "ping";
+
+/* A compressed message consists of `compressed_tag`, the tag of the actual message,
+the uncompressed and the compressed size, and then the data compressed with zlib. The
+compressed data holds what the message handler would otherwise have read from the
+stream. */
+void receive_compressed_message(read_stream_t *stream,
+                                connectivity_cluster_t::message_tag_t *tag_out,
+                                std::vector<char> *data_out) {
+    uint64_t uncompressed_size, compressed_size;
+    archive_result_t res = deserialize_universal(stream, tag_out);
+    if (bad(res)) { throw fake_archive_exc_t(); }
+    res = deserialize_universal(stream, &uncompressed_size);
+    if (bad(res)) { throw fake_archive_exc_t(); }
+    res = deserialize_universal(stream, &compressed_size);
+    if (bad(res)) { throw fake_archive_exc_t(); }
+    if (*tag_out == connectivity_cluster_t::compressed_tag
+        || *tag_out == connectivity_cluster_t::heartbeat_tag
+        || *tag_out == connectivity_cluster_t::ping_tag
+        || compressed_size > static_cast<uint64_t>(std::numeric_limits<uLong>::max())
+        || uncompressed_size > static_cast<uint64_t>(std::numeric_limits<uLong>::max())
+        /* zlib can't compress by more than a factor of about 1000, so anything else
+        is garbage and mustn't make us allocate huge buffers. */
+        || uncompressed_size / 1024 > compressed_size) {
+        throw fake_archive_exc_t();
+    }
+
+    std::vector<char> compressed(compressed_size);
+    if (force_read(stream, compressed.data(), compressed_size)
+            != static_cast<int64_t>(compressed_size)) {
+        throw fake_archive_exc_t();
+    }
+    data_out->resize(uncompressed_size);
+    uLongf dest_size = uncompressed_size;
+    int zres = uncompress(reinterpret_cast<Bytef *>(data_out->data()), &dest_size,
+                          reinterpret_cast<const Bytef *>(compressed.data()),
+                          compressed_size);
+    if (zres != Z_OK || dest_size != uncompressed_size) {
+        throw fake_archive_exc_t();
+    }
+}
+
 void fail_handshake(keepalive_tcp_conn_stream_t *conn,
                     const char *peername,
                     const handshake_result_t &reason,
@@ -1072,10 +1243,14 @@ join_result_t connectivity_cluster_t::run_t::handle(
         return join_result_t::TEMPORARY_ERROR;
     }
 
+    /* Whether the other server can decompress our messages and answers pings */
+    bool peer_accepts_compression = false;
+    bool peer_answers_pings = false;
     {
         // Tell the other node that we are happy to connect with it
         write_message_t wm;
-        serialize_universal(&wm, handshake_result_t::success());
+        serialize_universal(&wm, handshake_result_t::success(
+            strprintf("%s %s", compression_capability, ping_capability)));
         if (send_write_message(conn, &wm)) {
             return join_result_t::TEMPORARY_ERROR; // network error.
         }
@@ -1094,6 +1269,9 @@ join_result_t connectivity_cluster_t::run_t::handle(
                 return join_result_t::TEMPORARY_ERROR;
             return join_result_t::PERMANENT_ERROR;
         }
+        peer_accepts_compression =
+            handshake_result.has_capability(compression_capability);
+        peer_answers_pings = handshake_result.has_capability(ping_capability);
     }
 
     // Look up the ip addresses for the other host
@@ -1317,7 +1495,8 @@ join_result_t connectivity_cluster_t::run_t::handle(
         constructor registers it in the `connectivity_cluster_t`'s connection
         map. */
         connection_t conn_structure(
-            this, other_id, remote_server_id, conn, *other_peer_addr.get());
+            this, other_id, remote_server_id, conn, *other_peer_addr.get(),
+            compress_messages && peer_accepts_compression);
 
         /* `heartbeat_manager` will periodically send a heartbeat message to
         other servers, and it will also close the connection if we don't
@@ -1326,7 +1505,8 @@ join_result_t connectivity_cluster_t::run_t::handle(
             &conn_structure,
             auto_drainer_t::lock_t(conn_structure.drainers.get()),
             peerstr,
-            cross_thread_heartbeat_sl_view.get_watchable());
+            cross_thread_heartbeat_sl_view.get_watchable(),
+            peer_answers_pings);
 
         /* Main message-handling loop: read messages off the connection until
         it's closed, which may be due to network events, or the other end
@@ -1341,7 +1521,42 @@ join_result_t connectivity_cluster_t::run_t::handle(
                 /* Ignore messages tagged with the heartbeat tag. The
                 `keepalive_tcp_conn_stream_t` will have already notified the
                 `heartbeat_manager_t` as soon as the heartbeat arrived. */
-                if (tag != heartbeat_tag) {
+                if (tag == ping_tag) {
+                    bool is_reply;
+                    uint64_t ticks;
+                    res = deserialize_universal(conn, &is_reply);
+                    if (bad(res)) { throw fake_archive_exc_t(); }
+                    res = deserialize_universal(conn, &ticks);
+                    if (bad(res)) { throw fake_archive_exc_t(); }
+                    if (is_reply) {
+                        const ticks_t now = get_ticks();
+                        if (now >= ticks) {
+                            conn_structure.record_round_trip((now - ticks) / 1000);
+                        }
+                    } else {
+                        /* `send_message()` might block, and we don't want the pings
+                        to hold up the messages that come after them. */
+                        auto_drainer_t::lock_t keepalive(conn_structure.drainers.get());
+                        connection_t *connection = &conn_structure;
+                        coro_t::spawn_sometime([this, connection, keepalive, ticks]() {
+                            ping_writer_t writer(true, ticks);
+                            parent->send_message(
+                                connection, keepalive, ping_tag, &writer);
+                        });
+                    }
+                } else if (tag == compressed_tag) {
+                    std::vector<char> data;
+                    receive_compressed_message(conn, &tag, &data);
+                    cluster_message_handler_t *handler = parent->message_handlers[tag];
+                    guarantee(handler != nullptr, "Got a message for an unfamiliar tag. "
+                        "Apparently we aren't compatible with the cluster on the other "
+                        "end.");
+                    guarantee(resolved_version == cluster_version_t::CLUSTER);
+                    handler->on_local_message(
+                        &conn_structure,
+                        auto_drainer_t::lock_t(conn_structure.drainers.get()),
+                        std::move(data)); // might raise fake_archive_exc_t
+                } else if (tag != heartbeat_tag) {
                     cluster_message_handler_t *handler = parent->message_handlers[tag];
                     guarantee(handler != nullptr, "Got a message for an unfamiliar tag. "
                         "Apparently we aren't compatible with the cluster on the other "
@@ -1526,6 +1741,33 @@ void connectivity_cluster_t::send_message(connection_t *connection,
         message_handlers[tag]->on_local_message(connection, connection_keepalive,
             std::move(buffer_data));
     } else {
+        /* Large messages get compressed before we switch to the connection's thread,
+        so that the compression work is spread out over the threads that send. */
+        std::vector<char> compressed;
+        if (connection->compress_messages
+            && buffer.vector().size() >= CLUSTER_COMPRESSION_MIN_MESSAGE_SIZE) {
+            block_pm_duration compression_timer(&connection->pm_compression);
+            uLongf compressed_size = compressBound(buffer.vector().size());
+            compressed.resize(compressed_size);
+            int zres = compress2(reinterpret_cast<Bytef *>(compressed.data()),
+                                 &compressed_size,
+                                 reinterpret_cast<const Bytef *>(buffer.vector().data()),
+                                 buffer.vector().size(),
+                                 Z_BEST_SPEED);
+            guarantee(zres == Z_OK, "compress2 failed with error code %d", zres);
+            compressed.resize(compressed_size);
+            if (compressed.size() < buffer.vector().size()) {
+                connection->pm_bytes_before_compression += buffer.vector().size();
+                connection->pm_bytes_after_compression += compressed.size();
+                bytes_sent = compressed.size();
+            } else {
+                // Not worth it, send the message as it is.
+                compressed.clear();
+            }
+        }
+        const std::vector<char> &payload =
+            compressed.empty() ? buffer.vector() : compressed;
+
         on_thread_t threader(connection->conn->home_thread());
 
         /* Acquire the send-mutex so we don't collide with other things trying
@@ -1544,7 +1786,15 @@ void connectivity_cluster_t::send_message(connection_t *connection,
                               "changed, the cluster communication format has changed and "
                               "you need to ask yourself whether live cluster upgrades work."
                               );
-                serialize_universal(&wm, tag);
+                if (compressed.empty()) {
+                    serialize_universal(&wm, tag);
+                } else {
+                    serialize_universal(&wm, compressed_tag);
+                    serialize_universal(&wm, tag);
+                    serialize_universal(&wm,
+                        static_cast<uint64_t>(buffer.vector().size()));
+                    serialize_universal(&wm, static_cast<uint64_t>(compressed.size()));
+                }
                 make_buffered_tcp_conn_stream_wrapper_t buffered_conn(connection->conn);
                 int res = send_write_message(&buffered_conn, &wm);
                 if (res == -1) {
@@ -1558,17 +1808,19 @@ void connectivity_cluster_t::send_message(connection_t *connection,
                 }
             }
 
-            /* Write the message itself to the network */
+            /* Write the message itself to the network. Large messages go to the
+            socket straight from `payload`, which we keep until the write is done. */
             {
-                int64_t res = connection->conn->write_buffered(buffer.vector().data(),
-                                                               buffer.vector().size());
+                int64_t res = payload.size() >= UNBUFFERED_WRITE_MIN_SIZE
+                    ? connection->conn->write(payload.data(), payload.size())
+                    : connection->conn->write_buffered(payload.data(), payload.size());
                 if (res == -1) {
                     if (connection->conn->is_read_open()) {
                         connection->conn->shutdown_read();
                     }
                     return;
                 } else {
-                    guarantee(res == static_cast<int64_t>(buffer.vector().size()));
+                    guarantee(res == static_cast<int64_t>(payload.size()));
                 }
             }
         } /* Releases the send_mutex */
@@ -1596,6 +1848,12 @@ cluster_message_handler_t::cluster_message_handler_t(
     rassert(tag != connectivity_cluster_t::heartbeat_tag,
         "Tag %" PRIu8 " is reserved for heartbeat messages.",
         connectivity_cluster_t::heartbeat_tag);
+    rassert(tag != connectivity_cluster_t::compressed_tag,
+        "Tag %" PRIu8 " is reserved for compressed messages.",
+        connectivity_cluster_t::compressed_tag);
+    rassert(tag != connectivity_cluster_t::ping_tag,
+        "Tag %" PRIu8 " is reserved for pings.",
+        connectivity_cluster_t::ping_tag);
     rassert(connectivity_cluster->message_handlers[tag] == nullptr);
     connectivity_cluster->message_handlers[tag] = this;
 }
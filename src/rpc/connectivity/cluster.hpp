@@ -2,6 +2,7 @@
 #ifndef RPC_CONNECTIVITY_CLUSTER_HPP_
 #define RPC_CONNECTIVITY_CLUSTER_HPP_
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <string>
@@ -105,6 +106,14 @@ public:
     /* This tag is reserved exclusively for heartbeat messages. */
     static const message_tag_t heartbeat_tag = 'H';
 
+    /* This tag is reserved for compressed messages. The compressed data carries the
+    tag of the actual message. */
+    static const message_tag_t compressed_tag = 'Z';
+
+    /* This tag is reserved for the pings that measure the round trip time to other
+    servers. */
+    static const message_tag_t ping_tag = 'P';
+
     class run_t;
 
     /* `connection_t` represents an open connection to another server. If we lose
@@ -144,9 +153,24 @@ public:
         /* Drops the connection. */
         void kill_connection();
 
+        /* Returns the round trip time to the other server in microseconds, as measured
+        by the heartbeat pings, or -1 if it isn't known (yet). */
+        int64_t get_round_trip_usecs() const {
+            return round_trip_usecs.load();
+        }
+
+        /* Returns how much the round trip time varies from one ping to the next, in
+        microseconds, or -1 if it isn't known (yet). */
+        int64_t get_round_trip_jitter_usecs() const {
+            return round_trip_jitter_usecs.load();
+        }
+
     private:
         friend class connectivity_cluster_t;
 
+        /* Called by the connection's message handling loop whenever a ping returns. */
+        void record_round_trip(int64_t usecs);
+
         /* The constructor registers us in every thread's `connections` map, thereby
         notifying event subscribers. */
         connection_t(
@@ -154,7 +178,8 @@ public:
             const peer_id_t &peer_id,
             const server_id_t &server_id,
             keepalive_tcp_conn_stream_t *,
-            const peer_address_t &peer_address) THROWS_NOTHING;
+            const peer_address_t &peer_address,
+            bool compress_messages) THROWS_NOTHING;
         ~connection_t() THROWS_NOTHING;
 
         /* NULL for the loopback connection (i.e. our "connection" to ourself) */
@@ -172,9 +197,27 @@ public:
         buffered write makes it to the TCP stack. */
         pump_coro_t flusher;
 
+        /* Whether large messages to this peer get compressed. Only set if we were
+        started with `--cluster-compression` and the peer told us during the handshake
+        that it can decompress them. */
+        const bool compress_messages;
+
+        /* Exponentially weighted moving averages of the ping round trip times, and of
+        the differences between consecutive ones (as in RFC 3550). Only
+        `record_round_trip()` accesses `last_round_trip_usecs`. */
+        std::atomic<int64_t> round_trip_usecs;
+        std::atomic<int64_t> round_trip_jitter_usecs;
+        int64_t last_round_trip_usecs;
+
         perfmon_collection_t pm_collection;
         perfmon_sampler_t pm_bytes_sent;
-        perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership;
+        perfmon_counter_t pm_bytes_before_compression, pm_bytes_after_compression;
+        perfmon_duration_sampler_t pm_compression;
+        perfmon_latency_histogram_t pm_round_trip;
+        perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership,
+            pm_bytes_before_compression_membership,
+            pm_bytes_after_compression_membership, pm_compression_membership,
+            pm_round_trip_membership;
 
         /* We only hold this information so we can deregister ourself */
         run_t *parent;
@@ -203,7 +246,8 @@ public:
                   heartbeat_semilattice_metadata_t> > heartbeat_sl_view,
               std::shared_ptr<semilattice_read_view_t<
                   auth_semilattice_metadata_t> > auth_sl_view,
-              tls_ctx_t *tls_ctx)
+              tls_ctx_t *tls_ctx,
+              bool compress_messages)
             THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t);
 
         ~run_t();
@@ -298,6 +342,9 @@ public:
 
         tls_ctx_t *tls_ctx;
 
+        /* Whether we compress large messages to peers that support it */
+        bool compress_messages;
+
         /* `attempt_table` is a table of all the host:port pairs we're currently
         trying to connect to or have connected to. If we are told to connect to
         an address already in this table, we'll just ignore it. That's important
@@ -0,0 +1,50 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rpc/connectivity/failure_detector.hpp"
+
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+
+phi_accrual_failure_detector_t::phi_accrual_failure_detector_t(int64_t _min_stddev) :
+    min_stddev(_min_stddev), sum(0), sum_squares(0) { }
+
+void phi_accrual_failure_detector_t::heartbeat(int64_t now) {
+    if (last_heartbeat.has_value() && now >= *last_heartbeat) {
+        const int64_t interval = now - *last_heartbeat;
+        intervals.push_back(interval);
+        sum += interval;
+        sum_squares += static_cast<double>(interval) * interval;
+        if (intervals.size() > max_intervals) {
+            const double dropped = intervals.front();
+            intervals.pop_front();
+            sum -= dropped;
+            sum_squares -= dropped * dropped;
+        }
+    }
+    last_heartbeat = make_optional(now);
+}
+
+void phi_accrual_failure_detector_t::reset(int64_t new_min_stddev) {
+    min_stddev = new_min_stddev;
+    last_heartbeat.reset();
+    intervals.clear();
+    sum = sum_squares = 0;
+}
+
+double phi_accrual_failure_detector_t::phi(int64_t now) const {
+    if (!last_heartbeat.has_value() || intervals.size() < min_intervals) {
+        return 0;
+    }
+    const double n = intervals.size();
+    const double mean = sum / n;
+    const double variance = std::max(0.0, sum_squares / n - mean * mean);
+    const double stddev = std::max(sqrt(variance), static_cast<double>(min_stddev));
+    const double elapsed = now - *last_heartbeat;
+    /* The probability that a heartbeat arrives later than `elapsed` */
+    const double p_later = 0.5 * erfc((elapsed - mean) / (stddev * M_SQRT2));
+    if (p_later <= 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return -log10(p_later);
+}
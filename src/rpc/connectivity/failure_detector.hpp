@@ -0,0 +1,50 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RPC_CONNECTIVITY_FAILURE_DETECTOR_HPP_
+#define RPC_CONNECTIVITY_FAILURE_DETECTOR_HPP_
+
+#include <stdint.h>
+
+#include <deque>
+
+#include "containers/optional.hpp"
+#include "errors.hpp"
+
+/* `phi_accrual_failure_detector_t` implements the "phi accrual" failure detector of
+Hayashibara et al. It keeps the intervals between the last few heartbeats that arrived
+from a server, and estimates how suspicious a silence of a given length is. The
+suspicion level `phi()` is `-log10()` of the probability that the next heartbeat
+arrives even later than that, assuming that the intervals are normally distributed.
+For example a `phi()` of 8 means that a heartbeat that late only happens once in 10^8
+intervals. On a regular connection the suspicion rises quickly; on a jittery one it
+rises slowly.
+
+Times are in arbitrary but consistent units. `min_stddev` keeps a perfectly regular
+history from making the detector overly sensitive. */
+class phi_accrual_failure_detector_t {
+public:
+    explicit phi_accrual_failure_detector_t(int64_t min_stddev);
+
+    /* Records the arrival of a heartbeat at time `now`. */
+    void heartbeat(int64_t now);
+
+    /* Forgets all previous heartbeats and changes `min_stddev`. */
+    void reset(int64_t new_min_stddev);
+
+    /* Returns the suspicion level at time `now`, or 0 if there haven't been enough
+    heartbeats yet to tell. */
+    double phi(int64_t now) const;
+
+private:
+    static const size_t max_intervals = 100;
+    static const size_t min_intervals = 3;
+
+    int64_t min_stddev;
+    optional<int64_t> last_heartbeat;
+    std::deque<int64_t> intervals;
+    /* The sum of `intervals` and of their squares */
+    double sum, sum_squares;
+
+    DISABLE_COPYING(phi_accrual_failure_detector_t);
+};
+
+#endif  // RPC_CONNECTIVITY_FAILURE_DETECTOR_HPP_
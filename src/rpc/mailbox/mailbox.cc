@@ -7,6 +7,7 @@
 
 #include "debug.hpp"
 #include "containers/archive/archive.hpp"
+#include "containers/archive/shared_buf_stream.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "containers/archive/versioned.hpp"
 #include "concurrency/pmap.hpp"
@@ -33,10 +34,12 @@ std::string raw_mailbox_t::address_t::human_readable() const {
     return strprintf("%s:%d:%" PRIu64, uuid_to_str(peer.get_uuid()).c_str(), thread, mailbox_id);
 }
 
-raw_mailbox_t::raw_mailbox_t(mailbox_manager_t *m, mailbox_read_callback_t *_callback) :
+raw_mailbox_t::raw_mailbox_t(mailbox_manager_t *m, mailbox_read_callback_t *_callback,
+                             mailbox_blocking_t _blocking) :
     manager(m),
     mailbox_id(manager->register_mailbox(this)),
-    callback(_callback) {
+    callback(_callback),
+    blocking(_blocking) {
     guarantee(callback != nullptr);
 }
 
@@ -87,16 +90,14 @@ public:
 
         subwriter->write(cluster_version_t::CLUSTER, &wm);
 
-        // Prepend the message length.
-        // TODO: It would be more efficient if we could make this part of `msg`.
-        //  e.g. with a `prepend()` method on write_message_t.
-        write_message_t length_msg;
-        serialize_universal(&length_msg,
-                            static_cast<uint64_t>(wm.size()) - prefix_length);
+        // Prepend the message length.  Splicing the buffers of `wm` behind it
+        // doesn't copy them, and a single `send_write_message` tells the stream the
+        // total size up front, so that it can allocate its buffer once.
+        write_message_t msg;
+        serialize_universal(&msg, static_cast<uint64_t>(wm.size()) - prefix_length);
+        msg.append(std::move(wm));
 
-        int res = send_write_message(stream, &length_msg);
-        if (res) { throw fake_archive_exc_t(); }
-        res = send_write_message(stream, &wm);
+        int res = send_write_message(stream, &msg);
         if (res) { throw fake_archive_exc_t(); }
     }
 
@@ -226,21 +227,29 @@ void mailbox_manager_t::on_message(
 
     // Read the data from the read stream, so it can be deallocated before we continue
     // in a coroutine
-    std::vector<char> stream_data;
-    stream_data.resize(mbox_header.data_length);
-    int64_t bytes_read = force_read(stream, stream_data.data(), mbox_header.data_length);
+    counted_t<shared_buf_t> stream_data = shared_buf_t::create(mbox_header.data_length);
+    int64_t bytes_read = force_read(stream, stream_data->data(), mbox_header.data_length);
     if (bytes_read != static_cast<int64_t>(mbox_header.data_length)) {
         throw fake_archive_exc_t();
     }
 
-    // We use `spawn_now_dangerously()` to avoid having to heap-allocate `stream_data`.
-    // Instead we pass in a pointer to our local automatically allocated object
-    // and `mailbox_read_coroutine()` moves the data out of it before it yields.
+    if (threadnum_t(mbox_header.dest_thread) == get_thread_id()) {
+        raw_mailbox_t *mbox =
+            mailbox_tables.get()->find_mailbox(mbox_header.dest_mailbox_id);
+        if (mbox != nullptr && mbox->blocking == mailbox_blocking_t::NEVER_BLOCKS) {
+            shared_buf_read_stream_t mbox_stream(std::move(stream_data));
+            call_read_callback(mbox, &mbox_stream);
+            return;
+        }
+    }
+
+    // We use `spawn_now_dangerously()` to avoid reference count changes on
+    // `stream_data`. `mailbox_read_coroutine()` moves it out before it yields.
     coro_t::spawn_now_dangerously(
         [this, mbox_header, &stream_data]() {
             mailbox_read_coroutine(
                 threadnum_t(mbox_header.dest_thread), mbox_header.dest_mailbox_id,
-                &stream_data, 0, MAYBE_YIELD);
+                &stream_data, MAYBE_YIELD);
         });
 }
 
@@ -256,29 +265,58 @@ void mailbox_manager_t::mailbox_read_coroutine(
     stream_data = nullptr; // <- It is not safe to use `stream_data` anymore once we
                         //    switch the thread
 
-    {
-        on_thread_t rethreader(dest_thread);
-        if (force_yield == FORCE_YIELD && rethreader.home_thread() == get_thread_id()) {
-            // Yield to avoid problems with reentrancy in case of local
-            // delivery.
-            coro_t::yield();
-        }
+    deliver_to_mailbox(dest_thread, dest_mailbox_id, &stream, force_yield);
+}
+
+void mailbox_manager_t::mailbox_read_coroutine(
+        threadnum_t dest_thread,
+        raw_mailbox_t::id_t dest_mailbox_id,
+        counted_t<shared_buf_t> *stream_data,
+        force_yield_t force_yield) {
+
+    shared_buf_read_stream_t stream(std::move(*stream_data));
+    stream_data = nullptr; // <- It is not safe to use `stream_data` anymore once we
+                        //    switch the thread
+
+    deliver_to_mailbox(dest_thread, dest_mailbox_id, &stream, force_yield);
+}
+
+void mailbox_manager_t::deliver_to_mailbox(
+        threadnum_t dest_thread,
+        raw_mailbox_t::id_t dest_mailbox_id,
+        read_stream_t *stream,
+        force_yield_t force_yield) {
+    on_thread_t rethreader(dest_thread);
+    if (force_yield == FORCE_YIELD && rethreader.home_thread() == get_thread_id()) {
+        // Yield to avoid problems with reentrancy in case of local
+        // delivery.
+        coro_t::yield();
+    }
+
+    raw_mailbox_t *mbox = mailbox_tables.get()->find_mailbox(dest_mailbox_id);
+    if (mbox != nullptr) {
+        call_read_callback(mbox, stream);
+    }
+}
 
+void mailbox_manager_t::call_read_callback(raw_mailbox_t *mbox,
+                                           read_stream_t *stream) {
+    try {
         try {
-            raw_mailbox_t *mbox = mailbox_tables.get()->find_mailbox(dest_mailbox_id);
-            if (mbox != nullptr) {
-                try {
-                    auto_drainer_t::lock_t keepalive(&mbox->drainer);
-                    mbox->callback->read(&stream, keepalive.get_drain_signal());
-                } catch (const interrupted_exc_t &) {
-                    /* Do nothing. It's no longer safe to access `mbox` (because the
-                    destructor is running) but otherwise we don't need to take any
-                    special action. */
-                }
+            auto_drainer_t::lock_t keepalive(&mbox->drainer);
+            if (mbox->blocking == mailbox_blocking_t::NEVER_BLOCKS) {
+                ASSERT_NO_CORO_WAITING;
+                mbox->callback->read(stream, keepalive.get_drain_signal());
+            } else {
+                mbox->callback->read(stream, keepalive.get_drain_signal());
             }
-        } catch (const fake_archive_exc_t &e) {
-            logWRN("Received an invalid cluster message from a peer.");
+        } catch (const interrupted_exc_t &) {
+            /* Do nothing. It's no longer safe to access `mbox` (because the
+            destructor is running) but otherwise we don't need to take any
+            special action. */
         }
+    } catch (const fake_archive_exc_t &e) {
+        logWRN("Received an invalid cluster message from a peer.");
     }
 }
 
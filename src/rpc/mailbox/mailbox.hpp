@@ -10,6 +10,7 @@
 #include "concurrency/new_semaphore.hpp"
 #include "containers/archive/archive.hpp"
 #include "containers/archive/vector_stream.hpp"
+#include "containers/shared_buffer.hpp"
 #include "rpc/connectivity/cluster.hpp"
 #include "rpc/semilattice/joins/macros.hpp"
 
@@ -41,6 +42,13 @@ public:
         signal_t *interruptor) = 0;
 };
 
+/* Most messages are handled in a coroutine of their own.  A mailbox whose callback
+never blocks, such as one that just stores a response and pulses a signal, can be
+marked `NEVER_BLOCKS`.  Messages that arrive for it from other servers on its own
+thread are then handled directly in the connection's coroutine, which saves spawning a
+coroutine for each of them.  In debug mode, blocking in such a callback crashes. */
+enum class mailbox_blocking_t { MAY_BLOCK, NEVER_BLOCKS };
+
 struct raw_mailbox_t : public home_thread_mixin_t {
 public:
     struct address_t;
@@ -64,6 +72,8 @@ private:
     the destructor won't call `begin_shutdown()` again. */
     mailbox_read_callback_t *callback;
 
+    const mailbox_blocking_t blocking;
+
     auto_drainer_t drainer;
 
     DISABLE_COPYING(raw_mailbox_t);
@@ -112,7 +122,8 @@ public:
         id_t mailbox_id;
     };
 
-    raw_mailbox_t(mailbox_manager_t *, mailbox_read_callback_t *callback);
+    raw_mailbox_t(mailbox_manager_t *, mailbox_read_callback_t *callback,
+                  mailbox_blocking_t blocking = mailbox_blocking_t::MAY_BLOCK);
 
     /* Note that `~raw_mailbox_t()` will block until all of the callbacks have finished
     running. */
@@ -183,6 +194,17 @@ private:
                                 std::vector<char> *stream_data,
                                 int64_t stream_data_offset,
                                 force_yield_t force_yield);
+    /* Messages from other servers are read into a `shared_buf_t`, so that the read
+    callbacks can deserialize large datums without copying them again. */
+    void mailbox_read_coroutine(threadnum_t dest_thread,
+                                raw_mailbox_t::id_t dest_mailbox_id,
+                                counted_t<shared_buf_t> *stream_data,
+                                force_yield_t force_yield);
+    void deliver_to_mailbox(threadnum_t dest_thread,
+                            raw_mailbox_t::id_t dest_mailbox_id,
+                            read_stream_t *stream,
+                            force_yield_t force_yield);
+    static void call_read_callback(raw_mailbox_t *mbox, read_stream_t *stream);
 };
 
 /* Note: disconnect_watcher_t keeps the connection alive for as long as it
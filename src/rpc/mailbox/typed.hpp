@@ -58,8 +58,9 @@ public:
     typedef mailbox_addr_t<Args...> address_t;
 
     mailbox_t(mailbox_manager_t *manager,
-              const std::function< void(signal_t *, Args...)> &f) :
-        reader(this), fun(f), mailbox(manager, &reader)
+              const std::function< void(signal_t *, Args...)> &f,
+              mailbox_blocking_t blocking = mailbox_blocking_t::MAY_BLOCK) :
+        reader(this), fun(f), mailbox(manager, &reader, blocking)
         { }
 
     void begin_shutdown() {
@@ -3,8 +3,10 @@
 #define RPC_SEMILATTICE_SEMILATTICE_MANAGER_HPP_
 
 #include <map>
+#include <memory>
 #include <utility>
 
+#include "containers/optional.hpp"
 #include "rpc/mailbox/mailbox.hpp"
 #include "rpc/semilattice/view.hpp"
 
@@ -29,6 +31,9 @@ constraints:
     such that `metadata_t` is a semilattice and `semilattice_join(a, b)` sets
     `*a` to the semilattice-join of `*a` and `b`.
 
+4. It must be equality comparable. We use this to avoid sending a peer metadata that
+    it already has.
+
 Currently it's not thread-safe at all; all accesses to the metadata must be on
 the home thread of the `semilattice_manager_t`. */
 
@@ -61,7 +66,24 @@ private:
         publisher_t<std::function<void()> > *get_publisher();
     };
 
+    /* For each connected peer, we keep a `peer_info_t` in `peers`. Changes to the
+    metadata are joined into `pending` and sent by a single `send_to_peer()` coroutine
+    per peer, so that many changes in a row end up in a few messages. `sent` is what we
+    know that the peer has (if anything); if `pending` doesn't add anything to it, we
+    only send the peer the new version number. */
+    class peer_info_t {
+    public:
+        explicit peer_info_t(const connectivity_cluster_t::connection_pair_t &_conn) :
+            connection(_conn), pending_version(0), sending(false) { }
+        connectivity_cluster_t::connection_pair_t connection;
+        optional<metadata_t> sent;
+        optional<metadata_t> pending;
+        metadata_version_t pending_version;
+        bool sending;
+    };
+
     class metadata_writer_t;
+    class version_writer_t;
     class sync_from_query_writer_t;
     class sync_from_reply_writer_t;
     class sync_to_query_writer_t;
@@ -74,7 +96,18 @@ private:
         const peer_id_t &peer_id,
         const connectivity_cluster_t::connection_pair_t *pair);
 
+    /* Joins `added_metadata` into what we're going to send to `peer` next, and spawns
+    `send_to_peer()` if it isn't running */
+    void send_metadata_to_peer(
+        const std::shared_ptr<peer_info_t> &peer,
+        const metadata_t &added_metadata,
+        metadata_version_t version);
+    void send_to_peer(
+        std::shared_ptr<peer_info_t> peer,
+        auto_drainer_t::lock_t keepalive);
+
     void join_metadata_locally(metadata_t);
+    void on_version_from_peer(peer_id_t peer, metadata_version_t version);
     void wait_for_version_from_peer(peer_id_t peer, metadata_version_t version, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, sync_failed_exc_t);
 
     const std::shared_ptr<root_view_t> root_view;
@@ -84,7 +117,7 @@ private:
     publisher_controller_t<std::function<void()> > metadata_publisher;
     rwi_lock_assertion_t metadata_mutex;
 
-    std::map<peer_id_t, connectivity_cluster_t::connection_pair_t> last_connections;
+    std::map<peer_id_t, std::shared_ptr<peer_info_t> > peers;
 
     std::map<peer_id_t, metadata_version_t> last_versions_seen;
     std::multimap<std::pair<peer_id_t, metadata_version_t>, cond_t *> version_waiters;
@@ -72,26 +72,13 @@ void semilattice_manager_t<metadata_t>::root_view_t::join(const metadata_t &adde
     currently see a peer, that's OK; it will hear about the metadata change when
     it reconnects, via the `semilattice_manager_t`'s `on_connections_change()`
     handler. */
-    auto_drainer_t::lock_t parent_keepalive(parent->drainers.get());
-
-    for (const std::pair<peer_id_t, connectivity_cluster_t::connection_pair_t> &pair :
-            parent->last_connections) {
-        connectivity_cluster_t::connection_t *connection = pair.second.first;
-        auto_drainer_t::lock_t connection_keepalive = pair.second.second;
-        coro_t::spawn_sometime(
-            [this, parent_keepalive /* important to capture */,
-             connection, connection_keepalive /* important to capture */,
-             new_version, added_metadata]() {
-                metadata_writer_t writer(added_metadata, new_version);
-                new_semaphore_in_line_t acq(&parent->semaphore, 1);
-                acq.acquisition_signal()->wait();
-                parent->get_connectivity_cluster()->send_message(connection,
-                    connection_keepalive, parent->get_message_tag(), &writer);
-            });
+    for (const auto &pair : parent->peers) {
+        parent->send_metadata_to_peer(pair.second, added_metadata, new_version);
     }
 }
 
 static const char message_code_metadata = 'M';
+static const char message_code_version = 'V';
 static const char message_code_sync_from_query = 'F';
 static const char message_code_sync_from_reply = 'f';
 static const char message_code_sync_to_query = 'T';
@@ -129,6 +116,37 @@ private:
     metadata_version_t mdv;
 };
 
+/* Tells the peer about a new version without sending any metadata, because the peer
+already has all of the changes up to that version. */
+template <class metadata_t>
+class semilattice_manager_t<metadata_t>::version_writer_t :
+        public cluster_send_message_write_callback_t
+{
+public:
+    explicit version_writer_t(metadata_version_t _mdv) : mdv(_mdv) { }
+
+    void write(write_stream_t *stream) {
+        write_message_t wm;
+        // All cluster versions so far use a uint8_t code.
+        uint8_t code = message_code_version;
+        serialize_universal(&wm, code);
+        serialize<cluster_version_t::CLUSTER>(&wm, mdv);
+        int res = send_write_message(stream, &wm);
+        if (res) { throw fake_archive_exc_t(); }
+    }
+
+#ifdef ENABLE_MESSAGE_PROFILER
+    const char *message_profiler_tag() const {
+        static const std::string tag =
+            strprintf("semilattice<%s>.version", typeid(metadata_t).name());
+        return tag.c_str();
+    }
+#endif
+
+private:
+    metadata_version_t mdv;
+};
+
 template <class metadata_t>
 class semilattice_manager_t<metadata_t>::sync_from_query_writer_t :
         public cluster_send_message_write_callback_t
@@ -372,23 +390,29 @@ void semilattice_manager_t<metadata_t>::on_message(
                 on_thread_t thread_switcher(home_thread());
                 /* This is the meat of the change */
                 this->join_metadata_locally(added_metadata);
-                /* Also notify anything that was waiting for us to reach this version */
-                DEBUG_VAR mutex_assertion_t::acq_t acq(&this->peer_version_mutex);
-                auto inserted = this->last_versions_seen.insert(
-                    std::make_pair(sender, change_version));
-                if (!inserted.second) {
-                    inserted.first->second =
-                        std::max(inserted.first->second, change_version);
-                }
-                for (auto it = version_waiters.begin();
-                          it != version_waiters.end();
-                          it++) {
-                    if (it->first.first == sender &&
-                            it->first.second <= change_version &&
-                            !it->second->is_pulsed()) {
-                        it->second->pulse();
-                    }
+                /* The sender obviously has this metadata already, so there's no need
+                to send it back when somebody joins it in here. */
+                auto it = this->peers.find(sender);
+                if (it != this->peers.end() && it->second->sent.has_value()) {
+                    semilattice_join(&*it->second->sent, added_metadata);
                 }
+                /* Also notify anything that was waiting for us to reach this version */
+                this->on_version_from_peer(sender, change_version);
+            });
+            break;
+        }
+        /* Another peer has a new version, but we already have all of its changes */
+        case message_code_version: {
+            metadata_version_t change_version;
+            {
+                archive_result_t res =
+                    deserialize<cluster_version_t::CLUSTER>(stream, &change_version);
+                if (bad(res)) { throw fake_archive_exc_t(); }
+            }
+            coro_t::spawn_sometime([this, this_keepalive /* important to capture */,
+                    change_version, sender]() {
+                on_thread_t thread_switcher(home_thread());
+                this->on_version_from_peer(sender, change_version);
             });
             break;
         }
@@ -522,25 +546,72 @@ template<class metadata_t>
 void semilattice_manager_t<metadata_t>::on_connection_change(
         const peer_id_t &peer_id,
         const connectivity_cluster_t::connection_pair_t *pair) {
-    if (pair != nullptr && last_connections.count(peer_id) == 0) {
-        connectivity_cluster_t::connection_t *connection = pair->first;
-        auto_drainer_t::lock_t connection_keepalive = pair->second;
-        last_connections.insert(std::make_pair(peer_id, *pair));
-        auto_drainer_t::lock_t this_keepalive(drainers.get());
-        coro_t::spawn_sometime([this, this_keepalive /* important to capture */,
-                connection, connection_keepalive /* important to capture */]() {
-            metadata_writer_t writer(metadata, metadata_version);
-            new_semaphore_in_line_t acq(&this->semaphore, 1);
-            acq.acquisition_signal()->wait();
-            get_connectivity_cluster()->send_message(connection,
-                connection_keepalive, get_message_tag(), &writer);
-        });
+    if (pair != nullptr && peers.count(peer_id) == 0) {
+        auto peer = std::make_shared<peer_info_t>(*pair);
+        peers.insert(std::make_pair(peer_id, peer));
+        send_metadata_to_peer(peer, metadata, metadata_version);
+    }
+    if (pair == nullptr && peers.count(peer_id) == 1) {
+        peers.erase(peer_id);
+    }
+}
+
+template<class metadata_t>
+void semilattice_manager_t<metadata_t>::send_metadata_to_peer(
+        const std::shared_ptr<peer_info_t> &peer,
+        const metadata_t &added_metadata,
+        metadata_version_t version) {
+    assert_thread();
+    if (peer->pending.has_value()) {
+        semilattice_join(&*peer->pending, added_metadata);
+    } else {
+        peer->pending = make_optional(added_metadata);
     }
-    if (pair == nullptr && last_connections.count(peer_id) == 1) {
-        last_connections.erase(peer_id);
+    peer->pending_version = version;
+    if (!peer->sending) {
+        peer->sending = true;
+        coro_t::spawn_sometime(std::bind(&semilattice_manager_t::send_to_peer,
+            this, peer, auto_drainer_t::lock_t(drainers.get())));
     }
 }
 
+template<class metadata_t>
+void semilattice_manager_t<metadata_t>::send_to_peer(
+        std::shared_ptr<peer_info_t> peer,
+        UNUSED auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    while (peer->pending.has_value()) {
+        metadata_t to_send = std::move(*peer->pending);
+        peer->pending.reset();
+        metadata_version_t version = peer->pending_version;
+
+        bool has_changes = true;
+        if (peer->sent.has_value()) {
+            metadata_t new_sent = *peer->sent;
+            semilattice_join(&new_sent, to_send);
+            has_changes = !(new_sent == *peer->sent);
+            peer->sent = make_optional(std::move(new_sent));
+        } else {
+            peer->sent = make_optional(to_send);
+        }
+
+        /* Changes that come in while we wait here or while we send the message will be
+        sent in the next iteration. */
+        new_semaphore_in_line_t acq(&semaphore, 1);
+        acq.acquisition_signal()->wait();
+        if (has_changes) {
+            metadata_writer_t writer(to_send, version);
+            get_connectivity_cluster()->send_message(peer->connection.first,
+                peer->connection.second, get_message_tag(), &writer);
+        } else {
+            version_writer_t writer(version);
+            get_connectivity_cluster()->send_message(peer->connection.first,
+                peer->connection.second, get_message_tag(), &writer);
+        }
+    }
+    peer->sending = false;
+}
+
 template<class metadata_t>
 void semilattice_manager_t<metadata_t>::join_metadata_locally(metadata_t added_metadata) {
     assert_thread();
@@ -552,6 +623,24 @@ void semilattice_manager_t<metadata_t>::join_metadata_locally(metadata_t added_m
         });
 }
 
+template<class metadata_t>
+void semilattice_manager_t<metadata_t>::on_version_from_peer(
+        peer_id_t peer, metadata_version_t version) {
+    assert_thread();
+    DEBUG_VAR mutex_assertion_t::acq_t acq(&peer_version_mutex);
+    auto inserted = last_versions_seen.insert(std::make_pair(peer, version));
+    if (!inserted.second) {
+        inserted.first->second = std::max(inserted.first->second, version);
+    }
+    for (auto it = version_waiters.begin(); it != version_waiters.end(); it++) {
+        if (it->first.first == peer &&
+                it->first.second <= version &&
+                !it->second->is_pulsed()) {
+            it->second->pulse();
+        }
+    }
+}
+
 template<class metadata_t>
 void semilattice_manager_t<metadata_t>::wait_for_version_from_peer(peer_id_t peer, metadata_version_t version, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, sync_failed_exc_t) {
     assert_thread();
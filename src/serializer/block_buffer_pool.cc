@@ -0,0 +1,81 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "serializer/block_buffer_pool.hpp"
+
+#include <vector>
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "perfmon/perfmon.hpp"
+
+static const size_t NUM_BLOCK_BUFFER_SIZE_CLASSES
+    = BLOCK_BUFFER_POOL_MAX_BUFFER_SIZE / DEVICE_BLOCK_SIZE;
+
+struct thread_block_buffer_pool_t {
+    thread_block_buffer_pool_t() : retained_bytes(0) { }
+
+    // `free_lists[i]` holds the buffers of `(i + 1) * DEVICE_BLOCK_SIZE` bytes.
+    std::vector<scoped_device_block_aligned_ptr_t<ser_buffer_t> >
+        free_lists[NUM_BLOCK_BUFFER_SIZE_CLASSES];
+    int64_t retained_bytes;
+};
+
+static perfmon_counter_t pm_block_buffer_pool_hits, pm_block_buffer_pool_misses,
+    pm_block_buffer_pool_retained_bytes;
+static perfmon_multi_membership_t pm_block_buffer_pool_membership(
+    &get_global_perfmon_collection(),
+    &pm_block_buffer_pool_hits, "block_buffer_pool_hits",
+    &pm_block_buffer_pool_misses, "block_buffer_pool_misses",
+    &pm_block_buffer_pool_retained_bytes, "block_buffer_pool_retained_bytes");
+
+/* Returns the pool of the current thread, or null if `size` doesn't get pooled or if
+we aren't on one of the thread pool's threads.  The pools are never destroyed, so that
+buffers which get freed during shutdown still have somewhere to go. */
+static thread_block_buffer_pool_t *get_pool(size_t size, size_t *size_class_out) {
+    if (size == 0 || size > BLOCK_BUFFER_POOL_MAX_BUFFER_SIZE
+        || size % DEVICE_BLOCK_SIZE != 0) {
+        return nullptr;
+    }
+    const int thread = get_thread_id().threadnum;
+    if (thread < 0 || thread >= MAX_THREADS) {
+        return nullptr;
+    }
+    static cache_line_padded_t<thread_block_buffer_pool_t> *const pools
+        = new cache_line_padded_t<thread_block_buffer_pool_t>[MAX_THREADS];
+    *size_class_out = size / DEVICE_BLOCK_SIZE - 1;
+    return &pools[thread].value;
+}
+
+scoped_device_block_aligned_ptr_t<ser_buffer_t> alloc_block_buffer(size_t size) {
+    size_t size_class;
+    thread_block_buffer_pool_t *pool = get_pool(size, &size_class);
+    if (pool != nullptr) {
+        std::vector<scoped_device_block_aligned_ptr_t<ser_buffer_t> > *free_list
+            = &pool->free_lists[size_class];
+        if (!free_list->empty()) {
+            scoped_device_block_aligned_ptr_t<ser_buffer_t> buffer
+                = std::move(free_list->back());
+            free_list->pop_back();
+            pool->retained_bytes -= size;
+            pm_block_buffer_pool_retained_bytes -= size;
+            ++pm_block_buffer_pool_hits;
+            return buffer;
+        }
+        ++pm_block_buffer_pool_misses;
+    }
+    return scoped_device_block_aligned_ptr_t<ser_buffer_t>(size);
+}
+
+void free_block_buffer(size_t size,
+                       scoped_device_block_aligned_ptr_t<ser_buffer_t> &&buffer) {
+    size_t size_class;
+    thread_block_buffer_pool_t *pool = get_pool(size, &size_class);
+    if (pool == nullptr || !buffer.has()
+        || pool->retained_bytes + static_cast<int64_t>(size)
+            > BLOCK_BUFFER_POOL_MAX_RETAINED_BYTES) {
+        buffer.reset();
+        return;
+    }
+    pool->free_lists[size_class].push_back(std::move(buffer));
+    pool->retained_bytes += size;
+    pm_block_buffer_pool_retained_bytes += size;
+}
@@ -0,0 +1,24 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_BLOCK_BUFFER_POOL_HPP_
+#define SERIALIZER_BLOCK_BUFFER_POOL_HPP_
+
+#include "containers/scoped.hpp"
+#include "serializer/types.hpp"
+
+/* Every thread keeps the buffers of the blocks that it frees in free lists by size, so
+that loading a block usually doesn't have to go through `posix_memalign` and fault in
+new memory.  Only sizes up to `BLOCK_BUFFER_POOL_MAX_BUFFER_SIZE` that are multiples
+of `DEVICE_BLOCK_SIZE` get pooled, and a thread holds on to at most
+`BLOCK_BUFFER_POOL_MAX_RETAINED_BYTES`.
+
+The buffers are ordinary `scoped_device_block_aligned_ptr_t`s, so a buffer from the
+pool may just as well be freed by destroying it, and a buffer that was allocated some
+other way may be given to `free_block_buffer()`.  A buffer that is freed on another
+thread than the one that allocated it goes into the pool of that other thread. */
+
+// `size` is the allocated size, which must be a multiple of `DEVICE_BLOCK_SIZE`.
+scoped_device_block_aligned_ptr_t<ser_buffer_t> alloc_block_buffer(size_t size);
+void free_block_buffer(size_t size,
+                       scoped_device_block_aligned_ptr_t<ser_buffer_t> &&buffer);
+
+#endif  // SERIALIZER_BLOCK_BUFFER_POOL_HPP_
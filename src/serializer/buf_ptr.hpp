@@ -6,10 +6,12 @@
 #include "containers/scoped.hpp"
 #include "errors.hpp"
 #include "math.hpp"
+#include "serializer/block_buffer_pool.hpp"
 #include "serializer/types.hpp"
 
 // Memory-aligned bufs.  This type also keeps the unused part of the buf (up to the
-// DEVICE_BLOCK_SIZE multiple) zeroed out.
+// DEVICE_BLOCK_SIZE multiple) zeroed out.  The buffers come from and go back to the
+// block buffer pool of the thread (see block_buffer_pool.hpp).
 
 // Note: This wastes 4 bytes of space on a 64-bit system.  (Arguably, it wastes more
 // than that given that block sizes could be 16 bits and pointers are really 48
@@ -31,6 +33,10 @@ public:
         guarantee(ser_buffer_.has());
     }
 
+    ~buf_ptr_t() {
+        reset();
+    }
+
     buf_ptr_t &operator=(buf_ptr_t &&movee) {
         buf_ptr_t tmp(std::move(movee));
         std::swap(block_size_, tmp.block_size_);
@@ -39,8 +45,11 @@ public:
     }
 
     void reset() {
+        if (ser_buffer_.has()) {
+            free_block_buffer(compute_aligned_block_size(block_size_),
+                              std::move(ser_buffer_));
+        }
         block_size_ = block_size_t::undefined();
-        ser_buffer_.reset();
     }
 
     // Allocates a block, all of whose bytes are zeroed.
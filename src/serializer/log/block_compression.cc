@@ -0,0 +1,127 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "serializer/log/block_compression.hpp"
+
+#include <string.h>
+#include <zlib.h>
+
+#include "math.hpp"
+
+// We care much more about write latency than about the last few percent of
+// compression ratio.
+const int BLOCK_COMPRESSION_LEVEL = 1;
+
+block_codec_t::block_codec_t()
+    : deflate_stream(new z_stream), inflate_stream(new z_stream) {
+    memset(deflate_stream.get(), 0, sizeof(z_stream));
+    // A negative window size gives us raw deflate data, without the zlib header and
+    // checksum.  The serializer has its own header, and a corrupted block will fail
+    // to inflate to the right size anyway.
+    int res = deflateInit2(deflate_stream.get(), BLOCK_COMPRESSION_LEVEL, Z_DEFLATED,
+                           -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    guarantee(res == Z_OK, "deflateInit2 failed (%d)", res);
+
+    memset(inflate_stream.get(), 0, sizeof(z_stream));
+    res = inflateInit2(inflate_stream.get(), -MAX_WBITS);
+    guarantee(res == Z_OK, "inflateInit2 failed (%d)", res);
+}
+
+block_codec_t::~block_codec_t() {
+    deflateEnd(deflate_stream.get());
+    inflateEnd(inflate_stream.get());
+}
+
+bool block_codec_t::compress(
+        const ser_buffer_t *buf,
+        block_size_t block_size,
+        scoped_device_block_aligned_ptr_t<ser_buffer_t> *compressed_out,
+        block_size_t *disk_block_size_out) {
+    const uint32_t aligned_size = buf_ptr_t::compute_aligned_block_size(block_size);
+    if (aligned_size <= DEVICE_BLOCK_SIZE) {
+        // There's nothing to be gained.
+        return false;
+    }
+    const uint32_t max_compressed_size
+        = aligned_size - DEVICE_BLOCK_SIZE - sizeof(compressed_ser_buffer_t);
+
+    // We only keep the result if it saves at least one device block, so there's no
+    // point in letting deflate produce more than `max_compressed_size` bytes.
+    scoped_device_block_aligned_ptr_t<ser_buffer_t> out(aligned_size
+                                                        - DEVICE_BLOCK_SIZE);
+    compressed_ser_buffer_t *cbuf = reinterpret_cast<compressed_ser_buffer_t *>(out.get());
+
+    z_stream *strm = deflate_stream.get();
+    int res = deflateReset(strm);
+    guarantee(res == Z_OK, "deflateReset failed (%d)", res);
+    strm->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(buf->cache_data));
+    strm->avail_in = block_size.value();
+    strm->next_out = reinterpret_cast<Bytef *>(cbuf->compressed_data);
+    strm->avail_out = max_compressed_size;
+    res = deflate(strm, Z_FINISH);
+    if (res != Z_STREAM_END) {
+        // Either the output didn't fit, or something went wrong.  In both cases we
+        // just store the block uncompressed.
+        guarantee(res == Z_OK || res == Z_BUF_ERROR, "deflate failed (%d)", res);
+        return false;
+    }
+
+    const uint32_t compressed_size = max_compressed_size - strm->avail_out;
+    cbuf->ser_header = buf->ser_header;
+    memcpy(cbuf->compressed_header.magic, compressed_block_magic,
+           COMPRESSED_BLOCK_MAGIC_SIZE);
+    cbuf->compressed_header.ser_block_size = block_size.ser_value();
+    cbuf->compressed_header.compressed_size = compressed_size;
+
+    const block_size_t disk_block_size
+        = block_size_t::unsafe_make(sizeof(compressed_ser_buffer_t) + compressed_size);
+    const uint32_t disk_aligned_size
+        = buf_ptr_t::compute_aligned_block_size(disk_block_size);
+    rassert(disk_aligned_size < aligned_size);
+    memset(reinterpret_cast<char *>(cbuf) + disk_block_size.ser_value(), 0,
+           disk_aligned_size - disk_block_size.ser_value());
+
+    *compressed_out = std::move(out);
+    *disk_block_size_out = disk_block_size;
+    return true;
+}
+
+buf_ptr_t block_codec_t::decompress(const ser_buffer_t *disk_buf,
+                                    block_size_t block_size,
+                                    block_size_t disk_block_size) {
+    const compressed_ser_buffer_t *cbuf
+        = reinterpret_cast<const compressed_ser_buffer_t *>(disk_buf);
+    guarantee(disk_block_size.ser_value() >= sizeof(compressed_ser_buffer_t));
+    guarantee(memcmp(cbuf->compressed_header.magic, compressed_block_magic,
+                     COMPRESSED_BLOCK_MAGIC_SIZE) == 0,
+              "Compressed block has a bad header");
+    guarantee(cbuf->compressed_header.ser_block_size == block_size.ser_value(),
+              "Compressed block has the wrong size (%" PRIu32 " instead of %" PRIu32
+              ")", cbuf->compressed_header.ser_block_size, block_size.ser_value());
+    guarantee(cbuf->compressed_header.compressed_size
+              == disk_block_size.ser_value() - sizeof(compressed_ser_buffer_t));
+
+    buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(block_size);
+    ret.ser_buffer()->ser_header = cbuf->ser_header;
+
+    z_stream *strm = inflate_stream.get();
+    int res = inflateReset(strm);
+    guarantee(res == Z_OK, "inflateReset failed (%d)", res);
+    strm->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(cbuf->compressed_data));
+    strm->avail_in = cbuf->compressed_header.compressed_size;
+    strm->next_out = reinterpret_cast<Bytef *>(ret.cache_data());
+    strm->avail_out = block_size.value();
+    res = inflate(strm, Z_FINISH);
+    guarantee(res == Z_STREAM_END && strm->avail_out == 0,
+              "Could not decompress block (%d)", res);
+
+    ret.fill_padding_zero();
+    return ret;
+}
+
+block_size_t block_codec_t::uncompressed_block_size(const ser_buffer_t *disk_buf) {
+    const compressed_ser_buffer_t *cbuf
+        = reinterpret_cast<const compressed_ser_buffer_t *>(disk_buf);
+    guarantee(memcmp(cbuf->compressed_header.magic, compressed_block_magic,
+                     COMPRESSED_BLOCK_MAGIC_SIZE) == 0,
+              "Compressed block has a bad header");
+    return block_size_t::unsafe_make(cbuf->compressed_header.ser_block_size);
+}
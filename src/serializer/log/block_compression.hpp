@@ -0,0 +1,66 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_BLOCK_COMPRESSION_HPP_
+#define SERIALIZER_LOG_BLOCK_COMPRESSION_HPP_
+
+#include "containers/scoped.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/types.hpp"
+
+struct z_stream_s;
+
+/* A compressed block is stored on disk as its usual `ls_buf_data_t` header,
+followed by a `compressed_block_header_t`, followed by the deflated contents of the
+block's `cache_data`.  The size of the compressed block on disk is recorded in the
+LBA, so whether a block is compressed is known before it is read. */
+
+#define COMPRESSED_BLOCK_MAGIC_SIZE 4
+static const char compressed_block_magic[COMPRESSED_BLOCK_MAGIC_SIZE]
+    = {'z', 'b', 'l', 'k'};
+
+ATTR_PACKED(struct compressed_block_header_t {
+    char magic[COMPRESSED_BLOCK_MAGIC_SIZE];
+    // The block's uncompressed size, as seen above the serializer.
+    uint32_t ser_block_size;
+    // The number of bytes of deflated data that follow this header.
+    uint32_t compressed_size;
+});
+
+ATTR_PACKED(struct compressed_ser_buffer_t {
+    ls_buf_data_t ser_header;
+    compressed_block_header_t compressed_header;
+    char compressed_data[];
+});
+
+/* Compresses and decompresses blocks for a single serializer.  It keeps its zlib
+state around between blocks, so it must only be used from one thread. */
+class block_codec_t {
+public:
+    block_codec_t();
+    ~block_codec_t();
+
+    /* Tries to compress the `block_size` bytes at `buf`.  If that makes the block
+    take up fewer device blocks on disk, returns true, puts the compressed block into
+    `*compressed_out` (with zeroed padding) and its size into `*disk_block_size_out`.
+    Otherwise returns false, and the block should be stored as it is. */
+    bool compress(const ser_buffer_t *buf,
+                  block_size_t block_size,
+                  scoped_device_block_aligned_ptr_t<ser_buffer_t> *compressed_out,
+                  block_size_t *disk_block_size_out);
+
+    /* Turns the compressed block `disk_buf`, as read from disk, back into the
+    uncompressed block of size `block_size`. */
+    buf_ptr_t decompress(const ser_buffer_t *disk_buf,
+                         block_size_t block_size,
+                         block_size_t disk_block_size);
+
+    /* Returns the uncompressed size of the compressed block `disk_buf`. */
+    static block_size_t uncompressed_block_size(const ser_buffer_t *disk_buf);
+
+private:
+    scoped_ptr_t<z_stream_s> deflate_stream;
+    scoped_ptr_t<z_stream_s> inflate_stream;
+
+    DISABLE_COPYING(block_codec_t);
+};
+
+#endif  // SERIALIZER_LOG_BLOCK_COMPRESSION_HPP_
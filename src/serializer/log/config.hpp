@@ -9,16 +9,38 @@
 #include "serializer/types.hpp"
 #include "rpc/serialize_macros.hpp"
 
+/* How the serializer compresses data blocks when it writes them. */
+enum class block_compression_t {
+    none,
+    zlib
+};
+
 /* Configuration for the serializer that can change from run to run */
 
 struct log_serializer_dynamic_config_t {
     log_serializer_dynamic_config_t() {
         read_ahead = true;
+        block_compression = block_compression_t::none;
+        group_commit_window_ms = DEFAULT_GROUP_COMMIT_WINDOW_MS;
+        group_commit_max_bytes = DEFAULT_GROUP_COMMIT_MAX_BYTES;
     }
 
     /* Enable reading more data than requested to let the cache warmup more quickly
        esp. on rotational drives */
     bool read_ahead;
+
+    /* Compress data blocks on write when that saves disk space.  Compressed blocks
+       are recognized and decompressed on read regardless of this setting, so it can
+       be changed from run to run. */
+    block_compression_t block_compression;
+
+    /* Index writes that are waiting for the metablock at the same time share a
+       single metablock write (and fdatasync).  While other index writes are still in
+       flight, the first one in a group waits up to `group_commit_window_ms` for them
+       to join, unless the group already covers `group_commit_max_bytes` of block
+       writes. */
+    int64_t group_commit_window_ms;
+    int64_t group_commit_max_bytes;
 };
 
 /* This is equivalent to log_serializer_static_config_t below, but is an on-disk
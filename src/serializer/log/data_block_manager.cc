@@ -12,7 +12,9 @@
 #include "concurrency/new_mutex.hpp"
 #include "errors.hpp"
 #include "perfmon/perfmon.hpp"
+#include "serializer/block_buffer_pool.hpp"
 #include "serializer/buf_ptr.hpp"
+#include "serializer/log/block_compression.hpp"
 #include "serializer/log/log_serializer.hpp"
 #include "stl_utils.hpp"
 
@@ -360,7 +362,7 @@ public:
         // It has been, or is being, reconstructed from data on disk.
         state_reconstructing,
         // We are currently putting things on this extent. It is equal to
-        // last_data_extent.
+        // `active_extent` or `gc_active_extent`.
         state_active,
         // Not active, but not a GC candidate yet. It is in young_extent_queue.
         state_young,
@@ -390,8 +392,8 @@ data_block_manager_t::data_block_manager_t(
         const log_serializer_on_disk_static_config_t *_static_config,
         log_serializer_stats_t *_stats)
     : stats(_stats), shutdown_callback(nullptr), state(state_unstarted),
-      gc_enabled(true), static_config(_static_config), extent_manager(em),
-      serializer(_serializer),
+      gc_enabled(true), mmap_reads(false), static_config(_static_config),
+      extent_manager(em), serializer(_serializer),
       gc_index_write_pumper(std::bind(
           &data_block_manager_t::flush_gc_index_writes, this, std::placeholders::_1)),
       /* The capacity of the gc_index_write_semaphore will be scaled
@@ -443,8 +445,8 @@ void data_block_manager_t::start_existing(
         const dbm_metablock_mixin_t *last_metablock) {
     guarantee(state == state_unstarted);
     dbfile = file;
-    gc_io_account_nice.init(new file_account_t(file, GC_IO_PRIORITY_NICE));
-    gc_io_account_high.init(new file_account_t(file, GC_IO_PRIORITY_HIGH));
+    gc_io_account_nice.init(new file_account_t(file, GC_IO_PRIORITY_NICE, "gc"));
+    gc_io_account_high.init(new file_account_t(file, GC_IO_PRIORITY_HIGH, "gc"));
 
     /* Reconstruct the active data block extents from the metablock. */
     const int64_t offset = last_metablock->active_extent;
@@ -469,6 +471,7 @@ void data_block_manager_t::start_existing(
     } else {
         active_extent = nullptr;
     }
+    gc_active_extent = nullptr;
 
     /* Convert any extents that we found live blocks in, but that are not active
     extents, into old extents */
@@ -586,6 +589,8 @@ public:
         return entry->block_boundaries();
     }
 
+    // `ser_block_size_in` is the size of the block at `off_in` on disk.  The block
+    // is copied into `buf_out` as it is, without decompressing it.
     static void perform_read_ahead(data_block_manager_t *const parent,
                                    const int64_t off_in,
                                    const uint32_t ser_block_size_in,
@@ -654,14 +659,25 @@ public:
 
                 const block_size_t block_size
                     = block_size_t::unsafe_make(info.ser_block_size);
-                buf_ptr_t buf = buf_ptr_t::alloc_uninitialized(block_size);
-                memcpy(buf.ser_buffer(), current_buf, info.ser_block_size);
-                buf.fill_padding_zero();
-                guarantee(info.ser_block_size <= *(lower_it + 1) - *lower_it);
+                const block_size_t disk_block_size
+                    = block_size_t::unsafe_make(info.actual_disk_block_size());
+                guarantee(disk_block_size.ser_value() <= *(lower_it + 1) - *lower_it);
+
+                buf_ptr_t buf;
+                if (disk_block_size == block_size) {
+                    buf = buf_ptr_t::alloc_uninitialized(block_size);
+                    memcpy(buf.ser_buffer(), current_buf, info.ser_block_size);
+                    buf.fill_padding_zero();
+                } else {
+                    buf = parent->get_block_codec()->decompress(
+                        reinterpret_cast<const ser_buffer_t *>(current_buf),
+                        block_size, disk_block_size);
+                }
 
                 counted_t<block_token_t> token
                     = parent->serializer->generate_block_token(current_offset,
-                                                               block_size);
+                                                               block_size,
+                                                               disk_block_size);
 
                 parent->serializer->offer_buf_to_read_ahead_callbacks(
                         block_id,
@@ -686,8 +702,32 @@ bool data_block_manager_t::should_perform_read_ahead(int64_t offset) {
 }
 
 buf_ptr_t data_block_manager_t::read(int64_t off_in, block_size_t block_size,
-                                   file_account_t *io_account) {
+                                     block_size_t disk_block_size,
+                                     file_account_t *io_account) {
     guarantee(state == state_ready);
+    buf_ptr_t disk_buf = read_raw(off_in, disk_block_size, io_account);
+    if (disk_block_size == block_size) {
+        return disk_buf;
+    }
+    return get_block_codec()->decompress(disk_buf.ser_buffer(), block_size,
+                                         disk_block_size);
+}
+
+void data_block_manager_t::set_mmap_reads(bool enabled) {
+    mmap_reads = enabled;
+}
+
+buf_ptr_t data_block_manager_t::read_raw(int64_t off_in, block_size_t block_size,
+                                         file_account_t *io_account) {
+    if (mmap_reads
+        && !entries.get(static_config->extent_index(off_in))->was_written) {
+        buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(block_size);
+        if (dbfile->read_mapped(off_in, block_size.ser_value(), ret.ser_buffer())) {
+            ret.fill_padding_zero();
+            return ret;
+        }
+    }
+
     if (should_perform_read_ahead(off_in)) {
         buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(block_size);
         dbm_read_ahead_t::perform_read_ahead(this, off_in, block_size.ser_value(),
@@ -710,13 +750,16 @@ buf_ptr_t data_block_manager_t::read(int64_t off_in, block_size_t block_size,
             int64_t floor_off_in = floor_aligned(off_in, DEVICE_BLOCK_SIZE);
             int64_t ceil_off_end = ceil_aligned(off_in + block_size.ser_value(),
                                                 DEVICE_BLOCK_SIZE);
-            scoped_device_block_aligned_ptr_t<char> buf(ceil_off_end - floor_off_in);
-            co_read(dbfile, floor_off_in, ceil_off_end - floor_off_in,
-                    buf.get(), io_account);
+            const size_t read_size = ceil_off_end - floor_off_in;
+            scoped_device_block_aligned_ptr_t<ser_buffer_t> buf
+                = alloc_block_buffer(read_size);
+            co_read(dbfile, floor_off_in, read_size, buf.get(), io_account);
 
             buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(block_size);
-            memcpy(ret.ser_buffer(), buf.get() + (off_in - floor_off_in),
+            memcpy(ret.ser_buffer(),
+                   reinterpret_cast<const char *>(buf.get()) + (off_in - floor_off_in),
                    block_size.ser_value());
+            free_block_buffer(read_size, std::move(buf));
             stats->bytes_read(ret.aligned_block_size());
             // We have to fill the padding to zero, in this case.
             ret.fill_padding_zero();
@@ -729,15 +772,51 @@ std::vector<counted_t<block_token_t>>
 data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
                                   file_account_t *io_account,
                                   iocallback_t *cb) {
+    return write_blocks(writes, extent_stream_t::fresh, io_account, cb);
+}
+
+std::vector<counted_t<block_token_t>>
+data_block_manager_t::write_blocks(const std::vector<buf_write_info_t> &writes,
+                                   extent_stream_t stream,
+                                   file_account_t *io_account,
+                                   iocallback_t *cb) {
     // These tokens are grouped by extent.  You can do a contiguous write in each
     // extent.
-    std::vector<std::vector<counted_t<block_token_t>>> token_groups
-        = gimme_some_new_offsets(writes);
-
     for (auto it = writes.begin(); it != writes.end(); ++it) {
         it->buf->ser_header.block_id = it->block_id;
     }
 
+    // The blocks as they get written to disk.  The compressed copies of blocks that
+    // we compress here are kept in `compressed_bufs` until the writes are done.
+    std::vector<buf_write_info_t> disk_writes;
+    std::vector<scoped_device_block_aligned_ptr_t<ser_buffer_t>> compressed_bufs;
+    disk_writes.reserve(writes.size());
+    const bool compress
+        = serializer->dynamic_config.block_compression == block_compression_t::zlib;
+    for (auto it = writes.begin(); it != writes.end(); ++it) {
+        // Blocks that are already compressed (which get rewritten by the GC) are
+        // written as they are.
+        if (compress && it->disk_block_size == it->block_size) {
+            scoped_device_block_aligned_ptr_t<ser_buffer_t> compressed;
+            block_size_t disk_block_size = block_size_t::undefined();
+            if (get_block_codec()->compress(it->buf, it->block_size,
+                                            &compressed, &disk_block_size)) {
+                ++stats->pm_serializer_compressed_block_writes;
+                stats->pm_serializer_compression_saved_bytes
+                    += gc_entry_t::aligned_value(it->block_size)
+                    - gc_entry_t::aligned_value(disk_block_size);
+                disk_writes.push_back(buf_write_info_t(compressed.get(), it->block_size,
+                                                       disk_block_size, it->block_id));
+                compressed_bufs.push_back(std::move(compressed));
+                continue;
+            }
+        }
+        disk_writes.push_back(*it);
+    }
+
+    std::vector<std::vector<counted_t<block_token_t>>> token_groups
+        = gimme_some_new_offsets(disk_writes, stream);
+
     struct intermediate_cb_t : public iocallback_t {
         virtual void on_io_complete() {
             --ops_remaining;
@@ -750,9 +829,11 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
 
         size_t ops_remaining;
         iocallback_t *cb;
+        std::vector<scoped_device_block_aligned_ptr_t<ser_buffer_t>> compressed_bufs;
     };
 
     intermediate_cb_t *const intermediate_cb = new intermediate_cb_t;
+    intermediate_cb->compressed_bufs = std::move(compressed_bufs);
     // We add 1 for degenerate case where token_groups is empty -- we call
     // intermediate_cb->on_io_complete later.
     intermediate_cb->ops_remaining = token_groups.size() + 1;
@@ -763,7 +844,7 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
 
         const int64_t front_offset = token_groups[i].front()->offset();
         const int64_t back_offset = token_groups[i].back()->offset()
-            + gc_entry_t::aligned_value(token_groups[i].back()->block_size());
+            + gc_entry_t::aligned_value(token_groups[i].back()->disk_block_size());
 
         guarantee(divides(DEVICE_BLOCK_SIZE, front_offset));
 
@@ -776,16 +857,16 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
 
         for (size_t j = 0; j < token_groups[i].size(); ++j) {
             const int64_t j_offset = token_groups[i][j]->offset();
-            const block_size_t j_block_size = token_groups[i][j]->block_size();
+            const block_size_t j_block_size = token_groups[i][j]->disk_block_size();
             guarantee(j_offset == last_written_offset);
             const size_t j_aligned_size = gc_entry_t::aligned_value(j_block_size);
             total_aligned_size += j_aligned_size;
 
             // The behavior of gimme_some_new_offsets is supposed to retain order, so
             // we expect writes[write_number] to have the currently-relevant write.
-            guarantee(writes[write_number].block_size == j_block_size);
+            guarantee(disk_writes[write_number].disk_block_size == j_block_size);
 
-            iovecs[j].iov_base = writes[write_number].buf;
+            iovecs[j].iov_base = disk_writes[write_number].buf;
             iovecs[j].iov_len = j_aligned_size;
             last_written_offset = j_offset + j_aligned_size;
 
@@ -798,6 +879,11 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
                              std::move(iovecs), io_account, intermediate_cb);
 
         stats->bytes_written(total_aligned_size);
+        if (stream == extent_stream_t::gc) {
+            gc_stats.gc_written_block_bytes += total_aligned_size;
+        } else {
+            gc_stats.fresh_written_block_bytes += total_aligned_size;
+        }
     }
 
     // Call on_io_complete for degenerate case (we added 1 to ops_remaining
@@ -1178,8 +1264,12 @@ void data_block_manager_t::gc_one_extent(gc_state_t *gc_state) {
                     gc_state->current_entry->extent_ref.offset()
                     + gc_state->current_entry->relative_offset(i);
 
+                const block_size_t disk_block_size
+                    = gc_state->current_entry->block_size(i);
                 gc_writes.push_back(gc_write_t(block, block_offset,
-                    gc_state->current_entry->block_size(i)));
+                    live_block_size(block_offset, block->ser_header.block_id,
+                                    disk_block_size),
+                    disk_block_size));
             }
             guarantee(gc_writes.size() == num_writes);
         }
@@ -1241,15 +1331,17 @@ void data_block_manager_t::write_gcs(
         for (size_t i = 0; i < writes.size(); ++i) {
             old_block_tokens.push_back(
                     serializer->generate_block_token(writes[i].old_offset,
-                                                     writes[i].block_size));
+                                                     writes[i].block_size,
+                                                     writes[i].disk_block_size));
 
             the_writes.push_back(buf_write_info_t(writes[i].buf,
                                                   writes[i].block_size,
+                                                  writes[i].disk_block_size,
                                                   writes[i].buf->ser_header.block_id));
         }
 
-        new_block_tokens = many_writes(the_writes, choose_gc_io_account(),
-                                       &block_write_cond);
+        new_block_tokens = write_blocks(the_writes, extent_stream_t::gc,
+                                        choose_gc_io_account(), &block_write_cond);
 
         guarantee(new_block_tokens.size() == writes.size());
     }
@@ -1401,6 +1493,12 @@ void data_block_manager_t::actually_shutdown() {
         active_extent = nullptr;
     }
 
+    if (gc_active_extent != nullptr) {
+        UNUSED int64_t extent = gc_active_extent->extent_ref.release();
+        delete gc_active_extent;
+        gc_active_extent = nullptr;
+    }
+
     while (gc_entry_t *entry = young_extent_queue.head()) {
         young_extent_queue.remove(entry);
         UNUSED int64_t extent = entry->extent_ref.release();
@@ -1419,17 +1517,20 @@ void data_block_manager_t::actually_shutdown() {
 }
 
 std::vector<std::vector<counted_t<block_token_t>>>
-data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes) {
+data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes,
+                                             extent_stream_t stream) {
     ASSERT_NO_CORO_WAITING;
 
+    gc_entry_t **const active = active_extent_for_stream(stream);
+
     // Start a new extent if necessary.
-    if (active_extent == nullptr) {
-        active_extent = new gc_entry_t(this);
+    if (*active == nullptr) {
+        *active = new gc_entry_t(this);
         ++stats->pm_serializer_data_extents_allocated;
     }
 
 
-    guarantee(active_extent->state == gc_entry_t::state_active);
+    guarantee((*active)->state == gc_entry_t::state_active);
 
     std::vector<std::vector<counted_t<block_token_t>>> ret;
 
@@ -1437,25 +1538,25 @@ data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t>
     for (auto it = writes.begin(); it != writes.end(); ++it) {
         uint32_t relative_offset = valgrind_undefined<uint32_t>(UINT32_MAX);
         unsigned int block_index = valgrind_undefined<unsigned int>(UINT_MAX);
-        if (!active_extent->new_offset(it->block_size,
-                                       &relative_offset, &block_index)) {
-            // Move the active_extent gc_entry_t to the young extent queue (if it's
+        if (!(*active)->new_offset(it->disk_block_size,
+                                   &relative_offset, &block_index)) {
+            // Move the active gc_entry_t to the young extent queue (if it's
             // not already empty), and make a new gc_entry_t.
-            if (active_extent->num_live_blocks() == 0) {
-                gc_entry_t *old_active_extent = active_extent;
-                active_extent = new gc_entry_t(this);
+            if ((*active)->num_live_blocks() == 0) {
+                gc_entry_t *old_active_extent = *active;
+                *active = new gc_entry_t(this);
                 destroy_entry(old_active_extent);
             } else {
-                active_extent->state = gc_entry_t::state_young;
-                young_extent_queue.push_back(active_extent);
+                (*active)->state = gc_entry_t::state_young;
+                young_extent_queue.push_back(*active);
                 mark_unyoung_entries();
-                active_extent = new gc_entry_t(this);
+                *active = new gc_entry_t(this);
             }
 
             ++stats->pm_serializer_data_extents_allocated;
-            const bool succeeded = active_extent->new_offset(it->block_size,
-                                                             &relative_offset,
-                                                             &block_index);
+            const bool succeeded = (*active)->new_offset(it->disk_block_size,
+                                                         &relative_offset,
+                                                         &block_index);
             guarantee(succeeded);
 
             // Push the current group of tokens, if it's nonempty, onto the return
@@ -1466,11 +1567,12 @@ data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t>
             }
         }
 
-        const int64_t offset = active_extent->extent_ref.offset() + relative_offset;
-        active_extent->was_written = true;
-        active_extent->mark_live_tokenwise(block_index);
+        const int64_t offset = (*active)->extent_ref.offset() + relative_offset;
+        (*active)->was_written = true;
+        (*active)->mark_live_tokenwise(block_index);
 
-        tokens.push_back(serializer->generate_block_token(offset, it->block_size));
+        tokens.push_back(serializer->generate_block_token(offset, it->block_size,
+                                                          it->disk_block_size));
     }
 
     if (!tokens.empty()) {
@@ -1480,6 +1582,37 @@ data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t>
     return ret;
 }
 
+gc_entry_t **data_block_manager_t::active_extent_for_stream(extent_stream_t stream) {
+    switch (stream) {
+    case extent_stream_t::fresh: return &active_extent;
+    case extent_stream_t::gc: return &gc_active_extent;
+    default: unreachable();
+    }
+}
+
+block_size_t data_block_manager_t::live_block_size(int64_t offset,
+                                                   block_id_t block_id,
+                                                   block_size_t disk_block_size) {
+    // A live block is either referenced by block tokens, which know its size, or by
+    // the LBA.
+    auto token_it = serializer->offset_tokens.find(offset);
+    if (token_it != serializer->offset_tokens.end()) {
+        guarantee(token_it->second->disk_block_size() == disk_block_size);
+        return token_it->second->block_size();
+    }
+    const index_block_info_t info = serializer->lba_index->get_block_info(block_id);
+    guarantee(info.offset.has_value() && info.offset.get_value() == offset);
+    guarantee(info.actual_disk_block_size() == disk_block_size.ser_value());
+    return block_size_t::unsafe_make(info.ser_block_size);
+}
+
+block_codec_t *data_block_manager_t::get_block_codec() {
+    if (!block_codec.has()) {
+        block_codec.init(new block_codec_t());
+    }
+    return block_codec.get();
+}
+
 bool data_block_manager_t::is_gc_active() const {
     return !active_gcs.empty();
 }
@@ -1567,4 +1700,6 @@ void data_block_manager_t::gc_stat_t::operator-=(int64_t num) {
 
 data_block_manager_t::gc_stats_t::gc_stats_t(log_serializer_stats_t *_stats)
     : old_total_block_bytes(&_stats->pm_serializer_old_total_block_bytes),
-      old_garbage_block_bytes(&_stats->pm_serializer_old_garbage_block_bytes) { }
+      old_garbage_block_bytes(&_stats->pm_serializer_old_garbage_block_bytes),
+      fresh_written_block_bytes(&_stats->pm_serializer_fresh_written_block_bytes),
+      gc_written_block_bytes(&_stats->pm_serializer_gc_written_block_bytes) { }
@@ -16,6 +16,7 @@
 #include "serializer/log/extent_manager.hpp"
 #include "serializer/types.hpp"
 
+class block_codec_t;
 class buf_ptr_t;
 class log_serializer_t;
 class data_block_manager_t;
@@ -48,8 +49,10 @@ public:
     static void prepare_initial_metablock(dbm_metablock_mixin_t *mb);
     void start_existing(file_t *dbfile, const dbm_metablock_mixin_t *last_metablock);
 
+    // `disk_block_size` is the size of the block as stored on disk; reads of
+    // compressed blocks are decompressed to `block_size`.
     buf_ptr_t read(int64_t off_in, block_size_t block_size,
-                   file_account_t *io_account);
+                   block_size_t disk_block_size, file_account_t *io_account);
 
     /* exposed gc api */
     /* mark a buffer as garbage */
@@ -87,14 +90,49 @@ public:
                 file_account_t *io_account,
                 iocallback_t *cb);
 
+    // Fresh writes and blocks relocated by the GC go to separate active extents, so
+    // that long-lived blocks the GC keeps moving end up next to each other instead
+    // of being mixed with frequently overwritten ones.
+    enum class extent_stream_t {
+        fresh,
+        gc
+    };
+
     std::vector<std::vector<counted_t<block_token_t>>>
-    gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes);
+    gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes,
+                           extent_stream_t stream);
 
     bool is_gc_active() const;
 
+    /* With mapped reads, blocks in extents that haven't been written since startup
+    are copied straight out of the OS page cache through a memory mapping of the file
+    when they're resident there, instead of going through the I/O queue. Written
+    extents always use regular reads, because a mapped page of a reused extent
+    could be stale with direct I/O. */
+    void set_mmap_reads(bool enabled);
+
 private:
     void actually_shutdown();
 
+    std::vector<counted_t<block_token_t>>
+    write_blocks(const std::vector<buf_write_info_t> &writes,
+                 extent_stream_t stream,
+                 file_account_t *io_account,
+                 iocallback_t *cb);
+
+    gc_entry_t **active_extent_for_stream(extent_stream_t stream);
+
+    // Reads `disk_block_size` bytes at `off_in`, without decompressing them.
+    buf_ptr_t read_raw(int64_t off_in, block_size_t disk_block_size,
+                       file_account_t *io_account);
+
+    // Returns the uncompressed size of the live block at `offset`, whose size on
+    // disk is `disk_block_size`.
+    block_size_t live_block_size(int64_t offset, block_id_t block_id,
+                                 block_size_t disk_block_size);
+
+    block_codec_t *get_block_codec();
+
     struct gc_state_t : public intrusive_list_node_t<gc_state_t>{
     public:
         // The entry we're currently GCing.
@@ -111,10 +149,13 @@ private:
         ser_buffer_t *buf;
         int64_t old_offset;
         block_size_t block_size;
+        // `buf` holds the block as it was on disk, so this differs from `block_size`
+        // for compressed blocks.
+        block_size_t disk_block_size;
         gc_write_t(ser_buffer_t *b, int64_t _old_offset,
-                   block_size_t _block_size)
+                   block_size_t _block_size, block_size_t _disk_block_size)
             : buf(b), old_offset(_old_offset),
-              block_size(_block_size) { }
+              block_size(_block_size), disk_block_size(_disk_block_size) { }
     };
 
     /* Runs in a coroutine and keeps calling `gc_one_extent()` for as long as
@@ -176,12 +217,18 @@ private:
 
     bool gc_enabled;
 
+    bool mmap_reads;
+
     const log_serializer_on_disk_static_config_t* const static_config;
 
     extent_manager_t *const extent_manager;
     log_serializer_t *const serializer;
 
     file_t *dbfile;
+
+    // Created the first time we need to compress or decompress a block.
+    scoped_ptr_t<block_codec_t> block_codec;
+
     scoped_ptr_t<file_account_t> gc_io_account_nice;
     scoped_ptr_t<file_account_t> gc_io_account_high;
 
@@ -192,8 +239,12 @@ private:
     /* Contains every extent in the gc_entry_t::state_reconstructing state */
     intrusive_list_t<gc_entry_t> reconstructed_extents;
 
-    /* Contains the extent in the gc_entry_t::state_active state. */
+    /* Contain the extents in the gc_entry_t::state_active state: the one that fresh
+    writes go to, and the one that the GC relocates blocks to.  Only the former is
+    recorded in the metablock; after a restart the GC's extent is treated like any
+    other old extent. */
     gc_entry_t *active_extent;
+    gc_entry_t *gc_active_extent;
 
     /* Contains every extent in the gc_entry_t::state_young state */
     intrusive_list_t<gc_entry_t> young_extent_queue;
@@ -258,6 +309,11 @@ private:
     struct gc_stats_t {
         gc_stat_t old_total_block_bytes;
         gc_stat_t old_garbage_block_bytes;
+        // Bytes of data blocks written on behalf of the serializer's users, and bytes
+        // rewritten by the GC.  The GC's write amplification is
+        // (fresh + gc) / fresh.
+        gc_stat_t fresh_written_block_bytes;
+        gc_stat_t gc_written_block_bytes;
         explicit gc_stats_t(log_serializer_stats_t *);
     };
 
@@ -60,9 +60,10 @@ ATTR_PACKED(struct lba_entry_t {
     // (It probably assumes that sizeof(lba_entry_t) evenly divides
     // DEVICE_BLOCK_SIZE).
 
-    // Put the zero-padding at the beginning of the LBA entry.  We could use this, or
-    // the first 16 bits, perhaps, as a version flag.
-    uint32_t zero_reserved;
+    // The size of the block on disk, if the block is stored compressed, and 0
+    // otherwise.  This used to be zero padding, so entries written by older
+    // versions always describe uncompressed blocks.
+    uint32_t disk_block_size;
 
     // This could be a uint16_t if you wanted it to be, as long as block sizes are
     // all less than or equal to 4K (which is less than 64K).
@@ -76,10 +77,12 @@ ATTR_PACKED(struct lba_entry_t {
     flagged_off64_t offset;
 
     static lba_entry_t make(block_id_t block_id, repli_timestamp_t recency,
-                            flagged_off64_t offset, uint32_t ser_block_size) {
+                            flagged_off64_t offset, uint32_t ser_block_size,
+                            uint32_t disk_block_size) {
         guarantee(ser_block_size != 0 || !offset.has_value());
+        guarantee(disk_block_size < ser_block_size || disk_block_size == 0);
         lba_entry_t entry;
-        entry.zero_reserved = 0;
+        entry.disk_block_size = disk_block_size;
         entry.ser_block_size = ser_block_size;
         entry.block_id = block_id;
         entry.recency = recency;
@@ -93,7 +96,7 @@ ATTR_PACKED(struct lba_entry_t {
 
     static lba_entry_t make_padding_entry() {
         return make(PADDING_BLOCK_ID, repli_timestamp_t::invalid,
-                    flagged_off64_t::padding(), 0);
+                    flagged_off64_t::padding(), 0, 0);
     }
 });
 
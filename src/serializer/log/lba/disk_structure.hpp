@@ -9,6 +9,7 @@
 #include "serializer/log/lba/disk_format.hpp"
 #include "serializer/log/lba/disk_extent.hpp"
 
+class blocker_pool_t;
 class lba_load_fsm_t;
 class lba_writer_t;
 
@@ -34,6 +35,7 @@ public:
     // Put entries in an LBA and then call wait_for_write_completion() to write to disk
     void add_entry(block_id_t block_id, repli_timestamp_t recency,
                    flagged_off64_t offset, uint32_t ser_block_size,
+                   uint32_t disk_block_size,
                    file_account_t *io_account,
                    extent_transaction_t *txn);
     struct completion_callback_t {
@@ -55,12 +57,18 @@ public:
                          file_account_t *io_account, extent_transaction_t *txn);
 
     // If you call read(), then the in_memory_index_t will be populated and then the
-    // read_callback_t will be called when it is done.
+    // read_callback_t will be called when it is done.  If `replay_pool` isn't null,
+    // the entries are applied to the index on its threads.  That's safe because
+    // every disk structure fills a different shard of the index.
     struct read_callback_t {
         virtual void on_lba_extents_read() = 0;
         virtual ~read_callback_t() {}
     };
-    void read(in_memory_index_t *index, read_callback_t *cb);
+    void read(in_memory_index_t *index, blocker_pool_t *replay_pool,
+              read_callback_t *cb);
+
+    // The number of LBA extents, including the one currently being filled.
+    size_t num_extents() const;
 
     void prepare_metablock(lba_shard_metablock_t *mb_out);
 
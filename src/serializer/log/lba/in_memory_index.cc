@@ -2,51 +2,346 @@
 #include "serializer/log/lba/in_memory_index.hpp"
 
 #include <inttypes.h>
+#include <string.h>
 
+#include <algorithm>
+
+#include "containers/scoped.hpp"
+#include "perfmon/memory_accounting.hpp"
 #include "serializer/log/lba/disk_format.hpp"
 
-in_memory_index_t::in_memory_index_t()
-    : end_block_id_(0), end_aux_block_id_(FIRST_AUX_BLOCK_ID) { }
+// The number of block infos per chunk of a `packed_block_info_array_t`.
+const size_t PACKED_INFO_CHUNK_SIZE = 1 << 14;
+
+// Offsets are stored plus one in 48 bits, so that 0 means `flagged_off64_t::unused()`.
+const int64_t PACKED_INFO_MAX_OFFSET = (INT64_C(1) << 48) - 2;
+
+// Stands for `repli_timestamp_t::invalid` in a chunk's recency deltas.
+const uint32_t PACKED_INFO_INVALID_DELTA = UINT32_MAX;
+
+struct packed_block_info_array_t::chunk_t {
+    enum class recency_mode_t {
+        // All present entries have the recency `recency_base`.
+        uniform,
+        // The recency of a present entry is `recency_base +
+        // recency_deltas[i]`, or invalid if that is `PACKED_INFO_INVALID_DELTA`.
+        delta,
+        // The recency of a present entry is `recencies[i]`.
+        wide
+    };
+
+    chunk_t() : count(0), recency_mode(recency_mode_t::uniform),
+                recency_base(repli_timestamp_t::invalid) {
+        memset(present, 0, sizeof(present));
+    }
+
+    size_t bytes() const {
+        switch (recency_mode) {
+        case recency_mode_t::uniform: return sizeof(chunk_t);
+        case recency_mode_t::delta:
+            return sizeof(chunk_t) + PACKED_INFO_CHUNK_SIZE * sizeof(uint32_t);
+        case recency_mode_t::wide:
+            return sizeof(chunk_t) + PACKED_INFO_CHUNK_SIZE * sizeof(uint64_t);
+        default: unreachable();
+        }
+    }
+
+    bool is_present(size_t i) const {
+        return (present[i / 64] >> (i % 64)) & 1;
+    }
+
+    void set_present(size_t i, bool value) {
+        if (value) {
+            present[i / 64] |= UINT64_C(1) << (i % 64);
+        } else {
+            present[i / 64] &= ~(UINT64_C(1) << (i % 64));
+        }
+    }
+
+    flagged_off64_t offset(size_t i) const {
+        const uint64_t packed = offset_low[i]
+            | (static_cast<uint64_t>(offset_high[i]) << 32);
+        return packed == 0
+            ? flagged_off64_t::unused()
+            : flagged_off64_t::make(packed - 1);
+    }
+
+    void set_offset(size_t i, flagged_off64_t offset) {
+        uint64_t packed = 0;
+        if (offset.has_value()) {
+            guarantee(offset.get_value() <= PACKED_INFO_MAX_OFFSET);
+            packed = offset.get_value() + 1;
+        } else {
+            guarantee(offset == flagged_off64_t::unused());
+        }
+        offset_low[i] = static_cast<uint32_t>(packed);
+        offset_high[i] = static_cast<uint16_t>(packed >> 32);
+    }
+
+    repli_timestamp_t recency(size_t i) const {
+        switch (recency_mode) {
+        case recency_mode_t::uniform: return recency_base;
+        case recency_mode_t::delta: {
+            if (recency_deltas[i] == PACKED_INFO_INVALID_DELTA) {
+                return repli_timestamp_t::invalid;
+            }
+            repli_timestamp_t ret;
+            ret.longtime = recency_base.longtime + recency_deltas[i];
+            return ret;
+        }
+        case recency_mode_t::wide: {
+            repli_timestamp_t ret;
+            ret.longtime = recencies[i];
+            return ret;
+        }
+        default: unreachable();
+        }
+    }
+
+    // Must be called before `i` is marked as present.
+    void set_recency(size_t i, repli_timestamp_t recency) {
+        switch (recency_mode) {
+        case recency_mode_t::uniform: {
+            const size_t others = count - (is_present(i) ? 1 : 0);
+            if (others == 0) {
+                recency_base = recency;
+            } else if (recency != recency_base) {
+                make_delta(recency);
+                set_recency(i, recency);
+            }
+        } break;
+        case recency_mode_t::delta: {
+            if (recency == repli_timestamp_t::invalid) {
+                recency_deltas[i] = PACKED_INFO_INVALID_DELTA;
+            } else if (recency < recency_base) {
+                rebase(recency);
+                set_recency(i, recency);
+            } else if (recency.longtime - recency_base.longtime
+                       >= PACKED_INFO_INVALID_DELTA) {
+                make_wide();
+                set_recency(i, recency);
+            } else {
+                recency_deltas[i] = recency.longtime - recency_base.longtime;
+            }
+        } break;
+        case recency_mode_t::wide:
+            recencies[i] = recency.longtime;
+            break;
+        default: unreachable();
+        }
+    }
+
+    // Switches from `uniform` to `delta` mode, so that `new_recency` can be stored.
+    void make_delta(repli_timestamp_t new_recency) {
+        rassert(recency_mode == recency_mode_t::uniform);
+        const repli_timestamp_t old_recency = recency_base;
+        recency_deltas.init(PACKED_INFO_CHUNK_SIZE);
+        recency_mode = recency_mode_t::delta;
+        if (old_recency == repli_timestamp_t::invalid) {
+            recency_base = new_recency;
+            for (size_t i = 0; i < PACKED_INFO_CHUNK_SIZE; ++i) {
+                recency_deltas[i] = PACKED_INFO_INVALID_DELTA;
+            }
+        } else {
+            for (size_t i = 0; i < PACKED_INFO_CHUNK_SIZE; ++i) {
+                recency_deltas[i] = 0;
+            }
+            // `set_recency` rebases or widens as needed when it stores
+            // `new_recency`.
+        }
+    }
+
+    // Lowers `recency_base` to `new_base`, widening the chunk if that makes some
+    // delta too big.
+    void rebase(repli_timestamp_t new_base) {
+        rassert(recency_mode == recency_mode_t::delta);
+        rassert(new_base < recency_base);
+        const uint64_t shift = recency_base.longtime - new_base.longtime;
+        for (size_t i = 0; i < PACKED_INFO_CHUNK_SIZE; ++i) {
+            if (is_present(i) && recency_deltas[i] != PACKED_INFO_INVALID_DELTA
+                && recency_deltas[i] + shift >= PACKED_INFO_INVALID_DELTA) {
+                make_wide();
+                return;
+            }
+        }
+        for (size_t i = 0; i < PACKED_INFO_CHUNK_SIZE; ++i) {
+            if (recency_deltas[i] != PACKED_INFO_INVALID_DELTA) {
+                recency_deltas[i] += shift;
+            }
+        }
+        recency_base = new_base;
+    }
+
+    void make_wide() {
+        rassert(recency_mode == recency_mode_t::delta);
+        recencies.init(PACKED_INFO_CHUNK_SIZE);
+        for (size_t i = 0; i < PACKED_INFO_CHUNK_SIZE; ++i) {
+            recencies[i] = recency(i).longtime;
+        }
+        recency_mode = recency_mode_t::wide;
+        recency_deltas.reset();
+    }
+
+    // The number of present entries.
+    size_t count;
+    // A bit for every entry that isn't `index_block_info_t()`.  The values of entries
+    // that aren't present are undefined.
+    uint64_t present[PACKED_INFO_CHUNK_SIZE / 64];
+
+    uint32_t offset_low[PACKED_INFO_CHUNK_SIZE];
+    uint16_t offset_high[PACKED_INFO_CHUNK_SIZE];
+    uint16_t ser_block_sizes[PACKED_INFO_CHUNK_SIZE];
+    uint16_t disk_block_sizes[PACKED_INFO_CHUNK_SIZE];
+
+    recency_mode_t recency_mode;
+    repli_timestamp_t recency_base;
+    scoped_array_t<uint32_t> recency_deltas;
+    scoped_array_t<uint64_t> recencies;
+
+    DISABLE_COPYING(chunk_t);
+};
+
+packed_block_info_array_t::packed_block_info_array_t() : memory_usage_(0) { }
+
+packed_block_info_array_t::~packed_block_info_array_t() {
+    for (auto it = chunks_.begin(); it != chunks_.end(); ++it) {
+        delete *it;
+    }
+    account_memory(memory_category_t::lba_index, -static_cast<int64_t>(memory_usage_));
+}
+
+index_block_info_t packed_block_info_array_t::get(size_t key) const {
+    const size_t chunk_id = key / PACKED_INFO_CHUNK_SIZE;
+    if (chunk_id >= chunks_.size() || chunks_[chunk_id] == nullptr) {
+        return index_block_info_t();
+    }
+    const chunk_t *chunk = chunks_[chunk_id];
+    const size_t i = key % PACKED_INFO_CHUNK_SIZE;
+    if (!chunk->is_present(i)) {
+        return index_block_info_t();
+    }
+    return index_block_info_t(chunk->offset(i), chunk->recency(i),
+                              chunk->ser_block_sizes[i], chunk->disk_block_sizes[i]);
+}
+
+void packed_block_info_array_t::set(size_t key, const index_block_info_t &info) {
+    const size_t chunk_id = key / PACKED_INFO_CHUNK_SIZE;
+    const bool is_empty = info == index_block_info_t();
+    if (chunk_id >= chunks_.size() || chunks_[chunk_id] == nullptr) {
+        if (is_empty) {
+            return;
+        }
+        allocate_chunk(chunk_id);
+    }
+
+    chunk_t *chunk = chunks_[chunk_id];
+    const size_t i = key % PACKED_INFO_CHUNK_SIZE;
+    if (is_empty) {
+        if (chunk->is_present(i)) {
+            chunk->set_present(i, false);
+            --chunk->count;
+            if (chunk->count == 0) {
+                free_chunk(chunk_id);
+            }
+        }
+        return;
+    }
+
+    const size_t old_bytes = chunk->bytes();
+    chunk->set_offset(i, info.offset);
+    chunk->ser_block_sizes[i] = info.ser_block_size;
+    chunk->disk_block_sizes[i] = info.disk_block_size;
+    chunk->set_recency(i, info.recency);
+    if (!chunk->is_present(i)) {
+        chunk->set_present(i, true);
+        ++chunk->count;
+    }
+    update_memory_usage(old_bytes, chunk->bytes());
+}
+
+void packed_block_info_array_t::allocate_chunk(size_t chunk_id) {
+    if (chunk_id >= chunks_.size()) {
+        chunks_.resize(chunk_id + 1, nullptr);
+    }
+    chunks_[chunk_id] = new chunk_t;
+    update_memory_usage(0, chunks_[chunk_id]->bytes());
+}
+
+void packed_block_info_array_t::free_chunk(size_t chunk_id) {
+    update_memory_usage(chunks_[chunk_id]->bytes(), 0);
+    delete chunks_[chunk_id];
+    chunks_[chunk_id] = nullptr;
+
+    while (!chunks_.empty() && chunks_.back() == nullptr) {
+        chunks_.pop_back();
+    }
+}
+
+void packed_block_info_array_t::update_memory_usage(size_t old_chunk_bytes,
+                                                    size_t new_chunk_bytes) {
+    rassert(memory_usage_ >= old_chunk_bytes);
+    memory_usage_ = memory_usage_ - old_chunk_bytes + new_chunk_bytes;
+    account_memory(memory_category_t::lba_index,
+                   static_cast<int64_t>(new_chunk_bytes)
+                   - static_cast<int64_t>(old_chunk_bytes));
+}
+
+CT_ASSERT(FIRST_AUX_BLOCK_ID % LBA_SHARD_FACTOR == 0);
 
 block_id_t in_memory_index_t::end_block_id() {
-    return end_block_id_;
+    block_id_t ret = 0;
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        ret = std::max(ret, shards_[i].end_block_id);
+    }
+    return ret;
 }
 
 block_id_t in_memory_index_t::end_aux_block_id() {
-    return end_aux_block_id_;
+    block_id_t ret = FIRST_AUX_BLOCK_ID;
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        ret = std::max(ret, shards_[i].end_aux_block_id);
+    }
+    return ret;
 }
 
 index_block_info_t in_memory_index_t::get_block_info(block_id_t id) {
+    const shard_t &shard = shards_[id % LBA_SHARD_FACTOR];
     if (is_aux_block_id(id)) {
-        index_aux_block_info_t aux_info
-            = aux_infos_.get(make_aux_block_id_relative(id));
-        return index_block_info_t(aux_info.offset,
-                                  repli_timestamp_t::invalid,
-                                  aux_info.ser_block_size);
+        return shard.aux_infos.get(make_aux_block_id_relative(id) / LBA_SHARD_FACTOR);
     } else {
-        return infos_.get(id);
+        return shard.infos.get(id / LBA_SHARD_FACTOR);
     }
 }
 
 void in_memory_index_t::set_block_info(block_id_t id, repli_timestamp_t recency,
                                        flagged_off64_t offset,
-                                       uint16_t ser_block_size) {
+                                       uint16_t ser_block_size,
+                                       uint16_t disk_block_size) {
+    shard_t *shard = &shards_[id % LBA_SHARD_FACTOR];
     if (is_aux_block_id(id)) {
-        if (id >= end_aux_block_id_) {
-            end_aux_block_id_ = id + 1;
+        if (id >= shard->end_aux_block_id) {
+            shard->end_aux_block_id = id + 1;
         }
         // If you're trying to set the timestamp of  an aux block to anything
         // other than `invalid`, you might be doing something wrong. It will be
         // discarded anyway.
         rassert(recency == repli_timestamp_t::invalid);
-        index_aux_block_info_t info(offset, ser_block_size);
-        aux_infos_.set(make_aux_block_id_relative(id), info);
+        index_block_info_t info(offset, repli_timestamp_t::invalid, ser_block_size,
+                                disk_block_size);
+        shard->aux_infos.set(make_aux_block_id_relative(id) / LBA_SHARD_FACTOR, info);
     } else {
-        if (id >= end_block_id_) {
-            end_block_id_ = id + 1;
+        if (id >= shard->end_block_id) {
+            shard->end_block_id = id + 1;
         }
-        index_block_info_t info(offset, recency, ser_block_size);
-        infos_.set(id, info);
+        index_block_info_t info(offset, recency, ser_block_size, disk_block_size);
+        shard->infos.set(id / LBA_SHARD_FACTOR, info);
     }
 }
 
+size_t in_memory_index_t::memory_usage() const {
+    size_t ret = 0;
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        ret += shards_[i].infos.memory_usage() + shards_[i].aux_infos.memory_usage();
+    }
+    return ret;
+}
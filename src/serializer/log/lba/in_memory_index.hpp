@@ -2,8 +2,9 @@
 #ifndef SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
 #define SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
 
+#include <vector>
+
 #include "arch/compiler.hpp"
-#include "containers/two_level_array.hpp"
 #include "config/args.hpp"
 #include "serializer/serializer.hpp"
 #include "serializer/log/lba/disk_format.hpp"
@@ -12,60 +13,93 @@ ATTR_PACKED(struct index_block_info_t {
     index_block_info_t()
         : offset(flagged_off64_t::unused()),
           recency(repli_timestamp_t::invalid),
-          ser_block_size(0) { }
+          ser_block_size(0),
+          disk_block_size(0) { }
 
     index_block_info_t(flagged_off64_t _offset,
                        repli_timestamp_t _recency,
-                       uint16_t _ser_block_size)
+                       uint16_t _ser_block_size,
+                       uint16_t _disk_block_size)
         : offset(_offset),
           recency(_recency),
-          ser_block_size(_ser_block_size) { }
+          ser_block_size(_ser_block_size),
+          disk_block_size(_disk_block_size) { }
 
-    // For two_level_array_t.
     bool operator==(const index_block_info_t &other) const {
         return offset == other.offset &&
             recency == other.recency &&
-            ser_block_size == other.ser_block_size;
+            ser_block_size == other.ser_block_size &&
+            disk_block_size == other.disk_block_size;
+    }
+
+    // The number of bytes the block takes up on disk.
+    uint16_t actual_disk_block_size() const {
+        return disk_block_size == 0 ? ser_block_size : disk_block_size;
     }
 
     flagged_off64_t offset;
     repli_timestamp_t recency;
     uint16_t ser_block_size;
+    // The size of the block on disk if it's stored compressed, 0 otherwise.
+    uint16_t disk_block_size;
 });
 
-/* This is a reduced-size block info for auxiliary blocks (currently
-blob blocks used for large values). It doesn't store a replication
-timestamp, because we don't need it for those blocks. */
-ATTR_PACKED(struct index_aux_block_info_t {
-    index_aux_block_info_t()
-        : offset(flagged_off64_t::unused()),
-          ser_block_size(0) { }
+/* A sparse array of `index_block_info_t`s that takes less memory than storing them
+as they are.  Like `two_level_array_t` it consists of fixed-size chunks, which get
+allocated when the first value in them is set and freed once all of their values are
+back to `index_block_info_t()`.
+
+Within a chunk, offsets take up 6 bytes each.  Recencies are stored only once for
+the whole chunk for as long as they are all the same (which is always the case for
+aux blocks, whose recency is `invalid`), then as 32 bit deltas from the smallest
+recency in the chunk.  A chunk only falls back to full 64 bit recencies if they are
+too far apart for that. */
+class packed_block_info_array_t {
+public:
+    packed_block_info_array_t();
+    ~packed_block_info_array_t();
 
-    index_aux_block_info_t(flagged_off64_t _offset,
-                           uint16_t _ser_block_size)
-        : offset(_offset),
-          ser_block_size(_ser_block_size) { }
+    index_block_info_t get(size_t key) const;
+    void set(size_t key, const index_block_info_t &info);
 
-    // For two_level_array_t.
-    bool operator==(const index_aux_block_info_t &other) const {
-        return offset == other.offset &&
-            ser_block_size == other.ser_block_size;
+    // The number of bytes of memory allocated by the array.
+    size_t memory_usage() const {
+        return memory_usage_ + chunks_.capacity() * sizeof(chunk_t *);
     }
 
-    flagged_off64_t offset;
-    uint16_t ser_block_size;
-});
+private:
+    struct chunk_t;
 
+    void allocate_chunk(size_t chunk_id);
+    void free_chunk(size_t chunk_id);
+    void update_memory_usage(size_t old_chunk_bytes, size_t new_chunk_bytes);
 
+    std::vector<chunk_t *> chunks_;
+    size_t memory_usage_;
+
+    DISABLE_COPYING(packed_block_info_array_t);
+};
 
+/* The index is split the same way as the LBA on disk: block `id` lives in shard
+`id % LBA_SHARD_FACTOR`.  Different shards don't share any state, so the shards can
+be filled from different threads at the same time while the LBA is being loaded. */
 class in_memory_index_t {
-    two_level_array_t<index_block_info_t> infos_;
-    block_id_t end_block_id_;
-    two_level_array_t<index_aux_block_info_t> aux_infos_;
-    block_id_t end_aux_block_id_;
+    struct shard_t {
+        shard_t() : end_block_id(0), end_aux_block_id(FIRST_AUX_BLOCK_ID) { }
+
+        // Both arrays are indexed by the block id divided by `LBA_SHARD_FACTOR`.
+        packed_block_info_array_t infos;
+        // Aux blocks (currently blob blocks used for large values) don't have a
+        // replication timestamp, and always have the recency `invalid`.
+        packed_block_info_array_t aux_infos;
+        block_id_t end_block_id;
+        block_id_t end_aux_block_id;
+    };
+
+    shard_t shards_[LBA_SHARD_FACTOR];
 
 public:
-    in_memory_index_t();
+    in_memory_index_t() { }
 
     // end_block_id is one greater than the maximum used block id.
     block_id_t end_block_id();
@@ -73,8 +107,14 @@ public:
 
     index_block_info_t get_block_info(block_id_t id);
     void set_block_info(block_id_t id, repli_timestamp_t recency,
-                        flagged_off64_t offset, uint16_t ser_block_size);
+                        flagged_off64_t offset, uint16_t ser_block_size,
+                        uint16_t disk_block_size);
+
+    // The number of bytes of memory the index uses.  Must not be called while
+    // the index is being filled from multiple threads.
+    size_t memory_usage() const;
 
+    DISABLE_COPYING(in_memory_index_t);
 };
 
 #endif  // SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
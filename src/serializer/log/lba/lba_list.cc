@@ -4,6 +4,8 @@
 #include "utils.hpp"
 #include "serializer/log/lba/disk_format.hpp"
 #include "arch/arch.hpp"
+#include "arch/io/blocker_pool.hpp"
+#include "arch/runtime/thread_pool.hpp"
 #include "perfmon/perfmon.hpp"
 #include "serializer/log/stats.hpp"
 #include "arch/runtime/coroutines.hpp"
@@ -58,6 +60,7 @@ public:
     int cbs_out;
     lba_list_t *owner;
     lba_list_t::ready_callback_t *callback;
+    scoped_ptr_t<blocker_pool_t> replay_pool;
 
     lba_start_fsm_t(lba_list_t *l, lba_metablock_mixin_t *last_metablock)
         : owner(l), callback(nullptr)
@@ -85,9 +88,22 @@ public:
         rassert(cbs_out > 0);
         cbs_out--;
         if (cbs_out == 0) {
+            // The shards are read concurrently.  For big LBAs, applying the entries to
+            // the in-memory index takes more time than reading them, so we also spread
+            // that over one thread per shard.
+            size_t num_extents = 0;
+            for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+                num_extents += owner->disk_structures[i]->num_extents();
+            }
+            if (num_extents >= LBA_MIN_EXTENTS_FOR_PARALLEL_LOAD) {
+                replay_pool.init(new blocker_pool_t(
+                    LBA_SHARD_FACTOR, &linux_thread_pool_t::get_thread()->queue));
+            }
+
             cbs_out = LBA_SHARD_FACTOR;
             for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
-                owner->disk_structures[i]->read(&owner->in_memory_index, this);
+                owner->disk_structures[i]->read(&owner->in_memory_index,
+                                                replay_pool.get_or_null(), this);
             }
         }
     }
@@ -96,6 +112,13 @@ public:
         rassert(cbs_out > 0);
         cbs_out--;
         if (cbs_out == 0) {
+            if (replay_pool.has()) {
+                // We might be getting called from the pool's completion handler, so
+                // it must not be destroyed right here.
+                blocker_pool_t *pool = replay_pool.release();
+                coro_t::spawn_sometime([pool]() { delete pool; });
+            }
+
             // All LBA entries from the LBA extents have been read.
             // Now we can load the (more recent) inlined entries from
             // the metablock into the index:
@@ -109,7 +132,8 @@ public:
                         e->block_id,
                         e->recency,
                         e->offset,
-                        static_cast<uint16_t>(e->ser_block_size));
+                        static_cast<uint16_t>(e->ser_block_size),
+                        static_cast<uint16_t>(e->disk_block_size));
             }
 
             owner->state = lba_list_t::state_ready;
@@ -124,7 +148,7 @@ bool lba_list_t::start_existing(file_t *file, lba_metablock_mixin_t *last_metabl
     rassert(state == state_unstarted);
 
     dbfile = file;
-    gc_io_account.init(new file_account_t(dbfile, LBA_GC_IO_PRIORITY));
+    gc_io_account.init(new file_account_t(dbfile, LBA_GC_IO_PRIORITY, "lba_gc"));
 
     lba_start_fsm_t *starter = new lba_start_fsm_t(this, last_metablock);
     if (state == state_ready) {
@@ -147,6 +171,10 @@ block_id_t lba_list_t::end_aux_block_id() {
     return in_memory_index.end_aux_block_id();
 }
 
+size_t lba_list_t::in_memory_index_memory_usage() const {
+    return in_memory_index.memory_usage();
+}
+
 index_block_info_t lba_list_t::get_block_info(block_id_t block) {
     rassert(state == state_ready || state == state_gc_shutting_down);
     return in_memory_index.get_block_info(block);
@@ -164,6 +192,10 @@ block_size_t lba_list_t::get_block_size(block_id_t block) {
     return block_size_t::unsafe_make(get_block_info(block).ser_block_size);
 }
 
+block_size_t lba_list_t::get_disk_block_size(block_id_t block) {
+    return block_size_t::unsafe_make(get_block_info(block).actual_disk_block_size());
+}
+
 repli_timestamp_t lba_list_t::get_block_recency(block_id_t block) {
     return get_block_info(block).recency;
 }
@@ -192,13 +224,17 @@ segmented_vector_t<repli_timestamp_t> lba_list_t::get_block_recencies(block_id_t
 
 void lba_list_t::set_block_info(block_id_t block, repli_timestamp_t recency,
                                 flagged_off64_t offset, uint32_t ser_block_size,
+                                uint32_t disk_block_size,
                                 file_account_t *io_account, extent_transaction_t *txn) {
     rassert(state == state_ready || state == state_gc_shutting_down);
 
     guarantee(ser_block_size <= std::numeric_limits<uint16_t>::max());
     uint16_t ser_block_size_16 = static_cast<uint16_t>(ser_block_size);
+    guarantee(disk_block_size < ser_block_size || disk_block_size == 0);
+    uint16_t disk_block_size_16 = static_cast<uint16_t>(disk_block_size);
 
-    in_memory_index.set_block_info(block, recency, offset, ser_block_size_16);
+    in_memory_index.set_block_info(block, recency, offset, ser_block_size_16,
+                                   disk_block_size_16);
 
     // If the inline LBA is full, free it up first by moving its entries to
     // the LBA extents
@@ -207,7 +243,7 @@ void lba_list_t::set_block_info(block_id_t block, repli_timestamp_t recency,
         rassert(!check_inline_lba_full());
     }
     // Then store the entry inline
-    add_inline_entry(block, recency, offset, ser_block_size_16);
+    add_inline_entry(block, recency, offset, ser_block_size_16, disk_block_size_16);
 }
 
 bool lba_list_t::check_inline_lba_full() const {
@@ -245,6 +281,7 @@ void lba_list_t::move_inline_entries_to_extents(file_account_t *io_account, exte
                 e.recency,
                 e.offset,
                 e.ser_block_size,
+                e.disk_block_size,
                 io_account,
                 txn);
     }
@@ -253,11 +290,12 @@ void lba_list_t::move_inline_entries_to_extents(file_account_t *io_account, exte
 }
 
 void lba_list_t::add_inline_entry(block_id_t block, repli_timestamp_t recency,
-                                flagged_off64_t offset, uint16_t ser_block_size) {
+                                  flagged_off64_t offset, uint16_t ser_block_size,
+                                  uint16_t disk_block_size) {
 
     rassert(!check_inline_lba_full());
     inline_lba_entries[inline_lba_entries_count++] =
-            lba_entry_t::make(block, recency, offset, ser_block_size);
+            lba_entry_t::make(block, recency, offset, ser_block_size, disk_block_size);
 }
 
 class lba_writer_t :
@@ -353,11 +391,12 @@ void lba_list_t::gc(int lba_shard, auto_drainer_t::lock_t) {
 
         flagged_off64_t off = get_block_offset(id);
         if (off.has_value()) {
-            uint32_t ser_block_size = get_ser_block_size(id);
+            const index_block_info_t info = get_block_info(id);
             disk_structures[lba_shard]->add_entry(id,
-                                                  get_block_recency(id),
+                                                  info.recency,
                                                   off,
-                                                  ser_block_size,
+                                                  info.ser_block_size,
+                                                  info.disk_block_size,
                                                   gc_io_account.get(),
                                                   txns.back().get());
         }
@@ -45,6 +45,9 @@ public:
     flagged_off64_t get_block_offset(block_id_t block);
     uint32_t get_ser_block_size(block_id_t block);
     block_size_t get_block_size(block_id_t block);
+    // The size the block takes up on disk, which is smaller than `get_block_size`
+    // for compressed blocks.
+    block_size_t get_disk_block_size(block_id_t block);
     repli_timestamp_t get_block_recency(block_id_t block);
     segmented_vector_t<repli_timestamp_t> get_block_recencies(block_id_t first,
                                                               block_id_t step);
@@ -54,14 +57,19 @@ public:
     block_id_t end_block_id();
     block_id_t end_aux_block_id();
 
+    /* Returns how many bytes of memory the in-memory index is using. */
+    size_t in_memory_index_memory_usage() const;
+
 #ifndef NDEBUG
     bool is_extent_referenced(int64_t offset);
     bool is_offset_referenced(int64_t offset);
     int extent_refcount(int64_t offset);
 #endif
 
+    // `disk_block_size` is 0 if the block is stored uncompressed.
     void set_block_info(block_id_t block, repli_timestamp_t recency,
                         flagged_off64_t offset, uint32_t ser_block_size,
+                        uint32_t disk_block_size,
                         file_account_t *io_account,
                         extent_transaction_t *txn);
 
@@ -117,7 +125,8 @@ private:
     void move_inline_entries_to_extents(file_account_t *io_account,
                                         extent_transaction_t *txn);
     void add_inline_entry(block_id_t block, repli_timestamp_t recency,
-                          flagged_off64_t offset, uint16_t ser_block_size);
+                          flagged_off64_t offset, uint16_t ser_block_size,
+                          uint16_t disk_block_size);
 
     lba_disk_structure_t *disk_structures[LBA_SHARD_FACTOR];
 
@@ -9,20 +9,32 @@
 #include <functional>
 
 #include "arch/io/disk.hpp"
+#include "arch/io/striped_file.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/runtime/coroutines.hpp"
+#include "arch/timing.hpp"
+#include "assignment_sentry.hpp"
 #include "buffer_cache/types.hpp"
 #include "concurrency/new_mutex.hpp"
+#include "concurrency/wait_any.hpp"
 #include "logger.hpp"
 #include "perfmon/perfmon.hpp"
 #include "serializer/buf_ptr.hpp"
 #include "serializer/log/data_block_manager.hpp"
 
 filepath_file_opener_t::filepath_file_opener_t(const serializer_filepath_t &filepath,
-                                               io_backender_t *backender)
+                                               io_backender_t *backender,
+                                               bool striped)
     : filepath_(filepath),
       backender_(backender),
-      opened_temporary_(false) { }
+      opened_temporary_(false),
+#ifdef _WIN32
+      // TODO WINDOWS: striping relies on renaming the temporary files
+      striped_(false),
+#else
+      striped_(striped && !backender->get_stripe_directories().empty()),
+#endif
+      created_striped_(false) { }
 
 filepath_file_opener_t::~filepath_file_opener_t() { }
 
@@ -43,14 +55,60 @@ std::string filepath_file_opener_t::current_file_name() const {
     return opened_temporary_ ? temporary_file_name() : file_name();
 }
 
+std::string filepath_file_opener_t::stripes_file_name(
+        const serializer_filepath_t &filepath) {
+    return filepath.permanent_path() + ".stripes";
+}
+
+static std::string path_basename(const std::string &path) {
+    const size_t separator = path.find_last_of(PATH_SEPARATOR);
+    return separator == std::string::npos ? path : path.substr(separator + 1);
+}
+
+std::string filepath_file_opener_t::stripe_file_name(size_t index) const {
+    return strprintf("%s%s%s.stripe%zu",
+                     backender_->get_stripe_directories()[index].c_str(),
+                     PATH_SEPARATOR,
+                     path_basename(filepath_.permanent_path()).c_str(),
+                     index + 1);
+}
+
+std::string filepath_file_opener_t::stripe_temporary_file_name(size_t index) const {
+    return strprintf("%s%s%s%s%s.stripe%zu.create",
+                     backender_->get_stripe_directories()[index].c_str(),
+                     PATH_SEPARATOR, TEMPORARY_DIRECTORY_NAME, PATH_SEPARATOR,
+                     path_basename(filepath_.permanent_path()).c_str(),
+                     index + 1);
+}
+
+bool filepath_file_opener_t::read_stripes_file(const serializer_filepath_t &filepath,
+                                               std::vector<std::string> *paths_out) {
+    std::string contents;
+    if (!blocking_read_file(stripes_file_name(filepath).c_str(), &contents)) {
+        return false;
+    }
+    paths_out->clear();
+    size_t begin = 0;
+    while (begin < contents.size()) {
+        size_t end = contents.find('\n', begin);
+        guarantee(end != std::string::npos,
+                  "The file %s is damaged.", stripes_file_name(filepath).c_str());
+        paths_out->push_back(contents.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return true;
+}
+
 void filepath_file_opener_t::open_serializer_file(const std::string &path,
                                                   int extra_flags,
-                                                  scoped_ptr_t<file_t> *file_out) {
+                                                  scoped_ptr_t<file_t> *file_out,
+                                                  size_t device) {
     const file_open_result_t res = open_file(
             path.c_str(),
             linux_file_t::mode_read | linux_file_t::mode_write | extra_flags,
             backender_,
-            file_out);
+            file_out,
+            device);
     if (res.outcome == file_open_result_t::ERROR) {
         crash_due_to_inaccessible_database_file(path.c_str(), res);
     }
@@ -64,13 +122,42 @@ void filepath_file_opener_t::open_serializer_file(const std::string &path,
     }
 }
 
+void filepath_file_opener_t::open_striped_serializer_file(
+        const std::vector<std::string> &paths,
+        int extra_flags,
+        scoped_ptr_t<file_t> *file_out) {
+    const std::vector<std::string> &directories = backender_->get_stripe_directories();
+    std::vector<scoped_ptr_t<file_t> > files(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        // Stripe files in directories that are no longer configured share the
+        // queue of the data directory.
+        size_t device = 0;
+        for (size_t j = 0; j < directories.size() && i > 0; ++j) {
+            if (paths[i].compare(0, directories[j].size() + 1,
+                                 directories[j] + PATH_SEPARATOR) == 0) {
+                device = j + 1;
+            }
+        }
+        open_serializer_file(paths[i], extra_flags, &files[i], device);
+    }
+    file_out->init(new striped_file_t(std::move(files), SERIALIZER_STRIPE_UNIT_SIZE));
+}
+
 void filepath_file_opener_t::open_serializer_file_create_temporary(
         scoped_ptr_t<file_t> *file_out) {
     mutex_assertion_t::acq_t acq(&reentrance_mutex_);
-    open_serializer_file(temporary_file_name(),
-                         linux_file_t::mode_create | linux_file_t::mode_truncate,
-                         file_out);
+    const int flags = linux_file_t::mode_create | linux_file_t::mode_truncate;
+    if (striped_) {
+        std::vector<std::string> paths(1, temporary_file_name());
+        for (size_t i = 0; i < backender_->get_stripe_directories().size(); ++i) {
+            paths.push_back(stripe_temporary_file_name(i));
+        }
+        open_striped_serializer_file(paths, flags, file_out);
+    } else {
+        open_serializer_file(temporary_file_name(), flags, file_out);
+    }
     opened_temporary_ = true;
+    created_striped_ = striped_;
 }
 
 void filepath_file_opener_t::move_serializer_file_to_permanent_location() {
@@ -85,6 +172,34 @@ void filepath_file_opener_t::move_serializer_file_to_permanent_location() {
     // TODO WINDOWS: temporary files are not used because, by default,
     // files cannot be renamed while still open
 #else
+    if (created_striped_) {
+        // The stripe files and the list of them have to be in place before the main
+        // file is, because we only look for them once that exists.
+        std::string stripes;
+        for (size_t i = 0; i < backender_->get_stripe_directories().size(); ++i) {
+            const std::string temporary = stripe_temporary_file_name(i);
+            const std::string permanent = stripe_file_name(i);
+            if (::rename(temporary.c_str(), permanent.c_str()) != 0) {
+                crash("Could not rename database file %s to permanent location %s "
+                      "(%s)\n",
+                      temporary.c_str(), permanent.c_str(), errno_string(errno).c_str());
+            }
+            warn_fsync_parent_directory(permanent.c_str());
+            stripes += permanent + "\n";
+        }
+
+        const std::string stripes_path = stripes_file_name(filepath_);
+        scoped_fd_t fd(::open(stripes_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+        bool ok = fd.get() != INVALID_FD;
+        ok = ok && ::write(fd.get(), stripes.data(), stripes.size())
+            == static_cast<ssize_t>(stripes.size());
+        ok = ok && ::fsync(fd.get()) == 0;
+        if (!ok) {
+            crash("Could not write the list of stripe files %s (%s)\n",
+                  stripes_path.c_str(), errno_string(errno).c_str());
+        }
+    }
+
     const int res = ::rename(temporary_file_name().c_str(), file_name().c_str());
 
     if (res != 0) {
@@ -101,7 +216,20 @@ void filepath_file_opener_t::move_serializer_file_to_permanent_location() {
 
 void filepath_file_opener_t::open_serializer_file_existing(scoped_ptr_t<file_t> *file_out) {
     mutex_assertion_t::acq_t acq(&reentrance_mutex_);
-    open_serializer_file(current_file_name(), 0, file_out);
+    std::vector<std::string> paths;
+    if (opened_temporary_ && created_striped_) {
+        paths.push_back(temporary_file_name());
+        for (size_t i = 0; i < backender_->get_stripe_directories().size(); ++i) {
+            paths.push_back(stripe_temporary_file_name(i));
+        }
+    } else if (!opened_temporary_ && read_stripes_file(filepath_, &paths)) {
+        paths.insert(paths.begin(), file_name());
+    }
+    if (paths.empty()) {
+        open_serializer_file(current_file_name(), 0, file_out);
+    } else {
+        open_striped_serializer_file(paths, 0, file_out);
+    }
 }
 
 void filepath_file_opener_t::unlink_serializer_file() {
@@ -112,6 +240,25 @@ void filepath_file_opener_t::unlink_serializer_file() {
     guarantee(opened_temporary_);
     const int res = ::unlink(current_file_name().c_str());
     guarantee_err(res == 0, "unlink() failed");
+    if (created_striped_) {
+        for (size_t i = 0; i < backender_->get_stripe_directories().size(); ++i) {
+            const int stripe_res = ::unlink(stripe_temporary_file_name(i).c_str());
+            guarantee_err(stripe_res == 0, "unlink() failed");
+        }
+    }
+}
+
+void filepath_file_opener_t::unlink_stripe_files(const serializer_filepath_t &filepath) {
+    std::vector<std::string> paths;
+    if (!read_stripes_file(filepath, &paths)) {
+        return;
+    }
+    for (const std::string &path : paths) {
+        const int res = ::unlink(path.c_str());
+        guarantee_err(res == 0 || get_errno() == ENOENT,
+                      "unlink failed for file %s", path.c_str());
+    }
+    ::unlink(stripes_file_name(filepath).c_str());
 }
 
 
@@ -123,6 +270,8 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_block_writes(),
       pm_serializer_index_writes(secs_to_ticks(1)),
       pm_serializer_index_writes_size(secs_to_ticks(1), false),
+      pm_serializer_metablock_commits(secs_to_ticks(1)),
+      pm_serializer_group_commit_size(secs_to_ticks(1), false),
       pm_serializer_read_bytes_per_sec(secs_to_ticks(1)),
       pm_serializer_read_bytes_total(),
       pm_serializer_written_bytes_per_sec(secs_to_ticks(1)),
@@ -135,7 +284,14 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_data_extents_gced(),
       pm_serializer_old_garbage_block_bytes(),
       pm_serializer_old_total_block_bytes(),
+      pm_serializer_fresh_written_block_bytes(),
+      pm_serializer_gc_written_block_bytes(),
+      pm_serializer_compressed_block_writes(),
+      pm_serializer_compression_saved_bytes(),
       pm_serializer_lba_gcs(),
+      pm_serializer_lba_index_bytes(),
+      pm_serializer_io_queue_latency(16, "other"),
+      pm_serializer_io_service_latency(16, "other"),
       parent_collection_membership(parent, &serializer_collection, "serializer"),
       stats_membership(&serializer_collection,
           &pm_serializer_block_reads, "serializer_block_reads",
@@ -143,6 +299,8 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_block_writes, "serializer_block_writes",
           &pm_serializer_index_writes, "serializer_index_writes",
           &pm_serializer_index_writes_size, "serializer_index_writes_size",
+          &pm_serializer_metablock_commits, "serializer_metablock_commits",
+          &pm_serializer_group_commit_size, "serializer_group_commit_size",
           &pm_serializer_read_bytes_per_sec, "serializer_read_bytes_per_sec",
           &pm_serializer_read_bytes_total, "serializer_read_bytes_total",
           &pm_serializer_written_bytes_per_sec, "serializer_written_bytes_per_sec",
@@ -155,7 +313,17 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_data_extents_gced, "serializer_data_extents_gced",
           &pm_serializer_old_garbage_block_bytes, "serializer_old_garbage_block_bytes",
           &pm_serializer_old_total_block_bytes, "serializer_old_total_block_bytes",
-          &pm_serializer_lba_gcs, "serializer_lba_gcs")
+          &pm_serializer_fresh_written_block_bytes,
+              "serializer_fresh_written_block_bytes",
+          &pm_serializer_gc_written_block_bytes, "serializer_gc_written_block_bytes",
+          &pm_serializer_compressed_block_writes,
+              "serializer_compressed_block_writes",
+          &pm_serializer_compression_saved_bytes,
+              "serializer_compression_saved_bytes",
+          &pm_serializer_lba_gcs, "serializer_lba_gcs",
+          &pm_serializer_lba_index_bytes, "serializer_lba_index_bytes",
+          &pm_serializer_io_queue_latency, "serializer_io_queue_latency",
+          &pm_serializer_io_service_latency, "serializer_io_service_latency")
 { }
 
 void log_serializer_stats_t::bytes_read(size_t count) {
@@ -216,8 +384,10 @@ struct ls_start_existing_fsm_t :
         scoped_ptr_t<file_t> dbfile;
         file_opener->open_serializer_file_existing(&dbfile);
         ser->dbfile = dbfile.release();
+        ser->dbfile->set_io_latency_stats(&ser->stats->pm_serializer_io_queue_latency,
+                                          &ser->stats->pm_serializer_io_service_latency);
         ser->index_writes_io_account.init(
-            new file_account_t(ser->dbfile, INDEX_WRITE_IO_PRIORITY));
+            new file_account_t(ser->dbfile, INDEX_WRITE_IO_PRIORITY, "index_writes"));
 
         start_existing_state = state_read_static_header;
         // STATE A above implies STATE B here
@@ -318,7 +488,7 @@ struct ls_start_existing_fsm_t :
                     ser->lba_index->get_block_offset(next_block_to_reconstruct);
                 if (offset.has_value()) {
                     ser->data_block_manager->mark_live(offset.get_value(),
-                        ser->lba_index->get_block_size(next_block_to_reconstruct));
+                        ser->lba_index->get_disk_block_size(next_block_to_reconstruct));
                 }
 
                 ++next_block_to_reconstruct;
@@ -341,6 +511,7 @@ struct ls_start_existing_fsm_t :
             start_existing_state = state_done;
             rassert(ser->state == log_serializer_t::state_starting_up);
             ser->state = log_serializer_t::state_ready;
+            ser->update_lba_index_stats();
 
             if (to_signal_when_done) to_signal_when_done->pulse();
 
@@ -426,7 +597,9 @@ log_serializer_t::log_serializer_t(dynamic_config_t _dynamic_config,
       metablock_manager(nullptr),
       lba_index(nullptr),
       data_block_manager(nullptr),
-      active_write_count(0) {
+      group_commit_wakeup(nullptr),
+      active_write_count(0),
+      published_lba_index_bytes(0) {
     // STATE A
     /* This is because the serializer is not completely converted to coroutines yet. */
     ls_start_existing_fsm_t *s = new ls_start_existing_fsm_t(this);
@@ -446,11 +619,11 @@ log_serializer_t::~log_serializer_t() {
     rassert(active_write_count == 0);
 }
 
-file_account_t *log_serializer_t::make_io_account(int priority,
+file_account_t *log_serializer_t::make_io_account(int priority, const char *io_class,
                                                   int outstanding_requests_limit) {
     assert_thread();
     rassert(dbfile);
-    return new file_account_t(dbfile, priority, outstanding_requests_limit);
+    return new file_account_t(dbfile, priority, io_class, outstanding_requests_limit);
 }
 
 buf_ptr_t log_serializer_t::block_read(const counted_t<block_token_t> &token,
@@ -463,7 +636,7 @@ buf_ptr_t log_serializer_t::block_read(const counted_t<block_token_t> &token,
     stats->pm_serializer_block_reads.begin(&pm_time);
 
     buf_ptr_t ret = data_block_manager->read(token->offset_, token->block_size(),
-                                             io_account);
+                                             token->disk_block_size(), io_account);
 
     stats->pm_serializer_block_reads.end(&pm_time);
     return ret;
@@ -480,6 +653,7 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
 
     extent_transaction_t txn;
     index_write_prepare(&txn);
+    int64_t written_bytes = 0;
 
     {
         // The in-memory index updates, at least due to the needs of
@@ -493,6 +667,15 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
             const index_write_op_t &op = *write_op_it;
             flagged_off64_t offset = lba_index->get_block_offset(op.block_id);
             uint32_t ser_block_size = lba_index->get_ser_block_size(op.block_id);
+            // 0 means that the block is stored uncompressed.
+            uint32_t disk_block_size = 0;
+            if (ser_block_size != 0) {
+                const block_size_t old_disk_size
+                    = lba_index->get_disk_block_size(op.block_id);
+                if (old_disk_size.ser_value() != ser_block_size) {
+                    disk_block_size = old_disk_size.ser_value();
+                }
+            }
 
             if (op.token) {
                 // Update the offset pointed to, and mark garbage/liveness as necessary.
@@ -507,13 +690,17 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
                 if (token.has()) {
                     offset = flagged_off64_t::make(token->offset_);
                     ser_block_size = token->block_size().ser_value();
+                    disk_block_size = token->is_compressed()
+                        ? token->disk_block_size().ser_value() : 0;
 
                     /* mark the life */
                     data_block_manager->mark_live(offset.get_value(),
-                                                  token->block_size());
+                                                  token->disk_block_size());
+                    written_bytes += token->disk_block_size().ser_value();
                 } else {
                     offset = flagged_off64_t::unused();
                     ser_block_size = 0;
+                    disk_block_size = 0;
                 }
             }
 
@@ -521,7 +708,7 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
                 : lba_index->get_block_recency(op.block_id);
 
             lba_index->set_block_info(op.block_id, recency,
-                                      offset, ser_block_size,
+                                      offset, ser_block_size, disk_block_size,
                                       index_writes_io_account.get(), &txn);
         }
     }
@@ -542,7 +729,8 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
         }
     }
 
-    index_write_finish(mutex_acq, &txn, index_writes_io_account.get());
+    index_write_finish(mutex_acq, &txn, written_bytes, index_writes_io_account.get());
+    update_lba_index_stats();
 
     stats->pm_serializer_index_writes.end(&pm_time);
 }
@@ -560,6 +748,7 @@ void log_serializer_t::index_write_prepare(extent_transaction_t *txn) {
 
 void log_serializer_t::index_write_finish(new_mutex_in_line_t *mutex_acq,
                                           extent_transaction_t *txn,
+                                          int64_t written_bytes,
                                           file_account_t *io_account) {
     /* Write the LBA */
     struct : public cond_t, public lba_list_t::completion_callback_t {
@@ -572,7 +761,7 @@ void log_serializer_t::index_write_finish(new_mutex_in_line_t *mutex_acq,
     extent_manager->end_transaction(txn);
 
     /* Write the metablock */
-    write_metablock(mutex_acq, &on_lba_written, io_account);
+    write_metablock(mutex_acq, &on_lba_written, written_bytes, io_account);
 
     active_write_count--;
 
@@ -597,10 +786,29 @@ void log_serializer_t::index_write_finish(new_mutex_in_line_t *mutex_acq,
     }
 }
 
+struct log_serializer_t::metablock_waiter_t {
+    metablock_waiter_t(const scoped_device_block_aligned_ptr_t<crc_metablock_t> *_crc_mb,
+                       int64_t _written_bytes)
+        : crc_mb(_crc_mb), written_bytes(_written_bytes), safe_to_write(false) { }
+
+    const scoped_device_block_aligned_ptr_t<crc_metablock_t> *const crc_mb;
+    const int64_t written_bytes;
+    // Set once the waiter's `safe_to_write_cond` has been pulsed.
+    bool safe_to_write;
+    // Pulsed when the waiter gets to the front of the queue without being committed.
+    cond_t turn;
+    // Pulsed when a metablock that is at least as new as this one is on disk.
+    cond_t committed;
+};
+
 void log_serializer_t::write_metablock(new_mutex_in_line_t *mutex_acq,
                                        const signal_t *safe_to_write_cond,
+                                       int64_t written_bytes,
                                        file_account_t *io_account) {
     assert_thread();
+    ticks_t pm_time;
+    stats->pm_serializer_metablock_commits.begin(&pm_time);
+
     scoped_device_block_aligned_ptr_t<crc_metablock_t> crc_mb(METABLOCK_SIZE);
     memset(crc_mb.get(), 0, METABLOCK_SIZE);
 
@@ -610,48 +818,120 @@ void log_serializer_t::write_metablock(new_mutex_in_line_t *mutex_acq,
     prepare_metablock(&crc_mb->metablock);
 
     /* Get in line for the metablock manager */
-    bool waiting_for_prev_write = !metablock_waiter_queue.empty();
-    cond_t on_prev_write_submitted_metablock;
-    metablock_waiter_queue.push_back(&on_prev_write_submitted_metablock);
+    metablock_waiter_t waiter(&crc_mb, written_bytes);
+    metablock_waiter_queue.push_back(&waiter);
 
     // This operation is in line with the metablock manager.  Now another index write
     // may commence.
     mutex_acq->reset();
 
     safe_to_write_cond->wait();
-    if (waiting_for_prev_write) {
-        on_prev_write_submitted_metablock.wait();
+    waiter.safe_to_write = true;
+    if (group_commit_wakeup != nullptr) {
+        group_commit_wakeup->pulse_if_not_already_pulsed();
+    }
+
+    if (metablock_waiter_queue.front() != &waiter) {
+        /* Either an older waiter commits our metablock (or a newer one) as part of its
+        group, or it leaves us at the front of the queue. */
+        wait_any_t turn_or_committed(&waiter.turn, &waiter.committed);
+        turn_or_committed.wait();
+    }
+
+    if (!waiter.committed.is_pulsed()) {
+        guarantee(metablock_waiter_queue.front() == &waiter);
+        commit_metablock_group(io_account);
+    }
+    rassert(waiter.committed.is_pulsed());
+
+    stats->pm_serializer_metablock_commits.end(&pm_time);
+}
+
+void log_serializer_t::commit_metablock_group(file_account_t *io_account) {
+    assert_thread();
+    if (dynamic_config.group_commit_window_ms > 0 && group_commit_should_wait()) {
+        signal_timer_t window(dynamic_config.group_commit_window_ms);
+        while (!window.is_pulsed() && group_commit_should_wait()) {
+            cond_t wakeup;
+            assignment_sentry_t<cond_t *> wakeup_sentry(&group_commit_wakeup, &wakeup);
+            wait_any_t wakeup_or_timeout(&wakeup, &window);
+            wakeup_or_timeout.wait();
+        }
     }
-    guarantee(metablock_waiter_queue.front() == &on_prev_write_submitted_metablock);
+
+    /* The group is the longest run of waiters at the front of the queue that are safe
+    to write.  Their metablocks are snapshots of the serializer state in queue order,
+    so writing the newest one commits all of them. */
+    size_t group_size = 0;
+    int64_t group_bytes = 0;
+    metablock_waiter_t *newest = nullptr;
+    for (auto it = metablock_waiter_queue.begin();
+         it != metablock_waiter_queue.end();
+         ++it) {
+        if (!(*it)->safe_to_write
+            || (group_size > 0
+                && group_bytes + (*it)->written_bytes
+                   > dynamic_config.group_commit_max_bytes)) {
+            break;
+        }
+        ++group_size;
+        group_bytes += (*it)->written_bytes;
+        newest = *it;
+    }
+    guarantee(newest != nullptr);
 
     struct : public cond_t, public metablock_manager_t::metablock_write_callback_t {
         void on_metablock_write() { pulse(); }
     } on_metablock_write;
-    metablock_manager->write_metablock(crc_mb, io_account, &on_metablock_write);
+    metablock_manager->write_metablock(*newest->crc_mb, io_account, &on_metablock_write);
+    on_metablock_write.wait();
 
-    /* Remove ourselves from the list of metablock waiters. */
-    metablock_waiter_queue.pop_front();
+    stats->pm_serializer_group_commit_size.record(group_size);
 
-    /* If there was another transaction waiting for us to write our metablock so it
-    could write its metablock, notify it now so it can write its metablock. */
+    /* Remove the group from the queue, then notify its members and the waiter that
+    leads the next group. */
+    for (size_t i = 0; i < group_size; ++i) {
+        metablock_waiter_t *member = metablock_waiter_queue.front();
+        metablock_waiter_queue.pop_front();
+        member->committed.pulse();
+    }
     if (!metablock_waiter_queue.empty()) {
-        metablock_waiter_queue.front()->pulse();
+        metablock_waiter_queue.front()->turn.pulse();
     }
+}
 
-    on_metablock_write.wait();
+bool log_serializer_t::group_commit_should_wait() const {
+    size_t ready = 0;
+    int64_t ready_bytes = 0;
+    for (auto it = metablock_waiter_queue.begin();
+         it != metablock_waiter_queue.end() && (*it)->safe_to_write;
+         ++it) {
+        ++ready;
+        ready_bytes += (*it)->written_bytes;
+    }
+    if (ready_bytes >= dynamic_config.group_commit_max_bytes) {
+        return false;
+    }
+    /* Only wait if some other index write could still join the group, i.e. there is a
+    waiter that isn't safe to write yet, or an index write that hasn't gotten in line
+    yet.  A lone write never gets delayed. */
+    return ready < metablock_waiter_queue.size()
+        || static_cast<size_t>(active_write_count) > metablock_waiter_queue.size();
 }
 
 void log_serializer_t::write_metablock_sans_pipelining(
         const signal_t *safe_to_write_cond, file_account_t *io_account) {
     new_mutex_in_line_t dummy_acq;
-    write_metablock(&dummy_acq, safe_to_write_cond, io_account);
+    write_metablock(&dummy_acq, safe_to_write_cond, 0, io_account);
 
 }
 
 counted_t<block_token_t>
-log_serializer_t::generate_block_token(int64_t offset, block_size_t block_size) {
+log_serializer_t::generate_block_token(int64_t offset, block_size_t block_size,
+                                       block_size_t disk_block_size) {
     assert_thread();
-    counted_t<block_token_t> token(new block_token_t(this, offset, block_size));
+    counted_t<block_token_t> token(new block_token_t(this, offset, block_size,
+                                                     disk_block_size));
 
     auto location = offset_tokens.find(offset);
     if (location == offset_tokens.end()) {
@@ -763,6 +1043,12 @@ bool log_serializer_t::is_gc_active() const {
     return data_block_manager->is_gc_active() || lba_index->is_any_gc_active();
 }
 
+void log_serializer_t::set_mmap_reads(bool enabled) {
+    assert_thread();
+    rassert(state == state_ready);
+    data_block_manager->set_mmap_reads(enabled);
+}
+
 block_id_t log_serializer_t::end_block_id() {
     assert_thread();
     rassert(state == state_ready);
@@ -790,8 +1076,10 @@ counted_t<block_token_t> log_serializer_t::index_read(block_id_t block_id) {
 
     index_block_info_t info = lba_index->get_block_info(block_id);
     if (info.offset.has_value()) {
-        return generate_block_token(info.offset.get_value(),
-                                    block_size_t::unsafe_make(info.ser_block_size));
+        return generate_block_token(
+            info.offset.get_value(),
+            block_size_t::unsafe_make(info.ser_block_size),
+            block_size_t::unsafe_make(info.actual_disk_block_size()));
     } else {
         return counted_t<block_token_t>();
     }
@@ -950,6 +1238,13 @@ void log_serializer_t::consider_start_gc() {
     }
 }
 
+void log_serializer_t::update_lba_index_stats() {
+    assert_thread();
+    const size_t bytes = lba_index->in_memory_index_memory_usage();
+    stats->pm_serializer_lba_index_bytes += static_cast<int64_t>(bytes)
+        - static_cast<int64_t>(published_lba_index_bytes);
+    published_lba_index_bytes = bytes;
+}
 
 void log_serializer_t::register_read_ahead_cb(serializer_read_ahead_callback_t *cb) {
     assert_thread();
@@ -986,9 +1281,11 @@ bool log_serializer_t::should_perform_read_ahead() {
 
 block_token_t::block_token_t(log_serializer_t *serializer,
                              int64_t initial_offset,
-                             block_size_t initial_block_size)
+                             block_size_t initial_block_size,
+                             block_size_t initial_disk_block_size)
     : serializer_(serializer), ref_count_(0),
-      block_size_(initial_block_size), offset_(initial_offset) {
+      block_size_(initial_block_size), disk_block_size_(initial_disk_block_size),
+      offset_(initial_offset) {
     serializer_->assert_thread();
 }
 
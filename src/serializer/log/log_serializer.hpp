@@ -43,11 +43,18 @@ struct shutdown_callback_t {
  * respect that it deserves.
  */
 
-// Used to open a file (with the given filepath) for the log serializer.
+/* Used to open a file (with the given filepath) for the log serializer.
+
+If `striped` is true and the `io_backender_t` has stripe directories, new files are
+striped (see `striped_file_t`) across the file at `filepath` and one file in each of
+the stripe directories.  The paths of the stripe files are then saved in a file
+next to the main one (see `stripes_file_name()`), and the file is opened striped
+whenever that exists, even if the stripe directories have changed since. */
 class filepath_file_opener_t : public serializer_file_opener_t {
 public:
     filepath_file_opener_t(const serializer_filepath_t &filepath,
-                           io_backender_t *backender);
+                           io_backender_t *backender,
+                           bool striped = false);
     ~filepath_file_opener_t();
 
     // The path of the final position of the file.
@@ -58,8 +65,28 @@ public:
     void open_serializer_file_existing(scoped_ptr_t<file_t> *file_out);
     void unlink_serializer_file();
 
+    // Removes the stripe files of the file at `filepath`, if it has any.  Leaves the
+    // main file alone.  Blocks.
+    static void unlink_stripe_files(const serializer_filepath_t &filepath);
+
 private:
-    void open_serializer_file(const std::string &path, int extra_flags, scoped_ptr_t<file_t> *file_out);
+    void open_serializer_file(const std::string &path, int extra_flags,
+                              scoped_ptr_t<file_t> *file_out, size_t device = 0);
+
+    // Opens `paths[0]` (the main file) and the stripe files, and combines them
+    // into `file_out`.
+    void open_striped_serializer_file(const std::vector<std::string> &paths,
+                                      int extra_flags,
+                                      scoped_ptr_t<file_t> *file_out);
+
+    // The file listing the stripe files of the file at `filepath`
+    static std::string stripes_file_name(const serializer_filepath_t &filepath);
+    static bool read_stripes_file(const serializer_filepath_t &filepath,
+                                  std::vector<std::string> *paths_out);
+
+    // Where the stripe file in the `index`th stripe directory goes.
+    std::string stripe_file_name(size_t index) const;
+    std::string stripe_temporary_file_name(size_t index) const;
 
     // The path of the temporary file.  This is file_name() with some suffix appended.
     std::string temporary_file_name() const;
@@ -85,6 +112,12 @@ private:
     // use the temporary or permanent path.
     bool opened_temporary_;
 
+    // Whether new files get striped
+    const bool striped_;
+
+    // Whether the temporary file we created is striped
+    bool created_striped_;
+
     DISABLE_COPYING(filepath_file_opener_t);
 };
 
@@ -122,7 +155,8 @@ public:
     virtual ~log_serializer_t();
 
     using serializer_t::make_io_account;
-    file_account_t *make_io_account(int priority, int outstanding_requests_limit);
+    file_account_t *make_io_account(int priority, const char *io_class,
+                                    int outstanding_requests_limit);
 
     void register_read_ahead_cb(serializer_read_ahead_callback_t *cb);
     void unregister_read_ahead_cb(serializer_read_ahead_callback_t *cb);
@@ -152,11 +186,15 @@ public:
 
     virtual bool is_gc_active() const;
 
+    /* See `data_block_manager_t::set_mmap_reads()`. */
+    void set_mmap_reads(bool enabled);
+
 private:
     void unregister_block_token(block_token_t *token);
     void remap_block_to_new_offset(int64_t current_offset, int64_t new_offset);
     counted_t<block_token_t> generate_block_token(int64_t offset,
-                                                             block_size_t block_size);
+                                                  block_size_t block_size,
+                                                  block_size_t disk_block_size);
 
     void offer_buf_to_read_ahead_callbacks(
             block_id_t block_id,
@@ -167,9 +205,11 @@ private:
     /* Starts a new transaction, updates perfmons etc. */
     void index_write_prepare(extent_transaction_t *txn);
     /* Finishes a write transaction.  Resets `*mutex_acq` once it's okay to send
-       another index_write. */
+       another index_write.  `written_bytes` is the size of the blocks that the
+       transaction put into the index; it is used for sizing group commits. */
     void index_write_finish(new_mutex_in_line_t *mutex_acq,
                             extent_transaction_t *txn,
+                            int64_t written_bytes,
                             file_account_t *io_account);
 
     /* This mess is because the serializer is still mostly FSM-based */
@@ -186,11 +226,29 @@ private:
     complete.  This function writes the metablock in the state that it has when
     called, i.e.  it does not block between calling and preparing the new metablock.
     Use mutex_acq with a mutex you control if you want to extra-safely pipeline
-    operations from your caller. */
+    operations from your caller.
+
+    Concurrent calls are group-committed: once the previous metablock write has
+    completed, the oldest waiting call writes the metablock of the newest call whose
+    `safe_to_write_cond` has been pulsed, and all the calls in between return once
+    that write is complete.  `written_bytes` counts towards the group's
+    `group_commit_max_bytes`. */
     void write_metablock(new_mutex_in_line_t *mutex_acq,
                          const signal_t *safe_to_write_cond,
+                         int64_t written_bytes,
                          file_account_t *io_account);
 
+    struct metablock_waiter_t;
+
+    /* Called by the call to `write_metablock` at the front of
+    `metablock_waiter_queue`.  Collects a group of waiters, writes the newest
+    metablock in the group and removes the group from the queue. */
+    void commit_metablock_group(file_account_t *io_account);
+
+    /* Whether the group commit leader should keep waiting for more index writes to
+    join its group. */
+    bool group_commit_should_wait() const;
+
     // Used by the LBA gc operations to write metablocks -- it doesn't care to
     // pipeline operations and so we don't expose that facility.
     void write_metablock_sans_pipelining(const signal_t *safe_to_write_cond,
@@ -201,6 +259,9 @@ private:
 
     void consider_start_gc();
 
+    // Brings `pm_serializer_lba_index_bytes` up to date with the in-memory LBA.
+    void update_lba_index_stats();
+
     // We maintain offset_tokens so that we can remap block tokens' offsets while doing
     // a GC.  It's a multimap (we create duplicate tokens for an offset) because on-disk
     // GC (which remaps offsets) will move block tokens from an "old" offset to a "new"
@@ -257,10 +318,17 @@ private:
     /* The running index writes organize themselves into a list so that they can be sure
     to write their metablocks in the correct order. The first element in the list is the
     oldest transaction that started but did not finish. */
-    std::list<cond_t *> metablock_waiter_queue;
+    std::list<metablock_waiter_t *> metablock_waiter_queue;
+
+    // Pulsed by `write_metablock` when a waiter becomes ready to be committed, while
+    // the group commit leader is waiting for its group to fill up.
+    cond_t *group_commit_wakeup;
 
     int active_write_count;
 
+    // The in-memory LBA size that we last added to `pm_serializer_lba_index_bytes`.
+    size_t published_lba_index_bytes;
+
     DISABLE_COPYING(log_serializer_t);
 };
 
@@ -16,6 +16,10 @@ struct log_serializer_stats_t {
     perfmon_counter_t pm_serializer_block_writes;
     perfmon_duration_sampler_t pm_serializer_index_writes;
     perfmon_sampler_t pm_serializer_index_writes_size;
+    // How long index writes wait for their metablock to be committed, and how many
+    // index writes share each metablock write.
+    perfmon_duration_sampler_t pm_serializer_metablock_commits;
+    perfmon_sampler_t pm_serializer_group_commit_size;
 
     perfmon_rate_monitor_t pm_serializer_read_bytes_per_sec;
     perfmon_counter_t pm_serializer_read_bytes_total;
@@ -35,10 +39,22 @@ struct log_serializer_stats_t {
     perfmon_counter_t pm_serializer_data_extents_gced;
     perfmon_counter_t pm_serializer_old_garbage_block_bytes;
     perfmon_counter_t pm_serializer_old_total_block_bytes;
+    perfmon_counter_t pm_serializer_fresh_written_block_bytes;
+    perfmon_counter_t pm_serializer_gc_written_block_bytes;
+    perfmon_counter_t pm_serializer_compressed_block_writes;
+    perfmon_counter_t pm_serializer_compression_saved_bytes;
 
     /* used in serializer/log/lba/lba_list.cc */
     perfmon_counter_t pm_serializer_lba_gcs;
 
+    /* used in serializer/log/log_serializer.cc */
+    perfmon_counter_t pm_serializer_lba_index_bytes;
+
+    /* used in arch/io/disk.cc, through the accounts on the serializer file. The
+    latencies are broken down by the accounts' I/O class. */
+    perfmon_keyed_latency_t pm_serializer_io_queue_latency;
+    perfmon_keyed_latency_t pm_serializer_io_service_latency;
+
     perfmon_membership_t parent_collection_membership;
     perfmon_multi_membership_t stats_membership;
 };
@@ -14,7 +14,8 @@
 merger_serializer_t::merger_serializer_t(scoped_ptr_t<serializer_t> _inner,
                                          int _max_active_writes) :
     inner(std::move(_inner)),
-    block_writes_io_account(make_io_account(MERGER_BLOCK_WRITE_IO_PRIORITY)),
+    block_writes_io_account(make_io_account(MERGER_BLOCK_WRITE_IO_PRIORITY,
+                                            "block_writes")),
     write_committer(std::bind(&merger_serializer_t::do_index_write, this),
                     _max_active_writes) { }
 
@@ -47,9 +47,9 @@ public:
     virtual ~serializer_t() { }
 
     /* Allocates a new io account for the underlying file.
-    Use delete to free it. */
-    file_account_t *make_io_account(int priority);
-    virtual file_account_t *make_io_account(int priority,
+    Use delete to free it. `io_class` is as for `file_account_t`. */
+    file_account_t *make_io_account(int priority, const char *io_class);
+    virtual file_account_t *make_io_account(int priority, const char *io_class,
                                             int outstanding_requests_limit) = 0;
 
     /* Some serializer implementations support read-ahead to speed up cache warmup.
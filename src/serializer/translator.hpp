@@ -119,7 +119,8 @@ public:
                             config_block_id_t cfgid);
 
     /* Allocates a new io account for the underlying file */
-    file_account_t *make_io_account(int priority, int outstanding_requests_limit);
+    file_account_t *make_io_account(int priority, const char *io_class,
+                                    int outstanding_requests_limit);
 
     void index_write(new_mutex_in_line_t *mutex_acq,
                      const std::function<void()> &on_writes_reflected,
@@ -134,6 +134,10 @@ class block_token_t {
 public:
     int64_t offset() const { return offset_; }
     block_size_t block_size() const { return block_size_; }
+    // The number of bytes the block takes up on disk.  This is smaller than
+    // `block_size()` if the serializer stored the block compressed.
+    block_size_t disk_block_size() const { return disk_block_size_; }
+    bool is_compressed() const { return disk_block_size_ != block_size_; }
 
 private:
     friend class log_serializer_t;
@@ -144,7 +148,8 @@ private:
 
     block_token_t(log_serializer_t *serializer,
                   int64_t initial_offset,
-                  block_size_t initial_ser_block_size);
+                  block_size_t initial_ser_block_size,
+                  block_size_t initial_disk_block_size);
 
     log_serializer_t *const serializer_;
     std::atomic<intptr_t> ref_count_;
@@ -152,6 +157,9 @@ private:
     // The block's size.
     block_size_t block_size_;
 
+    // The block's size on disk (see `disk_block_size()`).
+    block_size_t disk_block_size_;
+
     // The block's offset on disk.
     int64_t offset_;
 
@@ -206,9 +214,18 @@ public:
 struct buf_write_info_t {
     buf_write_info_t(ser_buffer_t *_buf, block_size_t _block_size,
                      block_id_t _block_id)
-        : buf(_buf), block_size(_block_size), block_id(_block_id) { }
+        : buf(_buf), block_size(_block_size), disk_block_size(_block_size),
+          block_id(_block_id) { }
+    // For writing a block that `buf` already holds in its on-disk (possibly
+    // compressed) form, as the serializer's garbage collector does.
+    buf_write_info_t(ser_buffer_t *_buf, block_size_t _block_size,
+                     block_size_t _disk_block_size, block_id_t _block_id)
+        : buf(_buf), block_size(_block_size), disk_block_size(_disk_block_size),
+          block_id(_block_id) { }
     ser_buffer_t *buf;
     block_size_t block_size;
+    // Equal to `block_size` unless `buf` holds a compressed block.
+    block_size_t disk_block_size;
     block_id_t block_id;
 };
 
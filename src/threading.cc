@@ -66,16 +66,37 @@ thread_allocator_t::~thread_allocator_t() {
 thread_allocation_t::thread_allocation_t(thread_allocator_t *p)
     : thread(0), /* temporary, will be overwritten below */
       parent(p) {
+    allocate(-1);
+}
+
+thread_allocation_t::thread_allocation_t(thread_allocator_t *p,
+                                         threadnum_t same_numa_node_as)
+    : thread(0), /* temporary, will be overwritten below */
+      parent(p) {
+    allocate(get_thread_numa_node(same_numa_node_as));
+}
+
+void thread_allocation_t::allocate(int numa_node) {
     parent->assert_thread();
-    int32_t best_thread = 0;
-    for (int32_t i = 1; static_cast<size_t>(i) < parent->num_allocated.size(); ++i) {
-        if (parent->num_allocated[i] < parent->num_allocated[best_thread]) {
+    int32_t best_thread = -1;
+    for (int32_t i = 0; static_cast<size_t>(i) < parent->num_allocated.size(); ++i) {
+        if (numa_node != -1 && get_thread_numa_node(threadnum_t(i)) != numa_node) {
+            continue;
+        }
+        if (best_thread == -1
+            || parent->num_allocated[i] < parent->num_allocated[best_thread]) {
             best_thread = i;
         } else if (parent->num_allocated[i] == parent->num_allocated[best_thread] &&
                    parent->secondary_lt(threadnum_t(i), threadnum_t(best_thread))) {
             best_thread = i;
         }
     }
+    if (best_thread == -1) {
+        // There are no db threads on that node.
+        rassert(numa_node != -1);
+        allocate(-1);
+        return;
+    }
     thread = threadnum_t(best_thread);
     ++parent->num_allocated[best_thread];
 }
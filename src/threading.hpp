@@ -95,7 +95,9 @@ public:
 int get_num_db_threads();
 
 /* Tries to distribute allocations evenly across the db threads.
-Uses secondary_lt as a tie breaker. */
+Uses secondary_lt as a tie breaker.  An allocation can ask to be placed on the same
+NUMA node as another thread, in which case it only considers the threads on that node
+(if the threads are pinned to nodes at all). */
 class thread_allocator_t : public home_thread_mixin_t {
 public:
     explicit thread_allocator_t(
@@ -111,9 +113,13 @@ private:
 class thread_allocation_t {
 public:
     explicit thread_allocation_t(thread_allocator_t *p);
+    thread_allocation_t(thread_allocator_t *p, threadnum_t same_numa_node_as);
     ~thread_allocation_t();
     threadnum_t get_thread() const;
 private:
+    // Picks the least loaded thread on `numa_node`, or on any node if it's -1.
+    void allocate(int numa_node);
+
     threadnum_t thread;
     thread_allocator_t *parent;
     DISABLE_COPYING(thread_allocation_t);
@@ -0,0 +1,69 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/admission_control.hpp"
+
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/cond_var.hpp"
+#include "config/args.hpp"
+#include "containers/scoped.hpp"
+#include "perfmon/perfmon.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+/* Once all slots are taken, the waiting queries get the freed slots by priority, and
+the ones that can't get one in time are rejected. */
+TPTEST(AdmissionControlTest, PriorityAndTimeout) {
+    perfmon_counter_t queued, rejected;
+    ql::admission_control_t admission(&queued, &rejected);
+    cond_t non_interruptor;
+
+    std::vector<scoped_ptr_t<ql::admission_control_t::ticket_t> > tickets;
+    for (int i = 0; i < ADMISSION_MAX_ACTIVE_QUERIES; ++i) {
+        tickets.push_back(make_scoped<ql::admission_control_t::ticket_t>());
+        ASSERT_TRUE(admission.admit(ql::query_priority_t::NORMAL,
+                                    tickets.back().get(), &non_interruptor));
+    }
+
+    std::vector<ql::query_priority_t> admitted;
+    bool low_admitted = true;
+    cond_t normal_done, high_done, low_done;
+    auto run = [&](ql::query_priority_t priority, bool *res_out, cond_t *done) {
+        ql::admission_control_t::ticket_t ticket;
+        *res_out = admission.admit(priority, &ticket, &non_interruptor);
+        if (*res_out) {
+            admitted.push_back(priority);
+        }
+        done->pulse();
+    };
+    bool normal_admitted, high_admitted;
+    coro_t::spawn_now_dangerously([&]() {
+        run(ql::query_priority_t::NORMAL, &normal_admitted, &normal_done);
+    });
+    coro_t::spawn_now_dangerously([&]() {
+        run(ql::query_priority_t::HIGH, &high_admitted, &high_done);
+    });
+    coro_t::spawn_now_dangerously([&]() {
+        run(ql::query_priority_t::LOW, &low_admitted, &low_done);
+    });
+
+    // The low priority query gives up first.
+    low_done.wait();
+    EXPECT_FALSE(low_admitted);
+    EXPECT_TRUE(admitted.empty());
+
+    tickets.pop_back();
+    high_done.wait();
+    tickets.pop_back();
+    normal_done.wait();
+    EXPECT_TRUE(high_admitted);
+    EXPECT_TRUE(normal_admitted);
+    ASSERT_EQ(2u, admitted.size());
+    EXPECT_EQ(ql::query_priority_t::HIGH, admitted[0]);
+    EXPECT_EQ(ql::query_priority_t::NORMAL, admitted[1]);
+}
+
+}  // namespace unittest
@@ -34,6 +34,26 @@ TEST(WriteMessageTest, Variant) {
     ASSERT_EQ(15u, s.size());
 }
 
+TEST(WriteMessageTest, AppendMessage) {
+    write_message_t head;
+    serialize_universal(&head, static_cast<uint64_t>(0x0102030405060708ull));
+    write_message_t tail;
+    std::string big(write_buffer_t::DATA_SIZE + 10, 'x');
+    tail.append(big.data(), big.size());
+
+    head.append(std::move(tail));
+    ASSERT_EQ(0u, tail.size());
+    ASSERT_EQ(sizeof(uint64_t) + big.size(), head.size());
+
+    // Appending after the splice must keep the bytes in order.
+    head.append("y", 1);
+    std::string s;
+    dump_to_string(&head, &s);
+    ASSERT_EQ(head.size(), s.size());
+    ASSERT_EQ(8, s[0]);
+    ASSERT_EQ('x', s[sizeof(uint64_t)]);
+    ASSERT_EQ('y', s[s.size() - 1]);
+}
 
 
 }  // namespace unittest
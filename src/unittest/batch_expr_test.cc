@@ -0,0 +1,81 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/batch_expr.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+ql::datum_t make_row(double age, const std::string &country) {
+    return ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+        std::make_pair(datum_string_t("age"), ql::datum_t(age)),
+        std::make_pair(datum_string_t("country"), ql::datum_t(country.c_str()))});
+}
+
+TEST(BatchExprTest, Predicate) {
+    const ql::sym_t arg(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    ql::raw_term_t body = ((r.var(arg)["age"] > 30.0)
+                           && (r.var(arg)["country"] == std::string("DE"))).root_term();
+    scoped_ptr_t<ql::batch_expr_t> expr
+        = ql::batch_expr_t::compile(make_vector(arg), body);
+    ASSERT_TRUE(expr.has());
+
+    std::vector<ql::datum_t> rows{
+        make_row(40, "DE"),
+        make_row(20, "DE"),
+        make_row(40, "FR"),
+        ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+            std::make_pair(datum_string_t("country"), ql::datum_t("DE"))}),
+        ql::datum_t(2.0)};
+    std::vector<ql::datum_t> results;
+    expr->eval(rows, &results);
+    ASSERT_EQ(rows.size(), results.size());
+    EXPECT_EQ(ql::datum_t::boolean(true), results[0]);
+    EXPECT_EQ(ql::datum_t::boolean(false), results[1]);
+    EXPECT_EQ(ql::datum_t::boolean(false), results[2]);
+    // A missing field and a row that isn't an object have to be left to the regular
+    // evaluation, which produces the errors.
+    EXPECT_FALSE(results[3].has());
+    EXPECT_FALSE(results[4].has());
+}
+
+TEST(BatchExprTest, Arithmetic) {
+    const ql::sym_t arg(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    ql::raw_term_t body = (r.expr(100.0) / r.var(arg)["age"]).root_term();
+    scoped_ptr_t<ql::batch_expr_t> expr
+        = ql::batch_expr_t::compile(make_vector(arg), body);
+    ASSERT_TRUE(expr.has());
+
+    std::vector<ql::datum_t> rows{make_row(4, "DE"), make_row(0, "DE")};
+    std::vector<ql::datum_t> results;
+    expr->eval(rows, &results);
+    ASSERT_EQ(rows.size(), results.size());
+    EXPECT_EQ(ql::datum_t(25.0), results[0]);
+    EXPECT_FALSE(results[1].has());
+
+    // The results must not depend on the arena, which gets reset after each batch.
+    arena_t arena;
+    for (int i = 0; i < 2; ++i) {
+        std::vector<ql::datum_t> arena_results;
+        expr->eval(rows, &arena_results, &arena);
+        ASSERT_EQ(rows.size(), arena_results.size());
+        EXPECT_EQ(ql::datum_t(25.0), arena_results[0]);
+        EXPECT_FALSE(arena_results[1].has());
+    }
+    EXPECT_LT(0u, arena.bytes_from_blocks());
+}
+
+TEST(BatchExprTest, Unsupported) {
+    const ql::sym_t arg(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    ql::raw_term_t body = r.var(arg).pluck(std::string("age")).root_term();
+    EXPECT_FALSE(ql::batch_expr_t::compile(make_vector(arg), body).has());
+
+    // Other variables come from an enclosing scope.
+    const ql::sym_t other(2);
+    body = (r.var(other)["age"] > 30.0).root_term();
+    EXPECT_FALSE(ql::batch_expr_t::compile(make_vector(arg), body).has());
+}
+
+}  // namespace unittest
@@ -0,0 +1,29 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "serializer/block_buffer_pool.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(BlockBufferPool, ReusesBuffers) {
+    scoped_device_block_aligned_ptr_t<ser_buffer_t> buffer
+        = alloc_block_buffer(4 * DEVICE_BLOCK_SIZE);
+    ser_buffer_t *const address = buffer.get();
+    free_block_buffer(4 * DEVICE_BLOCK_SIZE, std::move(buffer));
+    EXPECT_FALSE(buffer.has());
+
+    // Other sizes don't get the buffer...
+    scoped_device_block_aligned_ptr_t<ser_buffer_t> other
+        = alloc_block_buffer(2 * DEVICE_BLOCK_SIZE);
+    EXPECT_NE(address, other.get());
+
+    // ...but `buf_ptr_t`s of the same aligned size do.
+    buf_ptr_t buf = buf_ptr_t::alloc_zeroed(
+        block_size_t::unsafe_make(4 * DEVICE_BLOCK_SIZE - 10));
+    EXPECT_EQ(address, buf.ser_buffer());
+    buf.reset();
+    EXPECT_EQ(address, alloc_block_buffer(4 * DEVICE_BLOCK_SIZE).get());
+}
+
+}  // namespace unittest
@@ -0,0 +1,56 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include "config/args.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/log/block_compression.hpp"
+
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(BlockCompressionTest, RoundTrip) {
+    const block_size_t block_size = block_size_t::unsafe_make(DEFAULT_BTREE_BLOCK_SIZE);
+    buf_ptr_t buf = buf_ptr_t::alloc_zeroed(block_size);
+    buf.ser_buffer()->ser_header.block_id = 17;
+    char *data = static_cast<char *>(buf.cache_data());
+    for (uint32_t i = 0; i < block_size.value(); ++i) {
+        data[i] = 'a' + (i / 100) % 26;
+    }
+
+    block_codec_t codec;
+    scoped_device_block_aligned_ptr_t<ser_buffer_t> compressed;
+    block_size_t disk_block_size = block_size_t::undefined();
+    ASSERT_TRUE(codec.compress(buf.ser_buffer(), block_size,
+                               &compressed, &disk_block_size));
+    ASSERT_LT(buf_ptr_t::compute_aligned_block_size(disk_block_size),
+              buf.aligned_block_size());
+    ASSERT_EQ(block_size,
+              block_codec_t::uncompressed_block_size(compressed.get()));
+
+    buf_ptr_t decompressed = codec.decompress(compressed.get(), block_size,
+                                              disk_block_size);
+    ASSERT_EQ(block_size, decompressed.block_size());
+    ASSERT_EQ(17u, decompressed.ser_buffer()->ser_header.block_id);
+    ASSERT_EQ(0, memcmp(buf.ser_buffer(), decompressed.ser_buffer(),
+                        buf.aligned_block_size()));
+}
+
+TEST(BlockCompressionTest, IncompressibleBlock) {
+    const block_size_t block_size = block_size_t::unsafe_make(DEFAULT_BTREE_BLOCK_SIZE);
+    buf_ptr_t buf = buf_ptr_t::alloc_zeroed(block_size);
+    char *data = static_cast<char *>(buf.cache_data());
+    uint32_t state = 12345;
+    for (uint32_t i = 0; i < block_size.value(); ++i) {
+        state = state * 1103515245 + 12345;
+        data[i] = static_cast<char>(state >> 16);
+    }
+
+    block_codec_t codec;
+    scoped_device_block_aligned_ptr_t<ser_buffer_t> compressed;
+    block_size_t disk_block_size = block_size_t::undefined();
+    ASSERT_FALSE(codec.compress(buf.ser_buffer(), block_size,
+                                &compressed, &disk_block_size));
+}
+
+}  // namespace unittest
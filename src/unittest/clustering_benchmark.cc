@@ -0,0 +1,261 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "unittest/gtest.hpp"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "clustering/administration/metadata.hpp"
+#include "clustering/generic/raft_core.hpp"
+#include "clustering/generic/raft_core.tcc"
+#include "clustering/generic/raft_network.hpp"
+#include "clustering/generic/raft_network.tcc"
+#include "clustering/immediate_consistency/backfillee.hpp"
+#include "clustering/immediate_consistency/backfiller.hpp"
+#include "clustering/immediate_consistency/local_replicator.hpp"
+#include "clustering/immediate_consistency/primary_dispatcher.hpp"
+#include "clustering/immediate_consistency/remote_replicator_client.hpp"
+#include "clustering/immediate_consistency/remote_replicator_server.hpp"
+#include "clustering/immediate_consistency/standard_backfill_throttler.hpp"
+#include "clustering/table_manager/backfill_progress_tracker.hpp"
+#include "containers/uuid.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "unittest/branch_history_manager.hpp"
+#include "unittest/clustering_utils.hpp"
+#include "unittest/clustering_utils_raft.hpp"
+#include "unittest/mock_store.hpp"
+#include "unittest/unittest_utils.hpp"
+
+// Benchmarks for failover, backfills and replication, on the same in-process clusters
+// that the clustering tests use.  Besides printing the results, every benchmark
+// records them as properties, which end up in the XML report when the unit tests are
+// run with `--gtest_output=xml`, like the ones in `hot_paths_benchmark.cc`.  The
+// stores are `mock_store_t`s, so this measures the clustering code rather than the
+// disk.  No need to run these in debug mode.
+#ifdef NDEBUG
+
+namespace unittest {
+
+namespace {
+
+void report_measurement(const char *name, const char *unit, double value) {
+    printf("%s: %f %s\n", name, value, unit);
+    ::testing::Test::RecordProperty(strprintf("%s_%s", name, unit),
+                                    static_cast<int>(value));
+}
+
+}  // namespace
+
+/* Kills the Raft leader of a five member cluster again and again, and measures how long
+it takes until a new leader has committed a change. */
+TPTEST(ClusteringBenchmark, RaftFailover) {
+    const int NUM_FAILOVERS = 10;
+    std::vector<raft_member_id_t> member_ids;
+    dummy_raft_cluster_t cluster(5, dummy_raft_state_t(), &member_ids);
+    do_writes_raft(&cluster, 10, 60000);
+
+    ticks_t total_ticks = 0;
+    ticks_t max_ticks = 0;
+    for (int i = 0; i < NUM_FAILOVERS; ++i) {
+        const raft_member_id_t old_leader = cluster.find_leader(60000);
+        const ticks_t start_ticks = get_ticks();
+        cluster.set_live(old_leader, dummy_raft_cluster_t::live_t::dead);
+        signal_timer_t timeout;
+        timeout.start(60000);
+        try {
+            while (!cluster.try_change(
+                    cluster.find_leader(&timeout), generate_uuid(), &timeout)) { }
+        } catch (const interrupted_exc_t &) {
+            FAIL() << "no new leader committed a change within 60 seconds";
+        }
+        const ticks_t failover_ticks = get_ticks() - start_ticks;
+        total_ticks += failover_ticks;
+        max_ticks = std::max(max_ticks, failover_ticks);
+
+        cluster.set_live(old_leader, dummy_raft_cluster_t::live_t::alive);
+        do_writes_raft(&cluster, 10, 60000);
+    }
+    report_measurement("raft_failover_mean", "ms",
+                       ticks_to_secs(total_ticks) * 1000 / NUM_FAILOVERS);
+    report_measurement("raft_failover_max", "ms", ticks_to_secs(max_ticks) * 1000);
+}
+
+/* Backfills a store full of documents into an empty one, like `BackfillTest` in
+`clustering_backfill.cc`, and measures the rate of the documents' keys and values. */
+TPTEST(ClusteringBenchmark, Backfill) {
+    const int NUM_KEYS = 20000;
+    const size_t VALUE_SIZE = 1000;
+    order_source_t order_source;
+    cond_t non_interruptor;
+    region_t region = region_t::universe();
+
+    mock_store_t backfiller_store;
+    mock_store_t backfillee_store;
+
+    in_memory_branch_history_manager_t branch_history_manager;
+    branch_id_t dummy_branch_id = generate_uuid();
+    {
+        branch_birth_certificate_t dummy_branch;
+        dummy_branch.initial_timestamp = state_timestamp_t::zero();
+        dummy_branch.origin = region_map_t<version_t>(region, version_t::zero());
+        branch_history_manager.create_branch(dummy_branch_id, dummy_branch);
+    }
+
+    state_timestamp_t timestamp = state_timestamp_t::zero();
+    store_view_t *stores[] = { &backfiller_store, &backfillee_store };
+    for (size_t i = 0; i < sizeof(stores) / sizeof(stores[0]); i++) {
+        write_token_t token;
+        stores[i]->new_write_token(&token);
+        stores[i]->set_metainfo(
+            region_map_t<binary_blob_t>(
+                region,
+                binary_blob_t(version_t(dummy_branch_id, timestamp))),
+            order_source.check_in(strprintf("set_metainfo(i=%zu)", i)),
+            &token,
+            write_durability_t::HARD,
+            &non_interruptor);
+    }
+
+    int64_t num_bytes = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        const std::string key = strprintf("key %06d", i);
+        const std::string value(VALUE_SIZE, 'a' + i % 26);
+        num_bytes += key.size() + value.size();
+        timestamp = timestamp.next();
+        write_token_t token;
+        backfiller_store.new_write_token(&token);
+        write_response_t response;
+        backfiller_store.write(
+            region_map_t<binary_blob_t>(
+                region,
+                binary_blob_t(version_t(dummy_branch_id, timestamp))),
+            mock_overwrite(key, value),
+            &response,
+            write_durability_t::SOFT,
+            timestamp,
+            order_source.check_in("backfiller_store.write"),
+            &token,
+            &non_interruptor);
+    }
+
+    simple_mailbox_cluster_t cluster;
+    backfiller_t backfiller(
+        cluster.get_mailbox_manager(),
+        &branch_history_manager,
+        &backfiller_store);
+
+    const ticks_t start_ticks = get_ticks();
+    {
+        backfill_progress_tracker_t backfill_progress_tracker;
+        backfill_progress_tracker_t::progress_tracker_t *progress_tracker =
+            backfill_progress_tracker.insert_progress_tracker(
+                backfillee_store.get_region());
+
+        backfillee_t backfillee(
+            cluster.get_mailbox_manager(),
+            &branch_history_manager,
+            &backfillee_store,
+            backfiller.get_business_card(),
+            backfill_config_t(),
+            progress_tracker,
+            &non_interruptor);
+        class callback_t : public backfillee_t::callback_t {
+        public:
+            bool on_progress(const region_map_t<version_t> &) THROWS_NOTHING {
+                return true;
+            }
+        } callback;
+        backfillee.go(
+            &callback,
+            key_range_t::right_bound_t(backfillee_store.get_region().inner.left),
+            &non_interruptor);
+    }
+    const double secs = ticks_to_secs(get_ticks() - start_ticks);
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        const std::string key = strprintf("key %06d", i);
+        ASSERT_EQ(backfiller_store.values(key), backfillee_store.values(key));
+    }
+    report_measurement("backfill", "mb_per_sec", num_bytes / secs / MEGABYTE);
+}
+
+/* Sends writes one at a time through a primary with a local and a remote replica, like
+the `Backfill` test in `clustering_branch.cc`, and measures how long it takes until both
+replicas have acknowledged them. */
+TPTEST(ClusteringBenchmark, ReplicationWriteLatency) {
+    const int NUM_WRITES = 5000;
+    order_source_t order_source;
+    simple_mailbox_cluster_t cluster;
+    cond_t interruptor;
+
+    primary_dispatcher_t primary_dispatcher(
+        &get_global_perfmon_collection(),
+        region_map_t<version_t>(region_t::universe(), version_t::zero()));
+
+    mock_store_t store1((binary_blob_t(version_t::zero())));
+    in_memory_branch_history_manager_t bhm1;
+    local_replicator_t local_replicator(
+        cluster.get_mailbox_manager(),
+        server_id_t::generate_server_id(),
+        &primary_dispatcher,
+        &store1,
+        &bhm1,
+        &interruptor);
+
+    remote_replicator_server_t remote_replicator_server(
+        cluster.get_mailbox_manager(),
+        &primary_dispatcher);
+
+    standard_backfill_throttler_t backfill_throttler;
+    backfill_progress_tracker_t backfill_progress_tracker;
+    mock_store_t store2((binary_blob_t(version_t::zero())));
+    in_memory_branch_history_manager_t bhm2;
+    remote_replicator_client_t remote_replicator_client(
+        &backfill_throttler,
+        backfill_config_t(),
+        &backfill_progress_tracker,
+        cluster.get_mailbox_manager(),
+        server_id_t::generate_server_id(),
+        backfill_throttler_t::priority_t::critical_t::NO,
+        primary_dispatcher.get_branch_id(),
+        remote_replicator_server.get_bcard(),
+        local_replicator.get_replica_bcard(),
+        server_id_t::generate_server_id(),
+        &store2,
+        &bhm2,
+        &interruptor);
+
+    std::vector<ticks_t> latencies;
+    latencies.reserve(NUM_WRITES);
+    for (int i = 0; i < NUM_WRITES; i++) {
+        write_t w = mock_overwrite(strprintf("key %04d", i % 1000), strprintf("%d", i));
+        simple_write_callback_t write_callback;
+        const ticks_t start_ticks = get_ticks();
+        primary_dispatcher.spawn_write(
+            w,
+            order_source.check_in("ClusteringBenchmark.ReplicationWriteLatency"),
+            &write_callback);
+        write_callback.wait_lazily_unordered();
+        latencies.push_back(get_ticks() - start_ticks);
+        ASSERT_EQ(2, write_callback.acks);
+    }
+
+    ticks_t total_ticks = 0;
+    for (ticks_t latency : latencies) {
+        total_ticks += latency;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    report_measurement("write_ack_latency_mean", "us",
+                       ticks_to_secs(total_ticks) * MILLION / NUM_WRITES);
+    report_measurement("write_ack_latency_p50", "us",
+                       ticks_to_secs(latencies[NUM_WRITES / 2]) * MILLION);
+    report_measurement("write_ack_latency_p99", "us",
+                       ticks_to_secs(latencies[NUM_WRITES * 99 / 100]) * MILLION);
+}
+
+}  // namespace unittest
+
+#endif  // NDEBUG
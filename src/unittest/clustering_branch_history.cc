@@ -2,6 +2,7 @@
 #include "unittest/gtest.hpp"
 
 #include "clustering/immediate_consistency/history.hpp"
+#include "clustering/table_contract/branch_history_gc.hpp"
 #include "containers/uuid.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "unittest/unittest_utils.hpp"
@@ -167,4 +168,37 @@ TPTEST(ClusteringBranchHistory, CommonAncestorSameOrigin) {
             quick_vers(b11, 456), quick_vers(b1112, 456), quick_region("A-Z")));
 }
 
+TPTEST(ClusteringBranchHistory, MarkAncestorsSinceTimestampLive) {
+    branch_history_t bh;
+    branch_id_t b1 = quick_branch(&bh, { {"A-Z", nil_uuid(), 0} });
+    branch_id_t b2 = quick_branch(&bh, { {"A-Z", b1, 100} });
+    branch_id_t b3 = quick_branch(&bh, { {"A-M", b2, 200}, {"N-Z", b1, 150} });
+    branch_id_t b4 = quick_branch(&bh, { {"A-Z", b3, 300} });
+
+    auto live_since = [&](int timestamp) {
+        std::set<branch_id_t> remove;
+        for (const auto &pair : bh.branches) {
+            remove.insert(pair.first);
+        }
+        mark_ancestors_since_timestamp_live(b4, quick_region("A-Z"),
+            make_state_timestamp(timestamp), &bh, &remove);
+        std::set<branch_id_t> live;
+        for (const auto &pair : bh.branches) {
+            if (remove.count(pair.first) == 0) {
+                live.insert(pair.first);
+            }
+        }
+        return live;
+    };
+
+    /* A common ancestor on `b4` itself doesn't need any other branches */
+    EXPECT_EQ(std::set<branch_id_t>({b4}), live_since(350));
+    /* `b3`'s origin is on `b2` in one half and on `b1` in the other */
+    EXPECT_EQ(std::set<branch_id_t>({b4, b3}), live_since(250));
+    /* If the common ancestor might be `b4`'s origin, we keep `b3` */
+    EXPECT_EQ(std::set<branch_id_t>({b4, b3}), live_since(300));
+    EXPECT_EQ(std::set<branch_id_t>({b4, b3, b2, b1}), live_since(200));
+    EXPECT_EQ(std::set<branch_id_t>({b4, b3, b2, b1}), live_since(0));
+}
+
 }   /* namespace unittest */
@@ -182,7 +182,7 @@ public:
         std::map<region_t, branch_id_t> register_current_branches;
         std::set<branch_id_t> remove_branches;
         branch_history_t add_branches;
-        calculate_all_contracts(state, acks, &connections,
+        calculate_all_contracts(state, acks, &connections, nullptr,
             &remove_contracts, &add_contracts, &register_current_branches,
             &remove_branches, &add_branches);
         for (const contract_id_t &id : remove_contracts) {
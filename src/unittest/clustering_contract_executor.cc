@@ -111,6 +111,9 @@ public:
     store_t *get_underlying_store(UNUSED size_t i) {
         crash("not implemented for this unit test");
     }
+    void set_mmap_reads(UNUSED bool enabled) {
+        /* do nothing */
+    }
 private:
     friend class executor_tester_t;
     server_id_t server_id;
@@ -253,7 +253,8 @@ public:
                                  0,
                                  heartbeat_manager.get_view(),
                                  auth_manager.get_view(),
-                                 nullptr)
+                                 nullptr,
+                                 false)
         { }
     connectivity_cluster_t *get_connectivity_cluster() {
         return &connectivity_cluster;
@@ -287,10 +288,12 @@ private:
 class test_cluster_run_t {
 public:
     explicit test_cluster_run_t(connectivity_cluster_t *c,
-                                const peer_address_t &canonical_addr = peer_address_t())
+                                const peer_address_t &canonical_addr = peer_address_t(),
+                                bool compress_messages = false)
         : run(c, server_id_t::generate_server_id(),
             get_unittest_addresses(), canonical_addr, 0, ANY_PORT, 0,
-            heartbeat_manager.get_view(), auth_manager.get_view(), nullptr) { }
+            heartbeat_manager.get_view(), auth_manager.get_view(), nullptr,
+            compress_messages) { }
 
     operator connectivity_cluster_t::run_t&() {
         return run;
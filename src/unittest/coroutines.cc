@@ -2,6 +2,8 @@
 
 #include "arch/runtime/coroutines.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/runtime/work_stealing.hpp"
+#include "arch/timing.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "config/args.hpp"
 #include "unittest/gtest.hpp"
@@ -106,6 +108,73 @@ TEST(CoroutinesTest, NotifyNow) {
     });
 }
 
+TEST(CoroutinesTest, RunningTicks) {
+    run_in_thread_pool([&]() {
+        const ticks_t start_running = coro_t::self()->get_running_ticks();
+        const ticks_t start = get_ticks();
+        while (get_ticks() < start + 20 * MILLION) { }
+        // Time spent waiting doesn't count.
+        nap(100);
+        const ticks_t running = coro_t::self()->get_running_ticks() - start_running;
+        EXPECT_GE(running, static_cast<ticks_t>(20 * MILLION));
+        EXPECT_LT(running, static_cast<ticks_t>(100 * MILLION));
+    });
+}
+
+TEST(CoroutinesTest, SmallStacks) {
+    // Runs more coroutines than fit on the hot free list twice, so that the second
+    // round reuses stacks that have had their pages released.
+    run_in_thread_pool([&]() {
+        for (int round = 0; round < 2; ++round) {
+            int num_waiting = 100;
+            cond_t all_ran;
+            for (int i = 0; i < 100; ++i) {
+                coro_t::spawn_sometime([&, i]() {
+                    ASSERT_FALSE(has_n_bytes_free_stack_space(COROUTINE_SMALL_STACK_SIZE));
+                    char buffer[KILOBYTE * 16];
+                    memset(buffer, i, sizeof(buffer));
+                    coro_t::yield();
+                    for (size_t j = 0; j < sizeof(buffer); j += KILOBYTE) {
+                        ASSERT_EQ(static_cast<char>(i), buffer[j]);
+                    }
+                    --num_waiting;
+                    if (num_waiting == 0) {
+                        all_ran.pulse();
+                    }
+                }, coro_stack_class_t::SMALL);
+            }
+            all_ran.wait_lazily_unordered();
+        }
+    });
+}
+
+TEST(CoroutinesTest, RunStealable) {
+    // Several coroutines keep one thread busy with CPU-bound tasks, which the idle
+    // threads may take over.  Either way the results and exceptions have to arrive.
+    run_in_thread_pool([&]() {
+        auto_drainer_t drainer;
+        std::vector<uint64_t> results(100, 0);
+        for (size_t i = 0; i < results.size(); ++i) {
+            auto_drainer_t::lock_t lock(&drainer);
+            coro_t::spawn_sometime([&results, i, lock]() {
+                run_stealable([&]() {
+                    uint64_t sum = 0;
+                    for (uint64_t j = 0; j < 100000; ++j) {
+                        sum += j * i;
+                    }
+                    results[i] = sum;
+                });
+                EXPECT_THROW(run_stealable([]() { throw std::runtime_error("x"); }),
+                             std::runtime_error);
+            });
+        }
+        drainer.drain();
+        for (size_t i = 0; i < results.size(); ++i) {
+            EXPECT_EQ(i * (UINT64_C(100000) * 99999 / 2), results[i]);
+        }
+    }, 4);
+}
+
 // The following test does not work on 32 bit architectures because it will exceed
 // their virtual memory.
 #if defined (__x86_64__) || defined (_WIN64)
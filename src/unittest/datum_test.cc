@@ -1,9 +1,12 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 
+#include "containers/archive/shared_buf_stream.hpp"
 #include "containers/archive/string_stream.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/datum_string.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 #include "unittest/gtest.hpp"
 
 
@@ -172,8 +175,90 @@ TEST(DatumTest, ArraySerialization) {
     }
 }
 
+std::string serialize_datum_to_string(const ql::datum_t &datum) {
+    string_stream_t write_stream;
+    write_message_t wm;
+    ql::datum_serialize(&wm, datum, ql::check_datum_serialization_errors_t::NO);
+    int write_res = send_write_message(&write_stream, &wm);
+    guarantee(write_res == 0);
+    return write_stream.str();
+}
+
+TEST(DatumTest, FieldFromSerialized) {
+    std::map<datum_string_t, ql::datum_t> fields;
+    for (int i = 0; i < 50; ++i) {
+        fields[datum_string_t(strprintf("field%d", i))]
+            = ql::datum_t(datum_string_t(std::string(2000, 'a' + i % 26)));
+    }
+    fields[datum_string_t("small")] = ql::datum_t(3.0);
+    const ql::datum_t object(std::move(fields));
+    const std::string serialized = serialize_datum_to_string(object);
+
+    int64_t bytes_read = 0;
+    auto read_region = [&](int64_t offset, int64_t size, char *out) {
+        ASSERT_LE(offset + size, static_cast<int64_t>(serialized.size()));
+        memcpy(out, serialized.data() + offset, size);
+        bytes_read += size;
+    };
+
+    for (size_t i = 0; i < object.obj_size(); ++i) {
+        auto pair = object.get_pair(i);
+        ql::datum_t field;
+        ASSERT_TRUE(ql::datum_get_field_from_serialized(
+            serialized.size(), read_region, pair.first, &field));
+        ASSERT_EQ(pair.second, field);
+    }
+
+    bytes_read = 0;
+    ql::datum_t field;
+    ASSERT_TRUE(ql::datum_get_field_from_serialized(
+        serialized.size(), read_region, datum_string_t("small"), &field));
+    ASSERT_EQ(ql::datum_t(3.0), field);
+    // Only a small part of the object needs to be read.
+    ASSERT_LT(bytes_read, 1000);
+
+    ASSERT_TRUE(ql::datum_get_field_from_serialized(
+        serialized.size(), read_region, datum_string_t("missing"), &field));
+    ASSERT_FALSE(field.has());
+
+    const std::string serialized_array = serialize_datum_to_string(
+        ql::datum_t(std::vector<ql::datum_t>{ql::datum_t::null()},
+                    ql::configured_limits_t::unlimited));
+    ASSERT_FALSE(ql::datum_get_field_from_serialized(
+        serialized_array.size(),
+        [&](int64_t offset, int64_t size, char *out) {
+            memcpy(out, serialized_array.data() + offset, size);
+        },
+        datum_string_t("small"), &field));
+}
+
 // Tests serialization with different offset sizes, up to 32 bit
 // (64 bit not tested here, because that would use too much memory for a unit test)
+TEST(DatumTest, FieldFromBuf) {
+    std::map<datum_string_t, ql::datum_t> fields;
+    for (int i = 0; i < 300; ++i) {
+        fields[datum_string_t(strprintf("field%d", i))]
+            = ql::datum_t(static_cast<double>(i));
+    }
+    fields[datum_string_t(std::string("nul\0key", 7))] = ql::datum_t::null();
+    const ql::datum_t object(std::move(fields));
+    const std::string serialized = serialize_datum_to_string(object);
+    counted_t<shared_buf_t> buf = shared_buf_t::create(serialized.size());
+    memcpy(buf->data(), serialized.data(), serialized.size());
+    const ql::datum_t deserialized
+        = ql::datum_deserialize_from_buf(shared_buf_ref_t<char>(buf, 0), 0);
+    ASSERT_TRUE(deserialized.get_buf_ref() != nullptr);
+
+    for (size_t i = 0; i < object.obj_size(); ++i) {
+        auto pair = object.get_pair(i);
+        EXPECT_EQ(pair.second, deserialized.get_field(pair.first, ql::NOTHROW));
+    }
+    for (const char *missing : {"", "field", "field3000", "nul", "zzz"}) {
+        EXPECT_FALSE(deserialized.get_field(missing, ql::NOTHROW).has());
+    }
+    EXPECT_FALSE(ql::datum_t::empty_object().get_field("a", ql::NOTHROW).has());
+}
+
 TEST(DatumTest, OffsetScaling) {
     {
         // 8 bit
@@ -205,4 +290,273 @@ TEST(DatumTest, OffsetScaling) {
     }
 }
 
+TEST(DatumTest, SharedBufDeserialization) {
+    std::map<datum_string_t, ql::datum_t> fields;
+    fields[datum_string_t("large")]
+        = ql::datum_t(datum_string_t(std::string(2000, 'a')));
+    fields[datum_string_t("small")] = ql::datum_t(datum_string_t("b"));
+    const ql::datum_t object(std::move(fields));
+    const ql::datum_t large_string(datum_string_t(std::string(3000, 'c')));
+    std::string serialized;
+    for (const ql::datum_t &datum : {object, large_string, object.get_field("small")}) {
+        serialized += serialize_datum_to_string(datum);
+    }
+
+    counted_t<shared_buf_t> buf = shared_buf_t::create(serialized.size());
+    memcpy(buf->data(), serialized.data(), serialized.size());
+    const char *const buf_start = buf->data();
+    const char *const buf_end = buf_start + buf->size();
+    auto points_into_buf = [&](const char *p) {
+        return p >= buf_start && p < buf_end;
+    };
+
+    shared_buf_read_stream_t stream(std::move(buf));
+    ql::datum_t deserialized;
+    ASSERT_EQ(archive_result_t::SUCCESS, ql::datum_deserialize(&stream, &deserialized));
+    ASSERT_EQ(object, deserialized);
+    ASSERT_TRUE(deserialized.get_buf_ref() != nullptr);
+    EXPECT_TRUE(points_into_buf(deserialized.get_buf_ref()->get()));
+
+    ASSERT_EQ(archive_result_t::SUCCESS, ql::datum_deserialize(&stream, &deserialized));
+    ASSERT_EQ(large_string, deserialized);
+    EXPECT_TRUE(points_into_buf(deserialized.as_str().data()));
+
+    // Small values are still copied, so that they don't keep the buffer alive.
+    ASSERT_EQ(archive_result_t::SUCCESS, ql::datum_deserialize(&stream, &deserialized));
+    ASSERT_EQ(object.get_field("small"), deserialized);
+    EXPECT_FALSE(points_into_buf(deserialized.as_str().data()));
+    EXPECT_EQ(0u, stream.remaining());
+}
+
+TEST(DatumTest, JsonFromSerialized) {
+    std::map<datum_string_t, ql::datum_t> inner;
+    inner[datum_string_t("b")] = ql::datum_t::binary(datum_string_t("abc"));
+    inner[datum_string_t("n")] = ql::datum_t::null();
+    std::map<datum_string_t, ql::datum_t> fields;
+    fields[datum_string_t("array")] = ql::datum_t(
+        std::vector<ql::datum_t>{
+            ql::datum_t(1.0), ql::datum_t(-0.0), ql::datum_t(2.5), ql::datum_t(-3.0),
+            ql::datum_t(1e300), ql::datum_t("x"), ql::datum_t::boolean(true),
+            ql::datum_t(std::move(inner)),
+            ql::datum_t(std::vector<ql::datum_t>(),
+                        ql::configured_limits_t::unlimited)},
+        ql::configured_limits_t::unlimited);
+    fields[datum_string_t("str")] = ql::datum_t(datum_string_t("\"quoted\"\n"));
+    const ql::datum_t object(std::move(fields));
+
+    string_read_stream_t read_stream(serialize_datum_to_string(object), 0);
+    ql::datum_t deserialized;
+    ASSERT_EQ(archive_result_t::SUCCESS,
+              ql::datum_deserialize(&read_stream, &deserialized));
+    ASSERT_TRUE(deserialized.get_buf_ref() != nullptr);
+    EXPECT_EQ(object.print(), deserialized.print());
+    EXPECT_EQ(object.get_field("array").print(),
+              deserialized.get_field("array").print());
+}
+
+TEST(DatumTest, TimeSerialization) {
+    const ql::datum_t compact = ql::pseudo::make_time(1234567890.123, "-07:30");
+    test_datum_serialization(compact);
+    // The type, the epoch time and the timezone offset
+    EXPECT_EQ(11u, ql::datum_serialized_size(
+        compact, ql::check_datum_serialization_errors_t::YES));
+
+    // Times that wouldn't come back the same are stored as objects.
+    const ql::datum_t not_compact = ql::pseudo::make_time(0, "-00:00");
+    test_datum_serialization(not_compact);
+    EXPECT_LT(11u, ql::datum_serialized_size(
+        not_compact, ql::check_datum_serialization_errors_t::YES));
+
+    // Nested in an object that's read from a buffer
+    const ql::datum_t object(std::map<datum_string_t, ql::datum_t>
+        {std::make_pair(datum_string_t("t"), compact)});
+    test_datum_serialization(object);
+    string_read_stream_t read_stream(serialize_datum_to_string(object), 0);
+    ql::datum_t deserialized;
+    ASSERT_EQ(archive_result_t::SUCCESS,
+              ql::datum_deserialize(&read_stream, &deserialized));
+    EXPECT_EQ(compact, deserialized.get_field("t"));
+    EXPECT_EQ(object.print(), deserialized.print());
+}
+
+TEST(DatumTest, InlineAndInternedStrings) {
+    const std::string short_str(datum_string_t::MAX_INLINE_SIZE, 's');
+    const std::string long_str(datum_string_t::MAX_INLINE_SIZE + 1, 'l');
+    for (const std::string &str : {std::string(), short_str, long_str}) {
+        datum_string_t s(str);
+        EXPECT_EQ(str, s.to_std());
+        datum_string_t interned = datum_string_t::intern(str.size(), str.data());
+        EXPECT_EQ(s, interned);
+        EXPECT_EQ(0, s.compare(interned));
+
+        datum_string_t moved(std::move(s));
+        EXPECT_EQ(str, moved.to_std());
+        EXPECT_TRUE(s.empty());
+
+        // Strings that refer to a serialized buffer copy short contents out of it.
+        string_read_stream_t stream(serialize_datum_to_string(ql::datum_t(moved)), 0);
+        ql::datum_t deserialized;
+        ASSERT_EQ(archive_result_t::SUCCESS, ql::datum_deserialize(&stream, &deserialized));
+        EXPECT_EQ(moved, deserialized.as_str());
+    }
+
+    // Equal interned keys share their buffer, so they point at the same data.
+    datum_string_t a = datum_string_t::intern(long_str.size(), long_str.data());
+    datum_string_t b = datum_string_t::intern(long_str.size(), long_str.data());
+    EXPECT_EQ(a.data(), b.data());
+
+    EXPECT_EQ(short_str + long_str, concat(datum_string_t(short_str),
+                                           datum_string_t(long_str)).to_std());
+    EXPECT_EQ("ab", concat(datum_string_t("a"), datum_string_t("b")).to_std());
+}
+
+int sign(int x) {
+    return x < 0 ? -1 : (x > 0 ? 1 : 0);
+}
+
+TEST(DatumTest, SortKeys) {
+    std::vector<ql::datum_t> datums = {
+        ql::datum_t::minval(),
+        ql::datum_t::maxval(),
+        ql::datum_t::null(),
+        ql::datum_t::boolean(false),
+        ql::datum_t::boolean(true),
+        ql::datum_t(-1e300),
+        ql::datum_t(-1.5),
+        ql::datum_t(-0.0),
+        ql::datum_t(0.0),
+        ql::datum_t(1e-300),
+        ql::datum_t(2.0),
+        ql::datum_t(datum_string_t("")),
+        ql::datum_t(datum_string_t("a")),
+        ql::datum_t(datum_string_t(std::string("a\0", 2))),
+        ql::datum_t(datum_string_t(std::string("a\0b", 3))),
+        ql::datum_t(datum_string_t("a\x01")),
+        ql::datum_t(datum_string_t("b\xff")),
+        ql::datum_t::empty_array()
+    };
+    const size_t num_scalars = datums.size();
+    for (size_t i = 0; i < num_scalars; i += 3) {
+        datums.push_back(ql::datum_t(std::vector<ql::datum_t>{datums[i]},
+                                     ql::configured_limits_t::unlimited));
+        datums.push_back(ql::datum_t(std::vector<ql::datum_t>{datums[i], datums[i]},
+                                     ql::configured_limits_t::unlimited));
+    }
+
+    for (const ql::datum_t &l : datums) {
+        std::string l_key;
+        ASSERT_TRUE(l.append_sort_key(&l_key));
+        for (const ql::datum_t &r : datums) {
+            std::string r_key;
+            ASSERT_TRUE(r.append_sort_key(&r_key));
+            EXPECT_EQ(sign(l.cmp(r)), sign(l_key.compare(r_key)))
+                << l.print() << " vs. " << r.print();
+        }
+    }
+
+    std::string key;
+    EXPECT_FALSE(ql::datum_t::empty_object().append_sort_key(&key));
+}
+
+// Whether a sindex key was truncated depends on the length of its own primary key, not
+// on the longest primary key there could be.
+TEST(DatumTest, SecondaryTruncation) {
+    const store_key_t primary_key("id");
+    const ql::datum_t medium(datum_string_t(std::string(150, 'a')));
+    const ql::datum_t large(datum_string_t(std::string(400, 'a')));
+    ASSERT_GT(150u, ql::datum_t::max_trunc_size());
+
+    ql::components_t components = ql::datum_t::extract_all(
+        medium.print_secondary(reql_version_t::LATEST, primary_key, r_nullopt));
+    EXPECT_FALSE(ql::datum_t::secondary_is_truncated(components));
+    EXPECT_EQ(medium.untruncated_secondary(reql_version_t::LATEST),
+              components.secondary);
+
+    components = ql::datum_t::extract_all(
+        large.print_secondary(reql_version_t::LATEST, primary_key, r_nullopt));
+    EXPECT_TRUE(ql::datum_t::secondary_is_truncated(components));
+    const std::string untruncated = large.untruncated_secondary(reql_version_t::LATEST);
+    EXPECT_LT(components.secondary.size(), untruncated.size());
+    EXPECT_EQ(0, untruncated.compare(0, components.secondary.size(),
+                                     components.secondary));
+}
+
+
+std::string serialize_datum_to_string_checked(const ql::datum_t &datum,
+                                             const shared_buf_t *checked_buf) {
+    string_stream_t write_stream;
+    write_message_t wm;
+    ql::serialization_result_t res = ql::datum_serialize(
+        &wm, datum, ql::check_datum_serialization_errors_t::YES, checked_buf);
+    guarantee(!ql::bad(res));
+    int write_res = send_write_message(&write_stream, &wm);
+    guarantee(write_res == 0);
+    return write_stream.str();
+}
+
+// Fields that an update takes over from the old row get copied from its buffer, which
+// must give the same result as serializing them element by element.
+TEST(DatumTest, SerializeWithCheckedBuf) {
+    std::map<datum_string_t, ql::datum_t> nested;
+    for (int i = 0; i < 100; ++i) {
+        nested[datum_string_t(strprintf("field%d", i))]
+            = ql::datum_t(static_cast<double>(i));
+    }
+    std::map<datum_string_t, ql::datum_t> fields;
+    fields[datum_string_t("counter")] = ql::datum_t(1.0);
+    fields[datum_string_t("nested")] = ql::datum_t(std::move(nested));
+    const std::string serialized = serialize_datum_to_string(
+        ql::datum_t(std::move(fields)));
+    counted_t<shared_buf_t> buf = shared_buf_t::create(serialized.size());
+    memcpy(buf->data(), serialized.data(), serialized.size());
+    const ql::datum_t old_row
+        = ql::datum_deserialize_from_buf(shared_buf_ref_t<char>(buf, 0), 0);
+
+    std::map<datum_string_t, ql::datum_t> new_fields;
+    for (size_t i = 0; i < old_row.obj_size(); ++i) {
+        new_fields.insert(old_row.get_pair(i));
+    }
+    new_fields[datum_string_t("counter")] = ql::datum_t(2.0);
+    const ql::datum_t new_row(std::move(new_fields));
+    ASSERT_TRUE(new_row.get_field("nested").get_buf_ref() != nullptr);
+
+    EXPECT_EQ(serialize_datum_to_string_checked(new_row, nullptr),
+              serialize_datum_to_string_checked(new_row, buf.get()));
+}
+
+TEST(DatumTest, PersistentArrayAppend) {
+    const ql::configured_limits_t &limits = ql::configured_limits_t::unlimited;
+    const size_t num_elements = 40000;
+    std::vector<ql::datum_t> versions;
+    ql::datum_t array = ql::datum_t::empty_array();
+    for (size_t i = 0; i < num_elements; ++i) {
+        array = array.append(ql::datum_t(static_cast<double>(i)), limits);
+        if (i % 997 == 0) {
+            versions.push_back(array);
+        }
+    }
+
+    ASSERT_EQ(num_elements, array.arr_size());
+    for (size_t i = 0; i < num_elements; ++i) {
+        ASSERT_EQ(static_cast<double>(i), array.get(i).as_num());
+    }
+
+    // Appending to an older version leaves the later ones alone.
+    ql::datum_t branch = versions[5].append(ql::datum_t("branch"), limits);
+    EXPECT_EQ(versions[5].arr_size() + 1, branch.arr_size());
+    EXPECT_EQ("branch", branch.get(branch.arr_size() - 1).as_str().to_std());
+    for (size_t v = 0; v < versions.size(); ++v) {
+        ASSERT_EQ(v * 997 + 1, versions[v].arr_size());
+        ASSERT_EQ(static_cast<double>(v * 997), versions[v].get(v * 997).as_num());
+    }
+
+    // The persistent representation is invisible to comparisons and serialization.
+    std::vector<ql::datum_t> copy;
+    for (size_t i = 0; i < num_elements; ++i) {
+        copy.push_back(ql::datum_t(static_cast<double>(i)));
+    }
+    EXPECT_EQ(ql::datum_t(std::move(copy), limits), array);
+    test_datum_serialization(array);
+}
+
 }  // namespace unittest
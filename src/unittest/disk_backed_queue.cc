@@ -74,6 +74,43 @@ TEST(DiskBackedQueue, BigVals) {
     unittest::run_in_thread_pool(&run_big_values_test, 2);
 }
 
+/* Pops some of the values while the rest are still being pushed, and lets the queue
+run empty in between, which makes it start over at the beginning of its file. */
+void run_interleaved_test() {
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+
+    const serializer_filepath_t serializer_path = dbq_serializer_path();
+
+    disk_backed_queue_t<std::string> queue(&io_backender, serializer_path, &get_global_perfmon_collection());
+    std::queue<std::string> ref_queue;
+
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 2000; ++i) {
+            std::string val(randint(2 * KILOBYTE), 'a' + i % 26);
+            queue.push(val);
+            ref_queue.push(val);
+            if (i % 3 == 0) {
+                std::string x;
+                queue.pop(&x);
+                EXPECT_EQ(ref_queue.front(), x);
+                ref_queue.pop();
+            }
+        }
+        while (!ref_queue.empty()) {
+            EXPECT_FALSE(queue.empty());
+            std::string x;
+            queue.pop(&x);
+            EXPECT_EQ(ref_queue.front(), x);
+            ref_queue.pop();
+        }
+        EXPECT_TRUE(queue.empty());
+    }
+}
+
+TEST(DiskBackedQueue, Interleaved) {
+    unittest::run_in_thread_pool(&run_interleaved_test, 2);
+}
+
 static void randomly_delay(int, signal_t *) {
     nap(randint(100));
 }
@@ -0,0 +1,84 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <sys/uio.h>
+
+#include <set>
+#include <vector>
+
+#include "arch/io/disk/merging.hpp"
+#include "concurrency/queue/unlimited_fifo.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+#if USE_WRITEV
+
+class merging_test_t {
+public:
+    merging_test_t() : merger(&stats, &queue) {
+        merger.done_fun = [this](accounting_payload_t *a) { done.insert(a); };
+    }
+
+    accounting_payload_t *add_read(int64_t offset, size_t count,
+                                   bool is_write = false) {
+        actions.push_back(make_scoped<accounting_payload_t>());
+        accounting_payload_t *a = actions.back().get();
+        buffers.push_back(std::vector<char>(count));
+        if (is_write) {
+            a->make_write(0, buffers.back().data(), count, offset, false);
+        } else {
+            a->make_read(0, buffers.back().data(), count, offset);
+        }
+        queue.push(a);
+        return a;
+    }
+
+    perfmon_collection_t stats;
+    unlimited_fifo_queue_t<accounting_payload_t *> queue;
+    merging_diskmgr_t merger;
+    std::vector<scoped_ptr_t<accounting_payload_t> > actions;
+    std::vector<std::vector<char> > buffers;
+    std::set<accounting_payload_t *> done;
+};
+
+TPTEST(DiskReadMerging, MergesAdjacentReads) {
+    merging_test_t test;
+    accounting_payload_t *r1 = test.add_read(8192, 4096);
+    accounting_payload_t *w = test.add_read(4096, 4096, true);
+    accounting_payload_t *r2 = test.add_read(12288 + DEVICE_BLOCK_SIZE, 4096);
+    accounting_payload_t *r3 = test.add_read(4096, 4096);
+    accounting_payload_t *far = test.add_read(100 * MEGABYTE, 4096);
+
+    // The reads at 4096, 8192 and 12288 + DEVICE_BLOCK_SIZE become one, with a gap
+    // before the last of them.
+    ASSERT_TRUE(test.merger.producer->available->get());
+    accounting_payload_t *merged = test.merger.producer->pop();
+    EXPECT_TRUE(merged->get_is_read());
+    EXPECT_EQ(4096, merged->get_offset());
+    EXPECT_EQ(static_cast<size_t>(8192 + DEVICE_BLOCK_SIZE + 4096), merged->get_count());
+    iovec *vecs;
+    size_t vecs_len;
+    merged->get_bufs(&vecs, &vecs_len);
+    ASSERT_EQ(4u, vecs_len);
+    EXPECT_EQ(test.buffers[3].data(), vecs[0].iov_base);
+    EXPECT_EQ(test.buffers[0].data(), vecs[1].iov_base);
+    EXPECT_EQ(static_cast<size_t>(DEVICE_BLOCK_SIZE), vecs[2].iov_len);
+    EXPECT_EQ(test.buffers[2].data(), vecs[3].iov_base);
+
+    // The others keep their order.
+    EXPECT_EQ(w, test.merger.producer->pop());
+    EXPECT_EQ(far, test.merger.producer->pop());
+    EXPECT_FALSE(test.merger.producer->available->get());
+
+    merged->set_successful_due_to_conflict();
+    test.merger.done(merged);
+    EXPECT_EQ(3u, test.done.size());
+    for (accounting_payload_t *r : {r1, r2, r3}) {
+        EXPECT_EQ(1u, test.done.count(r));
+        EXPECT_TRUE(r->get_succeeded());
+    }
+}
+
+#endif  // USE_WRITEV
+
+}  // namespace unittest
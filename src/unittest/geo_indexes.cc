@@ -157,7 +157,8 @@ void insert_data(namespace_interface_t *nsi,
 void prepare_namespace(namespace_interface_t *nsi,
                        order_source_t *osource,
                        const std::vector<scoped_ptr_t<store_t> > *stores,
-                       const std::vector<datum_t> &data) {
+                       const std::vector<datum_t> &data,
+                       const geo_covering_t &geo_covering = geo_covering_t()) {
     // Create an index
     std::string index_id = "geo";
 
@@ -169,7 +170,8 @@ void prepare_namespace(namespace_interface_t *nsi,
         ql::map_wire_func_t(mapping, make_vector(arg)),
         reql_version_t::LATEST,
         sindex_multi_bool_t::SINGLE,
-        sindex_geo_bool_t::GEO);
+        sindex_geo_bool_t::GEO,
+        geo_covering);
 
     cond_t non_interruptor;
     for (const auto &store : *stores) {
@@ -431,7 +433,8 @@ void test_get_intersecting(const datum_t &query_geometry,
 void run_get_intersecting_test(
         namespace_interface_t *nsi,
         order_source_t *osource,
-        const std::vector<scoped_ptr_t<store_t> > *stores) {
+        const std::vector<scoped_ptr_t<store_t> > *stores,
+        const geo_covering_t &geo_covering = geo_covering_t()) {
     // To reproduce a known failure: initialize the rng seed manually.
     const int rng_seed = randint(INT_MAX);
     debugf("Using RNG seed %i\n", rng_seed);
@@ -439,7 +442,7 @@ void run_get_intersecting_test(
 
     const size_t num_docs = 500;
     std::vector<datum_t> data = generate_data(num_docs, &rng);
-    prepare_namespace(nsi, osource, stores, data);
+    prepare_namespace(nsi, osource, stores, data, geo_covering);
 
     try {
         const int num_point_runs = 10;
@@ -470,7 +473,26 @@ TPTEST(GeoIndexes, GetNearest) {
 
 // Test that `get_intersecting` results agree with `intersects`
 TPTEST(GeoIndexes, GetIntersecting) {
-    run_with_namespace_interface(&run_get_intersecting_test);
+    run_with_namespace_interface(
+        [](namespace_interface_t *nsi,
+           order_source_t *osource,
+           const std::vector<scoped_ptr_t<store_t> > *stores) {
+            run_get_intersecting_test(nsi, osource, stores);
+        });
+}
+
+// Test that an index with fewer and coarser cells than usual still finds everything
+TPTEST(GeoIndexes, GetIntersectingCustomCovering) {
+    geo_covering_t geo_covering;
+    geo_covering.max_cells = 4;
+    geo_covering.min_level = 2;
+    geo_covering.max_level = 12;
+    run_with_namespace_interface(
+        [&](namespace_interface_t *nsi,
+            order_source_t *osource,
+            const std::vector<scoped_ptr_t<store_t> > *stores) {
+            run_get_intersecting_test(nsi, osource, stores, geo_covering);
+        });
 }
 
 } /* namespace unittest */
@@ -0,0 +1,35 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string>
+
+#include "config/args.hpp"
+#include "rdb_protocol/hot_keys.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+TEST(HotKeysTest, FindsHotKeys) {
+    hot_keys_t hot_keys;
+    EXPECT_TRUE(hot_keys.top().empty());
+
+    // A few hot keys in a stream of many cold ones
+    for (int i = 0; i < 20000; ++i) {
+        hot_keys.add(strprintf("cold %d", i));
+        if (i % 10 == 0) {
+            hot_keys.add("hot a");
+        }
+        if (i % 20 == 0) {
+            hot_keys.add("hot b");
+        }
+    }
+    auto top = hot_keys.top();
+    ASSERT_LE(top.size(), static_cast<size_t>(HOT_KEYS_TRACKED));
+    ASSERT_GE(top.size(), 2u);
+    EXPECT_EQ("hot a", top[0].first);
+    EXPECT_EQ("hot b", top[1].first);
+    // The sketch only ever over-estimates.
+    EXPECT_GE(top[0].second, 2000u);
+    EXPECT_GE(top[1].second, 1000u);
+}
+
+}  // namespace unittest
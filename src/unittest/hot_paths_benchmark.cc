@@ -0,0 +1,190 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "containers/archive/string_stream.hpp"
+#include "containers/scoped.hpp"
+#include "containers/shared_buffer.hpp"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "repli_timestamp.hpp"
+#include "unittest/btree_utils.hpp"
+#include "unittest/gtest.hpp"
+
+// Micro-benchmarks for some of the storage and query hot paths, so that regressions
+// in them can be found without going through a whole server.  The inputs are
+// deterministic.  Besides printing the results, every benchmark records its rate as
+// an `ops_per_sec` property, which ends up in the XML report when the unit tests are
+// run with `--gtest_output=xml`.  No need to run these in debug mode.
+#ifdef NDEBUG
+
+namespace unittest {
+
+void report_benchmark(const char *name, int64_t num_ops, ticks_t duration) {
+    const double secs = ticks_to_secs(duration);
+    const double ops_per_sec = num_ops / secs;
+    printf("%s: %" PRIi64 " ops in %f s (%f ops/s)\n", name, num_ops, secs, ops_per_sec);
+    ::testing::Test::RecordProperty(strprintf("%s_ops_per_sec", name),
+                                    static_cast<int>(ops_per_sec));
+}
+
+ql::datum_t make_benchmark_document(int i) {
+    std::string json = strprintf(
+        "{\"id\": %d, \"name\": \"user %d\", \"score\": %f,"
+        " \"tags\": [\"a\", \"b\", \"c\"], \"active\": true,"
+        " \"address\": {\"city\": \"city %d\", \"zip\": \"%05d\"}}",
+        i, i, i * 0.37, i % 100, i % 100000);
+    rapidjson::Document doc;
+    doc.Parse(json.c_str());
+    guarantee(!doc.HasParseError());
+    return ql::to_datum(doc, ql::configured_limits_t::unlimited,
+                        reql_version_t::LATEST);
+}
+
+std::vector<ql::datum_t> make_benchmark_documents(int count) {
+    std::vector<ql::datum_t> docs;
+    docs.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        docs.push_back(make_benchmark_document(i));
+    }
+    return docs;
+}
+
+TEST(HotPathsBenchmark, LeafInsertLookup) {
+    const max_block_size_t bs = max_block_size_t::unsafe_make(4096);
+    short_value_sizer_t sizer(bs);
+    scoped_malloc_t<leaf_node_t> node(bs.value());
+    const short_value_buffer_t value(std::string(20, 'v'));
+
+    const int NUM_ROUNDS = 20000;
+    int64_t num_inserts = 0;
+    int64_t num_lookups = 0;
+    ticks_t insert_ticks = 0;
+    ticks_t lookup_ticks = 0;
+    for (int round = 0; round < NUM_ROUNDS; ++round) {
+        leaf::init(&sizer, node.get());
+        std::vector<store_key_t> keys;
+
+        // Insert the keys in a scrambled but deterministic order until the node
+        // is full.
+        ticks_t start_ticks = get_ticks();
+        for (int i = 0; ; ++i) {
+            store_key_t key(strprintf("key%08d", (i * 7919) % 100000));
+            short_value_buffer_t v(value);
+            if (leaf::is_full(&sizer, node.get(), key.btree_key(), v.data())) {
+                break;
+            }
+            leaf::insert(&sizer, node.get(), key.btree_key(), v.data(),
+                         repli_timestamp_t::distant_past, repli_timestamp_t::distant_past,
+                         key_modification_proof_t::real_proof());
+            keys.push_back(key);
+        }
+        insert_ticks += get_ticks() - start_ticks;
+        num_inserts += keys.size();
+
+        start_ticks = get_ticks();
+        for (const store_key_t &key : keys) {
+            short_value_buffer_t v(value);
+            ASSERT_TRUE(leaf::lookup(&sizer, node.get(), key.btree_key(), v.data()));
+        }
+        lookup_ticks += get_ticks() - start_ticks;
+        num_lookups += keys.size();
+    }
+
+    report_benchmark("leaf_insert", num_inserts, insert_ticks);
+    report_benchmark("leaf_lookup", num_lookups, lookup_ticks);
+}
+
+TEST(HotPathsBenchmark, DatumSerialization) {
+    const std::vector<ql::datum_t> docs = make_benchmark_documents(10000);
+    const int NUM_REPETITIONS = 20;
+
+    std::vector<std::string> serialized(docs.size());
+    ticks_t start_ticks = get_ticks();
+    for (int rep = 0; rep < NUM_REPETITIONS; ++rep) {
+        for (size_t i = 0; i < docs.size(); ++i) {
+            string_stream_t stream;
+            write_message_t wm;
+            ql::datum_serialize(&wm, docs[i],
+                                ql::check_datum_serialization_errors_t::NO);
+            ASSERT_EQ(0, send_write_message(&stream, &wm));
+            serialized[i] = std::move(stream.str());
+        }
+    }
+    report_benchmark("datum_serialize", NUM_REPETITIONS * docs.size(),
+                     get_ticks() - start_ticks);
+
+    std::vector<counted_t<const shared_buf_t> > bufs;
+    for (const std::string &s : serialized) {
+        counted_t<shared_buf_t> buf = shared_buf_t::create(s.size());
+        memcpy(buf->data(), s.data(), s.size());
+        bufs.push_back(std::move(buf));
+    }
+
+    start_ticks = get_ticks();
+    for (int rep = 0; rep < NUM_REPETITIONS; ++rep) {
+        for (size_t i = 0; i < bufs.size(); ++i) {
+            ql::datum_t datum
+                = ql::datum_deserialize_from_buf(shared_buf_ref_t<char>(bufs[i], 0), 0);
+            // Objects are read lazily from the buffer, so access a field to make
+            // this do some actual work.
+            ASSERT_TRUE(datum.get_field("score", ql::NOTHROW).has());
+        }
+    }
+    report_benchmark("datum_deserialize_from_buf", NUM_REPETITIONS * bufs.size(),
+                     get_ticks() - start_ticks);
+}
+
+TEST(HotPathsBenchmark, DatumCmp) {
+    const std::vector<ql::datum_t> docs = make_benchmark_documents(1000);
+    const int NUM_REPETITIONS = 20;
+
+    int64_t num_ops = 0;
+    int64_t num_less = 0;
+    ticks_t start_ticks = get_ticks();
+    for (int rep = 0; rep < NUM_REPETITIONS; ++rep) {
+        for (size_t i = 0; i < docs.size(); ++i) {
+            for (size_t j = 0; j < docs.size(); j += 10) {
+                if (docs[i].cmp(docs[j]) < 0) {
+                    ++num_less;
+                }
+                ++num_ops;
+            }
+        }
+    }
+    report_benchmark("datum_cmp", num_ops, get_ticks() - start_ticks);
+    EXPECT_LT(0, num_less);
+}
+
+TEST(HotPathsBenchmark, DatumJsonEncoding) {
+    const std::vector<ql::datum_t> docs = make_benchmark_documents(10000);
+    const int NUM_REPETITIONS = 20;
+
+    size_t num_bytes = 0;
+    ticks_t start_ticks = get_ticks();
+    for (int rep = 0; rep < NUM_REPETITIONS; ++rep) {
+        for (const ql::datum_t &doc : docs) {
+            rapidjson::StringBuffer buffer;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            doc.write_json(&writer);
+            num_bytes += buffer.GetSize();
+        }
+    }
+    report_benchmark("datum_write_json", NUM_REPETITIONS * docs.size(),
+                     get_ticks() - start_ticks);
+    EXPECT_LT(0u, num_bytes);
+}
+
+}  // namespace unittest
+
+#endif  // NDEBUG
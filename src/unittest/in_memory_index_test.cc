@@ -0,0 +1,64 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "serializer/log/lba/in_memory_index.hpp"
+
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+repli_timestamp_t make_recency(uint64_t longtime) {
+    repli_timestamp_t ret;
+    ret.longtime = longtime;
+    return ret;
+}
+
+index_block_info_t make_info(int64_t offset, repli_timestamp_t recency) {
+    return index_block_info_t(flagged_off64_t::make(offset), recency, 4096, 0);
+}
+
+TEST(InMemoryIndexTest, PackedRoundTrip) {
+    packed_block_info_array_t array;
+    ASSERT_EQ(index_block_info_t(), array.get(12345));
+
+    // Uniform recencies, then deltas, then recencies too far apart for deltas.
+    array.set(3, make_info(1 << 20, make_recency(1000)));
+    array.set(4, make_info(5ll << 40, make_recency(1000)));
+    array.set(5, make_info(7, make_recency(1001)));
+    array.set(6, make_info(8192, make_recency(10)));
+    array.set(7, make_info(16384, repli_timestamp_t::invalid));
+    array.set(100000, make_info(4096, make_recency(1)));
+    ASSERT_EQ(make_info(1 << 20, make_recency(1000)), array.get(3));
+    ASSERT_EQ(make_info(5ll << 40, make_recency(1000)), array.get(4));
+    ASSERT_EQ(make_info(7, make_recency(1001)), array.get(5));
+    ASSERT_EQ(make_info(8192, make_recency(10)), array.get(6));
+    ASSERT_EQ(make_info(16384, repli_timestamp_t::invalid), array.get(7));
+    ASSERT_EQ(make_info(4096, make_recency(1)), array.get(100000));
+
+    array.set(8, make_info(0, make_recency(UINT64_C(1) << 40)));
+    ASSERT_EQ(make_info(0, make_recency(UINT64_C(1) << 40)), array.get(8));
+    ASSERT_EQ(make_info(7, make_recency(1001)), array.get(5));
+    ASSERT_EQ(make_info(16384, repli_timestamp_t::invalid), array.get(7));
+
+    // Deleted blocks and unused offsets.
+    index_block_info_t deleted(flagged_off64_t::unused(), make_recency(5), 0, 0);
+    array.set(4, deleted);
+    ASSERT_EQ(deleted, array.get(4));
+}
+
+TEST(InMemoryIndexTest, PackedMemoryUsage) {
+    packed_block_info_array_t array;
+    for (size_t i = 0; i < 100; ++i) {
+        array.set(i * 7, make_info(i * 4096, make_recency(42)));
+    }
+    const size_t uniform_usage = array.memory_usage();
+    ASSERT_GT(uniform_usage, 0u);
+    // Each entry should take up much less than a full `index_block_info_t`.
+    ASSERT_LT(uniform_usage / (1 << 14), sizeof(index_block_info_t));
+
+    for (size_t i = 0; i < 100; ++i) {
+        array.set(i * 7, index_block_info_t());
+    }
+    ASSERT_EQ(index_block_info_t(), array.get(7));
+    ASSERT_LT(array.memory_usage(), uniform_usage);
+}
+
+}  // namespace unittest
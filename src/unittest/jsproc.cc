@@ -117,6 +117,38 @@ SPAWNER_TEST(JSProc, EvalAndCall) {
     ASSERT_EQ(res_datum->as_int(), 10337);
 }
 
+SPAWNER_TEST(JSProc, CallBatch) {
+    extproc_pool_t extproc_pool(1);
+    js_runner_t js_runner;
+    ql::configured_limits_t limits;
+
+    js_runner.begin(&extproc_pool, nullptr, limits);
+
+    const std::string source_code =
+        "(function (x) { if (x == 3) { throw 'three'; } return x * 2; })";
+
+    std::vector<ql::datum_t> rows;
+    for (int i = 0; i < 5; ++i) {
+        rows.push_back(ql::datum_t(static_cast<double>(i)));
+    }
+
+    js_runner_t::req_config_t config;
+    config.timeout_ms = 10000;
+    std::vector<js_result_t> results = js_runner.call_batch(source_code, rows, config);
+    ASSERT_TRUE(js_runner.connected());
+
+    // The results stop with the row that threw.
+    ASSERT_EQ(4u, results.size());
+    for (size_t i = 0; i < 3; ++i) {
+        ql::datum_t *res_datum = boost::get<ql::datum_t>(&results[i]);
+        ASSERT_TRUE(res_datum != nullptr);
+        ASSERT_EQ(static_cast<int64_t>(i * 2), res_datum->as_int());
+    }
+    std::string *error = boost::get<std::string>(&results[3]);
+    ASSERT_TRUE(error != nullptr);
+    ASSERT_EQ("three", *error);
+}
+
 SPAWNER_TEST(JSProc, BrokenFunction) {
     extproc_pool_t extproc_pool(1);
     js_runner_t js_runner;
@@ -130,25 +130,28 @@ public:
 
         if (can_level) {
             ASSERT_TRUE(!sibling->kv_.empty());
+            // The replacement key separates the two nodes, but it need not be one of
+            // their keys.
             if (nodecmp_value < 0) {
-                // Copy keys from front of sibling until and including replacement key.
+                // Copy keys from front of sibling up to and including the replacement
+                // key.
 
                 std::map<store_key_t, std::string>::iterator p = sibling->kv_.begin();
-                while (p != sibling->kv_.end() && p->first < replacement) {
+                ASSERT_TRUE(p != sibling->kv_.end() && p->first <= replacement);
+                while (p != sibling->kv_.end() && p->first <= replacement) {
                     kv_[p->first] = p->second;
                     std::map<store_key_t, std::string>::iterator prev = p;
                     ++p;
                     sibling->kv_.erase(prev);
                 }
                 ASSERT_TRUE(p != sibling->kv_.end());
-                ASSERT_EQ(key_to_unescaped_str(p->first), key_to_unescaped_str(replacement));
-                kv_[p->first] = p->second;
-                sibling->kv_.erase(p);
             } else {
-                // Copy keys from end of sibling until but not including replacement key.
+                // Copy keys from end of sibling that are greater than the replacement
+                // key.
 
                 std::map<store_key_t, std::string>::iterator p = sibling->kv_.end();
                 --p;
+                ASSERT_TRUE(p->first > replacement);
                 while (p != sibling->kv_.begin() && p->first > replacement) {
                     kv_[p->first] = p->second;
                     std::map<store_key_t, std::string>::iterator prev = p;
@@ -156,7 +159,7 @@ public:
                     sibling->kv_.erase(prev);
                 }
 
-                ASSERT_EQ(key_to_unescaped_str(p->first), key_to_unescaped_str(replacement));
+                ASSERT_TRUE(p->first <= replacement);
             }
         }
 
@@ -166,13 +169,16 @@ public:
         sibling->Verify();
     }
 
-    void Split(LeafNodeTracker *right) {
+    void Split(LeafNodeTracker *right, store_key_t *median_out = nullptr) {
         ASSERT_EQ(bs_.ser_value(), right->bs_.ser_value());
 
         ASSERT_TRUE(leaf::is_empty(right->node()));
 
         store_key_t median;
         leaf::split(&sizer_, node(), right->node(), median.btree_key());
+        if (median_out != nullptr) {
+            *median_out = median;
+        }
 
         std::map<store_key_t, std::string>::iterator p = kv_.end();
         --p;
@@ -185,6 +191,21 @@ public:
         right->Verify();
     }
 
+    void SplitForAppend(LeafNodeTracker *right, const store_key_t &next_key) {
+        ASSERT_EQ(bs_.ser_value(), right->bs_.ser_value());
+
+        ASSERT_TRUE(leaf::is_empty(right->node()));
+        ASSERT_TRUE(leaf::is_past_last_key(node(), next_key.btree_key()));
+
+        store_key_t median;
+        leaf::split_for_append(&sizer_, node(), right->node(), median.btree_key());
+        ASSERT_EQ(kv_.rbegin()->first, median);
+        ASSERT_LT(median, next_key);
+
+        Verify();
+        right->Verify();
+    }
+
     bool IsFull(const store_key_t& key, const std::string& value) {
         short_value_buffer_t value_buf(value);
         return leaf::is_full(&sizer_, node(), key.btree_key(), value_buf.data());
@@ -701,6 +722,50 @@ TEST(LeafNodeTest, Splitting) {
     left.Split(&right);
 }
 
+TEST(LeafNodeTest, SplittingShortensSeparator) {
+    // Keys with a long common prefix, like those of a secondary index.
+    const std::string prefix(100, 'x');
+    LeafNodeTracker left;
+    for (int i = 0; ; ++i) {
+        store_key_t key(prefix + strprintf("%05d", i * 10));
+        std::string value = strprintf("A%d", i);
+        if (left.IsFull(key, value)) {
+            break;
+        }
+        left.Insert(key, value);
+    }
+
+    LeafNodeTracker right;
+    store_key_t median;
+    left.Split(&right, &median);
+
+    // The separator only needs to go one byte past the common prefix of the keys
+    // on either side of the split.
+    ASSERT_LT(median.size(), static_cast<int>(prefix.size()) + 5);
+}
+
+TEST(LeafNodeTest, SplittingForAppend) {
+    LeafNodeTracker left;
+    int i;
+    for (i = 0; ; ++i) {
+        store_key_t key(strprintf("a%05d", i));
+        std::string value = strprintf("A%d", i);
+        if (left.IsFull(key, value)) {
+            break;
+        }
+        left.Insert(key, value);
+    }
+    ASSERT_FALSE(left.IsUnderfull());
+
+    // The full leaf keeps all of its entries, and the next key in the sequence
+    // starts the right one.
+    LeafNodeTracker right;
+    store_key_t next_key(strprintf("a%05d", i));
+    left.SplitForAppend(&right, next_key);
+    ASSERT_FALSE(left.IsUnderfull());
+    ASSERT_TRUE(right.Insert(next_key, strprintf("A%d", i)));
+}
+
 TEST(LeafNodeTest, Fullness) {
     LeafNodeTracker node;
     int i;
@@ -1,3 +1,5 @@
+#include <string>
+
 #include "unittest/gtest.hpp"
 
 #include "containers/lru_cache.hpp"
@@ -65,4 +67,17 @@ TEST(LRUCacheTest, Find) {
     EXPECT_EQ(10, cache.rbegin()->first);
 }
 
+TEST(LRUCacheTest, MovableKeys) {
+    lru_cache_t<std::string, int> cache(2);
+    cache[std::string("a")] = 1;
+    cache[std::string("b")] = 2;
+    ASSERT_NE(cache.end(), cache.find("a"));
+    EXPECT_EQ(1, cache.find("a")->second);
+    cache[std::string("c")] = 3;
+    EXPECT_EQ(2, cache.size());
+    EXPECT_EQ(cache.end(), cache.find("b"));
+    ASSERT_NE(cache.end(), cache.find("c"));
+    EXPECT_EQ(3, cache.find("c")->second);
+}
+
 } // namespace unittest
@@ -32,11 +32,21 @@ public:
     void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
                       file_account_t *account, linux_iocallback_t *cb);
 
-    void *create_account(UNUSED int priority, UNUSED int outstanding_requests_limit) {
+    bool read_mapped(UNUSED int64_t offset, UNUSED size_t length, UNUSED void *buf) {
+        return false;
+    }
+
+    void *create_account(UNUSED int priority, UNUSED int outstanding_requests_limit,
+                         UNUSED const char *io_class) {
         // We don't care about accounts.  Return an arbitrary non-null pointer.
         return this;
     }
 
+    void set_io_latency_stats(UNUSED perfmon_keyed_latency_t *queue_latency,
+                              UNUSED perfmon_keyed_latency_t *service_latency) {
+        /* do nothing */
+    }
+
     void destroy_account(UNUSED void *account) {
         /* do nothing */
     }
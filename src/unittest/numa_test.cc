@@ -0,0 +1,33 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/numa.hpp"
+
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(NumaTest, ParseCpuList) {
+    std::vector<int> cpus;
+    ASSERT_TRUE(parse_cpu_list("0-3,8,10-11\n", &cpus));
+    ASSERT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}), cpus);
+    ASSERT_TRUE(parse_cpu_list("5", &cpus));
+    ASSERT_EQ(std::vector<int>({5}), cpus);
+    ASSERT_TRUE(parse_cpu_list("\n", &cpus));
+    ASSERT_TRUE(cpus.empty());
+    ASSERT_FALSE(parse_cpu_list("3-1", &cpus));
+    ASSERT_FALSE(parse_cpu_list("1,a", &cpus));
+}
+
+TEST(NumaTest, AssignThreads) {
+    const std::vector<std::vector<int> > node_cpus({{0, 1, 2, 3}, {4, 5, 6, 7}});
+    std::vector<int> cpus, nodes;
+    assign_threads_to_cpus(node_cpus, 4, &cpus, &nodes);
+    ASSERT_EQ(std::vector<int>({0, 1, 4, 5}), cpus);
+    ASSERT_EQ(std::vector<int>({0, 0, 1, 1}), nodes);
+
+    // More threads than CPUs wrap around within each node.
+    assign_threads_to_cpus(node_cpus, 12, &cpus, &nodes);
+    ASSERT_EQ(std::vector<int>({0, 1, 2, 3, 0, 1, 4, 5, 6, 7, 4, 5}), cpus);
+    ASSERT_EQ(std::vector<int>({0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1}), nodes);
+}
+
+}  // namespace unittest
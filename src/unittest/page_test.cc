@@ -314,6 +314,45 @@ TPTEST(PageTest, WriteWaitForFlush, 4) {
     pmap(2, std::bind(&WriteWaitForFlush_cases, &s, &page_cache, ph::_1));
 }
 
+// A snapshotted reader that still holds the version of a page that a write replaced
+// keeps it around, and the evicter counts it until the reader is gone.
+TPTEST(PageTest, SnapshotRetainedSize, 4) {
+    mock_ser_t mock;
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    block_id_t block_id;
+    {
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        {
+            current_test_acq_t acq(txn.get(), alt_create_t::create);
+            block_id = acq.block_id();
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            page_acq.get_buf_write();
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    auto snapshot = make_scoped<current_test_acq_t>(
+        &page_cache, block_id, read_access_t::read);
+    snapshot->declare_snapshotted();
+    snapshot->read_acq_signal()->wait();
+    EXPECT_EQ(0u, page_cache.evicter().snapshot_retained_size());
+
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    {
+        current_test_acq_t acq(txn.get(), block_id, access_t::write);
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_write(), &page_cache);
+        page_acq.get_buf_write();
+    }
+    page_cache.flush(std::move(txn));
+    EXPECT_LT(0u, page_cache.evicter().snapshot_retained_size());
+
+    snapshot.reset();
+    EXPECT_EQ(0u, page_cache.evicter().snapshot_retained_size());
+}
+
 class bigger_test_t {
 public:
     explicit bigger_test_t(uint64_t _memory_limit)
@@ -0,0 +1,89 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "rapidjson/document.h"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/error.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+ql::datum_t parse_with_document(const std::string &json) {
+    std::vector<char> buf(json.c_str(), json.c_str() + json.size() + 1);
+    rapidjson::Document doc;
+    doc.ParseInsitu(buf.data());
+    guarantee(!doc.HasParseError());
+    return ql::to_datum(doc, ql::configured_limits_t::unlimited,
+                        reql_version_t::LATEST);
+}
+
+bool parse_directly(const std::string &json, ql::datum_t *datum_out) {
+    std::vector<char> buf(json.c_str(), json.c_str() + json.size() + 1);
+    rapidjson::ParseErrorCode error;
+    return ql::parse_json_to_datum(buf.data(), ql::configured_limits_t::unlimited,
+                                   datum_out, &error);
+}
+
+TEST(ParseJsonTest, MatchesDocument) {
+    const std::vector<std::string> inputs = {
+        "null", "true", "-0", "12345678901234567890", "1.5e300", "\"str\\u00e9\"",
+        "[]", "{}", "  [1, [2, [3, {\"a\": [null, false]}]], -4.25]  ",
+        "{\"b\": 1, \"a\": {\"$reql_type$\": \"TIME\", \"epoch_time\": 1,"
+        " \"timezone\": \"+00:00\"}, \"c\": [\"x\", \"y\"]}"};
+    for (const std::string &input : inputs) {
+        ql::datum_t datum;
+        ASSERT_TRUE(parse_directly(input, &datum)) << input;
+        EXPECT_EQ(parse_with_document(input), datum) << input;
+    }
+
+    ql::datum_t datum;
+    EXPECT_FALSE(parse_directly("[1, 2", &datum));
+    EXPECT_FALSE(parse_directly("{\"a\": }", &datum));
+    EXPECT_FALSE(parse_directly("1 2", &datum));
+    EXPECT_THROW(parse_directly("{\"a\": 1, \"a\": 2}", &datum), ql::base_exc_t);
+    EXPECT_THROW(parse_directly("\"\xff\"", &datum), ql::base_exc_t);
+}
+
+// Compares the speed of `parse_json_to_datum` with parsing into a `rapidjson::Document`
+// first, for a document that looks like a bulk insert.  No need to run this in debug
+// mode.
+#ifdef NDEBUG
+TEST(ParseJsonTest, Benchmark) {
+    std::string json = "[";
+    for (int i = 0; i < 100000; ++i) {
+        json += strprintf(
+            "%s{\"id\": %d, \"name\": \"user %d\", \"score\": %f,"
+            " \"tags\": [\"a\", \"b\", \"c\"], \"active\": true}",
+            i == 0 ? "" : ",\n  ", i, i, i * 0.37);
+    }
+    json += "]";
+
+    const int NUM_REPETITIONS = 5;
+    ticks_t start_ticks = get_ticks();
+    for (int i = 0; i < NUM_REPETITIONS; ++i) {
+        ql::datum_t datum = parse_with_document(json);
+        ASSERT_EQ(100000u, datum.arr_size());
+    }
+    const double dur_document = ticks_to_secs(get_ticks() - start_ticks);
+
+    start_ticks = get_ticks();
+    for (int i = 0; i < NUM_REPETITIONS; ++i) {
+        ql::datum_t datum;
+        ASSERT_TRUE(parse_directly(json, &datum));
+        ASSERT_EQ(100000u, datum.arr_size());
+    }
+    const double dur_direct = ticks_to_secs(get_ticks() - start_ticks);
+
+    const double mb = static_cast<double>(json.size() * NUM_REPETITIONS) / MEGABYTE;
+    printf("rapidjson::Document + to_datum: %f s (%f MB/s)\n",
+           dur_document, mb / dur_document);
+    printf("parse_json_to_datum: %f s (%f MB/s)\n", dur_direct, mb / dur_direct);
+}
+#endif  // NDEBUG
+
+}  // namespace unittest
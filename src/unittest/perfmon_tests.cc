@@ -57,4 +57,31 @@ TEST(PerfmonTest, StddevComputation) {
     }
 }
 
+TEST(PerfmonTest, LatencyHistogramPercentiles) {
+    latency_histogram_t histogram;
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0u, histogram.percentile(0.5));
+
+    for (uint64_t i = 1; i <= 10000; ++i) {
+        histogram.record(i);
+    }
+    EXPECT_EQ(10000u, histogram.count());
+    EXPECT_EQ(10000u, histogram.max());
+    // Every bucket is at most an eighth of the power of two it's in wide.
+    const double fractions[] = {0.01, 0.5, 0.9, 0.99, 0.999};
+    for (double fraction : fractions) {
+        const double expected = fraction * 10000;
+        const double actual = histogram.percentile(fraction);
+        EXPECT_LE(expected, actual) << fraction;
+        EXPECT_GE(expected * 1.125, actual) << fraction;
+    }
+    EXPECT_EQ(10000u, histogram.percentile(1.0));
+
+    latency_histogram_t other;
+    other.record(latency_histogram_t::MAX_VALUE + 1000);
+    histogram.merge(other);
+    EXPECT_EQ(10001u, histogram.count());
+    EXPECT_EQ(latency_histogram_t::MAX_VALUE, histogram.percentile(1.0));
+}
+
 }  // namespace unittest
@@ -0,0 +1,57 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/point_read_cache.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST_MULTITHREAD(PointReadCacheTest, FillAndInvalidate, 2) {
+    const uint64_t size = 2 * get_num_threads();
+    ql::point_read_cache_t cache(size);
+    ASSERT_TRUE(cache.is_enabled());
+    const namespace_id_t table = generate_uuid();
+    const store_key_t a("a"), b("b"), c("c");
+    ql::datum_t value;
+
+    // Nothing gets cached before the table is watched.
+    ql::point_read_cache_t::ticket_t ticket = cache.start_fill(a);
+    cache.put(table, a, ticket, ql::datum_t(1.0));
+    EXPECT_FALSE(cache.get(table, a, &value));
+
+    ticket = cache.start_fill(a);
+    EXPECT_FALSE(cache.is_watched(table));
+    cache.set_watched(table, ticket);
+    ASSERT_TRUE(cache.is_watched(table));
+    cache.put(table, a, ticket, ql::datum_t(1.0));
+    ASSERT_TRUE(cache.get(table, a, &value));
+    EXPECT_EQ(ql::datum_t(1.0), value);
+
+    // A change that arrives while a read is running keeps it out of the cache.
+    ticket = cache.start_fill(b);
+    cache.invalidate(table, b);
+    cache.put(table, b, ticket, ql::datum_t(2.0));
+    EXPECT_FALSE(cache.get(table, b, &value));
+
+    cache.invalidate(table, a);
+    EXPECT_FALSE(cache.get(table, a, &value));
+
+    // Every thread keeps its share of the entries, least recently used out first.
+    cache.put(table, a, cache.start_fill(a), ql::datum_t(1.0));
+    cache.put(table, b, cache.start_fill(b), ql::datum_t(2.0));
+    EXPECT_TRUE(cache.get(table, a, &value));
+    cache.put(table, c, cache.start_fill(c), ql::datum_t(3.0));
+    EXPECT_TRUE(cache.get(table, a, &value));
+    EXPECT_FALSE(cache.get(table, b, &value));
+    EXPECT_TRUE(cache.get(table, c, &value));
+
+    // Once the table's feed goes away, its keys are gone, and a ticket from before
+    // can't mark it as watched again.
+    ticket = cache.start_fill(a);
+    cache.invalidate_table(table);
+    EXPECT_FALSE(cache.get(table, a, &value));
+    EXPECT_FALSE(cache.is_watched(table));
+    cache.set_watched(table, ticket);
+    EXPECT_FALSE(cache.is_watched(table));
+}
+
+}  // namespace unittest
@@ -0,0 +1,63 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "btree/keys.hpp"
+#include "btree/primary_key_filter.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+TEST(PrimaryKeyFilterTest, BloomFilter) {
+    const int num_keys = 10000;
+    bloom_filter_t filter(num_keys);
+    for (int i = 0; i < num_keys; ++i) {
+        filter.add(store_key_t(strprintf("present %d", i)));
+    }
+    EXPECT_FALSE(filter.is_full());
+    EXPECT_GT(filter.size(), static_cast<uint64_t>(num_keys * 0.99));
+
+    // There are no false negatives, and only a few false positives.
+    int false_positives = 0;
+    for (int i = 0; i < num_keys; ++i) {
+        EXPECT_TRUE(filter.may_contain(store_key_t(strprintf("present %d", i))));
+        if (filter.may_contain(store_key_t(strprintf("absent %d", i)))) {
+            ++false_positives;
+        }
+    }
+    EXPECT_LT(false_positives, num_keys / 50);
+}
+
+TEST(PrimaryKeyFilterTest, Rebuild) {
+    int full_calls = 0;
+    primary_key_filter_t filter([&]() { ++full_calls; });
+    const store_key_t a("a"), b("b");
+
+    // Nothing is ruled out before the first build, but the keys still get added.
+    EXPECT_TRUE(filter.may_contain(a));
+    filter.start_build(2);
+    filter.add(a);
+    EXPECT_TRUE(filter.may_contain(b));
+    ASSERT_TRUE(filter.finish_build());
+    EXPECT_TRUE(filter.may_contain(a));
+    EXPECT_FALSE(filter.may_contain(b));
+    EXPECT_EQ(1u, filter.size());
+
+    // Going over capacity asks for a bigger filter, once.
+    for (int i = 0; i < 10; ++i) {
+        filter.add(store_key_t(strprintf("more %d", i)));
+    }
+    EXPECT_EQ(1, full_calls);
+
+    // A build that turns out too small has to be started again.
+    filter.start_build(2);
+    for (int i = 0; i < 10; ++i) {
+        filter.add_scanned(store_key_t(strprintf("more %d", i)));
+    }
+    EXPECT_FALSE(filter.finish_build());
+    filter.start_build(100);
+    filter.add_scanned(a);
+    ASSERT_TRUE(filter.finish_build());
+    EXPECT_TRUE(filter.may_contain(a));
+    EXPECT_FALSE(filter.may_contain(b));
+}
+
+}  // namespace unittest
@@ -418,6 +418,7 @@ bool test_rdb_env_t::instance_t::table_create(
         UNUSED counted_t<const ql::db_t> db,
         UNUSED const table_generate_config_params_t &config_params,
         UNUSED const std::string &primary_key,
+        UNUSED key_generation_t key_generation,
         UNUSED write_durability_t durability,
         UNUSED signal_t *local_interruptor,
         UNUSED ql::datum_t *result_out,
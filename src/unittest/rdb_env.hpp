@@ -190,6 +190,7 @@ public:
                 counted_t<const ql::db_t> db,
                 const table_generate_config_params_t &config_params,
                 const std::string &primary_key,
+                key_generation_t key_generation,
                 write_durability_t durability,
                 signal_t *interruptor,
                 ql::datum_t *result_out,
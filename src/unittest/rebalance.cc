@@ -70,4 +70,28 @@ TEST(Rebalance, MaxKeyLength) {
     do_rebalance(distribution, 3);
 }
 
+TEST(Rebalance, MinimalMovement) {
+    std::map<store_key_t, int64_t> distribution;
+    for (char c = 'A'; c <= 'Z'; ++c) {
+        distribution[store_key_t(std::string(1, c))] = (c < 'M') ? 10 : 1;
+    }
+    table_shard_scheme_t old_scheme;
+    old_scheme.split_points.push_back(store_key_t("M"));
+
+    // Adding shards keeps the old split point and splits the crowded shard.
+    table_shard_scheme_t grown;
+    calculate_split_points_with_minimal_movement(distribution, 3, old_scheme, &grown);
+    ASSERT_EQ(3u, grown.num_shards());
+    EXPECT_LT(grown.split_points[0], store_key_t("M"));
+    EXPECT_EQ(store_key_t("M"), grown.split_points[1]);
+
+    // Removing shards merges the pair with the fewest documents.
+    table_shard_scheme_t three = old_scheme;
+    three.split_points.push_back(store_key_t("T"));
+    table_shard_scheme_t shrunk;
+    calculate_split_points_with_minimal_movement(distribution, 2, three, &shrunk);
+    ASSERT_EQ(2u, shrunk.num_shards());
+    EXPECT_EQ(store_key_t("M"), shrunk.split_points[0]);
+}
+
 }  // namespace unittest
@@ -14,6 +14,7 @@
 #include "unittest/clustering_utils.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "rpc/connectivity/cluster.hpp"
+#include "rpc/connectivity/failure_detector.hpp"
 #include "unittest/gtest.hpp"
 
 namespace unittest {
@@ -452,6 +453,81 @@ TPTEST_MULTITHREAD(RPCConnectivityTest, BinaryData, 3) {
     EXPECT_TRUE(a2.got_spectrum);
 }
 
+/* `Compression` sends large messages between servers with and without
+`--cluster-compression`, and makes sure that they all arrive intact.  The uncompressed
+messages are above `UNBUFFERED_WRITE_MIN_SIZE`, so they also cover unbuffered writes. */
+
+class large_message_test_application_t : public cluster_message_handler_t {
+public:
+    explicit large_message_test_application_t(connectivity_cluster_t *cm) :
+        cluster_message_handler_t(cm, 'L'),
+        got_message(false)
+        { }
+    static std::string make_message() {
+        std::string message;
+        for (int i = 0; i < 10000; ++i) {
+            message += strprintf("row %d, ", i % 100);
+        }
+        return message;
+    }
+    void send_message(peer_id_t peer) {
+        class writer_t : public cluster_send_message_write_callback_t {
+        public:
+            virtual ~writer_t() { }
+            void write(write_stream_t *stream) {
+                write_message_t wm;
+                serialize<cluster_version_t::CLUSTER>(&wm, make_message());
+                int res = send_write_message(stream, &wm);
+                if (res) { throw fake_archive_exc_t(); }
+            }
+#ifdef ENABLE_MESSAGE_PROFILER
+            const char *message_profiler_tag() const {
+                return "unittest";
+            }
+#endif
+        } writer;
+        auto_drainer_t::lock_t connection_keepalive;
+        connectivity_cluster_t::connection_t *connection =
+            get_connectivity_cluster()->get_connection(peer, &connection_keepalive);
+        ASSERT_TRUE(connection != nullptr);
+        get_connectivity_cluster()->send_message(connection, connection_keepalive,
+                                                 get_message_tag(), &writer);
+    }
+    void on_message(connectivity_cluster_t::connection_t *,
+                    auto_drainer_t::lock_t,
+                    read_stream_t *stream) {
+        std::string message;
+        archive_result_t res
+            = deserialize<cluster_version_t::CLUSTER>(stream, &message);
+        if (bad(res)) { throw fake_archive_exc_t(); }
+        EXPECT_EQ(make_message(), message);
+        got_message = true;
+    }
+    bool got_message;
+};
+
+TPTEST_MULTITHREAD(RPCConnectivityTest, Compression, 3) {
+    connectivity_cluster_t c1, c2, c3;
+    large_message_test_application_t a1(&c1), a2(&c2), a3(&c3);
+    test_cluster_run_t cr1(&c1, peer_address_t(), true);
+    test_cluster_run_t cr2(&c2, peer_address_t(), true);
+    test_cluster_run_t cr3(&c3);
+    cr2.join(get_cluster_local_address(&c1), 0);
+    cr3.join(get_cluster_local_address(&c1), 0);
+
+    let_stuff_happen();
+
+    a1.send_message(c2.get_me());
+    a1.send_message(c3.get_me());
+    a3.send_message(c1.get_me());
+
+    let_stuff_happen();
+
+    EXPECT_TRUE(a2.got_message);
+    EXPECT_TRUE(a3.got_message);
+    EXPECT_TRUE(a1.got_message);
+}
+
 /* `PeerIDSemantics` makes sure that `peer_id_t::is_nil()` works as expected. */
 TPTEST_MULTITHREAD(RPCConnectivityTest, PeerIDSemantics, 3) {
     peer_id_t nil_peer;
@@ -800,4 +876,23 @@ TPTEST(RPCConnectivityTest, CanonicalAddress) {
     // cool cool cool
 }
 
+/* `PhiAccrual` checks that the failure detector gets suspicious sooner on a regular
+connection than on a jittery one. */
+TEST(RPCConnectivityTest, PhiAccrual) {
+    phi_accrual_failure_detector_t regular(10), jittery(10);
+    EXPECT_EQ(0, regular.phi(0));
+    int64_t now = 0;
+    for (int i = 0; i < 20; ++i) {
+        now += 1000;
+        regular.heartbeat(now);
+        jittery.heartbeat(now + (i % 2 == 0 ? 0 : 900));
+    }
+    EXPECT_LT(regular.phi(now + 1000), 1);
+    EXPECT_GT(regular.phi(now + 3000), 8);
+    EXPECT_LT(jittery.phi(now + 3000), regular.phi(now + 3000));
+
+    regular.reset(10);
+    EXPECT_EQ(0, regular.phi(now + 3000));
+}
+
 }   /* namespace unittest */
@@ -19,6 +19,7 @@ class sl_int_t {
 public:
     sl_int_t() { }
     explicit sl_int_t(uint64_t initial) : i(initial) { }
+    bool operator==(const sl_int_t &other) const { return i == other.i; }
     uint64_t i;
 };
 
@@ -93,6 +94,12 @@ TPTEST(RPCSemilatticeTest, MetadataExchange, 2) {
 
     slm1.get_root_view()->sync_to(cluster2.get_me(), &non_interruptor);
     EXPECT_EQ(7u, slm2.get_root_view()->get().i);
+
+    /* `slm2` already has this, so `slm1` only sends it the new version, but
+    `sync_to()` must still work. */
+    slm1.get_root_view()->join(sl_int_t(7));
+    slm1.get_root_view()->sync_to(cluster2.get_me(), &non_interruptor);
+    EXPECT_EQ(7u, slm2.get_root_view()->get().i);
 }
 
 TPTEST(RPCSemilatticeTest, SyncFrom, 2) {
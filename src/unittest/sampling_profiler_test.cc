@@ -0,0 +1,35 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/sampling_profiler.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+#ifdef __linux__
+TEST(SamplingProfilerTest, RecordsBusyThread) {
+    run_in_thread_pool([&]() {
+        sampling_profiler_t *profiler = &sampling_profiler_t::get_global_profiler();
+        profiler->reset();
+        ASSERT_TRUE(profiler->start_on_this_thread(SAMPLING_PROFILER_MAX_HZ));
+
+        // The timer only counts CPU time, so we have to keep the thread busy.
+        volatile uint64_t sum = 0;
+        const ticks_t end_ticks = get_ticks() + 200 * MILLION;
+        while (get_ticks() < end_ticks) {
+            for (int i = 0; i < 1000; ++i) {
+                sum = sum + i;
+            }
+        }
+        profiler->stop_on_this_thread();
+
+        const std::string stacks = profiler->get_folded_stacks();
+        EXPECT_FALSE(stacks.empty());
+        EXPECT_EQ('\n', stacks.back());
+        profiler->reset();
+        EXPECT_EQ("", profiler->get_folded_stacks());
+    });
+}
+#endif  // __linux__
+
+}  // namespace unittest
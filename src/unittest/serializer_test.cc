@@ -30,7 +30,7 @@ void run_AddDeleteRepeatedly(bool perform_index_write) {
 
     buf_ptr_t buf = buf_ptr_t::alloc_zeroed(ser.max_block_size());
 
-    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(1, "test"));
 
     // We run enough create/delete operations to run ourselves through the young
     // extent queue and (with perform_index_write true) kick off a GC that reproduces
@@ -0,0 +1,36 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string>
+
+#include "rdb_protocol/sindex_stats.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+TEST(SindexStatsTest, HyperLogLogEstimate) {
+    hyperloglog_t empty;
+    EXPECT_EQ(0.0, empty.estimate());
+
+    // The standard error with 1024 registers is about 3%, so 10% is very unlikely to
+    // be exceeded, and the hash function is deterministic anyway.
+    const int sizes[] = {10, 1000, 100000};
+    for (int size : sizes) {
+        hyperloglog_t sketch;
+        for (int i = 0; i < size; ++i) {
+            // Adding every value twice doesn't change the estimate.
+            sketch.add(strprintf("value %d", i));
+            sketch.add(strprintf("value %d", i));
+        }
+        EXPECT_NEAR(size, sketch.estimate(), size * 0.1) << size;
+    }
+
+    hyperloglog_t a, b;
+    for (int i = 0; i < 5000; ++i) {
+        a.add(strprintf("%d", i));
+        b.add(strprintf("%d", i + 2500));
+    }
+    a.merge(b);
+    EXPECT_NEAR(7500, a.estimate(), 750);
+}
+
+}  // namespace unittest
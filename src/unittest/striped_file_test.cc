@@ -0,0 +1,107 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/io/striped_file.hpp"
+
+#include <string.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "concurrency/cond_var.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/mock_file.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+class striped_file_test_callback_t : public linux_iocallback_t, public cond_t {
+public:
+    void on_io_complete() {
+        pulse();
+    }
+};
+
+TEST(StripedFileTest, Sizes) {
+    const int64_t unit = 4 * DEVICE_BLOCK_SIZE;
+    for (size_t num_files = 1; num_files <= 4; ++num_files) {
+        for (int64_t size = 0; size <= unit * 10; size += DEVICE_BLOCK_SIZE) {
+            int64_t total = 0;
+            int64_t derived = 0;
+            for (size_t i = 0; i < num_files; ++i) {
+                const int64_t physical =
+                    striped_file_t::physical_size(size, i, num_files, unit);
+                total += physical;
+                derived = std::max(derived, striped_file_t::logical_size(
+                    physical, i, num_files, unit));
+            }
+            EXPECT_EQ(size, total);
+            EXPECT_EQ(size, derived);
+        }
+    }
+}
+
+TPTEST(StripedFileTest, ReadWrite) {
+    const int64_t unit = 2 * DEVICE_BLOCK_SIZE;
+    const size_t num_files = 3;
+    std::vector<std::vector<char> > data(num_files);
+    std::vector<scoped_ptr_t<file_t> > files(num_files);
+    for (size_t i = 0; i < num_files; ++i) {
+        files[i].init(new mock_file_t(mock_file_t::mode_rw, &data[i]));
+    }
+    striped_file_t file(std::move(files), unit);
+    file.set_file_size(unit * 7);
+    ASSERT_EQ(unit * 7, file.get_file_size());
+    ASSERT_EQ(static_cast<size_t>(unit * 3), data[0].size());
+    ASSERT_EQ(static_cast<size_t>(unit * 2), data[1].size());
+    ASSERT_EQ(static_cast<size_t>(unit * 2), data[2].size());
+
+    // Crosses several unit boundaries, and goes around the files once.
+    const size_t length = unit * 5;
+    scoped_device_block_aligned_ptr_t<char> in(length);
+    for (size_t i = 0; i < length; ++i) {
+        in.get()[i] = static_cast<char>(i / DEVICE_BLOCK_SIZE);
+    }
+    {
+        striped_file_test_callback_t cb;
+        file.write_async(DEVICE_BLOCK_SIZE, length, in.get(), DEFAULT_DISK_ACCOUNT, &cb,
+                         file_t::WRAP_IN_DATASYNCS);
+        cb.wait();
+    }
+    // Logical block 1 is the second block of unit 0, in file 0.
+    EXPECT_EQ(0, data[0][DEVICE_BLOCK_SIZE]);
+    // Logical block 2 starts unit 1, in file 1.
+    EXPECT_EQ(1, data[1][0]);
+    // Logical block 6 starts unit 3, which is the second unit of file 0.
+    EXPECT_EQ(5, data[0][unit]);
+
+    scoped_device_block_aligned_ptr_t<char> out(length);
+    {
+        striped_file_test_callback_t cb;
+        file.read_async(DEVICE_BLOCK_SIZE, length, out.get(), DEFAULT_DISK_ACCOUNT, &cb);
+        cb.wait();
+    }
+    EXPECT_EQ(0, memcmp(in.get(), out.get(), length));
+
+    // A vectored write whose buffers don't line up with the units
+    scoped_array_t<iovec> bufs(2);
+    bufs[0].iov_base = out.get();
+    bufs[0].iov_len = DEVICE_BLOCK_SIZE * 3;
+    bufs[1].iov_base = out.get() + DEVICE_BLOCK_SIZE * 3;
+    bufs[1].iov_len = DEVICE_BLOCK_SIZE;
+    for (size_t i = 0; i < DEVICE_BLOCK_SIZE * 4; ++i) {
+        out.get()[i] = static_cast<char>(100 + i / DEVICE_BLOCK_SIZE);
+    }
+    {
+        striped_file_test_callback_t cb;
+        file.writev_async(unit * 4, DEVICE_BLOCK_SIZE * 4, std::move(bufs),
+                          DEFAULT_DISK_ACCOUNT, &cb);
+        cb.wait();
+    }
+    // Units 4 and 5 are the second units of files 1 and 2.
+    EXPECT_EQ(100, data[1][unit]);
+    EXPECT_EQ(101, data[1][unit + DEVICE_BLOCK_SIZE]);
+    EXPECT_EQ(102, data[2][unit]);
+    EXPECT_EQ(103, data[2][unit + DEVICE_BLOCK_SIZE]);
+}
+
+}  // namespace unittest
@@ -0,0 +1,62 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/timer.hpp"
+
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "concurrency/cond_var.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+class recording_timer_callback_t : public timer_callback_t {
+public:
+    recording_timer_callback_t(int _id, std::vector<int> *_rings, cond_t *_done)
+        : id(_id), rings(_rings), done(_done) { }
+    void on_timer() {
+        rings->push_back(id);
+        if (done != nullptr) {
+            done->pulse_if_not_already_pulsed();
+        }
+    }
+private:
+    int id;
+    std::vector<int> *rings;
+    cond_t *done;
+};
+
+/* Timers on both sides of `TIMER_WHEEL_MIN_MS` go into different structures, but must
+still ring in order. */
+TPTEST(TimerTest, WheelAndQueueOrder) {
+    std::vector<int> rings;
+    cond_t done;
+    recording_timer_callback_t short_cb(0, &rings, nullptr);
+    recording_timer_callback_t long_cb(1, &rings, nullptr);
+    recording_timer_callback_t longer_cb(2, &rings, &done);
+    recording_timer_callback_t canceled_cb(3, &rings, nullptr);
+
+    fire_timer_once(TIMER_WHEEL_MIN_MS * 3, &longer_cb);
+    timer_token_t *canceled = fire_timer_once(TIMER_WHEEL_MIN_MS * 2, &canceled_cb);
+    fire_timer_once(TIMER_WHEEL_MIN_MS + TIMER_WHEEL_TICK_MS * 5, &long_cb);
+    fire_timer_once(TIMER_WHEEL_MIN_MS / 2, &short_cb);
+    cancel_timer(canceled);
+
+    done.wait();
+    ASSERT_EQ(3u, rings.size());
+    EXPECT_EQ(0, rings[0]);
+    EXPECT_EQ(1, rings[1]);
+    EXPECT_EQ(2, rings[2]);
+}
+
+TPTEST(TimerTest, RepeatingWheelTimer) {
+    std::vector<int> rings;
+    recording_timer_callback_t cb(0, &rings, nullptr);
+    timer_token_t *token = add_timer(TIMER_WHEEL_MIN_MS, &cb);
+    nap(TIMER_WHEEL_MIN_MS * 3 + TIMER_WHEEL_MIN_MS / 2);
+    cancel_timer(token);
+    EXPECT_LE(2u, rings.size());
+    EXPECT_GE(3u, rings.size());
+}
+
+}  // namespace unittest
@@ -0,0 +1,40 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/trigrams.hpp"
+
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(TrigramsTest, StringTrigrams) {
+    std::vector<std::string> expected = {" mi", "ith", "mit", "s m", "smi", "ths"};
+    EXPECT_EQ(expected, ql::string_trigrams("Smiths mith"));
+    EXPECT_EQ(std::vector<std::string>(), ql::string_trigrams("ab"));
+    // Trigrams are made of code points, not bytes.
+    expected = {"h\xc3\xa9l"};
+    EXPECT_EQ(expected, ql::string_trigrams("H\xc3\xa9l"));
+}
+
+TEST(TrigramsTest, RequiredTrigram) {
+    std::string trigram;
+    ASSERT_TRUE(ql::find_required_trigram("Smith", &trigram));
+    EXPECT_EQ("smi", trigram);
+    ASSERT_TRUE(ql::find_required_trigram("ab+cde", &trigram));
+    EXPECT_EQ("cde", trigram);
+    ASSERT_TRUE(ql::find_required_trigram("\\x41bcd", &trigram));
+    EXPECT_EQ("bcd", trigram);
+    ASSERT_TRUE(ql::find_required_trigram("[abc]def", &trigram));
+    EXPECT_EQ("def", trigram);
+    ASSERT_TRUE(ql::find_required_trigram("x(abcd)yz", &trigram));
+    EXPECT_EQ("abc", trigram);
+    // With flags, trigrams containing `k` or `s` don't count.
+    ASSERT_TRUE(ql::find_required_trigram("(?i)smith", &trigram));
+    EXPECT_EQ("mit", trigram);
+
+    EXPECT_FALSE(ql::find_required_trigram("abc|def", &trigram));
+    EXPECT_FALSE(ql::find_required_trigram("x(abc)?yz", &trigram));
+    EXPECT_FALSE(ql::find_required_trigram("abc*", &trigram));
+    EXPECT_FALSE(ql::find_required_trigram("ab\\dcd", &trigram));
+    EXPECT_FALSE(ql::find_required_trigram("(abc", &trigram));
+}
+
+}  // namespace unittest
@@ -0,0 +1,34 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/user_quotas.hpp"
+
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(UserQuotaTest, Parse) {
+    std::string username;
+    ql::user_quota_t quota;
+    std::string error;
+    ASSERT_TRUE(ql::parse_user_quota(
+        "analytics:concurrent_queries=4,read_bytes_per_sec=1000,priority=low",
+        &username, &quota, &error));
+    EXPECT_EQ("analytics", username);
+    EXPECT_EQ(4u, quota.max_concurrent_queries);
+    EXPECT_EQ(1000u, quota.max_read_bytes_per_sec);
+    EXPECT_EQ(0u, quota.max_write_ops_per_sec);
+    EXPECT_EQ(ql::query_priority_t::LOW, quota.max_priority);
+
+    ASSERT_TRUE(ql::parse_user_quota("bob:", &username, &quota, &error));
+    EXPECT_EQ("bob", username);
+    EXPECT_EQ(0u, quota.max_concurrent_queries);
+    EXPECT_EQ(ql::query_priority_t::HIGH, quota.max_priority);
+
+    EXPECT_FALSE(ql::parse_user_quota("bob", &username, &quota, &error));
+    EXPECT_FALSE(ql::parse_user_quota("bob:size=3", &username, &quota, &error));
+    EXPECT_FALSE(ql::parse_user_quota("bob:concurrent_queries=x",
+                                      &username, &quota, &error));
+    EXPECT_FALSE(ql::parse_user_quota("bob:priority=urgent",
+                                      &username, &quota, &error));
+}
+
+}  // namespace unittest
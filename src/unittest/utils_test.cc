@@ -120,6 +120,35 @@ TEST(BtreeUtilsTest, SizedStrcmp) {
     ASSERT_NE(0, sized_strcmp(test3, 11, test1, 14));
 }
 
+TEST(BtreeUtilsTest, KeyCmpAfterPrefix) {
+    const std::string strs[] = {"", "a", "ab", "abcdefghijklmnop", "abcdefghijklmnoq",
+                                "abcdefghijklmnopqrstuvwxyz", "abcdefghij", "b"};
+    for (const std::string &l : strs) {
+        for (const std::string &r : strs) {
+            store_key_t left(l);
+            store_key_t right(r);
+            int common_prefix = 0;
+            const int res = btree_key_cmp_after_prefix(
+                left.btree_key(), right.btree_key(), &common_prefix);
+            const int expected = btree_key_cmp(left.btree_key(), right.btree_key());
+            ASSERT_EQ(expected < 0, res < 0);
+            ASSERT_EQ(expected > 0, res > 0);
+
+            size_t lcp = 0;
+            while (lcp < l.size() && lcp < r.size() && l[lcp] == r[lcp]) {
+                ++lcp;
+            }
+            ASSERT_EQ(static_cast<int>(lcp), common_prefix);
+
+            // Starting from a known common prefix must give the same answer.
+            int known_prefix = lcp / 2;
+            ASSERT_EQ(res, btree_key_cmp_after_prefix(
+                left.btree_key(), right.btree_key(), &known_prefix));
+            ASSERT_EQ(common_prefix, known_prefix);
+        }
+    }
+}
+
 /* This doesn't quite belong in `utils_test.cc`, but I don't want to create a
 new file just for it. */
 
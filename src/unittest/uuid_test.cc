@@ -2,6 +2,7 @@
 #ifndef _WIN32
 #include <arpa/inet.h>
 #endif
+#include <string.h>
 
 #include "containers/uuid.hpp"
 #include "unittest/gtest.hpp"
@@ -63,6 +64,14 @@ TEST(UuidTest, StrToUuid) {
     ASSERT_FALSE(failure);
 }
 
+TEST(UuidTest, TimeOrdered) {
+    uuid_u first = generate_time_ordered_uuid();
+    uuid_u second = generate_time_ordered_uuid();
+    EXPECT_EQ('7', uuid_to_str(first)[14]);
+    // Apart from the first byte, later UUIDs sort after the earlier ones.
+    EXPECT_LE(memcmp(first.data() + 1, second.data() + 1, 5), 0);
+}
+
 void check_sha(const std::string &str, uint32_t expected[5]) {
     union {
         uint8_t hash[24];
@@ -0,0 +1,315 @@
+#!/usr/bin/env python
+# Copyright 2010-2016 RethinkDB, all rights reserved.
+
+"""Open-loop load generator with YCSB-like workload mixes.
+
+Unlike `test.py`, which runs each query back to back, this issues operations at a
+fixed target rate against a running cluster and measures every latency from the
+time the operation was *scheduled* to start.  A stalled server therefore shows up
+as high latency for all the operations that should have been issued during the
+stall, instead of as a lower throughput (i.e. the measurement is free of
+coordinated omission).
+
+Latencies are recorded per operation type in log-linear histograms, and saved to
+`results/` in the same format as `test.py`, so runs can be compared with
+`compare.py`.
+
+Usage:
+    python workload.py --port 28015 --mix a --rate 2000 --duration 60
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import math
+import os
+import random
+import subprocess
+import sys
+import threading
+import time
+
+from util import gen_doc
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
+import utils
+
+r = utils.import_python_driver()
+
+try:
+    xrange
+except NameError:
+    xrange = range
+
+# The fraction of each operation type in each mix.  `a` to `e` follow the YCSB core
+# workloads, `sindex` does lookups on a secondary index and `feeds` measures how
+# long it takes for writes to reach a number of open changefeeds.
+mixes = {
+    "a": {"get": 0.5, "update": 0.5},
+    "b": {"get": 0.95, "update": 0.05},
+    "c": {"get": 1.0},
+    "d": {"get": 0.95, "insert": 0.05},
+    "e": {"scan": 0.95, "insert": 0.05},
+    "sindex": {"sindex_get": 0.9, "update": 0.1},
+    "feeds": {"update": 1.0}
+}
+
+class Histogram(object):
+    """Latency histogram with a bounded relative error, in the spirit of HDR
+    histograms: values are bucketed by their power of two, and each power of two is
+    split into `sub_buckets` linear buckets."""
+
+    def __init__(self, sub_buckets=64):
+        self.sub_buckets = sub_buckets
+        self.counts = {}
+        self.count = 0
+        self.total = 0.0
+        self.min = None
+        self.max = None
+
+    def bucket(self, value_us):
+        if value_us < self.sub_buckets:
+            return int(value_us)
+        exponent = int(value_us).bit_length() - self.sub_buckets.bit_length()
+        return (exponent + 1) * self.sub_buckets + (int(value_us) >> exponent) - self.sub_buckets
+
+    def bucket_value(self, bucket):
+        if bucket < self.sub_buckets:
+            return float(bucket)
+        exponent = bucket // self.sub_buckets - 1
+        return float((bucket - (exponent + 1) * self.sub_buckets + self.sub_buckets) << exponent)
+
+    def record(self, latency):
+        self.count += 1
+        self.total += latency
+        self.min = latency if self.min is None else min(self.min, latency)
+        self.max = latency if self.max is None else max(self.max, latency)
+        b = self.bucket(max(0, latency * 1000000))
+        self.counts[b] = self.counts.get(b, 0) + 1
+
+    def merge(self, other):
+        for b, c in other.counts.items():
+            self.counts[b] = self.counts.get(b, 0) + c
+        self.count += other.count
+        self.total += other.total
+        for v in (other.min, other.max):
+            if v is not None:
+                self.min = v if self.min is None else min(self.min, v)
+                self.max = v if self.max is None else max(self.max, v)
+
+    def percentile(self, p):
+        """Returns the latency in seconds below which `p` percent of the values lie."""
+        if self.count == 0:
+            return 0.0
+        rank = max(1, int(math.ceil(self.count * p / 100.0)))
+        seen = 0
+        for b in sorted(self.counts):
+            seen += self.counts[b]
+            if seen >= rank:
+                return min(self.bucket_value(b) / 1000000, self.max)
+        return self.max
+
+class Worker(threading.Thread):
+    """Issues the operations of one share of the target rate on its own connection."""
+
+    def __init__(self, args, seed, rate, start_time, key_count):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.args = args
+        self.random = random.Random(seed)
+        self.interval = 1.0 / rate
+        self.start_time = start_time
+        self.key_count = key_count
+        self.next_key = key_count + seed * 1000000000
+        self.histograms = {}
+        self.errors = 0
+        self.ops = sorted(mixes[args.mix].items())
+
+    def pick_op(self):
+        x = self.random.random()
+        for name, fraction in self.ops:
+            x -= fraction
+            if x < 0:
+                return name
+        return self.ops[-1][0]
+
+    def run_op(self, conn, table, op):
+        key = self.random.randrange(self.key_count)
+        if op == "get":
+            table.get(key).run(conn)
+        elif op == "update":
+            table.get(key).update({"int": r.row["int"].default(0) + 1,
+                                   "updated_at": r.now()}).run(conn, durability=self.args.durability)
+        elif op == "insert":
+            doc = gen_doc(self.args.doc_size, self.next_key)
+            doc["id"] = self.next_key
+            self.next_key += 1
+            table.insert(doc).run(conn, durability=self.args.durability)
+        elif op == "scan":
+            list(table.between(key, key + self.random.randint(1, 100)).run(conn))
+        elif op == "sindex_get":
+            list(table.get_all(str(key // 1000), index="field0").limit(10).run(conn))
+
+    def run(self):
+        conn = r.connect(host=self.args.host, port=self.args.port)
+        table = r.db(self.args.db).table(self.args.table)
+        end_time = self.start_time + self.args.duration
+        scheduled = self.start_time + self.random.random() * self.interval
+        while scheduled < end_time:
+            now = time.time()
+            if now < scheduled:
+                time.sleep(scheduled - now)
+            op = self.pick_op()
+            try:
+                self.run_op(conn, table, op)
+            except r.errors.ReqlError:
+                self.errors += 1
+            # Measured from the scheduled start, so that time spent waiting for
+            # earlier operations counts too.
+            self.histograms.setdefault(op, Histogram()).record(time.time() - scheduled)
+            scheduled += self.interval
+        conn.close()
+
+class FeedListener(threading.Thread):
+    """Follows a changefeed on the table, recording how long changes take to arrive
+    after the `updated_at` time the update wrote.  That time comes from the server's
+    clock, so this assumes the clocks are in sync if the cluster runs elsewhere."""
+
+    def __init__(self, args, ready):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.args = args
+        self.ready = ready
+        self.histogram = Histogram()
+
+    def run(self):
+        conn = r.connect(host=self.args.host, port=self.args.port)
+        feed = r.db(self.args.db).table(self.args.table).changes()["new_val"]["updated_at"] \
+                .default(None).run(conn, time_format="raw")
+        self.ready.release()
+        end_time = time.time() + self.args.duration
+        for updated_at in feed:
+            if updated_at is not None:
+                self.histogram.record(time.time() - updated_at["epoch_time"])
+            if time.time() > end_time:
+                break
+        conn.close()
+
+def load_table(args):
+    conn = r.connect(host=args.host, port=args.port)
+    if args.db not in r.db_list().run(conn):
+        r.db_create(args.db).run(conn)
+    if args.table in r.db(args.db).table_list().run(conn):
+        r.db(args.db).table_drop(args.table).run(conn)
+    r.db(args.db).table_create(args.table).run(conn)
+    table = r.db(args.db).table(args.table)
+    table.index_create("field0").run(conn)
+    table.index_wait().run(conn)
+
+    print("Inserting %d documents..." % args.keys, end=' ')
+    sys.stdout.flush()
+    random.seed(args.seed)
+    batch = []
+    for i in xrange(args.keys):
+        doc = gen_doc(args.doc_size, i)
+        doc["id"] = i
+        batch.append(doc)
+        if len(batch) == 200:
+            table.insert(batch).run(conn, durability="soft")
+            batch = []
+    if batch:
+        table.insert(batch).run(conn, durability="soft")
+    table.sync().run(conn)
+    print(" Done.")
+    conn.close()
+
+def summarize(histogram, duration):
+    return {
+        "average": duration / max(1, histogram.count),
+        "count": histogram.count,
+        "mean_latency": histogram.total / max(1, histogram.count),
+        "min": histogram.min or 0.0,
+        "max": histogram.max or 0.0,
+        "first_centile": histogram.percentile(1),
+        "median": histogram.percentile(50),
+        "p99": histogram.percentile(99),
+        "p999": histogram.percentile(99.9),
+        "last_centile": histogram.percentile(99)
+    }
+
+def main():
+    parser = argparse.ArgumentParser(description="Open-loop load generator")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=28015)
+    parser.add_argument("--db", default="test")
+    parser.add_argument("--table", default="workload")
+    parser.add_argument("--mix", choices=sorted(mixes.keys()), default="a")
+    parser.add_argument("--rate", type=float, default=1000, help="operations per second")
+    parser.add_argument("--duration", type=float, default=60, help="seconds")
+    parser.add_argument("--workers", type=int, default=16)
+    parser.add_argument("--keys", type=int, default=100000)
+    parser.add_argument("--doc-size", choices=["small", "big"], default="small")
+    parser.add_argument("--durability", choices=["hard", "soft"], default="hard")
+    parser.add_argument("--feeds", type=int, default=10,
+                        help="changefeeds to open with the `feeds` mix")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--no-load", action="store_true",
+                        help="reuse the data from a previous run")
+    args = parser.parse_args()
+
+    if not args.no_load:
+        load_table(args)
+
+    listeners = []
+    if args.mix == "feeds":
+        ready = threading.Semaphore(0)
+        listeners = [FeedListener(args, ready) for i in xrange(args.feeds)]
+        for listener in listeners:
+            listener.start()
+        for listener in listeners:
+            ready.acquire()
+
+    start_time = time.time() + 1
+    workers = [Worker(args, args.seed * 1000 + i, args.rate / args.workers, start_time, args.keys)
+               for i in xrange(args.workers)]
+    print("Running mix %s at %g ops/s for %g s..." % (args.mix, args.rate, args.duration), end=' ')
+    sys.stdout.flush()
+    for worker in workers:
+        worker.start()
+    for worker in workers:
+        worker.join()
+    print(" Done.")
+
+    histograms = {}
+    for worker in workers:
+        for op, histogram in worker.histograms.items():
+            histograms.setdefault(op, Histogram()).merge(histogram)
+    if listeners:
+        # The listeners stop with the first change after the run ended.
+        feed_histogram = Histogram()
+        for listener in listeners:
+            listener.join(5)
+            feed_histogram.merge(listener.histogram)
+        histograms["feed_delivery"] = feed_histogram
+
+    results = {}
+    for op, histogram in histograms.items():
+        results["workload-%s-%s-%s" % (args.mix, op, args.doc_size)] = summarize(histogram, args.duration)
+        print("%-14s %8d ops  median %8.2f ms  p99 %8.2f ms  p99.9 %8.2f ms  max %8.2f ms" % (
+            op, histogram.count, histogram.percentile(50) * 1000, histogram.percentile(99) * 1000,
+            histogram.percentile(99.9) * 1000, (histogram.max or 0.0) * 1000))
+    errors = sum(worker.errors for worker in workers)
+    if errors:
+        print("%d operations failed" % errors)
+
+    results["hash"] = subprocess.Popen(['git', 'log', '-n 1', '--pretty=format:"%H"'], stdout=subprocess.PIPE).communicate()[0].decode('utf-8')
+    if not os.path.exists("results"):
+        os.makedirs("results")
+    path = "results/workload_%s_%s.txt" % (args.mix, time.strftime("%y.%m.%d-%H:%M:%S"))
+    with open(path, "w") as f:
+        f.write(json.dumps(results, indent=2))
+    print("Results saved in %s" % path)
+
+if __name__ == "__main__":
+    main()